@@ -0,0 +1,87 @@
+#pragma once
+
+#include <vector>
+#include "Geometry.h"
+
+// Damage accumulated between paints. Overlapping rectangles are merged as they arrive, and once
+// there are too many to be worth invalidating one by one they collapse into their union.
+class DirtyRegion
+{
+public:
+	void add(const Bounds& bounds)
+	{
+		if (bounds.isEmpty())
+		{
+			return;
+		}
+
+		Bounds merged{ bounds };
+
+		// absorbing one rectangle can make the result overlap another, so keep going until it settles
+		bool absorbed{ true };
+		while (absorbed)
+		{
+			absorbed = false;
+			for (std::size_t i{ 0 }; i < m_rects.size(); ++i)
+			{
+				if (m_rects[i].intersects(merged))
+				{
+					merged = merged.united(m_rects[i]);
+					m_rects[i] = m_rects.back();
+					m_rects.pop_back();
+					absorbed = true;
+					break;
+				}
+			}
+		}
+
+		m_rects.push_back(merged);
+
+		if (m_rects.size() > kMaxRects)
+		{
+			Bounds all{ getBounds() };
+			m_rects.assign(1, all);
+		}
+	}
+
+	void add(const DirtyRegion& other)
+	{
+		for (const auto& rect : other.m_rects)
+		{
+			add(rect);
+		}
+	}
+
+	bool isEmpty() const { return m_rects.empty(); }
+
+	bool intersects(const Bounds& bounds) const
+	{
+		for (const auto& rect : m_rects)
+		{
+			if (rect.intersects(bounds))
+			{
+				return true;
+			}
+		}
+		return false;
+	}
+
+	Bounds getBounds() const
+	{
+		Bounds all{ Bounds::empty() };
+		for (const auto& rect : m_rects)
+		{
+			all = all.united(rect);
+		}
+		return all;
+	}
+
+	const std::vector<Bounds>& getRects() const { return m_rects; }
+
+	void clear() { m_rects.clear(); }
+
+private:
+	static constexpr std::size_t kMaxRects{ 8 };
+
+	std::vector<Bounds> m_rects;
+};
@@ -0,0 +1,229 @@
+#pragma once
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "Geometry.h"
+#include "RenderBackend.h"
+
+// Records what the shapes draw so it can be drawn again later, somewhere else: the window records the
+// static layer on the UI thread and tile workers replay it. Once recorded a list is only read, so any
+// number of threads can replay it at once. Each command keeps its bounds on the canvas, so a replay
+// only draws what reaches the area it's asked for.
+class DisplayList : public RenderBackend
+{
+public:
+	// scale is what getScale reports while recording, so shapes pick the level of detail they'll be seen at
+	explicit DisplayList(float scale = 1.0f) : m_scale(scale) {}
+
+	void drawLine(float x1, float y1, float x2, float y2, std::uint32_t color, float width) override
+	{
+		RenderPoint points[2]{ { x1, y1 }, { x2, y2 } };
+		record(Op::Line, points, 2, color, width, false);
+	}
+
+	void drawRect(float x, float y, float width, float height, std::uint32_t color, float penWidth, bool filled) override
+	{
+		RenderPoint corners[2]{ { x, y }, { x + width, y + height } };
+		record(Op::Rect, corners, 2, color, penWidth, filled);
+	}
+
+	void drawEllipse(float x, float y, float width, float height, std::uint32_t color, float penWidth, bool filled) override
+	{
+		RenderPoint corners[2]{ { x, y }, { x + width, y + height } };
+		record(Op::Ellipse, corners, 2, color, penWidth, filled);
+	}
+
+	void drawPolygon(const RenderPoint* points, std::size_t count, std::uint32_t color, float penWidth, bool filled) override
+	{
+		record(Op::Polygon, points, count, color, penWidth, filled);
+	}
+
+	void drawCurve(const RenderPoint* points, std::size_t count, std::uint32_t color, float penWidth) override
+	{
+		record(Op::Curve, points, count, color, penWidth, false);
+	}
+
+	void drawBeziers(const RenderPoint* points, std::size_t count, std::uint32_t color, float penWidth) override
+	{
+		record(Op::Beziers, points, count, color, penWidth, false);
+	}
+
+	void drawPolyline(const RenderPoint* points, std::size_t count, std::uint32_t color, float width) override
+	{
+		record(Op::Polyline, points, count, color, width, false);
+	}
+
+	void drawText(const std::wstring& text, float x, float y, const std::wstring& family, float size, std::uint32_t color) override
+	{
+		// glyphs aren't measured here, so the bounds are generous: a few ems around each character
+		float em{ std::fabs(size) };
+		Bounds bounds{ x - em, y - 2.0f * em, x + em * (2.0f + 3.0f * static_cast<float>(text.size())), y + 4.0f * em };
+
+		RenderPoint origin{ x, y };
+		m_texts.push_back(Text{ text, family });
+		addCommand(Op::Text, &origin, 1, color, size, false, bounds).text = static_cast<std::uint32_t>(m_texts.size() - 1);
+	}
+
+	void setTransform(const Transform& transform) override
+	{
+		if (transform != m_transforms[m_transform])
+		{
+			m_transforms.push_back(transform);
+			m_transform = static_cast<std::uint32_t>(m_transforms.size() - 1);
+		}
+	}
+
+	float getScale() const override { return m_scale; }
+
+	std::size_t size() const { return m_commands.size(); }
+	bool empty() const { return m_commands.empty(); }
+
+	// draws the recorded commands that reach area, in the order they were recorded
+	void replay(RenderBackend& backend, const Bounds& area) const { replay(backend, area, 0, m_commands.size()); }
+
+	// Draws the recorded commands from first up to but not including last that reach area, in order, e.g. the
+	// run between two of the commands findPlainText finds. Returns how many it drew.
+	std::size_t replay(RenderBackend& backend, const Bounds& area, std::size_t first, std::size_t last) const
+	{
+		std::size_t drawn{ 0 };
+		std::uint32_t current{ 0 };
+		for (std::size_t i{ first }; i < last && i < m_commands.size(); ++i)
+		{
+			const Command& command{ m_commands[i] };
+			if (!command.bounds.intersects(area))
+			{
+				continue;
+			}
+			++drawn;
+
+			if (command.transform != current)
+			{
+				current = command.transform;
+				backend.setTransform(m_transforms[current]);
+			}
+
+			const RenderPoint* points{ &m_points[command.first] };
+			switch (command.op)
+			{
+			case Op::Line:
+				backend.drawLine(points[0].x, points[0].y, points[1].x, points[1].y, command.color, command.width);
+				break;
+			case Op::Rect:
+				backend.drawRect(points[0].x, points[0].y, points[1].x - points[0].x, points[1].y - points[0].y, command.color, command.width, command.filled);
+				break;
+			case Op::Ellipse:
+				backend.drawEllipse(points[0].x, points[0].y, points[1].x - points[0].x, points[1].y - points[0].y, command.color, command.width, command.filled);
+				break;
+			case Op::Polygon:
+				backend.drawPolygon(points, command.count, command.color, command.width, command.filled);
+				break;
+			case Op::Curve:
+				backend.drawCurve(points, command.count, command.color, command.width);
+				break;
+			case Op::Beziers:
+				backend.drawBeziers(points, command.count, command.color, command.width);
+				break;
+			case Op::Polyline:
+				backend.drawPolyline(points, command.count, command.color, command.width);
+				break;
+			case Op::Text:
+			{
+				const Text& text{ m_texts[command.text] };
+				backend.drawText(text.text, points[0].x, points[0].y, text.family, command.width, command.color);
+				break;
+			}
+			}
+		}
+
+		if (current != 0)
+		{
+			backend.setTransform(Transform{});
+		}
+		return drawn;
+	}
+
+	// Finds the text commands in fonts other than Leland that reach area, in recorded order. A backend with
+	// only Leland's outlines can't draw them, so to keep z order it draws the runs between them and leaves
+	// each one to a backend that has the font.
+	void findPlainText(const Bounds& area, std::vector<std::size_t>& out) const
+	{
+		out.clear();
+		for (std::size_t i{ 0 }; i < m_commands.size(); ++i)
+		{
+			const Command& command{ m_commands[i] };
+			if (command.op == Op::Text && m_texts[command.text].family != L"Leland" && command.bounds.intersects(area))
+			{
+				out.push_back(i);
+			}
+		}
+	}
+
+private:
+	enum class Op : std::uint8_t
+	{
+		Line,
+		Rect,
+		Ellipse,
+		Polygon,
+		Curve,
+		Beziers,
+		Polyline,
+		Text
+	};
+
+	struct Command
+	{
+		Op op;
+		bool filled;
+		std::uint32_t color;
+		float width; // the pen, or the size of text
+		std::uint32_t first; // into m_points
+		std::uint32_t count;
+		std::uint32_t transform; // into m_transforms
+		std::uint32_t text; // into m_texts, for text
+		Bounds bounds; // on the canvas, pen and transform included
+	};
+
+	struct Text
+	{
+		std::wstring text;
+		std::wstring family;
+	};
+
+	float m_scale;
+	std::vector<Command> m_commands;
+	std::vector<RenderPoint> m_points;
+	std::vector<Transform> m_transforms{ Transform{} };
+	std::uint32_t m_transform{ 0 };
+	std::vector<Text> m_texts;
+
+	void record(Op op, const RenderPoint* points, std::size_t count, std::uint32_t color, float width, bool filled)
+	{
+		if (count == 0)
+		{
+			return;
+		}
+
+		Bounds bounds{ points[0].x, points[0].y, points[0].x, points[0].y };
+		for (std::size_t i{ 1 }; i < count; ++i)
+		{
+			bounds = bounds.united(Bounds{ points[i].x, points[i].y, points[i].x, points[i].y });
+		}
+
+		// a mitred corner reaches out up to five pen widths at the join limit, and no pen is under a pixel
+		float reach{ filled ? 1.0f / m_scale : 5.0f * width + 2.0f / m_scale };
+		addCommand(op, points, count, color, width, filled, bounds.inflated(reach));
+	}
+
+	Command& addCommand(Op op, const RenderPoint* points, std::size_t count, std::uint32_t color, float width, bool filled, const Bounds& bounds)
+	{
+		Command command{ op, filled, color, width, static_cast<std::uint32_t>(m_points.size()), static_cast<std::uint32_t>(count), m_transform, 0,
+			m_transforms[m_transform].map(bounds) };
+		m_points.insert(m_points.end(), points, points + count);
+		m_commands.push_back(command);
+		return m_commands.back();
+	}
+};
@@ -0,0 +1,224 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <utility>
+#include <vector>
+#include "DocumentFile.h"
+#include "Geometry.h"
+#include "RenderBackend.h"
+#include "ShapeStore.h"
+
+// US Letter at the canvas's 96 pixels per inch
+constexpr float kExportPageWidth{ 816.0f };
+constexpr float kExportPageHeight{ 1056.0f };
+
+// Draws one document record straight from the mapped file, the way the store draws the shape it loads as.
+// transform takes the record's values onto the canvas (see GroupStack). points is scratch space, so
+// exporting many records reuses one buffer.
+inline void renderRecord(const DocumentReader& reader, const ShapeRecord& record, const Transform& transform, RenderBackend& backend, std::vector<float>& points)
+{
+	if (!getRecordPoints(reader, record, points))
+	{
+		return;
+	}
+
+	std::wstring text;
+	std::wstring font;
+	if (record.kind == ShapeKind::Symbol || record.kind == ShapeKind::Text)
+	{
+		text = reader.getString(record.textOffset, record.textLength);
+		font = reader.getString(record.fontOffset, record.fontLength);
+	}
+
+	if (!transform.isIdentity())
+	{
+		backend.setTransform(transform);
+	}
+	renderShape(backend, record.kind, points.data(), points.size() / 2, record.color, record.stroke, record.isFilled(), text, font);
+	if (!transform.isIdentity())
+	{
+		backend.setTransform(Transform{});
+	}
+}
+
+// Follows the groups around each record while a document is read in order, which is how groups are
+// written: a group, then everything in it. It keeps one transform per level of nesting, not per record.
+class GroupStack
+{
+public:
+	// what takes record index's values onto the canvas; call it in order for every record drawn and every
+	// group it's in
+	Transform enter(std::size_t index, const ShapeRecord& record)
+	{
+		while (!m_open.empty() && (record.parent == 0 || m_open.back().index != index - record.parent))
+		{
+			m_open.pop_back();
+		}
+
+		Transform transform{ m_open.empty() ? record.transform : record.transform.then(m_open.back().transform) };
+		if (record.kind == ShapeKind::Group)
+		{
+			m_open.push_back(OpenGroup{ index, transform });
+		}
+		return transform;
+	}
+
+	void clear() { m_open.clear(); }
+
+private:
+	struct OpenGroup
+	{
+		std::size_t index;
+		Transform transform;
+	};
+
+	std::vector<OpenGroup> m_open; // outermost first
+};
+
+// Content bounds reach past what's painted by the slack getShapeBounds adds for hit testing, and past a
+// stroke along the edge of a page by half its width. Content reaching no further than this onto a page
+// doesn't give it a page, so a line drawn from the origin doesn't add three near-empty pages above and
+// left of it.
+constexpr float kPageSlack{ 8.0f };
+
+// Pages are cells of a grid anchored at the canvas origin. A page key packs its row over its column, each
+// offset to be unsigned, so sorting keys puts pages in reading order.
+inline std::uint64_t getPageKey(long long column, long long row)
+{
+	return (static_cast<std::uint64_t>(static_cast<std::uint32_t>(row + 0x80000000LL)) << 32) | static_cast<std::uint32_t>(column + 0x80000000LL);
+}
+
+inline Bounds getPageBounds(std::uint64_t key, float pageWidth, float pageHeight)
+{
+	float left{ static_cast<float>(static_cast<long long>(key & 0xFFFFFFFFu) - 0x80000000LL) * pageWidth };
+	float top{ static_cast<float>(static_cast<long long>(key >> 32) - 0x80000000LL) * pageHeight };
+	return Bounds{ left, top, left + pageWidth, top + pageHeight };
+}
+
+// Calls addPage(key) for each page bounds reaches more than slack into; bounds smaller than the slack still
+// get the page they're on.
+template<typename AddPage>
+void forEachPageOf(const Bounds& bounds, float pageWidth, float pageHeight, float slack, AddPage&& addPage)
+{
+	if (bounds.isEmpty())
+	{
+		return;
+	}
+
+	long long firstColumn{ static_cast<long long>(std::floor((bounds.left + slack) / pageWidth)) };
+	long long lastColumn{ static_cast<long long>(std::ceil((bounds.right - slack) / pageWidth)) };
+	long long firstRow{ static_cast<long long>(std::floor((bounds.top + slack) / pageHeight)) };
+	long long lastRow{ static_cast<long long>(std::ceil((bounds.bottom - slack) / pageHeight)) };
+	for (long long row{ firstRow }; row < (std::max)(lastRow, firstRow + 1); ++row)
+	{
+		for (long long column{ firstColumn }; column < (std::max)(lastColumn, firstColumn + 1); ++column)
+		{
+			addPage(getPageKey(column, row));
+		}
+	}
+}
+
+// adds the pages each outermost shape of store reaches to pages
+inline void addPages(const ShapeStore& store, float pageWidth, float pageHeight, std::vector<std::uint64_t>& pages)
+{
+	for (std::size_t i{ 0 }; i < store.size(); ++i)
+	{
+		ShapeHandle shape{ store.getHandle(i) };
+		if (store.getParent(shape) == kNoShape)
+		{
+			forEachPageOf(store.getBounds(shape), pageWidth, pageHeight, kPageSlack, [&pages](std::uint64_t key) { pages.push_back(key); });
+		}
+	}
+}
+
+// Calls drawPage(page) for each of pages once, in reading order; pages that nothing reaches are left out,
+// however far apart the content is. No pages at all still gets the first.
+template<typename DrawPage>
+void forEachPage(std::vector<std::uint64_t>& pages, float pageWidth, float pageHeight, DrawPage&& drawPage)
+{
+	std::sort(pages.begin(), pages.end());
+	pages.erase(std::unique(pages.begin(), pages.end()), pages.end());
+	if (pages.empty())
+	{
+		pages.push_back(getPageKey(0, 0));
+	}
+	for (std::uint64_t key : pages)
+	{
+		drawPage(getPageBounds(key, pageWidth, pageHeight));
+	}
+}
+
+// Writes a mapped document page by page, each page drawn only from the records that reach it. Records
+// are decoded as each page is drawn rather than loaded up front; what's kept meanwhile is a page and an
+// index for each record on each page it reaches, and for the groups it's in there.
+inline bool exportDocument(const DocumentReader& reader, PageBackend& backend, float pageWidth = kExportPageWidth, float pageHeight = kExportPageHeight)
+{
+	ShapeRecord record;
+	std::vector<std::uint64_t> pages;
+	std::vector<std::pair<std::uint64_t, std::uint32_t>> onPages; // (page, record), for every page it touches
+	std::vector<std::uint32_t> open; // the groups around the record, outermost first
+	for (std::size_t i{ 0 }; i < reader.size(); ++i)
+	{
+		if (!reader.getRecord(i, record))
+		{
+			return false;
+		}
+
+		// as GroupStack follows them: a record's group is parent records back, and closes every group after it
+		while (!open.empty() && (record.parent == 0 || open.back() != i - record.parent))
+		{
+			open.pop_back();
+		}
+		if (record.kind == ShapeKind::Group)
+		{
+			open.push_back(static_cast<std::uint32_t>(i));
+			continue;
+		}
+
+		// a record gives a page only past the slack, but is drawn on every page it touches, so a stroke
+		// along an edge isn't cut off; a grouped one needs its groups there too, for their transforms
+		forEachPageOf(record.bounds, pageWidth, pageHeight, kPageSlack, [&pages](std::uint64_t key) { pages.push_back(key); });
+		forEachPageOf(record.bounds, pageWidth, pageHeight, 0.0f, [&](std::uint64_t key) {
+			onPages.emplace_back(key, static_cast<std::uint32_t>(i));
+			for (std::uint32_t group : open)
+			{
+				onPages.emplace_back(key, group);
+			}
+		});
+	}
+	std::sort(onPages.begin(), onPages.end());
+	onPages.erase(std::unique(onPages.begin(), onPages.end()), onPages.end());
+
+	bool written{ true };
+	std::vector<float> points;
+	GroupStack groups;
+
+	forEachPage(pages, pageWidth, pageHeight, [&](const Bounds& page) {
+		written = backend.beginPage(page.left, page.top, pageWidth, pageHeight) && written;
+
+		// in file order, which is paint order: drawings first, then the score, each bottom to top
+		groups.clear();
+		std::uint64_t key{ getPageKey(std::llround(page.left / pageWidth), std::llround(page.top / pageHeight)) };
+		auto next{ std::lower_bound(onPages.begin(), onPages.end(), std::make_pair(key, std::uint32_t{ 0 })) };
+		for (; next != onPages.end() && next->first == key; ++next)
+		{
+			if (!reader.getRecord(next->second, record))
+			{
+				continue;
+			}
+
+			// groups draw nothing themselves, but what's in them is drawn through their transforms
+			Transform transform{ groups.enter(next->second, record) };
+			if (record.kind != ShapeKind::Group)
+			{
+				renderRecord(reader, record, transform, backend, points);
+			}
+		}
+
+		written = backend.endPage() && written;
+	});
+
+	return backend.finish() && written;
+}
@@ -0,0 +1,515 @@
+#pragma once
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <initializer_list>
+#include <string>
+#include <vector>
+#include "Geometry.h"
+#include "MappedFile.h"
+
+// Simple Score documents (.ssd). Everything is little-endian and laid out in flat, fixed-stride sections,
+// so a mapped file can be read record by record without deserializing the whole thing first:
+//
+//   FileHeader   32 bytes   "SSCD", major, minor, section count, file size
+//   SectionEntry 24 bytes   tag, stride, count, offset   (one per section)
+//   sections                8-byte aligned; readers skip tags they don't know
+//
+// A reader accepts any minor version of its major version. Newer minors may grow a stride or add
+// sections, but must not change what existing bytes mean.
+
+enum class ShapeKind : std::uint8_t
+{
+	Line,
+	Ellipse,
+	Rect,
+	Triangle,
+	Sketch,
+	Measure,
+	Symbol,
+	Text,
+	Curve, // added in 1.1
+	Group  // added in 1.3
+};
+
+enum class DocumentLayer : std::uint8_t
+{
+	Drawing, // DRAW_SHAPES
+	Score    // SCORE
+};
+
+// One shape. What values[] holds depends on the kind:
+//   Line      a.x, a.y, b.x, b.y
+//   Ellipse   x, y, width, height
+//   Rect      x, y, width, height
+//   Triangle  p1.x, p1.y, p2.x, p2.y, p3.x, p3.y
+//   Sketch    nothing; the points are in the point section
+//   Measure   x, y, length, staff height
+//   Symbol    x, y, size; text is the glyph
+//   Text      x, y, size; text is the string, font the family
+//   Curve     nothing; the start, then two controls and an end per cubic segment, are in the point section
+//   Group     nothing; the shapes in it are the records that follow, each naming it as their parent
+// A grouped shape's values and transform are in its group's coordinates, and its group's transform takes
+// them on toward the canvas; its bounds are on the canvas like everyone else's.
+struct ShapeRecord
+{
+	static constexpr std::uint8_t kFilled{ 1 };
+	static constexpr std::uint8_t kLocked{ 2 };
+
+	ShapeKind kind{ ShapeKind::Line };
+	DocumentLayer layer{ DocumentLayer::Drawing };
+	std::uint8_t flags{ 0 };
+	std::uint32_t color{ 0xFF000000 }; // ARGB
+	std::int32_t stroke{ 1 };
+	float values[8]{};
+	std::uint32_t pointFirst{ 0 };
+	std::uint32_t pointCount{ 0 };
+	std::uint32_t textOffset{ 0 }; // UTF-16 units into the string section
+	std::uint32_t textLength{ 0 };
+	std::uint32_t fontOffset{ 0 };
+	std::uint32_t fontLength{ 0 };
+	Bounds bounds{ Bounds::empty() }; // lets a viewer cull straight from the file
+	Transform transform; // added in 1.2; takes the values or points onto the canvas, for shapes that were scaled or rotated
+	std::uint32_t parent{ 0 }; // added in 1.3; how many records back the shape's group is, or 0 outside any group
+
+	bool isFilled() const { return (flags & kFilled) != 0; }
+	bool isLocked() const { return (flags & kLocked) != 0; }
+};
+
+// Byte layout shared by the writer and the reader
+class DocumentFormat
+{
+protected:
+	static constexpr char kMagic[4]{ 'S', 'S', 'C', 'D' };
+	static constexpr std::uint16_t kMajorVersion{ 1 };
+	// 1.1 adds ShapeKind::Curve, which 1.0 readers turn away. 1.2 grows the record by a transform, which
+	// older readers skip, drawing scaled or rotated shapes as they were before. 1.3 adds ShapeKind::Group and
+	// the parent field in bytes every earlier version wrote as zero.
+	static constexpr std::uint16_t kMinorVersion{ 3 };
+
+	static constexpr std::size_t kHeaderSize{ 32 };
+	static constexpr std::size_t kSectionEntrySize{ 24 };
+	static constexpr std::size_t kRecordSize{ 112 };
+	static constexpr std::size_t kRecordSize10{ 88 }; // before the transform
+	static constexpr std::size_t kPointSize{ 8 };
+	static constexpr std::size_t kCharSize{ 2 };
+
+	// far beyond anything the app draws; a coordinate, size or transform entry past this, or a stroke past
+	// kMaxStroke, can only be damage, and would otherwise reach the spatial index and the rasterizer
+	static constexpr float kMaxCoordinate{ 1.0e9f };
+	static constexpr std::int32_t kMaxStroke{ 100000 };
+
+	static bool isCoordinate(float value) { return std::isfinite(value) && std::fabs(value) <= kMaxCoordinate; }
+
+	// four ASCII characters, read as a little-endian word
+	static constexpr std::uint32_t kRecordsTag{ 0x53434552 }; // "RECS"
+	static constexpr std::uint32_t kPointsTag{ 0x53544E50 };  // "PNTS"
+	static constexpr std::uint32_t kStringsTag{ 0x53525453 }; // "STRS"
+
+	static void put16(std::uint8_t* out, std::uint16_t value)
+	{
+		out[0] = static_cast<std::uint8_t>(value);
+		out[1] = static_cast<std::uint8_t>(value >> 8);
+	}
+
+	static void put32(std::uint8_t* out, std::uint32_t value)
+	{
+		for (int i{ 0 }; i < 4; ++i)
+		{
+			out[i] = static_cast<std::uint8_t>(value >> (8 * i));
+		}
+	}
+
+	static void put64(std::uint8_t* out, std::uint64_t value)
+	{
+		for (int i{ 0 }; i < 8; ++i)
+		{
+			out[i] = static_cast<std::uint8_t>(value >> (8 * i));
+		}
+	}
+
+	static void putFloat(std::uint8_t* out, float value)
+	{
+		std::uint32_t bits;
+		std::memcpy(&bits, &value, sizeof(bits));
+		put32(out, bits);
+	}
+
+	static std::uint16_t get16(const std::uint8_t* in)
+	{
+		return static_cast<std::uint16_t>(in[0] | in[1] << 8);
+	}
+
+	static std::uint32_t get32(const std::uint8_t* in)
+	{
+		return static_cast<std::uint32_t>(in[0]) | static_cast<std::uint32_t>(in[1]) << 8 | static_cast<std::uint32_t>(in[2]) << 16 | static_cast<std::uint32_t>(in[3]) << 24;
+	}
+
+	static std::uint64_t get64(const std::uint8_t* in)
+	{
+		return static_cast<std::uint64_t>(get32(in)) | static_cast<std::uint64_t>(get32(in + 4)) << 32;
+	}
+
+	static float getFloat(const std::uint8_t* in)
+	{
+		std::uint32_t bits{ get32(in) };
+		float value;
+		std::memcpy(&value, &bits, sizeof(value));
+		return value;
+	}
+
+	static std::size_t align8(std::size_t offset) { return (offset + 7) & ~static_cast<std::size_t>(7); }
+};
+
+// Collects shapes and writes them out in one pass. Shapes are added through ShapeStore::write.
+class DocumentWriter : private DocumentFormat
+{
+public:
+	void add(const ShapeRecord& record) { m_records.push_back(record); }
+
+	std::uint32_t getPointCount() const { return static_cast<std::uint32_t>(m_points.size() / 2); }
+
+	void addPoint(float x, float y)
+	{
+		m_points.push_back(x);
+		m_points.push_back(y);
+	}
+
+	// stores the string as UTF-16 and sets offset/length to where it landed
+	void addString(const std::wstring& text, std::uint32_t& offset, std::uint32_t& length)
+	{
+		offset = static_cast<std::uint32_t>(m_chars.size());
+		for (wchar_t ch : text)
+		{
+			std::uint32_t cp{ static_cast<std::uint32_t>(ch) };
+			if (cp > 0xFFFF) // only reachable where wchar_t is UTF-32
+			{
+				cp -= 0x10000;
+				m_chars.push_back(static_cast<std::uint16_t>(0xD800 + (cp >> 10)));
+				m_chars.push_back(static_cast<std::uint16_t>(0xDC00 + (cp & 0x3FF)));
+			}
+			else
+			{
+				m_chars.push_back(static_cast<std::uint16_t>(cp));
+			}
+		}
+		length = static_cast<std::uint32_t>(m_chars.size()) - offset;
+	}
+
+	std::size_t size() const { return m_records.size(); }
+
+	void clear()
+	{
+		m_records.clear();
+		m_points.clear();
+		m_chars.clear();
+	}
+
+	bool save(const std::filesystem::path& path) const
+	{
+		constexpr std::uint32_t kSectionCount{ 3 };
+
+		std::size_t recordsOffset{ align8(kHeaderSize + kSectionCount * kSectionEntrySize) };
+		std::size_t pointsOffset{ align8(recordsOffset + m_records.size() * kRecordSize) };
+		std::size_t stringsOffset{ align8(pointsOffset + m_points.size() / 2 * kPointSize) };
+		std::size_t fileSize{ align8(stringsOffset + m_chars.size() * kCharSize) };
+
+		std::ofstream out(path, std::ios::binary | std::ios::trunc);
+		if (!out)
+		{
+			return false;
+		}
+
+		std::uint8_t head[kHeaderSize + kSectionCount * kSectionEntrySize]{};
+		std::memcpy(head, kMagic, 4);
+		put16(head + 4, kMajorVersion);
+		put16(head + 6, kMinorVersion);
+		put32(head + 8, kSectionCount);
+		put64(head + 16, fileSize);
+
+		std::uint8_t* entry{ head + kHeaderSize };
+		writeEntry(entry, kRecordsTag, kRecordSize, m_records.size(), recordsOffset);
+		writeEntry(entry + kSectionEntrySize, kPointsTag, kPointSize, m_points.size() / 2, pointsOffset);
+		writeEntry(entry + 2 * kSectionEntrySize, kStringsTag, kCharSize, m_chars.size(), stringsOffset);
+
+		out.write(reinterpret_cast<const char*>(head), sizeof(head));
+		pad(out, recordsOffset - sizeof(head));
+
+		std::uint8_t record[kRecordSize];
+		for (const auto& shape : m_records)
+		{
+			encode(shape, record);
+			out.write(reinterpret_cast<const char*>(record), kRecordSize);
+		}
+		pad(out, pointsOffset - (recordsOffset + m_records.size() * kRecordSize));
+
+		for (float value : m_points)
+		{
+			std::uint8_t bytes[4];
+			putFloat(bytes, value);
+			out.write(reinterpret_cast<const char*>(bytes), 4);
+		}
+		pad(out, stringsOffset - (pointsOffset + m_points.size() / 2 * kPointSize));
+
+		for (std::uint16_t ch : m_chars)
+		{
+			std::uint8_t bytes[2];
+			put16(bytes, ch);
+			out.write(reinterpret_cast<const char*>(bytes), 2);
+		}
+		pad(out, fileSize - (stringsOffset + m_chars.size() * kCharSize));
+
+		return static_cast<bool>(out);
+	}
+
+private:
+	std::vector<ShapeRecord> m_records;
+	std::vector<float> m_points; // x, y pairs
+	std::vector<std::uint16_t> m_chars;
+
+	static void writeEntry(std::uint8_t* out, std::uint32_t tag, std::size_t stride, std::size_t count, std::size_t offset)
+	{
+		put32(out, tag);
+		put32(out + 4, static_cast<std::uint32_t>(stride));
+		put64(out + 8, count);
+		put64(out + 16, offset);
+	}
+
+	static void pad(std::ofstream& out, std::size_t count)
+	{
+		static const char zeros[8]{};
+		out.write(zeros, static_cast<std::streamsize>(count));
+	}
+
+	static void encode(const ShapeRecord& shape, std::uint8_t* out)
+	{
+		std::memset(out, 0, kRecordSize);
+		out[0] = static_cast<std::uint8_t>(shape.kind);
+		out[1] = static_cast<std::uint8_t>(shape.layer);
+		out[2] = shape.flags;
+		put32(out + 4, shape.color);
+		put32(out + 8, static_cast<std::uint32_t>(shape.stroke));
+		for (int i{ 0 }; i < 8; ++i)
+		{
+			putFloat(out + 12 + 4 * i, shape.values[i]);
+		}
+		put32(out + 44, shape.pointFirst);
+		put32(out + 48, shape.pointCount);
+		put32(out + 52, shape.textOffset);
+		put32(out + 56, shape.textLength);
+		put32(out + 60, shape.fontOffset);
+		put32(out + 64, shape.fontLength);
+		putFloat(out + 68, shape.bounds.left);
+		putFloat(out + 72, shape.bounds.top);
+		putFloat(out + 76, shape.bounds.right);
+		putFloat(out + 80, shape.bounds.bottom);
+		put32(out + 84, shape.parent);
+		putFloat(out + 88, shape.transform.a);
+		putFloat(out + 92, shape.transform.b);
+		putFloat(out + 96, shape.transform.c);
+		putFloat(out + 100, shape.transform.d);
+		putFloat(out + 104, shape.transform.tx);
+		putFloat(out + 108, shape.transform.ty);
+	}
+};
+
+// Maps a document and reads it in place. open() only checks the header and section table, so opening
+// costs the same however many shapes there are; each record is range-checked as it is read.
+class DocumentReader : private DocumentFormat
+{
+public:
+	bool open(const std::filesystem::path& path)
+	{
+		close();
+
+		if (!m_file.open(path) || m_file.size() < kHeaderSize)
+		{
+			close();
+			return false;
+		}
+
+		const std::uint8_t* data{ m_file.data() };
+		std::uint32_t sectionCount{ get32(data + 8) };
+
+		if (std::memcmp(data, kMagic, 4) != 0 || get16(data + 4) != kMajorVersion || get64(data + 16) != m_file.size()
+			|| sectionCount > (m_file.size() - kHeaderSize) / kSectionEntrySize)
+		{
+			close();
+			return false;
+		}
+
+		for (std::uint32_t i{ 0 }; i < sectionCount; ++i)
+		{
+			const std::uint8_t* entry{ data + kHeaderSize + i * kSectionEntrySize };
+			Section section{ data, get32(entry + 4), get64(entry + 8) };
+			std::uint64_t offset{ get64(entry + 16) };
+
+			// the stride and count come from the file, so check the product without overflowing
+			if (offset > m_file.size() || (section.stride != 0 && section.count > (m_file.size() - offset) / section.stride))
+			{
+				close();
+				return false;
+			}
+			section.data = data + offset;
+
+			switch (get32(entry))
+			{
+			case kRecordsTag:
+				m_records = section;
+				break;
+			case kPointsTag:
+				m_points = section;
+				break;
+			case kStringsTag:
+				m_strings = section;
+				break;
+			default:
+				break; // from a newer minor version
+			}
+		}
+
+		if (m_records.stride < kRecordSize10 || m_points.stride < kPointSize || m_strings.stride < kCharSize)
+		{
+			close();
+			return false;
+		}
+
+		return true;
+	}
+
+	void close()
+	{
+		m_file.close();
+		m_records = {};
+		m_points = {};
+		m_strings = {};
+	}
+
+	bool isOpen() const { return m_file.isOpen(); }
+
+	std::size_t size() const { return static_cast<std::size_t>(m_records.count); }
+
+	// false if the record points outside the point or string sections, or to a group after it, or if any of
+	// its numbers, or its points', are out of range
+	bool getRecord(std::size_t index, ShapeRecord& shape) const
+	{
+		if (index >= size())
+		{
+			return false;
+		}
+
+		const std::uint8_t* in{ m_records.data + index * m_records.stride };
+		shape.kind = static_cast<ShapeKind>(in[0]);
+		shape.layer = static_cast<DocumentLayer>(in[1]);
+		shape.flags = in[2];
+		shape.color = get32(in + 4);
+		shape.stroke = static_cast<std::int32_t>(get32(in + 8));
+		for (int i{ 0 }; i < 8; ++i)
+		{
+			shape.values[i] = getFloat(in + 12 + 4 * i);
+		}
+		shape.pointFirst = get32(in + 44);
+		shape.pointCount = get32(in + 48);
+		shape.textOffset = get32(in + 52);
+		shape.textLength = get32(in + 56);
+		shape.fontOffset = get32(in + 60);
+		shape.fontLength = get32(in + 64);
+		shape.bounds = Bounds{ getFloat(in + 68), getFloat(in + 72), getFloat(in + 76), getFloat(in + 80) };
+		shape.parent = get32(in + 84);
+		shape.transform = m_records.stride >= kRecordSize
+			? Transform{ getFloat(in + 88), getFloat(in + 92), getFloat(in + 96), getFloat(in + 100), getFloat(in + 104), getFloat(in + 108) }
+			: Transform{};
+
+		return shape.kind <= ShapeKind::Group && shape.layer <= DocumentLayer::Score && shape.parent <= index
+			&& inRange(shape.pointFirst, shape.pointCount, m_points.count)
+			&& inRange(shape.textOffset, shape.textLength, m_strings.count)
+			&& inRange(shape.fontOffset, shape.fontLength, m_strings.count)
+			&& hasValidNumbers(shape);
+	}
+
+	float getPointX(std::size_t index) const { return getFloat(m_points.data + index * m_points.stride); }
+	float getPointY(std::size_t index) const { return getFloat(m_points.data + index * m_points.stride + 4); }
+
+	std::wstring getString(std::uint32_t offset, std::uint32_t length) const
+	{
+		std::wstring text;
+		text.reserve(length);
+		for (std::uint32_t i{ 0 }; i < length; ++i)
+		{
+			std::uint32_t unit{ get16(m_strings.data + (static_cast<std::size_t>(offset) + i) * m_strings.stride) };
+			if constexpr (sizeof(wchar_t) == 4)
+			{
+				// put surrogate pairs back together where wchar_t is UTF-32
+				if (unit >= 0xD800 && unit < 0xDC00 && i + 1 < length)
+				{
+					std::uint32_t low{ get16(m_strings.data + (static_cast<std::size_t>(offset) + i + 1) * m_strings.stride) };
+					if (low >= 0xDC00 && low < 0xE000)
+					{
+						unit = 0x10000 + ((unit - 0xD800) << 10) + (low - 0xDC00);
+						++i;
+					}
+				}
+			}
+			text.push_back(static_cast<wchar_t>(unit));
+		}
+		return text;
+	}
+
+private:
+	struct Section
+	{
+		const std::uint8_t* data{ nullptr };
+		std::uint32_t stride{ 0 };
+		std::uint64_t count{ 0 };
+	};
+
+	MappedFile m_file;
+	Section m_records;
+	Section m_points;
+	Section m_strings;
+
+	static bool inRange(std::uint32_t first, std::uint32_t count, std::uint64_t total)
+	{
+		return first <= total && count <= total - first;
+	}
+
+	// the record's points must already be in range
+	bool hasValidNumbers(const ShapeRecord& shape) const
+	{
+		if (shape.stroke < 0 || shape.stroke > kMaxStroke)
+		{
+			return false;
+		}
+
+		for (float value : shape.values)
+		{
+			if (!isCoordinate(value))
+			{
+				return false;
+			}
+		}
+
+		const Bounds& b{ shape.bounds };
+		const Transform& t{ shape.transform };
+		for (float value : { b.left, b.top, b.right, b.bottom, t.a, t.b, t.c, t.d, t.tx, t.ty })
+		{
+			if (!isCoordinate(value))
+			{
+				return false;
+			}
+		}
+
+		for (std::uint32_t i{ 0 }; i < shape.pointCount; ++i)
+		{
+			if (!isCoordinate(getPointX(shape.pointFirst + i)) || !isCoordinate(getPointY(shape.pointFirst + i)))
+			{
+				return false;
+			}
+		}
+		return true;
+	}
+};
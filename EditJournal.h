@@ -0,0 +1,468 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <utility>
+#include <vector>
+#include "ShapeStore.h"
+#include "StyleTable.h"
+
+// What undo and redo tell the owner of a store as they change it, so its index and damage keep up
+class EditListener
+{
+public:
+	virtual ~EditListener() = default;
+
+	// the shape is back in the store; order is the snapshot's
+	virtual void shapeRestored(ShapeHandle shape, std::uint64_t order) = 0;
+
+	// the shapes are about to leave the store
+	virtual void shapesRemoving(const std::vector<ShapeHandle>& shapes) = 0;
+
+	// the shape moved, was restyled or resized
+	virtual void shapeChanged(ShapeHandle shape) = 0;
+
+	// the two shapes traded places in z order
+	virtual void shapesSwapped(ShapeHandle a, ShapeHandle b) = 0;
+
+	// the shapes were put into the group, which took the topmost one's place in z order
+	virtual void shapesGrouped(ShapeHandle group, const std::vector<ShapeHandle>& children) = 0;
+
+	// the group was dissolved and its children, bottom first, took its place
+	virtual void shapesUngrouped(ShapeHandle group, const std::vector<ShapeHandle>& children) = 0;
+};
+
+enum class EditKind : std::uint8_t
+{
+	Insert,
+	Remove,
+	Move,
+	Restyle,
+	Resize,
+	Reorder,
+	Transform,
+	Group,
+	Ungroup
+};
+
+// Undo and redo history for one ShapeStore. Each edit keeps only what changed: a move is the shapes and
+// one offset, a restyle the shapes' style ids before and after, and only inserts and removes copy whole
+// shapes. Undo and redo touch just the shapes in the edit. Once the journal holds more than its memory cap,
+// the oldest edits are forgotten, but never the newest, so an edit too big for the cap on its own can still
+// be undone; it pushes out everything before it instead.
+//
+// Edits are recorded after they're made, except removals, which are snapshotted before. Handles stay
+// valid across undo and redo because removed shapes go back under their old handles.
+class EditJournal
+{
+public:
+	static constexpr std::size_t kDefaultMemoryCap{ 16u << 20 };
+
+	explicit EditJournal(StyleTable& styles = shapeStyles(), std::size_t memoryCap = kDefaultMemoryCap) : m_styles(&styles), m_memoryCap(memoryCap) {}
+
+	EditJournal(const EditJournal&) = delete;
+	EditJournal& operator=(const EditJournal&) = delete;
+
+	~EditJournal() { clear(); }
+
+	// bytes of history to keep; lowering it forgets the oldest edits straight away, all but the newest
+	void setMemoryCap(std::size_t bytes)
+	{
+		m_memoryCap = bytes;
+		trim();
+	}
+	std::size_t getMemoryCap() const { return m_memoryCap; }
+	std::size_t getMemoryUsed() const { return m_memoryUsed; }
+
+	// edits remembered, undone ones included
+	std::size_t size() const { return m_edits.size(); }
+
+	// how many edits the memory cap has made the journal forget since the last call, so the user can be told
+	std::size_t takeForgotten() { return std::exchange(m_forgotten, 0); }
+
+	bool canUndo() const { return m_applied > 0; }
+	bool canRedo() const { return m_applied < m_edits.size(); }
+
+	void clear()
+	{
+		while (!m_edits.empty())
+		{
+			dropBack();
+		}
+		m_applied = 0;
+		m_sealed = true;
+	}
+
+	// stops the next move or restyle from joining the last one, e.g. when the selection changes or a slider is let go
+	void seal() { m_sealed = true; }
+
+	// shapes that were just added, each snapshotted with ShapeStore::snapshot
+	void recordInsert(std::vector<ShapeSnapshot> shapes)
+	{
+		Edit edit{ EditKind::Insert };
+		edit.snapshots = std::move(shapes);
+		sortByIndex(edit.snapshots);
+		push(std::move(edit));
+	}
+
+	// shapes about to be removed, each snapshotted with ShapeStore::snapshot before any of them goes
+	void recordRemove(std::vector<ShapeSnapshot> shapes)
+	{
+		Edit edit{ EditKind::Remove };
+		edit.snapshots = std::move(shapes);
+		sortByIndex(edit.snapshots);
+		push(std::move(edit));
+	}
+
+	// Shapes that were all translated by (dx, dy). With join, a move of the same shapes straight after
+	// another joined one adds to it instead, so holding an arrow key down is one edit.
+	void recordMove(std::vector<ShapeHandle> shapes, float dx, float dy, bool join = false)
+	{
+		if (join && canJoin(EditKind::Move, shapes))
+		{
+			Edit& last{ m_edits.back() };
+			last.dx += dx;
+			last.dy += dy;
+			return;
+		}
+
+		Edit edit{ EditKind::Move };
+		edit.shapes = std::move(shapes);
+		edit.dx = dx;
+		edit.dy = dy;
+		edit.joinable = join;
+		push(std::move(edit));
+	}
+
+	// Shapes whose style ids changed from before[i] to after[i]. The journal takes its own references.
+	// With join, a restyle of the same shapes straight after another joined one keeps the first before
+	// and the latest after, so dragging a slider is one edit.
+	void recordRestyle(std::vector<ShapeHandle> shapes, const std::vector<StyleId>& before, const std::vector<StyleId>& after, bool join = false)
+	{
+		if (join && canJoin(EditKind::Restyle, shapes))
+		{
+			Edit& last{ m_edits.back() };
+			for (std::size_t i{ 0 }; i < after.size(); ++i)
+			{
+				m_styles->retain(after[i]);
+				m_styles->release(last.styles[2 * i + 1]);
+				last.styles[2 * i + 1] = after[i];
+			}
+			return;
+		}
+
+		Edit edit{ EditKind::Restyle };
+		edit.shapes = std::move(shapes);
+		edit.styles.reserve(2 * before.size());
+		for (std::size_t i{ 0 }; i < before.size(); ++i)
+		{
+			m_styles->retain(before[i]);
+			m_styles->retain(after[i]);
+			edit.styles.push_back(before[i]);
+			edit.styles.push_back(after[i]);
+		}
+		edit.joinable = join;
+		push(std::move(edit));
+	}
+
+	// shapes whose ShapeStore width went from before[i] to after[i], e.g. resized measures and symbols; join as for restyles
+	void recordResize(std::vector<ShapeHandle> shapes, const std::vector<int>& before, const std::vector<int>& after, bool join = false)
+	{
+		if (join && canJoin(EditKind::Resize, shapes))
+		{
+			Edit& last{ m_edits.back() };
+			for (std::size_t i{ 0 }; i < after.size(); ++i)
+			{
+				last.widths[2 * i + 1] = after[i];
+			}
+			return;
+		}
+
+		Edit edit{ EditKind::Resize };
+		edit.shapes = std::move(shapes);
+		edit.widths.reserve(2 * before.size());
+		for (std::size_t i{ 0 }; i < before.size(); ++i)
+		{
+			edit.widths.push_back(before[i]);
+			edit.widths.push_back(after[i]);
+		}
+		edit.joinable = join;
+		push(std::move(edit));
+	}
+
+	// shapes whose transform went from before[i] to after[i], e.g. scaled or rotated ones; join as for restyles
+	void recordTransform(std::vector<ShapeHandle> shapes, const std::vector<Transform>& before, const std::vector<Transform>& after, bool join = false)
+	{
+		if (join && canJoin(EditKind::Transform, shapes))
+		{
+			Edit& last{ m_edits.back() };
+			for (std::size_t i{ 0 }; i < after.size(); ++i)
+			{
+				last.transforms[2 * i + 1] = after[i];
+			}
+			return;
+		}
+
+		Edit edit{ EditKind::Transform };
+		edit.shapes = std::move(shapes);
+		edit.transforms.reserve(2 * before.size());
+		for (std::size_t i{ 0 }; i < before.size(); ++i)
+		{
+			edit.transforms.push_back(before[i]);
+			edit.transforms.push_back(after[i]);
+		}
+		edit.joinable = join;
+		push(std::move(edit));
+	}
+
+	// two shapes that swapped places in z order
+	void recordReorder(ShapeHandle a, ShapeHandle b)
+	{
+		Edit edit{ EditKind::Reorder };
+		edit.shapes = { a, b };
+		push(std::move(edit));
+	}
+
+	// a group just made with ShapeStore::group, snapshotted, and its children's transforms inside it
+	void recordGroup(ShapeSnapshot group, std::vector<Transform> childTransforms)
+	{
+		Edit edit{ EditKind::Group };
+		edit.snapshots.push_back(std::move(group));
+		edit.transforms = std::move(childTransforms);
+		push(std::move(edit));
+	}
+
+	// groups about to be dissolved with ShapeStore::ungroup, snapshotted before, and each one's children's
+	// transforms inside it, one group after another
+	void recordUngroup(std::vector<ShapeSnapshot> groups, std::vector<Transform> childTransforms)
+	{
+		Edit edit{ EditKind::Ungroup };
+		edit.snapshots = std::move(groups);
+		edit.transforms = std::move(childTransforms);
+		push(std::move(edit));
+	}
+
+	// reverts the last applied edit; false when there's nothing to undo
+	bool undo(ShapeStore& store, EditListener& listener)
+	{
+		if (!canUndo())
+		{
+			return false;
+		}
+
+		m_sealed = true;
+		apply(m_edits[--m_applied], store, listener, false);
+		return true;
+	}
+
+	// reapplies the last undone edit; false when there's nothing to redo
+	bool redo(ShapeStore& store, EditListener& listener)
+	{
+		if (!canRedo())
+		{
+			return false;
+		}
+
+		m_sealed = true;
+		apply(m_edits[m_applied++], store, listener, true);
+		return true;
+	}
+
+private:
+	struct Edit
+	{
+		explicit Edit(EditKind k) : kind(k) {}
+
+		EditKind kind;
+		bool joinable{ false };
+		std::vector<ShapeHandle> shapes;
+		float dx{ 0.0f }; // Move
+		float dy{ 0.0f };
+		std::vector<StyleId> styles; // Restyle: before and after for each shape, interleaved
+		std::vector<int> widths; // Resize: likewise
+		std::vector<Transform> transforms; // Transform: likewise; Group and Ungroup: the children's inside their group
+		std::vector<ShapeSnapshot> snapshots; // Insert and Remove, bottom first; Group and Ungroup, the groups
+		std::size_t bytes{ 0 };
+	};
+
+	StyleTable* m_styles;
+	std::deque<Edit> m_edits; // oldest first
+	std::size_t m_applied{ 0 }; // edits before this one are done, the rest undone
+	std::size_t m_memoryCap;
+	std::size_t m_memoryUsed{ 0 };
+	std::size_t m_forgotten{ 0 };
+	bool m_sealed{ true };
+
+	static void sortByIndex(std::vector<ShapeSnapshot>& snapshots)
+	{
+		std::sort(snapshots.begin(), snapshots.end(), [](const ShapeSnapshot& a, const ShapeSnapshot& b) { return a.index < b.index; });
+	}
+
+	static std::size_t measure(const Edit& edit)
+	{
+		std::size_t bytes{ sizeof(Edit) + edit.shapes.capacity() * sizeof(ShapeHandle) + edit.styles.capacity() * sizeof(StyleId) + edit.widths.capacity() * sizeof(int)
+			+ edit.transforms.capacity() * sizeof(Transform) };
+		for (const ShapeSnapshot& snapshot : edit.snapshots)
+		{
+			bytes += sizeof(ShapeSnapshot) + snapshot.points.capacity() * sizeof(float) + (snapshot.text.capacity() + snapshot.font.capacity()) * sizeof(wchar_t)
+				+ snapshot.children.capacity() * sizeof(ShapeHandle);
+		}
+		return bytes;
+	}
+
+	bool canJoin(EditKind kind, const std::vector<ShapeHandle>& shapes) const
+	{
+		if (m_sealed || m_applied != m_edits.size() || m_edits.empty())
+		{
+			return false;
+		}
+
+		const Edit& last{ m_edits.back() };
+		return last.kind == kind && last.joinable && last.shapes == shapes;
+	}
+
+	void push(Edit&& edit)
+	{
+		// a new edit ends whatever could have been redone
+		while (m_edits.size() > m_applied)
+		{
+			dropBack();
+		}
+
+		edit.bytes = measure(edit);
+		m_memoryUsed += edit.bytes;
+		m_edits.push_back(std::move(edit));
+		++m_applied;
+		m_sealed = false;
+
+		trim();
+	}
+
+	void trim()
+	{
+		while (m_memoryUsed > m_memoryCap && m_edits.size() > 1)
+		{
+			release(m_edits.front());
+			m_edits.pop_front();
+			++m_forgotten;
+			if (m_applied > 0)
+			{
+				--m_applied;
+			}
+		}
+	}
+
+	void dropBack()
+	{
+		release(m_edits.back());
+		m_edits.pop_back();
+	}
+
+	// gives back the style references an edit holds
+	void release(const Edit& edit)
+	{
+		for (StyleId style : edit.styles)
+		{
+			m_styles->release(style);
+		}
+		for (const ShapeSnapshot& snapshot : edit.snapshots)
+		{
+			m_styles->release(snapshot.style);
+		}
+		m_memoryUsed -= edit.bytes;
+	}
+
+	static void apply(const Edit& edit, ShapeStore& store, EditListener& listener, bool forward)
+	{
+		switch (edit.kind)
+		{
+		case EditKind::Insert:
+		case EditKind::Remove:
+			if ((edit.kind == EditKind::Insert) == forward)
+			{
+				store.restore(edit.snapshots.data(), edit.snapshots.size());
+				for (const ShapeSnapshot& snapshot : edit.snapshots)
+				{
+					if (store.contains(snapshot.handle))
+					{
+						listener.shapeRestored(snapshot.handle, snapshot.order);
+					}
+				}
+			}
+			else
+			{
+				std::vector<ShapeHandle> shapes;
+				shapes.reserve(edit.snapshots.size());
+				for (const ShapeSnapshot& snapshot : edit.snapshots)
+				{
+					shapes.push_back(snapshot.handle);
+				}
+				listener.shapesRemoving(shapes);
+				store.remove(shapes);
+			}
+			break;
+		case EditKind::Move:
+		{
+			float sign{ forward ? 1.0f : -1.0f };
+			for (ShapeHandle shape : edit.shapes)
+			{
+				store.translate(shape, sign * edit.dx, sign * edit.dy);
+				listener.shapeChanged(shape);
+			}
+			break;
+		}
+		case EditKind::Restyle:
+			for (std::size_t i{ 0 }; i < edit.shapes.size(); ++i)
+			{
+				store.setStyle(edit.shapes[i], edit.styles[2 * i + (forward ? 1 : 0)]);
+				listener.shapeChanged(edit.shapes[i]);
+			}
+			break;
+		case EditKind::Resize:
+			for (std::size_t i{ 0 }; i < edit.shapes.size(); ++i)
+			{
+				store.setWidth(edit.shapes[i], edit.widths[2 * i + (forward ? 1 : 0)]);
+				listener.shapeChanged(edit.shapes[i]);
+			}
+			break;
+		case EditKind::Transform:
+			for (std::size_t i{ 0 }; i < edit.shapes.size(); ++i)
+			{
+				store.setTransform(edit.shapes[i], edit.transforms[2 * i + (forward ? 1 : 0)]);
+				listener.shapeChanged(edit.shapes[i]);
+			}
+			break;
+		case EditKind::Reorder:
+			store.swapOrder(edit.shapes[0], edit.shapes[1]);
+			listener.shapesSwapped(edit.shapes[0], edit.shapes[1]);
+			break;
+		case EditKind::Group:
+		case EditKind::Ungroup:
+			if ((edit.kind == EditKind::Group) == forward)
+			{
+				// the groups go back in the reverse of the order they were dissolved
+				std::size_t first{ edit.transforms.size() };
+				for (std::size_t i{ edit.snapshots.size() }; i-- > 0;)
+				{
+					const ShapeSnapshot& group{ edit.snapshots[i] };
+					first -= group.children.size();
+					if (store.regroup(group, edit.transforms.data() + first))
+					{
+						listener.shapesGrouped(group.handle, store.getChildren(group.handle));
+					}
+				}
+			}
+			else
+			{
+				for (const ShapeSnapshot& group : edit.snapshots)
+				{
+					std::vector<ShapeHandle> children{ store.ungroup(group.handle) };
+					listener.shapesUngrouped(group.handle, children);
+				}
+			}
+			break;
+		}
+	}
+};
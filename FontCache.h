@@ -0,0 +1,125 @@
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <list>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <utility>
+
+// Shared fonts keyed by (family, pixel size, style). Callers hold the shared_ptr while they draw, so
+// evicting the least recently used entry never pulls a font out from under a draw in progress. The app
+// caches GDI+ fonts; the font type is a parameter so the cache also builds, and is measured, without GDI+.
+template <typename Font>
+class BasicFontCache
+{
+public:
+	// builds the font for a key on a miss
+	using Factory = std::function<std::shared_ptr<Font>(const std::wstring& family, int pixelSize, int style)>;
+
+	explicit BasicFontCache(Factory make, std::size_t capacity = 64) : m_make(std::move(make)), m_capacity(capacity) {}
+
+	// style 0 is regular, as FontStyleRegular is
+	std::shared_ptr<Font> get(const std::wstring& family, int pixelSize, int style = 0)
+	{
+		Key key{ family, pixelSize, style };
+
+		auto found = m_lookup.find(key);
+		if (found != m_lookup.end())
+		{
+			++m_hits;
+			m_entries.splice(m_entries.begin(), m_entries, found->second); // mark most recently used
+			return found->second->second;
+		}
+
+		++m_misses;
+
+		auto font = m_make(family, pixelSize, style);
+		m_entries.emplace_front(key, font);
+		m_lookup.emplace(std::move(key), m_entries.begin());
+
+		if (m_entries.size() > m_capacity)
+		{
+			m_lookup.erase(m_entries.back().first);
+			m_entries.pop_back();
+			++m_evictions;
+		}
+
+		return font;
+	}
+
+	void setCapacity(std::size_t capacity)
+	{
+		m_capacity = capacity;
+		while (m_entries.size() > m_capacity)
+		{
+			m_lookup.erase(m_entries.back().first);
+			m_entries.pop_back();
+			++m_evictions;
+		}
+	}
+
+	std::size_t getHits() const { return m_hits; }
+	std::size_t getMisses() const { return m_misses; }
+	std::size_t getEvictions() const { return m_evictions; }
+	std::size_t size() const { return m_entries.size(); }
+
+	// must run before GdiplusShutdown
+	void clear()
+	{
+		m_lookup.clear();
+		m_entries.clear();
+	}
+
+private:
+	struct Key
+	{
+		std::wstring family;
+		int size;
+		int style;
+
+		bool operator==(const Key& other) const { return size == other.size && style == other.style && family == other.family; }
+	};
+
+	struct KeyHash
+	{
+		std::size_t operator()(const Key& key) const
+		{
+			std::size_t h{ std::hash<std::wstring>{}(key.family) };
+			h ^= std::hash<int>{}(key.size) + 0x9e3779b9 + (h << 6) + (h >> 2);
+			h ^= std::hash<int>{}(key.style) + 0x9e3779b9 + (h << 6) + (h >> 2);
+			return h;
+		}
+	};
+
+	using Entry = std::pair<Key, std::shared_ptr<Font>>;
+
+	Factory m_make;
+	std::size_t m_capacity;
+	std::list<Entry> m_entries; // most recently used first
+	std::unordered_map<Key, typename std::list<Entry>::iterator, KeyHash> m_lookup;
+
+	std::size_t m_hits{ 0 };
+	std::size_t m_misses{ 0 };
+	std::size_t m_evictions{ 0 };
+};
+
+#ifdef _WIN32
+
+#include <gdiplus.h>
+
+using namespace Gdiplus;
+
+using FontCache = BasicFontCache<Font>;
+
+// the one cache the GDI+ backend draws text from
+inline FontCache& fontCache()
+{
+	static FontCache cache{ [](const std::wstring& family, int pixelSize, int style) {
+		return std::make_shared<Font>(family.c_str(), static_cast<REAL>(pixelSize), style, UnitPixel);
+	} };
+	return cache;
+}
+
+#endif
@@ -0,0 +1,84 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+
+// Decides when changes get painted. Input applies to the model as it arrives, then asks for a frame; a
+// frame goes out at once if a refresh has passed since the last one, and otherwise one frame is scheduled
+// for the next refresh, which shows every change asked for in the meantime. A mouse polling at 1000 Hz
+// then costs as many paints as the display can show, not one per move.
+class FramePacer
+{
+public:
+	// what request says to do
+	static constexpr std::int64_t kPresentNow{ 0 };
+	static constexpr std::int64_t kAlreadyScheduled{ -1 };
+
+	explicit FramePacer(double refreshRate = 60.0) { setRefreshRate(refreshRate); }
+
+	void setRefreshRate(double refreshRate)
+	{
+		if (refreshRate > 0.0)
+		{
+			m_interval = static_cast<std::uint64_t>(1e9 / refreshRate);
+		}
+	}
+
+	std::uint64_t getInterval() const { return m_interval; }
+
+	// nanoseconds on a steady clock
+	static std::uint64_t now()
+	{
+		return static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count());
+	}
+
+	// asks for a frame at time: kPresentNow to present it now, kAlreadyScheduled if the scheduled frame
+	// will show it, or else the nanoseconds to wait before presenting, after which the caller calls fire
+	std::int64_t request(std::uint64_t time)
+	{
+		++m_requests;
+		if (m_scheduled)
+		{
+			return kAlreadyScheduled;
+		}
+
+		std::uint64_t elapsed{ time - m_lastFrame };
+		if (m_frames == 0 || elapsed >= m_interval)
+		{
+			present(time);
+			return kPresentNow;
+		}
+
+		m_scheduled = true;
+		return static_cast<std::int64_t>(m_interval - elapsed);
+	}
+
+	bool isScheduled() const { return m_scheduled; }
+
+	// the scheduled frame is presented at time
+	void fire(std::uint64_t time)
+	{
+		if (m_scheduled)
+		{
+			m_scheduled = false;
+			present(time);
+		}
+	}
+
+	// how many frames were asked for, and how many were presented
+	std::uint64_t getRequests() const { return m_requests; }
+	std::uint64_t getFrames() const { return m_frames; }
+
+private:
+	std::uint64_t m_interval{ 0 };
+	std::uint64_t m_lastFrame{ 0 };
+	bool m_scheduled{ false };
+	std::uint64_t m_requests{ 0 };
+	std::uint64_t m_frames{ 0 };
+
+	void present(std::uint64_t time)
+	{
+		m_lastFrame = time;
+		++m_frames;
+	}
+};
@@ -0,0 +1,245 @@
+#pragma once
+
+#include <gdiplus.h>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+#include "FontCache.h"
+#include "RenderBackend.h"
+
+using namespace Gdiplus;
+
+// The pen and brush for each interned style, made the first time the style is drawn and kept across
+// paints. A slot whose style was dropped and its id reused shows up by revision and is remade.
+class GdiplusStyleCache
+{
+public:
+	Pen* getPen(const StyleTable& styles, StyleId id)
+	{
+		Entry& entry{ getEntry(styles, id) };
+		if (!entry.pen)
+		{
+			const ShapeStyle& style{ styles.get(id) };
+			entry.pen = std::make_unique<Pen>(Color(style.color), static_cast<REAL>(style.stroke));
+		}
+		return entry.pen.get();
+	}
+
+	SolidBrush* getBrush(const StyleTable& styles, StyleId id)
+	{
+		Entry& entry{ getEntry(styles, id) };
+		if (!entry.brush)
+		{
+			entry.brush = std::make_unique<SolidBrush>(Color(styles.get(id).color));
+		}
+		return entry.brush.get();
+	}
+
+	// GDI+ objects must be gone before GdiplusShutdown
+	void clear() { m_entries.clear(); }
+
+private:
+	struct Entry
+	{
+		std::uint32_t revision{ 0 };
+		std::unique_ptr<Pen> pen;
+		std::unique_ptr<SolidBrush> brush;
+	};
+
+	std::vector<Entry> m_entries; // indexed by StyleId
+
+	Entry& getEntry(const StyleTable& styles, StyleId id)
+	{
+		if (id >= m_entries.size())
+		{
+			m_entries.resize(styles.capacity());
+		}
+
+		Entry& entry{ m_entries[id] };
+		std::uint32_t revision{ styles.getRevision(id) };
+		if (entry.revision != revision)
+		{
+			entry.revision = revision;
+			entry.pen.reset();
+			entry.brush.reset();
+		}
+		return entry;
+	}
+};
+
+inline GdiplusStyleCache& gdiplusStyles()
+{
+	static GdiplusStyleCache cache;
+	return cache;
+}
+
+// Paints onto a GDI+ Graphics, which is how the window is drawn. Shapes with an interned style use the
+// long-lived pens and brushes in gdiplusStyles(); anything else (previews, overlays, staff lines) gets
+// pens and brushes made the first time a color and width come up, kept for as long as the backend lives,
+// normally one WM_PAINT.
+class GdiplusBackend : public RenderBackend
+{
+public:
+	explicit GdiplusBackend(Graphics& graphics) : m_graphics(graphics) {}
+
+	Graphics& getGraphics() { return m_graphics; }
+
+	void setStyle(StyleId style) override { m_style = style; }
+
+	// the view's zoom, so renderShape can simplify what's too small to see
+	void setScale(float scale) { m_scale = scale; }
+	float getScale() const override { return m_scale; }
+
+	// how many primitives this backend has drawn, for the frame-time overlay
+	std::uint32_t getDrawCalls() const { return m_drawCalls; }
+
+	void drawLine(float x1, float y1, float x2, float y2, std::uint32_t color, float width) override
+	{
+		++m_drawCalls;
+		m_graphics.DrawLine(getPen(color, width), x1, y1, x2, y2);
+	}
+
+	void drawRect(float x, float y, float width, float height, std::uint32_t color, float penWidth, bool filled) override
+	{
+		++m_drawCalls;
+		if (filled)
+		{
+			m_graphics.FillRectangle(getBrush(color), x, y, width, height);
+		}
+		else
+		{
+			m_graphics.DrawRectangle(getPen(color, penWidth), x, y, width, height);
+		}
+	}
+
+	void drawEllipse(float x, float y, float width, float height, std::uint32_t color, float penWidth, bool filled) override
+	{
+		++m_drawCalls;
+		if (filled)
+		{
+			m_graphics.FillEllipse(getBrush(color), x, y, width, height);
+		}
+		else
+		{
+			m_graphics.DrawEllipse(getPen(color, penWidth), x, y, width, height);
+		}
+	}
+
+	void drawPolygon(const RenderPoint* points, std::size_t count, std::uint32_t color, float penWidth, bool filled) override
+	{
+		++m_drawCalls;
+		if (filled)
+		{
+			m_graphics.FillPolygon(getBrush(color), toPointF(points), static_cast<INT>(count));
+		}
+		else
+		{
+			m_graphics.DrawPolygon(getPen(color, penWidth), toPointF(points), static_cast<INT>(count));
+		}
+	}
+
+	void drawCurve(const RenderPoint* points, std::size_t count, std::uint32_t color, float penWidth) override
+	{
+		++m_drawCalls;
+		m_graphics.DrawCurve(getPen(color, penWidth), toPointF(points), static_cast<INT>(count));
+	}
+
+	void drawBeziers(const RenderPoint* points, std::size_t count, std::uint32_t color, float penWidth) override
+	{
+		++m_drawCalls;
+		m_graphics.DrawBeziers(getPen(color, penWidth), toPointF(points), static_cast<INT>(count));
+	}
+
+	void drawPolyline(const RenderPoint* points, std::size_t count, std::uint32_t color, float width) override
+	{
+		if (count >= 2)
+		{
+			++m_drawCalls;
+			m_graphics.DrawLines(getPen(color, width), toPointF(points), static_cast<INT>(count));
+		}
+	}
+
+	void drawText(const std::wstring& text, float x, float y, const std::wstring& family, float size, std::uint32_t color) override
+	{
+		++m_drawCalls;
+		std::shared_ptr<Font> font{ fontCache().get(family, static_cast<int>(std::lround(size))) };
+		m_graphics.DrawString(text.c_str(), -1, font.get(), PointF(x, y), getBrush(color));
+	}
+
+	// saves the window's own transform the first time, so the identity can put it back
+	void setTransform(const Transform& transform) override
+	{
+		if (m_transformed)
+		{
+			m_graphics.Restore(m_untransformed);
+			m_transformed = false;
+		}
+		if (transform.isIdentity())
+		{
+			return;
+		}
+
+		m_untransformed = m_graphics.Save();
+		m_transformed = true;
+		Matrix matrix(transform.a, transform.b, transform.c, transform.d, transform.tx, transform.ty);
+		m_graphics.MultiplyTransform(&matrix);
+	}
+
+private:
+	Graphics& m_graphics;
+	StyleId m_style{ kNoStyle };
+	float m_scale{ 1.0f };
+	std::uint32_t m_drawCalls{ 0 };
+	GraphicsState m_untransformed{ 0 };
+	bool m_transformed{ false };
+	std::unordered_map<std::uint64_t, std::unique_ptr<Pen>> m_pens; // keyed by color and width bits
+	std::unordered_map<std::uint32_t, std::unique_ptr<SolidBrush>> m_brushes;
+
+	static const PointF* toPointF(const RenderPoint* points)
+	{
+		static_assert(sizeof(PointF) == sizeof(RenderPoint), "RenderPoint mirrors PointF");
+		return reinterpret_cast<const PointF*>(points);
+	}
+
+	Pen* getPen(std::uint32_t color, float width)
+	{
+		if (matchesStyle(color) && static_cast<float>(shapeStyles().get(m_style).stroke) == width)
+		{
+			return gdiplusStyles().getPen(shapeStyles(), m_style);
+		}
+
+		std::uint32_t widthBits;
+		std::memcpy(&widthBits, &width, sizeof(widthBits));
+
+		auto& pen = m_pens[static_cast<std::uint64_t>(color) << 32 | widthBits];
+		if (!pen)
+		{
+			pen = std::make_unique<Pen>(Color(color), width);
+		}
+		return pen.get();
+	}
+
+	// the interned style's objects only stand in when they'd draw the same thing
+	bool matchesStyle(std::uint32_t color) const
+	{
+		return m_style != kNoStyle && m_style < shapeStyles().capacity() && shapeStyles().get(m_style).color == color;
+	}
+
+	SolidBrush* getBrush(std::uint32_t color)
+	{
+		if (matchesStyle(color))
+		{
+			return gdiplusStyles().getBrush(shapeStyles(), m_style);
+		}
+
+		auto& brush = m_brushes[color];
+		if (!brush)
+		{
+			brush = std::make_unique<SolidBrush>(Color(color));
+		}
+		return brush.get();
+	}
+};
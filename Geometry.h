@@ -0,0 +1,135 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+
+// axis-aligned bounding box in canvas pixels; kept free of windows.h so the portable cores can use it
+struct Bounds
+{
+	float left{ 0.0f };
+	float top{ 0.0f };
+	float right{ 0.0f };
+	float bottom{ 0.0f };
+
+	static Bounds fromCorner(float x, float y, float length, float height)
+	{
+		// shapes dragged up or left have negative extents; normalize them
+		return Bounds{ (std::min)(x, x + length), (std::min)(y, y + height), (std::max)(x, x + length), (std::max)(y, y + height) };
+	}
+
+	// the identity for united(); contains and intersects nothing
+	static Bounds empty() { return Bounds{ 0.0f, 0.0f, -1.0f, -1.0f }; }
+
+	float width() const { return right - left; }
+	float height() const { return bottom - top; }
+
+	bool isEmpty() const { return right < left || bottom < top; }
+
+	bool contains(float x, float y) const { return x >= left && x <= right && y >= top && y <= bottom; }
+
+	bool intersects(const Bounds& other) const
+	{
+		return !isEmpty() && !other.isEmpty() && left <= other.right && other.left <= right && top <= other.bottom && other.top <= bottom;
+	}
+
+	Bounds inflated(float amount) const
+	{
+		return isEmpty() ? *this : Bounds{ left - amount, top - amount, right + amount, bottom + amount };
+	}
+
+	Bounds translated(float dx, float dy) const
+	{
+		return isEmpty() ? *this : Bounds{ left + dx, top + dy, right + dx, bottom + dy };
+	}
+
+	Bounds united(const Bounds& other) const
+	{
+		if (isEmpty())
+		{
+			return other;
+		}
+		if (other.isEmpty())
+		{
+			return *this;
+		}
+
+		return Bounds{ (std::min)(left, other.left), (std::min)(top, other.top), (std::max)(right, other.right), (std::max)(bottom, other.bottom) };
+	}
+
+	bool operator==(const Bounds& other) const
+	{
+		return left == other.left && top == other.top && right == other.right && bottom == other.bottom;
+	}
+	bool operator!=(const Bounds& other) const { return !(*this == other); }
+};
+
+// 2D affine transform taking (x, y) to (a x + c y + tx, b x + d y + ty); the same six numbers as a GDI+
+// Matrix, an SVG matrix() and a PDF cm. The default is the identity.
+struct Transform
+{
+	float a{ 1.0f };
+	float b{ 0.0f };
+	float c{ 0.0f };
+	float d{ 1.0f };
+	float tx{ 0.0f };
+	float ty{ 0.0f };
+
+	static Transform translation(float dx, float dy) { return Transform{ 1.0f, 0.0f, 0.0f, 1.0f, dx, dy }; }
+
+	// scales by (sx, sy) about (cx, cy)
+	static Transform scaling(float sx, float sy, float cx, float cy) { return Transform{ sx, 0.0f, 0.0f, sy, cx - sx * cx, cy - sy * cy }; }
+
+	// turns clockwise on screen, since y points down, by radians about (cx, cy)
+	static Transform rotation(float radians, float cx, float cy)
+	{
+		float cosine{ std::cos(radians) };
+		float sine{ std::sin(radians) };
+		return Transform{ cosine, sine, -sine, cosine, cx - cosine * cx + sine * cy, cy - sine * cx - cosine * cy };
+	}
+
+	bool isTranslation() const { return a == 1.0f && b == 0.0f && c == 0.0f && d == 1.0f; }
+	bool isIdentity() const { return isTranslation() && tx == 0.0f && ty == 0.0f; }
+
+	float mapX(float x, float y) const { return a * x + c * y + tx; }
+	float mapY(float x, float y) const { return b * x + d * y + ty; }
+
+	// this transform followed by next
+	Transform then(const Transform& next) const
+	{
+		return Transform{ next.a * a + next.c * b, next.b * a + next.d * b, next.a * c + next.c * d, next.b * c + next.d * d,
+			next.a * tx + next.c * ty + next.tx, next.b * tx + next.d * ty + next.ty };
+	}
+
+	// the transform that undoes this one; the identity if this one flattens everything onto a line
+	Transform inverted() const
+	{
+		float determinant{ a * d - b * c };
+		if (determinant == 0.0f)
+		{
+			return Transform{};
+		}
+
+		return Transform{ d / determinant, -b / determinant, -c / determinant, a / determinant,
+			(c * ty - d * tx) / determinant, (b * tx - a * ty) / determinant };
+	}
+
+	// the box around the transformed corners of bounds
+	Bounds map(const Bounds& bounds) const
+	{
+		if (bounds.isEmpty() || isTranslation())
+		{
+			return bounds.translated(tx, ty);
+		}
+
+		float xs[4]{ mapX(bounds.left, bounds.top), mapX(bounds.right, bounds.top), mapX(bounds.left, bounds.bottom), mapX(bounds.right, bounds.bottom) };
+		float ys[4]{ mapY(bounds.left, bounds.top), mapY(bounds.right, bounds.top), mapY(bounds.left, bounds.bottom), mapY(bounds.right, bounds.bottom) };
+		return Bounds{ (std::min)({ xs[0], xs[1], xs[2], xs[3] }), (std::min)({ ys[0], ys[1], ys[2], ys[3] }),
+			(std::max)({ xs[0], xs[1], xs[2], xs[3] }), (std::max)({ ys[0], ys[1], ys[2], ys[3] }) };
+	}
+
+	bool operator==(const Transform& other) const
+	{
+		return a == other.a && b == other.b && c == other.c && d == other.d && tx == other.tx && ty == other.ty;
+	}
+	bool operator!=(const Transform& other) const { return !(*this == other); }
+};
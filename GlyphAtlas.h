@@ -0,0 +1,203 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+// Anti-aliased glyph masks, drawn once and kept for reuse. A mask is 8-bit coverage for one glyph at one
+// size and one subpixel position, packed onto shelves in square pages. Pages are the unit of eviction:
+// once the budget is reached, the page used least recently is emptied for the next glyph, and the glyphs
+// on it are drawn again if they come back. Scores reuse a few dozen glyphs at a few sizes, so that's rare.
+class GlyphAtlas
+{
+public:
+	static constexpr int kPageSize{ 512 };
+	static constexpr int kSubpixels{ 4 }; // positions per pixel the pen is rounded to, across and down
+	static constexpr int kSizeSteps{ 4 }; // em sizes are rounded to quarter pixels
+
+	// a glyph's mask, and where its top left goes relative to the pen's whole pixel
+	struct Entry
+	{
+		std::uint8_t* mask; // rows of stride bytes
+		int stride;
+		int width;
+		int height;
+		int left;
+		int top;
+	};
+
+	explicit GlyphAtlas(std::size_t budget = 4u << 20) : m_budget(budget) {}
+
+	// the key for glyph at em pixels with the pen at subpixel (subX, subY)
+	static std::uint64_t keyOf(std::uint16_t glyph, int sizeSteps, int subX, int subY)
+	{
+		return static_cast<std::uint64_t>(glyph) << 40 | static_cast<std::uint64_t>(static_cast<std::uint32_t>(sizeSteps)) << 8
+			| static_cast<std::uint64_t>(subX) << 4 | static_cast<std::uint64_t>(subY);
+	}
+
+	// the glyph if it's been drawn, now the most recently used; the entry is good until the next insert
+	const Entry* find(std::uint64_t key)
+	{
+		auto found = m_entries.find(key);
+		if (found == m_entries.end())
+		{
+			++m_misses;
+			return nullptr;
+		}
+
+		++m_hits;
+		m_pages[found->second.page]->lastUse = ++m_clock;
+		return &found->second.entry;
+	}
+
+	// Room for a width by height mask under key, cleared for the caller to draw into; null if it's bigger
+	// than a page. The mask stays until its page is evicted, which only an insert does.
+	const Entry* insert(std::uint64_t key, int width, int height, int left, int top)
+	{
+		if (width <= 0 || height <= 0 || width > kPageSize || height > kPageSize)
+		{
+			return nullptr;
+		}
+
+		std::size_t page;
+		int x;
+		int y;
+		if (!place(width, height, page, x, y))
+		{
+			return nullptr;
+		}
+
+		Page& target{ *m_pages[page] };
+		target.lastUse = ++m_clock;
+		target.keys.push_back(key);
+
+		std::uint8_t* mask{ &target.pixels[static_cast<std::size_t>(y) * kPageSize + x] };
+		for (int row{ 0 }; row < height; ++row)
+		{
+			std::fill(mask + static_cast<std::size_t>(row) * kPageSize, mask + static_cast<std::size_t>(row) * kPageSize + width, std::uint8_t{ 0 });
+		}
+
+		Stored& stored{ m_entries[key] };
+		stored = Stored{ Entry{ mask, kPageSize, width, height, left, top }, page };
+		return &stored.entry;
+	}
+
+	void setBudget(std::size_t budget) { m_budget = budget; }
+	std::size_t getBudget() const { return m_budget; }
+	std::size_t getBytes() const { return m_pages.size() * kPageBytes; }
+
+	std::size_t size() const { return m_entries.size(); }
+	std::size_t getHits() const { return m_hits; }
+	std::size_t getMisses() const { return m_misses; }
+	std::size_t getEvictions() const { return m_evictions; }
+
+	void clear()
+	{
+		m_entries.clear();
+		m_pages.clear();
+	}
+
+private:
+	static constexpr std::size_t kPageBytes{ static_cast<std::size_t>(kPageSize) * kPageSize };
+
+	struct Shelf
+	{
+		int y;
+		int height;
+		int x; // where the next mask goes
+	};
+
+	struct Page
+	{
+		std::vector<std::uint8_t> pixels;
+		std::vector<Shelf> shelves;
+		int bottom{ 0 }; // below the last shelf
+		std::uint64_t lastUse{ 0 };
+		std::vector<std::uint64_t> keys; // the glyphs on it
+	};
+
+	struct Stored
+	{
+		Entry entry;
+		std::size_t page;
+	};
+
+	std::size_t m_budget;
+	std::vector<std::unique_ptr<Page>> m_pages;
+	std::unordered_map<std::uint64_t, Stored> m_entries;
+	std::uint64_t m_clock{ 0 };
+
+	std::size_t m_hits{ 0 };
+	std::size_t m_misses{ 0 };
+	std::size_t m_evictions{ 0 };
+
+	// finds room on a page with space, a new page while under budget, or the least recently used page
+	bool place(int width, int height, std::size_t& page, int& x, int& y)
+	{
+		for (std::size_t i{ 0 }; i < m_pages.size(); ++i)
+		{
+			if (placeOn(*m_pages[i], width, height, x, y))
+			{
+				page = i;
+				return true;
+			}
+		}
+
+		if (m_pages.empty() || (m_pages.size() + 1) * kPageBytes <= m_budget)
+		{
+			m_pages.push_back(std::make_unique<Page>());
+			m_pages.back()->pixels.assign(kPageBytes, 0);
+			page = m_pages.size() - 1;
+			return placeOn(*m_pages.back(), width, height, x, y);
+		}
+
+		page = 0;
+		for (std::size_t i{ 1 }; i < m_pages.size(); ++i)
+		{
+			if (m_pages[i]->lastUse < m_pages[page]->lastUse)
+			{
+				page = i;
+			}
+		}
+
+		Page& evicted{ *m_pages[page] };
+		for (std::uint64_t key : evicted.keys)
+		{
+			m_entries.erase(key);
+		}
+		evicted.keys.clear();
+		evicted.shelves.clear();
+		evicted.bottom = 0;
+		++m_evictions;
+		return placeOn(evicted, width, height, x, y);
+	}
+
+	// a shelf no more than a third taller than the mask, or a new shelf
+	static bool placeOn(Page& page, int width, int height, int& x, int& y)
+	{
+		for (Shelf& shelf : page.shelves)
+		{
+			if (shelf.height >= height && shelf.height * 3 <= height * 4 && shelf.x + width <= kPageSize)
+			{
+				x = shelf.x;
+				y = shelf.y;
+				shelf.x += width;
+				return true;
+			}
+		}
+
+		if (page.bottom + height > kPageSize)
+		{
+			return false;
+		}
+
+		page.shelves.push_back(Shelf{ page.bottom, height, width });
+		x = 0;
+		y = page.bottom;
+		page.bottom += height;
+		return true;
+	}
+};
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <unordered_map>
+#include "MappedFile.h"
+#include "OpenType.h"
+
+// Leland's outlines and metrics for the vector exporters, read straight from the mapped font so export
+// works without GDI or an installed copy of the font.
+class GlyphOutlines
+{
+public:
+	bool open(const std::filesystem::path& fontPath)
+	{
+		m_glyphs.clear();
+		if (!m_file.open(fontPath) || !m_font.open(m_file.data(), m_file.size()))
+		{
+			m_file.close();
+			return false;
+		}
+		return true;
+	}
+
+	bool isOpen() const { return m_file.isOpen(); }
+
+	int getUnitsPerEm() const { return m_font.getUnitsPerEm(); }
+	int getAscender() const { return m_font.getAscender(); }
+	int getAdvance(std::uint16_t glyph) const { return m_font.getAdvance(glyph); }
+
+	// 0 (.notdef) for code points Leland doesn't have
+	std::uint16_t getGlyph(std::uint32_t codePoint)
+	{
+		auto found = m_glyphs.find(codePoint);
+		if (found != m_glyphs.end())
+		{
+			return found->second;
+		}
+
+		std::uint16_t glyph{ m_font.getGlyph(codePoint) };
+		m_glyphs.emplace(codePoint, glyph);
+		return glyph;
+	}
+
+	bool getOutline(std::uint16_t glyph, OutlineSink& sink) const { return m_font.getOutline(glyph, sink); }
+
+private:
+	MappedFile m_file;
+	OpenTypeFont m_font;
+	std::unordered_map<std::uint32_t, std::uint16_t> m_glyphs; // code point lookups already made
+};
@@ -0,0 +1,306 @@
+#pragma once
+
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include "MappedFile.h"
+#include "OpenType.h"
+
+// One supported code point. This is also the record layout of the cache file, so keep it fixed-size.
+struct GlyphInfo
+{
+	std::uint32_t codePoint;
+	std::uint32_t nameOffset; // into the name pool
+	std::uint16_t glyphId;
+	std::uint16_t nameLength;
+	std::int16_t xMin; // outline bounds in font units, y up
+	std::int16_t yMin;
+	std::int16_t xMax;
+	std::int16_t yMax;
+};
+
+static_assert(sizeof(GlyphInfo) == 20, "GlyphInfo is written to disk as-is");
+
+// Supported Leland glyphs with names and bounding boxes. The table is parsed from the font's cmap and CFF
+// outlines once, then written to a cache file. Later runs memory-map the cache, as long as the hash of
+// the font (and of SMuFL's glyphnames.json, if present) still matches.
+class GlyphTable
+{
+public:
+	// the private use area SMuFL lays its glyphs out in, as far as GDI's 16-bit WCHAR reaches
+	static constexpr std::uint32_t kFirstCodePoint{ 0xE000 };
+	static constexpr std::uint32_t kLastCodePoint{ 0xFFFE };
+
+	bool load(const std::filesystem::path& fontPath, const std::filesystem::path& cachePath, const std::filesystem::path& namesPath = {})
+	{
+		release();
+
+		MappedFile font;
+		if (!font.open(fontPath))
+		{
+			return false;
+		}
+
+		// SMuFL's canonical names ship as metadata rather than in the font, which names its glyphs uniXXXX
+		MappedFile smuflNames;
+		if (!namesPath.empty())
+		{
+			smuflNames.open(namesPath);
+		}
+
+		std::uint64_t sourceHash{ hashBytes(font.data(), font.size()) };
+		if (smuflNames.isOpen())
+		{
+			sourceHash = hashBytes(smuflNames.data(), smuflNames.size(), sourceHash);
+		}
+
+		if (mapCache(cachePath, sourceHash))
+		{
+			return true;
+		}
+
+		std::string_view json{};
+		if (smuflNames.isOpen())
+		{
+			json = std::string_view(reinterpret_cast<const char*>(smuflNames.data()), smuflNames.size());
+		}
+
+		if (!parse(font.data(), font.size(), json, m_ownedGlyphs, m_ownedNames, m_unitsPerEm))
+		{
+			return false;
+		}
+
+		if (writeCache(cachePath, sourceHash) && mapCache(cachePath, sourceHash))
+		{
+			m_ownedGlyphs.clear();
+			m_ownedNames.clear();
+			return true;
+		}
+
+		// the cache couldn't be written (e.g. a read-only install), so serve the freshly parsed copy
+		m_glyphs = m_ownedGlyphs.data();
+		m_count = m_ownedGlyphs.size();
+		m_names = m_ownedNames.data();
+		m_namesSize = m_ownedNames.size();
+		return true;
+	}
+
+	std::size_t size() const { return m_count; }
+	bool isEmpty() const { return m_count == 0; }
+	int getUnitsPerEm() const { return m_unitsPerEm; }
+
+	// sorted by code point
+	const GlyphInfo* begin() const { return m_glyphs; }
+	const GlyphInfo* end() const { return m_glyphs + m_count; }
+	const GlyphInfo& operator[](std::size_t index) const { return m_glyphs[index]; }
+
+	const GlyphInfo* find(std::uint32_t codePoint) const
+	{
+		const GlyphInfo* it{ std::lower_bound(begin(), end(), codePoint, [](const GlyphInfo& glyph, std::uint32_t cp) {
+			return glyph.codePoint < cp;
+		}) };
+		return it != end() && it->codePoint == codePoint ? it : nullptr;
+	}
+
+	std::string_view getName(const GlyphInfo& glyph) const { return std::string_view(m_names + glyph.nameOffset, glyph.nameLength); }
+
+	// builds the table straight from the font bytes; json is SMuFL's glyphnames.json and may be empty
+	static bool parse(const std::uint8_t* fontData, std::size_t fontSize, std::string_view json, std::vector<GlyphInfo>& glyphs, std::string& names, int& unitsPerEm)
+	{
+		OpenTypeFont font;
+		if (!font.open(fontData, fontSize))
+		{
+			return false;
+		}
+
+		std::unordered_map<std::uint32_t, std::string_view> smuflNames;
+		readSmuflNames(json, smuflNames);
+
+		std::vector<std::pair<std::uint32_t, std::uint16_t>> mapped;
+		font.getCharacterMap(kFirstCodePoint, kLastCodePoint, mapped);
+
+		glyphs.clear();
+		names.clear();
+		unitsPerEm = font.getUnitsPerEm();
+
+		for (const auto& [codePoint, glyphId] : mapped)
+		{
+			OutlineBounds bounds;
+			if (!font.getOutline(glyphId, bounds))
+			{
+				continue;
+			}
+
+			GlyphInfo glyph{};
+			glyph.codePoint = codePoint;
+			glyph.glyphId = glyphId;
+
+			if (!bounds.isEmpty())
+			{
+				glyph.xMin = static_cast<std::int16_t>(std::floor(bounds.getXMin()));
+				glyph.yMin = static_cast<std::int16_t>(std::floor(bounds.getYMin()));
+				glyph.xMax = static_cast<std::int16_t>(std::ceil(bounds.getXMax()));
+				glyph.yMax = static_cast<std::int16_t>(std::ceil(bounds.getYMax()));
+			}
+
+			auto smufl = smuflNames.find(codePoint);
+			std::string name{ smufl != smuflNames.end() ? std::string(smufl->second) : font.getGlyphName(glyphId) };
+
+			glyph.nameOffset = static_cast<std::uint32_t>(names.size());
+			glyph.nameLength = static_cast<std::uint16_t>(name.size());
+			names += name;
+
+			glyphs.push_back(glyph);
+		}
+
+		return !glyphs.empty();
+	}
+
+	// FNV-1a; enough to notice a replaced font, not meant to resist tampering
+	static std::uint64_t hashBytes(const std::uint8_t* data, std::size_t size, std::uint64_t hash = 14695981039346656037ull)
+	{
+		for (std::size_t i{ 0 }; i < size; ++i)
+		{
+			hash ^= data[i];
+			hash *= 1099511628211ull;
+		}
+		return hash;
+	}
+
+private:
+	struct CacheHeader
+	{
+		char magic[4];
+		std::uint32_t version;
+		std::uint64_t sourceHash;
+		std::uint32_t unitsPerEm;
+		std::uint32_t count;
+		std::uint32_t namesSize;
+		std::uint32_t reserved;
+	};
+
+	static_assert(sizeof(CacheHeader) == 32, "CacheHeader is written to disk as-is");
+
+	static constexpr std::uint32_t kCacheVersion{ 1 };
+
+	MappedFile m_cache;
+	std::vector<GlyphInfo> m_ownedGlyphs;
+	std::string m_ownedNames;
+
+	const GlyphInfo* m_glyphs{ nullptr };
+	std::size_t m_count{ 0 };
+	const char* m_names{ nullptr };
+	std::size_t m_namesSize{ 0 };
+	int m_unitsPerEm{ 1000 };
+
+	void release()
+	{
+		m_cache.close();
+		m_ownedGlyphs.clear();
+		m_ownedNames.clear();
+		m_glyphs = nullptr;
+		m_count = 0;
+		m_names = nullptr;
+		m_namesSize = 0;
+	}
+
+	bool mapCache(const std::filesystem::path& cachePath, std::uint64_t sourceHash)
+	{
+		if (!m_cache.open(cachePath) || m_cache.size() < sizeof(CacheHeader))
+		{
+			m_cache.close();
+			return false;
+		}
+
+		CacheHeader header;
+		std::memcpy(&header, m_cache.data(), sizeof(header));
+
+		std::size_t expected{ sizeof(CacheHeader) + static_cast<std::size_t>(header.count) * sizeof(GlyphInfo) + header.namesSize };
+		if (std::memcmp(header.magic, "SSGT", 4) != 0 || header.version != kCacheVersion || header.sourceHash != sourceHash || m_cache.size() != expected)
+		{
+			m_cache.close();
+			return false;
+		}
+
+		// the header is 32 bytes and the mapping page-aligned, so the records are suitably aligned in place
+		const GlyphInfo* glyphs{ reinterpret_cast<const GlyphInfo*>(m_cache.data() + sizeof(CacheHeader)) };
+		for (std::uint32_t i{ 0 }; i < header.count; ++i)
+		{
+			if (static_cast<std::size_t>(glyphs[i].nameOffset) + glyphs[i].nameLength > header.namesSize)
+			{
+				m_cache.close();
+				return false;
+			}
+		}
+
+		m_glyphs = glyphs;
+		m_count = header.count;
+		m_names = reinterpret_cast<const char*>(m_cache.data() + sizeof(CacheHeader) + header.count * sizeof(GlyphInfo));
+		m_namesSize = header.namesSize;
+		m_unitsPerEm = static_cast<int>(header.unitsPerEm);
+		return true;
+	}
+
+	bool writeCache(const std::filesystem::path& cachePath, std::uint64_t sourceHash) const
+	{
+		CacheHeader header{};
+		std::memcpy(header.magic, "SSGT", 4);
+		header.version = kCacheVersion;
+		header.sourceHash = sourceHash;
+		header.unitsPerEm = static_cast<std::uint32_t>(m_unitsPerEm);
+		header.count = static_cast<std::uint32_t>(m_ownedGlyphs.size());
+		header.namesSize = static_cast<std::uint32_t>(m_ownedNames.size());
+
+		std::ofstream out(cachePath, std::ios::binary | std::ios::trunc);
+		if (!out)
+		{
+			return false;
+		}
+
+		out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+		out.write(reinterpret_cast<const char*>(m_ownedGlyphs.data()), static_cast<std::streamsize>(m_ownedGlyphs.size() * sizeof(GlyphInfo)));
+		out.write(m_ownedNames.data(), static_cast<std::streamsize>(m_ownedNames.size()));
+		return static_cast<bool>(out);
+	}
+
+	// Pulls "name": { "codepoint": "U+E050", ... } pairs out of glyphnames.json. It scans for the
+	// codepoint fields instead of parsing the JSON, which is all that file's flat layout needs.
+	static void readSmuflNames(std::string_view json, std::unordered_map<std::uint32_t, std::string_view>& names)
+	{
+		constexpr std::string_view field{ "\"codepoint\"" };
+
+		std::size_t at{ json.find(field) };
+		while (at != std::string_view::npos)
+		{
+			std::size_t value{ json.find("U+", at + field.size()) };
+			std::size_t open{ json.rfind('{', at) };
+			std::size_t keyEnd{ open == std::string_view::npos ? open : json.rfind('"', open) };
+			std::size_t keyStart{ keyEnd == std::string_view::npos || keyEnd == 0 ? std::string_view::npos : json.rfind('"', keyEnd - 1) };
+
+			if (value != std::string_view::npos && keyStart != std::string_view::npos)
+			{
+				std::uint32_t codePoint{ 0 };
+				std::size_t digit{ value + 2 };
+				for (; digit < json.size() && std::isxdigit(static_cast<unsigned char>(json[digit])); ++digit)
+				{
+					char c{ static_cast<char>(std::tolower(static_cast<unsigned char>(json[digit]))) };
+					codePoint = codePoint * 16 + static_cast<std::uint32_t>(c <= '9' ? c - '0' : c - 'a' + 10);
+				}
+
+				names.emplace(codePoint, json.substr(keyStart + 1, keyEnd - keyStart - 1));
+			}
+
+			at = json.find(field, at + field.size());
+		}
+	}
+};
@@ -0,0 +1,128 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// Read-only memory map of a whole file. Empty files are refused, since neither platform can map zero bytes.
+class MappedFile
+{
+public:
+	MappedFile() = default;
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+
+	~MappedFile() { close(); }
+
+	bool open(const std::filesystem::path& path)
+	{
+		close();
+
+#ifdef _WIN32
+		m_file = CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+		if (m_file == INVALID_HANDLE_VALUE)
+		{
+			return false;
+		}
+
+		LARGE_INTEGER size;
+		if (!GetFileSizeEx(m_file, &size) || size.QuadPart == 0)
+		{
+			close();
+			return false;
+		}
+
+		m_mapping = CreateFileMappingW(m_file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+		if (!m_mapping)
+		{
+			close();
+			return false;
+		}
+
+		m_data = static_cast<const std::uint8_t*>(MapViewOfFile(m_mapping, FILE_MAP_READ, 0, 0, 0));
+		m_size = static_cast<std::size_t>(size.QuadPart);
+#else
+		m_fd = ::open(path.c_str(), O_RDONLY);
+		if (m_fd < 0)
+		{
+			return false;
+		}
+
+		struct stat info;
+		if (fstat(m_fd, &info) != 0 || info.st_size == 0)
+		{
+			close();
+			return false;
+		}
+
+		void* view{ mmap(nullptr, static_cast<std::size_t>(info.st_size), PROT_READ, MAP_PRIVATE, m_fd, 0) };
+		m_data = view == MAP_FAILED ? nullptr : static_cast<const std::uint8_t*>(view);
+		m_size = static_cast<std::size_t>(info.st_size);
+#endif
+
+		if (!m_data)
+		{
+			close();
+			return false;
+		}
+
+		return true;
+	}
+
+	void close()
+	{
+#ifdef _WIN32
+		if (m_data)
+		{
+			UnmapViewOfFile(m_data);
+		}
+		if (m_mapping)
+		{
+			CloseHandle(m_mapping);
+			m_mapping = nullptr;
+		}
+		if (m_file != INVALID_HANDLE_VALUE)
+		{
+			CloseHandle(m_file);
+			m_file = INVALID_HANDLE_VALUE;
+		}
+#else
+		if (m_data)
+		{
+			munmap(const_cast<std::uint8_t*>(m_data), m_size);
+		}
+		if (m_fd >= 0)
+		{
+			::close(m_fd);
+			m_fd = -1;
+		}
+#endif
+
+		m_data = nullptr;
+		m_size = 0;
+	}
+
+	bool isOpen() const { return m_data != nullptr; }
+	const std::uint8_t* data() const { return m_data; }
+	std::size_t size() const { return m_size; }
+
+private:
+#ifdef _WIN32
+	HANDLE m_file{ INVALID_HANDLE_VALUE };
+	HANDLE m_mapping{ nullptr };
+#else
+	int m_fd{ -1 };
+#endif
+
+	const std::uint8_t* m_data{ nullptr };
+	std::size_t m_size{ 0 };
+};
@@ -0,0 +1,1433 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <limits>
+#include <ostream>
+#include <string>
+#include <utility>
+#include <vector>
+#include "RenderBackend.h"
+#include "ShapeStore.h"
+#include "SpatialIndex.h"
+#include "XmlWriter.h"
+
+// Writes score elements as partwise MusicXML, reading the music back off the page. Measures side by side
+// make a staff; staves whose barlines line up and that sit evenly spaced make a system, and the nth staff
+// of every system is the same staff of the piece. A part name left of the first system that sits between
+// two staves puts them in one part, as MusicXmlImporter writes a piano's. In a measure, Leland Symbols are
+// read by code point and by where they sit on the staff: the clef, key and time at its start, then notes,
+// rests, their accidentals and dots, and clef changes. Text above the first staff is the title, and Text
+// beside a staff is words.
+//
+// Only the Measures are read up front, once, to find the staves, systems and parts. The file then goes part
+// by part and system by system, and each part's staves on a system pull their symbols out of a spatial
+// index of the score as they're written, so what's held grows with the measures and the busiest system,
+// not with the notes; getMemoryBound says how much. The XML goes through XmlWriter's buffer to the stream.
+// Durations come from note types and dots, so tuplets come out at their written values, and ledger lines,
+// drawings and glyphs that aren't notation are left out.
+class MusicXmlExporter
+{
+public:
+	// false, with getError saying why, if there's no staff to write or the file can't be written; index
+	// holds the score's outermost elements by their bounds, as SCORE keeps them
+	bool write(const ShapeStore& elements, const SpatialIndex<ShapeHandle>& index, const std::filesystem::path& path)
+	{
+		std::ofstream out(path, std::ios::binary);
+		if (!out)
+		{
+			return fail("can't create the file");
+		}
+		return write(elements, index, out);
+	}
+
+	bool write(const ShapeStore& elements, const SpatialIndex<ShapeHandle>& index, std::ostream& out)
+	{
+		*this = MusicXmlExporter();
+		findMeasures(elements);
+		if (m_boxes.empty())
+		{
+			return fail("the score has no measures to write");
+		}
+		findStaves();
+		findSystems();
+		findParts(elements, index);
+
+		XmlWriter writer(out);
+		writeScore(elements, index, writer);
+		if (!writer.finish())
+		{
+			return fail("couldn't write the file");
+		}
+		return true;
+	}
+
+	// for callers with no index of the score; the one built here takes memory for every element
+	bool write(const ShapeStore& elements, const std::filesystem::path& path)
+	{
+		SpatialIndex<ShapeHandle> index{ indexRoots(elements) };
+		return write(elements, index, path);
+	}
+
+	bool write(const ShapeStore& elements, std::ostream& out)
+	{
+		SpatialIndex<ShapeHandle> index{ indexRoots(elements) };
+		return write(elements, index, out);
+	}
+
+	const char* getError() const { return m_error ? m_error : ""; }
+
+	// A measure's box, and its share of the rows, systems and bands when a staff is one measure long, in
+	// vectors that may have doubled; and a Mark, its row, its entry among the notes between staves, the
+	// root the index found it under or a ledger line, the same way: rounded up.
+	static constexpr std::size_t kBytesPerMeasure{ 160 };
+	static constexpr std::size_t kBytesPerElement{ 128 };
+
+	// the most the last write held: every measure, the elements around the busiest part's staves on one
+	// system, and XmlWriter's buffer
+	std::size_t getMemoryBound() const { return m_boxes.size() * kBytesPerMeasure + m_mostElements * kBytesPerElement + kWriterBuffer; }
+
+	// the most elements the last write read at once
+	std::size_t getMostElements() const { return m_mostElements; }
+
+	std::size_t getPartCount() const { return m_parts.size(); }
+	std::size_t getMeasureCount() const { return m_measureCount; }
+	std::size_t getNoteCount() const { return m_notes; }
+
+private:
+	// Leland's ascender and the plain fonts', as MusicXmlImporter places glyphs and text by them
+	static constexpr float kLelandAscent{ 2.012f };
+	static constexpr float kPlainAscent{ 0.905f };
+
+	static constexpr std::size_t kWriterBuffer{ 64 * 1024 + 256 };
+
+	static constexpr int kDivisions{ 256 }; // to the quarter, so a 128th with three dots is still whole
+
+	// how close things have to be to go together, in staff spaces across and half spaces down
+	static constexpr float kCueScale{ 0.85f }; // smaller than this, to the staff, is a grace note
+	static constexpr float kChordReach{ 0.8f };
+	static constexpr float kAccidentalReach{ 2.4f };
+	static constexpr float kDotReach{ 4.5f };
+	static constexpr float kWordsAhead{ 0.25f }; // words level with a note go before it
+
+	enum class MarkKind : std::uint8_t
+	{
+		Glyph,
+		Words,
+	};
+
+	// A Symbol or Text by its origin: before place, x and y on the canvas and its size; after, where it is
+	// in the piece, x in staff spaces from the canvas's left and y in half spaces up from the bottom line.
+	struct Mark
+	{
+		std::uint32_t measure;
+		std::uint32_t staff; // in the part
+		float x;
+		float y;
+		float size; // to the staff's height, after place
+		std::uint32_t value; // the glyph, or the Text's handle
+		MarkKind kind;
+	};
+	static_assert(sizeof(Mark) <= 32, "kBytesPerElement counts a Mark as 32 bytes");
+
+	// one staff on one system, its measures in m_boxes from first, left to right
+	struct Row
+	{
+		float top;
+		float height;
+		std::size_t first;
+		std::size_t count;
+		std::uint32_t system;
+		std::uint32_t staff; // counted down the system
+	};
+	static_assert(sizeof(Bounds) <= 16 && sizeof(Row) <= 32, "kBytesPerMeasure counts a box as 16 bytes and a Row as 32");
+
+	// a horizontal Line, which is a ledger line if it's a space above or below a staff
+	struct Ledger
+	{
+		float y;
+		float left;
+		float right;
+	};
+
+	struct System
+	{
+		std::size_t firstRow;
+		std::uint32_t rows;
+		std::uint32_t firstMeasure;
+		std::uint32_t measures;
+	};
+
+	struct Part
+	{
+		std::uint32_t firstStaff;
+		std::uint32_t staves;
+		ShapeHandle name;
+	};
+
+	struct Clef
+	{
+		char sign{ 'G' };
+		int line{ 2 };
+		int octave{ 0 };
+
+		bool operator==(const Clef& other) const { return sign == other.sign && line == other.line && octave == other.octave; }
+		bool operator!=(const Clef& other) const { return !(*this == other); }
+	};
+
+	// what a staff shows at the start of a measure
+	struct Lead
+	{
+		bool hasClef{ false };
+		Clef clef;
+		int sharps{ 0 };
+		int flats{ 0 };
+		std::string beats;
+		std::string beatType;
+		wchar_t timeSymbol{ 0 };
+	};
+
+	enum class EventKind : std::uint8_t
+	{
+		Note,
+		Rest,
+		Clef,
+		Words,
+	};
+
+	// something in a staff's measure that takes its turn in the file
+	struct Event
+	{
+		EventKind kind;
+		std::uint32_t staff;
+		std::uint32_t mark;
+		float x;
+		float position;
+		int type{ 3 }; // 0 breve to 8 128th
+		int dots{ 0 };
+		int stem{ 0 }; // 0 not drawn, 1 up, 2 down
+		wchar_t accidental{ 0 };
+		bool grace{ false };
+		bool chord{ false };
+		Clef clef{};
+	};
+
+	// what a staff's notes are read against as the part goes
+	struct StaffState
+	{
+		Clef clef;
+		int fifths{ 0 };
+		std::vector<std::pair<int, int>> alters; // (step and octave, alter) for accidentals earlier in the measure
+	};
+
+	const char* m_error{ nullptr };
+
+	std::vector<Bounds> m_boxes; // every Measure on the canvas, by row, then left to right
+	std::vector<Row> m_rows; // top to bottom
+	std::vector<float> m_bands; // the y between each row and the next, which decides whose a mark is
+	std::vector<System> m_systems;
+	std::vector<Part> m_parts;
+	std::vector<std::uint32_t> m_partOf; // by staff
+	std::uint32_t m_staffCount{ 0 };
+	std::uint32_t m_measureCount{ 0 };
+	ShapeHandle m_title{ kNoShape };
+	std::vector<ShapeHandle> m_used; // the title and the part names, which aren't words
+	Bounds m_content{ Bounds::empty() };
+	std::size_t m_mostElements{ 0 };
+	std::size_t m_notes{ 0 };
+
+	// what collect last read
+	std::vector<ShapeHandle> m_roots;
+	std::vector<Mark> m_marks;
+	std::vector<Ledger> m_ledgers; // top to bottom
+
+	// the part being written
+	std::vector<StaffState> m_staves;
+	int m_beats{ 4 };
+	int m_beatType{ 4 };
+	wchar_t m_timeSymbol{ 0 };
+	std::vector<Lead> m_leads;
+	std::vector<Event> m_events;
+
+	bool fail(const char* error)
+	{
+		m_error = error;
+		return false;
+	}
+
+	// what takes a shape's points onto the canvas, through every group it's in
+	static Transform getCanvasTransform(const ShapeStore& elements, ShapeHandle shape)
+	{
+		Transform transform{ elements.getTransform(shape) };
+		for (ShapeHandle parent{ elements.getParent(shape) }; parent != kNoShape; parent = elements.getParent(parent))
+		{
+			transform = transform.then(elements.getTransform(parent));
+		}
+		return transform;
+	}
+
+	static SpatialIndex<ShapeHandle> indexRoots(const ShapeStore& elements)
+	{
+		SpatialIndex<ShapeHandle> index;
+		for (std::size_t i{ 0 }; i < elements.size(); ++i)
+		{
+			ShapeHandle shape{ elements.getHandle(i) };
+			if (elements.getParent(shape) == kNoShape)
+			{
+				index.insert(shape, elements.getBounds(shape));
+			}
+		}
+		return index;
+	}
+
+	// every Measure's box on the canvas, and how far the score reaches
+	void findMeasures(const ShapeStore& elements)
+	{
+		m_content = elements.getContentBounds();
+		for (std::size_t i{ 0 }; i < elements.size(); ++i)
+		{
+			ShapeHandle shape{ elements.getHandle(i) };
+			if (elements.getKind(shape) != ShapeKind::Measure)
+			{
+				continue;
+			}
+
+			const float* xy{ elements.getPoints(shape) };
+			Bounds box{ (std::min)(xy[0], xy[2]), (std::min)(xy[1], xy[3]), (std::max)(xy[0], xy[2]), (std::max)(xy[1], xy[3]) };
+			box = getCanvasTransform(elements, shape).map(box);
+			if (box.bottom > box.top && box.right > box.left)
+			{
+				m_boxes.push_back(box);
+			}
+		}
+	}
+
+	// Reads the Symbols and Text of the elements reaching the whole width of the score between top and
+	// bottom into m_marks, and their horizontal Lines into m_ledgers, in place of what was read before. The
+	// title and part names are left out.
+	void collect(const ShapeStore& elements, const SpatialIndex<ShapeHandle>& index, float top, float bottom)
+	{
+		m_marks.clear();
+		m_ledgers.clear();
+		index.query(Bounds{ m_content.left, top, m_content.right, bottom }, m_roots);
+
+		std::size_t read{ 0 };
+		for (ShapeHandle root : m_roots)
+		{
+			elements.forEachLeaf(root, [&](ShapeHandle leaf) {
+				++read;
+				ShapeKind kind{ elements.getKind(leaf) };
+				if (kind != ShapeKind::Symbol && kind != ShapeKind::Text && kind != ShapeKind::Line)
+				{
+					return;
+				}
+
+				Transform transform{ getCanvasTransform(elements, leaf) };
+				const float* xy{ elements.getPoints(leaf) };
+				if (kind == ShapeKind::Line)
+				{
+					float y0{ transform.mapY(xy[0], xy[1]) };
+					float y1{ transform.mapY(xy[2], xy[3]) };
+					float x0{ transform.mapX(xy[0], xy[1]) };
+					float x1{ transform.mapX(xy[2], xy[3]) };
+					if (std::abs(y1 - y0) < 0.5f)
+					{
+						m_ledgers.push_back(Ledger{ (y0 + y1) / 2.0f, (std::min)(x0, x1), (std::max)(x0, x1) });
+					}
+					return;
+				}
+
+				const std::wstring& text{ elements.getText(leaf) };
+				if (text.empty() || std::find(m_used.begin(), m_used.end(), leaf) != m_used.end())
+				{
+					return;
+				}
+
+				// back from the corner to the glyph's origin, or the text's baseline, as the importer put it
+				bool symbol{ kind == ShapeKind::Symbol };
+				float size{ xy[2] - xy[0] };
+				RenderPoint offset{ scoreTextOffset(static_cast<int>(std::lround(size))) };
+				float x{ xy[0] + offset.x + (symbol ? size / 6.0f : 0.0f) };
+				float y{ xy[1] + offset.y + size * (symbol ? kLelandAscent : kPlainAscent) };
+				float scale{ std::sqrt(std::abs(transform.a * transform.d - transform.b * transform.c)) };
+				m_marks.push_back(Mark{ 0, 0, transform.mapX(x, y), transform.mapY(x, y), size * scale,
+					symbol ? static_cast<std::uint32_t>(text[0]) : static_cast<std::uint32_t>(leaf), symbol ? MarkKind::Glyph : MarkKind::Words });
+			});
+		}
+		std::sort(m_ledgers.begin(), m_ledgers.end(), [](const Ledger& a, const Ledger& b) { return a.y < b.y; });
+		m_mostElements = (std::max)(m_mostElements, read);
+	}
+
+	// measures within half a space of the same top, and as tall, are one staff
+	void findStaves()
+	{
+		std::sort(m_boxes.begin(), m_boxes.end(), [](const Bounds& a, const Bounds& b) { return a.top != b.top ? a.top < b.top : a.left < b.left; });
+
+		std::size_t first{ 0 };
+		for (std::size_t i{ 1 }; i <= m_boxes.size(); ++i)
+		{
+			const Bounds& start{ m_boxes[first] };
+			float height{ start.bottom - start.top };
+			if (i < m_boxes.size() && m_boxes[i].top - start.top <= height / 8.0f && std::abs(m_boxes[i].bottom - m_boxes[i].top - height) <= height / 8.0f)
+			{
+				continue;
+			}
+
+			std::sort(m_boxes.begin() + first, m_boxes.begin() + i, [](const Bounds& a, const Bounds& b) { return a.left < b.left; });
+			m_rows.push_back(Row{ start.top, height, first, i - first, 0, 0 });
+			first = i;
+		}
+
+		for (std::size_t r{ 1 }; r < m_rows.size(); ++r)
+		{
+			m_bands.push_back((m_rows[r - 1].top + m_rows[r - 1].height + m_rows[r].top) / 2.0f);
+		}
+	}
+
+	// A staff joins the system above when its barlines line up with the last staff's, and it's no further
+	// below it than the system's staves are from each other; a wider gap, or an indent, starts a system. No
+	// system has more staves than the first, so later systems whose barlines happen to line up, as rows of
+	// measure rests do, stay apart.
+	void findSystems()
+	{
+		float spacing{ 0.0f };
+		for (std::size_t r{ 0 }; r < m_rows.size(); ++r)
+		{
+			Row& row{ m_rows[r] };
+			if (r > 0 && linedUp(m_rows[r - 1], row) && (m_systems.size() == 1 || m_systems.back().rows < m_systems.front().rows))
+			{
+				System& system{ m_systems.back() };
+				float gap{ row.top - m_rows[r - 1].top };
+				if (system.rows == 1 || gap <= spacing * 1.2f + 1.0f)
+				{
+					spacing = system.rows == 1 ? gap : spacing;
+					row.system = static_cast<std::uint32_t>(m_systems.size() - 1);
+					row.staff = system.rows++;
+					system.measures = (std::max)(system.measures, static_cast<std::uint32_t>(row.count));
+					continue;
+				}
+			}
+
+			spacing = 0.0f;
+			std::uint32_t firstMeasure{ m_systems.empty() ? 0u : m_systems.back().firstMeasure + m_systems.back().measures };
+			m_systems.push_back(System{ r, 1, firstMeasure, static_cast<std::uint32_t>(row.count) });
+			row.system = static_cast<std::uint32_t>(m_systems.size() - 1);
+			row.staff = 0;
+		}
+
+		const System& last{ m_systems.back() };
+		m_measureCount = last.firstMeasure + last.measures;
+		for (const System& system : m_systems)
+		{
+			m_staffCount = (std::max)(m_staffCount, system.rows);
+		}
+	}
+
+	bool linedUp(const Row& above, const Row& below) const
+	{
+		if (above.count != below.count)
+		{
+			return false;
+		}
+
+		float tolerance{ below.height / 4.0f };
+		for (std::size_t i{ 0 }; i < below.count; ++i)
+		{
+			const Bounds& a{ m_boxes[above.first + i] };
+			const Bounds& b{ m_boxes[below.first + i] };
+			if (std::abs(a.left - b.left) > tolerance || std::abs(a.right - b.right) > tolerance)
+			{
+				return false;
+			}
+		}
+		return true;
+	}
+
+	// Finds the title and the part names, and from where the names sit, which staves share a part. Every
+	// other staff is a part of its own. Both are read off what's above the first system and beside it.
+	void findParts(const ShapeStore& elements, const SpatialIndex<ShapeHandle>& index)
+	{
+		const System& first{ m_systems.front() };
+		const Row& top{ m_rows[first.firstRow] };
+		const Row& bottom{ m_rows[first.firstRow + first.rows - 1] };
+		float left{ m_boxes[top.first].left };
+		float title{ (std::numeric_limits<float>::max)() };
+		collect(elements, index, m_content.top, bottom.top + bottom.height * 3.0f);
+
+		std::vector<ShapeHandle> names(m_staffCount, kNoShape);
+		std::vector<std::uint8_t> joined(m_staffCount, 0); // the staff shares a part with the next
+		for (const Mark& mark : m_marks)
+		{
+			if (mark.kind != MarkKind::Words)
+			{
+				continue;
+			}
+
+			if (mark.y < top.top - top.height)
+			{
+				// the highest text well above the first staff
+				if (mark.y < title)
+				{
+					title = mark.y;
+					m_title = static_cast<ShapeHandle>(mark.value);
+				}
+				continue;
+			}
+			if (mark.x >= left || mark.y > bottom.top + bottom.height * 2.0f)
+			{
+				continue;
+			}
+
+			// a name's middle is a third of its size above its baseline
+			float middle{ mark.y - mark.size / 3.0f };
+			for (std::uint32_t staff{ 0 }; staff < first.rows; ++staff)
+			{
+				const Row& row{ m_rows[first.firstRow + staff] };
+				float space{ row.height / 4.0f };
+				if (middle >= row.top - space && middle <= row.top + row.height + space)
+				{
+					names[staff] = static_cast<ShapeHandle>(mark.value);
+					m_used.push_back(names[staff]);
+					break;
+				}
+				if (staff + 1 < first.rows && middle > row.top + row.height && middle < m_rows[first.firstRow + staff + 1].top)
+				{
+					names[staff] = static_cast<ShapeHandle>(mark.value);
+					joined[staff] = 1;
+					m_used.push_back(names[staff]);
+					break;
+				}
+			}
+		}
+		if (m_title != kNoShape)
+		{
+			m_used.push_back(m_title);
+		}
+
+		m_partOf.resize(m_staffCount);
+		for (std::uint32_t staff{ 0 }; staff < m_staffCount; ++staff)
+		{
+			bool grand{ joined[staff] != 0 && staff + 1 < m_staffCount };
+			m_parts.push_back(Part{ staff, grand ? 2u : 1u, names[staff] });
+			m_partOf[staff] = static_cast<std::uint32_t>(m_parts.size() - 1);
+			if (grand)
+			{
+				m_partOf[++staff] = static_cast<std::uint32_t>(m_parts.size() - 1);
+			}
+		}
+	}
+
+	// the staff nearest y
+	std::size_t getBand(float y) const { return static_cast<std::size_t>(std::upper_bound(m_bands.begin(), m_bands.end(), y) - m_bands.begin()); }
+
+	// whether y is between two staves, and if so the upper one
+	bool getGap(float y, std::size_t& upper) const
+	{
+		std::size_t row{ getBand(y) };
+		if (row > 0 && y < m_rows[row].top)
+		{
+			upper = row - 1;
+			return true;
+		}
+		if (row + 1 < m_rows.size() && y > m_rows[row].top + m_rows[row].height)
+		{
+			upper = row;
+			return true;
+		}
+		return false;
+	}
+
+	bool hasLedger(float y, float x, float tolerance) const
+	{
+		auto ledger{ std::lower_bound(m_ledgers.begin(), m_ledgers.end(), y - tolerance, [](const Ledger& a, float b) { return a.y < b; }) };
+		for (; ledger != m_ledgers.end() && ledger->y <= y + tolerance; ++ledger)
+		{
+			if (ledger->left <= x && x <= ledger->right)
+			{
+				return true;
+			}
+		}
+		return false;
+	}
+
+	// how many ledger lines lead from row's staff out to a note at (x, y), or 0 if any it would need there
+	// is missing
+	int countLedgers(const Row& row, float x, float y) const
+	{
+		float half{ row.height / 8.0f };
+		float bottom{ row.top + row.height };
+		float position{ (bottom - y) / half };
+		float inner{ position > 8.0f ? 10.0f : -2.0f };
+		float outer{ position > 8.0f ? 2.0f * std::floor(position / 2.0f + 0.1f) : 2.0f * std::ceil(position / 2.0f - 0.1f) };
+		float step{ position > 8.0f ? 2.0f : -2.0f };
+		int count{ 0 };
+		for (float line{ inner }; step > 0.0f ? line <= outer : line >= outer; line += step)
+		{
+			if (!hasLedger(bottom - line * half, x, half / 2.0f))
+			{
+				return 0;
+			}
+			++count;
+		}
+		return count;
+	}
+
+	// Which staff each mark is on. One between two staves could be either's: a note just off one staff is
+	// that staff's, one further out goes with the staff its ledger lines lead back to, and an accidental or
+	// dot goes with the note it's beside. The rest go to the nearest staff. A note a ledger line or two off
+	// one staff can be at the end of a longer run from the other, which passes those same lines; the longer
+	// run wins, as the lines between couldn't be there otherwise.
+	std::vector<std::uint32_t> findRows() const
+	{
+		std::vector<std::uint32_t> rows(m_marks.size());
+		std::vector<std::pair<std::size_t, std::size_t>> between; // notes in a gap as (upper row, mark), by gap then x
+		for (std::size_t i{ 0 }; i < m_marks.size(); ++i)
+		{
+			const Mark& mark{ m_marks[i] };
+			rows[i] = static_cast<std::uint32_t>(getBand(mark.y));
+
+			int type;
+			int stem;
+			std::size_t upper;
+			if (mark.kind == MarkKind::Glyph && noteOf(static_cast<wchar_t>(mark.value), type, stem) && getGap(mark.y, upper))
+			{
+				const Row& above{ m_rows[upper] };
+				const Row& below{ m_rows[upper + 1] };
+				float space{ below.height / 4.0f };
+				bool up{ mark.y >= below.top - space * 0.6f };
+				bool down{ mark.y <= above.top + above.height + space * 0.6f };
+				if (!up && !down)
+				{
+					int fromBelow{ countLedgers(below, mark.x + space / 2.0f, mark.y) };
+					int fromAbove{ countLedgers(above, mark.x + space / 2.0f, mark.y) };
+					up = fromBelow > fromAbove;
+					down = fromAbove > fromBelow;
+				}
+				if (up != down)
+				{
+					rows[i] = static_cast<std::uint32_t>(up ? upper + 1 : upper);
+				}
+				between.emplace_back(upper, i);
+			}
+		}
+		if (between.empty())
+		{
+			return rows;
+		}
+
+		auto before{ [this](const std::pair<std::size_t, std::size_t>& a, const std::pair<std::size_t, float>& b) {
+			return a.first != b.first ? a.first < b.first : m_marks[a.second].x < b.second;
+		} };
+		std::sort(between.begin(), between.end(), [this, &before](const auto& a, const auto& b) { return before(a, { b.first, m_marks[b.second].x }); });
+		for (std::size_t i{ 0 }; i < m_marks.size(); ++i)
+		{
+			const Mark& mark{ m_marks[i] };
+			int type;
+			int stem;
+			std::size_t upper;
+			if (mark.kind != MarkKind::Glyph || noteOf(static_cast<wchar_t>(mark.value), type, stem) || !getGap(mark.y, upper))
+			{
+				continue;
+			}
+
+			float space{ m_rows[upper + 1].height / 4.0f };
+			auto note{ std::lower_bound(between.begin(), between.end(), std::pair<std::size_t, float>{ upper, mark.x - kDotReach * space }, before) };
+			float nearest{ (std::numeric_limits<float>::max)() };
+			for (; note != between.end() && note->first == upper && m_marks[note->second].x <= mark.x + kAccidentalReach * space; ++note)
+			{
+				const Mark& other{ m_marks[note->second] };
+				float dx{ std::abs(other.x - mark.x) };
+				if (std::abs(other.y - mark.y) <= space && dx < nearest)
+				{
+					nearest = dx;
+					rows[i] = rows[note->second];
+				}
+			}
+		}
+		return rows;
+	}
+
+	// Keeps the marks on rows first to last, which collect read with the staves either side, giving each its
+	// staff, measure and place on the staff, and sorts them into the file's order.
+	void place(std::size_t first, std::size_t last)
+	{
+		std::vector<std::uint32_t> rows{ findRows() };
+		std::size_t kept{ 0 };
+		for (std::size_t i{ 0 }; i < m_marks.size(); ++i)
+		{
+			if (rows[i] < first || rows[i] > last)
+			{
+				continue;
+			}
+
+			Mark& mark{ m_marks[kept++] = m_marks[i] };
+			const Row& row{ m_rows[rows[i]] };
+			auto boxes{ m_boxes.begin() + static_cast<std::ptrdiff_t>(row.first) };
+			auto right{ std::upper_bound(boxes, boxes + static_cast<std::ptrdiff_t>(row.count), mark.x, [](float x, const Bounds& box) { return x < box.left; }) };
+			std::uint32_t column{ right == boxes ? 0u : static_cast<std::uint32_t>(right - boxes - 1) };
+
+			float space{ row.height / 4.0f };
+			mark.staff = row.staff - m_parts[m_partOf[row.staff]].firstStaff;
+			mark.measure = m_systems[row.system].firstMeasure + column;
+			mark.x /= space;
+			mark.y = (row.top + row.height - mark.y) / (space / 2.0f);
+			mark.size /= row.height;
+		}
+
+		m_marks.resize(kept);
+		std::stable_sort(m_marks.begin(), m_marks.end(), [](const Mark& a, const Mark& b) {
+			if (a.measure != b.measure) return a.measure < b.measure;
+			if (a.staff != b.staff) return a.staff < b.staff;
+			return a.x != b.x ? a.x < b.x : a.y < b.y;
+		});
+	}
+
+	bool startsSystem(std::uint32_t measure) const
+	{
+		auto after{ std::upper_bound(m_systems.begin(), m_systems.end(), measure, [](std::uint32_t m, const System& system) { return m < system.firstMeasure; }) };
+		return after != m_systems.begin() && (after - 1)->firstMeasure == measure;
+	}
+
+	void writeScore(const ShapeStore& elements, const SpatialIndex<ShapeHandle>& index, XmlWriter& writer)
+	{
+		writer.raw(R"(<?xml version="1.0" encoding="UTF-8" standalone="no"?>)");
+		writer.raw("\n<!DOCTYPE score-partwise PUBLIC \"-//Recordare//DTD MusicXML 4.0 Partwise//EN\" \"http://www.musicxml.org/dtds/partwise.dtd\">");
+		writer.start("score-partwise");
+		writer.attribute("version", "4.0");
+
+		if (m_title != kNoShape)
+		{
+			writer.start("work");
+			writer.element("work-title", narrow(elements.getText(m_title)));
+			writer.end();
+		}
+
+		writer.start("identification");
+		writer.start("encoding");
+		writer.element("software", "Simple Score");
+		writer.end();
+		writer.end();
+
+		writer.start("part-list");
+		for (std::size_t p{ 0 }; p < m_parts.size(); ++p)
+		{
+			writer.start("score-part");
+			writer.attribute("id", partId(p));
+			writer.element("part-name", m_parts[p].name == kNoShape ? std::string() : narrow(elements.getText(m_parts[p].name)));
+			writer.end();
+		}
+		writer.end();
+
+		for (std::size_t p{ 0 }; p < m_parts.size(); ++p)
+		{
+			writer.start("part");
+			writer.attribute("id", partId(p));
+
+			const Part& part{ m_parts[p] };
+			m_staves.assign(part.staves, StaffState());
+			m_beats = 4;
+			m_beatType = 4;
+			m_timeSymbol = 0;
+			for (const System& system : m_systems)
+			{
+				// the part's staves on this system, and the gaps either side, which hold marks of theirs; half
+				// a staff into the next staves covers marks whose bounds start beyond their origin
+				std::size_t first{ system.firstRow + part.firstStaff };
+				std::size_t last{ (std::min)(first + part.staves, system.firstRow + system.rows) };
+				m_marks.clear();
+				if (first < last)
+				{
+					float top{ first > 0 ? m_rows[first - 1].top + m_rows[first - 1].height / 2.0f : m_content.top };
+					float bottom{ last < m_rows.size() ? m_rows[last].top + m_rows[last].height / 2.0f : m_content.bottom };
+					collect(elements, index, top, bottom);
+					place(first, last - 1);
+				}
+
+				std::size_t at{ 0 };
+				for (std::uint32_t measure{ system.firstMeasure }; measure < system.firstMeasure + system.measures; ++measure)
+				{
+					std::size_t end{ at };
+					while (end < m_marks.size() && m_marks[end].measure == measure)
+					{
+						++end;
+					}
+					writeMeasure(elements, writer, static_cast<std::uint32_t>(p), measure, at, end);
+					at = end;
+				}
+			}
+			writer.end();
+		}
+		writer.end();
+	}
+
+	static std::string partId(std::size_t part) { return "P" + std::to_string(part + 1); }
+
+	void writeMeasure(const ShapeStore& elements, XmlWriter& writer, std::uint32_t part, std::uint32_t measure, std::size_t first, std::size_t last)
+	{
+		std::uint32_t staves{ m_parts[part].staves };
+		m_leads.assign(staves, Lead());
+		m_events.clear();
+		for (std::size_t i{ first }; i < last;)
+		{
+			std::size_t end{ i };
+			while (end < last && m_marks[end].staff == m_marks[i].staff)
+			{
+				++end;
+			}
+			readStaff(m_marks[i].staff, i, end);
+			i = end;
+		}
+
+		writer.start("measure");
+		writer.attribute("number", static_cast<long long>(measure) + 1);
+		bool newSystem{ startsSystem(measure) };
+		if (newSystem && measure > 0)
+		{
+			writer.start("print");
+			writer.attribute("new-system", "yes");
+			writer.end();
+		}
+		writeAttributes(writer, measure, staves, newSystem);
+
+		int measureLength{ (std::max)(1, m_beats * kDivisions * 4 / m_beatType) };
+		int elapsed{ 0 };
+		std::uint32_t staff{ 0 };
+		for (std::size_t e{ 0 }; e < m_events.size(); ++e)
+		{
+			const Event& event{ m_events[e] };
+			if (event.staff != staff)
+			{
+				staff = event.staff;
+				if (elapsed > 0)
+				{
+					writer.start("backup");
+					writer.element("duration", elapsed);
+					writer.end();
+				}
+				elapsed = 0;
+			}
+
+			switch (event.kind)
+			{
+			case EventKind::Note:
+			case EventKind::Rest:
+				elapsed += writeNote(writer, event, staves, measureLength, isWholeRest(e));
+				break;
+			case EventKind::Clef:
+				if (event.clef != m_staves[staff].clef)
+				{
+					m_staves[staff].clef = event.clef;
+					writer.start("attributes");
+					writeClef(writer, event.clef, staff, staves);
+					writer.end();
+				}
+				break;
+			case EventKind::Words:
+				writer.start("direction");
+				writer.attribute("placement", event.position > 4.0f ? "above" : "below");
+				writer.start("direction-type");
+				writer.element("words", narrow(elements.getText(static_cast<ShapeHandle>(m_marks[event.mark].value))));
+				writer.end();
+				if (staves > 1)
+				{
+					writer.element("staff", static_cast<long long>(staff) + 1);
+				}
+				writer.end();
+				break;
+			}
+		}
+		for (StaffState& state : m_staves)
+		{
+			state.alters.clear();
+		}
+		writer.end();
+	}
+
+	// sorts a staff's marks in one measure into its lead and its events
+	void readStaff(std::uint32_t staff, std::size_t first, std::size_t last)
+	{
+		std::size_t firstEvent{ m_events.size() };
+		float firstX{ (std::numeric_limits<float>::max)() };
+		for (std::size_t i{ first }; i < last; ++i)
+		{
+			const Mark& mark{ m_marks[i] };
+			Event event{ EventKind::Words, staff, static_cast<std::uint32_t>(i), mark.x, mark.y };
+			if (mark.kind == MarkKind::Words)
+			{
+				event.x -= kWordsAhead;
+				m_events.push_back(event);
+				continue;
+			}
+
+			wchar_t glyph{ static_cast<wchar_t>(mark.value) };
+			if (noteOf(glyph, event.type, event.stem))
+			{
+				event.kind = EventKind::Note;
+				event.position = std::round(mark.y);
+				event.grace = mark.size < kCueScale;
+			}
+			else if (restOf(glyph, event.type))
+			{
+				event.kind = EventKind::Rest;
+				event.position = std::round(mark.y);
+				event.grace = mark.size < kCueScale;
+			}
+			else
+			{
+				continue;
+			}
+			m_events.push_back(event);
+			firstX = (std::min)(firstX, event.x);
+		}
+
+		Lead& lead{ m_leads[staff] };
+		for (std::size_t i{ first }; i < last; ++i)
+		{
+			const Mark& mark{ m_marks[i] };
+			if (mark.kind != MarkKind::Glyph)
+			{
+				continue;
+			}
+
+			wchar_t glyph{ static_cast<wchar_t>(mark.value) };
+			Clef clef;
+			if (int alter; alterOf(glyph, alter))
+			{
+				if (Event* note{ findAccidentalNote(mark, firstEvent) })
+				{
+					note->accidental = glyph;
+				}
+				else if (mark.x < firstX)
+				{
+					lead.sharps += glyph == 0xE262 ? 1 : 0;
+					lead.flats += glyph == 0xE260 ? 1 : 0;
+				}
+			}
+			else if (glyph == 0xE1E7)
+			{
+				if (Event* note{ findDottedNote(mark, firstEvent) })
+				{
+					++note->dots;
+				}
+			}
+			else if (clefOf(glyph, std::round(mark.y), clef))
+			{
+				if (mark.x < firstX && mark.size >= kCueScale)
+				{
+					lead.hasClef = true;
+					lead.clef = clef;
+				}
+				else
+				{
+					Event event{ EventKind::Clef, staff, static_cast<std::uint32_t>(i), mark.x, mark.y };
+					event.clef = clef;
+					m_events.push_back(event);
+				}
+			}
+			else if (mark.x < firstX && glyph >= 0xE080 && glyph <= 0xE089)
+			{
+				(mark.y > 4.0f ? lead.beats : lead.beatType) += static_cast<char>('0' + (glyph - 0xE080));
+			}
+			else if (mark.x < firstX && (glyph == 0xE08A || glyph == 0xE08B))
+			{
+				lead.timeSymbol = glyph;
+			}
+		}
+
+		auto events{ m_events.begin() + static_cast<std::ptrdiff_t>(firstEvent) };
+		std::stable_sort(events, m_events.end(), [](const Event& a, const Event& b) { return a.x < b.x; });
+
+		// notes level with the one before, and the same size, are a chord with it
+		const Event* previous{ nullptr };
+		for (auto event{ events }; event != m_events.end(); ++event)
+		{
+			if (event->kind != EventKind::Note && event->kind != EventKind::Rest)
+			{
+				continue;
+			}
+			event->chord = event->kind == EventKind::Note && previous && previous->kind == EventKind::Note
+				&& previous->grace == event->grace && event->x - previous->x < kChordReach;
+			previous = &*event;
+		}
+	}
+
+	// the nearest note an accidental is just before, on the same line or space
+	Event* findAccidentalNote(const Mark& mark, std::size_t firstEvent)
+	{
+		Event* found{ nullptr };
+		for (std::size_t e{ firstEvent }; e < m_events.size(); ++e)
+		{
+			Event& event{ m_events[e] };
+			float dx{ event.x - mark.x };
+			if (event.kind == EventKind::Note && std::abs(event.position - mark.y) < 0.5f && dx > 0.0f && dx <= kAccidentalReach
+				&& (!found || dx < found->x - mark.x))
+			{
+				found = &event;
+			}
+		}
+		return found;
+	}
+
+	// The nearest note or rest a dot is after, preferring one whose line or space the dot is in or above,
+	// and one without dots yet, since notes a step apart in a chord share the space their dots go in.
+	Event* findDottedNote(const Mark& mark, std::size_t firstEvent)
+	{
+		Event* found{ nullptr };
+		float best{ (std::numeric_limits<float>::max)() };
+		for (std::size_t e{ firstEvent }; e < m_events.size(); ++e)
+		{
+			Event& event{ m_events[e] };
+			float dx{ mark.x - event.x };
+			float dy{ mark.y - event.position };
+			if ((event.kind == EventKind::Note || event.kind == EventKind::Rest) && dx > 0.0f && dx <= kDotReach && std::abs(dy) <= 1.5f)
+			{
+				float cost{ dx + (dy >= -0.25f && dy <= 1.25f ? 0.0f : kDotReach) + kChordReach * static_cast<float>(event.dots) };
+				if (cost < best)
+				{
+					best = cost;
+					found = &event;
+				}
+			}
+		}
+		return found;
+	}
+
+	// a rest alone in its staff's measure, and a whole rest, fills the measure whatever its time
+	bool isWholeRest(std::size_t e) const
+	{
+		const Event& event{ m_events[e] };
+		if (event.kind != EventKind::Rest || event.type != 1 || event.grace)
+		{
+			return false;
+		}
+
+		for (const Event& other : m_events)
+		{
+			if (&other != &event && other.staff == event.staff && (other.kind == EventKind::Note || other.kind == EventKind::Rest) && !other.grace)
+			{
+				return false;
+			}
+		}
+		return true;
+	}
+
+	// The clef, key and time where they change. A system's first measure always shows its clef and key, so
+	// one that shows no key there has gone back to none.
+	void writeAttributes(XmlWriter& writer, std::uint32_t measure, std::uint32_t staves, bool newSystem)
+	{
+		bool first{ measure == 0 };
+		std::vector<int> keys(staves);
+		bool keyChanged{ first };
+		bool keysDiffer{ false };
+		for (std::uint32_t s{ 0 }; s < staves; ++s)
+		{
+			const Lead& lead{ m_leads[s] };
+			bool shown{ lead.sharps > 0 || lead.flats > 0 };
+			keys[s] = shown ? (lead.sharps >= lead.flats ? lead.sharps : -lead.flats) : newSystem ? 0 : m_staves[s].fifths;
+			keyChanged = keyChanged || keys[s] != m_staves[s].fifths;
+			keysDiffer = keysDiffer || keys[s] != keys[0];
+		}
+
+		int beats{ m_beats };
+		int beatType{ m_beatType };
+		wchar_t symbol{ m_timeSymbol };
+		bool timeShown{ false };
+		for (const Lead& lead : m_leads)
+		{
+			if (lead.timeSymbol != 0)
+			{
+				beats = lead.timeSymbol == 0xE08A ? 4 : 2;
+				beatType = beats;
+				symbol = lead.timeSymbol;
+				timeShown = true;
+				break;
+			}
+			int top{ toInt(lead.beats) };
+			int bottom{ toInt(lead.beatType) };
+			if (top > 0 && bottom > 0)
+			{
+				beats = top;
+				beatType = bottom;
+				symbol = 0;
+				timeShown = true;
+				break;
+			}
+		}
+		bool timeChanged{ first || (timeShown && (beats != m_beats || beatType != m_beatType || symbol != m_timeSymbol)) };
+
+		bool clefChanged{ first };
+		for (std::uint32_t s{ 0 }; s < staves; ++s)
+		{
+			clefChanged = clefChanged || (m_leads[s].hasClef && m_leads[s].clef != m_staves[s].clef);
+		}
+
+		if (!keyChanged && !timeChanged && !clefChanged)
+		{
+			return;
+		}
+
+		writer.start("attributes");
+		if (first)
+		{
+			writer.element("divisions", kDivisions);
+		}
+		if (keyChanged)
+		{
+			for (std::uint32_t s{ 0 }; s < (keysDiffer ? staves : 1u); ++s)
+			{
+				writer.start("key");
+				if (keysDiffer)
+				{
+					writer.attribute("number", static_cast<long long>(s) + 1);
+				}
+				writer.element("fifths", keys[s]);
+				writer.end();
+			}
+			for (std::uint32_t s{ 0 }; s < staves; ++s)
+			{
+				m_staves[s].fifths = keysDiffer ? keys[s] : keys[0];
+			}
+		}
+		if (timeChanged)
+		{
+			writer.start("time");
+			if (symbol != 0)
+			{
+				writer.attribute("symbol", symbol == 0xE08A ? "common" : "cut");
+			}
+			if (!timeShown)
+			{
+				writer.attribute("print-object", "no");
+			}
+			writer.element("beats", beats);
+			writer.element("beat-type", beatType);
+			writer.end();
+			m_beats = beats;
+			m_beatType = beatType;
+			m_timeSymbol = symbol;
+		}
+		if (first && staves > 1)
+		{
+			writer.element("staves", staves);
+		}
+		for (std::uint32_t s{ 0 }; s < staves; ++s)
+		{
+			if (first || (m_leads[s].hasClef && m_leads[s].clef != m_staves[s].clef))
+			{
+				if (m_leads[s].hasClef)
+				{
+					m_staves[s].clef = m_leads[s].clef;
+				}
+				writeClef(writer, m_staves[s].clef, s, staves);
+			}
+		}
+		writer.end();
+	}
+
+	static void writeClef(XmlWriter& writer, const Clef& clef, std::uint32_t staff, std::uint32_t staves)
+	{
+		writer.start("clef");
+		if (staves > 1)
+		{
+			writer.attribute("number", static_cast<long long>(staff) + 1);
+		}
+		writer.element("sign", clef.sign == 'P' ? std::string("percussion") : clef.sign == 'T' ? std::string("TAB") : std::string(1, clef.sign));
+		if (clef.sign != 'P')
+		{
+			writer.element("line", clef.line);
+		}
+		if (clef.octave != 0)
+		{
+			writer.element("clef-octave-change", clef.octave);
+		}
+		writer.end();
+	}
+
+	// writes a note or rest and returns how far it moves the time on
+	int writeNote(XmlWriter& writer, const Event& event, std::uint32_t staves, int measureLength, bool wholeRest)
+	{
+		StaffState& state{ m_staves[event.staff] };
+		int duration{ wholeRest ? measureLength : durationOf(event.type, event.dots) };
+		++m_notes;
+
+		writer.start("note");
+		if (event.grace)
+		{
+			writer.empty("grace");
+		}
+		if (event.chord)
+		{
+			writer.empty("chord");
+		}
+
+		int step;
+		int octave;
+		pitchOf(static_cast<int>(event.position), state.clef, step, octave);
+		if (event.kind == EventKind::Rest)
+		{
+			writer.start("rest");
+			if (wholeRest)
+			{
+				writer.attribute("measure", "yes");
+			}
+			if (event.position != (event.type <= 1 ? 6.0f : 4.0f))
+			{
+				writer.element("display-step", std::string(1, "CDEFGAB"[step]));
+				writer.element("display-octave", octave);
+			}
+			writer.end();
+		}
+		else if (state.clef.sign == 'P' || state.clef.sign == 'T')
+		{
+			writer.start("unpitched");
+			writer.element("display-step", std::string(1, "CDEFGAB"[step]));
+			writer.element("display-octave", octave);
+			writer.end();
+		}
+		else
+		{
+			// an accidental lasts the rest of the measure on its line or space; otherwise the key decides
+			int pitch{ octave * 7 + step };
+			int alter{ keyAlter(state.fifths, step) };
+			auto earlier{ std::find_if(state.alters.begin(), state.alters.end(), [&](const std::pair<int, int>& a) { return a.first == pitch; }) };
+			if (event.accidental != 0)
+			{
+				alterOf(event.accidental, alter);
+				if (earlier != state.alters.end())
+				{
+					earlier->second = alter;
+				}
+				else
+				{
+					state.alters.emplace_back(pitch, alter);
+				}
+			}
+			else if (earlier != state.alters.end())
+			{
+				alter = earlier->second;
+			}
+
+			writer.start("pitch");
+			writer.element("step", std::string(1, "CDEFGAB"[step]));
+			if (alter != 0)
+			{
+				writer.element("alter", alter);
+			}
+			writer.element("octave", octave);
+			writer.end();
+		}
+
+		if (!event.grace)
+		{
+			writer.element("duration", duration);
+		}
+		writer.element("voice", static_cast<long long>(event.staff) + 1);
+		if (!wholeRest)
+		{
+			static constexpr const char* kTypes[]{ "breve", "whole", "half", "quarter", "eighth", "16th", "32nd", "64th", "128th" };
+			writer.element("type", kTypes[event.type]);
+			for (int dot{ 0 }; dot < event.dots; ++dot)
+			{
+				writer.empty("dot");
+			}
+		}
+		if (event.accidental != 0)
+		{
+			writer.element("accidental", accidentalName(event.accidental));
+		}
+		if (event.stem != 0)
+		{
+			writer.element("stem", event.stem == 2 ? "down" : "up");
+		}
+		if (staves > 1)
+		{
+			writer.element("staff", static_cast<long long>(event.staff) + 1);
+		}
+		writer.end();
+
+		return event.grace || event.chord ? 0 : duration;
+	}
+
+	static int durationOf(int type, int dots)
+	{
+		int value{ kDivisions * 8 >> type };
+		int duration{ value };
+		for (int dot{ 0 }; dot < (std::min)(dots, 3); ++dot)
+		{
+			value /= 2;
+			duration += value;
+		}
+		return duration;
+	}
+
+	// The line or space back to a step and octave, undoing MusicXmlImporter::positionOf; unpitched clefs
+	// read as treble.
+	static void pitchOf(int position, const Clef& clef, int& step, int& octave)
+	{
+		int reference{ clef.sign == 'F' ? 24 : clef.sign == 'C' ? 28 : 32 };
+		int line{ clef.sign == 'P' || clef.sign == 'T' ? 2 : clef.line };
+		int pitch{ position + reference + 7 * clef.octave - 2 * (line - 1) };
+		octave = pitch >= 0 ? pitch / 7 : (pitch - 6) / 7;
+		step = pitch - 7 * octave;
+	}
+
+	// the alter the key gives a step: sharps from F up in fifths, flats from B down
+	static int keyAlter(int fifths, int step)
+	{
+		static constexpr int kSharpOrder[7]{ 3, 0, 4, 1, 5, 2, 6 };
+		static constexpr int kFlatOrder[7]{ 6, 2, 5, 1, 4, 0, 3 };
+		for (int i{ 0 }; i < (std::min)(std::abs(fifths), 7); ++i)
+		{
+			if ((fifths > 0 ? kSharpOrder[i] : kFlatOrder[i]) == step)
+			{
+				return fifths > 0 ? 1 : -1;
+			}
+		}
+		return 0;
+	}
+
+	// SMuFL's precomposed notes and bare noteheads; false for anything else
+	static bool noteOf(wchar_t glyph, int& type, int& stem)
+	{
+		stem = 0;
+		if (glyph == 0xE1D0 || glyph == 0xE1D1 || glyph == 0xE0A0 || glyph == 0xE0A1)
+		{
+			type = 0;
+		}
+		else if (glyph == 0xE1D2 || glyph == 0xE0A2)
+		{
+			type = 1;
+		}
+		else if (glyph >= 0xE1D3 && glyph <= 0xE1E6)
+		{
+			type = (std::min)(8, 2 + (glyph - 0xE1D3) / 2);
+			stem = (glyph - 0xE1D3) % 2 == 0 ? 1 : 2;
+		}
+		else if (glyph == 0xE0A3 || glyph == 0xE0A4)
+		{
+			type = glyph == 0xE0A3 ? 2 : 3;
+		}
+		else
+		{
+			return false;
+		}
+		return true;
+	}
+
+	// maxima to 1024th rests, the ones past either end of MusicXML's types counted as the nearest
+	static bool restOf(wchar_t glyph, int& type)
+	{
+		if (glyph < 0xE4E0 || glyph > 0xE4EF)
+		{
+			return false;
+		}
+		type = (std::max)(0, (std::min)(8, static_cast<int>(glyph) - 0xE4E2));
+		return true;
+	}
+
+	static bool alterOf(wchar_t glyph, int& alter)
+	{
+		switch (glyph)
+		{
+		case 0xE260: alter = -1; return true;
+		case 0xE261: alter = 0; return true;
+		case 0xE262: alter = 1; return true;
+		case 0xE263: alter = 2; return true;
+		case 0xE264: alter = -2; return true;
+		default: return false;
+		}
+	}
+
+	static const char* accidentalName(wchar_t glyph)
+	{
+		switch (glyph)
+		{
+		case 0xE260: return "flat";
+		case 0xE261: return "natural";
+		case 0xE262: return "sharp";
+		case 0xE263: return "double-sharp";
+		default: return "flat-flat";
+		}
+	}
+
+	// the clef a glyph drawn at position is; G, F and C clefs sit on the line they name
+	static bool clefOf(wchar_t glyph, float position, Clef& clef)
+	{
+		int line{ static_cast<int>(std::lround(position / 2.0f)) + 1 };
+		switch (glyph)
+		{
+		case 0xE050: clef = Clef{ 'G', line, 0 }; return true;
+		case 0xE051: clef = Clef{ 'G', line, -2 }; return true;
+		case 0xE052: clef = Clef{ 'G', line, -1 }; return true;
+		case 0xE053: clef = Clef{ 'G', line, 1 }; return true;
+		case 0xE054: clef = Clef{ 'G', line, 2 }; return true;
+		case 0xE05C: clef = Clef{ 'C', line, 0 }; return true;
+		case 0xE062: clef = Clef{ 'F', line, 0 }; return true;
+		case 0xE063: clef = Clef{ 'F', line, -2 }; return true;
+		case 0xE064: clef = Clef{ 'F', line, -1 }; return true;
+		case 0xE065: clef = Clef{ 'F', line, 1 }; return true;
+		case 0xE066: clef = Clef{ 'F', line, 2 }; return true;
+		case 0xE069:
+		case 0xE06A: clef = Clef{ 'P', 3, 0 }; return true;
+		case 0xE06D: clef = Clef{ 'T', 5, 0 }; return true;
+		default: return false;
+		}
+	}
+
+	static int toInt(const std::string& digits)
+	{
+		int value{ 0 };
+		for (char digit : digits)
+		{
+			value = (std::min)(value * 10 + (digit - '0'), 100000);
+		}
+		return value;
+	}
+
+	// wchar_t, UTF-16 where it's 16 bits, to UTF-8; unpaired surrogates become U+FFFD
+	static std::string narrow(const std::wstring& wide)
+	{
+		std::string utf8;
+		utf8.reserve(wide.size());
+		for (std::size_t i{ 0 }; i < wide.size(); ++i)
+		{
+			std::uint32_t codePoint{ static_cast<std::uint32_t>(wide[i]) };
+			if (codePoint >= 0xD800 && codePoint <= 0xDBFF && i + 1 < wide.size() && static_cast<std::uint32_t>(wide[i + 1]) >= 0xDC00 && static_cast<std::uint32_t>(wide[i + 1]) <= 0xDFFF)
+			{
+				codePoint = 0x10000 + ((codePoint - 0xD800) << 10) + (static_cast<std::uint32_t>(wide[++i]) - 0xDC00);
+			}
+			else if ((codePoint >= 0xD800 && codePoint <= 0xDFFF) || codePoint > 0x10FFFF)
+			{
+				codePoint = 0xFFFD;
+			}
+
+			if (codePoint < 0x80)
+			{
+				utf8 += static_cast<char>(codePoint);
+			}
+			else if (codePoint < 0x800)
+			{
+				utf8 += static_cast<char>(0xC0 | (codePoint >> 6));
+				utf8 += static_cast<char>(0x80 | (codePoint & 0x3F));
+			}
+			else if (codePoint < 0x10000)
+			{
+				utf8 += static_cast<char>(0xE0 | (codePoint >> 12));
+				utf8 += static_cast<char>(0x80 | ((codePoint >> 6) & 0x3F));
+				utf8 += static_cast<char>(0x80 | (codePoint & 0x3F));
+			}
+			else
+			{
+				utf8 += static_cast<char>(0xF0 | (codePoint >> 18));
+				utf8 += static_cast<char>(0x80 | ((codePoint >> 12) & 0x3F));
+				utf8 += static_cast<char>(0x80 | ((codePoint >> 6) & 0x3F));
+				utf8 += static_cast<char>(0x80 | (codePoint & 0x3F));
+			}
+		}
+		return utf8;
+	}
+};
@@ -0,0 +1,1381 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <istream>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include "RenderBackend.h"
+#include "ShapeStore.h"
+#include "XmlReader.h"
+
+// Reads partwise MusicXML into score elements: every part's staves as Measures laid out in systems, its
+// clefs, key and time signatures, notes, rests, accidentals and dots as Leland Symbols, and the title, part
+// names and words as Text. The file streams through XmlReader; what's kept is the measure being read and
+// the elements already laid out, which go into the store in one batch at the end, once every part has been
+// read and it's known how tall a system is.
+//
+// It reads scores, it doesn't engrave them: notes are spaced by where they fall in their measure, stems
+// and flags come with SMuFL's precomposed notes, ledger lines are Lines, and beams, ties, slurs, tuplets,
+// lyrics and dynamics are left out. Compressed .mxl files have to be unzipped first.
+class MusicXmlImporter : private XmlHandler
+{
+public:
+	// adds the score in the file above what's in elements; false, with getError saying why, if it can't
+	bool import(const std::filesystem::path& path, ShapeStore& elements)
+	{
+		std::ifstream in(path, std::ios::binary);
+		if (!in)
+		{
+			return fail("can't open the file");
+		}
+
+		char magic[2]{};
+		in.read(magic, 2);
+		if (in.gcount() == 2 && magic[0] == 'P' && magic[1] == 'K')
+		{
+			return fail("compressed MusicXML (.mxl) isn't supported; unzip it and import the .musicxml inside");
+		}
+		in.clear();
+		in.seekg(0);
+		return import(in, elements);
+	}
+
+	bool import(std::istream& in, ShapeStore& elements)
+	{
+		*this = MusicXmlImporter();
+
+		XmlReader reader;
+		if (!reader.parse(in, *this))
+		{
+			return fail(m_error ? m_error : reader.getError());
+		}
+		if (m_error)
+		{
+			return false;
+		}
+		if (!m_sawScore || m_rows == 0)
+		{
+			return fail("no parts; only partwise MusicXML scores can be imported");
+		}
+		return insert(elements);
+	}
+
+	const char* getError() const { return m_error ? m_error : ""; }
+
+	std::size_t getPartCount() const { return m_parts.size(); }
+	std::size_t getMeasureCount() const { return m_measures.size(); }
+	std::size_t getNoteCount() const { return m_notes; }
+
+private:
+	// canvas pixels; symbols are drawn an em to a staff, the size the Symbols tool defaults to
+	static constexpr float kStaffHeight{ 28.0f };
+	static constexpr float kSpace{ kStaffHeight / 4.0f };
+	static constexpr float kSymbolSize{ kStaffHeight };
+	static constexpr float kCueSize{ 20.0f }; // grace and cue notes
+	static constexpr float kLeft{ 48.0f };
+	static constexpr float kTop{ 96.0f };
+	static constexpr float kIndent{ 96.0f }; // the first system's, where the part names go
+	static constexpr float kSystemWidth{ 720.0f };
+	static constexpr float kRowSpacing{ kStaffHeight * 3.0f }; // a staff and room for ledger lines
+	static constexpr float kSystemGap{ kStaffHeight };
+
+	// what goes where in a measure
+	static constexpr float kNoteSpacing{ kStaffHeight };
+	static constexpr float kMinContent{ 2.0f * kStaffHeight };
+	static constexpr float kMeasurePad{ 14.0f };
+	static constexpr float kClefWidth{ 30.0f };
+	static constexpr float kKeyStep{ 8.0f };
+	static constexpr float kKeyGap{ 4.0f };
+	static constexpr float kDigitWidth{ 12.0f };
+	static constexpr float kLeadGap{ 8.0f };
+	static constexpr float kNoteheadWidth{ 9.0f };
+	static constexpr int kMaxDots{ 4 }; // more than anyone writes; a file with hundreds still draws a few
+
+	// far past anything a score writes, and small enough that a measure's length in divisions is worked out
+	// without overflowing; times within a measure stop at kMaxTime
+	static constexpr int kMaxDivisions{ 1 << 20 };
+	static constexpr int kMaxBeats{ 1000 };
+	static constexpr int kMaxBeatType{ 1024 };
+	static constexpr int kMaxTime{ 1 << 30 };
+
+	static constexpr std::uint32_t kInk{ 0xFF000000 };
+
+	// Leland's ascender, 2012 units to the em; DrawString puts the baseline this far below the layout point
+	static constexpr float kLelandAscent{ 2.012f };
+	static constexpr float kPlainAscent{ 0.905f };
+
+	enum class Tag : std::uint8_t
+	{
+		Other,
+		ScorePartwise,
+		ScoreTimewise,
+		WorkTitle,
+		MovementTitle,
+		ScorePart,
+		PartName,
+		Part,
+		Measure,
+		Divisions,
+		Key,
+		Fifths,
+		Time,
+		Beats,
+		BeatType,
+		Staves,
+		Clef,
+		Sign,
+		Line,
+		ClefOctaveChange,
+		Note,
+		Grace,
+		Cue,
+		Chord,
+		Rest,
+		Step,
+		Octave,
+		Alter,
+		Duration,
+		Type,
+		Dot,
+		Accidental,
+		Stem,
+		Staff,
+		Backup,
+		Forward,
+		Direction,
+		Words
+	};
+
+	struct ClefState
+	{
+		char sign{ 'G' };
+		int line{ 2 };
+		int octave{ 0 }; // clef-octave-change
+	};
+
+	struct NoteState
+	{
+		bool rest{ false };
+		bool wholeMeasure{ false };
+		bool chord{ false };
+		bool grace{ false };
+		bool cue{ false };
+		bool printed{ true };
+		int step{ -1 }; // C to B as 0 to 6, from pitch, unpitched or a rest's display step
+		int octave{ 4 };
+		int alter{ 0 }; // from pitch, in semitones
+		int duration{ 0 };
+		int type{ -1 }; // breve to 128th as 0 to 8
+		int dots{ 0 };
+		wchar_t accidental{ 0 };
+		int stem{ 0 }; // 1 up, 2 down
+		int staff{ 1 };
+	};
+
+	// what a staff shows at the start of a measure if the measure starts a system, or if it changes there
+	struct StaffState
+	{
+		std::uint32_t measure;
+		ClefState clef;
+		int fifths;
+		int beats;
+		int beatType;
+		char timeSymbol;
+		std::uint8_t changed; // kClefChanged, kKeyChanged and kTimeChanged
+	};
+
+	static constexpr std::uint8_t kClefChanged{ 1 };
+	static constexpr std::uint8_t kKeyChanged{ 2 };
+	static constexpr std::uint8_t kTimeChanged{ 4 };
+
+	// A measure across every part: the times its parts have something at, merged, and once every part has
+	// been read, where it goes. The times are in quarter notes, since each part counts in its own divisions.
+	struct MeasureLayout
+	{
+		std::vector<float> times;
+		std::vector<float> offsets; // each time's x in the notes' area
+		float length{ 0.0f };
+		float content{ 0.0f }; // the notes' area, padding included
+		float inset{ kMeasurePad / 2.0f }; // from the lead to the first time, room for accidentals and grace notes before it
+		std::uint32_t system{ 0 };
+		float left{ 0.0f };
+		float width{ 0.0f };
+		float lead{ 0.0f }; // where the notes' area starts
+		float leadInside{ 0.0f }; // how wide the clef, key and time are partway through a system
+		float leadStarting{ 0.0f }; // and when the measure starts one
+		bool startsSystem{ false };
+	};
+
+	struct PartLayout
+	{
+		std::uint32_t rowBase;
+		std::uint32_t staves;
+		std::uint32_t measures;
+	};
+
+	// what a placed element's x is from
+	enum class Anchor : std::uint8_t
+	{
+		Onset, // the x of its time in its measure
+		Centered, // the middle of its measure's notes' area
+		Measure, // its measure's left edge
+		FirstSystem, // the canvas, on the first system
+		Canvas // the canvas, y included
+	};
+
+	// An element read but not yet in the store, since where it goes across depends on every part and where
+	// it goes down on how many staves they have between them. Symbol and Text are an origin and a size (in
+	// x1), Line its two ends; y is from the top of the element's staff.
+	struct Placed
+	{
+		ShapeKind kind;
+		Anchor anchor;
+		std::uint32_t value; // a symbol's glyph, or a text's index in m_strings
+		std::uint32_t measure;
+		std::uint32_t row;
+		float time;
+		float x0;
+		float y0;
+		float x1;
+		float y1;
+	};
+
+	const char* m_error{ nullptr };
+	bool m_sawScore{ false };
+	std::string m_text; // the current leaf's
+	bool m_capturing{ false };
+	std::vector<std::wstring> m_strings; // texts' strings
+	std::vector<Placed> m_placed;
+	std::size_t m_notes{ 0 };
+
+	// the score
+	std::wstring m_title;
+	std::vector<std::string> m_partIds; // in the part list
+	std::vector<std::wstring> m_partNames;
+	std::vector<PartLayout> m_parts; // as read
+	std::vector<MeasureLayout> m_measures;
+	std::vector<std::vector<StaffState>> m_changes; // per staff, top to bottom
+	std::uint32_t m_rows{ 0 }; // staves in the parts read so far
+
+	// the part being read; no staves until one starts
+	bool m_inPart{ false };
+	std::string m_partId;
+	std::uint32_t m_rowBase{ 0 };
+	std::uint32_t m_staves{ 0 };
+	std::uint32_t m_measure{ 0 }; // index of the one being read
+	int m_divisions{ 1 };
+	int m_beats{ 4 };
+	int m_beatType{ 4 };
+	char m_timeSymbol{ 0 }; // 'c' common, 'u' cut, 'n' not shown
+	std::vector<ClefState> m_clefs; // per staff
+	std::vector<int> m_fifths;
+
+	// the measure being read
+	int m_time{ 0 }; // divisions from its start
+	int m_measureEnd{ 0 };
+	int m_lastOnset{ 0 };
+	bool m_sawNote{ false };
+	std::size_t m_firstPlaced{ 0 }; // its first element in m_placed
+	std::vector<std::uint8_t> m_changed; // per staff, what changed before the first note
+	std::vector<std::vector<std::pair<int, int>>> m_alters; // per staff, (step and octave, alter) for accidentals drawn so far
+
+	// what's being read inside it
+	bool m_inClef{ false };
+	bool m_inNote{ false };
+	bool m_inBackup{ false };
+	bool m_inForward{ false };
+	bool m_inDirection{ false };
+	ClefState m_clef;
+	int m_clefStaff{ 0 }; // 0 for every staff
+	int m_keyStaff{ 0 };
+	std::string m_beatsText;
+	NoteState m_note;
+	bool m_below{ false };
+	int m_directionStaff{ 1 };
+	std::string m_words;
+
+	bool fail(const char* error)
+	{
+		m_error = error;
+		return false;
+	}
+
+	static Tag tagOf(std::string_view name)
+	{
+		static const std::unordered_map<std::string_view, Tag> tags{
+			{ "score-partwise", Tag::ScorePartwise }, { "score-timewise", Tag::ScoreTimewise },
+			{ "work-title", Tag::WorkTitle }, { "movement-title", Tag::MovementTitle },
+			{ "score-part", Tag::ScorePart }, { "part-name", Tag::PartName }, { "part", Tag::Part },
+			{ "measure", Tag::Measure }, { "divisions", Tag::Divisions }, { "key", Tag::Key }, { "fifths", Tag::Fifths },
+			{ "time", Tag::Time }, { "beats", Tag::Beats }, { "beat-type", Tag::BeatType }, { "staves", Tag::Staves },
+			{ "clef", Tag::Clef }, { "sign", Tag::Sign }, { "line", Tag::Line }, { "clef-octave-change", Tag::ClefOctaveChange },
+			{ "note", Tag::Note }, { "grace", Tag::Grace }, { "cue", Tag::Cue }, { "chord", Tag::Chord }, { "rest", Tag::Rest },
+			{ "step", Tag::Step }, { "display-step", Tag::Step }, { "octave", Tag::Octave }, { "display-octave", Tag::Octave },
+			{ "alter", Tag::Alter },
+			{ "duration", Tag::Duration }, { "type", Tag::Type }, { "dot", Tag::Dot }, { "accidental", Tag::Accidental },
+			{ "stem", Tag::Stem }, { "staff", Tag::Staff }, { "backup", Tag::Backup }, { "forward", Tag::Forward },
+			{ "direction", Tag::Direction }, { "words", Tag::Words },
+		};
+
+		auto found = tags.find(name);
+		return found == tags.end() ? Tag::Other : found->second;
+	}
+
+	// the leaves whose text is read
+	static bool hasText(Tag tag)
+	{
+		switch (tag)
+		{
+		case Tag::WorkTitle:
+		case Tag::MovementTitle:
+		case Tag::PartName:
+		case Tag::Divisions:
+		case Tag::Fifths:
+		case Tag::Beats:
+		case Tag::BeatType:
+		case Tag::Staves:
+		case Tag::Sign:
+		case Tag::Line:
+		case Tag::ClefOctaveChange:
+		case Tag::Step:
+		case Tag::Octave:
+		case Tag::Alter:
+		case Tag::Duration:
+		case Tag::Type:
+		case Tag::Accidental:
+		case Tag::Stem:
+		case Tag::Staff:
+		case Tag::Words:
+			return true;
+		default:
+			return false;
+		}
+	}
+
+	// what goes on a part's staves, which only exist inside one
+	static bool inPart(Tag tag)
+	{
+		switch (tag)
+		{
+		case Tag::Measure:
+		case Tag::Divisions:
+		case Tag::Key:
+		case Tag::Time:
+		case Tag::Staves:
+		case Tag::Clef:
+		case Tag::Note:
+		case Tag::Backup:
+		case Tag::Forward:
+		case Tag::Direction:
+			return true;
+		default:
+			return false;
+		}
+	}
+
+	void startElement(std::string_view name, const XmlAttributes& attributes) override
+	{
+		if (m_error)
+		{
+			return;
+		}
+
+		Tag tag{ tagOf(name) };
+		if (!m_inPart && inPart(tag))
+		{
+			fail("a measure, note, clef or key outside a part; the file isn't valid partwise MusicXML");
+			return;
+		}
+		if (hasText(tag))
+		{
+			m_text.clear();
+			m_capturing = true;
+		}
+
+		switch (tag)
+		{
+		case Tag::ScorePartwise:
+			m_sawScore = true;
+			break;
+		case Tag::ScoreTimewise:
+			fail("timewise MusicXML isn't supported; convert it to partwise first");
+			break;
+		case Tag::ScorePart:
+			m_partIds.emplace_back(attributes.get("id"));
+			m_partNames.emplace_back();
+			break;
+		case Tag::Part:
+			if (m_inPart)
+			{
+				fail("a part inside a part; the file isn't valid partwise MusicXML");
+				break;
+			}
+			startPart(attributes.get("id"));
+			break;
+		case Tag::Measure:
+			startMeasure();
+			break;
+		case Tag::Key:
+			m_keyStaff = toInt(attributes.get("number"));
+			break;
+		case Tag::Time:
+		{
+			std::string_view symbol{ attributes.get("symbol") };
+			m_timeSymbol = attributes.get("print-object") == "no" ? 'n' : symbol == "common" ? 'c' : symbol == "cut" ? 'u' : 0;
+			break;
+		}
+		case Tag::Clef:
+			m_inClef = true;
+			m_clef = ClefState{ 0, 0, 0 };
+			m_clefStaff = toInt(attributes.get("number"));
+			break;
+		case Tag::Note:
+			m_inNote = true;
+			m_note = NoteState();
+			m_note.printed = attributes.get("print-object") != "no";
+			break;
+		case Tag::Grace:
+			m_note.grace = true;
+			break;
+		case Tag::Cue:
+			m_note.cue = true;
+			break;
+		case Tag::Chord:
+			m_note.chord = true;
+			break;
+		case Tag::Rest:
+			m_note.rest = true;
+			m_note.wholeMeasure = attributes.get("measure") == "yes";
+			break;
+		case Tag::Dot:
+			m_note.dots += m_inNote && m_note.dots < kMaxDots ? 1 : 0;
+			break;
+		case Tag::Backup:
+			m_inBackup = true;
+			break;
+		case Tag::Forward:
+			m_inForward = true;
+			break;
+		case Tag::Direction:
+			m_inDirection = true;
+			m_below = attributes.get("placement") == "below";
+			m_directionStaff = 1;
+			m_words.clear();
+			break;
+		default:
+			break;
+		}
+	}
+
+	void characters(std::string_view text) override
+	{
+		if (m_capturing)
+		{
+			m_text += text;
+		}
+	}
+
+	void endElement(std::string_view name) override
+	{
+		if (m_error)
+		{
+			return;
+		}
+
+		Tag tag{ tagOf(name) };
+		m_capturing = false;
+		std::string_view text{ trim(m_text) };
+
+		switch (tag)
+		{
+		case Tag::WorkTitle:
+		case Tag::MovementTitle:
+			if (m_title.empty())
+			{
+				m_title = widen(text);
+			}
+			break;
+		case Tag::PartName:
+			if (!m_partNames.empty() && !m_inPart)
+			{
+				m_partNames.back() = widen(text);
+			}
+			break;
+		case Tag::Part:
+			endPart();
+			break;
+		case Tag::Measure:
+			endMeasure();
+			break;
+		case Tag::Divisions:
+			m_divisions = (std::max)(1, (std::min)(kMaxDivisions, toInt(text)));
+			break;
+		case Tag::Fifths:
+			setKey((std::max)(-7, (std::min)(7, toInt(text))));
+			break;
+		case Tag::Beats:
+			m_beatsText = std::string(text);
+			break;
+		case Tag::BeatType:
+			setTime(m_beatsText, text);
+			break;
+		case Tag::Time:
+			for (std::uint8_t& changed : m_changed)
+			{
+				changed |= kTimeChanged;
+			}
+			break;
+		case Tag::Staves:
+			setStaves(static_cast<std::uint32_t>((std::max)(1, (std::min)(16, toInt(text)))));
+			break;
+		case Tag::Sign:
+			m_clef.sign = text == "percussion" ? 'P' : text == "TAB" ? 'T' : text == "none" ? 'N' : text.empty() ? 'G' : text[0];
+			break;
+		case Tag::Line:
+			m_clef.line = m_inClef ? (std::min)(5, toInt(text)) : m_clef.line;
+			break;
+		case Tag::ClefOctaveChange:
+			m_clef.octave = (std::max)(-2, (std::min)(2, toInt(text)));
+			break;
+		case Tag::Clef:
+			m_inClef = false;
+			setClef();
+			break;
+		case Tag::Step:
+			m_note.step = stepOf(text);
+			break;
+		case Tag::Octave:
+			m_note.octave = (std::max)(0, (std::min)(9, toInt(text)));
+			break;
+		case Tag::Alter:
+			m_note.alter = toInt(text);
+			break;
+		case Tag::Duration:
+			readDuration((std::max)(0, toInt(text)));
+			break;
+		case Tag::Type:
+			m_note.type = typeOf(text);
+			break;
+		case Tag::Accidental:
+			m_note.accidental = accidentalOf(text);
+			break;
+		case Tag::Stem:
+			m_note.stem = text == "up" ? 1 : text == "down" ? 2 : 0;
+			break;
+		case Tag::Staff:
+			if (m_inNote)
+			{
+				m_note.staff = toInt(text);
+			}
+			else if (m_inDirection)
+			{
+				m_directionStaff = toInt(text);
+			}
+			break;
+		case Tag::Note:
+			m_inNote = false;
+			endNote();
+			break;
+		case Tag::Backup:
+			m_inBackup = false;
+			break;
+		case Tag::Forward:
+			m_inForward = false;
+			break;
+		case Tag::Words:
+			if (!text.empty())
+			{
+				m_words += m_words.empty() ? "" : " ";
+				m_words += text;
+			}
+			break;
+		case Tag::Direction:
+			m_inDirection = false;
+			endDirection();
+			break;
+		default:
+			break;
+		}
+	}
+
+	void startPart(std::string_view id)
+	{
+		m_inPart = true;
+		m_partId = std::string(id);
+		m_rowBase = m_rows;
+		m_measure = 0;
+		m_divisions = 1;
+		m_beats = 4;
+		m_beatType = 4;
+		m_timeSymbol = 0;
+		setStaves(1);
+		std::fill(m_clefs.begin(), m_clefs.end(), ClefState());
+		std::fill(m_fifths.begin(), m_fifths.end(), 0);
+	}
+
+	void endPart()
+	{
+		m_inPart = false;
+
+		// the name goes left of the part's staves on the first system
+		for (std::size_t i{ 0 }; i < m_partIds.size(); ++i)
+		{
+			if (m_partIds[i] == m_partId && !m_partNames[i].empty())
+			{
+				m_strings.push_back(m_partNames[i]);
+				float middle{ (kRowSpacing * static_cast<float>(m_staves - 1) + kStaffHeight) / 2.0f };
+				m_placed.push_back(Placed{ ShapeKind::Text, Anchor::FirstSystem, static_cast<std::uint32_t>(m_strings.size() - 1), 0, m_rowBase, 0.0f, kLeft, middle + 4.0f, 12.0f, 0.0f });
+				break;
+			}
+		}
+
+		m_parts.push_back(PartLayout{ m_rowBase, m_staves, m_measure });
+		m_rows += m_staves;
+	}
+
+	void setStaves(std::uint32_t staves)
+	{
+		m_staves = staves;
+		m_clefs.resize(staves);
+		m_fifths.resize(staves, m_fifths.empty() ? 0 : m_fifths.front());
+		m_changed.resize(staves, 0);
+		m_alters.resize(staves);
+	}
+
+	void startMeasure()
+	{
+		m_time = 0;
+		m_measureEnd = 0;
+		m_lastOnset = 0;
+		m_sawNote = false;
+		m_firstPlaced = m_placed.size();
+		std::fill(m_changed.begin(), m_changed.end(), std::uint8_t{ 0 });
+		for (std::vector<std::pair<int, int>>& alters : m_alters)
+		{
+			alters.clear();
+		}
+	}
+
+	std::uint32_t staffIndex(int staff) const { return static_cast<std::uint32_t>((std::max)(0, (std::min)(staff, static_cast<int>(m_staves)) - 1)); }
+
+	void setClef()
+	{
+		if (m_clef.sign == 0)
+		{
+			m_clef.sign = 'G';
+		}
+		if (m_clef.line <= 0)
+		{
+			m_clef.line = m_clef.sign == 'F' ? 4 : m_clef.sign == 'C' ? 3 : 2;
+		}
+
+		for (std::uint32_t s{ 0 }; s < m_staves; ++s)
+		{
+			if (m_clefStaff != 0 && s != staffIndex(m_clefStaff))
+			{
+				continue;
+			}
+
+			m_clefs[s] = m_clef;
+			if (!m_sawNote)
+			{
+				m_changed[s] |= kClefChanged;
+			}
+			else if (wchar_t glyph{ clefGlyph(m_clef) })
+			{
+				// a change partway through sits just before the note it applies to
+				addItem(ShapeKind::Symbol, static_cast<std::uint32_t>(glyph), m_time, -kClefWidth * 0.7f, clefPosition(m_clef), kCueSize, s);
+			}
+		}
+	}
+
+	void setKey(int fifths)
+	{
+		for (std::uint32_t s{ 0 }; s < m_staves; ++s)
+		{
+			if (m_keyStaff == 0 || s == staffIndex(m_keyStaff))
+			{
+				m_fifths[s] = fifths;
+				m_changed[s] |= kKeyChanged;
+			}
+		}
+	}
+
+	void setTime(std::string_view beats, std::string_view beatType)
+	{
+		// additive signatures like 3+2 count as their sum
+		int total{ 0 };
+		std::size_t at{ 0 };
+		while (at < beats.size())
+		{
+			std::size_t plus{ beats.find('+', at) };
+			std::size_t stop{ plus == std::string_view::npos ? beats.size() : plus };
+			total = (std::min)(kMaxBeats, total + (std::max)(0, toInt(beats.substr(at, stop - at))));
+			at = stop + 1;
+		}
+
+		int type{ (std::min)(kMaxBeatType, toInt(beatType)) };
+		if (total > 0 && type > 0)
+		{
+			m_beats = total;
+			m_beatType = type;
+		}
+	}
+
+	void readDuration(int duration)
+	{
+		if (m_inNote)
+		{
+			m_note.duration = duration;
+		}
+		else if (m_inBackup)
+		{
+			m_time = (std::max)(0, m_time - duration);
+		}
+		else if (m_inForward)
+		{
+			m_time = later(m_time, duration);
+			m_measureEnd = (std::max)(m_measureEnd, m_time);
+		}
+	}
+
+	// something on staff at time in the measure being read, dx across from the time's x
+	void addItem(ShapeKind kind, std::uint32_t value, int time, float dx, float position, float size, std::uint32_t staff, Anchor anchor = Anchor::Onset)
+	{
+		float y{ kStaffHeight - position * kSpace / 2.0f };
+		float quarters{ static_cast<float>(time) / static_cast<float>(m_divisions) };
+		bool line{ kind == ShapeKind::Line };
+		m_placed.push_back(Placed{ kind, anchor, value, m_measure, m_rowBase + staff, quarters, dx, y, line ? dx + size : size, line ? y : 0.0f });
+	}
+
+	void endNote()
+	{
+		NoteState& note{ m_note };
+		int onset{ note.chord ? m_lastOnset : m_time };
+		if (!note.chord)
+		{
+			m_lastOnset = m_time;
+			if (!note.grace)
+			{
+				m_time = later(m_time, note.duration);
+				m_measureEnd = (std::max)(m_measureEnd, m_time);
+			}
+		}
+		m_sawNote = true;
+		++m_notes;
+		if (!note.printed)
+		{
+			return;
+		}
+
+		std::uint32_t staff{ staffIndex(note.staff) };
+		float size{ note.grace || note.cue ? kCueSize : kSymbolSize };
+		float scale{ size / kSymbolSize };
+		float dx{ note.grace ? -kNoteSpacing / 2.0f : 0.0f }; // grace notes come just before their note
+		int type{ note.type >= 0 ? note.type : typeOfDuration(note.duration) };
+
+		if (note.rest)
+		{
+			bool whole{ note.wholeMeasure || (note.type < 0 && note.duration >= measureLength()) };
+			type = whole ? 1 : type;
+			float position{ note.step >= 0 ? static_cast<float>(positionOf(note.step, note.octave, m_clefs[staff])) : type <= 1 ? 6.0f : 4.0f };
+			addItem(ShapeKind::Symbol, 0xE4E2u + static_cast<std::uint32_t>(type), onset, dx, position, size, staff, whole ? Anchor::Centered : Anchor::Onset);
+			addDots(onset, dx, position, note.dots, scale, staff);
+			return;
+		}
+
+		int position{ positionOf(note.step >= 0 ? note.step : 6, note.octave, m_clefs[staff]) };
+		bool down{ note.stem == 2 || (note.stem == 0 && position >= 4) };
+		std::uint32_t glyph{ type == 0 ? 0xE1D0u : type == 1 ? 0xE1D2u : 0xE1D3u + 2u * static_cast<std::uint32_t>(type - 2) + (down ? 1u : 0u) };
+		addItem(ShapeKind::Symbol, glyph, onset, dx, static_cast<float>(position), size, staff);
+
+		wchar_t accidental{ note.step >= 0 ? accidentalFor(note, staff) : note.accidental };
+		if (accidental != 0)
+		{
+			addItem(ShapeKind::Symbol, static_cast<std::uint32_t>(accidental), onset, dx - 11.0f * scale, static_cast<float>(position), size, staff);
+		}
+		addDots(onset, dx, static_cast<float>(position), note.dots, scale, staff);
+
+		// ledger lines out to the note, a little wider than its head
+		for (int line{ -2 }; line >= position; line -= 2)
+		{
+			addItem(ShapeKind::Line, 0, onset, dx - 4.0f * scale, static_cast<float>(line), (kNoteheadWidth + 8.0f) * scale, staff);
+		}
+		for (int line{ 10 }; line <= position; line += 2)
+		{
+			addItem(ShapeKind::Line, 0, onset, dx - 4.0f * scale, static_cast<float>(line), (kNoteheadWidth + 8.0f) * scale, staff);
+		}
+	}
+
+	// dots go in the space, above the line when the note's on one
+	void addDots(int onset, float dx, float position, int dots, float scale, std::uint32_t staff)
+	{
+		float space{ static_cast<int>(position) % 2 == 0 ? position + 1.0f : position };
+		for (int dot{ 0 }; dot < dots; ++dot)
+		{
+			addItem(ShapeKind::Symbol, 0xE1E7u, onset, dx + (kNoteheadWidth + 4.0f + 5.0f * dot) * scale, space, kSymbolSize * scale, staff);
+		}
+	}
+
+	void endDirection()
+	{
+		if (!m_words.empty())
+		{
+			m_strings.push_back(widen(m_words));
+			addItem(ShapeKind::Text, static_cast<std::uint32_t>(m_strings.size() - 1), m_time, 0.0f, m_below ? -6.0f : 12.0f, 12.0f, staffIndex(m_directionStaff));
+		}
+	}
+
+	int measureLength() const
+	{
+		std::int64_t length{ static_cast<std::int64_t>(m_beats) * m_divisions * 4 / m_beatType };
+		return static_cast<int>((std::max)(std::int64_t{ 1 }, (std::min)(std::int64_t{ kMaxTime }, length)));
+	}
+
+	// duration on from time, stopping at kMaxTime however many durations a measure adds up
+	static int later(int time, int duration)
+	{
+		return static_cast<int>((std::min)(std::int64_t{ kMaxTime }, static_cast<std::int64_t>(time) + duration));
+	}
+
+	// records what the staves show at the start of the measure and merges its times into the other parts'
+	void endMeasure()
+	{
+		if (!m_inPart)
+		{
+			return;
+		}
+
+		if (m_changes.size() < m_rowBase + m_staves)
+		{
+			m_changes.resize(m_rowBase + m_staves);
+		}
+		for (std::uint32_t s{ 0 }; s < m_staves; ++s)
+		{
+			if (m_changed[s] != 0 || m_measure == 0)
+			{
+				m_changes[m_rowBase + s].push_back(StaffState{ m_measure, m_clefs[s], m_fifths[s], m_beats, m_beatType, m_timeSymbol, m_changed[s] });
+			}
+		}
+
+		if (m_measures.size() == m_measure)
+		{
+			m_measures.emplace_back();
+		}
+		MeasureLayout& layout{ m_measures[m_measure] };
+		float length{ static_cast<float>((std::max)(measureLength(), m_measureEnd)) / static_cast<float>(m_divisions) };
+		layout.length = (std::max)(layout.length, length);
+
+		std::size_t known{ layout.times.size() };
+		for (std::size_t i{ m_firstPlaced }; i < m_placed.size(); ++i)
+		{
+			if (m_placed[i].anchor == Anchor::Onset)
+			{
+				layout.times.push_back(m_placed[i].time);
+				if (m_placed[i].time < kSameTime)
+				{
+					layout.inset = (std::max)(layout.inset, kMeasurePad / 4.0f - m_placed[i].x0);
+				}
+			}
+		}
+		if (layout.times.size() > known)
+		{
+			std::sort(layout.times.begin(), layout.times.end());
+			layout.times.erase(std::unique(layout.times.begin(), layout.times.end(), [](float a, float b) { return b - a < kSameTime; }), layout.times.end());
+		}
+
+		++m_measure;
+	}
+
+	// tuplets leave times a rounding error apart in different parts' divisions
+	static constexpr float kSameTime{ 1e-4f };
+
+	// longer notes get a little more room after them, as engravers space them
+	static float getGap(float quarters)
+	{
+		return kNoteSpacing * (std::max)(0.7f, (std::min)(2.0f, 0.7f + 0.3f * std::sqrt((std::max)(0.0f, quarters))));
+	}
+
+	float getTimeWidth(const StaffState& state) const
+	{
+		if (state.timeSymbol == 'c' || state.timeSymbol == 'u')
+		{
+			return 2.0f * kDigitWidth;
+		}
+		std::size_t digits{ (std::max)(std::to_string(state.beats).size(), std::to_string(state.beatType).size()) };
+		return kDigitWidth * static_cast<float>(digits) + 4.0f;
+	}
+
+	// how wide the clef, key and time a staff shows at a measure's start are
+	float getLeadWidth(const StaffState& state, std::uint8_t changed, bool startsSystem) const
+	{
+		float width{ 0.0f };
+		if ((changed & kClefChanged) || startsSystem)
+		{
+			width += kClefWidth;
+		}
+		if (((changed & kKeyChanged) || startsSystem) && state.fifths != 0)
+		{
+			width += kKeyStep * static_cast<float>(std::abs(state.fifths)) + kKeyGap;
+		}
+		if ((changed & kTimeChanged) && state.timeSymbol != 'n')
+		{
+			width += getTimeWidth(state);
+		}
+		return width > 0.0f ? width + kLeadGap : 0.0f;
+	}
+
+	// Calls visit(row, measure, state, changed) for every measure of every staff, with what the staff shows
+	// there and what changed at that measure.
+	template<typename Visit>
+	void forEachStaffMeasure(Visit&& visit) const
+	{
+		for (const PartLayout& part : m_parts)
+		{
+			for (std::uint32_t row{ part.rowBase }; row < part.rowBase + part.staves; ++row)
+			{
+				const std::vector<StaffState>& changes{ m_changes[row] };
+				std::size_t next{ 0 };
+				StaffState state{ 0, ClefState(), 0, 4, 4, 0, 0 };
+				for (std::uint32_t measure{ 0 }; measure < part.measures; ++measure)
+				{
+					std::uint8_t changed{ 0 };
+					while (next < changes.size() && changes[next].measure == measure)
+					{
+						state = changes[next++];
+						changed |= state.changed;
+					}
+					visit(row, measure, state, changed);
+				}
+			}
+		}
+	}
+
+	// Spaces every measure's times, finds the widest lead any staff needs there and breaks the measures
+	// into systems.
+	void layOut()
+	{
+		for (MeasureLayout& layout : m_measures)
+		{
+			float x{ 0.0f };
+			float last{ 0.0f };
+			layout.offsets.resize(layout.times.size());
+			for (std::size_t i{ 0 }; i < layout.times.size(); ++i)
+			{
+				x += i == 0 && layout.times[i] < kSameTime ? 0.0f : getGap(layout.times[i] - last);
+				layout.offsets[i] = x;
+				last = layout.times[i];
+			}
+			x += layout.times.empty() ? 0.0f : getGap(layout.length - last);
+			layout.content = (std::max)(kMinContent, x) + layout.inset + kMeasurePad / 2.0f;
+		}
+
+		forEachStaffMeasure([this](std::uint32_t, std::uint32_t measure, const StaffState& state, std::uint8_t changed) {
+			MeasureLayout& layout{ m_measures[measure] };
+			layout.leadInside = (std::max)(layout.leadInside, getLeadWidth(state, changed, false));
+			layout.leadStarting = (std::max)(layout.leadStarting, getLeadWidth(state, changed, true));
+		});
+
+		std::uint32_t system{ 0 };
+		float cursor{ 0.0f };
+		for (MeasureLayout& layout : m_measures)
+		{
+			if (cursor > 0.0f && cursor + layout.leadInside + layout.content > getSystemWidth(system))
+			{
+				++system;
+				cursor = 0.0f;
+			}
+
+			layout.system = system;
+			layout.startsSystem = cursor == 0.0f;
+			layout.lead = layout.startsSystem ? layout.leadStarting : layout.leadInside;
+			layout.left = getSystemLeft(system) + cursor;
+			layout.width = layout.lead + layout.content;
+			cursor += layout.width;
+		}
+	}
+
+	float getSystemLeft(std::uint32_t system) const { return kLeft + (system == 0 ? kIndent : 0.0f); }
+	float getSystemWidth(std::uint32_t system) const { return kSystemWidth - (system == 0 ? kIndent : 0.0f); }
+
+	// the clefs, keys and times at the start of each measure that shows them
+	void placeLeads()
+	{
+		forEachStaffMeasure([this](std::uint32_t row, std::uint32_t measure, const StaffState& state, std::uint8_t changed) {
+			const MeasureLayout& layout{ m_measures[measure] };
+			float x{ 4.0f };
+			if ((changed & kClefChanged) || layout.startsSystem)
+			{
+				if (wchar_t glyph{ clefGlyph(state.clef) })
+				{
+					placeLead(static_cast<std::uint32_t>(glyph), measure, row, x, clefPosition(state.clef));
+				}
+				x += kClefWidth;
+			}
+
+			if ((changed & kKeyChanged) || layout.startsSystem)
+			{
+				// sharps from F and flats from B, in treble positions moved down to the clef's octave
+				static constexpr int kSharps[7]{ 38, 35, 39, 36, 33, 37, 34 };
+				static constexpr int kFlats[7]{ 34, 37, 33, 36, 32, 35, 31 };
+				int shift{ state.clef.sign == 'F' ? -14 : state.clef.sign == 'C' ? -7 : 0 };
+				for (int i{ 0 }; i < std::abs(state.fifths); ++i)
+				{
+					int step{ (state.fifths > 0 ? kSharps[i] : kFlats[i]) + shift };
+					int position{ positionOf(step % 7, step / 7, ClefState{ state.clef.sign, state.clef.line, 0 }) };
+					while (position > 9)
+					{
+						position -= 7;
+					}
+					while (position < -1)
+					{
+						position += 7;
+					}
+					placeLead(state.fifths > 0 ? 0xE262u : 0xE260u, measure, row, x, static_cast<float>(position));
+					x += kKeyStep;
+				}
+				x += state.fifths != 0 ? kKeyGap : 0.0f;
+			}
+
+			if ((changed & kTimeChanged) && state.timeSymbol != 'n')
+			{
+				if (state.timeSymbol == 'c' || state.timeSymbol == 'u')
+				{
+					placeLead(state.timeSymbol == 'c' ? 0xE08Au : 0xE08Bu, measure, row, x, 4.0f);
+				}
+				else
+				{
+					std::string top{ std::to_string(state.beats) };
+					std::string bottom{ std::to_string(state.beatType) };
+					float width{ kDigitWidth * static_cast<float>((std::max)(top.size(), bottom.size())) };
+					placeDigits(top, measure, row, x + (width - kDigitWidth * static_cast<float>(top.size())) / 2.0f, 6.0f);
+					placeDigits(bottom, measure, row, x + (width - kDigitWidth * static_cast<float>(bottom.size())) / 2.0f, 2.0f);
+				}
+			}
+		});
+	}
+
+	void placeLead(std::uint32_t glyph, std::uint32_t measure, std::uint32_t row, float x, float position)
+	{
+		m_placed.push_back(Placed{ ShapeKind::Symbol, Anchor::Measure, glyph, measure, row, 0.0f, x, kStaffHeight - position * kSpace / 2.0f, kSymbolSize, 0.0f });
+	}
+
+	void placeDigits(const std::string& digits, std::uint32_t measure, std::uint32_t row, float x, float position)
+	{
+		for (char digit : digits)
+		{
+			placeLead(0xE080u + static_cast<std::uint32_t>(digit - '0'), measure, row, x, position);
+			x += kDigitWidth;
+		}
+	}
+
+	// where a placed element's x is measured from
+	float getAnchorX(const Placed& placed) const
+	{
+		switch (placed.anchor)
+		{
+		case Anchor::Onset:
+		{
+			const MeasureLayout& layout{ m_measures[placed.measure] };
+			std::size_t column{ static_cast<std::size_t>(std::lower_bound(layout.times.begin(), layout.times.end(), placed.time - kSameTime) - layout.times.begin()) };
+			float offset{ column < layout.offsets.size() ? layout.offsets[column] : 0.0f };
+			return layout.left + layout.lead + layout.inset + offset;
+		}
+		case Anchor::Centered:
+		{
+			const MeasureLayout& layout{ m_measures[placed.measure] };
+			return layout.left + layout.lead + (layout.width - layout.lead) / 2.0f - kNoteheadWidth / 2.0f;
+		}
+		case Anchor::Measure:
+			return m_measures[placed.measure].left;
+		default:
+			return 0.0f;
+		}
+	}
+
+	// lays everything out, then adds it to the store in one pass, with each column grown once
+	bool insert(ShapeStore& elements)
+	{
+		layOut();
+		placeLeads();
+		if (!m_title.empty())
+		{
+			m_strings.push_back(m_title);
+			m_placed.push_back(Placed{ ShapeKind::Text, Anchor::Canvas, static_cast<std::uint32_t>(m_strings.size() - 1), 0, 0, 0.0f, kLeft, kTop - kStaffHeight * 1.5f, 24.0f, 0.0f });
+		}
+
+		std::size_t staves{ 0 };
+		for (const PartLayout& part : m_parts)
+		{
+			staves += static_cast<std::size_t>(part.staves) * part.measures;
+		}
+		std::size_t count{ staves + m_placed.size() };
+		if (elements.size() + count > ShapeStore::kMaxShapes)
+		{
+			return fail("the score has more elements than one document can hold");
+		}
+		elements.reserve(count, 2 * count);
+
+		float systemHeight{ kRowSpacing * static_cast<float>(m_rows) + kSystemGap };
+		auto getTop = [&](std::uint32_t system, std::uint32_t row) { return kTop + systemHeight * static_cast<float>(system) + kRowSpacing * static_cast<float>(row); };
+
+		// staves first, so everything else draws over them
+		for (const PartLayout& part : m_parts)
+		{
+			for (std::uint32_t row{ part.rowBase }; row < part.rowBase + part.staves; ++row)
+			{
+				for (std::uint32_t measure{ 0 }; measure < part.measures; ++measure)
+				{
+					const MeasureLayout& layout{ m_measures[measure] };
+					float top{ getTop(layout.system, row) };
+					float xy[4]{ layout.left, top, layout.left + layout.width, top + kStaffHeight };
+					elements.add(ShapeKind::Measure, xy, 2, kInk, 1, false);
+				}
+			}
+		}
+
+		for (const Placed& placed : m_placed)
+		{
+			float x{ getAnchorX(placed) + placed.x0 };
+			float top{ placed.anchor == Anchor::Canvas ? 0.0f : getTop(placed.anchor == Anchor::FirstSystem ? 0 : m_measures[placed.measure].system, placed.row) };
+			float y{ top + placed.y0 };
+			if (placed.kind == ShapeKind::Line)
+			{
+				float xy[4]{ x, y, x + placed.x1 - placed.x0, top + placed.y1 };
+				elements.add(ShapeKind::Line, xy, 2, kInk, 1, false);
+				continue;
+			}
+
+			// the corner that puts the glyph's origin, or the text's baseline, at (x, y)
+			float size{ placed.x1 };
+			bool symbol{ placed.kind == ShapeKind::Symbol };
+			RenderPoint offset{ scoreTextOffset(static_cast<int>(size)) };
+			float left{ x - offset.x - (symbol ? size / 6.0f : 0.0f) };
+			float corner{ y - offset.y - size * (symbol ? kLelandAscent : kPlainAscent) };
+			float xy[4]{ left, corner, left + size, corner + size };
+			if (symbol)
+			{
+				elements.add(ShapeKind::Symbol, xy, 2, kInk, 1, true, std::wstring(1, static_cast<wchar_t>(placed.value)));
+			}
+			else
+			{
+				elements.add(ShapeKind::Text, xy, 2, kInk, 1, true, m_strings[placed.value], L"Times New Roman");
+			}
+		}
+		return true;
+	}
+
+	// half spaces up from the bottom line to the pitch's line or space
+	static int positionOf(int step, int octave, const ClefState& clef)
+	{
+		int reference{ clef.sign == 'F' ? 24 : clef.sign == 'C' ? 28 : 32 }; // F3, middle C or G4 sits on the clef's line
+		int line{ clef.sign == 'P' || clef.sign == 'T' || clef.sign == 'N' ? 2 : clef.line };
+		return octave * 7 + step - reference - 7 * clef.octave + 2 * (line - 1);
+	}
+
+	static float clefPosition(const ClefState& clef)
+	{
+		return clef.sign == 'G' || clef.sign == 'F' || clef.sign == 'C' ? 2.0f * (clef.line - 1) : 4.0f;
+	}
+
+	static wchar_t clefGlyph(const ClefState& clef)
+	{
+		switch (clef.sign)
+		{
+		case 'G':
+			return clef.octave < 0 ? 0xE052 : clef.octave > 0 ? 0xE053 : 0xE050;
+		case 'F':
+			return clef.octave < 0 ? 0xE064 : 0xE062;
+		case 'C':
+			return 0xE05C;
+		case 'P':
+			return 0xE069;
+		case 'T':
+			return 0xE06D;
+		default:
+			return 0;
+		}
+	}
+
+	static int stepOf(std::string_view step)
+	{
+		static constexpr std::string_view kSteps{ "CDEFGAB" };
+		std::size_t at{ step.empty() ? std::string_view::npos : kSteps.find(step[0]) };
+		return at == std::string_view::npos ? -1 : static_cast<int>(at);
+	}
+
+	static int typeOf(std::string_view type)
+	{
+		static constexpr std::string_view kTypes[]{ "breve", "whole", "half", "quarter", "eighth", "16th", "32nd", "64th", "128th" };
+		for (int i{ 0 }; i < 9; ++i)
+		{
+			if (type == kTypes[i])
+			{
+				return i;
+			}
+		}
+		return type == "long" || type == "maxima" ? 0 : type.empty() ? -1 : 8;
+	}
+
+	// the type a note of duration would be written as, for files that leave it out
+	int typeOfDuration(int duration) const
+	{
+		int type{ 3 };
+		int quarter{ m_divisions };
+		while (type > 0 && duration >= 2 * quarter)
+		{
+			--type;
+			quarter *= 2;
+		}
+		quarter = m_divisions;
+		while (type < 8 && duration * 2 <= quarter && duration > 0)
+		{
+			++type;
+			quarter /= 2;
+		}
+		return type;
+	}
+
+	// The accidental a pitched note shows: its own, or where it has none and the key or an accidental earlier
+	// in the measure would read as another alter, the one that spells its pitch, so the pitch survives
+	// reading the page back. An accidental lasts the rest of the measure on its staff's line or space.
+	wchar_t accidentalFor(const NoteState& note, std::uint32_t staff)
+	{
+		char sign{ m_clefs[staff].sign };
+		if (sign == 'P' || sign == 'T' || sign == 'N')
+		{
+			return note.accidental;
+		}
+
+		std::vector<std::pair<int, int>>& alters{ m_alters[staff] };
+		int pitch{ note.octave * 7 + note.step };
+		auto earlier{ std::find_if(alters.begin(), alters.end(), [pitch](const std::pair<int, int>& a) { return a.first == pitch; }) };
+		int shown{ earlier != alters.end() ? earlier->second : keyAlter(m_fifths[staff], note.step) };
+		wchar_t accidental{ note.accidental };
+		if (accidental == 0 && note.alter != shown)
+		{
+			accidental = note.alter == -2 ? 0xE264 : note.alter == -1 ? 0xE260 : note.alter == 0 ? 0xE261 : note.alter == 1 ? 0xE262 : note.alter == 2 ? 0xE263 : 0;
+		}
+		if (accidental == 0)
+		{
+			return 0;
+		}
+
+		int alter{ accidental == 0xE264 ? -2 : accidental == 0xE260 ? -1 : accidental == 0xE262 ? 1 : accidental == 0xE263 ? 2 : 0 };
+		if (earlier != alters.end())
+		{
+			earlier->second = alter;
+		}
+		else
+		{
+			alters.emplace_back(pitch, alter);
+		}
+		return accidental;
+	}
+
+	// the alter the key gives a step: sharps from F up in fifths, flats from B down
+	static int keyAlter(int fifths, int step)
+	{
+		static constexpr int kSharpOrder[7]{ 3, 0, 4, 1, 5, 2, 6 };
+		static constexpr int kFlatOrder[7]{ 6, 2, 5, 1, 4, 0, 3 };
+		for (int i{ 0 }; i < (std::min)(std::abs(fifths), 7); ++i)
+		{
+			if ((fifths > 0 ? kSharpOrder[i] : kFlatOrder[i]) == step)
+			{
+				return fifths > 0 ? 1 : -1;
+			}
+		}
+		return 0;
+	}
+
+	static wchar_t accidentalOf(std::string_view accidental)
+	{
+		if (accidental == "sharp") return 0xE262;
+		if (accidental == "flat") return 0xE260;
+		if (accidental == "natural") return 0xE261;
+		if (accidental == "double-sharp" || accidental == "sharp-sharp") return 0xE263;
+		if (accidental == "flat-flat") return 0xE264;
+		return 0;
+	}
+
+	static int toInt(std::string_view text)
+	{
+		int sign{ 1 };
+		std::size_t at{ 0 };
+		while (at < text.size() && (text[at] == ' ' || text[at] == '+'))
+		{
+			++at;
+		}
+		if (at < text.size() && text[at] == '-')
+		{
+			sign = -1;
+			++at;
+		}
+
+		int value{ 0 };
+		while (at < text.size() && text[at] >= '0' && text[at] <= '9' && value < 100000000)
+		{
+			value = value * 10 + (text[at++] - '0');
+		}
+		return sign * value;
+	}
+
+	static std::string_view trim(std::string_view text)
+	{
+		while (!text.empty() && (text.front() == ' ' || text.front() == '\t' || text.front() == '\r' || text.front() == '\n'))
+		{
+			text.remove_prefix(1);
+		}
+		while (!text.empty() && (text.back() == ' ' || text.back() == '\t' || text.back() == '\r' || text.back() == '\n'))
+		{
+			text.remove_suffix(1);
+		}
+		return text;
+	}
+
+	// UTF-8 to wchar_t, UTF-16 where it's 16 bits; bytes that aren't UTF-8 become U+FFFD
+	static std::wstring widen(std::string_view utf8)
+	{
+		std::wstring wide;
+		wide.reserve(utf8.size());
+		std::size_t at{ 0 };
+		while (at < utf8.size())
+		{
+			unsigned char lead{ static_cast<unsigned char>(utf8[at]) };
+			int length{ lead < 0x80 ? 1 : (lead >> 5) == 6 ? 2 : (lead >> 4) == 14 ? 3 : (lead >> 3) == 30 ? 4 : 0 };
+			std::uint32_t codePoint{ length == 1 ? lead : length == 2 ? lead & 0x1Fu : length == 3 ? lead & 0x0Fu : lead & 0x07u };
+			bool valid{ length > 0 && at + length <= utf8.size() };
+			for (int i{ 1 }; valid && i < length; ++i)
+			{
+				unsigned char next{ static_cast<unsigned char>(utf8[at + i]) };
+				valid = (next & 0xC0) == 0x80;
+				codePoint = (codePoint << 6) | (next & 0x3Fu);
+			}
+			if (!valid || codePoint > 0x10FFFF)
+			{
+				codePoint = 0xFFFD;
+				length = 1;
+			}
+			at += static_cast<std::size_t>(length);
+
+			if (sizeof(wchar_t) == 2 && codePoint >= 0x10000)
+			{
+				wide += static_cast<wchar_t>(0xD800 + ((codePoint - 0x10000) >> 10));
+				wide += static_cast<wchar_t>(0xDC00 + ((codePoint - 0x10000) & 0x3FF));
+			}
+			else
+			{
+				wide += static_cast<wchar_t>(codePoint);
+			}
+		}
+		return wide;
+	}
+};
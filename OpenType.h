@@ -0,0 +1,1087 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <utility>
+#include <vector>
+
+// receives a glyph outline in font units, y up
+class OutlineSink
+{
+public:
+	virtual void moveTo(float x, float y) = 0;
+	virtual void lineTo(float x, float y) = 0;
+	virtual void cubicTo(float x1, float y1, float x2, float y2, float x, float y) = 0;
+	virtual void closePath() = 0;
+	virtual ~OutlineSink() = default;
+};
+
+// Tight outline bounds, including the extrema of curves that bulge past their end points.
+class OutlineBounds : public OutlineSink
+{
+public:
+	void moveTo(float x, float y) override { addPoint(x, y); m_x = x; m_y = y; }
+	void lineTo(float x, float y) override { addPoint(x, y); m_x = x; m_y = y; }
+
+	void cubicTo(float x1, float y1, float x2, float y2, float x, float y) override
+	{
+		addPoint(x, y);
+		addExtrema(m_x, x1, x2, x, m_y, y1, y2, y);
+		m_x = x;
+		m_y = y;
+	}
+
+	void closePath() override {}
+
+	bool isEmpty() const { return m_empty; }
+	float getXMin() const { return m_xMin; }
+	float getYMin() const { return m_yMin; }
+	float getXMax() const { return m_xMax; }
+	float getYMax() const { return m_yMax; }
+
+private:
+	bool m_empty{ true };
+	float m_xMin{ 0.0f };
+	float m_yMin{ 0.0f };
+	float m_xMax{ 0.0f };
+	float m_yMax{ 0.0f };
+	float m_x{ 0.0f };
+	float m_y{ 0.0f };
+
+	void addPoint(float x, float y)
+	{
+		if (m_empty)
+		{
+			m_xMin = m_xMax = x;
+			m_yMin = m_yMax = y;
+			m_empty = false;
+			return;
+		}
+
+		m_xMin = (std::min)(m_xMin, x);
+		m_xMax = (std::max)(m_xMax, x);
+		m_yMin = (std::min)(m_yMin, y);
+		m_yMax = (std::max)(m_yMax, y);
+	}
+
+	static float cubicAt(float p0, float p1, float p2, float p3, float t)
+	{
+		float u{ 1.0f - t };
+		return u * u * u * p0 + 3.0f * u * u * t * p1 + 3.0f * u * t * t * p2 + t * t * t * p3;
+	}
+
+	// roots of the derivative of one coordinate of the curve, each in [0, 1]
+	static int extremaOf(float p0, float p1, float p2, float p3, float* t)
+	{
+		float a{ -p0 + 3.0f * p1 - 3.0f * p2 + p3 };
+		float b{ 2.0f * (p0 - 2.0f * p1 + p2) };
+		float c{ p1 - p0 };
+		int count{ 0 };
+
+		if (std::abs(a) < 1e-6f)
+		{
+			if (std::abs(b) > 1e-6f)
+			{
+				t[count++] = -c / b;
+			}
+		}
+		else
+		{
+			float disc{ b * b - 4.0f * a * c };
+			if (disc >= 0.0f)
+			{
+				float root{ std::sqrt(disc) };
+				t[count++] = (-b + root) / (2.0f * a);
+				t[count++] = (-b - root) / (2.0f * a);
+			}
+		}
+
+		int kept{ 0 };
+		for (int i{ 0 }; i < count; ++i)
+		{
+			if (t[i] > 0.0f && t[i] < 1.0f)
+			{
+				t[kept++] = t[i];
+			}
+		}
+		return kept;
+	}
+
+	void addExtrema(float x0, float x1, float x2, float x3, float y0, float y1, float y2, float y3)
+	{
+		float t[2];
+
+		int n{ extremaOf(x0, x1, x2, x3, t) };
+		for (int i{ 0 }; i < n; ++i)
+		{
+			addPoint(cubicAt(x0, x1, x2, x3, t[i]), cubicAt(y0, y1, y2, y3, t[i]));
+		}
+
+		n = extremaOf(y0, y1, y2, y3, t);
+		for (int i{ 0 }; i < n; ++i)
+		{
+			addPoint(cubicAt(x0, x1, x2, x3, t[i]), cubicAt(y0, y1, y2, y3, t[i]));
+		}
+	}
+};
+
+// Read-only view over an OpenType font with CFF outlines, like Leland.otf. It reads the cmap, glyph
+// names from the CFF charset, and outlines from the Type 2 charstrings. Every read is bounds-checked,
+// because the bytes come from disk. The font data must outlive the view.
+class OpenTypeFont
+{
+public:
+	bool open(const std::uint8_t* data, std::size_t size)
+	{
+		m_data = data;
+		m_size = size;
+
+		if (size < 12)
+		{
+			return false;
+		}
+
+		std::uint32_t version{ u32(0) };
+		if (version != 0x4F54544F && version != 0x00010000) // 'OTTO' or TrueType
+		{
+			return false;
+		}
+
+		std::uint16_t numTables{ u16(4) };
+		for (std::uint16_t i{ 0 }; i < numTables; ++i)
+		{
+			std::size_t record{ 12 + static_cast<std::size_t>(i) * 16 };
+			if (record + 16 > size)
+			{
+				return false;
+			}
+
+			std::uint32_t tag{ u32(record) };
+			std::uint32_t offset{ u32(record + 8) };
+			std::uint32_t length{ u32(record + 12) };
+			if (static_cast<std::size_t>(offset) + length > size)
+			{
+				return false;
+			}
+
+			if (tag == tagOf("head"))
+			{
+				m_head = offset;
+			}
+			else if (tag == tagOf("cmap"))
+			{
+				m_cmap = offset;
+				m_cmapLength = length;
+			}
+			else if (tag == tagOf("CFF "))
+			{
+				m_cff = offset;
+				m_cffLength = length;
+			}
+			else if (tag == tagOf("hhea") && length >= 36)
+			{
+				m_hhea = offset;
+			}
+			else if (tag == tagOf("hmtx"))
+			{
+				m_hmtx = offset;
+				m_hmtxLength = length;
+			}
+			else if (tag == tagOf("OS/2") && length >= 78)
+			{
+				m_os2 = offset;
+			}
+		}
+
+		if (!m_head || !m_cmap || !m_cff || !inRange(m_head, 54))
+		{
+			return false;
+		}
+
+		m_unitsPerEm = u16(m_head + 18);
+
+		return openCmap() && openCff();
+	}
+
+	int getUnitsPerEm() const { return m_unitsPerEm; }
+	std::size_t getGlyphCount() const { return m_charStrings.count; }
+
+	// the cell ascent GDI lays text out with: OS/2 usWinAscent, else the hhea ascender, else the em
+	int getAscender() const
+	{
+		if (m_os2)
+		{
+			return u16(m_os2 + 74);
+		}
+		if (m_hhea)
+		{
+			return static_cast<std::int16_t>(u16(m_hhea + 4));
+		}
+		return m_unitsPerEm;
+	}
+
+	// horizontal advance from hmtx; glyphs past numberOfHMetrics share the last advance
+	int getAdvance(std::uint16_t glyph) const
+	{
+		if (!m_hhea || !m_hmtx)
+		{
+			return m_unitsPerEm;
+		}
+
+		std::size_t metrics{ u16(m_hhea + 34) };
+		if (metrics == 0)
+		{
+			return m_unitsPerEm;
+		}
+
+		std::size_t at{ m_hmtx + 4 * (std::min)(static_cast<std::size_t>(glyph), metrics - 1) };
+		return at + 2 <= m_hmtx + m_hmtxLength ? u16(at) : m_unitsPerEm;
+	}
+
+	// glyph for one code point, 0 (.notdef) if the cmap doesn't map it
+	std::uint16_t getGlyph(std::uint32_t codePoint) const
+	{
+		std::vector<std::pair<std::uint32_t, std::uint16_t>> mapped;
+		getCharacterMap(codePoint, codePoint, mapped);
+		return mapped.empty() ? 0 : mapped.front().second;
+	}
+
+	// every (code point, glyph) pair the cmap maps within [first, last], in code point order
+	void getCharacterMap(std::uint32_t first, std::uint32_t last, std::vector<std::pair<std::uint32_t, std::uint16_t>>& out) const
+	{
+		out.clear();
+
+		if (m_cmapFormat == 12)
+		{
+			std::uint32_t groups{ u32(m_cmapSubtable + 12) };
+			for (std::uint32_t g{ 0 }; g < groups; ++g)
+			{
+				std::size_t group{ m_cmapSubtable + 16 + static_cast<std::size_t>(g) * 12 };
+				if (!inRange(group, 12))
+				{
+					break;
+				}
+
+				std::uint32_t start{ u32(group) };
+				std::uint32_t end{ u32(group + 4) };
+				std::uint32_t glyph{ u32(group + 8) };
+				for (std::uint32_t cp{ (std::max)(start, first) }; cp <= (std::min)(end, last); ++cp)
+				{
+					out.emplace_back(cp, static_cast<std::uint16_t>(glyph + (cp - start)));
+				}
+			}
+			return;
+		}
+
+		// format 4: parallel arrays of segment ends, starts, deltas and range offsets
+		std::size_t segCount{ static_cast<std::size_t>(u16(m_cmapSubtable + 6) / 2) };
+		std::size_t ends{ m_cmapSubtable + 14 };
+		std::size_t starts{ ends + segCount * 2 + 2 };
+		std::size_t deltas{ starts + segCount * 2 };
+		std::size_t rangeOffsets{ deltas + segCount * 2 };
+
+		for (std::size_t s{ 0 }; s < segCount; ++s)
+		{
+			std::uint32_t end{ u16(ends + s * 2) };
+			std::uint32_t start{ u16(starts + s * 2) };
+			std::uint16_t delta{ u16(deltas + s * 2) };
+			std::size_t rangeOffsetAt{ rangeOffsets + s * 2 };
+			std::uint16_t rangeOffset{ u16(rangeOffsetAt) };
+
+			for (std::uint32_t cp{ (std::max)(start, first) }; cp <= (std::min)(end, last); ++cp)
+			{
+				if (cp == 0xFFFF)
+				{
+					break;
+				}
+
+				std::uint16_t glyph{ 0 };
+				if (rangeOffset == 0)
+				{
+					glyph = static_cast<std::uint16_t>(cp + delta);
+				}
+				else
+				{
+					std::size_t at{ rangeOffsetAt + rangeOffset + (cp - start) * 2 };
+					glyph = inRange(at, 2) ? u16(at) : 0;
+					if (glyph != 0)
+					{
+						glyph = static_cast<std::uint16_t>(glyph + delta);
+					}
+				}
+
+				if (glyph != 0)
+				{
+					out.emplace_back(cp, glyph);
+				}
+			}
+		}
+	}
+
+	std::string getGlyphName(std::uint16_t glyph) const
+	{
+		if (glyph == 0)
+		{
+			return ".notdef";
+		}
+
+		std::uint16_t sid{ charsetSid(glyph) };
+
+		// glyph names in the CFF standard strings are plain Latin ones; SMuFL names are all custom strings
+		if (sid < kStandardStrings)
+		{
+			return std::string{};
+		}
+
+		std::size_t offset{ 0 };
+		std::size_t length{ 0 };
+		if (!indexItem(m_strings, sid - kStandardStrings, offset, length))
+		{
+			return std::string{};
+		}
+
+		return std::string(reinterpret_cast<const char*>(m_data + offset), length);
+	}
+
+	// plays the glyph's charstring into sink; false if the glyph doesn't exist or the charstring is malformed
+	bool getOutline(std::uint16_t glyph, OutlineSink& sink) const
+	{
+		std::size_t offset{ 0 };
+		std::size_t length{ 0 };
+		if (!indexItem(m_charStrings, glyph, offset, length))
+		{
+			return false;
+		}
+
+		CharStringState state{ sink };
+		bool ok{ runCharString(offset, length, state, 0) };
+		if (state.open)
+		{
+			sink.closePath();
+		}
+		return ok;
+	}
+
+private:
+	// CFF INDEX: count, offset size and the absolute position of the offset array and the data
+	struct Index
+	{
+		std::size_t count{ 0 };
+		std::size_t offSize{ 0 };
+		std::size_t offsets{ 0 };
+		std::size_t data{ 0 };
+		std::size_t end{ 0 };
+	};
+
+	struct CharStringState
+	{
+		explicit CharStringState(OutlineSink& s) : sink(s) {}
+
+		OutlineSink& sink;
+		float stack[48]{};
+		int sp{ 0 };
+		float x{ 0.0f };
+		float y{ 0.0f };
+		int stems{ 0 };
+		bool sawWidth{ false };
+		bool open{ false };
+		bool ended{ false };
+	};
+
+	static constexpr std::uint16_t kStandardStrings{ 391 };
+
+	const std::uint8_t* m_data{ nullptr };
+	std::size_t m_size{ 0 };
+
+	std::size_t m_head{ 0 };
+	std::size_t m_cmap{ 0 };
+	std::size_t m_cmapLength{ 0 };
+	std::size_t m_cmapSubtable{ 0 };
+	int m_cmapFormat{ 0 };
+	std::size_t m_cff{ 0 };
+	std::size_t m_cffLength{ 0 };
+	std::size_t m_hhea{ 0 };
+	std::size_t m_hmtx{ 0 };
+	std::size_t m_hmtxLength{ 0 };
+	std::size_t m_os2{ 0 };
+	int m_unitsPerEm{ 1000 };
+
+	Index m_strings;
+	Index m_globalSubrs;
+	Index m_charStrings;
+	Index m_localSubrs;
+	std::size_t m_charset{ 0 };
+
+	static constexpr std::uint32_t tagOf(const char (&tag)[5])
+	{
+		return (static_cast<std::uint32_t>(static_cast<std::uint8_t>(tag[0])) << 24) | (static_cast<std::uint32_t>(static_cast<std::uint8_t>(tag[1])) << 16) |
+			(static_cast<std::uint32_t>(static_cast<std::uint8_t>(tag[2])) << 8) | static_cast<std::uint32_t>(static_cast<std::uint8_t>(tag[3]));
+	}
+
+	bool inRange(std::size_t offset, std::size_t length) const { return offset <= m_size && length <= m_size - offset; }
+
+	std::uint8_t u8(std::size_t offset) const { return inRange(offset, 1) ? m_data[offset] : 0; }
+	std::uint16_t u16(std::size_t offset) const { return inRange(offset, 2) ? static_cast<std::uint16_t>((m_data[offset] << 8) | m_data[offset + 1]) : 0; }
+
+	std::uint32_t u32(std::size_t offset) const
+	{
+		return inRange(offset, 4) ? (static_cast<std::uint32_t>(m_data[offset]) << 24) | (static_cast<std::uint32_t>(m_data[offset + 1]) << 16) |
+			(static_cast<std::uint32_t>(m_data[offset + 2]) << 8) | m_data[offset + 3] : 0;
+	}
+
+	std::uint32_t offsetN(std::size_t offset, std::size_t size) const
+	{
+		std::uint32_t value{ 0 };
+		for (std::size_t i{ 0 }; i < size; ++i)
+		{
+			value = (value << 8) | u8(offset + i);
+		}
+		return value;
+	}
+
+	bool openCmap()
+	{
+		// prefer the full-repertoire Windows subtable, then the BMP one, then Unicode platform ones
+		std::size_t best{ 0 };
+		int bestRank{ 0 };
+
+		std::uint16_t count{ u16(m_cmap + 2) };
+		for (std::uint16_t i{ 0 }; i < count; ++i)
+		{
+			std::size_t record{ m_cmap + 4 + static_cast<std::size_t>(i) * 8 };
+			std::uint16_t platform{ u16(record) };
+			std::uint16_t encoding{ u16(record + 2) };
+			std::size_t subtable{ m_cmap + u32(record + 4) };
+			std::uint16_t format{ u16(subtable) };
+
+			int rank{ 0 };
+			if (format == 12 && (platform == 3 || platform == 0))
+			{
+				rank = 3;
+			}
+			else if (format == 4 && platform == 3 && encoding == 1)
+			{
+				rank = 2;
+			}
+			else if (format == 4 && platform == 0)
+			{
+				rank = 1;
+			}
+
+			if (rank > bestRank && inRange(subtable, 16))
+			{
+				best = subtable;
+				bestRank = rank;
+			}
+		}
+
+		if (!bestRank)
+		{
+			return false;
+		}
+
+		m_cmapSubtable = best;
+		m_cmapFormat = u16(best);
+		return true;
+	}
+
+	bool readIndex(std::size_t offset, Index& index) const
+	{
+		index = Index{};
+		if (!inRange(offset, 2))
+		{
+			return false;
+		}
+
+		index.count = u16(offset);
+		if (index.count == 0)
+		{
+			index.end = offset + 2;
+			return true;
+		}
+
+		index.offSize = u8(offset + 2);
+		if (index.offSize < 1 || index.offSize > 4)
+		{
+			return false;
+		}
+
+		index.offsets = offset + 3;
+		index.data = index.offsets + (index.count + 1) * index.offSize - 1; // offsets are 1-based
+		index.end = index.data + offsetN(index.offsets + index.count * index.offSize, index.offSize);
+		return inRange(index.offsets, (index.count + 1) * index.offSize) && index.end <= m_size;
+	}
+
+	bool indexItem(const Index& index, std::size_t item, std::size_t& offset, std::size_t& length) const
+	{
+		if (item >= index.count)
+		{
+			return false;
+		}
+
+		std::uint32_t start{ offsetN(index.offsets + item * index.offSize, index.offSize) };
+		std::uint32_t end{ offsetN(index.offsets + (item + 1) * index.offSize, index.offSize) };
+		if (end < start || index.data + end > index.end)
+		{
+			return false;
+		}
+
+		offset = index.data + start;
+		length = end - start;
+		return true;
+	}
+
+	// one DICT operand; advances pos
+	bool readDictOperand(std::size_t& pos, std::size_t end, double& value) const
+	{
+		std::uint8_t b0{ u8(pos) };
+
+		if (b0 >= 32 && b0 <= 246)
+		{
+			value = b0 - 139;
+			pos += 1;
+		}
+		else if (b0 >= 247 && b0 <= 250)
+		{
+			value = (b0 - 247) * 256 + u8(pos + 1) + 108;
+			pos += 2;
+		}
+		else if (b0 >= 251 && b0 <= 254)
+		{
+			value = -(b0 - 251) * 256 - u8(pos + 1) - 108;
+			pos += 2;
+		}
+		else if (b0 == 28)
+		{
+			value = static_cast<std::int16_t>(u16(pos + 1));
+			pos += 3;
+		}
+		else if (b0 == 29)
+		{
+			value = static_cast<std::int32_t>(u32(pos + 1));
+			pos += 5;
+		}
+		else if (b0 == 30)
+		{
+			// real number packed in nibbles; none of the operators read here take one, so just skip it
+			value = 0;
+			++pos;
+			while (pos < end)
+			{
+				std::uint8_t b{ u8(pos++) };
+				if ((b & 0x0F) == 0x0F || (b >> 4) == 0x0F)
+				{
+					break;
+				}
+			}
+		}
+		else
+		{
+			return false;
+		}
+
+		return true;
+	}
+
+	// walks a DICT and hands every (operator, operands) pair to visit; two-byte operators are 1200 + b1
+	template <typename Visit>
+	void readDict(std::size_t offset, std::size_t length, Visit visit) const
+	{
+		double operands[48];
+		int count{ 0 };
+		std::size_t pos{ offset };
+		std::size_t end{ offset + length };
+
+		while (pos < end)
+		{
+			std::uint8_t b0{ u8(pos) };
+			if (b0 <= 21)
+			{
+				int op{ b0 };
+				++pos;
+				if (b0 == 12)
+				{
+					op = 1200 + u8(pos);
+					++pos;
+				}
+
+				visit(op, operands, count);
+				count = 0;
+			}
+			else
+			{
+				double value{ 0 };
+				if (!readDictOperand(pos, end, value))
+				{
+					return;
+				}
+				if (count < 48)
+				{
+					operands[count++] = value;
+				}
+			}
+		}
+	}
+
+	bool openCff()
+	{
+		std::size_t cff{ m_cff };
+		std::uint8_t headerSize{ u8(cff + 2) };
+
+		Index names;
+		Index topDicts;
+		if (!readIndex(cff + headerSize, names) || !readIndex(names.end, topDicts) || !readIndex(topDicts.end, m_strings) ||
+			!readIndex(m_strings.end, m_globalSubrs))
+		{
+			return false;
+		}
+
+		std::size_t topOffset{ 0 };
+		std::size_t topLength{ 0 };
+		if (!indexItem(topDicts, 0, topOffset, topLength))
+		{
+			return false;
+		}
+
+		std::size_t charStrings{ 0 };
+		std::size_t privateSize{ 0 };
+		std::size_t privateOffset{ 0 };
+		bool cidKeyed{ false };
+
+		readDict(topOffset, topLength, [&](int op, const double* operands, int count) {
+			if (op == 15 && count > 0)
+			{
+				m_charset = static_cast<std::size_t>(operands[0]);
+			}
+			else if (op == 17 && count > 0)
+			{
+				charStrings = static_cast<std::size_t>(operands[0]);
+			}
+			else if (op == 18 && count > 1)
+			{
+				privateSize = static_cast<std::size_t>(operands[0]);
+				privateOffset = static_cast<std::size_t>(operands[1]);
+			}
+			else if (op == 1230)
+			{
+				cidKeyed = true;
+			}
+		});
+
+		// SMuFL fonts are name-keyed; CID-keyed fonts would need FDSelect to find their local subrs
+		if (cidKeyed || !charStrings || !readIndex(cff + charStrings, m_charStrings))
+		{
+			return false;
+		}
+
+		if (privateSize && inRange(cff + privateOffset, privateSize))
+		{
+			std::size_t subrs{ 0 };
+			readDict(cff + privateOffset, privateSize, [&](int op, const double* operands, int count) {
+				if (op == 19 && count > 0)
+				{
+					subrs = static_cast<std::size_t>(operands[0]);
+				}
+			});
+
+			if (subrs && !readIndex(cff + privateOffset + subrs, m_localSubrs))
+			{
+				return false;
+			}
+		}
+
+		// charset offsets 0-2 name predefined Latin charsets, which carry no SMuFL names
+		if (m_charset > 2)
+		{
+			m_charset += cff;
+		}
+		else
+		{
+			m_charset = 0;
+		}
+
+		return true;
+	}
+
+	std::uint16_t charsetSid(std::uint16_t glyph) const
+	{
+		if (!m_charset)
+		{
+			return 0;
+		}
+
+		std::uint8_t format{ u8(m_charset) };
+		std::size_t pos{ m_charset + 1 };
+
+		if (format == 0)
+		{
+			return u16(pos + (static_cast<std::size_t>(glyph) - 1) * 2);
+		}
+
+		// formats 1 and 2 are runs of consecutive SIDs, with an 8- or 16-bit count of extra glyphs
+		std::size_t current{ 1 };
+		while (current < m_charStrings.count && inRange(pos, format == 1 ? 3 : 4))
+		{
+			std::uint16_t first{ u16(pos) };
+			std::size_t left{ static_cast<std::size_t>(format == 1 ? u8(pos + 2) : u16(pos + 2)) };
+			pos += format == 1 ? 3 : 4;
+
+			if (glyph <= current + left)
+			{
+				return static_cast<std::uint16_t>(first + (glyph - current));
+			}
+			current += left + 1;
+		}
+
+		return 0;
+	}
+
+	static int subrBias(std::size_t count)
+	{
+		return count < 1240 ? 107 : count < 33900 ? 1131 : 32768;
+	}
+
+	// the first stack-clearing operator may carry the advance width as an extra leading argument
+	static int skipWidth(CharStringState& st, bool hasExtra)
+	{
+		int first{ 0 };
+		if (!st.sawWidth && hasExtra)
+		{
+			first = 1;
+		}
+		st.sawWidth = true;
+		return first;
+	}
+
+	static void moveTo(CharStringState& st, float dx, float dy)
+	{
+		if (st.open)
+		{
+			st.sink.closePath();
+		}
+		st.x += dx;
+		st.y += dy;
+		st.sink.moveTo(st.x, st.y);
+		st.open = true;
+	}
+
+	static void lineTo(CharStringState& st, float dx, float dy)
+	{
+		st.x += dx;
+		st.y += dy;
+		st.sink.lineTo(st.x, st.y);
+	}
+
+	static void curveTo(CharStringState& st, float dx1, float dy1, float dx2, float dy2, float dx3, float dy3)
+	{
+		float x1{ st.x + dx1 };
+		float y1{ st.y + dy1 };
+		float x2{ x1 + dx2 };
+		float y2{ y1 + dy2 };
+		st.x = x2 + dx3;
+		st.y = y2 + dy3;
+		st.sink.cubicTo(x1, y1, x2, y2, st.x, st.y);
+	}
+
+	bool runCharString(std::size_t offset, std::size_t length, CharStringState& st, int depth) const
+	{
+		// the Type 2 spec caps subroutine nesting at 10
+		if (depth > 10 || !inRange(offset, length))
+		{
+			return false;
+		}
+
+		std::size_t pos{ offset };
+		std::size_t end{ offset + length };
+		float* s{ st.stack };
+
+		while (pos < end && !st.ended)
+		{
+			std::uint8_t b0{ m_data[pos++] };
+
+			if (b0 >= 32 || b0 == 28)
+			{
+				float value{ 0.0f };
+				if (b0 == 28)
+				{
+					value = static_cast<std::int16_t>(u16(pos));
+					pos += 2;
+				}
+				else if (b0 <= 246)
+				{
+					value = static_cast<float>(b0 - 139);
+				}
+				else if (b0 <= 250)
+				{
+					value = static_cast<float>((b0 - 247) * 256 + u8(pos++) + 108);
+				}
+				else if (b0 <= 254)
+				{
+					value = static_cast<float>(-(b0 - 251) * 256 - u8(pos++) - 108);
+				}
+				else
+				{
+					value = static_cast<std::int32_t>(u32(pos)) / 65536.0f;
+					pos += 4;
+				}
+
+				if (st.sp >= 48)
+				{
+					return false;
+				}
+				s[st.sp++] = value;
+				continue;
+			}
+
+			int sp{ st.sp };
+
+			switch (b0)
+			{
+			case 1: // hstem
+			case 3: // vstem
+			case 18: // hstemhm
+			case 23: // vstemhm
+			{
+				int first{ skipWidth(st, sp % 2 == 1) };
+				st.stems += (sp - first) / 2;
+				st.sp = 0;
+				break;
+			}
+			case 19: // hintmask
+			case 20: // cntrmask
+			{
+				// arguments here are an implied vstemhm
+				int first{ skipWidth(st, sp % 2 == 1) };
+				st.stems += (sp - first) / 2;
+				st.sp = 0;
+				pos += (st.stems + 7) / 8;
+				break;
+			}
+			case 21: // rmoveto
+			{
+				int first{ skipWidth(st, sp > 2) };
+				if (sp - first < 2)
+				{
+					return false;
+				}
+				moveTo(st, s[first], s[first + 1]);
+				st.sp = 0;
+				break;
+			}
+			case 22: // hmoveto
+			case 4: // vmoveto
+			{
+				int first{ skipWidth(st, sp > 1) };
+				if (sp - first < 1)
+				{
+					return false;
+				}
+				moveTo(st, b0 == 22 ? s[first] : 0.0f, b0 == 22 ? 0.0f : s[first]);
+				st.sp = 0;
+				break;
+			}
+			case 5: // rlineto
+				for (int i{ 0 }; i + 1 < sp; i += 2)
+				{
+					lineTo(st, s[i], s[i + 1]);
+				}
+				st.sp = 0;
+				break;
+			case 6: // hlineto
+			case 7: // vlineto
+			{
+				bool horizontal{ b0 == 6 };
+				for (int i{ 0 }; i < sp; ++i)
+				{
+					lineTo(st, horizontal ? s[i] : 0.0f, horizontal ? 0.0f : s[i]);
+					horizontal = !horizontal;
+				}
+				st.sp = 0;
+				break;
+			}
+			case 8: // rrcurveto
+				for (int i{ 0 }; i + 5 < sp; i += 6)
+				{
+					curveTo(st, s[i], s[i + 1], s[i + 2], s[i + 3], s[i + 4], s[i + 5]);
+				}
+				st.sp = 0;
+				break;
+			case 24: // rcurveline
+			{
+				int i{ 0 };
+				for (; i + 7 < sp; i += 6)
+				{
+					curveTo(st, s[i], s[i + 1], s[i + 2], s[i + 3], s[i + 4], s[i + 5]);
+				}
+				if (i + 1 < sp)
+				{
+					lineTo(st, s[i], s[i + 1]);
+				}
+				st.sp = 0;
+				break;
+			}
+			case 25: // rlinecurve
+			{
+				int i{ 0 };
+				for (; i + 7 < sp; i += 2)
+				{
+					lineTo(st, s[i], s[i + 1]);
+				}
+				if (i + 5 < sp)
+				{
+					curveTo(st, s[i], s[i + 1], s[i + 2], s[i + 3], s[i + 4], s[i + 5]);
+				}
+				st.sp = 0;
+				break;
+			}
+			case 26: // vvcurveto
+			{
+				int i{ 0 };
+				float dx1{ 0.0f };
+				if (sp % 2 == 1)
+				{
+					dx1 = s[i++];
+				}
+				for (; i + 3 < sp; i += 4)
+				{
+					curveTo(st, dx1, s[i], s[i + 1], s[i + 2], 0.0f, s[i + 3]);
+					dx1 = 0.0f;
+				}
+				st.sp = 0;
+				break;
+			}
+			case 27: // hhcurveto
+			{
+				int i{ 0 };
+				float dy1{ 0.0f };
+				if (sp % 2 == 1)
+				{
+					dy1 = s[i++];
+				}
+				for (; i + 3 < sp; i += 4)
+				{
+					curveTo(st, s[i], dy1, s[i + 1], s[i + 2], s[i + 3], 0.0f);
+					dy1 = 0.0f;
+				}
+				st.sp = 0;
+				break;
+			}
+			case 30: // vhcurveto
+			case 31: // hvcurveto
+			{
+				bool horizontal{ b0 == 31 };
+				for (int i{ 0 }; i + 3 < sp; i += 4)
+				{
+					// the very last curve may carry one extra argument for its final off-axis delta
+					float last{ (sp - i == 5) ? s[i + 4] : 0.0f };
+					if (horizontal)
+					{
+						curveTo(st, s[i], 0.0f, s[i + 1], s[i + 2], last, s[i + 3]);
+					}
+					else
+					{
+						curveTo(st, 0.0f, s[i], s[i + 1], s[i + 2], s[i + 3], last);
+					}
+					horizontal = !horizontal;
+				}
+				st.sp = 0;
+				break;
+			}
+			case 10: // callsubr
+			case 29: // callgsubr
+			{
+				if (sp < 1)
+				{
+					return false;
+				}
+
+				const Index& subrs{ b0 == 10 ? m_localSubrs : m_globalSubrs };
+				int number{ static_cast<int>(s[--st.sp]) + subrBias(subrs.count) };
+
+				std::size_t subrOffset{ 0 };
+				std::size_t subrLength{ 0 };
+				if (number < 0 || !indexItem(subrs, static_cast<std::size_t>(number), subrOffset, subrLength) ||
+					!runCharString(subrOffset, subrLength, st, depth + 1))
+				{
+					return false;
+				}
+				break;
+			}
+			case 11: // return
+				return true;
+			case 14: // endchar
+				skipWidth(st, sp == 1 || sp == 5);
+				if (st.open)
+				{
+					st.sink.closePath();
+					st.open = false;
+				}
+				st.sp = 0;
+				st.ended = true;
+				return true;
+			case 12:
+			{
+				std::uint8_t b1{ u8(pos++) };
+				switch (b1)
+				{
+				case 35: // flex
+					if (sp < 12)
+					{
+						return false;
+					}
+					curveTo(st, s[0], s[1], s[2], s[3], s[4], s[5]);
+					curveTo(st, s[6], s[7], s[8], s[9], s[10], s[11]);
+					break;
+				case 34: // hflex
+					if (sp < 7)
+					{
+						return false;
+					}
+					curveTo(st, s[0], 0.0f, s[1], s[2], s[3], 0.0f);
+					curveTo(st, s[4], 0.0f, s[5], -s[2], s[6], 0.0f);
+					break;
+				case 36: // hflex1
+					if (sp < 9)
+					{
+						return false;
+					}
+					curveTo(st, s[0], s[1], s[2], s[3], s[4], 0.0f);
+					curveTo(st, s[5], 0.0f, s[6], s[7], s[8], -(s[1] + s[3] + s[7]));
+					break;
+				case 37: // flex1
+				{
+					if (sp < 11)
+					{
+						return false;
+					}
+					float dx{ s[0] + s[2] + s[4] + s[6] + s[8] };
+					float dy{ s[1] + s[3] + s[5] + s[7] + s[9] };
+					curveTo(st, s[0], s[1], s[2], s[3], s[4], s[5]);
+					if (std::abs(dx) > std::abs(dy))
+					{
+						curveTo(st, s[6], s[7], s[8], s[9], s[10], -dy);
+					}
+					else
+					{
+						curveTo(st, s[6], s[7], s[8], s[9], -dx, s[10]);
+					}
+					break;
+				}
+				default:
+					// arithmetic and storage operators are deprecated and not used by outline fonts in practice
+					return false;
+				}
+				st.sp = 0;
+				break;
+			}
+			default:
+				return false;
+			}
+		}
+
+		return true;
+	}
+};
@@ -0,0 +1,477 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <set>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "VectorBackend.h"
+
+// Writes a multi-page PDF as it goes. Only the page being drawn is held in memory; every finished page,
+// and every Leland glyph the first time it is used, goes straight to the file, leaving just the object
+// offsets behind for the cross-reference table. Glyphs are Form XObjects holding their outlines, so the
+// document embeds exactly the subset it uses. Other fonts fall back to the built-in Helvetica.
+class PdfBackend : public VectorBackend
+{
+public:
+	explicit PdfBackend(GlyphOutlines* leland) : VectorBackend(leland) {}
+
+	bool open(const std::filesystem::path& path)
+	{
+		m_out.open(path, std::ios::binary | std::ios::trunc);
+		if (!m_out)
+		{
+			return false;
+		}
+
+		m_offsets.assign(kFirstFreeObject, 0);
+		m_pageObjects.clear();
+		m_glyphObjects.clear();
+		m_helvetica = 0;
+		m_written = 0;
+
+		write("%PDF-1.4\n%\xE2\xE3\xCF\xD3\n");
+		return static_cast<bool>(m_out);
+	}
+
+	bool beginPage(float left, float top, float width, float height) override
+	{
+		m_pageWidth = width * kPointsPerPixel;
+		m_pageHeight = height * kPointsPerPixel;
+		m_pageGlyphs.clear();
+		m_pageAlphas.clear();
+		m_alpha = 255;
+		m_transformed = false;
+		m_pageUsesHelvetica = false;
+
+		// flip to y down and scale canvas pixels to points, then move the page's corner to the origin
+		m_content.clear();
+		appendNumber(m_content, kPointsPerPixel);
+		m_content += " 0 0 ";
+		appendNumber(m_content, -kPointsPerPixel);
+		m_content += " 0 ";
+		appendNumber(m_content, m_pageHeight);
+		m_content += " cm 1 0 0 1 ";
+		appendNumber(m_content, -left);
+		m_content += ' ';
+		appendNumber(m_content, -top);
+		m_content += " cm\n";
+		return static_cast<bool>(m_out);
+	}
+
+	bool endPage() override
+	{
+		setTransform(Transform{});
+		int contents{ beginObject() };
+		write("<< /Length " + std::to_string(m_content.size()) + " >>\nstream\n");
+		write(m_content);
+		write("\nendstream\nendobj\n");
+
+		if (m_pageUsesHelvetica && !m_helvetica)
+		{
+			m_helvetica = beginObject();
+			write("<< /Type /Font /Subtype /Type1 /BaseFont /Helvetica /Encoding /WinAnsiEncoding >>\nendobj\n");
+		}
+
+		int page{ beginObject() };
+		std::string dict{ "<< /Type /Page /Parent 2 0 R /MediaBox [0 0 " };
+		appendNumber(dict, m_pageWidth);
+		dict += ' ';
+		appendNumber(dict, m_pageHeight);
+		dict += "] /Contents " + std::to_string(contents) + " 0 R /Resources <<";
+
+		if (!m_pageGlyphs.empty())
+		{
+			dict += " /XObject <<";
+			for (std::uint16_t glyph : m_pageGlyphs)
+			{
+				dict += " /G" + std::to_string(glyph) + ' ' + std::to_string(m_glyphObjects[glyph]) + " 0 R";
+			}
+			dict += " >>";
+		}
+
+		if (!m_pageAlphas.empty())
+		{
+			dict += " /ExtGState <<";
+			for (int alpha : m_pageAlphas)
+			{
+				dict += " /A" + std::to_string(alpha) + " << /CA ";
+				appendNumber(dict, alpha / 255.0f);
+				dict += " /ca ";
+				appendNumber(dict, alpha / 255.0f);
+				dict += " >>";
+			}
+			dict += " >>";
+		}
+
+		if (m_pageUsesHelvetica)
+		{
+			dict += " /Font << /F1 " + std::to_string(m_helvetica) + " 0 R >>";
+		}
+
+		dict += " >> >>\nendobj\n";
+		write(dict);
+
+		m_pageObjects.push_back(page);
+		m_content.clear();
+		return static_cast<bool>(m_out);
+	}
+
+	bool finish() override
+	{
+		m_offsets[kPagesObject] = m_written;
+		std::string pages{ std::to_string(kPagesObject) + " 0 obj\n<< /Type /Pages /Kids [" };
+		for (int page : m_pageObjects)
+		{
+			pages += std::to_string(page) + " 0 R ";
+		}
+		pages += "] /Count " + std::to_string(m_pageObjects.size()) + " >>\nendobj\n";
+		write(pages);
+
+		m_offsets[kCatalogObject] = m_written;
+		write(std::to_string(kCatalogObject) + " 0 obj\n<< /Type /Catalog /Pages " + std::to_string(kPagesObject) + " 0 R >>\nendobj\n");
+
+		std::uint64_t xref{ m_written };
+		write("xref\n0 " + std::to_string(m_offsets.size()) + "\n0000000000 65535 f \n");
+		for (std::size_t i{ 1 }; i < m_offsets.size(); ++i)
+		{
+			char entry[24];
+			std::snprintf(entry, sizeof(entry), "%010llu 00000 n \n", static_cast<unsigned long long>(m_offsets[i]));
+			write(entry);
+		}
+		write("trailer\n<< /Size " + std::to_string(m_offsets.size()) + " /Root " + std::to_string(kCatalogObject) + " 0 R >>\nstartxref\n"
+			+ std::to_string(xref) + "\n%%EOF\n");
+
+		m_out.close();
+		return !m_out.fail();
+	}
+
+	void drawLine(float x1, float y1, float x2, float y2, std::uint32_t color, float width) override
+	{
+		setStroke(color, width);
+		appendPoint(x1, y1);
+		m_content += " m ";
+		appendPoint(x2, y2);
+		m_content += " l S\n";
+	}
+
+	void drawRect(float x, float y, float width, float height, std::uint32_t color, float penWidth, bool filled) override
+	{
+		filled ? setFill(color) : setStroke(color, penWidth);
+		appendPoint(x, y);
+		m_content += ' ';
+		appendPoint(width, height);
+		m_content += filled ? " re f\n" : " re S\n";
+	}
+
+	void drawEllipse(float x, float y, float width, float height, std::uint32_t color, float penWidth, bool filled) override
+	{
+		constexpr float kKappa{ 0.5522848f }; // control point distance for a quarter circle of radius 1
+
+		float rx{ width / 2.0f };
+		float ry{ height / 2.0f };
+		float cx{ x + rx };
+		float cy{ y + ry };
+		float kx{ rx * kKappa };
+		float ky{ ry * kKappa };
+
+		filled ? setFill(color) : setStroke(color, penWidth);
+		appendPoint(cx + rx, cy);
+		m_content += " m ";
+		appendCurve(cx + rx, cy + ky, cx + kx, cy + ry, cx, cy + ry);
+		appendCurve(cx - kx, cy + ry, cx - rx, cy + ky, cx - rx, cy);
+		appendCurve(cx - rx, cy - ky, cx - kx, cy - ry, cx, cy - ry);
+		appendCurve(cx + kx, cy - ry, cx + rx, cy - ky, cx + rx, cy);
+		m_content += filled ? "f\n" : "s\n";
+	}
+
+	void drawPolygon(const RenderPoint* points, std::size_t count, std::uint32_t color, float penWidth, bool filled) override
+	{
+		if (count == 0)
+		{
+			return;
+		}
+
+		filled ? setFill(color) : setStroke(color, penWidth);
+		appendPoint(points[0].x, points[0].y);
+		m_content += " m ";
+		for (std::size_t i{ 1 }; i < count; ++i)
+		{
+			appendPoint(points[i].x, points[i].y);
+			m_content += " l ";
+		}
+		m_content += filled ? "f\n" : "s\n";
+	}
+
+	void drawCurve(const RenderPoint* points, std::size_t count, std::uint32_t color, float penWidth) override
+	{
+		if (count < 2)
+		{
+			return;
+		}
+
+		setStroke(color, penWidth);
+		appendPoint(points[0].x, points[0].y);
+		m_content += " m ";
+		for (std::size_t i{ 0 }; i + 1 < count; ++i)
+		{
+			RenderPoint c1;
+			RenderPoint c2;
+			getCurveControls(points, count, i, c1, c2);
+			appendCurve(c1.x, c1.y, c2.x, c2.y, points[i + 1].x, points[i + 1].y);
+		}
+		m_content += "S\n";
+	}
+
+	void drawBeziers(const RenderPoint* points, std::size_t count, std::uint32_t color, float penWidth) override
+	{
+		if (count < 4)
+		{
+			return;
+		}
+
+		setStroke(color, penWidth);
+		appendPoint(points[0].x, points[0].y);
+		m_content += " m ";
+		for (std::size_t i{ 1 }; i + 2 < count; i += 3)
+		{
+			appendCurve(points[i].x, points[i].y, points[i + 1].x, points[i + 1].y, points[i + 2].x, points[i + 2].y);
+		}
+		m_content += "S\n";
+	}
+
+	void drawText(const std::wstring& text, float x, float y, const std::wstring& family, float size, std::uint32_t color) override
+	{
+		setFill(color);
+
+		if (usesLeland(family))
+		{
+			layoutLeland(text, x, y, size, [&](std::uint16_t glyph, float originX, float baseline, float scale) {
+				useGlyph(glyph);
+
+				m_content += "q ";
+				appendNumber(m_content, scale);
+				m_content += " 0 0 ";
+				appendNumber(m_content, -scale);
+				m_content += ' ';
+				appendPoint(originX, baseline);
+				m_content += " cm /G" + std::to_string(glyph) + " Do Q\n";
+			});
+			return;
+		}
+
+		// the page is flipped, so the text matrix flips the glyphs back upright
+		m_pageUsesHelvetica = true;
+		m_content += "BT /F1 ";
+		appendNumber(m_content, std::fabs(size));
+		m_content += " Tf 1 0 0 -1 ";
+		appendPoint(x, getPlainBaseline(y, size));
+		m_content += " Tm (";
+		for (wchar_t ch : text)
+		{
+			unsigned int code{ static_cast<unsigned int>(ch) };
+			if (code == '(' || code == ')' || code == '\\')
+			{
+				m_content += '\\';
+			}
+			m_content += code >= 0x20 && code <= 0xFF ? static_cast<char>(code) : '?'; // Latin-1 is the part of WinAnsi we can map directly
+		}
+		m_content += ") Tj ET\n";
+	}
+
+	// A transformed shape is drawn between q and Q. Q also brings back the opacity that was set at q,
+	// so that's remembered too.
+	void setTransform(const Transform& transform) override
+	{
+		if (m_transformed)
+		{
+			m_content += "Q\n";
+			m_alpha = m_untransformedAlpha;
+			m_transformed = false;
+		}
+		if (transform.isIdentity())
+		{
+			return;
+		}
+
+		m_content += "q ";
+		appendNumber(m_content, transform.a, kFactorDecimals);
+		m_content += ' ';
+		appendNumber(m_content, transform.b, kFactorDecimals);
+		m_content += ' ';
+		appendNumber(m_content, transform.c, kFactorDecimals);
+		m_content += ' ';
+		appendNumber(m_content, transform.d, kFactorDecimals);
+		m_content += ' ';
+		appendPoint(transform.tx, transform.ty);
+		m_content += " cm\n";
+		m_untransformedAlpha = m_alpha;
+		m_transformed = true;
+	}
+
+private:
+	static constexpr float kPointsPerPixel{ 0.75f }; // canvas pixels are 1/96 inch
+	static constexpr int kCatalogObject{ 1 };
+	static constexpr int kPagesObject{ 2 };
+	static constexpr int kFirstFreeObject{ 3 };
+
+	std::ofstream m_out;
+	std::uint64_t m_written{ 0 };
+	std::vector<std::uint64_t> m_offsets; // by object number; 0 is the free-list head
+	std::vector<int> m_pageObjects;
+	std::unordered_map<std::uint16_t, int> m_glyphObjects; // Form XObject per glyph written so far
+	int m_helvetica{ 0 };
+
+	std::string m_content; // the current page's content stream
+	float m_pageWidth{ 0.0f };
+	float m_pageHeight{ 0.0f };
+	std::set<std::uint16_t> m_pageGlyphs;
+	std::set<int> m_pageAlphas;
+	int m_alpha{ 255 }; // opacity currently set on the page
+	int m_untransformedAlpha{ 255 }; // and what it goes back to when a transform ends
+	bool m_transformed{ false }; // inside a q that setTransform opened
+	bool m_pageUsesHelvetica{ false };
+
+	// glyph outline in font units
+	class PathSink : public OutlineSink
+	{
+	public:
+		explicit PathSink(std::string& out) : m_out(out) {}
+
+		void moveTo(float x, float y) override { point(x, y); m_out += " m "; }
+		void lineTo(float x, float y) override { point(x, y); m_out += " l "; }
+
+		void cubicTo(float x1, float y1, float x2, float y2, float x, float y) override
+		{
+			point(x1, y1);
+			m_out += ' ';
+			point(x2, y2);
+			m_out += ' ';
+			point(x, y);
+			m_out += " c ";
+		}
+
+		void closePath() override { m_out += "h "; }
+
+	private:
+		std::string& m_out;
+
+		void point(float x, float y)
+		{
+			appendNumber(m_out, x);
+			m_out += ' ';
+			appendNumber(m_out, y);
+		}
+	};
+
+	void write(const std::string& text)
+	{
+		m_out.write(text.data(), static_cast<std::streamsize>(text.size()));
+		m_written += text.size();
+	}
+
+	int beginObject()
+	{
+		int object{ static_cast<int>(m_offsets.size()) };
+		m_offsets.push_back(m_written);
+		write(std::to_string(object) + " 0 obj\n");
+		return object;
+	}
+
+	// writes the glyph's XObject the first time the document uses it
+	void useGlyph(std::uint16_t glyph)
+	{
+		m_pageGlyphs.insert(glyph);
+		if (m_glyphObjects.count(glyph))
+		{
+			return;
+		}
+
+		std::string path;
+		PathSink sink(path);
+		OutlineBounds bounds;
+		m_leland->getOutline(glyph, sink);
+		m_leland->getOutline(glyph, bounds);
+		path += 'f';
+
+		std::string dict{ "<< /Type /XObject /Subtype /Form /BBox [" };
+		if (bounds.isEmpty())
+		{
+			dict += "0 0 0 0";
+		}
+		else
+		{
+			appendNumber(dict, std::floor(bounds.getXMin()));
+			dict += ' ';
+			appendNumber(dict, std::floor(bounds.getYMin()));
+			dict += ' ';
+			appendNumber(dict, std::ceil(bounds.getXMax()));
+			dict += ' ';
+			appendNumber(dict, std::ceil(bounds.getYMax()));
+		}
+		dict += "] /Length " + std::to_string(path.size()) + " >>\nstream\n";
+
+		m_glyphObjects.emplace(glyph, beginObject());
+		write(dict);
+		write(path);
+		write("\nendstream\nendobj\n");
+	}
+
+	void appendPoint(float x, float y)
+	{
+		appendNumber(m_content, x);
+		m_content += ' ';
+		appendNumber(m_content, y);
+	}
+
+	void appendCurve(float x1, float y1, float x2, float y2, float x, float y)
+	{
+		appendPoint(x1, y1);
+		m_content += ' ';
+		appendPoint(x2, y2);
+		m_content += ' ';
+		appendPoint(x, y);
+		m_content += " c ";
+	}
+
+	void appendColor(std::uint32_t color)
+	{
+		appendNumber(m_content, getRed(color) / 255.0f);
+		m_content += ' ';
+		appendNumber(m_content, getGreen(color) / 255.0f);
+		m_content += ' ';
+		appendNumber(m_content, getBlue(color) / 255.0f);
+	}
+
+	// opacity needs a graphics state resource, so it is only switched when it changes
+	void setAlpha(std::uint32_t color)
+	{
+		int alpha{ static_cast<int>(color >> 24) };
+		if (alpha == m_alpha)
+		{
+			return;
+		}
+
+		m_alpha = alpha;
+		m_pageAlphas.insert(alpha);
+		m_content += "/A" + std::to_string(alpha) + " gs ";
+	}
+
+	void setStroke(std::uint32_t color, float width)
+	{
+		setAlpha(color);
+		appendColor(color);
+		m_content += " RG ";
+		appendNumber(m_content, width);
+		m_content += " w ";
+	}
+
+	void setFill(std::uint32_t color)
+	{
+		setAlpha(color);
+		appendColor(color);
+		m_content += " rg ";
+	}
+};
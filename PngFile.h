@@ -0,0 +1,251 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <vector>
+
+// Writes 32-bit images as PNG with nothing but the standard library. The deflate stream uses the fixed
+// Huffman codes and only looks for repeats of the previous pixel and of the pixel above, which is where
+// drawings repeat: blank paper and flat fills shrink to a few bytes a row, and the rest is stored as is.
+class PngWriter
+{
+public:
+	// pixels are premultiplied ARGB words, GDI+'s PixelFormat32bppPARGB, rows top to bottom
+	static bool save(const std::filesystem::path& path, const std::uint32_t* pixels, int width, int height)
+	{
+		if (width <= 0 || height <= 0)
+		{
+			return false;
+		}
+
+		// each row is a filter byte (none) and straight RGBA
+		std::size_t rowBytes{ static_cast<std::size_t>(width) * 4 + 1 };
+		std::vector<std::uint8_t> raw(rowBytes * static_cast<std::size_t>(height));
+		for (int y{ 0 }; y < height; ++y)
+		{
+			std::uint8_t* out{ &raw[rowBytes * static_cast<std::size_t>(y)] };
+			*out++ = 0;
+			for (int x{ 0 }; x < width; ++x)
+			{
+				std::uint32_t pixel{ pixels[static_cast<std::size_t>(y) * width + x] };
+				std::uint32_t alpha{ pixel >> 24 };
+				for (int shift : { 16, 8, 0 })
+				{
+					std::uint32_t channel{ (pixel >> shift) & 0xFF };
+					*out++ = static_cast<std::uint8_t>(alpha == 0 ? 0 : (std::min)(255u, (channel * 255 + alpha / 2) / alpha));
+				}
+				*out++ = static_cast<std::uint8_t>(alpha);
+			}
+		}
+
+		std::vector<std::uint8_t> header;
+		put32(header, static_cast<std::uint32_t>(width));
+		put32(header, static_cast<std::uint32_t>(height));
+		header.insert(header.end(), { 8, 6, 0, 0, 0 }); // 8 bits per channel, RGBA, deflate, no interlace
+
+		std::ofstream out(path, std::ios::binary | std::ios::trunc);
+		static const char kSignature[]{ "\x89PNG\r\n\x1A\n" };
+		out.write(kSignature, 8);
+		writeChunk(out, "IHDR", header);
+		writeChunk(out, "IDAT", deflate(raw, rowBytes));
+		writeChunk(out, "IEND", {});
+		out.close();
+		return !out.fail();
+	}
+
+private:
+	// an LSB-first bit stream, as deflate packs its codes
+	class BitWriter
+	{
+	public:
+		explicit BitWriter(std::vector<std::uint8_t>& out) : m_out(out) {}
+
+		void put(std::uint32_t bits, int count)
+		{
+			m_bits |= static_cast<std::uint64_t>(bits) << m_count;
+			m_count += count;
+			while (m_count >= 8)
+			{
+				m_out.push_back(static_cast<std::uint8_t>(m_bits));
+				m_bits >>= 8;
+				m_count -= 8;
+			}
+		}
+
+		// Huffman codes go most significant bit first
+		void putCode(std::uint32_t code, int length)
+		{
+			std::uint32_t reversed{ 0 };
+			for (int i{ 0 }; i < length; ++i)
+			{
+				reversed = (reversed << 1) | ((code >> i) & 1);
+			}
+			put(reversed, length);
+		}
+
+		void flush()
+		{
+			if (m_count > 0)
+			{
+				m_out.push_back(static_cast<std::uint8_t>(m_bits));
+			}
+			m_bits = 0;
+			m_count = 0;
+		}
+
+	private:
+		std::vector<std::uint8_t>& m_out;
+		std::uint64_t m_bits{ 0 };
+		int m_count{ 0 };
+	};
+
+	static constexpr std::size_t kMaxMatch{ 258 };
+
+	static void putLiteral(BitWriter& bits, std::uint32_t symbol)
+	{
+		if (symbol < 144)
+		{
+			bits.putCode(0x30 + symbol, 8);
+		}
+		else if (symbol < 256)
+		{
+			bits.putCode(0x190 + symbol - 144, 9);
+		}
+		else if (symbol < 280)
+		{
+			bits.putCode(symbol - 256, 7);
+		}
+		else
+		{
+			bits.putCode(0xC0 + symbol - 280, 8);
+		}
+	}
+
+	static void putMatch(BitWriter& bits, std::size_t length, std::size_t distance)
+	{
+		static constexpr std::uint16_t kLengthBase[29]{ 3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258 };
+		static constexpr std::uint8_t kLengthExtra[29]{ 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0 };
+		static constexpr std::uint16_t kDistanceBase[30]{ 1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193, 257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577 };
+		static constexpr std::uint8_t kDistanceExtra[30]{ 0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13 };
+
+		int code{ 28 };
+		while (kLengthBase[code] > length)
+		{
+			--code;
+		}
+		putLiteral(bits, 257 + static_cast<std::uint32_t>(code));
+		bits.put(static_cast<std::uint32_t>(length - kLengthBase[code]), kLengthExtra[code]);
+
+		code = 29;
+		while (kDistanceBase[code] > distance)
+		{
+			--code;
+		}
+		bits.putCode(static_cast<std::uint32_t>(code), 5);
+		bits.put(static_cast<std::uint32_t>(distance - kDistanceBase[code]), kDistanceExtra[code]);
+	}
+
+	static std::size_t matchLength(const std::vector<std::uint8_t>& data, std::size_t at, std::size_t distance)
+	{
+		if (distance > at)
+		{
+			return 0;
+		}
+
+		std::size_t limit{ (std::min)(kMaxMatch, data.size() - at) };
+		std::size_t length{ 0 };
+		while (length < limit && data[at + length] == data[at + length - distance])
+		{
+			++length;
+		}
+		return length;
+	}
+
+	// a zlib stream of one fixed-Huffman block
+	static std::vector<std::uint8_t> deflate(const std::vector<std::uint8_t>& data, std::size_t rowBytes)
+	{
+		std::vector<std::uint8_t> out{ 0x78, 0x01 };
+		BitWriter bits(out);
+		bits.put(1, 1); // the last block
+		bits.put(1, 2); // fixed codes
+
+		// the window is 32 KB; rows wider than that only look left
+		std::size_t above{ rowBytes <= 32768 ? rowBytes : 0 };
+		for (std::size_t at{ 0 }; at < data.size();)
+		{
+			std::size_t left{ matchLength(data, at, 4) };
+			std::size_t up{ above ? matchLength(data, at, above) : 0 };
+			std::size_t length{ (std::max)(left, up) };
+			if (length >= 3)
+			{
+				putMatch(bits, length, up >= left ? above : 4);
+				at += length;
+			}
+			else
+			{
+				putLiteral(bits, data[at]);
+				++at;
+			}
+		}
+		putLiteral(bits, 256);
+		bits.flush();
+
+		std::uint32_t a{ 1 };
+		std::uint32_t b{ 0 };
+		for (std::uint8_t byte : data)
+		{
+			a = (a + byte) % 65521;
+			b = (b + a) % 65521;
+		}
+		put32(out, (b << 16) | a);
+		return out;
+	}
+
+	static std::uint32_t crc32(const std::uint8_t* data, std::size_t size, std::uint32_t crc)
+	{
+		static const std::vector<std::uint32_t> table{ [] {
+			std::vector<std::uint32_t> entries(256);
+			for (std::uint32_t n{ 0 }; n < 256; ++n)
+			{
+				std::uint32_t c{ n };
+				for (int k{ 0 }; k < 8; ++k)
+				{
+					c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+				}
+				entries[n] = c;
+			}
+			return entries;
+		}() };
+
+		for (std::size_t i{ 0 }; i < size; ++i)
+		{
+			crc = table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+		}
+		return crc;
+	}
+
+	// PNG numbers are big-endian
+	static void put32(std::vector<std::uint8_t>& out, std::uint32_t value)
+	{
+		out.insert(out.end(), { static_cast<std::uint8_t>(value >> 24), static_cast<std::uint8_t>(value >> 16), static_cast<std::uint8_t>(value >> 8), static_cast<std::uint8_t>(value) });
+	}
+
+	static void writeChunk(std::ofstream& out, const char* type, const std::vector<std::uint8_t>& data)
+	{
+		std::vector<std::uint8_t> head;
+		put32(head, static_cast<std::uint32_t>(data.size()));
+		head.insert(head.end(), type, type + 4);
+
+		std::uint32_t crc{ crc32(head.data() + 4, 4, 0xFFFFFFFFu) };
+		crc = crc32(data.data(), data.size(), crc) ^ 0xFFFFFFFFu;
+
+		std::vector<std::uint8_t> tail;
+		put32(tail, crc);
+
+		out.write(reinterpret_cast<const char*>(head.data()), static_cast<std::streamsize>(head.size()));
+		out.write(reinterpret_cast<const char*>(data.data()), static_cast<std::streamsize>(data.size()));
+		out.write(reinterpret_cast<const char*>(tail.data()), static_cast<std::streamsize>(tail.size()));
+	}
+};
@@ -0,0 +1,162 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// A fixed-size queue between exactly one producer thread and one consumer thread, without locks: each side
+// owns one index and only reads the other's. Indices only grow, and wrap into the slots through a mask.
+template<typename T>
+class SpscRing
+{
+public:
+	// capacity is rounded up to a power of two
+	explicit SpscRing(std::size_t capacity = 1024)
+	{
+		std::size_t size{ 2 };
+		while (size < capacity)
+		{
+			size *= 2;
+		}
+		m_slots.resize(size);
+		m_mask = size - 1;
+	}
+
+	SpscRing(const SpscRing&) = delete;
+	SpscRing& operator=(const SpscRing&) = delete;
+
+	std::size_t capacity() const { return m_slots.size(); }
+
+	// producer: adds as many of values as fit, publishing them together; returns how many
+	std::size_t push(const T* values, std::size_t count)
+	{
+		std::size_t head{ m_head.load(std::memory_order_relaxed) };
+		if (head - m_cachedTail + count > m_slots.size())
+		{
+			m_cachedTail = m_tail.load(std::memory_order_acquire);
+		}
+
+		std::size_t room{ m_slots.size() - (head - m_cachedTail) };
+		std::size_t pushed{ count < room ? count : room };
+		for (std::size_t i{ 0 }; i < pushed; ++i)
+		{
+			m_slots[(head + i) & m_mask] = values[i];
+		}
+		m_head.store(head + pushed, std::memory_order_release);
+		return pushed;
+	}
+
+	bool push(const T& value) { return push(&value, 1) == 1; }
+
+	// consumer: moves up to max of the oldest values into out; returns how many
+	std::size_t pop(T* out, std::size_t max)
+	{
+		std::size_t tail{ m_tail.load(std::memory_order_relaxed) };
+		if (m_cachedHead - tail < max)
+		{
+			m_cachedHead = m_head.load(std::memory_order_acquire);
+		}
+
+		std::size_t available{ m_cachedHead - tail };
+		std::size_t popped{ max < available ? max : available };
+		for (std::size_t i{ 0 }; i < popped; ++i)
+		{
+			out[i] = m_slots[(tail + i) & m_mask];
+		}
+		m_tail.store(tail + popped, std::memory_order_release);
+		return popped;
+	}
+
+	// consumer: true if nothing was waiting when it looked
+	bool empty() const { return m_head.load(std::memory_order_acquire) == m_tail.load(std::memory_order_relaxed); }
+
+private:
+	std::vector<T> m_slots;
+	std::size_t m_mask{ 0 };
+
+	// the indices sit on their own cache lines, each with its owner's copy of the other's
+	alignas(64) std::atomic<std::size_t> m_head{ 0 }; // next slot the producer writes
+	std::size_t m_cachedTail{ 0 };
+	alignas(64) std::atomic<std::size_t> m_tail{ 0 }; // next slot the consumer reads
+	std::size_t m_cachedHead{ 0 };
+};
+
+// a pointer position as the system's move history reports it: screen pixels and a millisecond tick
+struct PointerSample
+{
+	int x;
+	int y;
+	std::uint32_t time;
+
+	bool operator==(const PointerSample& other) const { return x == other.x && y == other.y && time == other.time; }
+};
+
+// Turns repeated reads of the system's pointer history, each the latest few dozen moves newest first and
+// overlapping the read before, into one stream of moves with nothing repeated or reordered.
+class PointerHistory
+{
+public:
+	// starts a new stream with the moves after tick since, e.g. when the button went down
+	void reset(std::uint32_t since)
+	{
+		m_last = PointerSample{ 0, 0, since };
+		m_exact = false;
+		m_gaps = 0;
+	}
+
+	// appends the samples of a read, newest first, that the reads before hadn't, oldest first; returns how many
+	std::size_t takeNew(const PointerSample* newestFirst, std::size_t count, std::vector<PointerSample>& out)
+	{
+		if (count == 0)
+		{
+			return 0;
+		}
+
+		std::size_t fresh{ 0 };
+		if (m_exact)
+		{
+			while (fresh < count && !(newestFirst[fresh] == m_last))
+			{
+				++fresh;
+			}
+		}
+
+		// without the last sample to join up to, what's newer than it is new; if the history moved on past
+		// it before this read, moves may be missing in between
+		if (!m_exact || fresh == count)
+		{
+			if (m_exact)
+			{
+				++m_gaps;
+			}
+			fresh = 0;
+			while (fresh < count && isAfter(newestFirst[fresh].time, m_last.time))
+			{
+				++fresh;
+			}
+		}
+
+		for (std::size_t i{ fresh }; i-- > 0;)
+		{
+			out.push_back(newestFirst[i]);
+		}
+		if (fresh > 0)
+		{
+			m_last = newestFirst[0];
+			m_exact = true;
+		}
+		return fresh;
+	}
+
+	// reads that came too late to join up with the one before, so moves may be missing between them
+	std::size_t getGaps() const { return m_gaps; }
+
+private:
+	PointerSample m_last{ 0, 0, 0 };
+	bool m_exact{ false }; // whether m_last is a sample rather than just a time
+	std::size_t m_gaps{ 0 };
+
+	// the tick wraps every 49.7 days
+	static bool isAfter(std::uint32_t time, std::uint32_t than) { return static_cast<std::int32_t>(time - than) > 0; }
+};
@@ -0,0 +1,267 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <vector>
+
+// Scoped timers around the paint path and other hot spots. Each thread writes its own ring of recent
+// events without locking; the window reads them for the frame-time overlay and the trace export. With
+// the profiler off, a timer costs one relaxed load.
+
+// one timed scope; name is a string literal, and only the pointer is kept
+struct ProfileEvent
+{
+	const char* name{ nullptr };
+	std::uint64_t start{ 0 }; // nanoseconds since the profiler was made
+	std::uint64_t duration{ 0 };
+	std::uint32_t thread{ 0 }; // the order threads first recorded in, from 1
+};
+
+// One thread's most recent events. Only that thread writes; a reader copies what's there and drops
+// whatever the writer lapped while it copied, as a seqlock would. The slots are relaxed atomics so that
+// read is never a race, and fences order them against the head: once a reader has seen any store of event
+// n, it also sees the head at n or later, so it knows that slot may be torn.
+class ProfileRing
+{
+public:
+	static constexpr std::size_t kCapacity{ 4096 }; // a power of two
+
+	explicit ProfileRing(std::uint32_t thread) : m_thread(thread) {}
+
+	void push(const char* name, std::uint64_t start, std::uint64_t duration)
+	{
+		std::uint64_t head{ m_head.load(std::memory_order_relaxed) };
+		Slot& slot{ m_slots[head & (kCapacity - 1)] };
+
+		// keeps the head's last store ahead of these, for a reader's acquire fence to pair with
+		std::atomic_thread_fence(std::memory_order_release);
+		slot.name.store(name, std::memory_order_relaxed);
+		slot.start.store(start, std::memory_order_relaxed);
+		slot.duration.store(duration, std::memory_order_relaxed);
+		m_head.store(head + 1, std::memory_order_release);
+	}
+
+	// appends the events still held, oldest first
+	void copy(std::vector<ProfileEvent>& out) const
+	{
+		std::uint64_t head{ m_head.load(std::memory_order_acquire) };
+		std::uint64_t first{ head > kCapacity ? head - kCapacity : 0 };
+		std::size_t copied{ out.size() };
+
+		for (std::uint64_t i{ first }; i < head; ++i)
+		{
+			const Slot& slot{ m_slots[i & (kCapacity - 1)] };
+			out.push_back(ProfileEvent{ slot.name.load(std::memory_order_relaxed), slot.start.load(std::memory_order_relaxed),
+				slot.duration.load(std::memory_order_relaxed), m_thread });
+		}
+
+		// The writer may be partway through event now, which reuses the slot of event now - kCapacity, so
+		// that event and every one before it may be half old, half new.
+		std::atomic_thread_fence(std::memory_order_acquire);
+		std::uint64_t now{ m_head.load(std::memory_order_relaxed) };
+		if (now >= first + kCapacity)
+		{
+			std::uint64_t lapped{ (std::min)(now + 1 - kCapacity - first, head - first) };
+			out.erase(out.begin() + copied, out.begin() + copied + static_cast<std::ptrdiff_t>(lapped));
+		}
+	}
+
+	void clear() { m_head.store(0, std::memory_order_release); }
+
+private:
+	struct Slot
+	{
+		std::atomic<const char*> name{ nullptr };
+		std::atomic<std::uint64_t> start{ 0 };
+		std::atomic<std::uint64_t> duration{ 0 };
+	};
+
+	std::uint32_t m_thread;
+	std::atomic<std::uint64_t> m_head{ 0 };
+	Slot m_slots[kCapacity];
+};
+
+// frame times over the last kFrames frames
+struct FrameStats
+{
+	std::size_t frames{ 0 };
+	double p50{ 0.0 }; // milliseconds
+	double p99{ 0.0 };
+	std::uint32_t drawCalls{ 0 }; // in the last frame
+};
+
+class Profiler
+{
+public:
+	static constexpr std::size_t kFrames{ 240 };
+
+	Profiler() : m_epoch(std::chrono::steady_clock::now()) {}
+
+	bool isEnabled() const { return m_enabled.load(std::memory_order_relaxed); }
+	void setEnabled(bool enabled) { m_enabled.store(enabled, std::memory_order_relaxed); }
+
+	std::uint64_t now() const
+	{
+		return static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - m_epoch).count());
+	}
+
+	void record(const char* name, std::uint64_t start, std::uint64_t duration) { getRing().push(name, start, duration); }
+
+	// ends a frame that began at start, recording it as an event too; only the painting thread calls this
+	void endFrame(std::uint64_t start, std::uint32_t drawCalls)
+	{
+		std::uint64_t duration{ now() - start };
+		record("frame", start, duration);
+
+		m_frameTimes[m_frameCount % kFrames] = duration;
+		++m_frameCount;
+		m_drawCalls = drawCalls;
+	}
+
+	FrameStats getFrameStats() const
+	{
+		FrameStats stats;
+		stats.frames = (std::min)(m_frameCount, kFrames);
+		stats.drawCalls = m_drawCalls;
+		if (stats.frames == 0)
+		{
+			return stats;
+		}
+
+		std::vector<std::uint64_t> times(m_frameTimes, m_frameTimes + stats.frames);
+		std::sort(times.begin(), times.end());
+		stats.p50 = times[(times.size() - 1) / 2] / 1e6;
+		stats.p99 = times[(times.size() - 1) * 99 / 100] / 1e6;
+		return stats;
+	}
+
+	// every thread's recent events, ordered by start time
+	std::vector<ProfileEvent> collect() const
+	{
+		std::vector<ProfileEvent> events;
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			for (const auto& ring : m_rings)
+			{
+				ring->copy(events);
+			}
+		}
+
+		std::sort(events.begin(), events.end(), [](const ProfileEvent& a, const ProfileEvent& b) { return a.start < b.start; });
+		return events;
+	}
+
+	// the recent events as Chrome's trace event JSON, which chrome://tracing and Perfetto open
+	void writeChromeTrace(std::ostream& out) const
+	{
+		out << "{\"traceEvents\":[";
+
+		bool first{ true };
+		for (const ProfileEvent& event : collect())
+		{
+			out << (first ? "\n" : ",\n") << "{\"name\":\"";
+			for (const char* c{ event.name }; *c; ++c)
+			{
+				if (*c == '"' || *c == '\\')
+				{
+					out << '\\';
+				}
+				out << *c;
+			}
+			out << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << event.thread << ",\"ts\":";
+			writeMicroseconds(out, event.start);
+			out << ",\"dur\":";
+			writeMicroseconds(out, event.duration);
+			out << '}';
+			first = false;
+		}
+
+		out << "\n],\"displayTimeUnit\":\"ms\"}\n";
+	}
+
+	// forgets the recorded events and frame times; threads must not be recording while it runs
+	void clear()
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		for (const auto& ring : m_rings)
+		{
+			ring->clear();
+		}
+		m_frameCount = 0;
+		m_drawCalls = 0;
+	}
+
+private:
+	std::chrono::steady_clock::time_point m_epoch;
+	std::atomic<bool> m_enabled{ false };
+
+	mutable std::mutex m_mutex; // guards m_rings, which a thread joins the first time it records
+	std::vector<std::unique_ptr<ProfileRing>> m_rings;
+
+	std::uint64_t m_frameTimes[kFrames]{};
+	std::size_t m_frameCount{ 0 };
+	std::uint32_t m_drawCalls{ 0 };
+
+	ProfileRing& getRing()
+	{
+		// the ring this thread last used, and whose it was
+		thread_local const Profiler* owner{ nullptr };
+		thread_local ProfileRing* ring{ nullptr };
+		if (owner != this)
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_rings.push_back(std::make_unique<ProfileRing>(static_cast<std::uint32_t>(m_rings.size() + 1)));
+			ring = m_rings.back().get();
+			owner = this;
+		}
+		return *ring;
+	}
+
+	// trace timestamps are microseconds; three decimals keep the nanoseconds
+	static void writeMicroseconds(std::ostream& out, std::uint64_t nanoseconds)
+	{
+		std::uint64_t fraction{ nanoseconds % 1000 };
+		out << nanoseconds / 1000 << '.' << static_cast<char>('0' + fraction / 100) << static_cast<char>('0' + fraction / 10 % 10) << static_cast<char>('0' + fraction % 10);
+	}
+};
+
+// the one profiler the window and its helpers record into
+inline Profiler& profiler()
+{
+	static Profiler instance;
+	return instance;
+}
+
+// times the scope it lives in, if the profiler was on when it began
+class ProfileScope
+{
+public:
+	explicit ProfileScope(const char* name) : m_name(profiler().isEnabled() ? name : nullptr)
+	{
+		if (m_name)
+		{
+			m_start = profiler().now();
+		}
+	}
+
+	~ProfileScope()
+	{
+		if (m_name)
+		{
+			profiler().record(m_name, m_start, profiler().now() - m_start);
+		}
+	}
+
+	ProfileScope(const ProfileScope&) = delete;
+	ProfileScope& operator=(const ProfileScope&) = delete;
+
+private:
+	const char* m_name;
+	std::uint64_t m_start{ 0 };
+};
@@ -0,0 +1,890 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <vector>
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define RASTER_SSE2
+#endif
+#include "GlyphAtlas.h"
+#include "PngFile.h"
+#include "VectorBackend.h"
+
+// Anti-aliased coverage of one path at a time. Each edge adds the signed area it sweeps to the cells it
+// crosses, and a running sum along a row turns those into coverage, as font-rs does. Coverage is the
+// winding number's size clamped to 1: nonzero filling for the simple outlines the shapes fill, and a
+// union for strokes, whose pieces all go the same way round.
+class CoverageMask
+{
+public:
+	void resize(int width, int height)
+	{
+		m_width = (std::max)(width, 0);
+		m_height = (std::max)(height, 0);
+		m_stride = (static_cast<std::size_t>(m_width) + 2 + 7) & ~static_cast<std::size_t>(7); // room for edges on the right border, in whole vectors
+		m_area.assign(m_stride * static_cast<std::size_t>(m_height), 0.0f);
+		m_coverage.assign(m_stride, 0.0f);
+		reset();
+	}
+
+	int getWidth() const { return m_width; }
+	int getHeight() const { return m_height; }
+
+	// the rows and columns edges have touched since the last sweep
+	bool isEmpty() const { return m_top > m_bottom; }
+	int getTop() const { return m_top; }
+	int getBottom() const { return m_bottom; }
+	int getLeft() const { return m_left; }
+	int getRight() const { return (std::min)(m_right, m_width - 1); }
+
+	// an edge in pixels; whatever lies outside the mask is clipped, keeping its winding for what's inside
+	void addEdge(float x0, float y0, float x1, float y1)
+	{
+		if (y0 == y1 || !std::isfinite(x0) || !std::isfinite(y0) || !std::isfinite(x1) || !std::isfinite(y1))
+		{
+			return;
+		}
+
+		// an edge past the left or right border still covers everything on its inner side; split it where it
+		// crosses, and lay the outside pieces along the border
+		float width{ static_cast<float>(m_width) };
+		float crossings[2];
+		int count{ 0 };
+		if ((x0 < 0.0f) != (x1 < 0.0f))
+		{
+			crossings[count++] = -x0 / (x1 - x0);
+		}
+		if ((x0 > width) != (x1 > width))
+		{
+			crossings[count++] = (width - x0) / (x1 - x0);
+		}
+		if (count == 2 && crossings[0] > crossings[1])
+		{
+			std::swap(crossings[0], crossings[1]);
+		}
+
+		float fromX{ x0 };
+		float fromY{ y0 };
+		for (int i{ 0 }; i < count; ++i)
+		{
+			float toX{ x0 + (x1 - x0) * crossings[i] };
+			float toY{ y0 + (y1 - y0) * crossings[i] };
+			accumulate(std::clamp(fromX, 0.0f, width), fromY, std::clamp(toX, 0.0f, width), toY);
+			fromX = toX;
+			fromY = toY;
+		}
+		accumulate(std::clamp(fromX, 0.0f, width), fromY, std::clamp(x1, 0.0f, width), y1);
+	}
+
+	// Row y's coverage, from 0 to 1, over the touched columns; the row's area is cleared as it's read, so
+	// sweeping every touched row readies the mask for the next path
+	const float* sweep(int y)
+	{
+		float* area{ &m_area[static_cast<std::size_t>(y) * m_stride] };
+		float* coverage{ m_coverage.data() };
+
+		// the running sum starts at zero left of the first touched cell, so the sweep can start on a vector boundary
+		std::size_t first{ static_cast<std::size_t>(m_left) & ~static_cast<std::size_t>(7) };
+		std::size_t last{ (std::min)(m_stride, (static_cast<std::size_t>(m_right) + 8) & ~static_cast<std::size_t>(7)) };
+		sweepRow(area, coverage, first, last);
+		return coverage;
+	}
+
+	// forgets the touched area; call it once every touched row has been swept
+	void reset()
+	{
+		m_top = m_height;
+		m_bottom = -1;
+		m_left = m_width;
+		m_right = -1;
+	}
+
+private:
+	int m_width{ 0 };
+	int m_height{ 0 };
+	std::size_t m_stride{ 0 };
+	std::vector<float> m_area;
+	std::vector<float> m_coverage; // one row
+	int m_top{ 0 };
+	int m_bottom{ -1 };
+	int m_left{ 0 };
+	int m_right{ -1 };
+
+	// adds the signed area an edge inside the columns sweeps to each cell it crosses
+	void accumulate(float x0, float y0, float x1, float y1)
+	{
+		if (y0 == y1)
+		{
+			return;
+		}
+
+		float direction{ 1.0f };
+		if (y0 > y1)
+		{
+			std::swap(x0, x1);
+			std::swap(y0, y1);
+			direction = -1.0f;
+		}
+		if (y1 <= 0.0f || y0 >= static_cast<float>(m_height))
+		{
+			return;
+		}
+
+		// stepping down the rows can round x a hair outside the columns, a cell past the row's ends
+		float width{ static_cast<float>(m_width) };
+		float dxdy{ (x1 - x0) / (y1 - y0) };
+		float x{ std::clamp(y0 < 0.0f ? x0 - y0 * dxdy : x0, 0.0f, width) };
+		int first{ (std::max)(0, static_cast<int>(std::floor(y0))) };
+		int last{ (std::min)(m_height, static_cast<int>(std::ceil(y1))) };
+
+		m_top = (std::min)(m_top, first);
+		m_bottom = (std::max)(m_bottom, last - 1);
+		m_left = (std::min)(m_left, static_cast<int>(std::floor((std::min)(x0, x1))));
+		m_right = (std::max)(m_right, static_cast<int>(std::ceil((std::max)(x0, x1))) + 1);
+
+		for (int y{ first }; y < last; ++y)
+		{
+			float* row{ &m_area[static_cast<std::size_t>(y) * m_stride] };
+			float dy{ (std::min)(static_cast<float>(y + 1), y1) - (std::max)(static_cast<float>(y), y0) };
+			float next{ std::clamp(x + dxdy * dy, 0.0f, width) };
+			float d{ dy * direction };
+
+			float low{ (std::min)(x, next) };
+			float high{ (std::max)(x, next) };
+			float lowFloor{ std::floor(low) };
+			float highCeil{ std::ceil(high) };
+			int lowCell{ static_cast<int>(lowFloor) };
+			int highCell{ static_cast<int>(highCeil) };
+
+			if (highCell <= lowCell + 1)
+			{
+				// the edge stays within one cell on this row
+				float middle{ 0.5f * (x + next) - lowFloor };
+				row[lowCell] += d - d * middle;
+				row[lowCell + 1] += d * middle;
+			}
+			else
+			{
+				float slope{ 1.0f / (high - low) };
+				float lowFraction{ low - lowFloor };
+				float firstArea{ 0.5f * slope * (1.0f - lowFraction) * (1.0f - lowFraction) };
+				float highFraction{ high - highCeil + 1.0f };
+				float lastArea{ 0.5f * slope * highFraction * highFraction };
+
+				row[lowCell] += d * firstArea;
+				if (highCell == lowCell + 2)
+				{
+					row[lowCell + 1] += d * (1.0f - firstArea - lastArea);
+				}
+				else
+				{
+					float secondArea{ slope * (1.5f - lowFraction) };
+					row[lowCell + 1] += d * (secondArea - firstArea);
+					for (int cell{ lowCell + 2 }; cell < highCell - 1; ++cell)
+					{
+						row[cell] += d * slope;
+					}
+					float beforeLast{ secondArea + static_cast<float>(highCell - lowCell - 3) * slope };
+					row[highCell - 1] += d * (1.0f - beforeLast - lastArea);
+				}
+				row[highCell] += d * lastArea;
+			}
+
+			x = next;
+		}
+	}
+
+	// coverage[i] = min(1, |area[first] + ... + area[i]|), clearing area; first and last are multiples of 8
+	static void sweepRow(float* area, float* coverage, std::size_t first, std::size_t last)
+	{
+#if defined(__AVX2__)
+		const __m256 sign{ _mm256_set1_ps(-0.0f) };
+		const __m256 one{ _mm256_set1_ps(1.0f) };
+		const __m256i lastLane{ _mm256_set1_epi32(7) };
+		__m256 carry{ _mm256_setzero_ps() };
+		for (std::size_t i{ first }; i < last; i += 8)
+		{
+			// a prefix sum within each 128-bit half, then the low half's total carried into the high half
+			__m256 sum{ _mm256_loadu_ps(area + i) };
+			sum = _mm256_add_ps(sum, _mm256_castsi256_ps(_mm256_slli_si256(_mm256_castps_si256(sum), 4)));
+			sum = _mm256_add_ps(sum, _mm256_castsi256_ps(_mm256_slli_si256(_mm256_castps_si256(sum), 8)));
+			__m256 low{ _mm256_permute2f128_ps(sum, sum, 0x08) };
+			sum = _mm256_add_ps(sum, _mm256_shuffle_ps(low, low, 0xFF));
+			sum = _mm256_add_ps(sum, carry);
+			carry = _mm256_permutevar8x32_ps(sum, lastLane);
+
+			_mm256_storeu_ps(coverage + i, _mm256_min_ps(_mm256_andnot_ps(sign, sum), one));
+			_mm256_storeu_ps(area + i, _mm256_setzero_ps());
+		}
+#elif defined(RASTER_SSE2)
+		const __m128 sign{ _mm_set1_ps(-0.0f) };
+		const __m128 one{ _mm_set1_ps(1.0f) };
+		__m128 carry{ _mm_setzero_ps() };
+		for (std::size_t i{ first }; i < last; i += 4)
+		{
+			__m128 sum{ _mm_loadu_ps(area + i) };
+			sum = _mm_add_ps(sum, _mm_castsi128_ps(_mm_slli_si128(_mm_castps_si128(sum), 4)));
+			sum = _mm_add_ps(sum, _mm_castsi128_ps(_mm_slli_si128(_mm_castps_si128(sum), 8)));
+			sum = _mm_add_ps(sum, carry);
+			carry = _mm_shuffle_ps(sum, sum, 0xFF);
+
+			_mm_storeu_ps(coverage + i, _mm_min_ps(_mm_andnot_ps(sign, sum), one));
+			_mm_storeu_ps(area + i, _mm_setzero_ps());
+		}
+#else
+		float sum{ 0.0f };
+		for (std::size_t i{ first }; i < last; ++i)
+		{
+			sum += area[i];
+			coverage[i] = (std::min)(std::fabs(sum), 1.0f);
+			area[i] = 0.0f;
+		}
+#endif
+	}
+};
+
+// Draws into a 32-bit premultiplied ARGB surface without GDI+, so shapes can be rendered headless: page
+// images for export, thumbnails, or tiles off the UI thread. It follows the GDI+ backend's conventions,
+// since that's what the pixels are compared against: pens are centred with flat caps and mitred joins
+// (limit 10), fills don't stroke, curves are GDI+'s cardinal splines, and a pen never draws thinner than
+// a pixel. Leland glyphs are filled from the font's outlines, once per size and subpixel position, into a
+// glyph atlas they're blended from after that; other fonts have no outlines here and are skipped.
+class RasterBackend : public VectorBackend
+{
+public:
+	// scale is pixels per canvas pixel for pages, e.g. 0.25 for thumbnails
+	explicit RasterBackend(GlyphOutlines* leland, float scale = 1.0f) : VectorBackend(leland), m_pageScale(scale) {}
+
+	// pages go to PNG files named as SvgBackend names its pages: the path, then name-2.png and so on
+	bool open(const std::filesystem::path& path)
+	{
+		m_path = path;
+		m_pages = 0;
+		return !path.empty();
+	}
+
+	bool beginPage(float left, float top, float width, float height) override
+	{
+		++m_pages;
+		resize(static_cast<int>(std::lround(width * m_pageScale)), static_cast<int>(std::lround(height * m_pageScale)));
+		clear(0xFFFFFFFF);
+		setView(Transform::translation(-left, -top).then(Transform::scaling(m_pageScale, m_pageScale, 0.0f, 0.0f)));
+		return getWidth() > 0 && getHeight() > 0;
+	}
+
+	bool endPage() override
+	{
+		std::filesystem::path pagePath{ m_path };
+		if (m_pages > 1)
+		{
+			std::filesystem::path name{ m_path.stem() };
+			name += "-";
+			name += std::to_string(m_pages);
+			name += m_path.extension();
+			pagePath.replace_filename(name);
+		}
+		return PngWriter::save(pagePath, m_pixels.data(), getWidth(), getHeight());
+	}
+
+	bool finish() override { return m_pages > 0; }
+
+	void resize(int width, int height)
+	{
+		m_mask.resize(width, height);
+		m_pixels.assign(static_cast<std::size_t>(m_mask.getWidth()) * m_mask.getHeight(), 0);
+	}
+
+	int getWidth() const { return m_mask.getWidth(); }
+	int getHeight() const { return m_mask.getHeight(); }
+
+	// premultiplied ARGB rows, top to bottom, laid out like a GDI+ PixelFormat32bppPARGB bitmap
+	const std::uint32_t* getPixels() const { return m_pixels.data(); }
+
+	// fills the surface with a straight ARGB color
+	void clear(std::uint32_t color) { std::fill(m_pixels.begin(), m_pixels.end(), premultiply(color)); }
+
+	// where the canvas lands on the surface; shapes' own transforms go on top of it
+	void setView(const Transform& view)
+	{
+		m_view = view;
+		setTransform(m_shape);
+	}
+
+	void setTransform(const Transform& transform) override
+	{
+		m_shape = transform;
+		m_matrix = transform.then(m_view);
+		m_matrixScale = std::sqrt(std::fabs(m_matrix.a * m_matrix.d - m_matrix.b * m_matrix.c));
+	}
+
+	// how much the view magnifies the canvas, which the shapes use to pick their level of detail
+	float getScale() const override { return std::sqrt(std::fabs(m_view.a * m_view.d - m_view.b * m_view.c)); }
+
+	void drawLine(float x1, float y1, float x2, float y2, std::uint32_t color, float width) override
+	{
+		RenderPoint points[2]{ { x1, y1 }, { x2, y2 } };
+		strokePath(points, 2, false, width);
+		paint(color);
+	}
+
+	void drawRect(float x, float y, float width, float height, std::uint32_t color, float penWidth, bool filled) override
+	{
+		RenderPoint corners[4]{ { x, y }, { x + width, y }, { x + width, y + height }, { x, y + height } };
+		if (filled)
+		{
+			fillPath(corners, 4);
+		}
+		else
+		{
+			strokePath(corners, 4, true, penWidth);
+		}
+		paint(color);
+	}
+
+	void drawEllipse(float x, float y, float width, float height, std::uint32_t color, float penWidth, bool filled) override
+	{
+		m_ellipse.clear();
+		float radiusX{ width / 2.0f };
+		float radiusY{ height / 2.0f };
+		int steps{ getArcSteps((std::max)(std::fabs(radiusX), std::fabs(radiusY)) * m_matrixScale, 6.2831853f) };
+
+		// an inscribed polygon comes up short; pushing its corners out a little gives it the ellipse's area
+		float turn{ 6.2831853f / static_cast<float>(steps) };
+		float grow{ std::sqrt(turn / std::sin(turn)) };
+		for (int i{ 0 }; i < steps; ++i)
+		{
+			float angle{ turn * static_cast<float>(i) };
+			m_ellipse.push_back(RenderPoint{ x + radiusX + grow * radiusX * std::cos(angle), y + radiusY + grow * radiusY * std::sin(angle) });
+		}
+
+		if (filled)
+		{
+			fillPath(m_ellipse.data(), m_ellipse.size());
+		}
+		else
+		{
+			strokePath(m_ellipse.data(), m_ellipse.size(), true, penWidth);
+		}
+		paint(color);
+	}
+
+	void drawPolygon(const RenderPoint* points, std::size_t count, std::uint32_t color, float penWidth, bool filled) override
+	{
+		if (filled)
+		{
+			fillPath(points, count);
+		}
+		else
+		{
+			strokePath(points, count, true, penWidth);
+		}
+		paint(color);
+	}
+
+	void drawCurve(const RenderPoint* points, std::size_t count, std::uint32_t color, float penWidth) override
+	{
+		if (count < 2)
+		{
+			return;
+		}
+
+		m_curve.clear();
+		m_curve.push_back(points[0]);
+		for (std::size_t i{ 0 }; i + 1 < count; ++i)
+		{
+			RenderPoint c1;
+			RenderPoint c2;
+			getCurveControls(points, count, i, c1, c2);
+			flattenCubic(m_curve, points[i], c1, c2, points[i + 1]);
+		}
+		strokePath(m_curve.data(), m_curve.size(), false, penWidth);
+		paint(color);
+	}
+
+	void drawBeziers(const RenderPoint* points, std::size_t count, std::uint32_t color, float penWidth) override
+	{
+		if (count < 4)
+		{
+			return;
+		}
+
+		m_curve.clear();
+		m_curve.push_back(points[0]);
+		for (std::size_t i{ 0 }; i + 3 < count; i += 3)
+		{
+			flattenCubic(m_curve, points[i], points[i + 1], points[i + 2], points[i + 3]);
+		}
+		strokePath(m_curve.data(), m_curve.size(), false, penWidth);
+		paint(color);
+	}
+
+	void drawPolyline(const RenderPoint* points, std::size_t count, std::uint32_t color, float width) override
+	{
+		strokePath(points, count, false, width);
+		paint(color);
+	}
+
+	void drawText(const std::wstring& text, float x, float y, const std::wstring& family, float size, std::uint32_t color) override
+	{
+		if (!usesLeland(family))
+		{
+			return;
+		}
+
+		// upright glyphs come from the atlas; rotated, skewed or oversized ones are filled from their outlines
+		bool upright{ m_useAtlas && m_matrix.b == 0.0f && m_matrix.c == 0.0f && m_matrix.a == m_matrix.d && m_matrix.a > 0.0f };
+		layoutLeland(text, x, y, size, [&](std::uint16_t glyph, float originX, float baseline, float scale) {
+			if (upright && drawCachedGlyph(glyph, originX, baseline, scale, color))
+			{
+				return;
+			}
+
+			// outlines are in font units, y up
+			GlyphSink sink(m_mask, Transform{ scale, 0.0f, 0.0f, -scale, originX, baseline }.then(m_matrix));
+			m_leland->getOutline(glyph, sink);
+			sink.closePath();
+		});
+		paint(color);
+	}
+
+	GlyphAtlas& getGlyphAtlas() { return m_atlas; }
+
+	// off fills every glyph from its outline, as before the atlas; for measuring one against the other
+	void setGlyphAtlas(bool enabled) { m_useAtlas = enabled; }
+
+private:
+	static constexpr float kTolerance{ 0.2f }; // how far flattened curves may stray, in pixels
+	static constexpr float kMiterLimit{ 10.0f }; // GDI+'s default
+
+	std::filesystem::path m_path;
+	int m_pages{ 0 };
+	float m_pageScale;
+
+	CoverageMask m_mask;
+	CoverageMask m_glyphMask; // a glyph on its way into the atlas
+	GlyphAtlas m_atlas;
+	bool m_useAtlas{ true };
+	std::vector<std::uint32_t> m_pixels;
+	Transform m_view;
+	Transform m_shape;
+	Transform m_matrix; // m_shape then m_view: canvas to pixels for what's being drawn
+	float m_matrixScale{ 1.0f };
+	std::vector<RenderPoint> m_ellipse; // scratch
+	std::vector<RenderPoint> m_curve;
+
+	// feeds a glyph's outline to the mask, flattened in pixels
+	class GlyphSink : public OutlineSink
+	{
+	public:
+		GlyphSink(CoverageMask& mask, const Transform& toPixels) : m_mask(mask), m_toPixels(toPixels) {}
+
+		void moveTo(float x, float y) override
+		{
+			closePath();
+			m_start = map(x, y);
+			m_at = m_start;
+		}
+
+		void lineTo(float x, float y) override
+		{
+			RenderPoint to{ map(x, y) };
+			m_mask.addEdge(m_at.x, m_at.y, to.x, to.y);
+			m_at = to;
+		}
+
+		void cubicTo(float x1, float y1, float x2, float y2, float x, float y) override
+		{
+			m_points.clear();
+			m_points.push_back(m_at);
+			flattenInPixels(m_points, m_at, map(x1, y1), map(x2, y2), map(x, y));
+			for (std::size_t i{ 1 }; i < m_points.size(); ++i)
+			{
+				m_mask.addEdge(m_points[i - 1].x, m_points[i - 1].y, m_points[i].x, m_points[i].y);
+			}
+			m_at = m_points.back();
+		}
+
+		void closePath() override
+		{
+			m_mask.addEdge(m_at.x, m_at.y, m_start.x, m_start.y);
+			m_at = m_start;
+		}
+
+	private:
+		CoverageMask& m_mask;
+		Transform m_toPixels;
+		RenderPoint m_start{ 0.0f, 0.0f };
+		RenderPoint m_at{ 0.0f, 0.0f };
+		std::vector<RenderPoint> m_points;
+
+		RenderPoint map(float x, float y) const { return RenderPoint{ m_toPixels.mapX(x, y), m_toPixels.mapY(x, y) }; }
+	};
+
+	static std::uint32_t premultiply(std::uint32_t color)
+	{
+		std::uint32_t alpha{ color >> 24 };
+		std::uint32_t red{ (((color >> 16) & 0xFF) * alpha + 127) / 255 };
+		std::uint32_t green{ (((color >> 8) & 0xFF) * alpha + 127) / 255 };
+		std::uint32_t blue{ ((color & 0xFF) * alpha + 127) / 255 };
+		return alpha << 24 | red << 16 | green << 8 | blue;
+	}
+
+	// segments for an arc of the given angle and radius in pixels, so no chord strays past the tolerance
+	static int getArcSteps(float radius, float angle)
+	{
+		if (radius <= kTolerance)
+		{
+			return 4;
+		}
+		float step{ 2.0f * std::acos(1.0f - kTolerance / radius) };
+		return std::clamp(static_cast<int>(std::ceil(std::fabs(angle) / step)), 4, 1024);
+	}
+
+	// appends a cubic's points after p0, already in pixels
+	static void flattenInPixels(std::vector<RenderPoint>& out, RenderPoint p0, RenderPoint p1, RenderPoint p2, RenderPoint p3)
+	{
+		// a cubic strays from its chords by at most 3/4 of its largest second difference over steps squared
+		float ddx{ (std::max)(std::fabs(p0.x - 2.0f * p1.x + p2.x), std::fabs(p1.x - 2.0f * p2.x + p3.x)) };
+		float ddy{ (std::max)(std::fabs(p0.y - 2.0f * p1.y + p2.y), std::fabs(p1.y - 2.0f * p2.y + p3.y)) };
+		float bend{ std::sqrt(ddx * ddx + ddy * ddy) };
+		int steps{ std::clamp(static_cast<int>(std::ceil(std::sqrt(0.75f * bend / kTolerance))), 1, 256) };
+
+		for (int i{ 1 }; i <= steps; ++i)
+		{
+			float t{ static_cast<float>(i) / static_cast<float>(steps) };
+			float u{ 1.0f - t };
+			float w0{ u * u * u };
+			float w1{ 3.0f * u * u * t };
+			float w2{ 3.0f * u * t * t };
+			float w3{ t * t * t };
+			out.push_back(RenderPoint{ w0 * p0.x + w1 * p1.x + w2 * p2.x + w3 * p3.x, w0 * p0.y + w1 * p1.y + w2 * p2.y + w3 * p3.y });
+		}
+	}
+
+	// appends a cubic's points after p0, in canvas pixels but stepped finely enough for the surface
+	void flattenCubic(std::vector<RenderPoint>& out, RenderPoint p0, RenderPoint p1, RenderPoint p2, RenderPoint p3) const
+	{
+		std::size_t first{ out.size() };
+		flattenInPixels(out, toPixels(p0), toPixels(p1), toPixels(p2), toPixels(p3));
+
+		// the steps were counted in pixels; take the points from the canvas curve so strokes stay in canvas units
+		std::size_t steps{ out.size() - first };
+		for (std::size_t i{ 1 }; i <= steps; ++i)
+		{
+			float t{ static_cast<float>(i) / static_cast<float>(steps) };
+			float u{ 1.0f - t };
+			float w0{ u * u * u };
+			float w1{ 3.0f * u * u * t };
+			float w2{ 3.0f * u * t * t };
+			float w3{ t * t * t };
+			out[first + i - 1] = RenderPoint{ w0 * p0.x + w1 * p1.x + w2 * p2.x + w3 * p3.x, w0 * p0.y + w1 * p1.y + w2 * p2.y + w3 * p3.y };
+		}
+	}
+
+	RenderPoint toPixels(RenderPoint point) const { return RenderPoint{ m_matrix.mapX(point.x, point.y), m_matrix.mapY(point.x, point.y) }; }
+
+	// a closed outline in canvas pixels
+	void fillPath(const RenderPoint* points, std::size_t count)
+	{
+		if (count < 3)
+		{
+			return;
+		}
+
+		RenderPoint from{ toPixels(points[count - 1]) };
+		for (std::size_t i{ 0 }; i < count; ++i)
+		{
+			RenderPoint to{ toPixels(points[i]) };
+			m_mask.addEdge(from.x, from.y, to.x, to.y);
+			from = to;
+		}
+	}
+
+	// a convex piece of a stroke, turned to wind the same way as every other piece so overlaps add up
+	void addPiece(const RenderPoint* points, std::size_t count)
+	{
+		RenderPoint pixels[4];
+		float area{ 0.0f };
+		for (std::size_t i{ 0 }; i < count; ++i)
+		{
+			pixels[i] = toPixels(points[i]);
+		}
+		for (std::size_t i{ 0 }; i < count; ++i)
+		{
+			const RenderPoint& a{ pixels[i] };
+			const RenderPoint& b{ pixels[(i + 1) % count] };
+			area += a.x * b.y - b.x * a.y;
+		}
+
+		for (std::size_t i{ 0 }; i < count; ++i)
+		{
+			const RenderPoint& a{ pixels[i] };
+			const RenderPoint& b{ pixels[(i + 1) % count] };
+			if (area < 0.0f)
+			{
+				m_mask.addEdge(a.x, a.y, b.x, b.y);
+			}
+			else
+			{
+				m_mask.addEdge(b.x, b.y, a.x, a.y);
+			}
+		}
+	}
+
+	// a centred pen along points: a quad per segment and a mitre, or a bevel past the limit, at each turn
+	void strokePath(const RenderPoint* points, std::size_t count, bool closed, float width)
+	{
+		if (count < 2 || m_matrixScale <= 0.0f)
+		{
+			return;
+		}
+
+		float half{ (std::max)(width, 1.0f / m_matrixScale) / 2.0f };
+
+		RenderPoint previous{ 0.0f, 0.0f }; // the last segment's normal, half the pen wide
+		RenderPoint first{ 0.0f, 0.0f };
+		bool hasPrevious{ false };
+		std::size_t segments{ closed ? count : count - 1 };
+		for (std::size_t i{ 0 }; i < segments; ++i)
+		{
+			const RenderPoint& from{ points[i] };
+			const RenderPoint& to{ points[(i + 1) % count] };
+			float dx{ to.x - from.x };
+			float dy{ to.y - from.y };
+			float length{ std::sqrt(dx * dx + dy * dy) };
+			if (length == 0.0f)
+			{
+				continue;
+			}
+
+			RenderPoint normal{ -dy / length * half, dx / length * half };
+			RenderPoint quad[4]{ from + normal, to + normal, to - normal, from - normal };
+			addPiece(quad, 4);
+
+			if (hasPrevious)
+			{
+				addJoin(from, previous, normal, half);
+			}
+			else
+			{
+				first = normal;
+			}
+			previous = normal;
+			hasPrevious = true;
+		}
+
+		if (closed && hasPrevious)
+		{
+			addJoin(points[0], previous, first, half);
+		}
+	}
+
+	// fills the wedge on the outside of a turn at point, between the pen edges of two segments
+	void addJoin(RenderPoint point, RenderPoint before, RenderPoint after, float half)
+	{
+		float cross{ before.x * after.y - before.y * after.x };
+		if (cross == 0.0f)
+		{
+			return;
+		}
+
+		// the outside of the turn is where the two segments' pen edges part
+		float side{ cross > 0.0f ? -1.0f : 1.0f };
+		RenderPoint a{ point + before * side };
+		RenderPoint b{ point + after * side };
+
+		RenderPoint bisector{ before + after };
+		float length{ std::sqrt(bisector.x * bisector.x + bisector.y * bisector.y) };
+		if (length > 0.0f && 2.0f * half / length <= kMiterLimit)
+		{
+			RenderPoint tip{ point + bisector * (side * 2.0f * half * half / (length * length)) };
+			RenderPoint miter[4]{ point, a, tip, b };
+			addPiece(miter, 4);
+		}
+		else
+		{
+			RenderPoint bevel[3]{ point, a, b };
+			addPiece(bevel, 3);
+		}
+	}
+
+	// blends color through the mask's coverage onto the pixels, then readies the mask for the next path
+	void paint(std::uint32_t color)
+	{
+		if (m_mask.isEmpty())
+		{
+			m_mask.reset();
+			return;
+		}
+
+		std::uint32_t source{ premultiply(color) };
+		float alpha{ static_cast<float>(source >> 24) };
+		float red{ static_cast<float>((source >> 16) & 0xFF) };
+		float green{ static_cast<float>((source >> 8) & 0xFF) };
+		float blue{ static_cast<float>(source & 0xFF) };
+
+		int left{ (std::max)(0, m_mask.getLeft()) };
+		int right{ m_mask.getRight() };
+		for (int y{ m_mask.getTop() }; y <= m_mask.getBottom(); ++y)
+		{
+			const float* coverage{ m_mask.sweep(y) };
+			std::uint32_t* row{ &m_pixels[static_cast<std::size_t>(y) * getWidth()] };
+			for (int x{ left }; x <= right; ++x)
+			{
+				float cover{ coverage[x] };
+				if (cover < 1.0f / 512.0f)
+				{
+					continue;
+				}
+				if (cover >= 1.0f && (source >> 24) == 0xFF)
+				{
+					row[x] = source;
+					continue;
+				}
+
+				row[x] = blend(row[x], alpha, red, green, blue, cover);
+			}
+		}
+		m_mask.reset();
+	}
+
+	// source over pixel, with the premultiplied source's channels scaled by cover
+	static std::uint32_t blend(std::uint32_t pixel, float alpha, float red, float green, float blue, float cover)
+	{
+		float keep{ 1.0f - alpha * cover / 255.0f };
+		std::uint32_t a{ static_cast<std::uint32_t>(alpha * cover + static_cast<float>(pixel >> 24) * keep + 0.5f) };
+		std::uint32_t r{ static_cast<std::uint32_t>(red * cover + static_cast<float>((pixel >> 16) & 0xFF) * keep + 0.5f) };
+		std::uint32_t g{ static_cast<std::uint32_t>(green * cover + static_cast<float>((pixel >> 8) & 0xFF) * keep + 0.5f) };
+		std::uint32_t b{ static_cast<std::uint32_t>(blue * cover + static_cast<float>(pixel & 0xFF) * keep + 0.5f) };
+		return (std::min)(a, 255u) << 24 | (std::min)(r, 255u) << 16 | (std::min)(g, 255u) << 8 | (std::min)(b, 255u);
+	}
+
+	// Blends a glyph's mask from the atlas, drawing it into the atlas first if it isn't there; false if it's
+	// too big to keep. The em size and the pen are rounded to the atlas's steps, a few hundredths of a pixel.
+	bool drawCachedGlyph(std::uint16_t glyph, float originX, float baseline, float scale, std::uint32_t color)
+	{
+		float unitsPerEm{ static_cast<float>(m_leland->getUnitsPerEm()) };
+		int sizeSteps{ static_cast<int>(std::lround(scale * unitsPerEm * m_matrix.a * GlyphAtlas::kSizeSteps)) };
+		if (sizeSteps <= 0)
+		{
+			return true;
+		}
+
+		// the pen in pixels, split into a whole pixel and a subpixel step
+		long penX{ std::lround(m_matrix.mapX(originX, baseline) * GlyphAtlas::kSubpixels) };
+		long penY{ std::lround(m_matrix.mapY(originX, baseline) * GlyphAtlas::kSubpixels) };
+		long wholeX{ penX >= 0 ? penX / GlyphAtlas::kSubpixels : -((-penX + GlyphAtlas::kSubpixels - 1) / GlyphAtlas::kSubpixels) };
+		long wholeY{ penY >= 0 ? penY / GlyphAtlas::kSubpixels : -((-penY + GlyphAtlas::kSubpixels - 1) / GlyphAtlas::kSubpixels) };
+		int subX{ static_cast<int>(penX - wholeX * GlyphAtlas::kSubpixels) };
+		int subY{ static_cast<int>(penY - wholeY * GlyphAtlas::kSubpixels) };
+
+		std::uint64_t key{ GlyphAtlas::keyOf(glyph, sizeSteps, subX, subY) };
+		const GlyphAtlas::Entry* entry{ m_atlas.find(key) };
+		if (!entry)
+		{
+			entry = rasterizeGlyph(key, glyph, static_cast<float>(sizeSteps) / GlyphAtlas::kSizeSteps / unitsPerEm,
+				static_cast<float>(subX) / GlyphAtlas::kSubpixels, static_cast<float>(subY) / GlyphAtlas::kSubpixels);
+			if (!entry)
+			{
+				return false;
+			}
+		}
+
+		std::uint32_t source{ premultiply(color) };
+		long left{ wholeX + entry->left };
+		long top{ wholeY + entry->top };
+		long firstX{ (std::max)(0L, -left) };
+		long lastX{ (std::min)(static_cast<long>(entry->width), getWidth() - left) };
+		long firstY{ (std::max)(0L, -top) };
+		long lastY{ (std::min)(static_cast<long>(entry->height), getHeight() - top) };
+		for (long y{ firstY }; y < lastY; ++y)
+		{
+			const std::uint8_t* mask{ entry->mask + static_cast<std::size_t>(y) * entry->stride };
+			std::uint32_t* row{ &m_pixels[static_cast<std::size_t>(top + y) * getWidth() + left] };
+			for (long x{ firstX }; x < lastX; ++x)
+			{
+				std::uint8_t cover{ mask[x] };
+				if (cover == 0)
+				{
+					continue;
+				}
+				if (cover == 255 && (source >> 24) == 0xFF)
+				{
+					row[x] = source;
+					continue;
+				}
+				row[x] = blend(row[x], source, cover);
+			}
+		}
+		return true;
+	}
+
+	// source over pixel at 8-bit coverage, in integers: each channel is (s c 255 + d (255² - sa c)) / 255²
+	static std::uint32_t blend(std::uint32_t pixel, std::uint32_t source, std::uint32_t cover)
+	{
+		std::uint32_t keep{ 255 * 255 - (source >> 24) * cover };
+		std::uint32_t result{ 0 };
+		for (int shift : { 24, 16, 8, 0 })
+		{
+			std::uint32_t channel{ (((source >> shift) & 0xFF) * cover * 255 + ((pixel >> shift) & 0xFF) * keep + 255 * 255 / 2) / (255 * 255) };
+			result |= channel << shift;
+		}
+		return result;
+	}
+
+	// draws glyph at pixelsPerUnit into the atlas with the pen at (penX, penY) within its pixel; null if it
+	// has no outline or doesn't fit a page
+	const GlyphAtlas::Entry* rasterizeGlyph(std::uint64_t key, std::uint16_t glyph, float pixelsPerUnit, float penX, float penY)
+	{
+		OutlineBounds bounds;
+		m_leland->getOutline(glyph, bounds);
+		if (bounds.isEmpty())
+		{
+			// nothing to draw; a blank entry keeps it from being measured again
+			return m_atlas.insert(key, 1, 1, 0, 0);
+		}
+
+		// a pixel of margin around the outline for its antialiased edge
+		int left{ static_cast<int>(std::floor(bounds.getXMin() * pixelsPerUnit + penX)) - 1 };
+		int top{ static_cast<int>(std::floor(-bounds.getYMax() * pixelsPerUnit + penY)) - 1 };
+		int width{ static_cast<int>(std::ceil(bounds.getXMax() * pixelsPerUnit + penX)) + 1 - left };
+		int height{ static_cast<int>(std::ceil(-bounds.getYMin() * pixelsPerUnit + penY)) + 1 - top };
+		if (width > GlyphAtlas::kPageSize || height > GlyphAtlas::kPageSize)
+		{
+			return nullptr;
+		}
+
+		const GlyphAtlas::Entry* entry{ m_atlas.insert(key, width, height, left, top) };
+		if (!entry)
+		{
+			return nullptr;
+		}
+
+		m_glyphMask.resize(width, height);
+		GlyphSink sink(m_glyphMask, Transform{ pixelsPerUnit, 0.0f, 0.0f, -pixelsPerUnit, penX - static_cast<float>(left), penY - static_cast<float>(top) });
+		m_leland->getOutline(glyph, sink);
+		sink.closePath();
+
+		if (!m_glyphMask.isEmpty())
+		{
+			int first{ (std::max)(0, m_glyphMask.getLeft()) };
+			int last{ m_glyphMask.getRight() };
+			for (int y{ m_glyphMask.getTop() }; y <= m_glyphMask.getBottom(); ++y)
+			{
+				const float* coverage{ m_glyphMask.sweep(y) };
+				for (int x{ first }; x <= last; ++x)
+				{
+					entry->mask[static_cast<std::size_t>(y) * entry->stride + x] = static_cast<std::uint8_t>(coverage[x] * 255.0f + 0.5f);
+				}
+			}
+		}
+		m_glyphMask.reset();
+		return entry;
+	}
+};
@@ -0,0 +1,92 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include "Geometry.h"
+#include "StyleTable.h"
+
+// A point as backends see it; laid out like GDI+'s PointF so shapes can hand their points over as-is
+struct RenderPoint
+{
+	float x;
+	float y;
+};
+
+inline RenderPoint operator+(RenderPoint a, RenderPoint b) { return RenderPoint{ a.x + b.x, a.y + b.y }; }
+inline RenderPoint operator-(RenderPoint a, RenderPoint b) { return RenderPoint{ a.x - b.x, a.y - b.y }; }
+inline RenderPoint operator*(RenderPoint a, float s) { return RenderPoint{ a.x * s, a.y * s }; }
+
+// What ShapeStore::render draws to. The GDI+ backend paints the window; the SVG and PDF backends write files.
+// Coordinates are canvas pixels with y pointing down, and colors are ARGB.
+class RenderBackend
+{
+public:
+	virtual ~RenderBackend() = default;
+
+	virtual void drawLine(float x1, float y1, float x2, float y2, std::uint32_t color, float width) = 0;
+	virtual void drawRect(float x, float y, float width, float height, std::uint32_t color, float penWidth, bool filled) = 0;
+	virtual void drawEllipse(float x, float y, float width, float height, std::uint32_t color, float penWidth, bool filled) = 0;
+	virtual void drawPolygon(const RenderPoint* points, std::size_t count, std::uint32_t color, float penWidth, bool filled) = 0;
+
+	// cardinal spline through the points with GDI+'s default tension of 0.5
+	virtual void drawCurve(const RenderPoint* points, std::size_t count, std::uint32_t color, float penWidth) = 0;
+
+	// cubic Béziers laid out like GDI+'s DrawBeziers: the start, then two controls and an end per segment
+	virtual void drawBeziers(const RenderPoint* points, std::size_t count, std::uint32_t color, float penWidth) = 0;
+
+	// lays the text out the way GDI+'s DrawString does from a point: (x, y) is the top left of the line
+	virtual void drawText(const std::wstring& text, float x, float y, const std::wstring& family, float size, std::uint32_t color) = 0;
+
+	// Maps what's drawn next through transform, on top of the backend's own mapping to the window or page.
+	// The identity goes back to plain canvas coordinates; strokes and text scale along with the shapes.
+	virtual void setTransform(const Transform& transform) = 0;
+
+	// Which interned style the next calls draw with, or kNoStyle. Only a hint for backends that keep
+	// something per style; the color and width passed to each call are still what gets drawn.
+	virtual void setStyle(StyleId) {}
+
+	// straight segments through the points; backends with a native polyline draw it in one call
+	virtual void drawPolyline(const RenderPoint* points, std::size_t count, std::uint32_t color, float width)
+	{
+		for (std::size_t i{ 1 }; i < count; ++i)
+		{
+			drawLine(points[i - 1].x, points[i - 1].y, points[i].x, points[i].y, color, width);
+		}
+	}
+
+	// How many device pixels a canvas pixel spans. Zoomed out past kCoarseScale, renderShape draws
+	// stand-ins for detail too small to see; files are always drawn in full.
+	virtual float getScale() const { return 1.0f; }
+};
+
+// A backend that writes pages, like the exporters. Everything drawn between beginPage and endPage lands
+// on one page, which shows the canvas area [left, left + width) x [top, top + height).
+class PageBackend : public RenderBackend
+{
+public:
+	virtual bool beginPage(float left, float top, float width, float height) = 0;
+	virtual bool endPage() = 0;
+	virtual bool finish() = 0;
+};
+
+// Where Symbol and Text start drawing relative to their corner, for a font of the given pixel size
+inline RenderPoint scoreTextOffset(int size)
+{
+	float diagonal{ (size < 0 ? -size : size) * 1.41421356f }; // diagonal of a size x size square
+	return RenderPoint{ -diagonal / 10.0f, -diagonal / 1.5f };
+}
+
+// The staff a Measure draws: five lines spaced size / 4 apart, closed off at both ends
+inline void renderStaff(RenderBackend& backend, float x, float y, float length, float size, std::uint32_t color, float width)
+{
+	backend.drawLine(x, y, x, y + size, color, width); // left edge; could make optional
+
+	for (int line{ 0 }; line <= 4; ++line)
+	{
+		float lineY{ y + size * line / 4 };
+		backend.drawLine(x, lineY, x + length, lineY, color, width);
+	}
+
+	backend.drawLine(x + length, y, x + length, y + size, color, width); // right edge; same as above
+}
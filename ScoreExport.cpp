@@ -0,0 +1,164 @@
+// score-export: converts Simple Score documents to PDF, SVG or PNG without a window, e.g. on a build server.
+// It shares the document reader and export backends with the app and needs nothing but the standard library:
+//
+//     g++ -std=c++17 -O2 -o score-export ScoreExport.cpp
+//
+// PNG pages are rasterized with SSE2 on x86-64; add -mavx2 for the AVX2 coverage kernel.
+//
+// It isn't part of the Visual Studio project; the app exports through File > Export.
+
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <string>
+#include <vector>
+#include "DocumentExport.h"
+#include "PdfBackend.h"
+#include "RasterBackend.h"
+#include "SvgBackend.h"
+
+static void printUsage()
+{
+    std::fprintf(stderr,
+        "usage: score-export [--format pdf|svg|png] [--font Leland.otf] [--page WIDTHxHEIGHT] [--scale N] [--out DIR] FILE.ssd...\n"
+        "\n"
+        "  --format  output format (default pdf)\n"
+        "  --font    Leland, for symbols (default ./Leland.otf; without it they export as plain text)\n"
+        "  --page    page size in canvas pixels, 96 to the inch (default 816x1056, US Letter)\n"
+        "  --scale   PNG pixels per canvas pixel, e.g. 0.25 for thumbnails (default 1)\n"
+        "  --out     directory for the output (default beside each input)\n");
+}
+
+static bool parsePage(const std::string& text, float& width, float& height)
+{
+    char* end{ nullptr };
+    width = std::strtof(text.c_str(), &end);
+    if (*end != 'x' && *end != 'X')
+    {
+        return false;
+    }
+    height = std::strtof(end + 1, &end);
+    return *end == '\0' && width > 0.0f && height > 0.0f;
+}
+
+static bool exportFile(const std::filesystem::path& input, const std::filesystem::path& output, const std::string& format, GlyphOutlines& leland, float pageWidth, float pageHeight, float scale)
+{
+    DocumentReader reader;
+    if (!reader.open(input))
+    {
+        std::fprintf(stderr, "%s: not a Simple Score document, or saved by a newer version\n", input.string().c_str());
+        return false;
+    }
+
+    bool written{ false };
+    if (format == "svg")
+    {
+        SvgBackend backend(&leland);
+        written = backend.open(output) && exportDocument(reader, backend, pageWidth, pageHeight);
+    }
+    else if (format == "png")
+    {
+        RasterBackend backend(&leland, scale);
+        written = backend.open(output) && exportDocument(reader, backend, pageWidth, pageHeight);
+    }
+    else
+    {
+        PdfBackend backend(&leland);
+        written = backend.open(output) && exportDocument(reader, backend, pageWidth, pageHeight);
+    }
+
+    if (!written)
+    {
+        std::fprintf(stderr, "%s: failed to write %s\n", input.string().c_str(), output.string().c_str());
+    }
+    return written;
+}
+
+int main(int argc, char** argv)
+{
+    std::string format{ "pdf" };
+    std::filesystem::path fontPath{ "Leland.otf" };
+    std::filesystem::path outDir;
+    float pageWidth{ kExportPageWidth };
+    float pageHeight{ kExportPageHeight };
+    float scale{ 1.0f };
+    std::vector<std::filesystem::path> inputs;
+
+    for (int i{ 1 }; i < argc; ++i)
+    {
+        std::string arg{ argv[i] };
+        bool hasValue{ i + 1 < argc };
+
+        if (arg == "--format" && hasValue)
+        {
+            format = argv[++i];
+            if (format != "pdf" && format != "svg" && format != "png")
+            {
+                printUsage();
+                return 2;
+            }
+        }
+        else if (arg == "--font" && hasValue)
+        {
+            fontPath = argv[++i];
+        }
+        else if (arg == "--page" && hasValue)
+        {
+            if (!parsePage(argv[++i], pageWidth, pageHeight))
+            {
+                printUsage();
+                return 2;
+            }
+        }
+        else if (arg == "--scale" && hasValue)
+        {
+            char* end{ nullptr };
+            scale = std::strtof(argv[++i], &end);
+            if (*end != '\0' || !(scale > 0.0f))
+            {
+                printUsage();
+                return 2;
+            }
+        }
+        else if (arg == "--out" && hasValue)
+        {
+            outDir = argv[++i];
+        }
+        else if (arg.size() > 1 && arg[0] == '-')
+        {
+            printUsage();
+            return 2;
+        }
+        else
+        {
+            inputs.emplace_back(arg);
+        }
+    }
+
+    if (inputs.empty())
+    {
+        printUsage();
+        return 2;
+    }
+
+    GlyphOutlines leland;
+    if (!leland.open(fontPath))
+    {
+        std::fprintf(stderr, "warning: couldn't read %s; symbols will be exported as plain text\n", fontPath.string().c_str());
+    }
+
+    int failures{ 0 };
+    for (const auto& input : inputs)
+    {
+        std::filesystem::path output{ outDir.empty() ? input.parent_path() : outDir };
+        output /= input.stem();
+        output += "." + format;
+
+        if (!exportFile(input, output, format, leland, pageWidth, pageHeight, scale))
+        {
+            ++failures;
+        }
+    }
+
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,1762 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <iterator>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "DocumentFile.h"
+#include "Geometry.h"
+#include "RenderBackend.h"
+#include "SpatialIndex.h"
+#include "StyleTable.h"
+
+// Names a stored shape. It stays valid through moves, restyles and z-order changes, and stops matching
+// once the shape is removed, even after its slot is reused (for the next 255 reuses).
+using ShapeHandle = std::uint32_t;
+constexpr ShapeHandle kNoShape{ 0xFFFFFFFF };
+
+// Every kind is kept as a list of x, y pairs:
+//   Line      the two ends
+//   Ellipse   the corner the drag started from, then the opposite corner
+//   Rect      the same
+//   Triangle  the three vertices
+//   Sketch    every sampled point, drawn as a cardinal spline (documents from before curve fitting)
+//   Curve     the start, then two controls and an end per cubic Bézier segment
+//   Measure   the top left corner, then that corner + (length, staff height)
+//   Symbol    the corner, then the corner + (size, size); the glyph is the shape's text
+//   Text      the same; the string and font family are the shape's text and font
+//   Group     none; it draws the shapes in it, whose transforms take them into the group's coordinates
+// Points are in the shape's own coordinates, and a transform per shape takes them onto the canvas, or into
+// its group's coordinates when it's in one: moving a shape is O(1) however many points it has, and scaling
+// or rotating one never rewrites them.
+
+static_assert(sizeof(RenderPoint) == 2 * sizeof(float), "RenderPoint is an x, y pair");
+
+inline const RenderPoint* asRenderPoints(const float* xy) { return reinterpret_cast<const RenderPoint*>(xy); }
+
+// box around the points themselves; selection and the rubber band test against this
+inline Bounds getShapeExtent(const float* xy, std::size_t pointCount)
+{
+	if (pointCount == 0)
+	{
+		return Bounds::empty();
+	}
+
+	Bounds extent{ xy[0], xy[1], xy[0], xy[1] };
+	for (std::size_t i{ 1 }; i < pointCount; ++i)
+	{
+		extent.left = (std::min)(extent.left, xy[2 * i]);
+		extent.right = (std::max)(extent.right, xy[2 * i]);
+		extent.top = (std::min)(extent.top, xy[2 * i + 1]);
+		extent.bottom = (std::max)(extent.bottom, xy[2 * i + 1]);
+	}
+	return extent;
+}
+
+// box covering every pixel the shape paints; the spatial index and damage tracking rely on it
+inline Bounds getShapeBounds(ShapeKind kind, const float* xy, std::size_t pointCount, int stroke, std::size_t textLength)
+{
+	Bounds bounds{ getShapeExtent(xy, pointCount).inflated(stroke / 2.0f + 2.0f) };
+
+	switch (kind)
+	{
+	case ShapeKind::Triangle:
+	{
+		// hit testing allows an area slack of 100, which reaches up to 100 / edge pixels outside an edge
+		float shortest{ (std::min)({ std::hypot(xy[2] - xy[0], xy[3] - xy[1]), std::hypot(xy[4] - xy[2], xy[5] - xy[3]), std::hypot(xy[0] - xy[4], xy[1] - xy[5]) }) };
+		return bounds.inflated(100.0f / (std::max)(shortest, 1.0f));
+	}
+	case ShapeKind::Sketch:
+	{
+		// DrawCurve's cardinal spline can bulge past the points by up to a third of a segment
+		float longest{ 0.0f };
+		for (std::size_t i{ 1 }; i < pointCount; ++i)
+		{
+			longest = (std::max)(longest, std::hypot(xy[2 * i] - xy[2 * i - 2], xy[2 * i + 1] - xy[2 * i - 1]));
+		}
+		return bounds.inflated(longest / 3.0f);
+	}
+	case ShapeKind::Symbol:
+	case ShapeKind::Text:
+	{
+		float size{ xy[2] - xy[0] };
+		float em{ std::abs(size) };
+		RenderPoint offset{ scoreTextOffset(static_cast<int>(std::lround(size))) };
+		float x{ xy[0] + offset.x };
+		float y{ xy[1] + offset.y };
+
+		// Leland's font box reaches about a quarter em left of the origin, 2.3 em right and 4 em down;
+		// other fonts get no metrics here, so allow a full em per character and two ems of line height
+		Bounds text{ kind == ShapeKind::Symbol ? Bounds{ x - em * 0.3f, y, x + em * 2.5f, y + em * 4.1f } : Bounds{ x, y, x + em * (textLength + 1), y + em * 2.0f } };
+		return text.united(bounds).inflated(2.0f);
+	}
+	default:
+		return bounds;
+	}
+}
+
+// fills xy with a document record's points, laid out as above; false for a kind this build doesn't know
+inline bool getRecordPoints(const DocumentReader& reader, const ShapeRecord& record, std::vector<float>& xy)
+{
+	const float* v{ record.values };
+	xy.clear();
+
+	switch (record.kind)
+	{
+	case ShapeKind::Line:
+		xy.assign(v, v + 4);
+		return true;
+	case ShapeKind::Ellipse:
+	case ShapeKind::Rect:
+	case ShapeKind::Measure:
+		// documents keep a corner and a size
+		xy.assign({ v[0], v[1], v[0] + v[2], v[1] + v[3] });
+		return true;
+	case ShapeKind::Triangle:
+		xy.assign(v, v + 6);
+		return true;
+	case ShapeKind::Sketch:
+	case ShapeKind::Curve:
+		xy.reserve(2 * static_cast<std::size_t>(record.pointCount));
+		for (std::uint32_t i{ 0 }; i < record.pointCount; ++i)
+		{
+			xy.push_back(reader.getPointX(record.pointFirst + i));
+			xy.push_back(reader.getPointY(record.pointFirst + i));
+		}
+		return true;
+	case ShapeKind::Symbol:
+	case ShapeKind::Text:
+		xy.assign({ v[0], v[1], v[0] + v[2], v[1] + v[2] });
+		return true;
+	case ShapeKind::Group:
+		return true;
+	default:
+		return false;
+	}
+}
+
+// below this many device pixels per canvas pixel, glyphs are a few pixels across and strokes' wiggles vanish
+constexpr float kCoarseScale{ 0.5f };
+
+// a stroke as a polyline through every stride-th point, dropping points within a device pixel of the last
+// one kept; Béziers pass 3 so only the points on the curve are used
+inline void renderSimplified(RenderBackend& backend, const RenderPoint* points, std::size_t count, std::size_t stride, std::uint32_t color, float width)
+{
+	thread_local std::vector<RenderPoint> kept;
+	kept.clear();
+
+	float tolerance{ 1.0f / backend.getScale() };
+	for (std::size_t i{ 0 }; i < count; i += stride)
+	{
+		if (kept.empty() || std::abs(points[i].x - kept.back().x) + std::abs(points[i].y - kept.back().y) >= tolerance)
+		{
+			kept.push_back(points[i]);
+		}
+	}
+	if (count > 1 && (kept.size() < 2 || kept.back().x != points[count - 1].x || kept.back().y != points[count - 1].y))
+	{
+		kept.push_back(points[count - 1]);
+	}
+
+	backend.drawPolyline(kept.data(), kept.size(), color, width);
+}
+
+// draws one shape from its points; stored shapes, the live previews and the exporters all come through here
+// style is the interned id of (color, stroke, filled) when there is one, so backends can reuse what they made for it
+inline void renderShape(RenderBackend& backend, ShapeKind kind, const float* xy, std::size_t pointCount, std::uint32_t color, int stroke, bool filled, const std::wstring& text, const std::wstring& font, StyleId style = kNoStyle)
+{
+	float width{ static_cast<float>(stroke) };
+	bool coarse{ backend.getScale() < kCoarseScale };
+	backend.setStyle(style);
+
+	switch (kind)
+	{
+	case ShapeKind::Line:
+		backend.drawLine(xy[0], xy[1], xy[2], xy[3], color, width);
+		break;
+	case ShapeKind::Ellipse:
+		backend.drawEllipse(xy[0], xy[1], xy[2] - xy[0], xy[3] - xy[1], color, width, filled);
+		break;
+	case ShapeKind::Rect:
+		backend.drawRect(xy[0], xy[1], xy[2] - xy[0], xy[3] - xy[1], color, width, filled);
+		break;
+	case ShapeKind::Triangle:
+		backend.drawPolygon(asRenderPoints(xy), 3, color, width, filled);
+		break;
+	case ShapeKind::Sketch:
+		if (coarse)
+		{
+			renderSimplified(backend, asRenderPoints(xy), pointCount, 1, color, width);
+		}
+		else
+		{
+			backend.drawCurve(asRenderPoints(xy), pointCount, color, width);
+		}
+		break;
+	case ShapeKind::Curve:
+		if (coarse)
+		{
+			renderSimplified(backend, asRenderPoints(xy), pointCount, 3, color, width);
+		}
+		else
+		{
+			backend.drawBeziers(asRenderPoints(xy), pointCount, color, width);
+		}
+		break;
+	case ShapeKind::Measure:
+		renderStaff(backend, xy[0], xy[1], xy[2] - xy[0], xy[3] - xy[1], color, width);
+		break;
+	case ShapeKind::Symbol:
+	case ShapeKind::Text:
+	{
+		float size{ xy[2] - xy[0] };
+		if (coarse && kind == ShapeKind::Symbol)
+		{
+			// about a notehead: a staff space square in the middle of the symbol's box
+			float quarter{ size / 4.0f };
+			backend.drawRect(xy[0] + 1.5f * quarter, xy[1] + 1.5f * quarter, quarter, quarter, color, width, true);
+			break;
+		}
+
+		// sizes are whole pixels; a corner far out on the canvas can leave corner + size a hair short of one
+		RenderPoint offset{ scoreTextOffset(static_cast<int>(std::lround(size))) };
+		backend.drawText(text, xy[0] + offset.x, xy[1] + offset.y, kind == ShapeKind::Symbol ? std::wstring(L"Leland") : font, size, color);
+		break;
+	}
+	default:
+		break;
+	}
+}
+
+// A copy of one stored shape that ShapeStore::restore puts back exactly as it was, handle and z position
+// included. It holds a reference to its style, which whoever keeps it releases.
+struct ShapeSnapshot
+{
+	ShapeHandle handle{ kNoShape };
+	std::uint32_t index{ 0 }; // z position
+	std::uint64_t order{ 0 }; // the owner's to use, e.g. for the shape's place in a spatial index
+	ShapeKind kind{ ShapeKind::Line };
+	std::uint8_t flags{ 0 };
+	StyleId style{ kNoStyle };
+	Transform transform;
+	std::vector<float> points; // before the transform
+	std::wstring text;
+	std::wstring font;
+	ShapeHandle parent{ kNoShape }; // the group it was in
+	std::vector<ShapeHandle> children; // a group's, bottom first
+};
+
+// Shapes stored column by column: kind, flags, style, bounds and the range of their points each live in
+// their own packed array, in z order (bottom first). Drawing, hit testing and moving walk floats instead
+// of chasing a shared_ptr to a heap object per shape, and a shape costs no allocation beyond its points.
+//
+// A group is a row of its own that owns its children and keeps their union, so it is indexed, hit tested
+// and moved as one shape. Children's bounds are in their group's coordinates and only roots (shapes in no
+// group) have a z position that means anything outside their group; callers draw, index and save roots.
+class ShapeStore
+{
+public:
+	static constexpr std::size_t kMaxShapes{ std::size_t{ 1 } << 24 }; // a handle has room for this many slots
+
+	explicit ShapeStore(StyleTable& styles = shapeStyles()) : m_styleTable(&styles) {}
+
+	ShapeStore(const ShapeStore&) = delete;
+	ShapeStore& operator=(const ShapeStore&) = delete;
+
+	ShapeStore(ShapeStore&& other) noexcept : m_styleTable(other.m_styleTable) { swap(other); }
+
+	ShapeStore& operator=(ShapeStore&& other) noexcept
+	{
+		if (this != &other)
+		{
+			clear();
+			swap(other);
+		}
+		return *this;
+	}
+
+	~ShapeStore() { clear(); }
+
+	std::size_t size() const { return m_kinds.size(); }
+	bool empty() const { return m_kinds.empty(); }
+
+	// makes room for shapes more shapes with points more points between them, so adding a batch of known
+	// size, e.g. an import, grows every column once instead of step by step
+	void reserve(std::size_t shapes, std::size_t points)
+	{
+		std::size_t rows{ m_handles.size() + shapes };
+		m_handles.reserve(rows);
+		m_kinds.reserve(rows);
+		m_flags.reserve(rows);
+		m_styles.reserve(rows);
+		m_first.reserve(rows);
+		m_counts.reserve(rows);
+		m_transforms.reserve(rows);
+		m_parents.reserve(rows);
+		m_left.reserve(rows);
+		m_top.reserve(rows);
+		m_right.reserve(rows);
+		m_bottom.reserve(rows);
+		m_coords.reserve(m_coords.size() + 2 * points);
+
+		std::size_t slots{ m_slots.size() + (shapes > m_freeSlots.size() ? shapes - m_freeSlots.size() : 0) };
+		m_slots.reserve(slots);
+		m_generations.reserve(slots);
+		m_texts.reserve(slots);
+	}
+
+	bool contains(ShapeHandle shape) const { return indexOf(shape) != kNoIndex; }
+
+	// the shape at a z position, 0 being the bottom
+	ShapeHandle getHandle(std::size_t index) const { return m_handles[index]; }
+
+	// and the z position of a shape, which must be in the store
+	std::size_t getPosition(ShapeHandle shape) const { return indexOf(shape); }
+
+	// the root drawn directly above or below, or kNoShape at the top or bottom; shapes in groups are
+	// passed over, since they're drawn with their group
+	ShapeHandle getAbove(ShapeHandle shape) const
+	{
+		std::uint32_t i{ indexOf(shape) };
+		while (i != kNoIndex && ++i < m_handles.size())
+		{
+			if (m_parents[i] == kNoShape)
+			{
+				return m_handles[i];
+			}
+		}
+		return kNoShape;
+	}
+
+	ShapeHandle getBelow(ShapeHandle shape) const
+	{
+		std::uint32_t i{ indexOf(shape) };
+		while (i != kNoIndex && i-- > 0)
+		{
+			if (m_parents[i] == kNoShape)
+			{
+				return m_handles[i];
+			}
+		}
+		return kNoShape;
+	}
+
+	// adds a shape on top; xy holds pointCount x, y pairs laid out as described above
+	ShapeHandle add(ShapeKind kind, const float* xy, std::size_t pointCount, std::uint32_t color, int stroke, bool filled, const std::wstring& text = L"", const std::wstring& font = L"")
+	{
+		std::uint32_t slot;
+		if (!m_freeSlots.empty())
+		{
+			slot = m_freeSlots.back();
+			m_freeSlots.pop_back();
+		}
+		else
+		{
+			slot = static_cast<std::uint32_t>(m_slots.size());
+			m_slots.push_back(kNoIndex);
+			m_generations.push_back(0);
+			m_texts.emplace_back();
+		}
+
+		ShapeHandle handle{ (static_cast<std::uint32_t>(m_generations[slot]) << kSlotBits) | slot };
+		m_slots[slot] = static_cast<std::uint32_t>(m_kinds.size());
+		m_handles.push_back(handle);
+
+		m_kinds.push_back(kind);
+		m_flags.push_back(0);
+		m_styles.push_back(m_styleTable->intern(ShapeStyle{ color, stroke, filled }));
+		m_first.push_back(static_cast<std::uint32_t>(m_coords.size()));
+		m_counts.push_back(static_cast<std::uint32_t>(pointCount));
+		m_transforms.emplace_back();
+		m_parents.push_back(kNoShape);
+		m_coords.insert(m_coords.end(), xy, xy + 2 * pointCount);
+
+		if (kind == ShapeKind::Group)
+		{
+			m_groups[slot] = GroupNode();
+		}
+
+		if (kind == ShapeKind::Symbol || kind == ShapeKind::Text)
+		{
+			m_texts[slot].text = text;
+			m_texts[slot].font = internFont(font);
+		}
+
+		Bounds bounds{ getShapeBounds(kind, xy, pointCount, stroke, text.size()) };
+		m_left.push_back(bounds.left);
+		m_top.push_back(bounds.top);
+		m_right.push_back(bounds.right);
+		m_bottom.push_back(bounds.bottom);
+
+		return handle;
+	}
+
+	// a copy of the shape that restore can put back after it's removed; it holds a reference to the style
+	ShapeSnapshot snapshot(ShapeHandle shape) const
+	{
+		std::uint32_t i{ indexOf(shape) };
+		const float* xy{ getPointsAt(i) };
+		const ShapeText& text{ m_texts[slotOf(shape)] };
+
+		ShapeSnapshot copy;
+		copy.handle = shape;
+		copy.index = i;
+		copy.kind = m_kinds[i];
+		copy.flags = m_flags[i];
+		copy.style = m_styles[i];
+		copy.transform = m_transforms[i];
+		copy.points.assign(xy, xy + 2 * m_counts[i]);
+		copy.text = text.text;
+		copy.font = m_fontNames[text.font];
+		copy.parent = m_parents[i];
+		if (copy.kind == ShapeKind::Group)
+		{
+			copy.children = groupAt(i).children;
+		}
+
+		m_styleTable->retain(copy.style);
+		return copy;
+	}
+
+	// Puts a removed shape back under its old handle and at its old z position, as when an edit is undone.
+	// False if its slot has been given to another shape since.
+	bool restore(const ShapeSnapshot& copy) { return restore(&copy, 1) == 1; }
+
+	// Puts back many removed shapes, sorted bottom first, in one pass over the columns however many there
+	// are. Returns how many went back; any whose slot has been taken since are skipped. Groups and their
+	// children are linked back up, whichever of them came back.
+	std::size_t restore(const ShapeSnapshot* copies, std::size_t count)
+	{
+		claimSlots(copies, count);
+		if (m_restoring.empty())
+		{
+			return 0;
+		}
+
+		std::size_t oldSize{ m_handles.size() };
+		std::size_t newSize{ oldSize + m_restoring.size() };
+		resizeColumns(newSize);
+
+		// merge from the top down, so every shape moves at most once
+		std::size_t read{ oldSize };
+		std::size_t next{ m_restoring.size() };
+		for (std::size_t write{ newSize }; write-- > 0;)
+		{
+			if (next > 0 && (read == 0 || copies[m_restoring[next - 1]].index >= write))
+			{
+				placeAt(static_cast<std::uint32_t>(write), copies[m_restoring[--next]]);
+			}
+			else
+			{
+				moveColumns(static_cast<std::uint32_t>(--read), static_cast<std::uint32_t>(write));
+			}
+			m_slots[slotOf(m_handles[write])] = static_cast<std::uint32_t>(write);
+
+			// below here nothing moves
+			if (next == 0 && read == write)
+			{
+				break;
+			}
+		}
+
+		relink(copies);
+		return m_restoring.size();
+	}
+
+	// rebuilds a shape from a document record; kNoShape for a kind this build doesn't know
+	ShapeHandle add(const DocumentReader& reader, const ShapeRecord& record)
+	{
+		if (!getRecordPoints(reader, record, m_recordPoints))
+		{
+			return kNoShape;
+		}
+
+		std::wstring text;
+		std::wstring font;
+		if (record.kind == ShapeKind::Symbol || record.kind == ShapeKind::Text)
+		{
+			text = reader.getString(record.textOffset, record.textLength);
+			font = reader.getString(record.fontOffset, record.fontLength);
+		}
+
+		ShapeHandle shape{ add(record.kind, m_recordPoints.data(), m_recordPoints.size() / 2, record.color, record.stroke, record.isFilled(), text, font) };
+		setLocked(shape, record.isLocked());
+		if (!record.transform.isIdentity())
+		{
+			setTransform(shape, record.transform);
+		}
+
+		if (record.parent != 0)
+		{
+			// its group was loaded record.parent shapes ago
+			std::uint32_t i{ static_cast<std::uint32_t>(size() - 1) };
+			if (record.parent > i || m_kinds[i - record.parent] != ShapeKind::Group)
+			{
+				remove(shape);
+				return kNoShape;
+			}
+			attach(i, i - record.parent);
+		}
+		return shape;
+	}
+
+	// appends a shape to a document being saved; a group is followed by everything in it, depth first
+	void write(ShapeHandle shape, DocumentWriter& writer, DocumentLayer layer) const
+	{
+		std::uint32_t i{ indexOf(shape) };
+		if (i != kNoIndex)
+		{
+			writeAt(i, writer, layer, kNoIndex, Transform{});
+		}
+	}
+
+	void remove(ShapeHandle shape)
+	{
+		std::uint32_t i{ indexOf(shape) };
+		if (i == kNoIndex)
+		{
+			return;
+		}
+
+		// groups take everything in them along, and grouped shapes leave their group; the batch path does both
+		if (m_kinds[i] == ShapeKind::Group || m_parents[i] != kNoShape)
+		{
+			remove(std::vector<ShapeHandle>{ shape });
+			return;
+		}
+		eraseRow(i);
+	}
+
+	// Removes many shapes with one stable pass over the columns rather than an erase each, so deleting a
+	// big selection stays linear. A group goes with everything in it. The shapes left keep their z order;
+	// handles that aren't stored are ignored.
+	void remove(const std::vector<ShapeHandle>& shapes)
+	{
+		m_removing.assign(m_handles.size(), 0);
+		bool any{ false };
+		for (ShapeHandle shape : shapes)
+		{
+			std::uint32_t i{ indexOf(shape) };
+			if (i == kNoIndex || m_removing[i])
+			{
+				continue;
+			}
+
+			m_removing[i] = 1;
+			any = true;
+			if (m_kinds[i] == ShapeKind::Group)
+			{
+				m_descendants.clear();
+				getDescendants(shape, m_descendants);
+				for (ShapeHandle descendant : m_descendants)
+				{
+					m_removing[indexOf(descendant)] = 1;
+				}
+			}
+		}
+		if (!any)
+		{
+			return;
+		}
+
+		// groups that stay but lose some of their children
+		m_relinking.clear();
+		for (std::uint32_t i{ 0 }; i < m_handles.size(); ++i)
+		{
+			if (m_removing[i] && m_parents[i] != kNoShape && !m_removing[indexOf(m_parents[i])])
+			{
+				m_relinking.push_back(m_parents[i]);
+			}
+		}
+		std::sort(m_relinking.begin(), m_relinking.end());
+		m_relinking.erase(std::unique(m_relinking.begin(), m_relinking.end()), m_relinking.end());
+		for (ShapeHandle group : m_relinking)
+		{
+			std::vector<ShapeHandle>& children{ m_groups[slotOf(group)].children };
+			children.erase(std::remove_if(children.begin(), children.end(), [this](ShapeHandle child) { return m_removing[indexOf(child)] != 0; }), children.end());
+		}
+
+		for (std::uint32_t i{ 0 }; i < m_handles.size(); ++i)
+		{
+			if (m_removing[i])
+			{
+				m_deadCoords += 2 * static_cast<std::size_t>(m_counts[i]);
+				m_styleTable->release(m_styles[i]);
+				freeSlot(m_handles[i]);
+			}
+		}
+
+		std::uint32_t kept{ 0 };
+		for (std::uint32_t i{ 0 }; i < m_handles.size(); ++i)
+		{
+			if (!m_removing[i])
+			{
+				if (kept != i)
+				{
+					moveColumns(i, kept);
+				}
+				m_slots[slotOf(m_handles[kept])] = kept;
+				++kept;
+			}
+		}
+		resizeColumns(kept);
+
+		if (m_deadCoords > m_coords.size() / 2)
+		{
+			compactCoords();
+		}
+
+		for (ShapeHandle group : m_relinking)
+		{
+			childrenChanged(indexOf(group));
+		}
+	}
+
+	// the group the shape is in, or kNoShape for a root
+	ShapeHandle getParent(ShapeHandle shape) const { return m_parents[indexOf(shape)]; }
+
+	// the outermost group the shape is in, or the shape itself if it's a root
+	ShapeHandle getRoot(ShapeHandle shape) const
+	{
+		while (shape != kNoShape && m_parents[indexOf(shape)] != kNoShape)
+		{
+			shape = m_parents[indexOf(shape)];
+		}
+		return shape;
+	}
+
+	bool isGroup(ShapeHandle shape) const { return m_kinds[indexOf(shape)] == ShapeKind::Group; }
+
+	// a group's children, bottom first
+	const std::vector<ShapeHandle>& getChildren(ShapeHandle group) const { return groupAt(indexOf(group)).children; }
+
+	// the transforms of a group's children, bottom first, which ShapeStore::regroup takes back
+	std::vector<Transform> getChildTransforms(ShapeHandle group) const
+	{
+		std::vector<Transform> transforms;
+		for (ShapeHandle child : getChildren(group))
+		{
+			transforms.push_back(getTransform(child));
+		}
+		return transforms;
+	}
+
+	// calls visit with the shape, or with every shape inside it that isn't a group if it's a group
+	template<typename Visit>
+	void forEachLeaf(ShapeHandle shape, Visit&& visit) const
+	{
+		if (!isGroup(shape))
+		{
+			visit(shape);
+			return;
+		}
+		for (ShapeHandle child : getChildren(shape))
+		{
+			forEachLeaf(child, visit);
+		}
+	}
+
+	// appends everything in a group, nested groups and what's in them included, each group before its children
+	void getDescendants(ShapeHandle group, std::vector<ShapeHandle>& out) const
+	{
+		for (ShapeHandle child : getChildren(group))
+		{
+			out.push_back(child);
+			if (isGroup(child))
+			{
+				getDescendants(child, out);
+			}
+		}
+	}
+
+	// Puts roots into a new group, which goes where the topmost of them was in z order; the rest move down
+	// to sit together just under it, keeping their order. They keep their transforms, and the group's starts
+	// as the identity. Shapes that are already in a group are left out; kNoShape if that leaves none.
+	ShapeHandle group(std::vector<ShapeHandle> shapes)
+	{
+		shapes.erase(std::remove_if(shapes.begin(), shapes.end(), [this](ShapeHandle shape) {
+			std::uint32_t i{ indexOf(shape) };
+			return i == kNoIndex || m_parents[i] != kNoShape;
+		}), shapes.end());
+		std::sort(shapes.begin(), shapes.end(), [this](ShapeHandle a, ShapeHandle b) { return indexOf(a) < indexOf(b); });
+		shapes.erase(std::unique(shapes.begin(), shapes.end()), shapes.end());
+		if (shapes.empty())
+		{
+			return kNoShape;
+		}
+
+		// what's between them first, then them
+		std::uint32_t first{ indexOf(shapes.front()) };
+		std::uint32_t top{ indexOf(shapes.back()) };
+		m_removing.assign(m_handles.size(), 0);
+		for (ShapeHandle shape : shapes)
+		{
+			m_removing[indexOf(shape)] = 1;
+		}
+		m_restoring.clear();
+		for (int member{ 0 }; member < 2; ++member)
+		{
+			for (std::uint32_t i{ first }; i <= top; ++i)
+			{
+				if (m_removing[i] == member)
+				{
+					m_restoring.push_back(i);
+				}
+			}
+		}
+		gatherRows(first, m_restoring);
+
+		ShapeSnapshot node;
+		node.handle = nextHandle();
+		node.index = top + 1;
+		node.kind = ShapeKind::Group;
+		node.style = m_styleTable->intern(ShapeStyle{});
+		node.children = std::move(shapes);
+		restore(&node, 1);
+		m_styleTable->release(node.style);
+		return node.handle;
+	}
+
+	// Dissolves a group into the group it's in, or into the roots, composing its transform into each child's
+	// so nothing moves on screen. The children take its place among their new siblings and keep their z
+	// positions. Returns them, bottom first; nothing if the shape isn't a group.
+	std::vector<ShapeHandle> ungroup(ShapeHandle shape)
+	{
+		std::uint32_t i{ indexOf(shape) };
+		if (i == kNoIndex || m_kinds[i] != ShapeKind::Group)
+		{
+			return {};
+		}
+
+		std::vector<ShapeHandle> children{ std::move(groupAt(i).children) };
+		ShapeHandle parent{ m_parents[i] };
+		Transform transform{ m_transforms[i] };
+		for (ShapeHandle child : children)
+		{
+			std::uint32_t c{ indexOf(child) };
+			m_parents[c] = parent;
+			m_transforms[c] = m_transforms[c].then(transform);
+			measure(c);
+		}
+
+		if (parent != kNoShape)
+		{
+			std::vector<ShapeHandle>& siblings{ m_groups[slotOf(parent)].children };
+			auto at = siblings.erase(std::find(siblings.begin(), siblings.end(), shape));
+			siblings.insert(at, children.begin(), children.end());
+		}
+
+		eraseRow(i);
+		if (parent != kNoShape)
+		{
+			childrenChanged(indexOf(parent));
+		}
+		return children;
+	}
+
+	// Undoes ungroup: puts the group back from a snapshot taken before, around the same children, which get
+	// back the transforms they had inside it (one per child, in the snapshot's order).
+	bool regroup(const ShapeSnapshot& group, const Transform* childTransforms)
+	{
+		for (std::size_t k{ 0 }; k < group.children.size(); ++k)
+		{
+			std::uint32_t c{ indexOf(group.children[k]) };
+			if (c == kNoIndex || m_parents[c] != group.parent)
+			{
+				return false;
+			}
+		}
+		if (!restore(group))
+		{
+			return false;
+		}
+
+		for (std::size_t k{ 0 }; k < group.children.size(); ++k)
+		{
+			std::uint32_t c{ indexOf(group.children[k]) };
+			m_transforms[c] = childTransforms[k];
+			measure(c);
+		}
+		if (group.parent != kNoShape)
+		{
+			// it goes back where its first child is, and the children leave the siblings they joined
+			std::vector<ShapeHandle>& siblings{ m_groups[slotOf(group.parent)].children };
+			siblings.erase(std::remove(siblings.begin(), siblings.end(), group.handle), siblings.end());
+			auto at = std::find(siblings.begin(), siblings.end(), group.children.front());
+			at = siblings.insert(at, group.handle);
+			siblings.erase(std::remove_if(std::next(at), siblings.end(), [this, &group](ShapeHandle sibling) {
+				return m_parents[indexOf(sibling)] == group.handle;
+			}), siblings.end());
+		}
+		childrenChanged(indexOf(group.handle));
+		return true;
+	}
+
+	void clear()
+	{
+		for (ShapeHandle shape : m_handles)
+		{
+			freeSlot(shape);
+		}
+		for (StyleId style : m_styles)
+		{
+			m_styleTable->release(style);
+		}
+
+		m_handles.clear();
+		m_kinds.clear();
+		m_flags.clear();
+		m_styles.clear();
+		m_first.clear();
+		m_counts.clear();
+		m_transforms.clear();
+		m_parents.clear();
+		m_left.clear();
+		m_top.clear();
+		m_right.clear();
+		m_bottom.clear();
+		m_coords.clear();
+		m_deadCoords = 0;
+		m_groups.clear();
+	}
+
+	// exchanges two roots' places in z order
+	void swapOrder(ShapeHandle a, ShapeHandle b)
+	{
+		std::uint32_t i{ indexOf(a) };
+		std::uint32_t j{ indexOf(b) };
+		if (i == kNoIndex || j == kNoIndex)
+		{
+			return;
+		}
+
+		std::swap(m_handles[i], m_handles[j]);
+		std::swap(m_kinds[i], m_kinds[j]);
+		std::swap(m_flags[i], m_flags[j]);
+		std::swap(m_styles[i], m_styles[j]);
+		std::swap(m_first[i], m_first[j]);
+		std::swap(m_counts[i], m_counts[j]);
+		std::swap(m_transforms[i], m_transforms[j]);
+		std::swap(m_parents[i], m_parents[j]);
+		std::swap(m_left[i], m_left[j]);
+		std::swap(m_top[i], m_top[j]);
+		std::swap(m_right[i], m_right[j]);
+		std::swap(m_bottom[i], m_bottom[j]);
+		m_slots[a & kSlotMask] = j;
+		m_slots[b & kSlotMask] = i;
+	}
+
+	ShapeKind getKind(ShapeHandle shape) const { return m_kinds[indexOf(shape)]; }
+	StyleId getStyle(ShapeHandle shape) const { return m_styles[indexOf(shape)]; }
+	StyleTable& getStyleTable() const { return *m_styleTable; }
+	std::uint32_t getColor(ShapeHandle shape) const { return m_styleTable->get(m_styles[indexOf(shape)]).color; }
+	int getStroke(ShapeHandle shape) const { return m_styleTable->get(m_styles[indexOf(shape)]).stroke; }
+	bool isFilled(ShapeHandle shape) const { return m_styleTable->get(m_styles[indexOf(shape)]).filled; }
+	bool isLocked(ShapeHandle shape) const { return (m_flags[indexOf(shape)] & kLocked) != 0; }
+	// the shape's points before its transform, laid out as described above
+	const float* getPoints(ShapeHandle shape) const { return getPointsAt(indexOf(shape)); }
+	std::size_t getPointCount(ShapeHandle shape) const { return m_counts[indexOf(shape)]; }
+	// a symbol's glyph or a text's string; empty for other kinds
+	const std::wstring& getText(ShapeHandle shape) const { return m_texts[slotOf(shape)].text; }
+	// on the canvas for a root, in its group's coordinates otherwise
+	Bounds getBounds(ShapeHandle shape) const { return getBoundsAt(indexOf(shape)); }
+	Bounds getExtent(ShapeHandle shape) const { return getExtentAt(indexOf(shape)); }
+
+	void setColor(ShapeHandle shape, std::uint32_t color)
+	{
+		std::uint32_t i{ indexOf(shape) };
+		ShapeStyle style{ m_styleTable->get(m_styles[i]) };
+		style.color = color;
+		restyle(i, style);
+	}
+
+	// points the shape at an interned style, as when a restyle is undone; the store takes its own reference
+	void setStyle(ShapeHandle shape, StyleId style)
+	{
+		std::uint32_t i{ indexOf(shape) };
+		m_styleTable->retain(style);
+		m_styleTable->release(m_styles[i]);
+		m_styles[i] = style;
+		updateBounds(i);
+	}
+
+	// what setWidth last set: staff space for measures, size for symbols and text, stroke for the rest
+	int getWidth(ShapeHandle shape) const
+	{
+		std::uint32_t i{ indexOf(shape) };
+		const float* xy{ getPointsAt(i) };
+
+		switch (m_kinds[i])
+		{
+		case ShapeKind::Measure:
+			return static_cast<int>(std::lround((xy[3] - xy[1]) / 4.0f));
+		case ShapeKind::Symbol:
+		case ShapeKind::Text:
+			return static_cast<int>(std::lround(xy[2] - xy[0]));
+		default:
+			return m_styleTable->get(m_styles[i]).stroke;
+		}
+	}
+
+	// the stroke for drawn shapes; for score elements, the size (a staff's is four times this)
+	void setWidth(ShapeHandle shape, int width)
+	{
+		std::uint32_t i{ indexOf(shape) };
+		float* xy{ &m_coords[m_first[i]] };
+
+		switch (m_kinds[i])
+		{
+		case ShapeKind::Measure:
+			xy[3] = xy[1] + static_cast<float>(width * 4);
+			break;
+		case ShapeKind::Symbol:
+		case ShapeKind::Text:
+			xy[2] = xy[0] + static_cast<float>(width);
+			xy[3] = xy[1] + static_cast<float>(width);
+			break;
+		default:
+		{
+			ShapeStyle style{ m_styleTable->get(m_styles[i]) };
+			style.stroke = width;
+			restyle(i, style);
+			break;
+		}
+		}
+
+		updateBounds(i);
+	}
+
+	void setFilled(ShapeHandle shape, bool filled)
+	{
+		std::uint32_t i{ indexOf(shape) };
+		ShapeStyle style{ m_styleTable->get(m_styles[i]) };
+		style.filled = filled;
+		restyle(i, style);
+	}
+
+	void setLocked(ShapeHandle shape, bool locked) { setFlag(indexOf(shape), kLocked, locked); }
+
+	// moves the shape's transform, not its points; a group moves without touching what's in it
+	void translate(ShapeHandle shape, float dx, float dy)
+	{
+		std::uint32_t i{ indexOf(shape) };
+		m_transforms[i].tx += dx;
+		m_transforms[i].ty += dy;
+
+		// the shape keeps its size, so its bounds just shift
+		m_left[i] += dx;
+		m_right[i] += dx;
+		m_top[i] += dy;
+		m_bottom[i] += dy;
+
+		if (m_parents[i] != kNoShape)
+		{
+			invalidateDrawLists(i);
+			updateParents(i);
+		}
+	}
+
+	// what takes the shape's points onto the canvas, or into its group's coordinates
+	const Transform& getTransform(ShapeHandle shape) const { return m_transforms[indexOf(shape)]; }
+
+	void setTransform(ShapeHandle shape, const Transform& transform)
+	{
+		std::uint32_t i{ indexOf(shape) };
+		m_transforms[i] = transform;
+		invalidateDrawLists(i);
+		if (m_kinds[i] != ShapeKind::Group)
+		{
+			updateBounds(i);
+			return;
+		}
+
+		// what's inside hasn't changed, only where the group puts it
+		Bounds before{ getBoundsAt(i) };
+		setBoundsAt(i, transform.map(groupAt(i).content));
+		if (getBoundsAt(i) != before)
+		{
+			updateParents(i);
+		}
+	}
+
+	// follows the shape's transform with change, e.g. to scale or rotate it about a point
+	void applyTransform(ShapeHandle shape, const Transform& change) { setTransform(shape, getTransform(shape).then(change)); }
+
+	// whether (x, y) selects the shape
+	bool hitTest(ShapeHandle shape, float x, float y) const { return hitTestAt(indexOf(shape), x, y); }
+
+	// whether the shape lies entirely inside a rubber band selection
+	bool isInside(ShapeHandle shape, const Bounds& area) const
+	{
+		Bounds extent{ getExtent(shape) };
+		return extent.left > area.left && extent.top > area.top && extent.right < area.right && extent.bottom < area.bottom;
+	}
+
+	// draws a root; a group draws from its flattened list, so moving it never walks the shapes inside
+	void render(ShapeHandle shape, RenderBackend& backend) const
+	{
+		std::uint32_t i{ indexOf(shape) };
+		if (m_kinds[i] != ShapeKind::Group)
+		{
+			renderAt(i, m_transforms[i], backend);
+			return;
+		}
+
+		for (const DrawItem& item : getDrawList(i))
+		{
+			renderAt(indexOf(item.shape), item.transform.then(m_transforms[i]), backend);
+		}
+	}
+
+	// the union of every root's bounds, reduced straight over the packed columns
+	Bounds getContentBounds() const
+	{
+		Bounds content{ Bounds::empty() };
+		for (std::size_t i{ 0 }; i < m_handles.size(); ++i)
+		{
+			if (m_parents[i] == kNoShape)
+			{
+				content = content.united(getBoundsAt(static_cast<std::uint32_t>(i)));
+			}
+		}
+		return content;
+	}
+
+private:
+	static constexpr std::uint32_t kSlotBits{ 24 };
+	static constexpr std::uint32_t kSlotMask{ (1u << kSlotBits) - 1 };
+	static_assert(kMaxShapes == std::size_t{ kSlotMask } + 1, "kMaxShapes is every slot a handle can name");
+	static constexpr std::uint32_t kNoIndex{ 0xFFFFFFFF };
+	// a slot taken by a restore whose shape hasn't been placed yet
+	static constexpr std::uint32_t kClaimed{ 0xFFFFFFFE };
+
+	static constexpr std::uint8_t kLocked{ 1 };
+
+	struct ShapeText
+	{
+		std::wstring text;
+		std::uint32_t font{ 0 }; // into m_fontNames
+	};
+
+	// a shape a group draws, with the transform from its points into the group's coordinates
+	struct DrawItem
+	{
+		ShapeHandle shape;
+		Transform transform;
+	};
+
+	struct GroupNode
+	{
+		std::vector<ShapeHandle> children; // bottom first
+		Bounds content{ Bounds::empty() }; // the children's bounds, in the group's coordinates
+		Bounds extent{ Bounds::empty() }; // and their extents
+		// everything inside that draws, nested groups flattened; rebuilt only after a transform or child changes
+		mutable std::vector<DrawItem> drawList;
+		mutable bool drawListValid{ false };
+		// a big group's children by their bounds, so hit testing it doesn't try each; rebuilt after they change
+		mutable SpatialIndex<ShapeHandle> childIndex;
+		mutable bool childIndexValid{ false };
+	};
+
+	// groups with at least this many children hit test through a child index
+	static constexpr std::size_t kIndexedChildren{ 64 };
+
+	// one entry per shape, in z order
+	std::vector<ShapeHandle> m_handles;
+	std::vector<ShapeKind> m_kinds;
+	std::vector<std::uint8_t> m_flags;
+	std::vector<StyleId> m_styles; // each holds a reference in m_styleTable
+	std::vector<std::uint32_t> m_first; // first float in m_coords
+	std::vector<std::uint32_t> m_counts; // points
+	std::vector<Transform> m_transforms; // takes the points onto the canvas, or into the group
+	std::vector<ShapeHandle> m_parents; // the group each is in, or kNoShape
+	std::vector<float> m_left;
+	std::vector<float> m_top;
+	std::vector<float> m_right;
+	std::vector<float> m_bottom;
+
+	std::vector<float> m_coords; // every shape's points, x, y interleaved
+	std::size_t m_deadCoords{ 0 }; // floats in m_coords left behind by removed shapes
+
+	// one entry per slot; a handle is its slot plus the slot's generation in the top 8 bits
+	std::vector<std::uint32_t> m_slots; // index into the columns, or kNoIndex when free
+	std::vector<std::uint8_t> m_generations;
+	std::vector<std::uint32_t> m_freeSlots;
+	std::vector<ShapeText> m_texts; // only symbols and text use theirs
+	std::unordered_map<std::uint32_t, GroupNode> m_groups; // by slot, one per group
+
+	StyleTable* m_styleTable;
+	std::vector<std::wstring> m_fontNames{ L"" };
+	std::vector<float> m_recordPoints; // reused while loading
+	std::vector<std::uint8_t> m_removing; // reused by batch remove, one mark per z position
+	std::vector<std::uint32_t> m_restoring; // reused by batch restore and group
+	std::vector<ShapeHandle> m_relinking; // reused for the groups a batch remove or restore changes
+	std::vector<ShapeHandle> m_descendants; // reused by batch remove
+
+	static std::uint32_t slotOf(ShapeHandle shape) { return shape & kSlotMask; }
+
+	std::uint32_t indexOf(ShapeHandle shape) const
+	{
+		std::uint32_t slot{ slotOf(shape) };
+		if (shape == kNoShape || slot >= m_slots.size() || m_generations[slot] != (shape >> kSlotBits))
+		{
+			return kNoIndex;
+		}
+		return m_slots[slot];
+	}
+
+	// shape i's points relative to its translation
+	const float* getPointsAt(std::uint32_t i) const { return m_coords.data() + m_first[i]; }
+
+	// Shape i's points moved by a transform that only translates. The identity hands back the stored
+	// points; otherwise they're copied into a per-thread buffer that's good until the next call.
+	const float* getWorldPoints(std::uint32_t i, const Transform& transform) const
+	{
+		const float* xy{ getPointsAt(i) };
+		if (transform.isIdentity())
+		{
+			return xy;
+		}
+
+		thread_local std::vector<float> world;
+		world.assign(xy, xy + 2 * static_cast<std::size_t>(m_counts[i]));
+		for (std::size_t k{ 0 }; k < world.size(); k += 2)
+		{
+			world[k] += transform.tx;
+			world[k + 1] += transform.ty;
+		}
+		return world.data();
+	}
+
+	Bounds getBoundsAt(std::uint32_t i) const { return Bounds{ m_left[i], m_top[i], m_right[i], m_bottom[i] }; }
+
+	void setBoundsAt(std::uint32_t i, const Bounds& bounds)
+	{
+		m_left[i] = bounds.left;
+		m_top[i] = bounds.top;
+		m_right[i] = bounds.right;
+		m_bottom[i] = bounds.bottom;
+	}
+
+	Bounds getExtentAt(std::uint32_t i) const
+	{
+		if (m_kinds[i] == ShapeKind::Group)
+		{
+			return m_transforms[i].map(groupAt(i).extent);
+		}
+		return m_transforms[i].map(getShapeExtent(getPointsAt(i), m_counts[i]));
+	}
+
+	GroupNode& groupAt(std::uint32_t i) { return m_groups.find(slotOf(m_handles[i]))->second; }
+	const GroupNode& groupAt(std::uint32_t i) const { return m_groups.find(slotOf(m_handles[i]))->second; }
+
+	// Recomputes shape i's bounds from its points, or a group's from its children's, which must be up to
+	// date. True if they changed.
+	bool measure(std::uint32_t i)
+	{
+		Bounds before{ getBoundsAt(i) };
+		if (m_kinds[i] != ShapeKind::Group)
+		{
+			std::size_t textLength{ m_texts[slotOf(m_handles[i])].text.size() };
+			setBoundsAt(i, m_transforms[i].map(getShapeBounds(m_kinds[i], getPointsAt(i), m_counts[i], m_styleTable->get(m_styles[i]).stroke, textLength)));
+			return getBoundsAt(i) != before;
+		}
+
+		GroupNode& node{ groupAt(i) };
+		Bounds extent{ node.extent };
+		node.childIndexValid = false;
+		node.content = Bounds::empty();
+		node.extent = Bounds::empty();
+		for (ShapeHandle child : node.children)
+		{
+			std::uint32_t c{ indexOf(child) };
+			node.content = node.content.united(getBoundsAt(c));
+			node.extent = node.extent.united(getExtentAt(c));
+		}
+		setBoundsAt(i, m_transforms[i].map(node.content));
+		return getBoundsAt(i) != before || node.extent != extent;
+	}
+
+	// shape i's bounds changed; carries that up through the groups it's in, as far as it makes a difference
+	void updateParents(std::uint32_t i)
+	{
+		while (m_parents[i] != kNoShape)
+		{
+			i = indexOf(m_parents[i]);
+			if (!measure(i))
+			{
+				return;
+			}
+		}
+	}
+
+	void updateBounds(std::uint32_t i)
+	{
+		if (measure(i))
+		{
+			updateParents(i);
+		}
+	}
+
+	// shape i's transform changed, so the draw lists of the groups it's in are stale; its own isn't, being
+	// in its own coordinates
+	void invalidateDrawLists(std::uint32_t i)
+	{
+		for (ShapeHandle parent{ m_parents[i] }; parent != kNoShape; parent = m_parents[indexOf(parent)])
+		{
+			m_groups[slotOf(parent)].drawListValid = false;
+		}
+	}
+
+	// group g gained or lost children
+	void childrenChanged(std::uint32_t g)
+	{
+		groupAt(g).drawListValid = false;
+		invalidateDrawLists(g);
+		updateBounds(g);
+	}
+
+	// group i's flattened draw list, rebuilt first if anything inside has changed since
+	const std::vector<DrawItem>& getDrawList(std::uint32_t i) const
+	{
+		const GroupNode& node{ groupAt(i) };
+		if (!node.drawListValid)
+		{
+			node.drawList.clear();
+			for (ShapeHandle child : node.children)
+			{
+				std::uint32_t c{ indexOf(child) };
+				if (m_kinds[c] != ShapeKind::Group)
+				{
+					node.drawList.push_back(DrawItem{ child, m_transforms[c] });
+					continue;
+				}
+
+				// a nested group lends its own list
+				for (const DrawItem& item : getDrawList(c))
+				{
+					node.drawList.push_back(DrawItem{ item.shape, item.transform.then(m_transforms[c]) });
+				}
+			}
+			node.drawListValid = true;
+		}
+		return node.drawList;
+	}
+
+	// draws shape i, which isn't a group, through transform rather than its own
+	void renderAt(std::uint32_t i, const Transform& transform, RenderBackend& backend) const
+	{
+		const ShapeStyle& style{ m_styleTable->get(m_styles[i]) };
+		const ShapeText& text{ m_texts[slotOf(m_handles[i])] };
+		// moved shapes draw from their translated points, as they did before they had transforms
+		if (transform.isTranslation())
+		{
+			renderShape(backend, m_kinds[i], getWorldPoints(i, transform), m_counts[i], style.color, style.stroke, style.filled, text.text, m_fontNames[text.font], m_styles[i]);
+			return;
+		}
+
+		backend.setTransform(transform);
+		renderShape(backend, m_kinds[i], getPointsAt(i), m_counts[i], style.color, style.stroke, style.filled, text.text, m_fontNames[text.font], m_styles[i]);
+		backend.setTransform(Transform{});
+	}
+
+	bool hitTestAt(std::uint32_t i, float x, float y) const
+	{
+		// most shapes are rejected by the packed bounds before their points are touched
+		if (x < m_left[i] || x > m_right[i] || y < m_top[i] || y > m_bottom[i])
+		{
+			return false;
+		}
+
+		// test in the shape's own coordinates
+		const float* xy{ getPointsAt(i) };
+		const Transform& transform{ m_transforms[i] };
+		if (transform.isTranslation())
+		{
+			x -= transform.tx;
+			y -= transform.ty;
+		}
+		else
+		{
+			Transform inverse{ transform.inverted() };
+			float localX{ inverse.mapX(x, y) };
+			y = inverse.mapY(x, y);
+			x = localX;
+		}
+
+		switch (m_kinds[i])
+		{
+		case ShapeKind::Group:
+		{
+			// any shape inside, tested in the group's coordinates
+			const GroupNode& node{ groupAt(i) };
+			auto hits = [this, x, y](ShapeHandle child) { return hitTestAt(indexOf(child), x, y); };
+			if (node.children.size() < kIndexedChildren)
+			{
+				return std::any_of(node.children.rbegin(), node.children.rend(), hits);
+			}
+
+			if (!node.childIndexValid)
+			{
+				node.childIndex.clear();
+				for (ShapeHandle child : node.children)
+				{
+					node.childIndex.insert(child, getBoundsAt(indexOf(child)));
+				}
+				node.childIndexValid = true;
+			}
+			std::vector<ShapeHandle> candidates;
+			node.childIndex.query(x, y, candidates);
+			return std::any_of(candidates.rbegin(), candidates.rend(), hits);
+		}
+		case ShapeKind::Triangle:
+		{
+			// inside when the three triangles to (x, y) add up to no more than the whole, give or take 100
+			float whole{ triangleArea(xy[0], xy[1], xy[2], xy[3], xy[4], xy[5]) };
+			float parts{ triangleArea(x, y, xy[2], xy[3], xy[4], xy[5]) + triangleArea(xy[0], xy[1], x, y, xy[4], xy[5]) + triangleArea(xy[0], xy[1], xy[2], xy[3], x, y) };
+			return parts <= whole + 100.0f;
+		}
+		case ShapeKind::Measure:
+		case ShapeKind::Symbol:
+		case ShapeKind::Text:
+		{
+			// score elements are picked by their inside, not their edge
+			Bounds extent{ getShapeExtent(xy, m_counts[i]) };
+			return x > extent.left && x < extent.right && y > extent.top && y < extent.bottom;
+		}
+		default:
+			return getShapeExtent(xy, m_counts[i]).contains(x, y);
+		}
+	}
+
+	// adds shape i to the top of group g while a document loads; the groups above can only grow, so each
+	// takes the union with what it's gained rather than going back over all of its children
+	void attach(std::uint32_t i, std::uint32_t g)
+	{
+		m_parents[i] = m_handles[g];
+		groupAt(g).children.push_back(m_handles[i]);
+
+		for (std::uint32_t child{ i }; ; child = g, g = indexOf(m_parents[g]))
+		{
+			GroupNode& node{ groupAt(g) };
+			node.content = node.content.united(getBoundsAt(child));
+			node.extent = node.extent.united(getExtentAt(child));
+			node.drawListValid = false;
+			node.childIndexValid = false;
+			setBoundsAt(g, m_transforms[g].map(node.content));
+			if (m_parents[g] == kNoShape)
+			{
+				break;
+			}
+		}
+	}
+
+	// After a batch restore, links restored groups to their children and restored children to their groups,
+	// then brings every group that changed up to date, innermost first.
+	void relink(const ShapeSnapshot* copies)
+	{
+		m_relinking.clear();
+		for (std::uint32_t c : m_restoring)
+		{
+			const ShapeSnapshot& copy{ copies[c] };
+			std::uint32_t i{ indexOf(copy.handle) };
+			if (copy.kind == ShapeKind::Group)
+			{
+				GroupNode& node{ m_groups[slotOf(copy.handle)] };
+				node = GroupNode();
+				for (ShapeHandle child : copy.children)
+				{
+					std::uint32_t k{ indexOf(child) };
+					if (k != kNoIndex)
+					{
+						node.children.push_back(child);
+						m_parents[k] = copy.handle;
+					}
+				}
+				m_relinking.push_back(copy.handle);
+			}
+
+			if (copy.parent == kNoShape)
+			{
+				continue;
+			}
+			if (!contains(copy.parent))
+			{
+				m_parents[i] = kNoShape;
+				continue;
+			}
+			std::vector<ShapeHandle>& siblings{ m_groups[slotOf(copy.parent)].children };
+			if (std::find(siblings.begin(), siblings.end(), copy.handle) == siblings.end())
+			{
+				siblings.push_back(copy.handle);
+			}
+			m_relinking.push_back(copy.parent);
+		}
+		if (m_relinking.empty())
+		{
+			return;
+		}
+
+		std::sort(m_relinking.begin(), m_relinking.end());
+		m_relinking.erase(std::unique(m_relinking.begin(), m_relinking.end()), m_relinking.end());
+		std::sort(m_relinking.begin(), m_relinking.end(), [this](ShapeHandle a, ShapeHandle b) { return depthOf(a) > depthOf(b); });
+		for (ShapeHandle group : m_relinking)
+		{
+			childrenChanged(indexOf(group));
+		}
+	}
+
+	std::uint32_t depthOf(ShapeHandle shape) const
+	{
+		std::uint32_t depth{ 0 };
+		for (ShapeHandle parent{ m_parents[indexOf(shape)] }; parent != kNoShape; parent = m_parents[indexOf(parent)])
+		{
+			++depth;
+		}
+		return depth;
+	}
+
+	// the handle the next shape added or grouped gets
+	ShapeHandle nextHandle() const
+	{
+		std::uint32_t slot{ m_freeSlots.empty() ? static_cast<std::uint32_t>(m_slots.size()) : m_freeSlots.back() };
+		std::uint32_t generation{ slot < m_generations.size() ? m_generations[slot] : 0u };
+		return (generation << kSlotBits) | slot;
+	}
+
+	// Appends shape i, then what's in it if it's a group. group is the record index of the group it's in, or
+	// kNoIndex for a root, and toCanvas takes that group's coordinates onto the canvas.
+	void writeAt(std::uint32_t i, DocumentWriter& writer, DocumentLayer layer, std::uint32_t group, const Transform& toCanvas) const
+	{
+		// a shape that was only moved is saved where it ended up; one scaled or rotated keeps its transform
+		const Transform& transform{ m_transforms[i] };
+		const float* xy{ transform.isTranslation() ? getWorldPoints(i, transform) : getPointsAt(i) };
+		const ShapeStyle& style{ m_styleTable->get(m_styles[i]) };
+
+		ShapeRecord record;
+		record.kind = m_kinds[i];
+		record.layer = layer;
+		record.flags = (style.filled ? ShapeRecord::kFilled : 0) | ((m_flags[i] & kLocked) ? ShapeRecord::kLocked : 0);
+		record.color = style.color;
+		record.stroke = style.stroke;
+		record.bounds = toCanvas.map(getBoundsAt(i));
+		record.parent = group == kNoIndex ? 0 : static_cast<std::uint32_t>(writer.size()) - group;
+		// a group has no points to move, so it always keeps its transform
+		if (!transform.isTranslation() || record.kind == ShapeKind::Group)
+		{
+			record.transform = transform;
+		}
+
+		switch (record.kind)
+		{
+		case ShapeKind::Line:
+		case ShapeKind::Triangle:
+			std::copy(xy, xy + 2 * m_counts[i], record.values);
+			break;
+		case ShapeKind::Ellipse:
+		case ShapeKind::Rect:
+		case ShapeKind::Measure:
+			record.values[0] = xy[0];
+			record.values[1] = xy[1];
+			record.values[2] = xy[2] - xy[0];
+			record.values[3] = xy[3] - xy[1];
+			break;
+		case ShapeKind::Sketch:
+		case ShapeKind::Curve:
+			record.pointFirst = writer.getPointCount();
+			record.pointCount = m_counts[i];
+			for (std::uint32_t p{ 0 }; p < m_counts[i]; ++p)
+			{
+				writer.addPoint(xy[2 * p], xy[2 * p + 1]);
+			}
+			break;
+		case ShapeKind::Symbol:
+		case ShapeKind::Text:
+		{
+			const ShapeText& text{ m_texts[slotOf(m_handles[i])] };
+			record.values[0] = xy[0];
+			record.values[1] = xy[1];
+			record.values[2] = xy[2] - xy[0];
+			writer.addString(text.text, record.textOffset, record.textLength);
+			if (record.kind == ShapeKind::Text)
+			{
+				writer.addString(m_fontNames[text.font], record.fontOffset, record.fontLength);
+			}
+			break;
+		}
+		default:
+			break;
+		}
+
+		std::uint32_t groupRecord{ static_cast<std::uint32_t>(writer.size()) };
+		writer.add(record);
+
+		if (record.kind == ShapeKind::Group)
+		{
+			Transform childToCanvas{ transform.then(toCanvas) };
+			for (ShapeHandle child : groupAt(i).children)
+			{
+				writeAt(indexOf(child), writer, layer, groupRecord, childToCanvas);
+			}
+		}
+	}
+
+
+	// erases row i, whose links to any group the caller has already undone
+	void eraseRow(std::uint32_t i)
+	{
+		m_deadCoords += 2 * static_cast<std::size_t>(m_counts[i]);
+		m_styleTable->release(m_styles[i]);
+		freeSlot(m_handles[i]);
+
+		eraseAt(m_handles, i);
+		eraseAt(m_kinds, i);
+		eraseAt(m_flags, i);
+		eraseAt(m_styles, i);
+		eraseAt(m_first, i);
+		eraseAt(m_counts, i);
+		eraseAt(m_transforms, i);
+		eraseAt(m_parents, i);
+		eraseAt(m_left, i);
+		eraseAt(m_top, i);
+		eraseAt(m_right, i);
+		eraseAt(m_bottom, i);
+
+		// everything above moved down one place
+		for (std::size_t j{ i }; j < m_handles.size(); ++j)
+		{
+			m_slots[m_handles[j] & kSlotMask] = static_cast<std::uint32_t>(j);
+		}
+
+		if (m_deadCoords > m_coords.size() / 2)
+		{
+			compactCoords();
+		}
+	}
+
+
+	void setFlag(std::uint32_t i, std::uint8_t flag, bool on)
+	{
+		m_flags[i] = on ? (m_flags[i] | flag) : (m_flags[i] & ~flag);
+	}
+
+	void freeSlot(ShapeHandle shape)
+	{
+		std::uint32_t slot{ slotOf(shape) };
+		m_slots[slot] = kNoIndex;
+		++m_generations[slot];
+		m_texts[slot] = ShapeText{};
+		m_groups.erase(slot);
+		m_freeSlots.push_back(slot);
+	}
+
+	// Takes the slots of the copies being restored out of the free list, adding slots up to them if the store
+	// has never had that many, and fills m_restoring with the copies whose slots were still free. The claimed
+	// slots are marked and the free list swept once, so putting back a big delete doesn't search it per shape.
+	void claimSlots(const ShapeSnapshot* copies, std::size_t count)
+	{
+		m_restoring.clear();
+		for (std::size_t c{ 0 }; c < count; ++c)
+		{
+			std::uint32_t slot{ slotOf(copies[c].handle) };
+			while (m_slots.size() <= slot)
+			{
+				std::uint32_t added{ static_cast<std::uint32_t>(m_slots.size()) };
+				m_slots.push_back(kNoIndex);
+				m_generations.push_back(0);
+				m_texts.emplace_back();
+				m_freeSlots.push_back(added);
+			}
+
+			if (m_slots[slot] == kNoIndex)
+			{
+				m_slots[slot] = kClaimed;
+				m_restoring.push_back(static_cast<std::uint32_t>(c));
+			}
+		}
+
+		// a single undo restores the slot freed last, so it's nearly always at the back
+		if (m_restoring.size() == 1)
+		{
+			std::uint32_t slot{ slotOf(copies[m_restoring.front()].handle) };
+			auto found = std::find(m_freeSlots.rbegin(), m_freeSlots.rend(), slot);
+			m_freeSlots.erase(std::next(found).base());
+		}
+		else if (!m_restoring.empty())
+		{
+			std::erase_if(m_freeSlots, [this](std::uint32_t slot) { return m_slots[slot] == kClaimed; });
+		}
+	}
+
+	// copies shape from's columns over shape to's; its points stay where they are in m_coords
+	void moveColumns(std::uint32_t from, std::uint32_t to)
+	{
+		m_handles[to] = m_handles[from];
+		m_kinds[to] = m_kinds[from];
+		m_flags[to] = m_flags[from];
+		m_styles[to] = m_styles[from];
+		m_first[to] = m_first[from];
+		m_counts[to] = m_counts[from];
+		m_transforms[to] = m_transforms[from];
+		m_parents[to] = m_parents[from];
+		m_left[to] = m_left[from];
+		m_top[to] = m_top[from];
+		m_right[to] = m_right[from];
+		m_bottom[to] = m_bottom[from];
+	}
+
+	void resizeColumns(std::size_t size)
+	{
+		m_handles.resize(size);
+		m_kinds.resize(size);
+		m_flags.resize(size);
+		m_styles.resize(size);
+		m_first.resize(size);
+		m_counts.resize(size);
+		m_transforms.resize(size);
+		m_parents.resize(size);
+		m_left.resize(size);
+		m_top.resize(size);
+		m_right.resize(size);
+		m_bottom.resize(size);
+	}
+
+	// writes a snapshot into z position i, whose slot has already been claimed
+	void placeAt(std::uint32_t i, const ShapeSnapshot& copy)
+	{
+		std::uint32_t slot{ slotOf(copy.handle) };
+		m_generations[slot] = static_cast<std::uint8_t>(copy.handle >> kSlotBits);
+		m_texts[slot].text = copy.text;
+		m_texts[slot].font = internFont(copy.font);
+		m_styleTable->retain(copy.style);
+
+		std::size_t pointCount{ copy.points.size() / 2 };
+		Bounds bounds{ copy.transform.map(getShapeBounds(copy.kind, copy.points.data(), pointCount, m_styleTable->get(copy.style).stroke, copy.text.size())) };
+
+		m_handles[i] = copy.handle;
+		m_kinds[i] = copy.kind;
+		m_flags[i] = copy.flags;
+		m_styles[i] = copy.style;
+		m_first[i] = static_cast<std::uint32_t>(m_coords.size());
+		m_counts[i] = static_cast<std::uint32_t>(pointCount);
+		m_transforms[i] = copy.transform;
+		m_parents[i] = copy.parent;
+		m_left[i] = bounds.left;
+		m_top[i] = bounds.top;
+		m_right[i] = bounds.right;
+		m_bottom[i] = bounds.bottom;
+		m_coords.insert(m_coords.end(), copy.points.begin(), copy.points.end());
+	}
+
+	// points shape i at another style, taking the new reference before dropping the old in case they're the same
+	void restyle(std::uint32_t i, const ShapeStyle& style)
+	{
+		StyleId old{ m_styles[i] };
+		m_styles[i] = m_styleTable->intern(style);
+		m_styleTable->release(old);
+	}
+
+	void swap(ShapeStore& other) noexcept
+	{
+		std::swap(m_handles, other.m_handles);
+		std::swap(m_kinds, other.m_kinds);
+		std::swap(m_flags, other.m_flags);
+		std::swap(m_styles, other.m_styles);
+		std::swap(m_first, other.m_first);
+		std::swap(m_counts, other.m_counts);
+		std::swap(m_transforms, other.m_transforms);
+		std::swap(m_parents, other.m_parents);
+		std::swap(m_left, other.m_left);
+		std::swap(m_top, other.m_top);
+		std::swap(m_right, other.m_right);
+		std::swap(m_bottom, other.m_bottom);
+		std::swap(m_coords, other.m_coords);
+		std::swap(m_deadCoords, other.m_deadCoords);
+		std::swap(m_slots, other.m_slots);
+		std::swap(m_generations, other.m_generations);
+		std::swap(m_freeSlots, other.m_freeSlots);
+		std::swap(m_texts, other.m_texts);
+		std::swap(m_groups, other.m_groups);
+		std::swap(m_styleTable, other.m_styleTable);
+		std::swap(m_fontNames, other.m_fontNames);
+		std::swap(m_recordPoints, other.m_recordPoints);
+		std::swap(m_removing, other.m_removing);
+		std::swap(m_restoring, other.m_restoring);
+		std::swap(m_relinking, other.m_relinking);
+		std::swap(m_descendants, other.m_descendants);
+	}
+
+	std::uint32_t internFont(const std::wstring& font)
+	{
+		auto found = std::find(m_fontNames.begin(), m_fontNames.end(), font);
+		if (found != m_fontNames.end())
+		{
+			return static_cast<std::uint32_t>(found - m_fontNames.begin());
+		}
+
+		m_fontNames.push_back(font);
+		return static_cast<std::uint32_t>(m_fontNames.size() - 1);
+	}
+
+	// rewrites m_coords in z order without the points of removed shapes
+	void compactCoords()
+	{
+		std::vector<float> coords;
+		coords.reserve(m_coords.size() - m_deadCoords);
+		for (std::size_t i{ 0 }; i < m_first.size(); ++i)
+		{
+			std::uint32_t first{ static_cast<std::uint32_t>(coords.size()) };
+			coords.insert(coords.end(), m_coords.begin() + m_first[i], m_coords.begin() + m_first[i] + 2 * m_counts[i]);
+			m_first[i] = first;
+		}
+		m_coords = std::move(coords);
+		m_deadCoords = 0;
+	}
+
+	template<typename T>
+	static void eraseAt(std::vector<T>& column, std::uint32_t i)
+	{
+		column.erase(column.begin() + i);
+	}
+
+	// rewrites z positions first onward with the rows at rows, in that order
+	template<typename T>
+	static void gather(std::vector<T>& column, std::uint32_t first, const std::vector<std::uint32_t>& rows)
+	{
+		std::vector<T> gathered;
+		gathered.reserve(rows.size());
+		for (std::uint32_t row : rows)
+		{
+			gathered.push_back(column[row]);
+		}
+		std::copy(gathered.begin(), gathered.end(), column.begin() + first);
+	}
+
+	void gatherRows(std::uint32_t first, const std::vector<std::uint32_t>& rows)
+	{
+		gather(m_handles, first, rows);
+		gather(m_kinds, first, rows);
+		gather(m_flags, first, rows);
+		gather(m_styles, first, rows);
+		gather(m_first, first, rows);
+		gather(m_counts, first, rows);
+		gather(m_transforms, first, rows);
+		gather(m_parents, first, rows);
+		gather(m_left, first, rows);
+		gather(m_top, first, rows);
+		gather(m_right, first, rows);
+		gather(m_bottom, first, rows);
+		for (std::size_t i{ first }; i < first + rows.size(); ++i)
+		{
+			m_slots[slotOf(m_handles[i])] = static_cast<std::uint32_t>(i);
+		}
+	}
+
+	static float triangleArea(float ax, float ay, float bx, float by, float cx, float cy)
+	{
+		return std::abs((ax * (by - cy) + bx * (cy - ay) + cx * (ay - by)) / 2.0f);
+	}
+};
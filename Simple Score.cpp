@@ -3,17 +3,52 @@
 
 #include <windows.h>
 #include <CommCtrl.h>
+#include <commdlg.h>
 #include <gdiplus.h>
 #include <iostream>
+#include <atomic>
+#include <cstdio>
+#include <cstring>
 #include <filesystem>
+#include <fstream>
+#include <thread>
 #include <vector>
+#include "resource.h"
 #include "Simple Score.h"
+#include "FontCache.h"
+#include "GdiplusBackend.h"
+#include "DocumentExport.h"
+#include "FramePacer.h"
+#include "MusicXmlExport.h"
+#include "MusicXmlImport.h"
+#include "PdfBackend.h"
+#include "PointerRing.h"
+#include "RasterBackend.h"
+#include "SvgBackend.h"
+#include "TileCache.h"
+#include "TileRenderer.h"
+#include "Viewport.h"
 #pragma comment(lib, "Gdiplus.lib")
+#pragma comment(lib, "Comdlg32.lib")
 
 using namespace Gdiplus;
 
 #define MAX_LOADSTRING 100
 
+constexpr float kWheelStep{ 60.0f };            // window pixels one wheel notch pans
+constexpr RECT kStatsRect{ 8, 8, 368, 30 };     // where the frame-time overlay sits in the window
+constexpr UINT WM_TILESREADY{ WM_APP + 1 };     // posted by a tile worker when finished tiles are waiting
+constexpr UINT_PTR kFrameTimer{ 1 };            // fires when a frame held back for the next refresh is due
+
+// a tile's pixels, and the tile and zoom they were drawn for; a cached tile may be handed to another key
+struct TileSurface
+{
+    std::unique_ptr<Bitmap> bitmap;
+    int column{ 0 };
+    int row{ 0 };
+    float zoom{ 0.0f };
+};
+
 // Global Variables:
 HINSTANCE hInst;                                // current instance
 WCHAR szTitle[MAX_LOADSTRING];                  // The title bar text
@@ -29,6 +64,20 @@ SCORE score{};                                  // class for holding and drawing
 DRAW_SHAPES drawShapes{};                       // class for holding and drawing shapes
 HBITMAP hBitmap{ NULL };                        // bitmap for double buffering
 HDC memDC{ NULL };                              // memory device context for double buffering
+HFONT leland{ NULL };                           // Leland at listbox size, for the symbols dialog
+HBRUSH paletteBrush{ NULL };                    // the palette's color swatch
+TileCache<TileSurface> tiles{};                 // the static layer, drawn once per tile and composited each paint
+std::unique_ptr<TileRenderer> tileRenderer;     // draws stale tiles on worker threads
+Viewport view{};                                // pan and zoom of the canvas in the window
+bool isPanning{ false };                        // whether the middle button is dragging the view
+POINT panFrom{};                                // where the pan was last dragged from, in window pixels
+bool showFrameStats{ false };                   // whether the frame-time overlay is up, and the profiler with it
+FramePacer framePacer{};                        // holds input's repaints to one per display refresh
+bool canvasStale{ false };                      // whether the next frame repaints the whole canvas, after a pan or zoom
+SpscRing<PointerSample> pointerSamples{ 4096 }; // pen moves read by the capture thread, waiting for the UI thread
+std::thread pointerThread;                      // reads the pointer's move history while a sketch is drawn
+std::atomic<bool> capturingPointer{ false };    // tells the capture thread to keep reading
+std::atomic<bool> pointerHistoryFailed{ false }; // the history can't be read, e.g. over remote desktop; messages are used instead
 HWND gWindow{ NULL };                           // global window for main window
 HWND hSymbolsDialog{ NULL };                    // global window for modeless symbols dialog
 HWND hPaletteDialog{ NULL };                    // global window for modeless palette dialog
@@ -44,7 +93,7 @@ INT_PTR CALLBACK    Symbols(HWND, UINT, WPARAM, LPARAM);
 INT_PTR CALLBACK    TextDialog(HWND hDlg, UINT message, WPARAM wParam, LPARAM lParam);
 
 void                LoadFontsIntoComboBox(HWND hComboBox);
-void                updatePalette(Shape* shape);  // updates palette when selecting shapes
+void                updatePalette(ShapeHandle shape);  // updates palette when selecting shapes
 
 
 
@@ -62,7 +111,15 @@ void loadLelandFont()
     }
     else
     {
-        score.setFont();
+        leland = CreateFont(
+            288, 0, 0, 0, FW_NORMAL, FALSE, FALSE, FALSE,
+            DEFAULT_CHARSET, OUT_OUTLINE_PRECIS, CLIP_DEFAULT_PRECIS,
+            DEFAULT_QUALITY, VARIABLE_PITCH, L"Leland");
+
+        if (!score.loadGlyphs(fontPath))
+        {
+            MessageBox(nullptr, L"Failed to read the glyph table from Leland.otf.", L"Error", MB_OK | MB_ICONERROR);
+        }
     }
 }
 
@@ -114,9 +171,14 @@ int APIENTRY wWinMain(_In_ HINSTANCE hInstance,
         }
     }
 
+    DeleteObject(leland);
+    DeleteObject(paletteBrush);
     unloadLelandFont();
     drawShapes.deleteShapes();
     score.deleteScore();
+    tiles.clear();
+    fontCache().clear();
+    gdiplusStyles().clear();
     GdiplusShutdown(gdiplusToken);
 
     return (int) msg.wParam;
@@ -230,6 +292,639 @@ static void hideTextDlg(HWND& hWnd)
     }
 }
 
+// asks for a .ssd path; returns false if the user cancelled
+static bool chooseDocument(HWND hWnd, bool save, std::filesystem::path& path)
+{
+    WCHAR file[MAX_PATH]{};
+
+    OPENFILENAME ofn{};
+    ofn.lStructSize = sizeof(ofn);
+    ofn.hwndOwner = hWnd;
+    ofn.lpstrFilter = L"Simple Score Documents (*.ssd)\0*.ssd\0All Files (*.*)\0*.*\0";
+    ofn.lpstrFile = file;
+    ofn.nMaxFile = MAX_PATH;
+    ofn.lpstrDefExt = L"ssd";
+
+    if (save)
+    {
+        ofn.Flags = OFN_OVERWRITEPROMPT | OFN_PATHMUSTEXIST;
+        if (!GetSaveFileName(&ofn))
+        {
+            return false;
+        }
+    }
+    else
+    {
+        ofn.Flags = OFN_FILEMUSTEXIST | OFN_PATHMUSTEXIST;
+        if (!GetOpenFileName(&ofn))
+        {
+            return false;
+        }
+    }
+
+    path = file;
+    return true;
+}
+
+static void saveDocument(HWND hWnd)
+{
+    std::filesystem::path path;
+    if (!chooseDocument(hWnd, true, path))
+    {
+        return;
+    }
+
+    DocumentWriter writer;
+    drawShapes.writeShapes(writer);
+    score.writeElements(writer);
+
+    if (!writer.save(path))
+    {
+        MessageBox(hWnd, L"Failed to save the document.", L"Error", MB_OK | MB_ICONERROR);
+    }
+}
+
+static void openDocument(HWND hWnd)
+{
+    std::filesystem::path path;
+    if (!chooseDocument(hWnd, false, path))
+    {
+        return;
+    }
+
+    DocumentReader reader;
+    if (!reader.open(path))
+    {
+        MessageBox(hWnd, L"The file is not a Simple Score document, or was saved by a newer version.", L"Error", MB_OK | MB_ICONERROR);
+        return;
+    }
+
+    // build everything first, so a damaged file leaves the current document untouched
+    ShapeStore shapes;
+    ShapeStore elements;
+    for (std::size_t i{ 0 }; i < reader.size(); ++i)
+    {
+        ShapeRecord record;
+        if (!reader.getRecord(i, record) || (record.layer == DocumentLayer::Score ? elements : shapes).add(reader, record) == kNoShape)
+        {
+            MessageBox(hWnd, L"The document is damaged and could not be opened.", L"Error", MB_OK | MB_ICONERROR);
+            return;
+        }
+    }
+
+    drawShapes.setShapes(std::move(shapes));
+    score.setElements(std::move(elements));
+
+    // a new document starts with a whole history
+    SetWindowText(hWnd, szTitle);
+}
+
+// replaces the score with a partwise MusicXML file, laid out as measures, symbols and text; the drawing stays
+static void importMusicXml(HWND hWnd)
+{
+    WCHAR file[MAX_PATH]{};
+
+    OPENFILENAME ofn{};
+    ofn.lStructSize = sizeof(ofn);
+    ofn.hwndOwner = hWnd;
+    ofn.lpstrFilter = L"MusicXML Files (*.musicxml;*.xml)\0*.musicxml;*.xml\0All Files (*.*)\0*.*\0";
+    ofn.lpstrFile = file;
+    ofn.nMaxFile = MAX_PATH;
+    ofn.Flags = OFN_FILEMUSTEXIST | OFN_PATHMUSTEXIST;
+    if (!GetOpenFileName(&ofn))
+    {
+        return;
+    }
+
+    // like opening a document, a file that fails part way leaves the current score untouched
+    ShapeStore elements;
+    MusicXmlImporter importer;
+    if (!importer.import(std::filesystem::path{ file }, elements))
+    {
+        std::string error{ importer.getError() };
+        std::wstring message{ L"The file could not be imported as MusicXML:\n" + std::wstring(error.begin(), error.end()) };
+        MessageBox(hWnd, message.c_str(), L"Error", MB_OK | MB_ICONERROR);
+        return;
+    }
+
+    score.setElements(std::move(elements));
+}
+
+// writes the drawing and the score as PDF, SVG or PNG pages, whichever the user picks
+static void exportPages(HWND hWnd)
+{
+    WCHAR file[MAX_PATH]{};
+
+    OPENFILENAME ofn{};
+    ofn.lStructSize = sizeof(ofn);
+    ofn.hwndOwner = hWnd;
+    ofn.lpstrFilter = L"PDF Documents (*.pdf)\0*.pdf\0SVG Images (*.svg)\0*.svg\0PNG Images (*.png)\0*.png\0";
+    ofn.lpstrFile = file;
+    ofn.nMaxFile = MAX_PATH;
+    ofn.lpstrDefExt = L"pdf";
+    ofn.Flags = OFN_OVERWRITEPROMPT | OFN_PATHMUSTEXIST;
+    if (!GetSaveFileName(&ofn))
+    {
+        return;
+    }
+
+    std::filesystem::path path{ file };
+    bool svg{ ofn.nFilterIndex == 2 || path.extension() == L".svg" };
+    bool png{ !svg && (ofn.nFilterIndex == 3 || path.extension() == L".png") };
+
+    // without the font file Leland text still exports, just as plain text
+    GlyphOutlines leland;
+    leland.open(std::filesystem::current_path() / L"Leland.otf");
+
+    SvgBackend svgBackend(&leland);
+    PdfBackend pdfBackend(&leland);
+    RasterBackend pngBackend(&leland);
+    PageBackend& backend{ svg ? static_cast<PageBackend&>(svgBackend) : png ? static_cast<PageBackend&>(pngBackend) : pdfBackend };
+    bool written{ svg ? svgBackend.open(path) : png ? pngBackend.open(path) : pdfBackend.open(path) };
+
+    if (written)
+    {
+        // only the pages something reaches; each draws through the spatial index, so just what's on it
+        std::vector<std::uint64_t> pages;
+        addPages(drawShapes.getShapes(), kExportPageWidth, kExportPageHeight, pages);
+        addPages(score.getElements(), kExportPageWidth, kExportPageHeight, pages);
+        forEachPage(pages, kExportPageWidth, kExportPageHeight, [&](const Bounds& page) {
+            written = backend.beginPage(page.left, page.top, kExportPageWidth, kExportPageHeight) && written;
+            drawShapes.drawStoredShapes(backend, page);
+            score.drawStoredElements(backend, page);
+            written = backend.endPage() && written;
+        });
+        written = backend.finish() && written;
+    }
+
+    if (!written)
+    {
+        MessageBox(hWnd, L"Failed to export the document.", L"Error", MB_OK | MB_ICONERROR);
+    }
+}
+
+// writes the score as partwise MusicXML, read back from its measures, symbols and text; the drawing isn't part of it
+static void exportMusicXml(HWND hWnd)
+{
+    WCHAR file[MAX_PATH]{};
+
+    OPENFILENAME ofn{};
+    ofn.lStructSize = sizeof(ofn);
+    ofn.hwndOwner = hWnd;
+    ofn.lpstrFilter = L"MusicXML Files (*.musicxml)\0*.musicxml\0";
+    ofn.lpstrFile = file;
+    ofn.nMaxFile = MAX_PATH;
+    ofn.lpstrDefExt = L"musicxml";
+    ofn.Flags = OFN_OVERWRITEPROMPT | OFN_PATHMUSTEXIST;
+    if (!GetSaveFileName(&ofn))
+    {
+        return;
+    }
+
+    MusicXmlExporter exporter;
+    if (!exporter.write(score.getElements(), score.getIndex(), std::filesystem::path{ file }))
+    {
+        std::string error{ exporter.getError() };
+        std::wstring message{ L"The score could not be exported as MusicXML:\n" + std::wstring(error.begin(), error.end()) };
+        MessageBox(hWnd, message.c_str(), L"Error", MB_OK | MB_ICONERROR);
+    }
+}
+
+// the canvas point under a mouse message's window coordinates
+static RenderPoint toCanvas(LPARAM lParam)
+{
+    // the coordinates are signed; they go negative while the mouse is captured outside the window
+    float x{ static_cast<float>(static_cast<short>(LOWORD(lParam))) };
+    float y{ static_cast<float>(static_cast<short>(HIWORD(lParam))) };
+    return RenderPoint{ view.toCanvasX(x), view.toCanvasY(y) };
+}
+
+// the dashed rectangle around the selection, or the band being dragged out
+static void drawSelectRect(Graphics& graphics, const Bounds& rect)
+{
+    if (rect.isEmpty())
+    {
+        return;
+    }
+
+    Pen selectPen(Color(255, 0, 0, 100), 2.0f);
+    selectPen.SetDashStyle(DashStyleDash);
+    graphics.DrawRectangle(&selectPen, rect.left, rect.top, rect.width(), rect.height());
+}
+
+// a solid brush in the palette's current color, remade only when the color changes
+static HBRUSH getPaletteBrush()
+{
+    COLORREF color{ RGB(drawShapes.getR(), drawShapes.getG(), drawShapes.getB()) };
+
+    LOGBRUSH lb{};
+    if (paletteBrush == NULL || GetObject(paletteBrush, sizeof(LOGBRUSH), &lb) == 0 || lb.lbColor != color)
+    {
+        DeleteObject(paletteBrush);
+        paletteBrush = CreateSolidBrush(color);
+    }
+
+    return paletteBrush;
+}
+
+// marks the tiles under changes to the static layer for redrawing; changes to the live selection leave them be
+static void invalidateTiles()
+{
+    DirtyRegion stale;
+    drawShapes.takeStale(stale);
+    score.takeStale(stale);
+
+    for (const auto& bounds : stale.getRects())
+    {
+        // tiles are laid out over the zoomed canvas; a pixel more covers antialiasing at fractional zooms
+        tiles.invalidate(view.toZoomed(view.toWindow(bounds)).inflated(1.0f));
+    }
+}
+
+// copies the tiles under a window area into graphics and hands the stale ones to the workers, recording
+// the static layer under them once for all of them; a stale tile shows its old pixels until the new ones
+// land, or paper if they were drawn at another zoom. Returns how many primitives were recorded.
+static std::uint32_t compositeTiles(Graphics& graphics, const Bounds& window)
+{
+    ProfileScope timer("compositeTiles");
+
+    struct StaleTile
+    {
+        int column;
+        int row;
+        std::uint64_t revision;
+    };
+    std::vector<StaleTile> stale;
+    Bounds area{ Bounds::empty() };
+
+    int size{ tiles.getTileSize() };
+    float zoom{ view.getZoom() };
+    SolidBrush paper(Color(255, 255, 255));
+
+    graphics.SetCompositingMode(CompositingModeSourceCopy);
+    tiles.forEachTile(view.toZoomed(window), [&](TileCache<TileSurface>::Tile& tile) {
+        if (!tile.valid && !tileRenderer->isPending(tile.column, tile.row, tile.revision))
+        {
+            stale.push_back(StaleTile{ tile.column, tile.row, tile.revision });
+            area = area.united(TileRenderer::getCanvasBounds(tile.column, tile.row, size, zoom));
+        }
+
+        int x{ tile.column * size - static_cast<int>(view.getOffsetX()) };
+        int y{ tile.row * size - static_cast<int>(view.getOffsetY()) };
+        const TileSurface& surface{ tile.surface };
+        if (surface.bitmap && surface.column == tile.column && surface.row == tile.row && surface.zoom == zoom)
+        {
+            graphics.DrawImage(surface.bitmap.get(), x, y, 0, 0, size, size, UnitPixel);
+        }
+        else
+        {
+            graphics.FillRectangle(&paper, x, y, size, size);
+        }
+    });
+    graphics.SetCompositingMode(CompositingModeSourceOver);
+
+    if (stale.empty())
+    {
+        return 0;
+    }
+
+    // the workers share the recording and only read it; the next change records a new one
+    auto scene{ std::make_shared<DisplayList>(zoom) };
+    {
+        ProfileScope timer("drawStaticShapes");
+        drawShapes.drawStaticShapes(*scene, area);
+    }
+    {
+        ProfileScope timer("drawStaticElements");
+        score.drawStaticElements(*scene, area);
+    }
+
+    for (const StaleTile& tile : stale)
+    {
+        tileRenderer->request(tile.column, tile.row, tile.revision, size, zoom, scene);
+    }
+    return static_cast<std::uint32_t>(scene->size());
+}
+
+// copies the tiles the workers have finished into the cache and repaints where they go. A tile that was
+// invalidated again, or handed to another key, since it was asked for is dropped; the repaint asks again.
+static void takeFinishedTiles(HWND hWnd)
+{
+    ProfileScope timer("takeFinishedTiles");
+
+    std::vector<RenderedTile> finished;
+    tileRenderer->takeFinished(finished);
+
+    for (const RenderedTile& rendered : finished)
+    {
+        int size{ rendered.size };
+        int x{ rendered.column * size - static_cast<int>(view.getOffsetX()) };
+        int y{ rendered.row * size - static_cast<int>(view.getOffsetY()) };
+        RECT rect{ x, y, x + size, y + size };
+        InvalidateRect(hWnd, &rect, FALSE);
+
+        auto* tile{ tiles.find(rendered.column, rendered.row) };
+        if (!tile || tile->revision != rendered.revision)
+        {
+            continue;
+        }
+
+        TileSurface& surface{ tile->surface };
+        if (!surface.bitmap)
+        {
+            surface.bitmap = std::make_unique<Bitmap>(size, size, PixelFormat32bppPARGB);
+        }
+
+        Rect bounds(0, 0, size, size);
+        BitmapData data;
+        if (surface.bitmap->LockBits(&bounds, ImageLockModeWrite, PixelFormat32bppPARGB, &data) != Ok)
+        {
+            continue;
+        }
+        for (int row{ 0 }; row < size; ++row)
+        {
+            std::memcpy(static_cast<BYTE*>(data.Scan0) + static_cast<std::ptrdiff_t>(row) * data.Stride, &rendered.pixels[static_cast<std::size_t>(row) * size], static_cast<std::size_t>(size) * 4);
+        }
+        surface.bitmap->UnlockBits(&data);
+
+        // the workers only have Leland's outlines, so text in other fonts goes on here, each one between the
+        // layer under it and the layer the worker drew over it
+        if (!rendered.overlays.empty())
+        {
+            Graphics graphics(surface.bitmap.get());
+            graphics.SetSmoothingMode(SmoothingModeAntiAlias);
+            graphics.SetTextRenderingHint(TextRenderingHintAntiAliasGridFit);
+            GdiplusBackend backend(graphics);
+            backend.setScale(rendered.zoom);
+            Bounds area{ TileRenderer::getCanvasBounds(rendered.column, rendered.row, size, rendered.zoom) };
+
+            for (const TileOverlay& overlay : rendered.overlays)
+            {
+                graphics.TranslateTransform(-static_cast<float>(rendered.column * size), -static_cast<float>(rendered.row * size));
+                graphics.ScaleTransform(rendered.zoom, rendered.zoom);
+                rendered.scene->replay(backend, area, overlay.text, overlay.text + 1);
+                graphics.ResetTransform();
+
+                if (!overlay.pixels.empty())
+                {
+                    Bitmap layer(size, size, size * 4, PixelFormat32bppPARGB, reinterpret_cast<BYTE*>(const_cast<std::uint32_t*>(overlay.pixels.data())));
+                    graphics.DrawImage(&layer, 0, 0, size, size);
+                }
+            }
+        }
+
+        surface.column = rendered.column;
+        surface.row = rendered.row;
+        surface.zoom = rendered.zoom;
+        tile->valid = true;
+    }
+}
+
+// p50 and p99 frame times over the last few seconds of paints, and what the last paint drew
+static void drawFrameStats(Graphics& graphics)
+{
+    FrameStats stats{ profiler().getFrameStats() };
+
+    WCHAR text[128];
+    swprintf(text, 128, L"frame p50 %.2f ms  p99 %.2f ms  %u draws  (%zu frames)", stats.p50, stats.p99, stats.drawCalls, stats.frames);
+
+    graphics.ResetTransform();
+    SolidBrush paper(Color(224, 255, 255, 255));
+    SolidBrush ink(Color(255, 0, 0, 0));
+    graphics.FillRectangle(&paper, static_cast<INT>(kStatsRect.left), static_cast<INT>(kStatsRect.top), static_cast<INT>(kStatsRect.right - kStatsRect.left), static_cast<INT>(kStatsRect.bottom - kStatsRect.top));
+    std::shared_ptr<Font> font{ fontCache().get(L"Consolas", 12) };
+    graphics.DrawString(text, -1, font.get(), PointF(static_cast<REAL>(kStatsRect.left + 4), static_cast<REAL>(kStatsRect.top + 3)), &ink);
+}
+
+// writes what the profiler has recorded as a Chrome trace, for chrome://tracing or Perfetto
+static void exportTrace(HWND hWnd)
+{
+    WCHAR file[MAX_PATH]{};
+
+    OPENFILENAME ofn{};
+    ofn.lStructSize = sizeof(ofn);
+    ofn.hwndOwner = hWnd;
+    ofn.lpstrFilter = L"Chrome Traces (*.json)\0*.json\0";
+    ofn.lpstrFile = file;
+    ofn.nMaxFile = MAX_PATH;
+    ofn.lpstrDefExt = L"json";
+    ofn.Flags = OFN_OVERWRITEPROMPT | OFN_PATHMUSTEXIST;
+    if (!GetSaveFileName(&ofn))
+    {
+        return;
+    }
+
+    std::ofstream out(std::filesystem::path(file), std::ios::binary);
+    profiler().writeChromeTrace(out);
+    if (!out)
+    {
+        MessageBox(hWnd, L"Failed to write the trace.", L"Error", MB_OK | MB_ICONERROR);
+    }
+}
+
+// says in the title bar once an edit has pushed older ones out of the undo history, e.g. a very big delete
+static void noteForgottenEdits(HWND hWnd)
+{
+    if (drawShapes.takeForgottenEdits() + score.takeForgottenEdits() > 0)
+    {
+        std::wstring title{ szTitle };
+        title += L" - older edits can no longer be undone";
+        SetWindowText(hWnd, title.c_str());
+    }
+}
+
+// invalidates only the areas drawShapes and score recorded as changed since the last call
+static void invalidateDirty(HWND hWnd)
+{
+    invalidateTiles();
+    noteForgottenEdits(hWnd);
+
+    DirtyRegion dirty;
+    drawShapes.takeDirty(dirty);
+    score.takeDirty(dirty);
+
+    for (const auto& damage : dirty.getRects())
+    {
+        Bounds bounds{ view.toWindow(damage) };
+        RECT rect{ static_cast<LONG>(std::floor(bounds.left)), static_cast<LONG>(std::floor(bounds.top)),
+                   static_cast<LONG>(std::ceil(bounds.right)) + 1, static_cast<LONG>(std::ceil(bounds.bottom)) + 1 };
+        InvalidateRect(hWnd, &rect, FALSE);
+    }
+
+    // the overlay shows the frames before this one, so it's refreshed with every paint
+    if (showFrameStats)
+    {
+        InvalidateRect(hWnd, &kStatsRect, FALSE);
+    }
+}
+
+// invalidates the whole canvas, e.g. when the mode changes what overlays are shown
+static void invalidateCanvas(HWND hWnd)
+{
+    invalidateTiles();
+
+    // the recorded damage is covered by the full repaint, but the overlay positions still need syncing
+    DirtyRegion dirty;
+    drawShapes.takeDirty(dirty);
+    score.takeDirty(dirty);
+
+    InvalidateRect(hWnd, NULL, FALSE);
+}
+
+// Reads the system's history of pointer moves about every millisecond while a sketch is drawn, so the
+// stroke gets the moves the message queue coalesces away, and keeps them coming while the UI thread paints.
+// The history holds the last 64 moves; reads that come too late to join up are counted as gaps.
+static void capturePointer(std::uint32_t since)
+{
+    PointerHistory history;
+    history.reset(since);
+
+    MOUSEMOVEPOINT points[64];
+    PointerSample read[64];
+    std::vector<PointerSample> fresh;
+    int failures{ 0 };
+
+    while (capturingPointer.load(std::memory_order_acquire))
+    {
+        POINT cursor;
+        int count{ -1 };
+        if (GetCursorPos(&cursor))
+        {
+            // the history is looked up from the move to the cursor's position, in 16-bit display coordinates
+            MOUSEMOVEPOINT latest{};
+            latest.x = cursor.x & 0xFFFF;
+            latest.y = cursor.y & 0xFFFF;
+            count = GetMouseMovePointsEx(sizeof(MOUSEMOVEPOINT), &latest, points, 64, GMMP_USE_DISPLAY_POINTS);
+        }
+
+        if (count < 0)
+        {
+            // the cursor can be a move ahead of the history; only a run of failures means there is none
+            if (++failures == 50)
+            {
+                pointerHistoryFailed.store(true, std::memory_order_release);
+            }
+        }
+        else
+        {
+            failures = 0;
+            for (int i{ 0 }; i < count; ++i)
+            {
+                // monitors left of or above the primary one come back as large positive numbers
+                read[i] = PointerSample{ points[i].x > 32767 ? points[i].x - 65536 : points[i].x, points[i].y > 32767 ? points[i].y - 65536 : points[i].y,
+                    static_cast<std::uint32_t>(points[i].time) };
+            }
+
+            fresh.clear();
+            history.takeNew(read, static_cast<std::size_t>(count), fresh);
+
+            // a full ring means the UI thread has stalled for seconds; the stroke loses those moves
+            pointerSamples.push(fresh.data(), fresh.size());
+        }
+
+        Sleep(1);
+    }
+}
+
+// moves the pen moves the capture thread has read into the sketch, from the screen onto the canvas
+static void drainPointer(HWND hWnd)
+{
+    POINT origin{ 0, 0 };
+    ClientToScreen(hWnd, &origin);
+
+    PointerSample batch[256];
+    RenderPoint points[256];
+    std::size_t count;
+    while ((count = pointerSamples.pop(batch, 256)) > 0)
+    {
+        for (std::size_t i{ 0 }; i < count; ++i)
+        {
+            points[i] = RenderPoint{ view.toCanvasX(static_cast<float>(batch[i].x - origin.x)), view.toCanvasY(static_cast<float>(batch[i].y - origin.y)) };
+        }
+        drawShapes.addSketchPoints(points, count);
+    }
+}
+
+static void stopPointerCapture()
+{
+    capturingPointer.store(false, std::memory_order_release);
+    if (pointerThread.joinable())
+    {
+        pointerThread.join();
+    }
+}
+
+// starts reading the moves after the message time since, the pen going down
+static void startPointerCapture(DWORD since)
+{
+    stopPointerCapture();
+
+    // whatever the last stroke left behind isn't part of this one
+    PointerSample stale[256];
+    while (pointerSamples.pop(stale, 256) > 0)
+    {
+    }
+
+    pointerHistoryFailed.store(false, std::memory_order_relaxed);
+    capturingPointer.store(true, std::memory_order_release);
+    pointerThread = std::thread(capturePointer, static_cast<std::uint32_t>(since));
+}
+
+// the pen's path comes from the capture thread if it can read the history, or else from the messages
+static bool usesPointerHistory()
+{
+    return pointerThread.joinable() && !pointerHistoryFailed.load(std::memory_order_acquire);
+}
+
+// invalidates what changed since the last frame, all of it if the view moved
+static void presentFrame(HWND hWnd)
+{
+    if (canvasStale)
+    {
+        canvasStale = false;
+        invalidateCanvas(hWnd);
+    }
+    else
+    {
+        invalidateDirty(hWnd);
+    }
+}
+
+// shows what input has changed at the next frame: now, if a refresh has passed since the last one, or
+// else when the frame timer fires, along with whatever else changes before then. The model is already
+// up to date either way; only the repaint waits.
+static void requestFrame(HWND hWnd, bool wholeCanvas = false)
+{
+    canvasStale = canvasStale || wholeCanvas;
+
+    std::int64_t wait{ framePacer.request(FramePacer::now()) };
+    if (wait == FramePacer::kPresentNow)
+    {
+        presentFrame(hWnd);
+    }
+    else if (wait != FramePacer::kAlreadyScheduled)
+    {
+        SetTimer(hWnd, kFrameTimer, static_cast<UINT>((wait + 999999) / 1000000), nullptr);
+    }
+}
+
+// zooms by factor about a window point; the tiles were drawn at the old zoom, so they all go
+static void zoomView(HWND hWnd, float factor, float x, float y)
+{
+    if (view.zoomAbout(factor, x, y))
+    {
+        tiles.invalidateAll();
+        requestFrame(hWnd, true);
+    }
+}
+
+// panning keeps the tiles, which are laid out over the canvas rather than the window
+static void panView(HWND hWnd, float dx, float dy)
+{
+    view.pan(dx, dy);
+    requestFrame(hWnd, true);
+}
+
 
 //
 //  FUNCTION: WndProc(HWND, UINT, WPARAM, LPARAM)
@@ -332,6 +1027,56 @@ LRESULT CALLBACK WndProc(HWND hWnd, UINT message, WPARAM wParam, LPARAM lParam)
             drawShapes.setShape(DRAW_SHAPES::SELECT);
             score.setElement(SCORE::NONE);
             break;
+        case ID_FILE_OPEN:
+            openDocument(hWnd);
+            break;
+        case ID_FILE_IMPORT:
+            importMusicXml(hWnd);
+            break;
+        case ID_FILE_SAVE:
+            saveDocument(hWnd);
+            break;
+        case ID_FILE_EXPORT:
+            exportPages(hWnd);
+            break;
+        case ID_FILE_EXPORTMUSICXML:
+            exportMusicXml(hWnd);
+            break;
+        case ID_VIEW_FRAMESTATS:
+            // the timers only run while their numbers are on screen
+            showFrameStats = !showFrameStats;
+            profiler().setEnabled(showFrameStats);
+            CheckMenuItem(GetMenu(hWnd), ID_VIEW_FRAMESTATS, MF_BYCOMMAND | (showFrameStats ? MF_CHECKED : MF_UNCHECKED));
+            break;
+        case ID_VIEW_EXPORTTRACE:
+            exportTrace(hWnd);
+            break;
+        case ID_EDIT_UNDO:
+        case ID_EDIT_REDO:
+            // undo whichever layer is being edited
+            if (score.getElement() != SCORE::NONE)
+            {
+                wmId == ID_EDIT_UNDO ? score.undo() : score.redo();
+            }
+            else
+            {
+                wmId == ID_EDIT_UNDO ? drawShapes.undo() : drawShapes.redo();
+            }
+            invalidateDirty(hWnd);
+            return 0;
+        case ID_EDIT_GROUP:
+        case ID_EDIT_UNGROUP:
+            // likewise for grouping the selection
+            if (score.getElement() != SCORE::NONE)
+            {
+                wmId == ID_EDIT_GROUP ? score.groupSelected() : score.ungroupSelected();
+            }
+            else
+            {
+                wmId == ID_EDIT_GROUP ? drawShapes.groupSelected() : drawShapes.ungroupSelected();
+            }
+            invalidateDirty(hWnd);
+            return 0;
         case IDM_EXIT:
             DestroyWindow(hWnd);
             break;
@@ -339,22 +1084,21 @@ LRESULT CALLBACK WndProc(HWND hWnd, UINT message, WPARAM wParam, LPARAM lParam)
             return DefWindowProc(hWnd, message, wParam, lParam);
         }
 
-        InvalidateRect(hWnd, NULL, TRUE);
+        invalidateCanvas(hWnd);
 
         break;
     }
     case WM_LBUTTONDOWN:
     {
         // get mouse position
-        int x{ LOWORD(lParam) };
-        int y{ HIWORD(lParam) };
+        RenderPoint point{ toCanvas(lParam) };
 
         if (drawShapes.getShape() != DRAW_SHAPES::NONE)
         {
             if (drawShapes.getShape() == DRAW_SHAPES::SELECT)
             {
                 // check if a shape is selected, or start drawing select rect
-                drawShapes.selectShape(x, y);
+                drawShapes.selectShape(point.x, point.y);
                 if (!drawShapes.isSelecting())
                 {
                     updatePalette(drawShapes.getSelected());
@@ -367,96 +1111,161 @@ LRESULT CALLBACK WndProc(HWND hWnd, UINT message, WPARAM wParam, LPARAM lParam)
             }
 
             // save current mouse coordinates as origin (corner, vertex, center, etc.) of shape 
-            drawShapes.setOrigin(PointF(static_cast<REAL>(x), static_cast<REAL>(y)));
+            drawShapes.setOrigin(point);
 
             // save mouse position also as "current" to abstract width and height
-            drawShapes.setCurrent(PointF(static_cast<REAL>(x), static_cast<REAL>(y)));
+            drawShapes.setCurrent(point);
+
+            if (drawShapes.isDrawing() && drawShapes.getShape() == DRAW_SHAPES::SKETCH)
+            {
+                // a sketch starts where the pen goes down; the rest of it is read from the pointer's history
+                drawShapes.addSketchPoint();
+                startPointerCapture(GetMessageTime());
+            }
         }
         else if (score.getElement() != SCORE::NONE)
         {
             if (score.getElement() == SCORE::SELECT)
             {
-                score.selectElement(x, y);
+                score.selectElement(point.x, point.y);
             }
             else
             {
                 score.setDrawing(true);
             }
 
-            score.setOrigin(PointF(static_cast<REAL>(x), static_cast<REAL>(y)));
-            score.setCurrent(PointF(static_cast<REAL>(x), static_cast<REAL>(y)));
+            score.setOrigin(point);
+            score.setCurrent(point);
         }
 
-        InvalidateRect(hWnd, NULL, TRUE);
+        invalidateDirty(hWnd);
+
+        break;
+    }
+    case WM_MBUTTONDOWN:
+        // the middle button drags the view around
+        isPanning = true;
+        panFrom = POINT{ static_cast<short>(LOWORD(lParam)), static_cast<short>(HIWORD(lParam)) };
+        SetCapture(hWnd);
+
+        break;
+
+    case WM_MBUTTONUP:
+        if (isPanning)
+        {
+            isPanning = false;
+            ReleaseCapture();
+        }
 
         break;
+
+    case WM_MOUSEWHEEL:
+    case WM_MOUSEHWHEEL:
+    {
+        float notches{ static_cast<float>(GET_WHEEL_DELTA_WPARAM(wParam)) / WHEEL_DELTA };
+        WORD keys{ LOWORD(wParam) };
+
+        if (message == WM_MOUSEWHEEL && (keys & MK_CONTROL))
+        {
+            // zoom about the cursor, whose position comes in screen coordinates
+            POINT cursor{ static_cast<short>(LOWORD(lParam)), static_cast<short>(HIWORD(lParam)) };
+            ScreenToClient(hWnd, &cursor);
+            zoomView(hWnd, std::pow(1.25f, notches), static_cast<float>(cursor.x), static_cast<float>(cursor.y));
+        }
+        else if (message == WM_MOUSEHWHEEL)
+        {
+            panView(hWnd, -notches * kWheelStep, 0.0f);
+        }
+        else if (keys & MK_SHIFT)
+        {
+            panView(hWnd, notches * kWheelStep, 0.0f);
+        }
+        else
+        {
+            panView(hWnd, 0.0f, notches * kWheelStep);
+        }
+
+        return 0;
     }
     case WM_MOUSEMOVE:
-        if (drawShapes.isDrawing())
+        if (isPanning)
+        {
+            POINT to{ static_cast<short>(LOWORD(lParam)), static_cast<short>(HIWORD(lParam)) };
+            panView(hWnd, static_cast<float>(to.x - panFrom.x), static_cast<float>(to.y - panFrom.y));
+            panFrom = to;
+        }
+        else if (drawShapes.isDrawing())
         {
             // get mouse position
-            int x{ LOWORD(lParam) };
-            int y{ HIWORD(lParam) };
+            RenderPoint point{ toCanvas(lParam) };
 
             // save mouse position as "current" to abstract width and height
-            drawShapes.setCurrent(PointF(static_cast<REAL>(x), static_cast<REAL>(y)));
+            drawShapes.setCurrent(point);
+
+            if (drawShapes.getShape() == DRAW_SHAPES::SKETCH)
+            {
+                // fit the stroke as it's drawn rather than once the pen lifts
+                if (usesPointerHistory())
+                {
+                    drainPointer(hWnd);
+                }
+                else
+                {
+                    drawShapes.addSketchPoint();
+                }
+            }
 
-            InvalidateRect(hWnd, NULL, TRUE);
+            requestFrame(hWnd);
         }
         else if (drawShapes.isMoving())
         {
             // get mouse position
-            int x{ LOWORD(lParam) };
-            int y{ HIWORD(lParam) };
+            RenderPoint point{ toCanvas(lParam) };
 
             // compare mouse position with shape position
-            drawShapes.moveShape(x, y);
+            drawShapes.moveShape(point.x, point.y);
 
-            InvalidateRect(hWnd, NULL, TRUE);
+            requestFrame(hWnd);
         }
         else if (drawShapes.isSelecting())
         {
             // get mouse position
-            int x{ LOWORD(lParam) };
-            int y{ HIWORD(lParam) };
+            RenderPoint point{ toCanvas(lParam) };
 
             // save mouse position as "current" to abstract width and height of select rect
-            drawShapes.setCurrent(PointF(static_cast<REAL>(x), static_cast<REAL>(y)));
+            drawShapes.setCurrent(point);
 
-            InvalidateRect(hWnd, NULL, TRUE);
+            requestFrame(hWnd);
         }
         else if (score.isDrawing())
         {
             // get mouse position
-            int x{ LOWORD(lParam) };
-            int y{ HIWORD(lParam) };
+            RenderPoint point{ toCanvas(lParam) };
 
             // save mouse position as "current" to abstract width and height of select rect
-            score.setCurrent(PointF(static_cast<REAL>(x), static_cast<REAL>(y)));
+            score.setCurrent(point);
 
-            InvalidateRect(hWnd, NULL, TRUE);
+            requestFrame(hWnd);
         }
         else if (score.isMoving())
         {
             // get mouse position
-            int x{ LOWORD(lParam) };
-            int y{ HIWORD(lParam) };
+            RenderPoint point{ toCanvas(lParam) };
 
             // compare mouse position with element position
-            score.moveElement(x, y);
+            score.moveElement(point.x, point.y);
 
-            InvalidateRect(hWnd, NULL, TRUE);
+            requestFrame(hWnd);
         }
         else if (score.isSelecting())
         {
             // get mouse position
-            int x{ LOWORD(lParam) };
-            int y{ HIWORD(lParam) };
+            RenderPoint point{ toCanvas(lParam) };
 
             // save mouse position as "current" to abstract width and height of select rect
-            score.setCurrent(PointF(static_cast<REAL>(x), static_cast<REAL>(y)));
+            score.setCurrent(point);
 
-            InvalidateRect(hWnd, NULL, TRUE);
+            requestFrame(hWnd);
         }
 
         break;
@@ -468,55 +1277,62 @@ LRESULT CALLBACK WndProc(HWND hWnd, UINT message, WPARAM wParam, LPARAM lParam)
         else if (drawShapes.isSelecting())
         {
             // get mouse position
-            int x{ LOWORD(lParam) };
-            int y{ HIWORD(lParam) };
+            RenderPoint point{ toCanvas(lParam) };
 
             // save mouse position as "current" to abstract width and height
-            drawShapes.setCurrent(PointF(static_cast<REAL>(x), static_cast<REAL>(y)));
+            drawShapes.setCurrent(point);
 
             drawShapes.selectShapes();
 
             drawShapes.stopSelecting();
 
-            InvalidateRect(hWnd, NULL, TRUE);
+            invalidateDirty(hWnd);
         }
         else if (drawShapes.isDrawing())
         {
             // get mouse position
-            int x{ LOWORD(lParam) };
-            int y{ HIWORD(lParam) };
+            RenderPoint point{ toCanvas(lParam) };
 
             // save mouse position as "current" to abstract width and height
-            drawShapes.setCurrent(PointF(static_cast<REAL>(x), static_cast<REAL>(y)));
+            drawShapes.setCurrent(point);
 
             // store currently drawn shape
             switch (drawShapes.getShape())
             {
             case DRAW_SHAPES::LINE:
-                drawShapes.addShape(std::make_shared<LineShape>(PointF(drawShapes.getOX(), drawShapes.getOY()), PointF(drawShapes.getCX(), drawShapes.getCY()), drawShapes.getColor(), drawShapes.getWidth()));
+                drawShapes.addLine(RenderPoint{ drawShapes.getOX(), drawShapes.getOY() }, RenderPoint{ drawShapes.getCX(), drawShapes.getCY() }, drawShapes.getColor(), drawShapes.getWidth());
                 drawShapes.setSelect();
                 break;
             case DRAW_SHAPES::RECT:
-                drawShapes.addShape(std::make_shared<RectShape>(PointF(drawShapes.getOX(), drawShapes.getOY()), drawShapes.getCX() - drawShapes.getOX(), drawShapes.getCY() - drawShapes.getOY(), drawShapes.getColor(), drawShapes.getWidth(), drawShapes.getFillMode()));
+                drawShapes.addRect(RenderPoint{ drawShapes.getOX(), drawShapes.getOY() }, drawShapes.getCX() - drawShapes.getOX(), drawShapes.getCY() - drawShapes.getOY(), drawShapes.getColor(), drawShapes.getWidth(), drawShapes.getFillMode());
                 drawShapes.setSelect();
                 break;
             case DRAW_SHAPES::ELLIPSE:
-                drawShapes.addShape(std::make_shared<EllipseShape>(PointF(drawShapes.getOX(), drawShapes.getOY()), drawShapes.getCX() - drawShapes.getOX(), drawShapes.getCY() - drawShapes.getOY(), drawShapes.getColor(), drawShapes.getWidth(), drawShapes.getFillMode()));
+                drawShapes.addEllipse(RenderPoint{ drawShapes.getOX(), drawShapes.getOY() }, drawShapes.getCX() - drawShapes.getOX(), drawShapes.getCY() - drawShapes.getOY(), drawShapes.getColor(), drawShapes.getWidth(), drawShapes.getFillMode());
                 drawShapes.setSelect();
                 break;
             case DRAW_SHAPES::TRIANGLE:
-                drawShapes.addShape(std::make_shared<TriShape>(PointF(drawShapes.getCX(), drawShapes.getCY()), PointF(drawShapes.getOX(), drawShapes.getOY()), PointF(drawShapes.getCX(), drawShapes.getOY()), drawShapes.getColor(), drawShapes.getWidth(), drawShapes.getFillMode()));
+                drawShapes.addTriangle(RenderPoint{ drawShapes.getCX(), drawShapes.getCY() }, RenderPoint{ drawShapes.getOX(), drawShapes.getOY() }, RenderPoint{ drawShapes.getCX(), drawShapes.getOY() }, drawShapes.getColor(), drawShapes.getWidth(), drawShapes.getFillMode());
                 drawShapes.setSelect();
                 break;
             case DRAW_SHAPES::SKETCH:
+            {
+                // the capture thread stops first, so the moves up to the release are all in the ring
+                bool fromHistory{ usesPointerHistory() };
+                stopPointerCapture();
+                if (fromHistory)
+                {
+                    drainPointer(hWnd);
+                }
                 drawShapes.addSketch();
                 drawShapes.setSelect();
                 break;
             }
+            }
 
             drawShapes.setDrawing(false);
 
-            InvalidateRect(hWnd, NULL, TRUE);
+            invalidateDirty(hWnd);
         }
         else if (score.isMoving())
         {
@@ -525,37 +1341,35 @@ LRESULT CALLBACK WndProc(HWND hWnd, UINT message, WPARAM wParam, LPARAM lParam)
         else if (score.isSelecting())
         {
             // get mouse position
-            int x{ LOWORD(lParam) };
-            int y{ HIWORD(lParam) };
+            RenderPoint point{ toCanvas(lParam) };
 
             // save mouse position as "current" to abstract width and height
-            score.setCurrent(PointF(static_cast<REAL>(x), static_cast<REAL>(y)));
+            score.setCurrent(point);
 
             score.selectElements();
 
             score.stopSelecting();
 
-            InvalidateRect(hWnd, NULL, TRUE);
+            invalidateDirty(hWnd);
 
         }
         else if (score.isDrawing())
         {
             // get mouse position
-            int x{ LOWORD(lParam) };
-            int y{ HIWORD(lParam) };
+            RenderPoint point{ toCanvas(lParam) };
 
             // save mouse position as "current" to abstract width and height
-            score.setCurrent(PointF(static_cast<REAL>(x), static_cast<REAL>(y)));
+            score.setCurrent(point);
 
             // store currently drawn shape
             switch (score.getElement())
             {
             case SCORE::MEASURE:
-                score.addElement(std::make_shared<Measure>(score.getOrigin(), score.getCurrent().X - score.getOrigin().X));
+                score.addMeasure(score.getOrigin(), score.getCurrent().x - score.getOrigin().x);
                 score.setSelect();
                 break;
             case SCORE::SYMBOL:
-                score.addElement(std::make_shared<Symbol>(score.getOrigin(), score.getCurrent().Y - score.getOrigin().Y, score.getSymbol()));
+                score.addSymbol(score.getOrigin(), score.getCurrent().y - score.getOrigin().y, score.getSymbol());
                 score.setSelect();
                 break;
             default:
@@ -564,14 +1378,21 @@ LRESULT CALLBACK WndProc(HWND hWnd, UINT message, WPARAM wParam, LPARAM lParam)
 
             score.setDrawing(false);
 
-            InvalidateRect(hWnd, NULL, TRUE);
+            invalidateDirty(hWnd);
         }
 
         break;
 
     case WM_KEYDOWN:
+        // bit 30 is set when the key was already down; a fresh press is a new edit, and only its auto-repeat
+        // joins the nudges, scales or turns before it
         if (drawShapes.getShape() == DRAW_SHAPES::SELECT)
         {
+            if ((lParam & (1 << 30)) == 0)
+            {
+                drawShapes.endEdit();
+            }
+
             switch (wParam)
             {
             case VK_LEFT:
@@ -586,12 +1407,29 @@ LRESULT CALLBACK WndProc(HWND hWnd, UINT message, WPARAM wParam, LPARAM lParam)
             case VK_DOWN:
                 drawShapes.moveShapes(DRAW_SHAPES::DOWN);
                 break;
+            case VK_OEM_PLUS:
+            case VK_ADD:
+                drawShapes.scaleShapes(1.1f);
+                break;
+            case VK_OEM_MINUS:
+            case VK_SUBTRACT:
+                drawShapes.scaleShapes(1.0f / 1.1f);
+                break;
+            case 'R':
+                // shift turns the other way
+                drawShapes.rotateShapes(GetKeyState(VK_SHIFT) < 0 ? -15.0f : 15.0f);
+                break;
             }
 
-            InvalidateRect(gWindow, NULL, TRUE);
+            requestFrame(hWnd);
         }
         else if (score.getElement() == SCORE::SELECT)
         {
+            if ((lParam & (1 << 30)) == 0)
+            {
+                score.endEdit();
+            }
+
             switch (wParam)
             {
             case VK_LEFT:
@@ -608,7 +1446,7 @@ LRESULT CALLBACK WndProc(HWND hWnd, UINT message, WPARAM wParam, LPARAM lParam)
                 break;
             }
 
-            InvalidateRect(gWindow, NULL, TRUE);
+            requestFrame(hWnd);
         }
 
         break;
@@ -633,6 +1471,13 @@ LRESULT CALLBACK WndProc(HWND hWnd, UINT message, WPARAM wParam, LPARAM lParam)
         scaleX = dpiX / 96.0f;
         scaleY = dpiY / 96.0f;
 
+        // frames are paced to the display; 0 and 1 mean the driver doesn't say
+        int refreshRate{ GetDeviceCaps(hdc, VREFRESH) };
+        if (refreshRate > 1)
+        {
+            framePacer.setRefreshRate(refreshRate);
+        }
+
         ReleaseDC(hWnd, hdc);
 
         // create compatible bitmap with client size
@@ -640,8 +1485,24 @@ LRESULT CALLBACK WndProc(HWND hWnd, UINT message, WPARAM wParam, LPARAM lParam)
         hBitmap = CreateCompatibleBitmap(GetDC(hWnd), clientWidth * scaleX, clientHeight * scaleY);
         SelectObject(memDC, hBitmap);
 
+        // posting is all a worker does with the window
+        tileRenderer = std::make_unique<TileRenderer>(std::filesystem::current_path() / L"Leland.otf", [hWnd] { PostMessage(hWnd, WM_TILESREADY, 0, 0); });
+
         break;
     }
+    case WM_TILESREADY:
+        takeFinishedTiles(hWnd);
+        break;
+
+    case WM_TIMER:
+        if (wParam == kFrameTimer)
+        {
+            KillTimer(hWnd, kFrameTimer);
+            framePacer.fire(FramePacer::now());
+            presentFrame(hWnd);
+        }
+        break;
+
     case WM_SIZE:
         // get new client area size
         GetClientRect(hWnd, &clientRect);
@@ -660,40 +1521,86 @@ LRESULT CALLBACK WndProc(HWND hWnd, UINT message, WPARAM wParam, LPARAM lParam)
             PAINTSTRUCT ps;
             HDC hdc = BeginPaint(hWnd, &ps);
 
+            // checked once, so turning the profiler on mid-paint can't time half a frame
+            bool profiling{ profiler().isEnabled() };
+            std::uint64_t frameStart{ profiling ? profiler().now() : 0 };
+            std::uint32_t drawCalls{ 0 };
+
+            // memDC keeps the last frame, so only the invalidated rect is redrawn, and only what's on the canvas under it
+            RECT& paint{ ps.rcPaint };
+            Bounds window{ static_cast<float>(paint.left), static_cast<float>(paint.top), static_cast<float>(paint.right), static_cast<float>(paint.bottom) };
+            Bounds area{ view.toCanvas(window) };
+
             // draw onto the memory DC with GDI+
             Graphics graphics(memDC);
             graphics.SetSmoothingMode(SmoothingModeAntiAlias);
             graphics.SetInterpolationMode(InterpolationModeHighQualityBicubic);
             graphics.SetTextRenderingHint(TextRenderingHintAntiAliasGridFit);
-            graphics.Clear(Color(255, 255, 255));
+            graphics.SetClip(Rect(paint.left, paint.top, paint.right - paint.left, paint.bottom - paint.top));
+
+            // the static layer comes from the tile cache; tiles something changed under are redrawn off this thread
+            invalidateTiles();
+            drawCalls += compositeTiles(graphics, window);
 
-            // draw stored shapes
-            drawShapes.drawStoredShapes(graphics);
+            // everything else is drawn in canvas coordinates through the view
+            Transform toWindow{ view.getTransform() };
+            Matrix matrix(toWindow.a, toWindow.b, toWindow.c, toWindow.d, toWindow.tx, toWindow.ty);
+            graphics.SetTransform(&matrix);
+
+            GdiplusBackend backend(graphics);
+            backend.setScale(view.getZoom());
+
+            // the live selection goes over the tiles, so dragging it only costs its own redraw
+            {
+                ProfileScope timer("drawLiveShapes");
+                drawShapes.drawLiveShapes(backend, area);
+            }
 
             // draw current shape, if left mouse button is depressed while in a shape mode
             if (drawShapes.isDrawing())
             {
-                drawShapes.drawCurrentShape(graphics);
+                ProfileScope timer("drawCurrentShape");
+                drawShapes.drawCurrentShape(backend);
             }
 
-            score.drawStoredElements(graphics);
+            {
+                ProfileScope timer("drawLiveElements");
+                score.drawLiveElements(backend, area);
+            }
 
             if (score.isDrawing())
             {
-                score.drawCurrentElement(graphics);
+                ProfileScope timer("drawCurrentElement");
+                score.drawCurrentElement(backend);
             }
 
             if (drawShapes.getShape() == DRAW_SHAPES::SELECT)
             {
-                drawShapes.selectRect(graphics);
+                ProfileScope timer("selectRect");
+                drawSelectRect(graphics, drawShapes.getSelectRect());
             }
             else if (score.getElement() == SCORE::SELECT)
             {
-                score.selectRect(graphics);
+                ProfileScope timer("selectRect");
+                drawSelectRect(graphics, score.getSelectRect());
+            }
+
+            drawCalls += backend.getDrawCalls();
+            if (showFrameStats)
+            {
+                drawFrameStats(graphics);
             }
 
             // blit memory DC to main DC
-            BitBlt(hdc, 0, 0, ps.rcPaint.right - ps.rcPaint.left, ps.rcPaint.bottom - ps.rcPaint.top, memDC, 0, 0, SRCCOPY);
+            {
+                ProfileScope timer("BitBlt");
+                BitBlt(hdc, paint.left, paint.top, paint.right - paint.left, paint.bottom - paint.top, memDC, paint.left, paint.top, SRCCOPY);
+            }
+
+            if (profiling)
+            {
+                profiler().endFrame(frameStart, drawCalls);
+            }
 
             EndPaint(hWnd, &ps);
         }
@@ -701,7 +1608,9 @@ LRESULT CALLBACK WndProc(HWND hWnd, UINT message, WPARAM wParam, LPARAM lParam)
         break;
 
     case WM_DESTROY:
-        // clean up resources
+        // clean up resources; the workers finish the tiles they're on first
+        stopPointerCapture();
+        tileRenderer.reset();
         DeleteObject(hBitmap);
         DeleteDC(memDC);
         PostQuitMessage(0);
@@ -735,26 +1644,30 @@ INT_PTR CALLBACK About(HWND hDlg, UINT message, WPARAM wParam, LPARAM lParam)
     return (INT_PTR)FALSE;
 }
 
-void updatePalette(Shape* shape)
+void updatePalette(ShapeHandle shape)
 {
-    SendMessage(GetDlgItem(hPaletteDialog, IDC_RSLIDER), TBM_SETPOS, TRUE, shape->getColor().GetRed());
-    drawShapes.setR(shape->getColor().GetRed());
+    const ShapeStore& shapes{ drawShapes.getShapes() };
+    Color color{ shapes.getColor(shape) };
+    int width{ shapes.getStroke(shape) };
 
-    SendMessage(GetDlgItem(hPaletteDialog, IDC_GSLIDER), TBM_SETPOS, TRUE, shape->getColor().GetGreen());
-    drawShapes.setG(shape->getColor().GetGreen());
+    SendMessage(GetDlgItem(hPaletteDialog, IDC_RSLIDER), TBM_SETPOS, TRUE, color.GetRed());
+    drawShapes.setR(color.GetRed());
 
-    SendMessage(GetDlgItem(hPaletteDialog, IDC_BSLIDER), TBM_SETPOS, TRUE, shape->getColor().GetBlue());
-    drawShapes.setB(shape->getColor().GetBlue());
+    SendMessage(GetDlgItem(hPaletteDialog, IDC_GSLIDER), TBM_SETPOS, TRUE, color.GetGreen());
+    drawShapes.setG(color.GetGreen());
 
-    SendMessage(GetDlgItem(hPaletteDialog, IDC_OSLIDER), TBM_SETPOS, TRUE, shape->getColor().GetAlpha());
-    drawShapes.setAlpha(shape->getColor().GetAlpha());
+    SendMessage(GetDlgItem(hPaletteDialog, IDC_BSLIDER), TBM_SETPOS, TRUE, color.GetBlue());
+    drawShapes.setB(color.GetBlue());
 
-    SendMessage(GetDlgItem(hPaletteDialog, IDC_TSLIDER), TBM_SETPOS, TRUE, shape->getWidth());
-    drawShapes.setWidth(shape->getWidth());
+    SendMessage(GetDlgItem(hPaletteDialog, IDC_OSLIDER), TBM_SETPOS, TRUE, color.GetAlpha());
+    drawShapes.setAlpha(color.GetAlpha());
 
+    SendMessage(GetDlgItem(hPaletteDialog, IDC_TSLIDER), TBM_SETPOS, TRUE, width);
+    drawShapes.setWidth(width);
 
-    SendMessage(GetDlgItem(hPaletteDialog, IDC_FILLBOX), BM_SETCHECK, shape->isFilled() ? BST_CHECKED : BST_UNCHECKED, 0);
-    SendMessage(GetDlgItem(hPaletteDialog, IDC_LOCKBOX), BM_SETCHECK, shape->isLocked() ? BST_CHECKED : BST_UNCHECKED, 0);
+
+    SendMessage(GetDlgItem(hPaletteDialog, IDC_FILLBOX), BM_SETCHECK, shapes.isFilled(shape) ? BST_CHECKED : BST_UNCHECKED, 0);
+    SendMessage(GetDlgItem(hPaletteDialog, IDC_LOCKBOX), BM_SETCHECK, shapes.isLocked(shape) ? BST_CHECKED : BST_UNCHECKED, 0);
 
     InvalidateRect(hPaletteDialog, NULL, TRUE);
 }
@@ -792,7 +1705,7 @@ INT_PTR CALLBACK Palette(HWND hwndDlg, UINT uMsg, WPARAM wParam, LPARAM lParam)
 
         if (dis->CtlID == IDC_CCOLOR)
         {
-            FillRect(hdc, &rect, drawShapes.getBrush());
+            FillRect(hdc, &rect, getPaletteBrush());
             
             return TRUE;
         }
@@ -812,7 +1725,7 @@ INT_PTR CALLBACK Palette(HWND hwndDlg, UINT uMsg, WPARAM wParam, LPARAM lParam)
             drawShapes.setSelectWidth();
 
             InvalidateRect(HWND(GetDlgItem(hwndDlg, IDC_CCOLOR)), NULL, TRUE);
-            InvalidateRect(gWindow, NULL, TRUE);
+            invalidateDirty(gWindow);
         }
         else if ((HWND)lParam == GetDlgItem(hwndDlg, IDC_OSLIDER))
         {
@@ -821,7 +1734,7 @@ INT_PTR CALLBACK Palette(HWND hwndDlg, UINT uMsg, WPARAM wParam, LPARAM lParam)
             drawShapes.setSelectColor();
 
             InvalidateRect(HWND(GetDlgItem(hwndDlg, IDC_CCOLOR)), NULL, TRUE);
-            InvalidateRect(gWindow, NULL, TRUE);
+            invalidateDirty(gWindow);
         }
         else if ((HWND)lParam == GetDlgItem(hwndDlg, IDC_RSLIDER))
         {
@@ -830,7 +1743,7 @@ INT_PTR CALLBACK Palette(HWND hwndDlg, UINT uMsg, WPARAM wParam, LPARAM lParam)
             drawShapes.setSelectColor();
 
             InvalidateRect(HWND(GetDlgItem(hwndDlg, IDC_CCOLOR)), NULL, TRUE);
-            InvalidateRect(gWindow, NULL, TRUE);
+            invalidateDirty(gWindow);
         }
         else if ((HWND)lParam == GetDlgItem(hwndDlg, IDC_GSLIDER))
         {
@@ -839,7 +1752,7 @@ INT_PTR CALLBACK Palette(HWND hwndDlg, UINT uMsg, WPARAM wParam, LPARAM lParam)
             drawShapes.setSelectColor();
 
             InvalidateRect(HWND(GetDlgItem(hwndDlg, IDC_CCOLOR)), NULL, TRUE);
-            InvalidateRect(gWindow, NULL, TRUE);
+            invalidateDirty(gWindow);
         }
         else if ((HWND)lParam == GetDlgItem(hwndDlg, IDC_BSLIDER))
         {
@@ -848,7 +1761,13 @@ INT_PTR CALLBACK Palette(HWND hwndDlg, UINT uMsg, WPARAM wParam, LPARAM lParam)
             drawShapes.setSelectColor();
 
             InvalidateRect(HWND(GetDlgItem(hwndDlg, IDC_CCOLOR)), NULL, TRUE);
-            InvalidateRect(gWindow, NULL, TRUE);
+            invalidateDirty(gWindow);
+        }
+
+        // letting go of a slider ends its run of changes, which undo as one
+        if (LOWORD(wParam) == TB_ENDTRACK)
+        {
+            drawShapes.endEdit();
         }
 
         return TRUE;
@@ -874,7 +1793,7 @@ INT_PTR CALLBACK Palette(HWND hwndDlg, UINT uMsg, WPARAM wParam, LPARAM lParam)
                     drawShapes.setSelectFill();
                 }
 
-                InvalidateRect(gWindow, NULL, TRUE);
+                invalidateDirty(gWindow);
             }
         }
         else if (LOWORD(wParam) == IDC_LOCKBOX)
@@ -898,17 +1817,17 @@ INT_PTR CALLBACK Palette(HWND hwndDlg, UINT uMsg, WPARAM wParam, LPARAM lParam)
         else if (LOWORD(wParam) == IDC_POPSHAPE)
         {
             drawShapes.popUp();
-            InvalidateRect(gWindow, NULL, TRUE);
+            invalidateDirty(gWindow);
         }
         else if (LOWORD(wParam) == IDC_PUSHSHAPE)
         {
             drawShapes.pushDown();
-            InvalidateRect(gWindow, NULL, TRUE);
+            invalidateDirty(gWindow);
         }
         else if (LOWORD(wParam) == IDC_DELETE)
         {
            drawShapes.removeShape();
-           InvalidateRect(gWindow, NULL, TRUE);
+           invalidateDirty(gWindow);
         }
         break;
     }
@@ -933,11 +1852,20 @@ INT_PTR CALLBACK Symbols(HWND hwndDlg, UINT uMsg, WPARAM wParam, LPARAM lParam)
         SendMessage(oSlider, TBM_SETPOS, TRUE, 0); // Set initial position to 0
 
         HWND symbols = GetDlgItem(hwndDlg, IDC_SYMBOLS);
-        SendMessage(symbols, WM_SETFONT, (WPARAM)score.getLeland(), TRUE);
+        SendMessage(symbols, WM_SETFONT, (WPARAM)leland, TRUE);
+
+        // owner-drawn rows don't size themselves from WM_SETFONT, so match them to Leland (listboxes cap rows at 255 px)
+        HDC hdc = GetDC(symbols);
+        HGDIOBJ oldFont = SelectObject(hdc, leland);
+        TEXTMETRIC metrics{};
+        GetTextMetrics(hdc, &metrics);
+        SelectObject(hdc, oldFont);
+        ReleaseDC(symbols, hdc);
+        SendMessage(symbols, LB_SETITEMHEIGHT, 0, MAKELPARAM((std::min)(static_cast<int>(metrics.tmHeight), 255), 0));
 
-        score.setGlyphs(symbols);
+        // the listbox is owner-data: it only keeps a row count and asks for each visible row as it paints
+        SendMessage(symbols, LB_SETCOUNT, score.getGlyphCount(), 0);
 
-        SendMessage(symbols, CB_RESETCONTENT, 0, 0);
         InvalidateRect(symbols, NULL, TRUE);
         UpdateWindow(symbols);
         return (INT_PTR)TRUE;
@@ -945,20 +1873,29 @@ INT_PTR CALLBACK Symbols(HWND hwndDlg, UINT uMsg, WPARAM wParam, LPARAM lParam)
     case WM_DRAWITEM:
     {
         LPDRAWITEMSTRUCT dis = (LPDRAWITEMSTRUCT)lParam;
-        if (dis->CtlType == ODT_LISTBOX)
+        if (dis->CtlType == ODT_LISTBOX && dis->itemID < score.getGlyphCount())
         {
             HDC hdc = dis->hDC;
             RECT rc = dis->rcItem;
+            bool selected{ (dis->itemState & ODS_SELECTED) != 0 };
 
             // Set background color
-            FillRect(hdc, &rc, (HBRUSH)(COLOR_WINDOW + 1));
+            FillRect(hdc, &rc, (HBRUSH)((selected ? COLOR_HIGHLIGHT : COLOR_WINDOW) + 1));
 
             // Set text color
-            SetTextColor(hdc, RGB(0, 0, 0)); // Black
+            SetTextColor(hdc, GetSysColor(selected ? COLOR_HIGHLIGHTTEXT : COLOR_WINDOWTEXT));
+            SetBkMode(hdc, TRANSPARENT);
 
-            // Draw the item text (glyph)
-            WCHAR glyph[2] = { score.getGlyphs()[dis->itemID][0], L'\0' }; // Null-terminated string
-            DrawText(hdc, glyph, -1, &rc, DT_VCENTER | DT_CENTER | DT_NOPREFIX);
+            // Draw the item text (glyph) straight out of the catalogue
+            std::wstring_view glyph{ score.getGlyph(dis->itemID) };
+            HGDIOBJ oldFont = SelectObject(hdc, leland);
+            DrawText(hdc, glyph.data(), static_cast<int>(glyph.size()), &rc, DT_VCENTER | DT_CENTER | DT_NOPREFIX | DT_SINGLELINE);
+            SelectObject(hdc, oldFont);
+
+            if (dis->itemState & ODS_FOCUS)
+            {
+                DrawFocusRect(hdc, &rc);
+            }
         }
         return TRUE;
     }
@@ -970,7 +1907,13 @@ INT_PTR CALLBACK Symbols(HWND hwndDlg, UINT uMsg, WPARAM wParam, LPARAM lParam)
             // Set size of currently-drawn text
             score.setSize(position);
 
-            InvalidateRect(gWindow, NULL, TRUE);
+            // letting go ends the run of sizes, which undo as one
+            if (LOWORD(wParam) == TB_ENDTRACK)
+            {
+                score.endEdit();
+            }
+
+            invalidateDirty(gWindow);
         }
         break;
 
@@ -982,10 +1925,13 @@ INT_PTR CALLBACK Symbols(HWND hwndDlg, UINT uMsg, WPARAM wParam, LPARAM lParam)
         switch (wmId)
         {
         case IDC_SYMBOLS: // Assuming this is the ID for your symbols list
-            if (HIWORD(wParam) == CBN_SELCHANGE) // Check for selection change
+            if (HIWORD(wParam) == LBN_SELCHANGE) // Check for selection change
             {
-                int index = SendMessage(symbols, LB_GETCURSEL, 0, 0);
-                score.setSymbol(index);
+                LRESULT index = SendMessage(symbols, LB_GETCURSEL, 0, 0);
+                if (index != LB_ERR)
+                {
+                    score.setSymbol(static_cast<std::size_t>(index));
+                }
             }
             break;
         case IDC_LOCKSYM:
@@ -1008,7 +1954,7 @@ INT_PTR CALLBACK Symbols(HWND hwndDlg, UINT uMsg, WPARAM wParam, LPARAM lParam)
 
         case IDC_DELETESYM:
             score.removeElement();
-            InvalidateRect(gWindow, NULL, TRUE);
+            invalidateDirty(gWindow);
             break;
 
         default:
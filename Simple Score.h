@@ -1,794 +1,349 @@
 #pragma once
 
-#include "resource.h"
-#include <gdiplus.h>
+#include <algorithm>
+#include <cstdint>
+#include <filesystem>
 #include <iostream>
+#include <iterator>
+#include <string>
+#include <string_view>
 #include <vector>
 #include <mutex>
 #include <memory>
-
-using namespace Gdiplus;
-
-class Shape
+#include "Geometry.h"
+#include "SpatialIndex.h"
+#include "DirtyRegion.h"
+#include "GlyphTable.h"
+#include "DocumentFile.h"
+#include "RenderBackend.h"
+#include "ShapeStore.h"
+#include "EditJournal.h"
+#include "SketchFitter.h"
+#include "Profiler.h"
+
+// The drawing and the score as the window edits them. Neither includes windows.h: points are RenderPoints,
+// colors are ARGB words and everything drawn goes through a RenderBackend, so the model also builds
+// headless, e.g. to benchmark it on Linux. The window owns the GDI objects and the listbox.
+
+class DRAW_SHAPES : private EditListener
 {
 public:
-	Shape(Color color, int width, bool filled) : m_color(color), m_width(width), m_filled(filled)
-	{
-		setTools(color, width);
-	}
-
-	void setTools(Color color, int width)
-	{
-		m_color = color;
-		m_width = width;
-		m_brush = std::make_unique<SolidBrush>(color);
-		m_pen = std::make_unique<Pen>(color, width);
-	}
-
-	virtual void draw(Graphics& graphics) const = 0; // Pure virtual function
-	virtual bool hitTest(int x, int y) = 0; // check if point is within the shape
-	virtual bool netTest(PointF tlCorn, PointF brCorn) = 0; // check if shape is within the selection rectangle
-	virtual void move(float dx, float dy) = 0; // move shape
-	virtual PointF getPosition() = 0; // return position of shape (relative to click point)
-	virtual PointF getCorner() const = 0; // return corner of shape
-	virtual int getLength() const = 0; // return length of shape ("width" is reserved for thickness)
-	virtual int getHeight()const  = 0; //return height of shape
-	virtual ~Shape() = default; // Virtual destructor for proper cleanup
-
-	Color getColor() const { return m_color; }
-	int getWidth() const { return m_width; }
-
-	void setColor(Color color)
-	{ 
-		m_color = color;
-		setTools(m_color, m_width);
-	}
-
-	virtual void setWidth(int w) = 0;
-
-	void setFillMode(bool f) { m_filled = f; }
-
-	void setSelX(int x) { m_selX = x; }
-	void setSelY(int y) { m_selY = y; }
-	int getSelX() const { return m_selX; }
-	int getSelY() const { return m_selY; }
-
-	const Pen* getPen() const { return m_pen.get(); }
-
-	const SolidBrush* getBrush() const { return m_filled ? m_brush.get() : nullptr; }
-
-	bool isFilled() const { return m_filled; }
-
-	void setLock(bool b) { m_locked = b; }
-
-	bool isLocked() const { return m_locked; }
-
-private:
-	Color m_color;
-	int m_width;
-	int m_selX;
-	int m_selY;
-
-	bool m_filled;
-	bool m_locked{ false };
-	std::unique_ptr<Pen> m_pen;
-	std::unique_ptr<SolidBrush> m_brush;
-};
-
-class LineShape : public Shape
-{
-public:
-	LineShape(PointF a, PointF b, Color color, int width) : m_a(a), m_b(b), Shape(color, width, 0) { setHiLo(); }
-
-	~LineShape() override = default;
-
-	void setHiLo()
-	{
-		if (m_a.X >= m_b.X)
-		{
-			hiX = m_a.X;
-			loX = m_b.X;
-		}
-		else
-		{
-			hiX = m_b.X;
-			loX = m_a.X;
-		}
-
-		if (m_a.Y >= m_b.Y)
-		{
-			hiY = m_a.Y;
-			loY = m_b.Y;
-		}
-		else
-		{
-			hiY = m_b.Y;
-			loY = m_a.Y;
-		}
-	}
-	
-
-	void setWidth(int w)
-	{
-		setTools(getColor(), w);
-	}
-
-	bool hitTest(int x, int y) override
+	enum SHAPE
 	{
-		if (x <= hiX && x >= loX && y <= hiY && y >= loY)
-		{
-			setSelX(x);
-			setSelY(y);
-
-			return true;
-		}
-
-		return false;
-	}
+		NONE,
+		LINE,
+		RECT,
+		ELLIPSE,
+		TRIANGLE,
+		SKETCH,
+		SELECT
+	};
 
-	bool netTest(PointF tlCorn, PointF brCorn) override
+	enum DIRECTION
 	{
-		if (loX > tlCorn.X && loY > tlCorn.Y && hiX < brCorn.X && hiY < brCorn.Y)
-		{
-			setSelX(loX);
-			setSelY(loY);
-
-			return true;
-		}
-
-		return false;
-	}
+		LEFT,
+		DOWN,
+		RIGHT,
+		UP
+	};
 
-	PointF getPosition() override { return PointF(getSelX(), getSelY()); }
-	PointF getCorner() const override { return PointF(loX, loY); }
-	int getLength() const { return hiX - loX; }
-	int getHeight() const { return hiY - loY; }
+	void setShape(SHAPE shape) { m_shape = shape; }
+	SHAPE getShape() const { return m_shape; }
 
-	void move(float dx, float dy) override
+	void addLine(RenderPoint a, RenderPoint b, std::uint32_t color, int width)
 	{
-		float moveX{ dx - getSelX() };
-		float moveY{ dy - getSelY() };
-		
-		m_a.X += moveX;
-		m_b.X += moveX;
-		m_a.Y += moveY;
-		m_b.Y += moveY;
-
-		setSelX(dx);
-		setSelY(dy);
-
-		setHiLo();
+		float xy[4]{ a.x, a.y, b.x, b.y };
+		insertShape(m_shapes.add(ShapeKind::Line, xy, 2, color, width, false));
 	}
 
-	void draw(Graphics& graphics) const override
+	void addRect(RenderPoint corner, float length, float height, std::uint32_t color, int width, bool filled)
 	{
-		graphics.DrawLine(getPen(), m_a.X, m_a.Y, m_b.X, m_b.Y);
+		float xy[4]{ corner.x, corner.y, corner.x + length, corner.y + height };
+		insertShape(m_shapes.add(ShapeKind::Rect, xy, 2, color, width, filled));
 	}
 
-private:
-	PointF m_a;
-	PointF m_b;
-
-	int hiX, loX, hiY, loY;
-};
-
-class EllipseShape : public Shape
-{
-public:
-	EllipseShape(PointF c, REAL width, REAL height, Color color, int w, bool f) : m_center(c), m_width(width), m_height(height), Shape(color, w, f) {}
-	~EllipseShape() override = default;
-
-	void draw(Graphics& graphics) const override
+	void addEllipse(RenderPoint corner, float length, float height, std::uint32_t color, int width, bool filled)
 	{
-		if (isFilled())
-		{
-			graphics.FillEllipse(getBrush(), m_center.X, m_center.Y, m_width, m_height);
-		}
-		else
-		{
-			graphics.DrawEllipse(getPen(), m_center.X, m_center.Y, m_width, m_height);
-		}
+		float xy[4]{ corner.x, corner.y, corner.x + length, corner.y + height };
+		insertShape(m_shapes.add(ShapeKind::Ellipse, xy, 2, color, width, filled));
 	}
 
-	void setWidth(int w)
+	void addTriangle(RenderPoint p1, RenderPoint p2, RenderPoint p3, std::uint32_t color, int width, bool filled)
 	{
-		setTools(getColor(), w);
+		float xy[6]{ p1.x, p1.y, p2.x, p2.y, p3.x, p3.y };
+		insertShape(m_shapes.add(ShapeKind::Triangle, xy, 3, color, width, filled));
 	}
 
-	bool hitTest(int x, int y) override
-	{
-		if ((x <= m_center.X + m_width) && (x >= m_center.X) && (y <= m_center.Y + m_height) && (y >= m_center.Y))
-		{
-			setSelX(x);
-			setSelY(y);
-
-			return true;
-		}
-
-		return false;
-	}
-
-	bool netTest(PointF tlCorn, PointF brCorn) override
-	{
-		if (m_center.X > tlCorn.X && m_center.Y > tlCorn.Y && m_center.X + m_width < brCorn.X && m_center.Y + m_height < brCorn.Y)
-		{
-			setSelX(m_center.X);
-			setSelY(m_center.Y);
-
-			return true;
-		}
-
-		return false;
-	}
+	void setWidth(int w) { m_width = w; }
+	int getWidth() const { return m_width; }
 
-	PointF getPosition() override { return PointF(getSelX(), getSelY()); }
-	PointF getCorner() const override { return m_center; }
-	int getLength() const { return m_width; }
-	int getHeight() const { return m_height; }
+	void setAlpha(uint8_t a) { m_alpha = a; }
+	void setR(uint8_t r) { m_r = r; }
+	void setG(uint8_t g) { m_g = g; }
+	void setB(uint8_t b) { m_b = b; }
 
-	void move(float dx, float dy) override
+	// ARGB, as GDI+ and the backends take it
+	std::uint32_t getColor() const
 	{
-		float moveX{ dx - getSelX() };
-		float moveY{ dy - getSelY()};
-
-		m_center.X += moveX;
-		m_center.Y += moveY;
-
-		setSelX(dx);
-		setSelY(dy);
+		return static_cast<std::uint32_t>(m_alpha) << 24 | static_cast<std::uint32_t>(m_r) << 16 | static_cast<std::uint32_t>(m_g) << 8 | m_b;
 	}
 
-private:
-	PointF m_center;
-	REAL m_width;
-	REAL m_height;
-
-};
-
-class RectShape : public Shape
-{
-public:
-	RectShape(PointF corner, int width, int height, Color color, int w, bool f) : m_corner(corner), m_width(width), m_height(height), Shape(color, w, f) {}
-	~RectShape() override = default;
-
-	void draw(Graphics& graphics) const override
-	{
-		if (isFilled())
-		{
-			graphics.FillRectangle(getBrush(), static_cast<int>(m_corner.X), static_cast<int>(m_corner.Y), m_width, m_height);
-		}
-		else
-		{
-			graphics.DrawRectangle(getPen(), static_cast<int>(m_corner.X), static_cast<int>(m_corner.Y), m_width, m_height);
-		}
-	}
+	uint8_t getAlpha() const { return m_alpha; }
+	uint8_t getR() const { return m_r; }
+	uint8_t getG() const { return m_g; }
+	uint8_t getB() const { return m_b; }
 
-	void setWidth(int w)
+	// draws the stored shapes that intersect area, in z order
+	void drawStoredShapes(RenderBackend& backend, const Bounds& area)
 	{
-		setTools(getColor(), w);
+		drawShapesWhere(backend, area, [](ShapeHandle) { return true; });
 	}
 
-	bool hitTest(int x, int y) override
+	// the static layer, which the window keeps as cached tiles: everything but the live shapes
+	void drawStaticShapes(RenderBackend& backend, const Bounds& area)
 	{
-		if ((x <= (m_corner.X + m_width)) && (x >= m_corner.X) && (y <= (m_corner.Y + m_height)) && (y >= m_corner.Y))
-		{
-			setSelX(x);
-			setSelY(y);
-
-			return true;
-		}
-
-		return false;
+		drawShapesWhere(backend, area, [this](ShapeHandle shape) { return !isLive(shape); });
 	}
 
-	bool netTest(PointF tlCorn, PointF brCorn) override
+	// the live layer, drawn over the tiles every frame, so dragging the selection never redraws a tile
+	void drawLiveShapes(RenderBackend& backend, const Bounds& area)
 	{
-		if(m_corner.X > tlCorn.X && m_corner.Y > tlCorn.Y && m_corner.X + m_width < brCorn.X && m_corner.Y + m_height < brCorn.Y)
+		if (!m_live.empty())
 		{
-			setSelX(m_corner.X);
-			setSelY(m_corner.Y);
-
-			return true;
+			drawShapesWhere(backend, area, [this](ShapeHandle shape) { return isLive(shape); });
 		}
-
-		return false;
 	}
 
-	PointF getPosition() override { return PointF(getSelX(), getSelY()); }
-	PointF getCorner() const override { return m_corner; }
-	int getLength() const { return m_width; }
-	int getHeight() const { return m_height; }
+	void setOrigin(RenderPoint origin){ m_origin = origin; }
 
-	void move(float dx, float dy) override
-	{
-		float moveX{ dx - getSelX() };
-		float moveY{ dy - getSelY() };
-
-		m_corner.X += moveX;
-		m_corner.Y += moveY;
+	float getOX() const{ return m_origin.x; }
+	float getOY() const{ return m_origin.y; }
 
-		setSelX(dx);
-		setSelY(dy);
-	}
+	void setCurrent(RenderPoint current) { m_current = current; }
 
-private:
-	PointF m_corner;
-	int m_width;
-	int m_height;
-};
+	float getCX() const { return m_current.x; }
+	float getCY() const { return m_current.y; }
 
-class TriShape : public Shape
-{
-public:
-	TriShape(PointF p1, PointF p2, PointF p3, Color color, int w, bool f) : Shape(color, w, f)
-	{
-		m_points[0] = p1;
-		m_points[1] = p2;
-		m_points[2] = p3;
+	void setDrawing(bool b) { m_drawing = b; }
+	bool isDrawing() const { return m_drawing; }
 
-		setHiLo(p1, p2, p3);
-	}
-	~TriShape() override = default;
+	void setFillMode(bool b) { m_fill = b; }
+	bool getFillMode() const { return m_fill; }
 
-	void draw(Graphics& graphics) const override
+	// the palette's sliders call these as they're dragged; each drag is one edit until endEdit
+	void setSelectColor()
 	{
-		if (isFilled())
-		{
-			graphics.FillPolygon(getBrush(), m_points, 3);
-		}
-		else
-		{
-			graphics.DrawPolygon(getPen(), m_points, 3);
-		}
+		restyleSelected([this](ShapeHandle shape) { m_shapes.setColor(shape, getColor()); }, true);
 	}
 
-	void setWidth(int w)
+	void setSelectWidth()
 	{
-		setTools(getColor(), w);
+		restyleSelected([this](ShapeHandle shape) { m_shapes.setWidth(shape, m_width); }, true);
 	}
 
-	bool hitTest(int x, int y) override
+	void setSelectFill()
 	{
-		PointF p(x, y);
-
-		float areaO{ triangleArea(m_points[0], m_points[1], m_points[2]) };
-
-		float area1{ triangleArea(p, m_points[1], m_points[2]) };
-		float area2{ triangleArea(m_points[0], p, m_points[2]) };
-		float area3{ triangleArea(m_points[0], m_points[1], p) };
-
-		if ((area1 + area2 + area3) <= areaO + 100)
-		{
-			setSelX(x);
-			setSelY(y);
-
-			return true;
-		}
-
-		return false;
+		restyleSelected([this](ShapeHandle shape) { m_shapes.setFilled(shape, m_fill); }, false);
 	}
 
-	bool netTest(PointF tlCorn, PointF brCorn) override
-	{
-		if (m_loX > tlCorn.X && m_loY > tlCorn.Y && m_hiX < brCorn.X && m_hiY < brCorn.Y)
-		{
-			setSelX(m_loX);
-			setSelY(m_loY);
-
-			return true;
-		}
+	// ends the current run of nudges or slider changes, so the next one is a separate edit
+	void endEdit() { m_journal.seal(); }
 
-		return false;
-	}
+	bool canUndo() const { return m_journal.canUndo(); }
+	bool canRedo() const { return m_journal.canRedo(); }
 
-	PointF getCorner() const override { return PointF(m_loX, m_loY); }
-	int getLength() const { return m_hiX - m_loX; }
-	int getHeight() const { return m_hiY - m_loY; }
-	PointF getPosition() override { return PointF(getSelX(), getSelY()); }
+	// how many of the oldest edits have stopped being undoable since the last call, to tell the user
+	std::size_t takeForgottenEdits() { return m_journal.takeForgotten(); }
 
-	void move(float dx, float dy) override
+	// the selection may not survive undo and redo, so they clear it
+	void undo()
 	{
-		float moveX{ dx - getSelX() };
-		float moveY{ dy - getSelY() };
-
-		m_points[0].X += moveX;
-		m_points[1].X += moveX;
-		m_points[2].X += moveX;
-
-		m_points[0].Y += moveY;
-		m_points[1].Y += moveY;
-		m_points[2].Y += moveY;
-
-		setSelX(dx);
-		setSelY(dy);
-
-		setHiLo(m_points[0], m_points[1], m_points[2]);
+		unSelect();
+		m_isMoving = false;
+		m_journal.undo(m_shapes, *this);
+		fitOrders();
 	}
 
-private:
-	PointF m_points[3];
-
-	int m_hiX, m_loX, m_hiY, m_loY;
-
-	float triangleArea(PointF a, PointF b, PointF c) const
+	void redo()
 	{
-		return std::abs((a.X * (b.Y - c.Y) + b.X * (c.Y - a.Y) + c.X * (a.Y - b.Y)) / 2.0f);
+		unSelect();
+		m_isMoving = false;
+		m_journal.redo(m_shapes, *this);
+		fitOrders();
 	}
 
-	void setHiLo(PointF a, PointF b, PointF c)
-	{
-		if (a.X > b.X && a.X > c.X)
-		{
-			m_hiX = a.X;
-		}
-		else if (b.X > c.X)
-		{
-			m_hiX = b.X;
-		}
-		else
-		{
-			m_hiX = c.X;
-		}
+	void drawCurrentShape(RenderBackend& backend);
 
-		if (a.X < b.X && a.X < c.X)
-		{
-			m_loX = a.X;
-		}
-		else if (b.X < c.X)
-		{
-			m_loX = b.X;
-		}
-		else
-		{
-			m_loX = c.X;
-		}
-
-		if (a.Y > b.Y && a.Y > c.Y)
-		{
-			m_hiY = a.Y;
-		}
-		else if (b.Y > c.Y)
-		{
-			m_hiY = b.Y;
-		}
-		else
-		{
-			m_hiY = c.Y;
-		}
-
-		if (a.Y < b.Y && a.Y < c.Y)
-		{
-			m_loY = a.Y;
-		}
-		else if (b.Y < c.Y)
-		{
-			m_loY = b.Y;
-		}
-		else
-		{
-			m_loY = c.Y;
-		}
-	}
-};
-
-class SketchShape : public Shape
-{
-public:
-	SketchShape(std::vector<PointF> points, Color color, int w) : m_points(points), Shape(color, w, 0)
-	{
-		setHiLo(points);
-	}
-
-	~SketchShape() override = default;
-
-	void draw(Graphics& graphics) const override
-	{
-		graphics.DrawCurve(getPen(), m_points.data(), m_points.size());
-	}
-
-	void setWidth(int w)
-	{
-		setTools(getColor(), w);
-	}
-
-	bool hitTest(int x, int y) override
-	{
-		if (x <= m_hiX && x >= m_loX && y <= m_hiY && y >= m_loY)
-		{
-			setSelX(x);
-			setSelY(y);
-
-			return true;
-		}
-
-		return false;
-	}
-
-	bool netTest(PointF tlCorn, PointF brCorn) override
-	{
-		if (m_loX > tlCorn.X && m_loY > tlCorn.Y && m_hiX < brCorn.X && m_hiY < brCorn.Y)
+	void addSketch()
+	{ 
+		std::lock_guard<std::mutex> lock(mutex_);
+		if (!m_sketch.empty())
 		{
-			setSelX(m_loX);
-			setSelY(m_loY);
-
-			return true;
+			const std::vector<RenderPoint>& curve{ m_sketch.finish() };
+			insertShape(m_shapes.add(ShapeKind::Curve, asFloats(curve.data()), curve.size(), getColor(), m_width, false));
 		}
-
-		return false;
+		m_sketch.clear();
 	}
 
-	PointF getPosition() override { return PointF(getSelX(), getSelY()); }
-	PointF getCorner() const override { return PointF(m_loX, m_loY); }
-	int getLength() const { return m_hiX - m_loX; }
-	int getHeight() const { return m_hiY - m_loY; }
-
-	void move(float dx, float dy) override
+	// feeds the point under the pen to the sketch being drawn
+	void addSketchPoint()
 	{
-		float moveX{ dx - getSelX() };
-		float moveY{ dy - getSelY() };
-
-		for (auto& mp : m_points)
-		{
-			mp.X += moveX;
-			mp.Y += moveY;
-		}
-
-		m_loX += moveX;
-		m_hiX += moveX;
-		m_loY += moveY;
-		m_hiY += moveY;
-
-		setSelX(dx);
-		setSelY(dy);
+		std::lock_guard<std::mutex> lock(mutex_);
+		m_sketch.add(m_current.x, m_current.y);
+		m_sketchDamage = m_sketchDamage.united(m_sketch.getOpenBounds());
 	}
 
-private:
-	std::vector<PointF> m_points;
-	int m_loX{ 10000 };
-	int m_hiX{ -10000 };
-	int m_loY{ 10000 };
-	int m_hiY{ -10000 };
-	int m_selX{ 0 };
-	int m_selY{ 0 };
-
-	void setHiLo(std::vector<PointF>& points)
+	// feeds a batch of the pen's path to the sketch, oldest first, under one lock; the pen is then at the last
+	void addSketchPoints(const RenderPoint* points, std::size_t count)
 	{
-		for (const auto& p : points)
+		if (count == 0)
 		{
-			if (p.X > m_hiX)
-			{
-				m_hiX = p.X;
-			}
-			else if (p.X < m_loX)
-			{
-				m_loX = p.X;
-			}
-
-			if (p.Y > m_hiY)
-			{
-				m_hiY = p.Y;
-			}
-			else if (p.Y < m_loY)
-			{
-				m_loY = p.Y;
-			}
+			return;
 		}
-	}
-};
-
-class DRAW_SHAPES
-{
-public:
-	DRAW_SHAPES()
-	{
-		m_brush = CreateSolidBrush(RGB(0, 0, 0));
-	}
-
-	~DRAW_SHAPES()
-	{
-		DeleteObject(m_brush);
-		m_brush = NULL;
-	}
-
-	enum SHAPE
-	{
-		NONE,
-		LINE,
-		RECT,
-		ELLIPSE,
-		TRIANGLE,
-		SKETCH,
-		SELECT
-	};
 
-	enum DIRECTION
-	{
-		LEFT,
-		DOWN,
-		RIGHT,
-		UP
-	};
-
-	void setShape(SHAPE shape) { m_shape = shape; }
-	SHAPE getShape() const { return m_shape; }
-	void addShape(std::shared_ptr<Shape> shape) { m_shapes.push_back(shape); }
-
-	void setWidth(int w) { m_width = w; }
-	int getWidth() const { return m_width; }
-
-	void setAlpha(uint8_t a) { m_alpha = a; }
-	void setR(uint8_t r) { m_r = r; }
-	void setG(uint8_t g) { m_g = g; }
-	void setB(uint8_t b) { m_b = b; }
-
-	Color getColor() const { return Color(m_alpha, m_r, m_g, m_b); }
-
-	uint8_t getAlpha() const { return m_alpha; }
-
-	void drawStoredShapes(Graphics& graphics)
-	{
 		std::lock_guard<std::mutex> lock(mutex_);
-		for (const auto& shape : m_shapes)
+		for (std::size_t i{ 0 }; i < count; ++i)
 		{
-			shape->draw(graphics);
-		}
-	}
-
-	void setOrigin(PointF origin){ m_origin = origin; }
-
-	REAL getOX() const{ return m_origin.X; }
-	REAL getOY() const{ return m_origin.Y; }
-
-	void setCurrent(PointF current) { m_current = current; }
-
-	REAL getCX() const { return m_current.X; }
-	REAL getCY() const { return m_current.Y; }
-
-	void setDrawing(bool b) { m_drawing = b; }
-	bool isDrawing() const { return m_drawing; }
-
-	void setFillMode(bool b) { m_fill = b; }
-	bool getFillMode() const { return m_fill; }
+			m_sketch.add(points[i].x, points[i].y);
 
-	void setSelectColor()
-	{
-		if (m_selected)
-		{
-			if (!m_selected->isLocked())
-			{
-				m_selected->setColor(Color(m_alpha, m_r, m_g, m_b));
-			}
-		}
-		else if (m_selected_shapes.size() > 0)
-		{
-			for (auto& shape : m_selected_shapes)
-			{
-				if (!shape->isLocked())
-				{
-					shape->setColor(Color(m_alpha, m_r, m_g, m_b));
-				}
-			}
-		}
-	}
-
-	void setSelectWidth()
-	{
-		if (m_selected)
-		{
-			if (!m_selected->isLocked())
-			{
-				m_selected->setWidth(m_width);
-			}
-		}
-		else if (m_selected_shapes.size() > 0)
-		{
-			for (auto& shape : m_selected_shapes)
-			{
-				if (!shape->isLocked())
-				{
-					shape->setWidth(m_width);
-				}
-			}
+			// segments can open and settle within one batch, between overlays
+			m_sketchDamage = m_sketchDamage.united(m_sketch.getOpenBounds());
 		}
+		m_current = points[count - 1];
 	}
 
-	void setSelectFill()
+	void setSelect()
 	{
-		if (m_selected)
-		{
-			if (!m_selected->isLocked())
-			{
-				m_selected->setFillMode(m_fill);
-			}
-		}
-		else if (m_selected_shapes.size() > 0)
-		{
-			for (auto& shape : m_selected_shapes)
-			{
-				if (!shape->isLocked())
-				{
-					shape->setFillMode(m_fill);
-				}
-			}
-		}
-	}
-
-	void drawCurrentShape(Graphics& graphics);
-
-	void addSketch()
-	{ 
-		std::lock_guard<std::mutex> lock(mutex_);
-		m_shapes.push_back(std::make_shared<SketchShape>(m_sketch_points, getColor(), m_width));
-		m_sketch_points.clear();
+		m_journal.seal();
+		m_selected = m_shapes.getHandle(m_shapes.size() - 1);
+		updateLive();
 	}
 
-	HBRUSH getBrush()
-	{ 
-		LOGBRUSH lb;
-		GetObject(m_brush, sizeof(LOGBRUSH), &lb);
-		COLORREF color = lb.lbColor; // color value of current brush
-
-		if (color != RGB(m_r, m_g, m_b))
-		{
-			DeleteObject(m_brush);
+	ShapeHandle getSelected() const { return m_selected; }
 
-			m_brush = CreateSolidBrush(RGB(m_r, m_g, m_b));
-		}
+	const ShapeStore& getShapes() const { return m_shapes; }
 
-		return m_brush;
-	}
-
-	void setSelect() { m_selected = m_shapes.back().get(); }
-
-	Shape* getSelected() const { return m_selected; }
-
-	void unSelect() { m_selected = NULL; m_selected_shapes.clear(); }
+	void unSelect()
+	{
+		m_journal.seal();
+		m_selected = kNoShape;
+		m_selected_shapes.clear();
+		updateLive();
+	}
 
-	void selectShape(int x, int y)
+	void selectShape(float x, float y)
 	{
-		for (auto& shape : m_shapes)
+		ProfileScope timer("selectShape");
+		m_journal.seal();
+		m_index.query(x, y, m_candidates);
+
+		for (ShapeHandle shape : m_candidates)
 		{
-			if (shape->hitTest(x, y))
+			if (m_shapes.hitTest(shape, x, y))
 			{
-				m_selected = shape.get();
+				m_selected = shape;
+				m_dragX = x;
+				m_dragY = y;
+				m_dragStartX = x;
+				m_dragStartY = y;
 				m_isMoving = true;
+				updateLive();
 				return;
 			}
 		}
 		
-		m_selected = NULL;
+		m_selected = kNoShape;
 		m_isSelecting = true;
 		m_selected_shapes.clear();
+		updateLive();
 	}
 
 	void selectShapes()
 	{
-		for (auto& shape : m_shapes)
+		ProfileScope timer("selectShapes");
+		Bounds net{ Bounds::fromCorner(m_origin.x, m_origin.y, m_current.x - m_origin.x, m_current.y - m_origin.y) };
+		m_index.query(net, m_candidates);
+
+		for (ShapeHandle shape : m_candidates)
 		{
-			if (shape->netTest(m_origin, m_current))
+			if (m_shapes.isInside(shape, net))
 			{
 				m_selected_shapes.push_back(shape);
 			}
 		}
+		updateLive();
+	}
+
+	// the dashed rectangle the window draws around the selection; empty if there's none
+	Bounds getSelectRect() const
+	{
+		if (m_selected != kNoShape)
+		{
+			return m_shapes.getExtent(m_selected);
+		}
+		else if (m_isSelecting || m_selected_shapes.size() > 0)
+		{
+			return Bounds::fromCorner(m_origin.x, m_origin.y, m_current.x - m_origin.x, m_current.y - m_origin.y);
+		}
+		return Bounds::empty();
 	}
 
-	void selectRect(Graphics& graphics) const
+	// area covered by the in-progress shape and the selection rectangle, which follow the mouse
+	Bounds getOverlayBounds() const
 	{
-		Pen selectPen(Color(255, 0, 0, 100), 2.0f);
-		selectPen.SetDashStyle(DashStyleDash);
+		Bounds overlay{ Bounds::empty() };
 
-		if (m_selected)
+		if (m_drawing)
 		{
-			PointF corner{ m_selected->getCorner() };
-			REAL length{ static_cast<REAL>(m_selected->getLength()) };
-			REAL height{ static_cast<REAL>(m_selected->getHeight()) };
+			if (m_shape == SKETCH)
+			{
+				// settled segments never change, so only the open one needs repainting; a cubic stays inside its control points
+				overlay = m_sketch.getOpenBounds().united(Bounds::fromCorner(m_current.x, m_current.y, 0.0f, 0.0f)).inflated(m_width / 2.0f + 2.0f);
+			}
+			else
+			{
+				overlay = Bounds::fromCorner(m_origin.x, m_origin.y, m_current.x - m_origin.x, m_current.y - m_origin.y).inflated(m_width / 2.0f + 2.0f);
+			}
+		}
 
-			graphics.DrawRectangle(&selectPen, corner.X, corner.Y, length, height);
+		if (m_shape == SELECT)
+		{
+			if (m_selected != kNoShape)
+			{
+				overlay = overlay.united(m_shapes.getExtent(m_selected).inflated(2.0f));
+			}
+			else if (m_isSelecting || m_selected_shapes.size() > 0)
+			{
+				overlay = overlay.united(Bounds::fromCorner(m_origin.x, m_origin.y, m_current.x - m_origin.x, m_current.y - m_origin.y).inflated(2.0f));
+			}
 		}
-		else if (m_isSelecting || m_selected_shapes.size() > 0)
+
+		return overlay;
+	}
+
+	// hands over the damage recorded since the last call, including where the overlay was and is now
+	void takeDirty(DirtyRegion& dirty)
+	{
+		Bounds overlay{ getOverlayBounds() };
+		m_dirty.add(m_lastOverlay);
+		m_dirty.add(overlay);
+		m_lastOverlay = overlay;
+
+		if (!m_sketchDamage.isEmpty())
 		{
-			graphics.DrawRectangle(&selectPen, m_origin.X, m_origin.Y, m_current.X - m_origin.X, m_current.Y - m_origin.Y);
+			m_dirty.add(m_sketchDamage.inflated(m_width / 2.0f + 2.0f));
+			m_sketchDamage = Bounds::empty();
 		}
+
+		dirty.add(m_dirty);
+		m_dirty.clear();
+	}
+
+	// hands over the damage to the static layer since the last call; the tiles under it are stale
+	void takeStale(DirtyRegion& stale)
+	{
+		stale.add(m_staticDirty);
+		m_staticDirty.clear();
 	}
 
 	bool isMoving() const { return m_isMoving; }
@@ -797,68 +352,71 @@ public:
 
 	void stopSelecting() { m_isSelecting = false; }
 
-	void dropShape() { m_isMoving = false; }
+	// a drag is recorded as one move when the shape is let go
+	void dropShape()
+	{
+		m_isMoving = false;
+
+		if (m_shapes.contains(m_selected) && !m_shapes.isLocked(m_selected) && (m_dragX != m_dragStartX || m_dragY != m_dragStartY))
+		{
+			m_journal.recordMove({ m_selected }, m_dragX - m_dragStartX, m_dragY - m_dragStartY);
+		}
+	}
 
-	void moveShape(int x, int y)
+	void moveShape(float x, float y)
 	{ 
-		if (!m_selected->isLocked())
+		if (!m_shapes.isLocked(m_selected))
 		{
-			m_selected->move(x, y);
+			m_shapes.translate(m_selected, x - m_dragX, y - m_dragY);
+			touchShape(m_selected);
 		}
+
+		m_dragX = x;
+		m_dragY = y;
 	}
 
 	void moveShapes(DIRECTION direction)
 	{
 		bool shapesCanMove{ false };
 
-		for (auto& shape : m_selected_shapes)
+		float dx{ direction == LEFT ? -1.0f : direction == RIGHT ? 1.0f : 0.0f };
+		float dy{ direction == UP ? -1.0f : direction == DOWN ? 1.0f : 0.0f };
+
+		std::vector<ShapeHandle> moved;
+		for (ShapeHandle shape : m_selected_shapes)
 		{
-			if (!shape->isLocked())
+			if (!m_shapes.isLocked(shape))
 			{
 				shapesCanMove = true;
 
-				PointF position{ shape->getPosition() };
-				switch (direction)
-				{
-				case LEFT:
-					--position.X;
-					break;
-				case DOWN:
-					++position.Y;
-					break;
-				case RIGHT:
-					++position.X;
-					break;
-				case UP:
-					--position.Y;
-					break;
-				default:
-					return;
-				}
-
-				shape->move(position.X, position.Y);
+				m_shapes.translate(shape, dx, dy);
+				touchShape(shape);
+				moved.push_back(shape);
 			}
 		}
 
 		if (shapesCanMove)
 		{
+			// the window ends the edit on each fresh key press, so only an arrow key's auto-repeat joins into one move
+			m_journal.recordMove(std::move(moved), dx, dy, true);
+
 			switch (direction)
 			{
 			case LEFT:
-				--m_origin.X;
-				--m_current.X;
+				--m_origin.x;
+				--m_current.x;
 				break;
 			case DOWN:
-				++m_origin.Y;
-				++m_current.Y;
+				++m_origin.y;
+				++m_current.y;
 				break;
 			case RIGHT:
-				++m_origin.X;
-				++m_current.X;
+				++m_origin.x;
+				++m_current.x;
 				break;
 			case UP:
-				--m_origin.Y;
-				--m_current.Y;
+				--m_origin.y;
+				--m_current.y;
 				break;
 			default:
 				return;
@@ -866,139 +424,267 @@ public:
 		}
 	}
 
-	void deleteShapes()
+	// grows or shrinks the selection about its middle
+	void scaleShapes(float factor)
 	{
-		m_shapes.clear();
-		m_selected_shapes.clear();
+		RenderPoint middle{ getSelectionMiddle() };
+		transformSelected(Transform::scaling(factor, factor, middle.x, middle.y));
 	}
 
-	void removeShape()
+	// turns the selection about its middle, clockwise for positive degrees
+	void rotateShapes(float degrees)
+	{
+		RenderPoint middle{ getSelectionMiddle() };
+		transformSelected(Transform::rotation(degrees * 3.14159265f / 180.0f, middle.x, middle.y));
+	}
+
+	// the union of every stored shape's bounds
+	Bounds getContentBounds() const
+	{
+		return m_shapes.getContentBounds();
+	}
+
+	// groups write what's in them, so only roots are written here
+	void writeShapes(DocumentWriter& writer) const
 	{
-		if (m_selected)
+		for (std::size_t i{ 0 }; i < m_shapes.size(); ++i)
 		{
-			if (m_shapes.size() == 1)
+			ShapeHandle shape{ m_shapes.getHandle(i) };
+			if (m_shapes.getParent(shape) == kNoShape)
 			{
-				if (!m_shapes[0]->isLocked())
-				{
-					m_shapes.pop_back();
-					m_selected = NULL;
-				}
+				m_shapes.write(shape, writer, DocumentLayer::Drawing);
 			}
-			else if (!m_selected->isLocked())
+		}
+	}
+
+	// replaces every stored shape, e.g. with the ones from a document that was just opened
+	void setShapes(ShapeStore shapes)
+	{
+		m_selected = kNoShape;
+		m_selected_shapes.clear();
+		updateLive();
+		clearIndex();
+		m_journal.clear();
+
+		m_shapes = std::move(shapes);
+		for (std::size_t i{ 0 }; i < m_shapes.size(); ++i)
+		{
+			ShapeHandle shape{ m_shapes.getHandle(i) };
+			if (m_shapes.getParent(shape) == kNoShape)
 			{
+				indexShape(shape);
+			}
+		}
+	}
 
-				// Find the shared_ptr that matches m_selected
-				auto it = std::find_if(m_shapes.begin(), m_shapes.end(),
-					[this](const std::shared_ptr<Shape>& shape) {
-						return shape.get() == m_selected; // Compare pointers
-					});
+	void deleteShapes()
+	{
+		m_selected = kNoShape;
+		m_journal.clear();
+		m_selected_shapes.clear();
+		updateLive();
+		clearIndex();
+		m_shapes.clear();
+	}
 
-				// If found, erase it
-				if (it != m_shapes.end())
-				{
-					m_shapes.erase(it);
-					m_selected = NULL;
-				}
+	void removeShape()
+	{
+		if (m_selected != kNoShape)
+		{
+			if (!m_shapes.isLocked(m_selected))
+			{
+				std::vector<ShapeSnapshot> removed;
+				snapshotTree(m_selected, removed);
+				m_journal.recordRemove(std::move(removed));
+				unindexShape(m_selected);
+				m_shapes.remove(m_selected);
+				m_selected = kNoShape;
+				updateLive();
 			}
 		}
 		else if (m_selected_shapes.size() > 0)
 		{
 			bool shapesAreUnlocked{ false };
 
-			for (auto& selected_shape : m_selected_shapes)
+			// every snapshot has to be taken before the first removal shifts the z positions
+			std::vector<ShapeSnapshot> removed;
+			for (ShapeHandle shape : m_selected_shapes)
 			{
-				if (!selected_shape->isLocked())
+				if (!m_shapes.isLocked(shape))
 				{
-					shapesAreUnlocked = true;
-
-					auto it = std::find_if(m_shapes.begin(), m_shapes.end(),
-						[selected_shape](const std::shared_ptr<Shape>& shape) {
-							return shape.get() == selected_shape.get();
-						});
+					snapshotTree(shape, removed);
+				}
+			}
 
-					m_shapes.erase(it);
+			// locked shapes stay; the rest go in one pass that keeps the survivors' z order
+			std::vector<ShapeHandle> victims;
+			victims.reserve(removed.size());
+			for (const ShapeSnapshot& shape : removed)
+			{
+				shapesAreUnlocked = true;
 
-					selected_shape = NULL;
-				}
+				damage(shape.handle, m_index.boundsOf(shape.handle));
+				victims.push_back(shape.handle);
 			}
 
 			if (shapesAreUnlocked)
 			{
+				m_index.remove(victims);
+				m_shapes.remove(victims);
+				m_journal.recordRemove(std::move(removed));
 				m_selected_shapes.clear();
+				updateLive();
 			}
 		}
 	}
 
 	void lockSelectedShape()
 	{
-		if (m_selected)
+		if (m_selected != kNoShape)
 		{
-			m_selected->setLock(true);
+			m_shapes.setLocked(m_selected, true);
 		}
 		else if (m_selected_shapes.size() > 0)
 		{
-			for (auto& shape : m_selected_shapes)
+			for (ShapeHandle shape : m_selected_shapes)
 			{
-				shape->setLock(true);
+				m_shapes.setLocked(shape, true);
 			}
 		}
+		updateLive();
 	}
 
 	void unlockSelectedShape()
 	{
-		if (m_selected)
+		if (m_selected != kNoShape)
 		{
-			m_selected->setLock(false);
+			m_shapes.setLocked(m_selected, false);
 		}
 		else if (m_selected_shapes.size() > 0)
 		{
-			for (auto& shape : m_selected_shapes)
+			for (ShapeHandle shape : m_selected_shapes)
 			{
-				shape->setLock(false);
+				m_shapes.setLocked(shape, false);
 			}
 		}
+		updateLive();
 	}
 
-	void popUp()
+	// puts the unlocked selected shapes into one group, which is then what's selected
+	void groupSelected()
 	{
-		if (!m_selected->isLocked())
+		std::vector<ShapeHandle> members;
+		for (ShapeHandle shape : m_selected_shapes)
 		{
-			// Find the shared_ptr that matches m_selected
-			auto it = std::find_if(m_shapes.begin(), m_shapes.end(),
-				[this](const std::shared_ptr<Shape>& shape) {
-					return shape.get() == m_selected; // Compare pointers
-				});
+			if (!m_shapes.isLocked(shape))
+			{
+				members.push_back(shape);
+			}
+		}
+		if (members.size() < 2)
+		{
+			return;
+		}
+
+		ShapeHandle group{ m_shapes.group(members) };
+		shapesGrouped(group, m_shapes.getChildren(group));
+		m_journal.recordGroup(snapshotShape(group), m_shapes.getChildTransforms(group));
+		m_selected_shapes.assign(1, group);
+		updateLive();
+	}
+
+	// dissolves the selected groups, selecting what was in them
+	void ungroupSelected()
+	{
+		std::vector<ShapeHandle> groups;
+		if (m_selected != kNoShape)
+		{
+			groups.push_back(m_selected);
+		}
+		else
+		{
+			groups = m_selected_shapes;
+		}
+		groups.erase(std::remove_if(groups.begin(), groups.end(), [this](ShapeHandle shape) { return m_shapes.isLocked(shape) || !m_shapes.isGroup(shape); }), groups.end());
+		if (groups.empty())
+		{
+			return;
+		}
+
+		std::vector<ShapeSnapshot> snapshots;
+		std::vector<Transform> transforms;
+		std::vector<ShapeHandle> freed;
+		for (ShapeHandle group : groups)
+		{
+			snapshots.push_back(snapshotShape(group));
+			std::vector<Transform> inside{ m_shapes.getChildTransforms(group) };
+			transforms.insert(transforms.end(), inside.begin(), inside.end());
+
+			std::vector<ShapeHandle> children{ m_shapes.ungroup(group) };
+			shapesUngrouped(group, children);
+			freed.insert(freed.end(), children.begin(), children.end());
+		}
+		fitOrders();
+		m_journal.recordUngroup(std::move(snapshots), std::move(transforms));
+
+		// a band selection keeps what it held; a clicked group is simply gone
+		if (m_selected != kNoShape)
+		{
+			m_selected = kNoShape;
+		}
+		else
+		{
+			m_selected_shapes = std::move(freed);
+		}
+		updateLive();
+	}
 
-			// If not at the end, pop up
-			if (it != m_shapes.end() - 1)
+	void popUp()
+	{
+		if (!m_shapes.isLocked(m_selected))
+		{
+			// If not at the top, pop up
+			ShapeHandle above{ m_shapes.getAbove(m_selected) };
+			if (above != kNoShape)
 			{
-				std::iter_swap(it, std::next(it));
+				damage(above, m_index.boundsOf(above));
+				touchShape(m_selected);
+				m_index.swapOrder(m_selected, above);
+				m_shapes.swapOrder(m_selected, above);
+				m_journal.recordReorder(m_selected, above);
 			}
 		}
 	}
 
 	void pushDown()
 	{
-		if (!m_selected->isLocked())
+		if (!m_shapes.isLocked(m_selected))
 		{
-			// Find the shared_ptr that matches m_selected
-			auto it = std::find_if(m_shapes.begin(), m_shapes.end(),
-				[this](const std::shared_ptr<Shape>& shape) {
-					return shape.get() == m_selected; // Compare pointers
-				});
-
-			// If not at the begin, push down
-			if (it != m_shapes.begin())
+			// If not at the bottom, push down
+			ShapeHandle below{ m_shapes.getBelow(m_selected) };
+			if (below != kNoShape)
 			{
-				std::iter_swap(it, std::prev(it));
+				damage(below, m_index.boundsOf(below));
+				touchShape(m_selected);
+				m_index.swapOrder(m_selected, below);
+				m_shapes.swapOrder(m_selected, below);
+				m_journal.recordReorder(m_selected, below);
 			}
 		}
 	}
 
 private:
-	std::vector<std::shared_ptr<Shape>> m_shapes;
+	ShapeStore m_shapes;
+	EditJournal m_journal;
+	SpatialIndex<ShapeHandle> m_index;
+	std::vector<ShapeHandle> m_unfitted; // roots undo, redo or an ungroup put in the index at provisional orders
+	std::vector<ShapeHandle> m_candidates; // reused query buffer
+	DirtyRegion m_dirty;
+	DirtyRegion m_staticDirty; // the part of m_dirty the static layer's tiles have to redraw
+	Bounds m_lastOverlay{ Bounds::empty() };
 	std::mutex mutex_;
-	std::vector<PointF> m_sketch_points;
+	SketchFitter m_sketch;
+	Bounds m_sketchDamage{ Bounds::empty() }; // where the sketch's open segments reached since the last takeDirty
 
 	SHAPE m_shape{ NONE };
 	uint8_t m_alpha{ 255 };
@@ -1009,275 +695,399 @@ private:
 
 	bool m_drawing{ false };
 	bool m_fill{ false };
-	PointF m_origin;
-	PointF m_current;
-
-	HBRUSH m_brush;
-
-	Shape* m_selected{ nullptr };
+	RenderPoint m_origin{ 0.0f, 0.0f };
+	RenderPoint m_current{ 0.0f, 0.0f };
+
+	ShapeHandle m_selected{ kNoShape };
+	float m_dragX{ 0.0f }; // where the selected shape was last dragged from
+	float m_dragY{ 0.0f };
+	float m_dragStartX{ 0.0f }; // and where the drag began
+	float m_dragStartY{ 0.0f };
 	bool m_isMoving{ false };
 	bool m_isSelecting{ false };
-	std::vector<std::shared_ptr<Shape>> m_selected_shapes;
-};
+	std::vector<ShapeHandle> m_selected_shapes;
+	std::vector<ShapeHandle> m_live; // the selected unlocked shapes, sorted; drawn over the tiles instead of in them
 
-inline void DRAW_SHAPES::drawCurrentShape(Graphics& graphics)
-{
-	switch (m_shape)
+	static const float* asFloats(const RenderPoint* points)
 	{
-	case LINE:
-		{
-			LineShape line(m_origin, m_current, getColor(), m_width);
-			line.draw(graphics);
-			break;
-		}
-	case RECT:
-		{
-			RectShape rect(m_origin, m_current.X - m_origin.X, m_current.Y - m_origin.Y, getColor(), m_width, getFillMode());
-			rect.draw(graphics);
-			break;
-		}
-	case ELLIPSE:
+		static_assert(sizeof(RenderPoint) == 2 * sizeof(float), "RenderPoint is an x, y pair");
+		return reinterpret_cast<const float*>(points);
+	}
+
+	template<typename Keep>
+	void drawShapesWhere(RenderBackend& backend, const Bounds& area, Keep&& keep)
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		m_index.query(area, m_candidates);
+		for (ShapeHandle shape : m_candidates)
 		{
-			EllipseShape ellipse(m_origin, m_current.X - m_origin.X, m_current.Y - m_origin.Y, getColor(), m_width, getFillMode());
-			ellipse.draw(graphics);
-			break;
+			if (keep(shape))
+			{
+				m_shapes.render(shape, backend);
+			}
 		}
-	case TRIANGLE:
+	}
+
+	bool isLive(ShapeHandle shape) const { return std::binary_search(m_live.begin(), m_live.end(), shape); }
+
+	// recomputes the live shapes after the selection or a lock changes; whatever moved between the layers
+	// has to be drawn into, or out of, the tiles under it
+	void updateLive()
+	{
+		std::vector<ShapeHandle> live{ m_selected_shapes };
+		live.push_back(m_selected);
+		live.erase(std::remove_if(live.begin(), live.end(), [this](ShapeHandle shape) { return !m_shapes.contains(shape) || m_shapes.isLocked(shape); }), live.end());
+		std::sort(live.begin(), live.end());
+		live.erase(std::unique(live.begin(), live.end()), live.end());
+
+		std::vector<ShapeHandle> moved;
+		std::set_symmetric_difference(live.begin(), live.end(), m_live.begin(), m_live.end(), std::back_inserter(moved));
+		for (ShapeHandle shape : moved)
 		{
-			TriShape triangle(m_current, m_origin, PointF(m_current.X, m_origin.Y), getColor(), m_width, getFillMode());
-			triangle.draw(graphics);
-			break;
+			m_staticDirty.add(m_index.boundsOf(shape));
 		}
-	case SKETCH:
-		{
-			m_sketch_points.push_back(m_current);
 
-			if (m_sketch_points.size() > 1)
-			{
-				SketchShape sketch(m_sketch_points, getColor(), m_width);
-				sketch.draw(graphics);
-			}
+		m_live = std::move(live);
+	}
 
-			break;
+	// damage from a change to a stored shape; the tiles hold only the shapes that aren't live
+	void damage(ShapeHandle shape, const Bounds& bounds)
+	{
+		m_dirty.add(bounds);
+		if (!isLive(shape))
+		{
+			m_staticDirty.add(bounds);
 		}
 	}
-}
 
-class Measure : public Shape
-{
-public:
-	Measure(PointF tlCorner, int l) : m_tlCorner(tlCorner), m_length(l), Shape(Color(255, 0, 0, 0), 1, 0) {}
-
-	void draw(Graphics& graphics) const
+	// empties the index, damaging everything that was in it
+	void clearIndex()
 	{
-		graphics.DrawLine(getPen(), m_tlCorner, PointF(m_tlCorner.X, m_tlCorner.Y + m_size)); // left edge; could make optional
+		Bounds all{ m_shapes.getContentBounds() };
+		m_dirty.add(all);
+		m_staticDirty.add(all);
+		m_index.clear();
+	}
 
-		graphics.DrawLine(getPen(), m_tlCorner, PointF(m_tlCorner.X + m_length, m_tlCorner.Y));
-		graphics.DrawLine(getPen(), PointF(m_tlCorner.X, m_tlCorner.Y + (m_size / 4)), PointF(m_tlCorner.X + m_length, m_tlCorner.Y + (m_size / 4)));
-		graphics.DrawLine(getPen(), PointF(m_tlCorner.X, m_tlCorner.Y + (m_size / 2)), PointF(m_tlCorner.X + m_length, m_tlCorner.Y + (m_size / 2)));
-		graphics.DrawLine(getPen(), PointF(m_tlCorner.X, m_tlCorner.Y + (m_size * 3 / 4)), PointF(m_tlCorner.X + m_length, m_tlCorner.Y + (m_size * 3 / 4)));
-		graphics.DrawLine(getPen(), PointF(m_tlCorner.X, m_tlCorner.Y + m_size), PointF(m_tlCorner.X + m_length, m_tlCorner.Y + m_size));
+	void indexShape(ShapeHandle shape)
+	{
+		Bounds bounds{ m_shapes.getBounds(shape) };
+		m_index.insert(shape, bounds);
+		damage(shape, bounds);
+	}
 
-		graphics.DrawLine(getPen(), PointF(m_tlCorner.X + m_length, m_tlCorner.Y), PointF(m_tlCorner.X + m_length, m_tlCorner.Y + m_size)); // right edge; same as above
+	// re-indexes a changed shape, damaging both the area it left and the area it now covers; a shape in a
+	// group is indexed as its outermost group
+	void touchShape(ShapeHandle shape)
+	{
+		shape = m_shapes.getRoot(shape);
+		Bounds bounds{ m_shapes.getBounds(shape) };
+		damage(shape, m_index.boundsOf(shape));
+		damage(shape, bounds);
+		m_index.update(shape, bounds);
 	}
 
-	void setWidth(int w)
+	void unindexShape(ShapeHandle shape)
 	{
-		m_size = w * 4;
+		damage(shape, m_index.boundsOf(shape));
+		m_index.remove(shape);
 	}
 
-	bool hitTest(int x, int y) override
+	// Undo and redo put shapes back in the index at the orders they had when they were recorded, which a
+	// group or ungroup since may have left out of step with their neighbours', and an ungroup puts the
+	// children in at the group's. Each run of them that sits together in z order is fitted into the gap
+	// between the roots just below and above it, so the work follows the size of the change; only when a gap
+	// has run out does the whole index take the store's z order afresh. What was fitted was damaged, and
+	// nothing else moves.
+	void fitOrders()
 	{
-		if (x > m_tlCorner.X && x < m_tlCorner.X + m_length && y > m_tlCorner.Y && y < m_tlCorner.Y + m_size)
+		std::erase_if(m_unfitted, [this](ShapeHandle shape) { return !m_shapes.contains(shape) || m_shapes.getParent(shape) != kNoShape; });
+		std::sort(m_unfitted.begin(), m_unfitted.end(), [this](ShapeHandle a, ShapeHandle b) { return m_shapes.getPosition(a) < m_shapes.getPosition(b); });
+		for (std::size_t first{ 0 }; first < m_unfitted.size();)
 		{
-			setSelX(x);
-			setSelY(y);
+			std::size_t end{ first + 1 };
+			while (end < m_unfitted.size() && m_shapes.getAbove(m_unfitted[end - 1]) == m_unfitted[end])
+			{
+				++end;
+			}
 
-			return true;
+			ShapeHandle below{ m_shapes.getBelow(m_unfitted[first]) };
+			ShapeHandle above{ m_shapes.getAbove(m_unfitted[end - 1]) };
+			if (!m_index.fitBetween(m_unfitted.data() + first, end - first, below != kNoShape ? &below : nullptr, above != kNoShape ? &above : nullptr))
+			{
+				renumberIndex();
+				break;
+			}
+			first = end;
 		}
-		return false;
+		m_unfitted.clear();
 	}
 
-	bool netTest(PointF tlCorner, PointF brCorner) override
+	// gives every root in the index its store z order afresh, with the gaps between orders back at full width
+	void renumberIndex()
 	{
-		if (m_tlCorner.X > tlCorner.X && m_tlCorner.Y > tlCorner.Y && m_tlCorner.X + m_length < brCorner.X && m_tlCorner.Y + m_size < brCorner.Y)
+		m_candidates.clear();
+		for (std::size_t i{ 0 }; i < m_shapes.size(); ++i)
 		{
-			setSelX(m_tlCorner.X);
-			setSelY(m_tlCorner.Y);
-			return true;
+			ShapeHandle shape{ m_shapes.getHandle(i) };
+			if (m_shapes.getParent(shape) == kNoShape)
+			{
+				m_candidates.push_back(shape);
+			}
 		}
-		return false;
+		m_index.renumber(m_candidates);
 	}
 
-	void move(float dx, float dy) override
+	// indexes a shape that was just drawn and records it so it can be undone
+	void insertShape(ShapeHandle shape)
 	{
-		float moveX{ dx - getSelX() };
-		float moveY{ dy - getSelY() };
-
-		m_tlCorner.X += moveX;
-		m_tlCorner.Y += moveY;
-
-		setSelX(dx);
-		setSelY(dy);
+		indexShape(shape);
+		m_journal.recordInsert({ snapshotShape(shape) });
 	}
 
-	PointF getPosition() override { return m_tlCorner; }
-	PointF getCorner() const override { return m_tlCorner; }
-	int getLength() const { return m_length; }
-	int getHeight() const { return m_size; }
-	~Measure() override = default;
-
-private:
-	PointF m_tlCorner;
-	int m_length{};
-	int m_size{ 28 };
-};
-
-class Symbol : public Shape
-{
-public:
-	Symbol(PointF corner, int width, std::wstring symbol) : m_corner(corner), m_width(width), m_symbol(symbol), Shape(Color(255, 0, 0, 0), 1, 1) {}
-
-	void draw(Graphics& graphics) const
+	ShapeSnapshot snapshotShape(ShapeHandle shape) const
 	{
-		double size{ std::sqrt(std::pow(m_width, 2) + std::pow(m_width, 2)) };
-		PointF drawPoint(m_corner.X - size / 10.0f, m_corner.Y - size / 1.5);
-
-		Font font(L"Leland", m_width, FontStyleRegular, UnitPixel);
-		graphics.DrawString(m_symbol.c_str(), -1, &font, drawPoint, getBrush());
+		ShapeSnapshot snapshot{ m_shapes.snapshot(shape) };
+		snapshot.order = m_index.orderOf(shape);
+		return snapshot;
 	}
 
-	void setWidth(int w)
+	// snapshots a shape and, if it's a group, everything in it, which goes with it when it's removed
+	void snapshotTree(ShapeHandle shape, std::vector<ShapeSnapshot>& out) const
 	{
-		m_width = w;
+		out.push_back(snapshotShape(shape));
+		if (m_shapes.isGroup(shape))
+		{
+			std::vector<ShapeHandle> inside;
+			m_shapes.getDescendants(shape, inside);
+			for (ShapeHandle descendant : inside)
+			{
+				out.push_back(m_shapes.snapshot(descendant));
+			}
+		}
 	}
 
-	bool hitTest(int x, int y) override
+	// applies change to each unlocked selected shape, or everything in a selected group, recording their
+	// styles before and after as one edit
+	template<typename Change>
+	void restyleSelected(Change&& change, bool join)
 	{
-		if (x > m_corner.X && x < m_corner.X + m_width && y > m_corner.Y && y < m_corner.Y + m_width)
+		std::vector<ShapeHandle> changed;
+		std::vector<StyleId> before;
+		std::vector<StyleId> after;
+
+		auto restyle = [&](ShapeHandle shape) {
+			if (!m_shapes.isLocked(shape))
+			{
+				m_shapes.forEachLeaf(shape, [&](ShapeHandle leaf) {
+					before.push_back(m_shapes.getStyle(leaf));
+					m_shapes.getStyleTable().retain(before.back()); // keeps it from being dropped and reused in between
+					change(leaf);
+					after.push_back(m_shapes.getStyle(leaf));
+					changed.push_back(leaf);
+				});
+				touchShape(shape);
+			}
+		};
+
+		if (m_selected != kNoShape)
+		{
+			restyle(m_selected);
+		}
+		else
 		{
-			setSelX(x);
-			setSelY(y);
+			for (ShapeHandle shape : m_selected_shapes)
+			{
+				restyle(shape);
+			}
+		}
 
-			return true;
+		if (!changed.empty())
+		{
+			m_journal.recordRestyle(std::move(changed), before, after, join);
+		}
+		for (StyleId style : before)
+		{
+			m_shapes.getStyleTable().release(style);
 		}
-		return false;
 	}
 
-	bool netTest(PointF tlCorner, PointF brCorner) override
-	{ 
-		if (m_corner.X > tlCorner.X && m_corner.Y > tlCorner.Y && m_corner.X + m_width < brCorner.X && m_corner.Y + m_width < brCorner.Y)
+	RenderPoint getSelectionMiddle() const
+	{
+		Bounds area{ Bounds::empty() };
+		if (m_selected != kNoShape)
 		{
-			setSelX(m_corner.X);
-			setSelY(m_corner.Y);
-			return true;
+			area = m_shapes.getExtent(m_selected);
+		}
+		else
+		{
+			for (ShapeHandle shape : m_selected_shapes)
+			{
+				area = area.united(m_shapes.getExtent(shape));
+			}
 		}
-		return false;
+		return RenderPoint{ (area.left + area.right) / 2.0f, (area.top + area.bottom) / 2.0f };
 	}
 
-	void move(float dx, float dy) override
+	// follows each unlocked selected shape's transform with change; a key's auto-repeat joins into one edit
+	void transformSelected(const Transform& change)
 	{
-		float moveX{ dx - getSelX() };
-		float moveY{ dy - getSelY() };
-
-		m_corner.X += moveX;
-		m_corner.Y += moveY;
+		std::vector<ShapeHandle> changed;
+		std::vector<Transform> before;
+		std::vector<Transform> after;
 
-		setSelX(dx);
-		setSelY(dy);
-	}
+		auto transform = [&](ShapeHandle shape) {
+			if (!m_shapes.isLocked(shape))
+			{
+				before.push_back(m_shapes.getTransform(shape));
+				m_shapes.applyTransform(shape, change);
+				after.push_back(m_shapes.getTransform(shape));
+				changed.push_back(shape);
+				touchShape(shape);
+			}
+		};
 
-	PointF getPosition() override { return m_corner; }
-	PointF getCorner() const override { return m_corner; }
-	int getLength() const { return m_width; }
-	int getHeight() const { return m_width; }
-	~Symbol() override = default;
+		if (m_selected != kNoShape)
+		{
+			transform(m_selected);
+		}
+		else
+		{
+			for (ShapeHandle shape : m_selected_shapes)
+			{
+				transform(shape);
+			}
 
-private:
-	PointF m_corner;
-	std::wstring m_symbol;
-	int m_width;
-};
+			// keep the selection rectangle around what it selected
+			Bounds band{ change.map(Bounds::fromCorner(m_origin.x, m_origin.y, m_current.x - m_origin.x, m_current.y - m_origin.y)) };
+			m_dirty.add(band);
+			m_origin = RenderPoint{ band.left, band.top };
+			m_current = RenderPoint{ band.right, band.bottom };
+		}
 
-class Text : public Shape
-{
-public:
-	Text(PointF corner, int width, const std::wstring& font=L"Arial") : m_corner(corner), m_width(width), m_font(font), Shape(Color(255, 0, 0, 0), 1, 1) {}
+		if (!changed.empty())
+		{
+			m_journal.recordTransform(std::move(changed), before, after, true);
+		}
+	}
 
-	void draw(Graphics& graphics) const
+	void shapeRestored(ShapeHandle shape, std::uint64_t order) override
 	{
-		double size{ std::sqrt(std::pow(m_width, 2) + std::pow(m_width, 2)) };
-		PointF drawPoint(m_corner.X - size / 10.0f, m_corner.Y - size / 1.5);
+		// what's in a group comes back with it
+		if (m_shapes.getParent(shape) != kNoShape)
+		{
+			return;
+		}
+
+		Bounds bounds{ m_shapes.getBounds(shape) };
+		m_index.insert(shape, bounds, order);
+		damage(shape, bounds);
+		m_unfitted.push_back(shape);
+	}
 
-		Font font(m_font.c_str(), m_width, FontStyleRegular, UnitPixel);
-		graphics.DrawString(m_wstring.c_str(), -1, &font, drawPoint, getBrush());
+	void shapesRemoving(const std::vector<ShapeHandle>& shapes) override
+	{
+		for (ShapeHandle shape : shapes)
+		{
+			damage(shape, m_index.boundsOf(shape));
+		}
+		m_index.remove(shapes);
 	}
 
-	void setWidth(int w)
+	void shapeChanged(ShapeHandle shape) override { touchShape(shape); }
+
+	void shapesSwapped(ShapeHandle a, ShapeHandle b) override
 	{
-		m_width = w;
+		damage(a, m_index.boundsOf(a));
+		damage(b, m_index.boundsOf(b));
+		m_index.swapOrder(a, b);
 	}
 
-	bool hitTest(int x, int y) override
+	// the group is indexed in place of its children, at the topmost one's order
+	void shapesGrouped(ShapeHandle group, const std::vector<ShapeHandle>& children) override
 	{
-		if (x > m_corner.X && x < m_corner.X + m_width && y > m_corner.Y && y < m_corner.Y + m_width)
+		std::uint64_t order{ 0 };
+		for (ShapeHandle child : children)
 		{
-			setSelX(x);
-			setSelY(y);
-
-			return true;
+			order = (std::max)(order, m_index.orderOf(child));
+			damage(child, m_index.boundsOf(child));
 		}
-		return false;
+		m_index.remove(children);
+
+		Bounds bounds{ m_shapes.getBounds(group) };
+		m_index.insert(group, bounds, order);
+		damage(group, bounds);
 	}
 
-	bool netTest(PointF tlCorner, PointF brCorner) override
+	// and the children are indexed in its place, to be fitted between its neighbours once the edit is done
+	void shapesUngrouped(ShapeHandle group, const std::vector<ShapeHandle>& children) override
 	{
-		if (m_corner.X > tlCorner.X && m_corner.Y > tlCorner.Y && m_corner.X + m_width < brCorner.X && m_corner.Y + m_width < brCorner.Y)
+		std::uint64_t order{ m_index.orderOf(group) };
+		damage(group, m_index.boundsOf(group));
+		m_index.remove(group);
+		if (children.empty())
+		{
+			return;
+		}
+
+		for (ShapeHandle child : children)
 		{
-			setSelX(m_corner.X);
-			setSelY(m_corner.Y);
-			return true;
+			Bounds bounds{ m_shapes.getBounds(child) };
+			m_index.insert(child, bounds, order);
+			damage(child, bounds);
+			m_unfitted.push_back(child);
 		}
-		return false;
 	}
+};
 
-	void move(float dx, float dy) override
-	{
-		float moveX{ dx - getSelX() };
-		float moveY{ dy - getSelY() };
+inline void DRAW_SHAPES::drawCurrentShape(RenderBackend& backend)
+{
+	std::uint32_t color{ getColor() };
 
-		m_corner.X += moveX;
-		m_corner.Y += moveY;
+	switch (m_shape)
+	{
+	case LINE:
+		{
+			float xy[4]{ m_origin.x, m_origin.y, m_current.x, m_current.y };
+			renderShape(backend, ShapeKind::Line, xy, 2, color, m_width, false, L"", L"");
+			break;
+		}
+	case RECT:
+		{
+			float xy[4]{ m_origin.x, m_origin.y, m_current.x, m_current.y };
+			renderShape(backend, ShapeKind::Rect, xy, 2, color, m_width, getFillMode(), L"", L"");
+			break;
+		}
+	case ELLIPSE:
+		{
+			float xy[4]{ m_origin.x, m_origin.y, m_current.x, m_current.y };
+			renderShape(backend, ShapeKind::Ellipse, xy, 2, color, m_width, getFillMode(), L"", L"");
+			break;
+		}
+	case TRIANGLE:
+		{
+			float xy[6]{ m_current.x, m_current.y, m_origin.x, m_origin.y, m_current.x, m_origin.y };
+			renderShape(backend, ShapeKind::Triangle, xy, 3, color, m_width, getFillMode(), L"", L"");
+			break;
+		}
+	case SKETCH:
+		{
+			const std::vector<RenderPoint>& curve{ m_sketch.getCurve() };
+			if (curve.size() >= 4)
+			{
+				renderShape(backend, ShapeKind::Curve, asFloats(curve.data()), curve.size(), color, m_width, false, L"", L"");
+			}
 
-		setSelX(dx);
-		setSelY(dy);
+			break;
+		}
+	default:
+		break;
 	}
+}
 
-	void setFont(const std::wstring& font) { m_font = font; }
-
-	void queryString(const std::wstring& string) { m_wstring = string; }
-
-	PointF getPosition() override { return m_corner; }
-	PointF getCorner() const override { return m_corner; }
-	int getLength() const { return m_width; }
-	int getHeight() const { return m_width; }
-	~Text() override = default;
-
-private:
-	PointF m_corner;
-	std::wstring m_font;
-	std::wstring m_wstring{ L"" };
-	int m_width;
-};
-
-class SCORE
+class SCORE : private EditListener
 {
 public:
-	~SCORE()
-	{
-		DeleteObject(m_leland);
-	}
-
 	enum ELEMENT
 	{
 		NONE,
@@ -1295,25 +1105,48 @@ public:
 		UP
 	};
 
-	void drawStoredElements(Graphics& graphics)
+	// draws the stored elements that intersect area, in z order
+	void drawStoredElements(RenderBackend& backend, const Bounds& area)
+	{
+		drawElementsWhere(backend, area, [](ShapeHandle) { return true; });
+	}
+
+	// the elements the window keeps in its cached tiles, over the static shapes
+	void drawStaticElements(RenderBackend& backend, const Bounds& area)
+	{
+		drawElementsWhere(backend, area, [this](ShapeHandle e) { return !isLive(e); });
+	}
+
+	// the selected unlocked elements, drawn over the tiles every frame
+	void drawLiveElements(RenderBackend& backend, const Bounds& area)
 	{
-		for (auto& e : m_elements)
+		if (!m_live.empty())
 		{
-			e->draw(graphics);
+			drawElementsWhere(backend, area, [this](ShapeHandle e) { return isLive(e); });
 		}
 	}
 
-	void addElement(std::shared_ptr<Shape> element) { m_elements.push_back(element); }
+	void addMeasure(RenderPoint corner, int length)
+	{
+		float xy[4]{ corner.x, corner.y, corner.x + length, corner.y + kStaffHeight };
+		insertElement(m_elements.add(ShapeKind::Measure, xy, 2, kInk, 1, false));
+	}
+
+	void addSymbol(RenderPoint corner, int size, const std::wstring& symbol)
+	{
+		float xy[4]{ corner.x, corner.y, corner.x + size, corner.y + size };
+		insertElement(m_elements.add(ShapeKind::Symbol, xy, 2, kInk, 1, true, symbol));
+	}
 
-	void drawCurrentElement(Graphics& graphics);
+	void drawCurrentElement(RenderBackend& backend);
 
 	void setElement(ELEMENT element) { m_element = element; }
 	ELEMENT getElement() const { return m_element; }
 
-	void setOrigin(PointF origin) { m_origin = origin; }
-	void setCurrent(PointF current) { m_current = current; }
-	PointF getOrigin() const { return m_origin; }
-	PointF getCurrent() const { return m_current; }
+	void setOrigin(RenderPoint origin) { m_origin = origin; }
+	void setCurrent(RenderPoint current) { m_current = current; }
+	RenderPoint getOrigin() const { return m_origin; }
+	RenderPoint getCurrent() const { return m_current; }
 
 	void setDrawing(bool b) { m_isDrawing = b; }
 	bool isDrawing() const { return m_isDrawing; }
@@ -1321,144 +1154,196 @@ public:
 	void setMoving(bool b) { m_isMoving = b; }
 	bool isMoving() const { return m_isMoving; }
 
-	void setSelect() { m_selected = m_elements.back().get(); }
+	void setSelect()
+	{
+		m_journal.seal();
+		m_selected = m_elements.getHandle(m_elements.size() - 1);
+		updateLive();
+	}
 
 	bool isSelecting() const { return m_isSelecting; }
 
-	void setFont()
-	{ 
-		m_leland = CreateFont(
-			288, 0, 0, 0, FW_NORMAL, FALSE, FALSE, FALSE,
-			DEFAULT_CHARSET, OUT_OUTLINE_PRECIS, CLIP_DEFAULT_PRECIS,
-			DEFAULT_QUALITY, VARIABLE_PITCH, L"Leland");
+	// ends the current run of nudges or size changes, so the next one is a separate edit
+	void endEdit() { m_journal.seal(); }
+
+	bool canUndo() const { return m_journal.canUndo(); }
+	bool canRedo() const { return m_journal.canRedo(); }
+
+	// how many of the oldest edits have stopped being undoable since the last call, to tell the user
+	std::size_t takeForgottenEdits() { return m_journal.takeForgotten(); }
+
+	// the selection may not survive undo and redo, so they clear it
+	void undo()
+	{
+		unSelect();
+		m_journal.undo(m_elements, *this);
+		fitOrders();
 	}
 
-	void setGlyphs(HWND hWnd)
+	void redo()
 	{
-		HDC hdc = GetDC(hWnd);
-		SelectObject(hdc, m_leland);
+		unSelect();
+		m_journal.redo(m_elements, *this);
+		fitOrders();
+	}
 
-		for (WCHAR ch{ 0xE000 }; ch < 0xFFFF; ++ch)
+	// reads the supported glyphs from the cache beside the font, rebuilding it if the font has changed
+	bool loadGlyphs(const std::filesystem::path& fontPath)
+	{
+		ProfileScope timer("loadGlyphs");
+		std::filesystem::path dir{ fontPath.parent_path() };
+		if (!m_glyphTable.load(fontPath, dir / L"Leland.glyphs", dir / L"glyphnames.json"))
 		{
-			if (isGlyphSupported(hdc, ch))
-			{
-				WCHAR glyph[2] = { ch, L'\0' };
-				SendMessage(hWnd, LB_ADDSTRING, 0, (LPARAM)glyph);
-				m_glyphs.push_back(glyph);
-			}
+			return false;
 		}
 
-		ReleaseDC(hWnd, hdc);
+		m_glyphs.clear();
+		m_glyphs.reserve(m_glyphTable.size());
+		for (const GlyphInfo& glyph : m_glyphTable)
+		{
+			m_glyphs.push_back(static_cast<wchar_t>(glyph.codePoint));
+		}
+		return true;
 	}
 
-	std::vector<std::wstring> getGlyphs() const { return m_glyphs; }
+	const GlyphTable& getGlyphTable() const { return m_glyphTable; }
 
-	void setSymbol(std::size_t index) { m_sym = m_glyphs[index]; }
-	std::wstring getSymbol() const { return m_sym; }
+	// one UTF-16 unit per glyph, in code point order; every Leland glyph sits in the BMP's private use area
+	const std::vector<wchar_t>& getGlyphs() const { return m_glyphs; }
+	const ShapeStore& getElements() const { return m_elements; }
+	std::size_t getGlyphCount() const { return m_glyphs.size(); }
+	std::wstring_view getGlyph(std::size_t index) const { return std::wstring_view(&m_glyphs[index], 1); }
+	std::string_view getGlyphName(std::size_t index) const { return m_glyphTable.getName(m_glyphTable[index]); }
 
-	HFONT getLeland() const { return m_leland; }
+	// the outermost elements by their bounds, for exports that read the score an area at a time
+	const SpatialIndex<ShapeHandle>& getIndex() const { return m_index; }
 
-	void selectElement(int x, int y)
+	void setSymbol(std::size_t index)
 	{
-		for (auto& el : m_elements)
+		if (index < m_glyphs.size())
 		{
-			if (el->hitTest(x, y))
+			m_sym = getGlyph(index);
+		}
+	}
+	std::wstring getSymbol() const { return m_sym; }
+
+	void selectElement(float x, float y)
+	{
+		ProfileScope timer("selectElement");
+		m_journal.seal();
+		m_index.query(x, y, m_candidates);
+
+		for (ShapeHandle el : m_candidates)
+		{
+			if (m_elements.hitTest(el, x, y))
 			{
-				m_selected = el.get();
+				m_selected = el;
+				m_dragX = x;
+				m_dragY = y;
+				m_dragStartX = x;
+				m_dragStartY = y;
 				m_isMoving = true;
 				if (m_selected_elements.size() > 0)
 				{
 					m_selected_elements.clear();
 				}
+				updateLive();
 				return;
 			}
 		}
 
 		m_isSelecting = true;
 		m_selected_elements.clear();
+		updateLive();
 	}
 
-	void moveElement(int x, int y)
+	void moveElement(float x, float y)
 	{
-		if (!m_selected->isLocked())
+		if (!m_elements.isLocked(m_selected))
 		{
-			m_selected->move(x, y);
+			m_elements.translate(m_selected, x - m_dragX, y - m_dragY);
+			touchElement(m_selected);
 		} 
-	}
 
-	void dropElement() { m_isMoving = false; }
+		m_dragX = x;
+		m_dragY = y;
+	}
 
-	void selectRect(Graphics& graphics) const
+	// a drag is recorded as one move when the element is let go
+	void dropElement()
 	{
-		Pen selectPen(Color(255, 0, 0, 100), 2.0f);
-		selectPen.SetDashStyle(DashStyleDash);
+		m_isMoving = false;
+
+		if (m_elements.contains(m_selected) && !m_elements.isLocked(m_selected) && (m_dragX != m_dragStartX || m_dragY != m_dragStartY))
+		{
+			m_journal.recordMove({ m_selected }, m_dragX - m_dragStartX, m_dragY - m_dragStartY);
+		}
+	}
 
-		graphics.DrawRectangle(&selectPen, m_origin.X, m_origin.Y, m_current.X - m_origin.X, m_current.Y - m_origin.Y);
+	// the band being dragged out, which the window draws dashed
+	Bounds getSelectRect() const
+	{
+		return Bounds::fromCorner(m_origin.x, m_origin.y, m_current.x - m_origin.x, m_current.y - m_origin.y);
 	}
 
 	void selectElements()
 	{
-		for (auto& el : m_elements)
+		ProfileScope timer("selectElements");
+		Bounds net{ Bounds::fromCorner(m_origin.x, m_origin.y, m_current.x - m_origin.x, m_current.y - m_origin.y) };
+		m_index.query(net, m_candidates);
+
+		for (ShapeHandle el : m_candidates)
 		{
-			if (el->netTest(m_origin, m_current))
+			if (m_elements.isInside(el, net))
 			{
 				m_selected_elements.push_back(el);
 			}
 		}
+		updateLive();
 	}
 
 	void moveElements(DIRECTION direction)
 	{
 		bool elementsAreUnlocked{ false };
 
-		for (auto& el : m_selected_elements)
+		float dx{ direction == LEFT ? -1.0f : direction == RIGHT ? 1.0f : 0.0f };
+		float dy{ direction == UP ? -1.0f : direction == DOWN ? 1.0f : 0.0f };
+
+		std::vector<ShapeHandle> moved;
+		for (ShapeHandle el : m_selected_elements)
 		{
-			if (!el->isLocked())
+			if (!m_elements.isLocked(el))
 			{
 				elementsAreUnlocked = true;
 
-				PointF position{ el->getPosition() };
-				switch (direction)
-				{
-				case LEFT:
-					--position.X;
-					break;
-				case DOWN:
-					++position.Y;
-					break;
-				case RIGHT:
-					++position.X;
-					break;
-				case UP:
-					--position.Y;
-					break;
-				default:
-					return;
-				}
-
-				el->move(position.X, position.Y);
+				m_elements.translate(el, dx, dy);
+				touchElement(el);
+				moved.push_back(el);
 			}
 		}
 
 		if (elementsAreUnlocked)
 		{
+			// a held arrow key repeats and the run is one move; the window ends it at the next fresh press
+			m_journal.recordMove(std::move(moved), dx, dy, true);
+
 			switch (direction)
 			{
 			case LEFT:
-				--m_origin.X;
-				--m_current.X;
+				--m_origin.x;
+				--m_current.x;
 				break;
 			case DOWN:
-				++m_origin.Y;
-				++m_current.Y;
+				++m_origin.y;
+				++m_current.y;
 				break;
 			case RIGHT:
-				++m_origin.X;
-				++m_current.X;
+				++m_origin.x;
+				++m_current.x;
 				break;
 			case UP:
-				--m_origin.Y;
-				--m_current.Y;
+				--m_origin.y;
+				--m_current.y;
 				break;
 			default:
 				return;
@@ -1468,160 +1353,572 @@ public:
 
 	void removeElement()
 	{
-		if (m_selected)
+		if (m_selected != kNoShape)
 		{
-			if (m_elements.size() == 1)
-			{
-				if (!m_elements[0]->isLocked())
-				{
-					m_elements.pop_back();
-					m_selected = NULL;
-				}
-			}
-			else if (!m_selected->isLocked())
+			if (!m_elements.isLocked(m_selected))
 			{
-				// Find the shared_ptr that matches m_selected
-				auto it = std::find_if(m_elements.begin(), m_elements.end(),
-					[this](const std::shared_ptr<Shape>& shape) {
-						return shape.get() == m_selected; // Compare pointers
-					});
-
-				// If found, erase it
-				if (it != m_elements.end())
-				{
-					m_elements.erase(it);
-					m_selected = NULL;
-				}
+				std::vector<ShapeSnapshot> removed;
+				snapshotTree(m_selected, removed);
+				m_journal.recordRemove(std::move(removed));
+				unindexElement(m_selected);
+				m_elements.remove(m_selected);
+				m_selected = kNoShape;
+				updateLive();
 			}
 		}
 		else if (m_selected_elements.size() > 0)
 		{
 			bool elementsAreUnlocked{ false };
 
-			for (auto& selected_el : m_selected_elements)
+			// snapshot them all before the first removal shifts the z positions
+			std::vector<ShapeSnapshot> removed;
+			for (ShapeHandle el : m_selected_elements)
 			{
-				if (!selected_el->isLocked())
+				if (!m_elements.isLocked(el))
 				{
-					elementsAreUnlocked = true;
-
-					auto it = std::find_if(m_elements.begin(), m_elements.end(),
-						[selected_el](const std::shared_ptr<Shape>& shape) {
-							return shape.get() == selected_el.get();
-						});
+					snapshotTree(el, removed);
+				}
+			}
 
-					m_elements.erase(it);
+			// locked elements stay; the rest go in one pass that keeps the survivors' z order
+			std::vector<ShapeHandle> victims;
+			victims.reserve(removed.size());
+			for (const ShapeSnapshot& el : removed)
+			{
+				elementsAreUnlocked = true;
 
-					selected_el = NULL;
-				}
+				damage(el.handle, m_index.boundsOf(el.handle));
+				victims.push_back(el.handle);
 			}
 
 			if (elementsAreUnlocked)
 			{
+				m_index.remove(victims);
+				m_elements.remove(victims);
+				m_journal.recordRemove(std::move(removed));
 				m_selected_elements.clear();
+				updateLive();
 			}
 		}
 	}
 
 	void stopSelecting() { m_isSelecting = false; }
 
-	void setSize(int s)
+	// area covered by the in-progress element and the selection rectangle, which follow the mouse
+	Bounds getOverlayBounds() const
 	{
-		if (m_selected)
+		Bounds overlay{ Bounds::empty() };
+
+		if (m_isDrawing)
 		{
-			if (!m_selected->isLocked())
+			switch (m_element)
+			{
+			case MEASURE:
+			{
+				float xy[4]{ m_origin.x, m_origin.y, m_origin.x + static_cast<int>(m_current.x - m_origin.x), m_origin.y + kStaffHeight };
+				overlay = getShapeBounds(ShapeKind::Measure, xy, 2, 1, 0);
+				break;
+			}
+			case SYMBOL:
 			{
-				m_selected->setWidth(s);
+				int size{ static_cast<int>(m_current.y - m_origin.y) };
+				float xy[4]{ m_origin.x, m_origin.y, m_origin.x + size, m_origin.y + size };
+				overlay = getShapeBounds(ShapeKind::Symbol, xy, 2, 1, m_sym.size());
+				break;
+			}
+			default:
+				break;
 			}
 		}
-		else if (m_selected_elements.size() > 0)
+
+		if (m_element == SELECT)
+		{
+			overlay = overlay.united(Bounds::fromCorner(m_origin.x, m_origin.y, m_current.x - m_origin.x, m_current.y - m_origin.y).inflated(2.0f));
+		}
+
+		return overlay;
+	}
+
+	// hands over the damage recorded since the last call, including where the overlay was and is now
+	void takeDirty(DirtyRegion& dirty)
+	{
+		Bounds overlay{ getOverlayBounds() };
+		m_dirty.add(m_lastOverlay);
+		m_dirty.add(overlay);
+		m_lastOverlay = overlay;
+
+		dirty.add(m_dirty);
+		m_dirty.clear();
+	}
+
+	// hands over the damage to the cached elements since the last call
+	void takeStale(DirtyRegion& stale)
+	{
+		stale.add(m_staticDirty);
+		m_staticDirty.clear();
+	}
+
+	// the size slider calls this as it's dragged; each drag is one edit until endEdit
+	void setSize(int s)
+	{
+		std::vector<ShapeHandle> resized;
+		std::vector<int> before;
+		std::vector<int> after;
+
+		auto resize = [&](ShapeHandle el) {
+			if (!m_elements.isLocked(el))
+			{
+				// a group resizes everything in it
+				m_elements.forEachLeaf(el, [&](ShapeHandle leaf) {
+					before.push_back(m_elements.getWidth(leaf));
+					m_elements.setWidth(leaf, s);
+					after.push_back(s);
+					resized.push_back(leaf);
+				});
+				touchElement(el);
+			}
+		};
+
+		if (m_selected != kNoShape)
+		{
+			resize(m_selected);
+		}
+		else
 		{
-			for (auto& el : m_selected_elements)
+			for (ShapeHandle el : m_selected_elements)
 			{
-				if (!el->isLocked())
-				{
-					el->setWidth(s);
-				}
+				resize(el);
 			}
 		}
+
+		if (!resized.empty())
+		{
+			m_journal.recordResize(std::move(resized), before, after, true);
+		}
 	}
 
 	void lockElement()
 	{
-		if (m_selected)
+		if (m_selected != kNoShape)
 		{
-			m_selected->setLock(true);
+			m_elements.setLocked(m_selected, true);
 		}
 		else if (m_selected_elements.size() > 0)
 		{
-			for (auto& el : m_selected_elements)
+			for (ShapeHandle el : m_selected_elements)
 			{
-				el->setLock(true);
+				m_elements.setLocked(el, true);
 			}
 		}
+		updateLive();
 	}
 
 	void unlockElement()
 	{
-		if (m_selected)
+		if (m_selected != kNoShape)
 		{
-			m_selected->setLock(false);
+			m_elements.setLocked(m_selected, false);
 		}
 		else if (m_selected_elements.size() > 0)
 		{
-			for (auto& el : m_selected_elements)
+			for (ShapeHandle el : m_selected_elements)
+			{
+				m_elements.setLocked(el, false);
+			}
+		}
+		updateLive();
+	}
+
+	// the union of every stored element's bounds
+	Bounds getContentBounds() const
+	{
+		return m_elements.getContentBounds();
+	}
+
+	// groups write what's in them, so only roots are written here
+	void writeElements(DocumentWriter& writer) const
+	{
+		for (std::size_t i{ 0 }; i < m_elements.size(); ++i)
+		{
+			ShapeHandle el{ m_elements.getHandle(i) };
+			if (m_elements.getParent(el) == kNoShape)
+			{
+				m_elements.write(el, writer, DocumentLayer::Score);
+			}
+		}
+	}
+
+	// replaces every stored element, e.g. with the ones from a document that was just opened
+	void setElements(ShapeStore elements)
+	{
+		m_selected = kNoShape;
+		m_selected_elements.clear();
+		updateLive();
+		clearIndex();
+		m_journal.clear();
+
+		m_elements = std::move(elements);
+		for (std::size_t i{ 0 }; i < m_elements.size(); ++i)
+		{
+			ShapeHandle el{ m_elements.getHandle(i) };
+			if (m_elements.getParent(el) == kNoShape)
+			{
+				indexElement(el);
+			}
+		}
+	}
+
+	// puts the unlocked selected elements into one group, which is then what's selected
+	void groupSelected()
+	{
+		std::vector<ShapeHandle> members;
+		for (ShapeHandle el : m_selected_elements)
+		{
+			if (!m_elements.isLocked(el))
 			{
-				el->setLock(false);
+				members.push_back(el);
 			}
 		}
+		if (members.size() < 2)
+		{
+			return;
+		}
+
+		ShapeHandle group{ m_elements.group(members) };
+		shapesGrouped(group, m_elements.getChildren(group));
+		m_journal.recordGroup(snapshotElement(group), m_elements.getChildTransforms(group));
+		m_selected_elements.assign(1, group);
+		updateLive();
+	}
+
+	// dissolves the selected groups, selecting what was in them
+	void ungroupSelected()
+	{
+		std::vector<ShapeHandle> groups;
+		if (m_selected != kNoShape)
+		{
+			groups.push_back(m_selected);
+		}
+		else
+		{
+			groups = m_selected_elements;
+		}
+		groups.erase(std::remove_if(groups.begin(), groups.end(), [this](ShapeHandle el) { return m_elements.isLocked(el) || !m_elements.isGroup(el); }), groups.end());
+		if (groups.empty())
+		{
+			return;
+		}
+
+		std::vector<ShapeSnapshot> snapshots;
+		std::vector<Transform> transforms;
+		std::vector<ShapeHandle> freed;
+		for (ShapeHandle group : groups)
+		{
+			snapshots.push_back(snapshotElement(group));
+			std::vector<Transform> inside{ m_elements.getChildTransforms(group) };
+			transforms.insert(transforms.end(), inside.begin(), inside.end());
+
+			std::vector<ShapeHandle> children{ m_elements.ungroup(group) };
+			shapesUngrouped(group, children);
+			freed.insert(freed.end(), children.begin(), children.end());
+		}
+		fitOrders();
+		m_journal.recordUngroup(std::move(snapshots), std::move(transforms));
+
+		// a band selection keeps what it held; a clicked group is simply gone
+		if (m_selected != kNoShape)
+		{
+			m_selected = kNoShape;
+		}
+		else
+		{
+			m_selected_elements = std::move(freed);
+		}
+		updateLive();
 	}
 
 	void deleteScore()
 	{ 
-		m_elements.clear();
+		m_selected = kNoShape;
+		m_journal.clear();
 		m_selected_elements.clear();
+		updateLive();
+		clearIndex();
+		m_elements.clear();
 	}
 
 private:
-	std::vector<std::shared_ptr<Shape>> m_elements;
-	std::vector<std::shared_ptr<Shape>> m_selected_elements;
-	Shape* m_selected;
+	static constexpr float kStaffHeight{ 28.0f }; // four spaces at the default size
+	static constexpr std::uint32_t kInk{ 0xFF000000 }; // opaque black
+
+	ShapeStore m_elements;
+	EditJournal m_journal;
+	SpatialIndex<ShapeHandle> m_index;
+	std::vector<ShapeHandle> m_unfitted; // roots undo, redo or an ungroup put in the index at provisional orders
+	std::vector<ShapeHandle> m_candidates; // reused query buffer
+	DirtyRegion m_dirty;
+	DirtyRegion m_staticDirty; // the part of m_dirty the cached tiles have to redraw
+	Bounds m_lastOverlay{ Bounds::empty() };
+	std::vector<ShapeHandle> m_selected_elements;
+	std::vector<ShapeHandle> m_live; // the selected unlocked elements, sorted
+	ShapeHandle m_selected{ kNoShape };
+	float m_dragX{ 0.0f }; // where the selected element was last dragged from
+	float m_dragY{ 0.0f };
+	float m_dragStartX{ 0.0f }; // and where the drag began
+	float m_dragStartY{ 0.0f };
 	ELEMENT m_element;
-	PointF m_origin;
-	PointF m_current;
+	RenderPoint m_origin{ 0.0f, 0.0f };
+	RenderPoint m_current{ 0.0f, 0.0f };
 
 	bool m_isDrawing{ false };
 	bool m_isSelecting{ false };
 	bool m_isMoving{ false };
 
-	std::vector<std::wstring> m_glyphs;
+	GlyphTable m_glyphTable;
+	std::vector<wchar_t> m_glyphs;
 	std::wstring m_sym;
-	HFONT m_leland{ nullptr };
 
-	bool isGlyphSupported(HDC hdc, WCHAR ch)
+	template<typename Keep>
+	void drawElementsWhere(RenderBackend& backend, const Bounds& area, Keep&& keep)
+	{
+		m_index.query(area, m_candidates);
+		for (ShapeHandle e : m_candidates)
+		{
+			if (keep(e))
+			{
+				m_elements.render(e, backend);
+			}
+		}
+	}
+
+	bool isLive(ShapeHandle element) const { return std::binary_search(m_live.begin(), m_live.end(), element); }
+
+	// recomputes the live elements after the selection or a lock changes, damaging the tiles under any
+	// that moved between the layers
+	void updateLive()
+	{
+		std::vector<ShapeHandle> live{ m_selected_elements };
+		live.push_back(m_selected);
+		live.erase(std::remove_if(live.begin(), live.end(), [this](ShapeHandle el) { return !m_elements.contains(el) || m_elements.isLocked(el); }), live.end());
+		std::sort(live.begin(), live.end());
+		live.erase(std::unique(live.begin(), live.end()), live.end());
+
+		std::vector<ShapeHandle> moved;
+		std::set_symmetric_difference(live.begin(), live.end(), m_live.begin(), m_live.end(), std::back_inserter(moved));
+		for (ShapeHandle el : moved)
+		{
+			m_staticDirty.add(m_index.boundsOf(el));
+		}
+
+		m_live = std::move(live);
+	}
+
+	// damage from a change to a stored element; the tiles hold only the elements that aren't live
+	void damage(ShapeHandle element, const Bounds& bounds)
+	{
+		m_dirty.add(bounds);
+		if (!isLive(element))
+		{
+			m_staticDirty.add(bounds);
+		}
+	}
+
+	// empties the index, damaging everything that was in it
+	void clearIndex()
+	{
+		Bounds all{ m_elements.getContentBounds() };
+		m_dirty.add(all);
+		m_staticDirty.add(all);
+		m_index.clear();
+	}
+
+	void indexElement(ShapeHandle element)
+	{
+		Bounds bounds{ m_elements.getBounds(element) };
+		m_index.insert(element, bounds);
+		damage(element, bounds);
+	}
+
+	// re-indexes a changed element, damaging both the area it left and the area it now covers; an element
+	// in a group is indexed as its outermost group
+	void touchElement(ShapeHandle element)
+	{
+		element = m_elements.getRoot(element);
+		Bounds bounds{ m_elements.getBounds(element) };
+		damage(element, m_index.boundsOf(element));
+		damage(element, bounds);
+		m_index.update(element, bounds);
+	}
+
+	void unindexElement(ShapeHandle element)
+	{
+		damage(element, m_index.boundsOf(element));
+		m_index.remove(element);
+	}
+
+	// as DRAW_SHAPES::fitOrders: what undo, redo or an ungroup put in the index is fitted between its neighbours
+	void fitOrders()
+	{
+		std::erase_if(m_unfitted, [this](ShapeHandle el) { return !m_elements.contains(el) || m_elements.getParent(el) != kNoShape; });
+		std::sort(m_unfitted.begin(), m_unfitted.end(), [this](ShapeHandle a, ShapeHandle b) { return m_elements.getPosition(a) < m_elements.getPosition(b); });
+		for (std::size_t first{ 0 }; first < m_unfitted.size();)
+		{
+			std::size_t end{ first + 1 };
+			while (end < m_unfitted.size() && m_elements.getAbove(m_unfitted[end - 1]) == m_unfitted[end])
+			{
+				++end;
+			}
+
+			ShapeHandle below{ m_elements.getBelow(m_unfitted[first]) };
+			ShapeHandle above{ m_elements.getAbove(m_unfitted[end - 1]) };
+			if (!m_index.fitBetween(m_unfitted.data() + first, end - first, below != kNoShape ? &below : nullptr, above != kNoShape ? &above : nullptr))
+			{
+				renumberIndex();
+				break;
+			}
+			first = end;
+		}
+		m_unfitted.clear();
+	}
+
+	void renumberIndex()
+	{
+		m_candidates.clear();
+		for (std::size_t i{ 0 }; i < m_elements.size(); ++i)
+		{
+			ShapeHandle el{ m_elements.getHandle(i) };
+			if (m_elements.getParent(el) == kNoShape)
+			{
+				m_candidates.push_back(el);
+			}
+		}
+		m_index.renumber(m_candidates);
+	}
+
+	// indexes an element that was just placed and records it so it can be undone
+	void insertElement(ShapeHandle element)
+	{
+		indexElement(element);
+		m_journal.recordInsert({ snapshotElement(element) });
+	}
+
+	ShapeSnapshot snapshotElement(ShapeHandle element) const
+	{
+		ShapeSnapshot snapshot{ m_elements.snapshot(element) };
+		snapshot.order = m_index.orderOf(element);
+		return snapshot;
+	}
+
+	// snapshots an element and, if it's a group, everything in it, which goes with it when it's removed
+	void snapshotTree(ShapeHandle element, std::vector<ShapeSnapshot>& out) const
+	{
+		out.push_back(snapshotElement(element));
+		if (m_elements.isGroup(element))
+		{
+			std::vector<ShapeHandle> inside;
+			m_elements.getDescendants(element, inside);
+			for (ShapeHandle descendant : inside)
+			{
+				out.push_back(m_elements.snapshot(descendant));
+			}
+		}
+	}
+
+	void unSelect()
+	{
+		m_selected = kNoShape;
+		m_selected_elements.clear();
+		m_isMoving = false;
+		updateLive();
+	}
+
+	void shapeRestored(ShapeHandle element, std::uint64_t order) override
+	{
+		// what's in a group comes back with it
+		if (m_elements.getParent(element) != kNoShape)
+		{
+			return;
+		}
+
+		Bounds bounds{ m_elements.getBounds(element) };
+		m_index.insert(element, bounds, order);
+		damage(element, bounds);
+		m_unfitted.push_back(element);
+	}
+
+	void shapesRemoving(const std::vector<ShapeHandle>& elements) override
+	{
+		for (ShapeHandle element : elements)
+		{
+			damage(element, m_index.boundsOf(element));
+		}
+		m_index.remove(elements);
+	}
+
+	void shapeChanged(ShapeHandle element) override { touchElement(element); }
+
+	void shapesSwapped(ShapeHandle a, ShapeHandle b) override
+	{
+		damage(a, m_index.boundsOf(a));
+		damage(b, m_index.boundsOf(b));
+		m_index.swapOrder(a, b);
+	}
+
+	// the group is indexed in place of its children, at the topmost one's order
+	void shapesGrouped(ShapeHandle group, const std::vector<ShapeHandle>& children) override
+	{
+		std::uint64_t order{ 0 };
+		for (ShapeHandle child : children)
+		{
+			order = (std::max)(order, m_index.orderOf(child));
+			damage(child, m_index.boundsOf(child));
+		}
+		m_index.remove(children);
+
+		Bounds bounds{ m_elements.getBounds(group) };
+		m_index.insert(group, bounds, order);
+		damage(group, bounds);
+	}
+
+	// and the children are indexed in its place, to be fitted between its neighbours once the edit is done
+	void shapesUngrouped(ShapeHandle group, const std::vector<ShapeHandle>& children) override
 	{
-		WORD glyphIndex;
-		GetGlyphIndicesW(hdc, &ch, 1, &glyphIndex, GGI_MARK_NONEXISTING_GLYPHS);
-		return glyphIndex != GDI_ERROR && glyphIndex != 0xFFFF;
+		std::uint64_t order{ m_index.orderOf(group) };
+		damage(group, m_index.boundsOf(group));
+		m_index.remove(group);
+		if (children.empty())
+		{
+			return;
+		}
+
+		for (ShapeHandle child : children)
+		{
+			Bounds bounds{ m_elements.getBounds(child) };
+			m_index.insert(child, bounds, order);
+			damage(child, bounds);
+			m_unfitted.push_back(child);
+		}
 	}
 };
 
-inline void SCORE::drawCurrentElement(Graphics& graphics)
+inline void SCORE::drawCurrentElement(RenderBackend& backend)
 {
 	switch (m_element)
 	{
 	case MEASURE:
 		{
-			Measure m(m_origin, m_current.X - m_origin.X);
-			m.draw(graphics);
+			float xy[4]{ m_origin.x, m_origin.y, m_origin.x + static_cast<int>(m_current.x - m_origin.x), m_origin.y + kStaffHeight };
+			renderShape(backend, ShapeKind::Measure, xy, 2, kInk, 1, false, L"", L"");
 			break;
 		}
 	case SYMBOL:
 		{
-			Symbol s(m_origin, m_current.Y - m_origin.Y, getSymbol());
-			s.draw(graphics);
+			int size{ static_cast<int>(m_current.y - m_origin.y) };
+			float xy[4]{ m_origin.x, m_origin.y, m_origin.x + size, m_origin.y + size };
+			renderShape(backend, ShapeKind::Symbol, xy, 2, kInk, 1, true, getSymbol(), L"");
 			break;
 		}
 	default:
 		break;
 	}
-}
\ No newline at end of file
+}
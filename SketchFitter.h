@@ -0,0 +1,420 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <vector>
+#include "Geometry.h"
+#include "RenderBackend.h"
+
+// Turns a freehand stroke into a few cubic Béziers while it's being drawn. Each stage gets half the tolerance:
+//
+//   1. simplify: a sampled point is kept only once the stroke since the last kept point stops fitting a
+//      straight chord (a streaming Ramer-Douglas-Peucker), so every sample lies within tolerance / 2 of
+//      the kept polyline
+//   2. fit: the kept points after the last settled segment are fitted with one cubic (Schneider's least
+//      squares with Newton reparameterization), which must pass within tolerance / 2 of every point of the
+//      kept polyline, so no sample ends up further than the tolerance from the curve. When a new point
+//      breaks the fit, the last good one is settled and a new segment starts there, leaving the join's
+//      tangent where it was.
+//
+// Settled segments never change, so each sample costs work in the open segment only and a preview only
+// needs to repaint that segment. The curve is laid out as ShapeKind::Curve expects: the start, then two
+// controls and an end per segment.
+class SketchFitter
+{
+public:
+	explicit SketchFitter(float tolerance = 1.0f) : m_tolerance(tolerance) {}
+
+	// the furthest, in pixels, a sampled point may end up from the curve
+	void setTolerance(float tolerance) { m_tolerance = tolerance; }
+	float getTolerance() const { return m_tolerance; }
+
+	void clear()
+	{
+		m_samples = 0;
+		m_run.clear();
+		m_open.clear();
+		m_openFit.clear();
+		m_settled.clear();
+		m_curve.clear();
+		m_hasTangent = false;
+	}
+
+	bool empty() const { return m_samples == 0; }
+
+	// points added so far, and how many the simplifier kept
+	std::size_t getSampleCount() const { return m_samples; }
+	std::size_t getKeptCount() const { return m_kept; }
+
+	void add(float x, float y)
+	{
+		RenderPoint p{ x, y };
+
+		if (m_samples++ == 0)
+		{
+			m_kept = 0;
+			m_anchor = p;
+			keep(p);
+			updateCurve();
+			return;
+		}
+
+		RenderPoint last{ m_run.empty() ? m_anchor : m_run.back() };
+		if (last.x == p.x && last.y == p.y)
+		{
+			return;
+		}
+
+		// the run since the anchor must stay within half the tolerance of the chord to p
+		bool straight{ m_run.size() < kMaxRun };
+		for (std::size_t i{ 0 }; straight && i < m_run.size(); ++i)
+		{
+			straight = distanceToSegment(m_run[i], m_anchor, p) <= simplifyTolerance();
+		}
+
+		if (!straight)
+		{
+			m_anchor = m_run.back();
+			keep(m_anchor);
+			m_run.clear();
+		}
+
+		m_run.push_back(p);
+		updateCurve();
+	}
+
+	// the curve through everything added so far, the open tail fitted provisionally
+	const std::vector<RenderPoint>& getCurve() const { return m_curve; }
+
+	// what the curve covers past the settled segments; only this part changes as points arrive
+	Bounds getOpenBounds() const
+	{
+		Bounds bounds{ Bounds::empty() };
+		std::size_t first{ m_settled.empty() ? 0 : m_settled.size() - 1 };
+		for (std::size_t i{ first }; i < m_curve.size(); ++i)
+		{
+			bounds = bounds.united(Bounds{ m_curve[i].x, m_curve[i].y, m_curve[i].x, m_curve[i].y });
+		}
+		return bounds;
+	}
+
+	// keeps the last sample and settles the rest; the curve stays valid until the next clear or add
+	const std::vector<RenderPoint>& finish()
+	{
+		if (!m_run.empty())
+		{
+			keep(m_run.back());
+			m_run.clear();
+		}
+		settle();
+
+		m_curve = m_settled;
+		if (m_curve.size() == 1)
+		{
+			// a click: one segment that starts and ends in the same place
+			m_curve.assign(4, m_curve[0]);
+		}
+		return m_curve;
+	}
+
+private:
+	static constexpr std::size_t kMaxRun{ 256 }; // samples checked per new point while simplifying
+	static constexpr std::size_t kMaxOpen{ 64 }; // kept points one segment may span
+	static constexpr int kReparameterizations{ 4 };
+
+	float m_tolerance;
+	std::size_t m_samples{ 0 };
+	std::size_t m_kept{ 0 };
+
+	RenderPoint m_anchor{}; // last kept point
+	std::vector<RenderPoint> m_run; // samples since the anchor
+
+	std::vector<RenderPoint> m_open; // kept points from the end of the settled curve on
+	std::vector<RenderPoint> m_openFit; // the cubic through m_open, four points
+	std::vector<RenderPoint> m_settled; // start, then three points per settled segment
+	RenderPoint m_tangent{}; // leaving the settled curve's end, when m_hasTangent
+	bool m_hasTangent{ false };
+
+	std::vector<RenderPoint> m_curve;
+	std::vector<float> m_parameters; // scratch for fitting
+
+	float simplifyTolerance() const { return m_tolerance / 2.0f; }
+	float fitTolerance() const { return m_tolerance / 2.0f; }
+
+	// feeds a point the simplifier kept to the fitter
+	void keep(RenderPoint p)
+	{
+		++m_kept;
+
+		if (m_settled.empty() && m_open.empty())
+		{
+			m_settled.push_back(p);
+			m_open.push_back(p);
+			return;
+		}
+
+		m_open.push_back(p);
+
+		std::vector<RenderPoint> fit;
+		if (m_open.size() <= kMaxOpen && fitOpen(m_open, fit))
+		{
+			m_openFit = std::move(fit);
+			return;
+		}
+
+		// p broke the segment: settle it as it was and start the next from its end
+		m_open.pop_back();
+		settle();
+		m_open.push_back(p);
+		fitOpen(m_open, m_openFit);
+	}
+
+	void settle()
+	{
+		if (m_open.size() < 2)
+		{
+			return;
+		}
+
+		m_settled.insert(m_settled.end(), m_openFit.begin() + 1, m_openFit.end());
+		m_tangent = normalize(m_openFit[3] - m_openFit[2], m_openFit[3] - m_openFit[0]);
+		m_hasTangent = true;
+
+		RenderPoint end{ m_open.back() };
+		m_open.assign(1, end);
+		m_openFit.clear();
+	}
+
+	// fits points with one cubic leaving the settled curve smoothly; two points always fit, if need be with a corner
+	bool fitOpen(const std::vector<RenderPoint>& points, std::vector<RenderPoint>& fit)
+	{
+		RenderPoint chord{ points.back() - points.front() };
+		RenderPoint startTangent{ m_hasTangent ? m_tangent : estimateStartTangent(points) };
+		RenderPoint endTangent{ normalize(points[points.size() - 2] - points.back(), chord * -1.0f) };
+
+		if (fitCubic(points, startTangent, endTangent, fit))
+		{
+			return true;
+		}
+		if (points.size() > 2)
+		{
+			return false;
+		}
+
+		RenderPoint direction{ normalize(chord, RenderPoint{ 1.0f, 0.0f }) };
+		float third{ length(chord) / 3.0f };
+		fit = { points[0], points[0] + direction * third, points[1] - direction * third, points[1] };
+		return true;
+	}
+
+	// settled segments plus a provisional fit of the open points and the latest sample
+	void updateCurve()
+	{
+		m_curve = m_settled;
+
+		std::vector<RenderPoint> tail{ m_open };
+		if (!m_run.empty())
+		{
+			tail.push_back(m_run.back());
+		}
+		if (tail.size() < 2)
+		{
+			return;
+		}
+
+		std::vector<RenderPoint> fit;
+		if (fitOpen(tail, fit))
+		{
+			m_curve.insert(m_curve.end(), fit.begin() + 1, fit.end());
+			return;
+		}
+
+		// the sample doesn't fit the open segment: show that segment, then a straight piece to the sample
+		m_curve.insert(m_curve.end(), m_openFit.begin() + 1, m_openFit.end());
+		RenderPoint from{ m_curve.back() };
+		RenderPoint to{ tail.back() };
+		m_curve.push_back(from + (to - from) * (1.0f / 3.0f));
+		m_curve.push_back(from + (to - from) * (2.0f / 3.0f));
+		m_curve.push_back(to);
+	}
+
+	bool fitCubic(const std::vector<RenderPoint>& points, RenderPoint startTangent, RenderPoint endTangent, std::vector<RenderPoint>& fit)
+	{
+		parameterizeByLength(points);
+		fit = generateBezier(points, startTangent, endTangent);
+
+		float error{ maxError(points, fit) };
+		if (error <= fitTolerance())
+		{
+			return true;
+		}
+		if (error > 4.0f * fitTolerance())
+		{
+			return false;
+		}
+
+		for (int i{ 0 }; i < kReparameterizations; ++i)
+		{
+			reparameterize(points, fit);
+			fit = generateBezier(points, startTangent, endTangent);
+			if (maxError(points, fit) <= fitTolerance())
+			{
+				return true;
+			}
+		}
+		return false;
+	}
+
+	void parameterizeByLength(const std::vector<RenderPoint>& points)
+	{
+		m_parameters.assign(points.size(), 0.0f);
+		for (std::size_t i{ 1 }; i < points.size(); ++i)
+		{
+			m_parameters[i] = m_parameters[i - 1] + length(points[i] - points[i - 1]);
+		}
+
+		float total{ m_parameters.back() };
+		for (float& u : m_parameters)
+		{
+			u = total > 0.0f ? u / total : 0.0f;
+		}
+	}
+
+	// least squares for how far each control sits along its tangent (Schneider, Graphics Gems, 1990)
+	std::vector<RenderPoint> generateBezier(const std::vector<RenderPoint>& points, RenderPoint startTangent, RenderPoint endTangent) const
+	{
+		RenderPoint first{ points.front() };
+		RenderPoint last{ points.back() };
+
+		float c00{ 0.0f };
+		float c01{ 0.0f };
+		float c11{ 0.0f };
+		float x0{ 0.0f };
+		float x1{ 0.0f };
+		for (std::size_t i{ 0 }; i < points.size(); ++i)
+		{
+			float u{ m_parameters[i] };
+			float v{ 1.0f - u };
+			float b0{ v * v * v };
+			float b1{ 3.0f * u * v * v };
+			float b2{ 3.0f * u * u * v };
+			float b3{ u * u * u };
+
+			RenderPoint a1{ startTangent * b1 };
+			RenderPoint a2{ endTangent * b2 };
+			RenderPoint rest{ points[i] - (first * (b0 + b1) + last * (b2 + b3)) };
+
+			c00 += dot(a1, a1);
+			c01 += dot(a1, a2);
+			c11 += dot(a2, a2);
+			x0 += dot(a1, rest);
+			x1 += dot(a2, rest);
+		}
+
+		float chord{ length(last - first) };
+		float determinant{ c00 * c11 - c01 * c01 };
+		float alphaStart{ determinant != 0.0f ? (x0 * c11 - c01 * x1) / determinant : 0.0f };
+		float alphaEnd{ determinant != 0.0f ? (c00 * x1 - c01 * x0) / determinant : 0.0f };
+
+		// a control on or behind its end point is degenerate; fall back to a third of the chord
+		float epsilon{ 1.0e-6f * chord };
+		if (alphaStart < epsilon || alphaEnd < epsilon)
+		{
+			alphaStart = chord / 3.0f;
+			alphaEnd = chord / 3.0f;
+		}
+
+		return { first, first + startTangent * alphaStart, last + endTangent * alphaEnd, last };
+	}
+
+	// one Newton step per point toward the parameter of its nearest point on the curve
+	void reparameterize(const std::vector<RenderPoint>& points, const std::vector<RenderPoint>& bezier)
+	{
+		for (std::size_t i{ 0 }; i < points.size(); ++i)
+		{
+			float u{ m_parameters[i] };
+			RenderPoint offset{ evaluate(bezier, u) - points[i] };
+			RenderPoint d1{ derivative(bezier, u) };
+			RenderPoint d2{ secondDerivative(bezier, u) };
+
+			float numerator{ dot(offset, d1) };
+			float denominator{ dot(d1, d1) + dot(offset, d2) };
+			if (denominator != 0.0f)
+			{
+				m_parameters[i] = (std::clamp)(u - numerator / denominator, 0.0f, 1.0f);
+			}
+		}
+	}
+
+	// a bound on the worst miss anywhere along the edges between the points. Along an edge the miss is the
+	// straight edge less the curve over the edge's parameters, so it strays from the misses at the edge's ends
+	// by at most the curve's largest second derivative there times the parameter span squared over 8. The
+	// second derivative is linear in u, so its largest is at one end of the span.
+	float maxError(const std::vector<RenderPoint>& points, const std::vector<RenderPoint>& bezier) const
+	{
+		float worst{ 0.0f };
+		float previousMiss{ 0.0f };
+		float previousBend{ 0.0f };
+		for (std::size_t i{ 0 }; i < points.size(); ++i)
+		{
+			float u{ m_parameters[i] };
+			float miss{ length(evaluate(bezier, u) - points[i]) };
+			float bend{ length(secondDerivative(bezier, u)) };
+			worst = (std::max)(worst, miss);
+			if (i > 0)
+			{
+				float span{ u - m_parameters[i - 1] };
+				worst = (std::max)(worst, (std::max)(previousMiss, miss) + (std::max)(previousBend, bend) * span * span / 8.0f);
+			}
+			previousMiss = miss;
+			previousBend = bend;
+		}
+		return worst;
+	}
+
+	static RenderPoint estimateStartTangent(const std::vector<RenderPoint>& points)
+	{
+		return normalize(points[1] - points[0], RenderPoint{ 1.0f, 0.0f });
+	}
+
+	static RenderPoint evaluate(const std::vector<RenderPoint>& b, float u)
+	{
+		float v{ 1.0f - u };
+		return b[0] * (v * v * v) + b[1] * (3.0f * u * v * v) + b[2] * (3.0f * u * u * v) + b[3] * (u * u * u);
+	}
+
+	static RenderPoint derivative(const std::vector<RenderPoint>& b, float u)
+	{
+		float v{ 1.0f - u };
+		return (b[1] - b[0]) * (3.0f * v * v) + (b[2] - b[1]) * (6.0f * u * v) + (b[3] - b[2]) * (3.0f * u * u);
+	}
+
+	static RenderPoint secondDerivative(const std::vector<RenderPoint>& b, float u)
+	{
+		return (b[2] - b[1] * 2.0f + b[0]) * (6.0f * (1.0f - u)) + (b[3] - b[2] * 2.0f + b[1]) * (6.0f * u);
+	}
+
+	static float distanceToSegment(RenderPoint p, RenderPoint a, RenderPoint b)
+	{
+		RenderPoint ab{ b - a };
+		float span{ dot(ab, ab) };
+		float t{ span > 0.0f ? (std::clamp)(dot(p - a, ab) / span, 0.0f, 1.0f) : 0.0f };
+		return length(p - (a + ab * t));
+	}
+
+	static float dot(RenderPoint a, RenderPoint b) { return a.x * b.x + a.y * b.y; }
+	static float length(RenderPoint a) { return std::hypot(a.x, a.y); }
+
+	// v scaled to length 1, or fallback's direction when v is too short to have one
+	static RenderPoint normalize(RenderPoint v, RenderPoint fallback)
+	{
+		float size{ length(v) };
+		if (size > 1.0e-6f)
+		{
+			return v * (1.0f / size);
+		}
+		float other{ length(fallback) };
+		return other > 1.0e-6f ? fallback * (1.0f / other) : RenderPoint{ 1.0f, 0.0f };
+	}
+};
@@ -0,0 +1,417 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include "Geometry.h"
+
+// Uniform grid over item bounds. Point and rectangle queries only visit the cells they cover,
+// and results come back in insertion (z) order so callers can keep "first hit wins" semantics.
+// Items are small hashable keys, such as shape handles. Orders are handed out kOrderGap apart, so items
+// put back between others can be fitted into the gap without renumbering the rest.
+template <typename T>
+class SpatialIndex
+{
+public:
+	static constexpr std::uint64_t kOrderGap{ 1u << 20 };
+
+	explicit SpatialIndex(float cellSize = 128.0f) : m_cellSize(cellSize) {}
+
+	void insert(T item, const Bounds& bounds)
+	{
+		Entry entry{ bounds, m_nextOrder };
+		m_nextOrder += kOrderGap;
+		setCells(entry, bounds);
+		link(item, entry);
+		m_entries.emplace(item, entry);
+	}
+
+	// inserts at a given place in query order, e.g. one that orderOf returned before the item was removed
+	void insert(T item, const Bounds& bounds, std::uint64_t order)
+	{
+		Entry entry{ bounds, order };
+		setCells(entry, bounds);
+		link(item, entry);
+		m_entries.emplace(item, entry);
+		m_nextOrder = (std::max)(m_nextOrder, order + kOrderGap);
+	}
+
+	void update(T item, const Bounds& bounds)
+	{
+		auto it = m_entries.find(item);
+		if (it == m_entries.end())
+		{
+			insert(item, bounds);
+			return;
+		}
+
+		Entry moved{ it->second };
+		moved.bounds = bounds;
+		setCells(moved, bounds);
+
+		// small moves usually stay within the same cells
+		if (moved.large == it->second.large && moved.x0 == it->second.x0 && moved.y0 == it->second.y0 && moved.x1 == it->second.x1 && moved.y1 == it->second.y1)
+		{
+			it->second.bounds = bounds;
+			return;
+		}
+
+		unlink(item, it->second);
+		link(item, moved);
+		it->second = moved;
+	}
+
+	void remove(T item)
+	{
+		auto it = m_entries.find(item);
+		if (it != m_entries.end())
+		{
+			unlink(item, it->second);
+			m_entries.erase(it);
+		}
+	}
+
+	// Removes many items, sweeping each cell they were in once rather than once per item, so clearing a
+	// big selection out of a crowded area stays linear.
+	void remove(const std::vector<T>& items)
+	{
+		m_touched.clear();
+		bool large{ false };
+		for (T item : items)
+		{
+			auto it = m_entries.find(item);
+			if (it == m_entries.end())
+			{
+				continue;
+			}
+
+			const Entry& entry{ it->second };
+			if (entry.large)
+			{
+				large = true;
+			}
+			else
+			{
+				for (int cy{ entry.y0 }; cy <= entry.y1; ++cy)
+				{
+					for (int cx{ entry.x0 }; cx <= entry.x1; ++cx)
+					{
+						m_touched.push_back(key(cx, cy));
+					}
+				}
+			}
+			m_entries.erase(it);
+		}
+
+		std::sort(m_touched.begin(), m_touched.end());
+		m_touched.erase(std::unique(m_touched.begin(), m_touched.end()), m_touched.end());
+
+		auto gone = [this](T item) { return m_entries.find(item) == m_entries.end(); };
+		for (std::uint64_t touched : m_touched)
+		{
+			auto cell = m_cells.find(touched);
+			if (cell != m_cells.end())
+			{
+				cell->second.erase(std::remove_if(cell->second.begin(), cell->second.end(), gone), cell->second.end());
+				if (cell->second.empty())
+				{
+					m_cells.erase(cell);
+				}
+			}
+		}
+		if (large)
+		{
+			m_large.erase(std::remove_if(m_large.begin(), m_large.end(), gone), m_large.end());
+		}
+	}
+
+	// Gives count items, bottom first, orders spread evenly between below's and above's, so they sort between
+	// the two and nothing else's order changes, e.g. shapes put back by undo or a group's children taking its
+	// place. below and above are null at the bottom and the top. False, changing nothing, when the gap is too
+	// narrow for them all; renumber then.
+	bool fitBetween(const T* items, std::size_t count, const T* below, const T* above)
+	{
+		std::uint64_t low{ below ? orderOf(*below) : 0 };
+		if (!above)
+		{
+			low = (std::max)(low, m_nextOrder);
+		}
+		std::uint64_t high{ above ? orderOf(*above) : low + (count + 1) * kOrderGap };
+		if (high <= low || high - low <= count)
+		{
+			return false;
+		}
+
+		std::uint64_t step{ (high - low) / (count + 1) };
+		for (std::size_t k{ 0 }; k < count; ++k)
+		{
+			auto it = m_entries.find(items[k]);
+			if (it != m_entries.end())
+			{
+				it->second.order = low + step * (k + 1);
+			}
+		}
+		m_nextOrder = (std::max)(m_nextOrder, low + step * count + kOrderGap);
+		return true;
+	}
+
+	// gives the items orders kOrderGap apart as listed, bottom first; for putting the owner's z order back
+	// once there's no gap left to fit items into. Items that aren't indexed are skipped.
+	void renumber(const std::vector<T>& items)
+	{
+		std::uint64_t order{ kOrderGap };
+		for (T item : items)
+		{
+			auto it = m_entries.find(item);
+			if (it != m_entries.end())
+			{
+				it->second.order = order;
+				order += kOrderGap;
+			}
+		}
+		m_nextOrder = order;
+	}
+
+	// keeps query order in step with a z-order swap in the owning vector
+	void swapOrder(T a, T b)
+	{
+		auto itA = m_entries.find(a);
+		auto itB = m_entries.find(b);
+		if (itA != m_entries.end() && itB != m_entries.end())
+		{
+			std::swap(itA->second.order, itB->second.order);
+		}
+	}
+
+	void clear()
+	{
+		m_cells.clear();
+		m_large.clear();
+		m_entries.clear();
+		m_nextOrder = kOrderGap;
+	}
+
+	std::size_t size() const { return m_entries.size(); }
+
+	// bounds the item was last indexed with, or empty if it isn't indexed
+	Bounds boundsOf(T item) const
+	{
+		auto it = m_entries.find(item);
+		return it != m_entries.end() ? it->second.bounds : Bounds::empty();
+	}
+
+	// where the item sorts in query results, or 0 if it isn't indexed
+	std::uint64_t orderOf(T item) const
+	{
+		auto it = m_entries.find(item);
+		return it != m_entries.end() ? it->second.order : 0;
+	}
+
+	// items whose bounds contain (x, y), bottom-most first
+	void query(float x, float y, std::vector<T>& out) const
+	{
+		out.clear();
+
+		// a point off the grid can only be inside large items
+		double cx{ cellAt(x) };
+		double cy{ cellAt(y) };
+		if (onGrid(cx) && onGrid(cy))
+		{
+			auto cell = m_cells.find(key(static_cast<int>(cx), static_cast<int>(cy)));
+			if (cell != m_cells.end())
+			{
+				for (T item : cell->second)
+				{
+					if (m_entries.at(item).bounds.contains(x, y))
+					{
+						out.push_back(item);
+					}
+				}
+			}
+		}
+
+		for (T item : m_large)
+		{
+			if (m_entries.at(item).bounds.contains(x, y))
+			{
+				out.push_back(item);
+			}
+		}
+
+		sortByOrder(out);
+	}
+
+	// items whose bounds intersect area, bottom-most first
+	void query(const Bounds& area, std::vector<T>& out) const
+	{
+		out.clear();
+
+		double x0{ cellAt(area.left) };
+		double y0{ cellAt(area.top) };
+		double x1{ cellAt(area.right) };
+		double y1{ cellAt(area.bottom) };
+
+		if (!onGrid(x0) || !onGrid(y0) || !onGrid(x1) || !onGrid(y1) || (x1 - x0 + 1) * (y1 - y0 + 1) > static_cast<double>(m_cells.size()))
+		{
+			// the area covers more cells than are occupied, or reaches off the grid; walk the occupied ones instead
+			for (const auto& cell : m_cells)
+			{
+				collect(cell.second, area, out);
+			}
+		}
+		else
+		{
+			for (int cy{ static_cast<int>(y0) }; cy <= static_cast<int>(y1); ++cy)
+			{
+				for (int cx{ static_cast<int>(x0) }; cx <= static_cast<int>(x1); ++cx)
+				{
+					auto cell = m_cells.find(key(cx, cy));
+					if (cell != m_cells.end())
+					{
+						collect(cell->second, area, out);
+					}
+				}
+			}
+		}
+
+		collect(m_large, area, out);
+
+		// items spanning several cells were collected once per cell
+		std::sort(out.begin(), out.end());
+		out.erase(std::unique(out.begin(), out.end()), out.end());
+
+		sortByOrder(out);
+	}
+
+private:
+	struct Entry
+	{
+		Bounds bounds;
+		std::uint64_t order;
+		int x0{ 0 };
+		int y0{ 0 };
+		int x1{ 0 };
+		int y1{ 0 };
+		bool large{ false };
+	};
+
+	// items covering more cells than this live in a side list that every query scans
+	static constexpr int kMaxCells{ 64 };
+
+	// cell coordinates beyond this either way are off the grid, so they always fit in an int
+	static constexpr double kMaxCell{ 1 << 30 };
+
+	float m_cellSize;
+	std::uint64_t m_nextOrder{ kOrderGap }; // orders start a gap up, so there's room to fit items under the first
+	std::unordered_map<std::uint64_t, std::vector<T>> m_cells;
+	std::vector<T> m_large;
+	std::unordered_map<T, Entry> m_entries;
+	std::vector<std::uint64_t> m_touched; // reused by batch remove
+
+	// in double, so coordinates that are huge, infinite or NaN can be caught before they become ints
+	double cellAt(float v) const { return std::floor(static_cast<double>(v) / m_cellSize); }
+
+	// false for NaN too
+	static bool onGrid(double cell) { return cell >= -kMaxCell && cell <= kMaxCell; }
+
+	static std::uint64_t key(int cx, int cy)
+	{
+		return (static_cast<std::uint64_t>(static_cast<std::uint32_t>(cx)) << 32) | static_cast<std::uint32_t>(cy);
+	}
+
+	void setCells(Entry& entry, const Bounds& bounds) const
+	{
+		double x0{ cellAt(bounds.left) };
+		double y0{ cellAt(bounds.top) };
+		double x1{ cellAt(bounds.right) };
+		double y1{ cellAt(bounds.bottom) };
+
+		// bounds off the grid go in the side list, where nothing walks their cells
+		entry.large = !onGrid(x0) || !onGrid(y0) || !onGrid(x1) || !onGrid(y1) || (x1 - x0 + 1) * (y1 - y0 + 1) > kMaxCells;
+		if (entry.large)
+		{
+			entry.x0 = entry.y0 = entry.x1 = entry.y1 = 0;
+			return;
+		}
+
+		entry.x0 = static_cast<int>(x0);
+		entry.y0 = static_cast<int>(y0);
+		entry.x1 = static_cast<int>(x1);
+		entry.y1 = static_cast<int>(y1);
+	}
+
+	void link(T item, const Entry& entry)
+	{
+		if (entry.large)
+		{
+			m_large.push_back(item);
+			return;
+		}
+
+		for (int cy{ entry.y0 }; cy <= entry.y1; ++cy)
+		{
+			for (int cx{ entry.x0 }; cx <= entry.x1; ++cx)
+			{
+				m_cells[key(cx, cy)].push_back(item);
+			}
+		}
+	}
+
+	void unlink(T item, const Entry& entry)
+	{
+		if (entry.large)
+		{
+			eraseFrom(m_large, item);
+			return;
+		}
+
+		for (int cy{ entry.y0 }; cy <= entry.y1; ++cy)
+		{
+			for (int cx{ entry.x0 }; cx <= entry.x1; ++cx)
+			{
+				auto cell = m_cells.find(key(cx, cy));
+				if (cell != m_cells.end())
+				{
+					eraseFrom(cell->second, item);
+					if (cell->second.empty())
+					{
+						m_cells.erase(cell);
+					}
+				}
+			}
+		}
+	}
+
+	static void eraseFrom(std::vector<T>& items, T item)
+	{
+		// cell order doesn't matter, so swap-and-pop
+		auto it = std::find(items.begin(), items.end(), item);
+		if (it != items.end())
+		{
+			*it = items.back();
+			items.pop_back();
+		}
+	}
+
+	void collect(const std::vector<T>& items, const Bounds& area, std::vector<T>& out) const
+	{
+		for (T item : items)
+		{
+			if (m_entries.at(item).bounds.intersects(area))
+			{
+				out.push_back(item);
+			}
+		}
+	}
+
+	void sortByOrder(std::vector<T>& items) const
+	{
+		std::sort(items.begin(), items.end(), [this](T a, T b) {
+			return m_entries.at(a).order < m_entries.at(b).order;
+		});
+	}
+};
@@ -0,0 +1,105 @@
+#pragma once
+
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+// How a shape is painted. Shapes refer to one by StyleId rather than carrying their own copy.
+struct ShapeStyle
+{
+	std::uint32_t color{ 0xFF000000 }; // ARGB
+	int stroke{ 1 };
+	bool filled{ false };
+};
+
+using StyleId = std::uint32_t;
+constexpr StyleId kNoStyle{ 0xFFFFFFFF };
+
+// Every distinct style in use, stored once and reference counted. Restyling a thousand shapes to the
+// same color adds one entry and drops the ones nothing uses any more, so a palette slider dragged over
+// a big selection costs a hash lookup per shape instead of an allocation. Ids of dropped styles are
+// reused; getRevision tells a cache keyed by id that its entry now means something else.
+class StyleTable
+{
+public:
+	// the id of style, adding it if it's new; the caller owns one reference
+	StyleId intern(const ShapeStyle& style)
+	{
+		std::uint64_t key{ keyOf(style) };
+		auto found = m_ids.find(key);
+		if (found != m_ids.end())
+		{
+			++m_entries[found->second].references;
+			return found->second;
+		}
+
+		StyleId id;
+		if (!m_free.empty())
+		{
+			id = m_free.back();
+			m_free.pop_back();
+		}
+		else
+		{
+			id = static_cast<StyleId>(m_entries.size());
+			m_entries.emplace_back();
+		}
+
+		Entry& entry{ m_entries[id] };
+		entry.style = style;
+		entry.references = 1;
+		m_ids.emplace(key, id);
+		return id;
+	}
+
+	void retain(StyleId id) { ++m_entries[id].references; }
+
+	void release(StyleId id)
+	{
+		Entry& entry{ m_entries[id] };
+		if (--entry.references == 0)
+		{
+			m_ids.erase(keyOf(entry.style));
+			++entry.revision;
+			m_free.push_back(id);
+		}
+	}
+
+	const ShapeStyle& get(StyleId id) const { return m_entries[id].style; }
+
+	std::uint32_t getRevision(StyleId id) const { return m_entries[id].revision; }
+
+	// how many shapes, snapshots and edits hold the style
+	std::uint32_t getReferences(StyleId id) const { return m_entries[id].references; }
+
+	// styles with at least one reference
+	std::size_t size() const { return m_ids.size(); }
+
+	// one past the highest id handed out so far
+	std::size_t capacity() const { return m_entries.size(); }
+
+private:
+	struct Entry
+	{
+		ShapeStyle style;
+		std::uint32_t references{ 0 };
+		std::uint32_t revision{ 0 };
+	};
+
+	std::vector<Entry> m_entries;
+	std::vector<StyleId> m_free;
+	std::unordered_map<std::uint64_t, StyleId> m_ids;
+
+	static std::uint64_t keyOf(const ShapeStyle& style)
+	{
+		// stroke widths are small, so 31 bits of it and the fill flag share the low word
+		return (static_cast<std::uint64_t>(style.color) << 32) | ((static_cast<std::uint32_t>(style.stroke) & 0x7FFFFFFF) << 1) | (style.filled ? 1u : 0u);
+	}
+};
+
+// the table every ShapeStore draws its styles from, so the drawing and the score share entries
+inline StyleTable& shapeStyles()
+{
+	static StyleTable styles;
+	return styles;
+}
@@ -0,0 +1,451 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include "VectorBackend.h"
+
+// Writes each page as its own SVG file: the first to the path given to open(), later ones beside it
+// as name-2.svg, name-3.svg and so on. Elements go straight to the file as they are drawn. A Leland glyph's
+// outline is written into the page's <defs> the first time the page uses it, so each file carries only
+// the glyphs it shows.
+class SvgBackend : public VectorBackend
+{
+public:
+	explicit SvgBackend(GlyphOutlines* leland) : VectorBackend(leland) {}
+
+	bool open(const std::filesystem::path& path)
+	{
+		m_path = path;
+		m_pages = 0;
+		return !path.empty();
+	}
+
+	bool beginPage(float left, float top, float width, float height) override
+	{
+		std::filesystem::path pagePath{ m_path };
+		if (++m_pages > 1)
+		{
+			std::filesystem::path name{ m_path.stem() };
+			name += "-" + std::to_string(m_pages);
+			name += m_path.extension();
+			pagePath.replace_filename(name);
+		}
+
+		m_out.open(pagePath, std::ios::binary | std::ios::trunc);
+		if (!m_out)
+		{
+			return false;
+		}
+
+		m_pageGlyphs.clear();
+		m_transformed = false;
+		m_line.clear();
+		m_line += "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n<svg xmlns=\"http://www.w3.org/2000/svg\" xmlns:xlink=\"http://www.w3.org/1999/xlink\" width=\"";
+		appendNumber(m_line, width);
+		m_line += "\" height=\"";
+		appendNumber(m_line, height);
+		m_line += "\" viewBox=\"";
+		appendNumber(m_line, left);
+		m_line += ' ';
+		appendNumber(m_line, top);
+		m_line += ' ';
+		appendNumber(m_line, width);
+		m_line += ' ';
+		appendNumber(m_line, height);
+		m_line += "\">\n<rect x=\"";
+		appendNumber(m_line, left);
+		m_line += "\" y=\"";
+		appendNumber(m_line, top);
+		m_line += "\" width=\"100%\" height=\"100%\" fill=\"#ffffff\"/>\n";
+		flush();
+		return static_cast<bool>(m_out);
+	}
+
+	bool endPage() override
+	{
+		setTransform(Transform{});
+		m_out << "</svg>\n";
+		bool written{ static_cast<bool>(m_out) };
+		m_out.close();
+		return written && !m_out.fail();
+	}
+
+	bool finish() override { return m_pages > 0; }
+
+	void drawLine(float x1, float y1, float x2, float y2, std::uint32_t color, float width) override
+	{
+		m_line += "<line x1=\"";
+		appendNumber(m_line, x1);
+		m_line += "\" y1=\"";
+		appendNumber(m_line, y1);
+		m_line += "\" x2=\"";
+		appendNumber(m_line, x2);
+		m_line += "\" y2=\"";
+		appendNumber(m_line, y2);
+		m_line += '"';
+		appendPaint(color, width, false);
+		m_line += "/>\n";
+		flush();
+	}
+
+	void drawRect(float x, float y, float width, float height, std::uint32_t color, float penWidth, bool filled) override
+	{
+		m_line += "<rect x=\"";
+		appendNumber(m_line, width < 0 ? x + width : x);
+		m_line += "\" y=\"";
+		appendNumber(m_line, height < 0 ? y + height : y);
+		m_line += "\" width=\"";
+		appendNumber(m_line, std::fabs(width));
+		m_line += "\" height=\"";
+		appendNumber(m_line, std::fabs(height));
+		m_line += '"';
+		appendPaint(color, penWidth, filled);
+		m_line += "/>\n";
+		flush();
+	}
+
+	void drawEllipse(float x, float y, float width, float height, std::uint32_t color, float penWidth, bool filled) override
+	{
+		m_line += "<ellipse cx=\"";
+		appendNumber(m_line, x + width / 2.0f);
+		m_line += "\" cy=\"";
+		appendNumber(m_line, y + height / 2.0f);
+		m_line += "\" rx=\"";
+		appendNumber(m_line, std::fabs(width) / 2.0f);
+		m_line += "\" ry=\"";
+		appendNumber(m_line, std::fabs(height) / 2.0f);
+		m_line += '"';
+		appendPaint(color, penWidth, filled);
+		m_line += "/>\n";
+		flush();
+	}
+
+	void drawPolygon(const RenderPoint* points, std::size_t count, std::uint32_t color, float penWidth, bool filled) override
+	{
+		m_line += "<polygon points=\"";
+		for (std::size_t i{ 0 }; i < count; ++i)
+		{
+			if (i > 0)
+			{
+				m_line += ' ';
+			}
+			appendNumber(m_line, points[i].x);
+			m_line += ',';
+			appendNumber(m_line, points[i].y);
+		}
+		m_line += '"';
+		appendPaint(color, penWidth, filled);
+		m_line += "/>\n";
+		flush();
+	}
+
+	void drawCurve(const RenderPoint* points, std::size_t count, std::uint32_t color, float penWidth) override
+	{
+		if (count < 2)
+		{
+			return;
+		}
+
+		m_line += "<path d=\"M";
+		appendPoint(points[0]);
+		for (std::size_t i{ 0 }; i + 1 < count; ++i)
+		{
+			RenderPoint c1;
+			RenderPoint c2;
+			getCurveControls(points, count, i, c1, c2);
+
+			m_line += 'C';
+			appendPoint(c1);
+			m_line += ' ';
+			appendPoint(c2);
+			m_line += ' ';
+			appendPoint(points[i + 1]);
+
+			if (m_line.size() > kFlushSize) // long sketches go out in pieces
+			{
+				flush();
+			}
+		}
+		m_line += '"';
+		appendPaint(color, penWidth, false);
+		m_line += "/>\n";
+		flush();
+	}
+
+	void drawBeziers(const RenderPoint* points, std::size_t count, std::uint32_t color, float penWidth) override
+	{
+		if (count < 4)
+		{
+			return;
+		}
+
+		m_line += "<path d=\"M";
+		appendPoint(points[0]);
+		for (std::size_t i{ 1 }; i + 2 < count; i += 3)
+		{
+			m_line += 'C';
+			appendPoint(points[i]);
+			m_line += ' ';
+			appendPoint(points[i + 1]);
+			m_line += ' ';
+			appendPoint(points[i + 2]);
+
+			if (m_line.size() > kFlushSize)
+			{
+				flush();
+			}
+		}
+		m_line += '"';
+		appendPaint(color, penWidth, false);
+		m_line += "/>\n";
+		flush();
+	}
+
+	void drawText(const std::wstring& text, float x, float y, const std::wstring& family, float size, std::uint32_t color) override
+	{
+		if (usesLeland(family))
+		{
+			layoutLeland(text, x, y, size, [&](std::uint16_t glyph, float originX, float baseline, float scale) {
+				defineGlyph(glyph);
+
+				m_line += "<use xlink:href=\"#g";
+				m_line += std::to_string(glyph);
+				m_line += "\" transform=\"matrix(";
+				appendNumber(m_line, scale);
+				m_line += " 0 0 ";
+				appendNumber(m_line, -scale);
+				m_line += ' ';
+				appendNumber(m_line, originX);
+				m_line += ' ';
+				appendNumber(m_line, baseline);
+				m_line += ")\"";
+				appendFill(color);
+				m_line += "/>\n";
+				flush();
+			});
+			return;
+		}
+
+		m_line += "<text x=\"";
+		appendNumber(m_line, x);
+		m_line += "\" y=\"";
+		appendNumber(m_line, getPlainBaseline(y, size));
+		m_line += "\" font-family=\"";
+		appendEscaped(family);
+		m_line += "\" font-size=\"";
+		appendNumber(m_line, std::fabs(size));
+		m_line += '"';
+		appendFill(color);
+		m_line += " xml:space=\"preserve\">";
+		appendEscaped(text);
+		m_line += "</text>\n";
+		flush();
+	}
+
+	// transformed shapes go in a group of their own
+	void setTransform(const Transform& transform) override
+	{
+		if (m_transformed)
+		{
+			m_line += "</g>\n";
+			m_transformed = false;
+		}
+		if (!transform.isIdentity())
+		{
+			m_line += "<g transform=\"matrix(";
+			appendNumber(m_line, transform.a, kFactorDecimals);
+			m_line += ' ';
+			appendNumber(m_line, transform.b, kFactorDecimals);
+			m_line += ' ';
+			appendNumber(m_line, transform.c, kFactorDecimals);
+			m_line += ' ';
+			appendNumber(m_line, transform.d, kFactorDecimals);
+			m_line += ' ';
+			appendNumber(m_line, transform.tx);
+			m_line += ' ';
+			appendNumber(m_line, transform.ty);
+			m_line += ")\">\n";
+			m_transformed = true;
+		}
+		flush();
+	}
+
+private:
+	static constexpr std::size_t kFlushSize{ 64 * 1024 };
+
+	std::filesystem::path m_path;
+	int m_pages{ 0 };
+	std::ofstream m_out;
+	std::string m_line; // the element being written
+	std::unordered_map<std::uint16_t, std::string> m_glyphPaths; // outlines already converted, by glyph
+	std::unordered_set<std::uint16_t> m_pageGlyphs; // defined in the current file
+	bool m_transformed{ false }; // inside a <g> that setTransform opened
+
+	// path data in font units, y up
+	class PathSink : public OutlineSink
+	{
+	public:
+		explicit PathSink(std::string& out) : m_out(out) {}
+
+		void moveTo(float x, float y) override { command('M', &x, &y, 1); }
+		void lineTo(float x, float y) override { command('L', &x, &y, 1); }
+
+		void cubicTo(float x1, float y1, float x2, float y2, float x, float y) override
+		{
+			float xs[3]{ x1, x2, x };
+			float ys[3]{ y1, y2, y };
+			command('C', xs, ys, 3);
+		}
+
+		void closePath() override { m_out += 'Z'; }
+
+	private:
+		std::string& m_out;
+
+		void command(char verb, const float* xs, const float* ys, int count)
+		{
+			m_out += verb;
+			for (int i{ 0 }; i < count; ++i)
+			{
+				if (i > 0)
+				{
+					m_out += ' ';
+				}
+				appendNumber(m_out, xs[i]);
+				m_out += ' ';
+				appendNumber(m_out, ys[i]);
+			}
+		}
+	};
+
+	void flush()
+	{
+		m_out.write(m_line.data(), static_cast<std::streamsize>(m_line.size()));
+		m_line.clear();
+	}
+
+	void defineGlyph(std::uint16_t glyph)
+	{
+		if (!m_pageGlyphs.insert(glyph).second)
+		{
+			return;
+		}
+
+		auto& path = m_glyphPaths[glyph];
+		if (path.empty())
+		{
+			PathSink sink(path);
+			m_leland->getOutline(glyph, sink);
+		}
+
+		m_line += "<defs><path id=\"g";
+		m_line += std::to_string(glyph);
+		m_line += "\" d=\"";
+		m_line += path;
+		m_line += "\"/></defs>\n";
+	}
+
+	void appendPoint(const RenderPoint& point)
+	{
+		appendNumber(m_line, point.x);
+		m_line += ' ';
+		appendNumber(m_line, point.y);
+	}
+
+	void appendColor(std::uint32_t color)
+	{
+		char hex[8];
+		std::snprintf(hex, sizeof(hex), "#%02x%02x%02x", getRed(color), getGreen(color), getBlue(color));
+		m_line += hex;
+	}
+
+	void appendFill(std::uint32_t color)
+	{
+		m_line += " fill=\"";
+		appendColor(color);
+		m_line += '"';
+		if ((color >> 24) != 0xFF)
+		{
+			m_line += " fill-opacity=\"";
+			appendNumber(m_line, getAlpha(color));
+			m_line += '"';
+		}
+	}
+
+	// filled shapes are painted without an outline, like GDI+'s Fill calls
+	void appendPaint(std::uint32_t color, float width, bool filled)
+	{
+		if (filled)
+		{
+			appendFill(color);
+			return;
+		}
+
+		m_line += " fill=\"none\" stroke=\"";
+		appendColor(color);
+		m_line += "\" stroke-width=\"";
+		appendNumber(m_line, width);
+		m_line += '"';
+		if ((color >> 24) != 0xFF)
+		{
+			m_line += " stroke-opacity=\"";
+			appendNumber(m_line, getAlpha(color));
+			m_line += '"';
+		}
+	}
+
+	// as UTF-8, with XML's special characters escaped
+	void appendEscaped(const std::wstring& text)
+	{
+		for (std::size_t i{ 0 }; i < text.size(); ++i)
+		{
+			std::uint32_t cp{ static_cast<std::uint32_t>(text[i]) };
+			if (cp >= 0xD800 && cp < 0xDC00 && i + 1 < text.size())
+			{
+				cp = 0x10000 + ((cp - 0xD800) << 10) + (static_cast<std::uint32_t>(text[i + 1]) - 0xDC00);
+				++i;
+			}
+
+			switch (cp)
+			{
+			case '<': m_line += "&lt;"; continue;
+			case '>': m_line += "&gt;"; continue;
+			case '&': m_line += "&amp;"; continue;
+			case '"': m_line += "&quot;"; continue;
+			default: break;
+			}
+
+			if (cp < 0x20 && cp != '\t' && cp != '\n' && cp != '\r')
+			{
+				continue; // not allowed in XML 1.0
+			}
+
+			if (cp < 0x80)
+			{
+				m_line += static_cast<char>(cp);
+			}
+			else if (cp < 0x800)
+			{
+				m_line += static_cast<char>(0xC0 | (cp >> 6));
+				m_line += static_cast<char>(0x80 | (cp & 0x3F));
+			}
+			else if (cp < 0x10000)
+			{
+				m_line += static_cast<char>(0xE0 | (cp >> 12));
+				m_line += static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+				m_line += static_cast<char>(0x80 | (cp & 0x3F));
+			}
+			else
+			{
+				m_line += static_cast<char>(0xF0 | (cp >> 18));
+				m_line += static_cast<char>(0x80 | ((cp >> 12) & 0x3F));
+				m_line += static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+				m_line += static_cast<char>(0x80 | (cp & 0x3F));
+			}
+		}
+	}
+};
@@ -0,0 +1,221 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <list>
+#include <unordered_map>
+#include "Geometry.h"
+
+// Raster tiles of the static layer, on a fixed grid anchored at the canvas origin. Tiles are kept most
+// recently used first under a memory budget; once a new tile would go over it, the least recently used
+// tile is handed out again under the new key, surface and all, so steady-state painting allocates nothing.
+// Surface is whatever holds the pixels, e.g. a std::unique_ptr<Bitmap>; the cache never looks inside it.
+template<typename Surface>
+class TileCache
+{
+public:
+	struct Tile
+	{
+		int column;
+		int row;
+		Surface surface;
+		bool valid; // false until the surface has been drawn since the tile was last invalidated
+		std::uint64_t revision; // changes whenever the tile is invalidated or handed to another key, never repeating
+	};
+
+	explicit TileCache(int tileSize = 256, std::size_t budget = 64u << 20) : m_tileSize(tileSize), m_budget(budget) {}
+
+	int getTileSize() const { return m_tileSize; }
+
+	// pixels are 32-bit
+	std::size_t getTileBytes() const { return static_cast<std::size_t>(m_tileSize) * m_tileSize * 4; }
+
+	Bounds getTileBounds(int column, int row) const
+	{
+		return Bounds{ static_cast<float>(column) * m_tileSize, static_cast<float>(row) * m_tileSize,
+			static_cast<float>(column + 1) * m_tileSize, static_cast<float>(row + 1) * m_tileSize };
+	}
+
+	// the tile, now the most recently used. If it isn't valid, the caller draws its surface and sets valid;
+	// a surface that's still empty, e.g. a null pointer, has to be created first.
+	Tile& get(int column, int row)
+	{
+		std::uint64_t key{ keyOf(column, row) };
+
+		auto found = m_lookup.find(key);
+		if (found != m_lookup.end())
+		{
+			m_tiles.splice(m_tiles.begin(), m_tiles, found->second); // mark most recently used
+			if (found->second->valid)
+			{
+				++m_hits;
+			}
+			else
+			{
+				++m_misses;
+			}
+			return *found->second;
+		}
+
+		++m_misses;
+
+		if (!m_tiles.empty() && (m_tiles.size() + 1) * getTileBytes() > m_budget)
+		{
+			// reuse the least recently used tile's surface rather than freeing one and allocating another
+			m_lookup.erase(keyOf(m_tiles.back().column, m_tiles.back().row));
+			m_tiles.splice(m_tiles.begin(), m_tiles, std::prev(m_tiles.end()));
+			++m_evictions;
+		}
+		else
+		{
+			m_tiles.emplace_front(Tile{ column, row, Surface{}, false, 0 });
+		}
+
+		Tile& tile{ m_tiles.front() };
+		tile.column = column;
+		tile.row = row;
+		tile.valid = false;
+		tile.revision = ++m_revision;
+		m_lookup.emplace(key, m_tiles.begin());
+		return tile;
+	}
+
+	// the tile if it's cached, without marking it used; for results that arrive after the tile was asked for
+	Tile* find(int column, int row)
+	{
+		auto found = m_lookup.find(keyOf(column, row));
+		return found != m_lookup.end() ? &*found->second : nullptr;
+	}
+
+	// calls visit(tile) for each tile overlapping area, a row at a time; area's right and bottom edges are
+	// exclusive, as a RECT's are. Tiles are fetched one by one, so a budget smaller than the area still
+	// works; it just redraws tiles it has to evict.
+	template<typename Visit>
+	void forEachTile(const Bounds& area, Visit&& visit)
+	{
+		if (area.isEmpty())
+		{
+			return;
+		}
+
+		int left{ cellOf(area.left) };
+		int top{ cellOf(area.top) };
+		int right{ (std::max)(left, toCell(std::ceil(static_cast<double>(area.right) / m_tileSize) - 1.0)) };
+		int bottom{ (std::max)(top, toCell(std::ceil(static_cast<double>(area.bottom) / m_tileSize) - 1.0)) };
+		for (int row{ top }; row <= bottom; ++row)
+		{
+			for (int column{ left }; column <= right; ++column)
+			{
+				visit(get(column, row));
+			}
+		}
+	}
+
+	// marks the tiles overlapping area as needing a redraw; they keep their surfaces for it
+	void invalidate(const Bounds& area)
+	{
+		if (area.isEmpty())
+		{
+			return;
+		}
+
+		int left{ cellOf(area.left) };
+		int top{ cellOf(area.top) };
+		int right{ cellOf(area.right) };
+		int bottom{ cellOf(area.bottom) };
+
+		// damage as big as a document would mean millions of lookups; walking the cached tiles is cheaper then
+		double covered{ (static_cast<double>(right) - left + 1) * (static_cast<double>(bottom) - top + 1) };
+		if (covered > static_cast<double>(m_tiles.size()))
+		{
+			for (Tile& tile : m_tiles)
+			{
+				if (tile.column >= left && tile.column <= right && tile.row >= top && tile.row <= bottom)
+				{
+					invalidate(tile);
+				}
+			}
+			return;
+		}
+
+		for (int row{ top }; row <= bottom; ++row)
+		{
+			for (int column{ left }; column <= right; ++column)
+			{
+				auto found = m_lookup.find(keyOf(column, row));
+				if (found != m_lookup.end())
+				{
+					invalidate(*found->second);
+				}
+			}
+		}
+	}
+
+	void invalidateAll()
+	{
+		for (Tile& tile : m_tiles)
+		{
+			invalidate(tile);
+		}
+	}
+
+	void setBudget(std::size_t budget)
+	{
+		m_budget = budget;
+		while (!m_tiles.empty() && m_tiles.size() * getTileBytes() > m_budget)
+		{
+			m_lookup.erase(keyOf(m_tiles.back().column, m_tiles.back().row));
+			m_tiles.pop_back();
+			++m_evictions;
+		}
+	}
+
+	std::size_t getBudget() const { return m_budget; }
+	std::size_t getBytes() const { return m_tiles.size() * getTileBytes(); }
+
+	// a hit is a valid tile; a miss is one that had to be drawn
+	std::size_t getHits() const { return m_hits; }
+	std::size_t getMisses() const { return m_misses; }
+	std::size_t getEvictions() const { return m_evictions; }
+	std::size_t size() const { return m_tiles.size(); }
+
+	// frees every surface; for GDI+ bitmaps this must run before GdiplusShutdown
+	void clear()
+	{
+		m_lookup.clear();
+		m_tiles.clear();
+	}
+
+private:
+	int m_tileSize;
+	std::size_t m_budget;
+	std::list<Tile> m_tiles; // most recently used first
+	std::unordered_map<std::uint64_t, typename std::list<Tile>::iterator> m_lookup;
+
+	std::size_t m_hits{ 0 };
+	std::size_t m_misses{ 0 };
+	std::size_t m_evictions{ 0 };
+	std::uint64_t m_revision{ 0 };
+
+	void invalidate(Tile& tile)
+	{
+		tile.valid = false;
+		tile.revision = ++m_revision;
+	}
+
+	// tiles this far from the origin are never on screen; clamping keeps huge and NaN coordinates in an int
+	static constexpr double kMaxCell{ 1 << 30 };
+
+	int cellOf(float coordinate) const { return toCell(std::floor(static_cast<double>(coordinate) / m_tileSize)); }
+
+	// NaN fails the first comparison and lands at the far top left
+	static int toCell(double cell) { return cell >= -kMaxCell ? static_cast<int>((std::min)(cell, kMaxCell)) : static_cast<int>(-kMaxCell); }
+
+	static std::uint64_t keyOf(int column, int row)
+	{
+		return (static_cast<std::uint64_t>(static_cast<std::uint32_t>(column)) << 32) | static_cast<std::uint32_t>(row);
+	}
+};
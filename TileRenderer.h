@@ -0,0 +1,203 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include "DisplayList.h"
+#include "Geometry.h"
+#include "GlyphOutlines.h"
+#include "Profiler.h"
+#include "RasterBackend.h"
+#include "WorkStealingPool.h"
+
+// What's recorded after a text command the workers can't draw, up to the next one: the UI thread draws the
+// text, then blends the layer over it, so the tile keeps the scene's z order.
+struct TileOverlay
+{
+	std::size_t text; // the text command, in the scene
+	std::vector<std::uint32_t> pixels; // premultiplied ARGB over transparency, size by size; empty if nothing reached the tile
+};
+
+// a tile drawn off the UI thread, waiting to be copied into the tile cache
+struct RenderedTile
+{
+	int column;
+	int row;
+	std::uint64_t revision; // the cache's revision of the tile when it was asked for
+	float zoom;
+	int size;
+	std::vector<std::uint32_t> pixels; // premultiplied ARGB, size by size; everything under the first overlay's text
+	std::vector<TileOverlay> overlays; // bottom first
+	std::shared_ptr<const DisplayList> scene; // what it was drawn from
+};
+
+// Draws tiles of a recorded scene on a work-stealing pool. The UI thread asks for tiles and later takes
+// the finished ones; it never waits on a worker. Each tile is one task drawing the whole tile from the
+// scene in recorded order, so its pixels come out the same whichever thread draws it and however many
+// threads there are. Workers draw with their own RasterBackend and font outlines, which aren't shared.
+// Those are only Leland's, so a tile with text in other fonts comes in layers split at that text, for the
+// UI thread to draw it between them.
+class TileRenderer
+{
+public:
+	// onFinished is called from a worker when a tile is ready and none were waiting; it should only post a message
+	TileRenderer(std::filesystem::path fontPath, std::function<void()> onFinished, std::size_t threads = 0)
+		: m_fontPath(std::move(fontPath)), m_onFinished(std::move(onFinished)), m_pool(threads)
+	{
+	}
+
+	std::size_t getThreadCount() const { return m_pool.getThreadCount(); }
+
+	// true if that revision of the tile has been asked for and not yet taken
+	bool isPending(int column, int row, std::uint64_t revision) const
+	{
+		auto found = m_pending.find(keyOf(column, row));
+		return found != m_pending.end() && found->second == revision;
+	}
+
+	std::size_t getPendingCount() const { return m_pending.size(); }
+
+	// draws tile (column, row) of the grid of size-pixel tiles over the canvas scaled by zoom
+	void request(int column, int row, std::uint64_t revision, int size, float zoom, std::shared_ptr<const DisplayList> scene)
+	{
+		m_pending[keyOf(column, row)] = revision;
+		m_pool.submit([this, column, row, revision, size, zoom, scene = std::move(scene)]() mutable {
+			RenderedTile tile{ column, row, revision, zoom, size, {}, {}, std::move(scene) };
+			bool drawn{ true };
+			try
+			{
+				draw(tile);
+			}
+			catch (...)
+			{
+				// e.g. out of memory for the surface; the tile stops being pending and the next repaint asks again
+				drawn = false;
+				tile.pixels.clear();
+				tile.overlays.clear();
+				m_failedCount.fetch_add(1, std::memory_order_relaxed);
+			}
+
+			bool notify;
+			{
+				std::lock_guard<std::mutex> lock(m_mutex);
+				notify = m_finished.empty() && m_failed.empty();
+				(drawn ? m_finished : m_failed).push_back(std::move(tile));
+			}
+			if (notify && m_onFinished)
+			{
+				m_onFinished();
+			}
+		});
+	}
+
+	// moves the finished tiles into out, oldest first; tiles whose drawing threw are dropped, and no longer pending
+	void takeFinished(std::vector<RenderedTile>& out)
+	{
+		std::vector<RenderedTile> failed;
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			for (RenderedTile& tile : m_finished)
+			{
+				out.push_back(std::move(tile));
+			}
+			m_finished.clear();
+			failed.swap(m_failed);
+		}
+
+		for (const std::vector<RenderedTile>* taken : { &out, &failed })
+		{
+			for (const RenderedTile& tile : *taken)
+			{
+				// a newer revision may have been asked for since; that one is still pending
+				auto found = m_pending.find(keyOf(tile.column, tile.row));
+				if (found != m_pending.end() && found->second == tile.revision)
+				{
+					m_pending.erase(found);
+				}
+			}
+		}
+	}
+
+	// tiles whose drawing threw, since the renderer was made
+	std::size_t getFailedCount() const { return m_failedCount.load(std::memory_order_relaxed); }
+
+	// blocks until every tile asked for has been drawn; for callers without a message loop
+	void wait() { m_pool.wait(); }
+
+	// the canvas area tile (column, row) shows at zoom; in float, as a tile far out or huge overflows int
+	static Bounds getCanvasBounds(int column, int row, int size, float zoom)
+	{
+		float left{ static_cast<float>(column) * static_cast<float>(size) };
+		float top{ static_cast<float>(row) * static_cast<float>(size) };
+		return Bounds{ left / zoom, top / zoom, (left + static_cast<float>(size)) / zoom, (top + static_cast<float>(size)) / zoom };
+	}
+
+private:
+	std::filesystem::path m_fontPath;
+	std::function<void()> m_onFinished;
+	std::unordered_map<std::uint64_t, std::uint64_t> m_pending; // tile to revision; UI thread only
+
+	std::mutex m_mutex; // guards m_finished and m_failed
+	std::vector<RenderedTile> m_finished;
+	std::vector<RenderedTile> m_failed;
+	std::atomic<std::size_t> m_failedCount{ 0 };
+
+	WorkStealingPool m_pool; // last, so its threads are joined before the rest goes
+
+	void draw(RenderedTile& tile) const
+	{
+		ProfileScope timer("drawTile");
+
+		// each worker thread keeps its own outlines and surface for as long as it lives
+		thread_local GlyphOutlines leland;
+		thread_local RasterBackend backend(&leland);
+		if (!leland.isOpen())
+		{
+			leland.open(m_fontPath);
+		}
+
+		thread_local std::vector<std::size_t> texts;
+
+		float offsetX{ static_cast<float>(tile.column) * tile.size };
+		float offsetY{ static_cast<float>(tile.row) * tile.size };
+		Bounds area{ getCanvasBounds(tile.column, tile.row, tile.size, tile.zoom) };
+		tile.scene->findPlainText(area, texts);
+
+		backend.resize(tile.size, tile.size);
+		backend.clear(0xFFFFFFFF);
+		backend.setView(Transform::scaling(tile.zoom, tile.zoom, 0.0f, 0.0f).then(Transform::translation(-offsetX, -offsetY)));
+		tile.scene->replay(backend, area, 0, texts.empty() ? tile.scene->size() : texts.front());
+		takePixels(backend, tile.size, tile.pixels);
+
+		// the layer above each text runs to the next one, or to the top
+		for (std::size_t k{ 0 }; k < texts.size(); ++k)
+		{
+			std::size_t last{ k + 1 < texts.size() ? texts[k + 1] : tile.scene->size() };
+			TileOverlay& overlay{ tile.overlays.emplace_back() };
+			overlay.text = texts[k];
+			backend.clear(0x00000000);
+			if (tile.scene->replay(backend, area, texts[k] + 1, last) > 0)
+			{
+				takePixels(backend, tile.size, overlay.pixels);
+			}
+		}
+	}
+
+	static void takePixels(const RasterBackend& backend, int size, std::vector<std::uint32_t>& out)
+	{
+		const std::uint32_t* pixels{ backend.getPixels() };
+		out.assign(pixels, pixels + static_cast<std::size_t>(size) * size);
+	}
+
+	static std::uint64_t keyOf(int column, int row)
+	{
+		return (static_cast<std::uint64_t>(static_cast<std::uint32_t>(column)) << 32) | static_cast<std::uint32_t>(row);
+	}
+};
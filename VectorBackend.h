@@ -0,0 +1,93 @@
+#pragma once
+
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include "GlyphOutlines.h"
+#include "RenderBackend.h"
+
+// What the page backends share: number formatting for SVG and PDF, the Bézier form of GDI+'s curves,
+// and laying out Leland text the way DrawString does so exported glyphs land where they were on screen.
+class VectorBackend : public PageBackend
+{
+public:
+	// leland may be null or unopened, in which case Leland text is written as plain text
+	explicit VectorBackend(GlyphOutlines* leland) : m_leland(leland) {}
+
+protected:
+	GlyphOutlines* m_leland;
+
+	// Two decimals is a hundredth of a pixel, finer than either format needs for coordinates. Scale and
+	// rotation factors multiply whole coordinates, so they are written with more.
+	static void appendNumber(std::string& out, float value, int decimals = 2)
+	{
+		char buffer[48];
+		int length{ std::snprintf(buffer, sizeof(buffer), "%.*f", decimals, static_cast<double>(value)) };
+		while (length > 0 && buffer[length - 1] == '0')
+		{
+			--length;
+		}
+		if (length > 0 && buffer[length - 1] == '.')
+		{
+			--length;
+		}
+		if (length == 2 && buffer[0] == '-' && buffer[1] == '0')
+		{
+			out += '0';
+			return;
+		}
+		out.append(buffer, static_cast<std::size_t>(length));
+	}
+
+	static constexpr int kFactorDecimals{ 6 }; // for the scale and rotation part of a transform
+
+	static float getAlpha(std::uint32_t color) { return static_cast<float>(color >> 24) / 255.0f; }
+	static int getRed(std::uint32_t color) { return (color >> 16) & 0xFF; }
+	static int getGreen(std::uint32_t color) { return (color >> 8) & 0xFF; }
+	static int getBlue(std::uint32_t color) { return color & 0xFF; }
+
+	// control points of segment i of a cardinal spline, matching GDI+'s DrawCurve at tension 0.5
+	static void getCurveControls(const RenderPoint* points, std::size_t count, std::size_t i, RenderPoint& c1, RenderPoint& c2)
+	{
+		constexpr float kScale{ 0.5f / 3.0f };
+
+		const RenderPoint& before{ points[i == 0 ? 0 : i - 1] };
+		const RenderPoint& from{ points[i] };
+		const RenderPoint& to{ points[i + 1] };
+		const RenderPoint& after{ points[i + 2 < count ? i + 2 : count - 1] };
+
+		c1 = RenderPoint{ from.x + (to.x - before.x) * kScale, from.y + (to.y - before.y) * kScale };
+		c2 = RenderPoint{ to.x - (after.x - from.x) * kScale, to.y - (after.y - from.y) * kScale };
+	}
+
+	bool usesLeland(const std::wstring& family) const { return family == L"Leland" && m_leland && m_leland->isOpen(); }
+
+	// Calls place(glyph, x, baseline, scale) for each glyph of a Leland string. DrawString pads the line
+	// by a sixth of an em and puts the baseline one cell ascent below the layout point.
+	template<typename Place>
+	void layoutLeland(const std::wstring& text, float x, float y, float size, Place&& place)
+	{
+		float em{ std::fabs(size) };
+		float scale{ em / static_cast<float>(m_leland->getUnitsPerEm()) };
+		float penX{ x + em / 6.0f };
+		float baseline{ y + static_cast<float>(m_leland->getAscender()) * scale };
+
+		for (std::size_t i{ 0 }; i < text.size(); ++i)
+		{
+			std::uint32_t codePoint{ static_cast<std::uint32_t>(text[i]) };
+			if (codePoint >= 0xD800 && codePoint < 0xDC00 && i + 1 < text.size()) // a surrogate pair, where wchar_t is UTF-16
+			{
+				codePoint = 0x10000 + ((codePoint - 0xD800) << 10) + (static_cast<std::uint32_t>(text[i + 1]) - 0xDC00);
+				++i;
+			}
+
+			std::uint16_t glyph{ m_leland->getGlyph(codePoint) };
+			place(glyph, penX, baseline, scale);
+			penX += static_cast<float>(m_leland->getAdvance(glyph)) * scale;
+		}
+	}
+
+	// other fonts aren't embedded; their text is placed on an Arial-like baseline at 0.905 em
+	static float getPlainBaseline(float y, float size) { return y + std::fabs(size) * 0.905f; }
+};
@@ -0,0 +1,73 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include "Geometry.h"
+
+// The window's view of the canvas. A canvas point p shows at window point p * zoom - offset, and the
+// offset is kept to whole pixels so the static layer's tiles, laid out over the zoomed canvas, land on
+// pixel boundaries however far the view is panned.
+class Viewport
+{
+public:
+	static constexpr float kMinZoom{ 0.05f };
+	static constexpr float kMaxZoom{ 8.0f };
+
+	float getZoom() const { return m_zoom; }
+	float getOffsetX() const { return m_offsetX; }
+	float getOffsetY() const { return m_offsetY; }
+
+	// maps canvas pixels to window pixels
+	Transform getTransform() const { return Transform{ m_zoom, 0.0f, 0.0f, m_zoom, -m_offsetX, -m_offsetY }; }
+
+	float toCanvasX(float x) const { return (x + m_offsetX) / m_zoom; }
+	float toCanvasY(float y) const { return (y + m_offsetY) / m_zoom; }
+
+	Bounds toCanvas(const Bounds& window) const
+	{
+		return window.isEmpty() ? window : Bounds{ toCanvasX(window.left), toCanvasY(window.top), toCanvasX(window.right), toCanvasY(window.bottom) };
+	}
+
+	Bounds toWindow(const Bounds& canvas) const { return getTransform().map(canvas); }
+
+	// the zoomed canvas, where the tiles are laid out, is the window shifted by the offset
+	Bounds toZoomed(const Bounds& window) const { return window.translated(m_offsetX, m_offsetY); }
+	Bounds fromZoomed(const Bounds& zoomed) const { return toCanvas(zoomed.translated(-m_offsetX, -m_offsetY)); }
+
+	// moves the canvas by (dx, dy) window pixels
+	void pan(float dx, float dy)
+	{
+		m_offsetX = std::round(m_offsetX - dx);
+		m_offsetY = std::round(m_offsetY - dy);
+	}
+
+	// zooms by factor, keeping the canvas point under window point (x, y) where it is; false if the zoom
+	// was already at its limit
+	bool zoomAbout(float factor, float x, float y)
+	{
+		float zoom{ (std::clamp)(m_zoom * factor, kMinZoom, kMaxZoom) };
+		if (zoom == m_zoom)
+		{
+			return false;
+		}
+
+		float canvasX{ toCanvasX(x) };
+		float canvasY{ toCanvasY(y) };
+		m_zoom = zoom;
+		m_offsetX = std::round(canvasX * m_zoom - x);
+		m_offsetY = std::round(canvasY * m_zoom - y);
+		return true;
+	}
+
+	void reset()
+	{
+		m_zoom = 1.0f;
+		m_offsetX = 0.0f;
+		m_offsetY = 0.0f;
+	}
+
+private:
+	float m_zoom{ 1.0f };
+	float m_offsetX{ 0.0f };
+	float m_offsetY{ 0.0f };
+};
@@ -0,0 +1,187 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Runs tasks on a fixed set of worker threads. Each worker has its own queue: submitted tasks are dealt
+// round the queues, a worker takes the newest task from its own, and a worker whose queue is empty steals
+// the oldest task from the others, so a few slow tasks don't leave the rest of the pool idle. Tasks run in
+// no particular order; anything that must come out the same every time has to be decided inside the task.
+class WorkStealingPool
+{
+public:
+	// threads 0 means one per core but the caller's
+	explicit WorkStealingPool(std::size_t threads = 0)
+	{
+		if (threads == 0)
+		{
+			unsigned cores{ std::thread::hardware_concurrency() };
+			threads = cores > 1 ? cores - 1 : 1;
+		}
+
+		for (std::size_t i{ 0 }; i < threads; ++i)
+		{
+			m_queues.push_back(std::make_unique<Queue>());
+		}
+		for (std::size_t i{ 0 }; i < threads; ++i)
+		{
+			m_threads.emplace_back([this, i] { run(i); });
+		}
+	}
+
+	// tasks that haven't started are dropped; running ones finish first
+	~WorkStealingPool()
+	{
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_stopping = true;
+		}
+		m_wake.notify_all();
+		for (std::thread& thread : m_threads)
+		{
+			thread.join();
+		}
+	}
+
+	WorkStealingPool(const WorkStealingPool&) = delete;
+	WorkStealingPool& operator=(const WorkStealingPool&) = delete;
+
+	std::size_t getThreadCount() const { return m_threads.size(); }
+
+	void submit(std::function<void()> task)
+	{
+		// unfinished before it's queued, so wait() can't miss it; announced after, so a worker woken for it
+		// finds it there
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			++m_unfinished;
+		}
+
+		Queue& queue{ *m_queues[m_next.fetch_add(1, std::memory_order_relaxed) % m_queues.size()] };
+		{
+			std::lock_guard<std::mutex> lock(queue.mutex);
+			queue.tasks.push_back(std::move(task));
+		}
+
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			++m_submitted;
+		}
+		m_wake.notify_one();
+	}
+
+	// Blocks until every task submitted so far has run; not for the UI thread. If any of them threw, the
+	// first exception is rethrown here, once the rest have run.
+	void wait()
+	{
+		std::unique_lock<std::mutex> lock(m_mutex);
+		m_idle.wait(lock, [this] { return m_unfinished == 0; });
+		if (m_error)
+		{
+			std::exception_ptr error{ std::move(m_error) };
+			m_error = nullptr;
+			std::rethrow_exception(error);
+		}
+	}
+
+private:
+	struct Queue
+	{
+		std::mutex mutex;
+		std::deque<std::function<void()>> tasks;
+	};
+
+	std::vector<std::unique_ptr<Queue>> m_queues;
+	std::vector<std::thread> m_threads;
+	std::atomic<std::size_t> m_next{ 0 }; // the queue the next task goes to; tasks submit too, so workers race for it
+
+	std::mutex m_mutex; // guards the counts, m_error and m_stopping
+	std::condition_variable m_wake;
+	std::condition_variable m_idle;
+	std::size_t m_submitted{ 0 }; // tasks put in a queue so far; a worker sleeps until it changes
+	std::size_t m_unfinished{ 0 }; // submitted, not yet run
+	std::exception_ptr m_error; // the first exception a task threw since the last wait()
+	bool m_stopping{ false };
+
+	// the newest task in worker self's queue, or else the oldest in the next queue that has one
+	bool take(std::size_t self, std::function<void()>& task)
+	{
+		for (std::size_t i{ 0 }; i < m_queues.size(); ++i)
+		{
+			Queue& queue{ *m_queues[(self + i) % m_queues.size()] };
+			std::lock_guard<std::mutex> lock(queue.mutex);
+			if (queue.tasks.empty())
+			{
+				continue;
+			}
+
+			if (i == 0)
+			{
+				task = std::move(queue.tasks.back());
+				queue.tasks.pop_back();
+			}
+			else
+			{
+				task = std::move(queue.tasks.front());
+				queue.tasks.pop_front();
+			}
+			return true;
+		}
+		return false;
+	}
+
+	void run(std::size_t self)
+	{
+		for (;;)
+		{
+			// read before looking, so a task queued after the look still wakes this worker
+			std::size_t seen;
+			{
+				std::lock_guard<std::mutex> lock(m_mutex);
+				seen = m_submitted;
+			}
+
+			std::function<void()> task;
+			if (take(self, task))
+			{
+				// a task that throws still counts as run, or wait() would never return
+				std::exception_ptr error;
+				try
+				{
+					task();
+				}
+				catch (...)
+				{
+					error = std::current_exception();
+				}
+
+				std::lock_guard<std::mutex> lock(m_mutex);
+				if (error && !m_error)
+				{
+					m_error = std::move(error);
+				}
+				if (--m_unfinished == 0)
+				{
+					m_idle.notify_all();
+				}
+				continue;
+			}
+
+			std::unique_lock<std::mutex> lock(m_mutex);
+			m_wake.wait(lock, [this, seen] { return m_stopping || m_submitted != seen; });
+			if (m_stopping)
+			{
+				return;
+			}
+		}
+	}
+};
@@ -0,0 +1,573 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <istream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// one name="value" on a start tag, its value with entities already replaced
+struct XmlAttribute
+{
+	std::string_view name;
+	std::string_view value;
+};
+
+// a start tag's attributes; good until the handler returns
+class XmlAttributes
+{
+public:
+	explicit XmlAttributes(const std::vector<XmlAttribute>& attributes) : m_attributes(attributes) {}
+
+	// the value, or empty if the tag doesn't have it
+	std::string_view get(std::string_view name) const
+	{
+		for (const XmlAttribute& attribute : m_attributes)
+		{
+			if (attribute.name == name)
+			{
+				return attribute.value;
+			}
+		}
+		return {};
+	}
+
+	std::size_t size() const { return m_attributes.size(); }
+	const XmlAttribute& operator[](std::size_t index) const { return m_attributes[index]; }
+
+private:
+	const std::vector<XmlAttribute>& m_attributes;
+};
+
+// What XmlReader reports as it goes; the views are only good until the call returns
+class XmlHandler
+{
+public:
+	virtual ~XmlHandler() = default;
+
+	virtual void startElement(std::string_view name, const XmlAttributes& attributes) = 0;
+	virtual void endElement(std::string_view name) = 0;
+
+	// text between tags, entities replaced and CDATA as is; one run of text may come in several calls
+	virtual void characters(std::string_view text) = 0;
+};
+
+// A streaming XML parser: it reads a chunk at a time and reports each tag and run of text as it reaches it,
+// without building a tree, so a file of any size takes the chunk plus the longest single tag in memory.
+// It reads UTF-8 (or ASCII) documents, skips the prolog, comments, processing instructions and the DTD,
+// and checks that tags nest. It doesn't validate. The five predefined entities and decimal or hex character
+// references are replaced; other entities, and references past U+10FFFF, are left as written.
+class XmlReader
+{
+public:
+	explicit XmlReader(std::size_t chunkSize = 64u << 10) : m_chunkSize(chunkSize < 64 ? 64 : chunkSize) {}
+
+	bool parse(const std::filesystem::path& path, XmlHandler& handler)
+	{
+		std::ifstream in(path, std::ios::binary);
+		if (!in)
+		{
+			return fail("can't open the file");
+		}
+		return parse(in, handler);
+	}
+
+	// false, with getError saying why and getOffset where, if the document isn't well formed
+	bool parse(std::istream& in, XmlHandler& handler)
+	{
+		m_in = &in;
+		m_buffer.assign(m_chunkSize, '\0');
+		m_begin = 0;
+		m_end = 0;
+		m_consumed = 0;
+		m_atEnd = false;
+		m_openNames.clear();
+		m_openStarts.clear();
+		m_error = nullptr;
+		bool sawRoot{ false };
+
+		if (!fill(4))
+		{
+			return fail("the file is empty");
+		}
+		if (m_end >= 2 && ((m_buffer[0] == '\xFF' && m_buffer[1] == '\xFE') || (m_buffer[0] == '\xFE' && m_buffer[1] == '\xFF')))
+		{
+			return fail("UTF-16 documents aren't supported");
+		}
+		if (m_end >= 3 && std::memcmp(m_buffer.data(), "\xEF\xBB\xBF", 3) == 0)
+		{
+			m_begin = 3;
+		}
+
+		while (m_begin < m_end || fill(1))
+		{
+			if (m_buffer[m_begin] != '<')
+			{
+				// text runs to the next tag, so an entity is never cut in two; only whitespace may sit outside the root
+				std::size_t next{ findMore("<", m_begin) };
+				std::size_t stop{ next == std::string::npos ? m_end : next };
+				std::string_view text{ &m_buffer[m_begin], stop - m_begin };
+				if (m_openStarts.empty())
+				{
+					if (text.find_first_not_of(" \t\r\n") != std::string_view::npos)
+					{
+						return fail("text outside the root element");
+					}
+				}
+				else
+				{
+					handler.characters(decode(text, m_text));
+				}
+				m_begin = stop;
+				continue;
+			}
+
+			// enough to tell what kind of markup it is, if the file has that much left
+			fill(9);
+			std::string_view at{ &m_buffer[m_begin], m_end - m_begin };
+			if (at.size() < 2)
+			{
+				return fail("the file ends inside a tag");
+			}
+
+			if (at[1] == '?')
+			{
+				if (!skipPast("?>"))
+				{
+					return false;
+				}
+			}
+			else if (at.substr(0, 4) == "<!--")
+			{
+				if (!skipPast("-->"))
+				{
+					return false;
+				}
+			}
+			else if (at.substr(0, 9) == "<![CDATA[")
+			{
+				std::size_t stop{ findMore("]]>", m_begin + 9) };
+				if (stop == std::string::npos)
+				{
+					return fail("the file ends inside CDATA");
+				}
+				if (m_openStarts.empty())
+				{
+					return fail("CDATA outside the root element");
+				}
+				handler.characters(std::string_view(&m_buffer[m_begin + 9], stop - m_begin - 9));
+				m_begin = stop + 3;
+			}
+			else if (at[1] == '!')
+			{
+				if (!skipDeclaration())
+				{
+					return false;
+				}
+			}
+			else if (at[1] == '/')
+			{
+				std::size_t stop{ findMore(">", m_begin) };
+				if (stop == std::string::npos)
+				{
+					return fail("the file ends inside a tag");
+				}
+
+				std::string_view name{ trim(std::string_view(&m_buffer[m_begin + 2], stop - m_begin - 2)) };
+				if (m_openStarts.empty() || getOpen() != name)
+				{
+					return fail("an end tag doesn't match its start tag");
+				}
+				handler.endElement(name);
+				closeElement();
+				m_begin = stop + 1;
+			}
+			else
+			{
+				if (m_openStarts.empty() && sawRoot)
+				{
+					return fail("more than one root element");
+				}
+				if (!readStartTag(handler))
+				{
+					return false;
+				}
+				sawRoot = true;
+			}
+		}
+
+		if (!m_openStarts.empty() || !sawRoot)
+		{
+			return fail(sawRoot ? "the file ends before the root element does" : "no root element");
+		}
+		return true;
+	}
+
+	const char* getError() const { return m_error ? m_error : ""; }
+
+	// how far into the file reading got
+	std::uint64_t getOffset() const { return m_consumed + m_begin; }
+
+private:
+	std::size_t m_chunkSize;
+	std::istream* m_in{ nullptr };
+	std::vector<char> m_buffer;
+	std::size_t m_begin{ 0 }; // the unread part of m_buffer
+	std::size_t m_end{ 0 };
+	std::uint64_t m_consumed{ 0 }; // bytes dropped from the front of m_buffer so far
+	bool m_atEnd{ false };
+	const char* m_error{ nullptr };
+
+	// the names of the elements the reader is inside, outermost first, end to end
+	std::string m_openNames;
+	std::vector<std::size_t> m_openStarts;
+	std::vector<XmlAttribute> m_attributes; // reused for each start tag
+	std::vector<std::size_t> m_valueEnds; // where each attribute's value ends in m_values
+	std::string m_values;
+	std::string m_text; // decoded text
+
+	bool fail(const char* error)
+	{
+		m_error = error;
+		return false;
+	}
+
+	// reads until at least count unread bytes are buffered; false if the file ends first
+	bool fill(std::size_t count)
+	{
+		while (m_end - m_begin < count)
+		{
+			if (m_atEnd)
+			{
+				return false;
+			}
+
+			// keep what's unread, at the front, and grow only if one token outgrows the buffer
+			if (m_begin > 0)
+			{
+				std::memmove(m_buffer.data(), m_buffer.data() + m_begin, m_end - m_begin);
+				m_consumed += m_begin;
+				m_end -= m_begin;
+				m_begin = 0;
+			}
+			if (m_buffer.size() - m_end < m_chunkSize / 2)
+			{
+				m_buffer.resize(m_buffer.size() + m_chunkSize);
+			}
+
+			m_in->read(m_buffer.data() + m_end, static_cast<std::streamsize>(m_buffer.size() - m_end));
+			std::size_t got{ static_cast<std::size_t>(m_in->gcount()) };
+			m_end += got;
+			if (got == 0 || !*m_in)
+			{
+				m_atEnd = true;
+			}
+		}
+		return true;
+	}
+
+	std::string_view getOpen() const { return std::string_view(m_openNames).substr(m_openStarts.back()); }
+
+	void closeElement()
+	{
+		m_openNames.resize(m_openStarts.back());
+		m_openStarts.pop_back();
+	}
+
+	// Where pattern starts at or after from, reading more until it turns up; npos if the file ends first.
+	// Reading may move what's buffered, so the offset is from m_begin's place after the call.
+	std::size_t findMore(std::string_view pattern, std::size_t from)
+	{
+		from -= m_begin;
+		while (true)
+		{
+			std::size_t at{ std::string_view(m_buffer.data(), m_end).find(pattern, m_begin + from) };
+			if (at != std::string::npos)
+			{
+				return at;
+			}
+
+			// start the next search where a match could still begin
+			std::size_t searched{ m_end - m_begin };
+			from = searched >= pattern.size() ? searched - pattern.size() + 1 : 0;
+			if (!fill(searched + 1))
+			{
+				return std::string::npos;
+			}
+		}
+	}
+
+	bool skipPast(std::string_view pattern)
+	{
+		std::size_t stop{ findMore(pattern, m_begin + 2) };
+		if (stop == std::string::npos)
+		{
+			return fail("the file ends inside a comment or processing instruction");
+		}
+		m_begin = stop + pattern.size();
+		return true;
+	}
+
+	// <!DOCTYPE ...>, which may hold an internal subset in brackets with >s of its own
+	bool skipDeclaration()
+	{
+		std::size_t at{ m_begin + 2 };
+		int depth{ 0 };
+		char quote{ 0 };
+		while (true)
+		{
+			if (at == m_end)
+			{
+				std::size_t offset{ at - m_begin };
+				if (!fill(offset + 1))
+				{
+					return fail("the file ends inside the document type");
+				}
+				at = m_begin + offset;
+			}
+
+			char c{ m_buffer[at++] };
+			if (quote)
+			{
+				quote = c == quote ? 0 : quote;
+			}
+			else if (c == '"' || c == '\'')
+			{
+				quote = c;
+			}
+			else if (c == '[')
+			{
+				++depth;
+			}
+			else if (c == ']')
+			{
+				--depth;
+			}
+			else if (c == '>' && depth <= 0)
+			{
+				m_begin = at;
+				return true;
+			}
+		}
+	}
+
+	// <name a="1" b='2'> or <name/>; values may hold > inside their quotes
+	bool readStartTag(XmlHandler& handler)
+	{
+		std::size_t at{ m_begin + 1 };
+		char quote{ 0 };
+		while (true)
+		{
+			if (at == m_end)
+			{
+				std::size_t offset{ at - m_begin };
+				if (!fill(offset + 1))
+				{
+					return fail("the file ends inside a tag");
+				}
+				at = m_begin + offset;
+			}
+
+			char c{ m_buffer[at] };
+			if (quote)
+			{
+				quote = c == quote ? 0 : quote;
+			}
+			else if (c == '"' || c == '\'')
+			{
+				quote = c;
+			}
+			else if (c == '>')
+			{
+				break;
+			}
+			++at;
+		}
+
+		std::string_view tag{ &m_buffer[m_begin + 1], at - m_begin - 1 };
+		bool empty{ !tag.empty() && tag.back() == '/' };
+		if (empty)
+		{
+			tag.remove_suffix(1);
+		}
+
+		std::size_t nameEnd{ 0 };
+		while (nameEnd < tag.size() && !isSpace(tag[nameEnd]))
+		{
+			++nameEnd;
+		}
+		std::string_view name{ tag.substr(0, nameEnd) };
+		if (name.empty())
+		{
+			return fail("a tag without a name");
+		}
+		if (!readAttributes(tag.substr(nameEnd)))
+		{
+			return false;
+		}
+
+		m_openStarts.push_back(m_openNames.size());
+		m_openNames += name;
+		handler.startElement(name, XmlAttributes(m_attributes));
+		if (empty)
+		{
+			handler.endElement(name);
+			closeElement();
+		}
+		m_begin = at + 1;
+		return true;
+	}
+
+	bool readAttributes(std::string_view rest)
+	{
+		m_attributes.clear();
+		m_valueEnds.clear();
+		m_values.clear();
+
+		std::size_t at{ 0 };
+		while (true)
+		{
+			while (at < rest.size() && isSpace(rest[at]))
+			{
+				++at;
+			}
+			if (at == rest.size())
+			{
+				break;
+			}
+
+			std::size_t equals{ rest.find('=', at) };
+			if (equals == std::string_view::npos)
+			{
+				return fail("an attribute without a value");
+			}
+			std::size_t open{ equals + 1 };
+			while (open < rest.size() && isSpace(rest[open]))
+			{
+				++open;
+			}
+			if (open == rest.size() || (rest[open] != '"' && rest[open] != '\''))
+			{
+				return fail("an attribute value without quotes");
+			}
+			std::size_t close{ rest.find(rest[open], open + 1) };
+			if (close == std::string_view::npos)
+			{
+				return fail("an attribute value without its closing quote");
+			}
+
+			// values are decoded into one string, so the views are only taken once it stops growing
+			m_attributes.push_back(XmlAttribute{ trim(rest.substr(at, equals - at)), {} });
+			m_values += decode(rest.substr(open + 1, close - open - 1), m_text);
+			m_valueEnds.push_back(m_values.size());
+			at = close + 1;
+		}
+
+		std::size_t start{ 0 };
+		for (std::size_t i{ 0 }; i < m_attributes.size(); ++i)
+		{
+			m_attributes[i].value = std::string_view(m_values.data() + start, m_valueEnds[i] - start);
+			start = m_valueEnds[i];
+		}
+		return true;
+	}
+
+	static bool isSpace(char c) { return c == ' ' || c == '\t' || c == '\r' || c == '\n'; }
+
+	static std::string_view trim(std::string_view text)
+	{
+		while (!text.empty() && isSpace(text.front()))
+		{
+			text.remove_prefix(1);
+		}
+		while (!text.empty() && isSpace(text.back()))
+		{
+			text.remove_suffix(1);
+		}
+		return text;
+	}
+
+	// text with &lt; &gt; &amp; &quot; &apos; and &#...; replaced; text without any comes back as is
+	static std::string_view decode(std::string_view text, std::string& out)
+	{
+		std::size_t amp{ text.find('&') };
+		if (amp == std::string_view::npos)
+		{
+			return text;
+		}
+
+		out.assign(text.data(), amp);
+		while (amp < text.size())
+		{
+			std::size_t semicolon{ text.find(';', amp) };
+			std::string_view entity{ semicolon == std::string_view::npos ? std::string_view{} : text.substr(amp + 1, semicolon - amp - 1) };
+			std::uint32_t codePoint{ 0 };
+			if (entity == "lt") codePoint = '<';
+			else if (entity == "gt") codePoint = '>';
+			else if (entity == "amp") codePoint = '&';
+			else if (entity == "quot") codePoint = '"';
+			else if (entity == "apos") codePoint = '\'';
+			else if (entity.size() > 1 && entity[0] == '#')
+			{
+				bool hex{ entity[1] == 'x' || entity[1] == 'X' };
+				for (char c : entity.substr(hex ? 2 : 1))
+				{
+					int digit{ c >= '0' && c <= '9' ? c - '0' : hex && c >= 'a' && c <= 'f' ? c - 'a' + 10 : hex && c >= 'A' && c <= 'F' ? c - 'A' + 10 : -1 };
+					if (digit < 0 || codePoint > 0x10FFFF)
+					{
+						codePoint = 0;
+						break;
+					}
+					codePoint = codePoint * (hex ? 16 : 10) + static_cast<std::uint32_t>(digit);
+				}
+			}
+
+			if (codePoint == 0 || codePoint > 0x10FFFF)
+			{
+				out += '&';
+				++amp;
+			}
+			else
+			{
+				appendUtf8(out, codePoint);
+				amp = semicolon + 1;
+			}
+
+			std::size_t next{ text.find('&', amp) };
+			std::size_t stop{ next == std::string_view::npos ? text.size() : next };
+			out.append(text.data() + amp, stop - amp);
+			amp = stop;
+		}
+		return out;
+	}
+
+	static void appendUtf8(std::string& out, std::uint32_t codePoint)
+	{
+		if (codePoint < 0x80)
+		{
+			out += static_cast<char>(codePoint);
+		}
+		else if (codePoint < 0x800)
+		{
+			out += static_cast<char>(0xC0 | (codePoint >> 6));
+			out += static_cast<char>(0x80 | (codePoint & 0x3F));
+		}
+		else if (codePoint < 0x10000)
+		{
+			out += static_cast<char>(0xE0 | (codePoint >> 12));
+			out += static_cast<char>(0x80 | ((codePoint >> 6) & 0x3F));
+			out += static_cast<char>(0x80 | (codePoint & 0x3F));
+		}
+		else
+		{
+			out += static_cast<char>(0xF0 | (codePoint >> 18));
+			out += static_cast<char>(0x80 | ((codePoint >> 12) & 0x3F));
+			out += static_cast<char>(0x80 | ((codePoint >> 6) & 0x3F));
+			out += static_cast<char>(0x80 | (codePoint & 0x3F));
+		}
+	}
+};
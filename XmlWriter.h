@@ -0,0 +1,219 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// A streaming XML writer, the other half of XmlReader: tags and text go into a fixed buffer that's handed to
+// the stream whenever it fills, so a document of any length takes the buffer and the names of the elements
+// still open. Elements are indented two spaces a level; one holding only text stays on its line.
+class XmlWriter
+{
+public:
+	explicit XmlWriter(std::ostream& out, std::size_t bufferSize = 64 * 1024) : m_out(out), m_bufferSize(bufferSize)
+	{
+		m_buffer.reserve(bufferSize + 256);
+	}
+
+	~XmlWriter() { flush(); }
+
+	XmlWriter(const XmlWriter&) = delete;
+	XmlWriter& operator=(const XmlWriter&) = delete;
+
+	// written as is, for the declaration and DOCTYPE before the root
+	void raw(std::string_view text)
+	{
+		m_buffer.append(text);
+		m_started = true;
+		spill();
+	}
+
+	// opens an element; attributes can follow until anything goes inside it
+	void start(std::string_view name)
+	{
+		closeStartTag();
+		newLine();
+		m_buffer += '<';
+		m_buffer.append(name);
+		m_open = true;
+
+		if (m_depth == m_names.size())
+		{
+			m_names.emplace_back();
+		}
+		m_names[m_depth++].assign(name);
+		spill();
+	}
+
+	void attribute(std::string_view name, std::string_view value)
+	{
+		m_buffer += ' ';
+		m_buffer.append(name);
+		m_buffer.append("=\"");
+		escape(value, true);
+		m_buffer += '"';
+	}
+
+	void attribute(std::string_view name, long long value) { attribute(name, std::string_view{ std::to_string(value) }); }
+
+	// text inside the element opened last, escaped
+	void text(std::string_view text)
+	{
+		closeStartTag();
+		escape(text, false);
+		m_hasText = true;
+		spill();
+	}
+
+	// closes the element opened last, as <name/> if nothing went inside it
+	void end()
+	{
+		if (m_depth == 0)
+		{
+			return;
+		}
+
+		--m_depth;
+		if (m_open)
+		{
+			m_buffer.append("/>");
+			m_open = false;
+		}
+		else
+		{
+			if (!m_hasText)
+			{
+				newLine();
+			}
+			m_buffer.append("</");
+			m_buffer.append(m_names[m_depth]);
+			m_buffer += '>';
+		}
+		m_hasText = false;
+		spill();
+	}
+
+	// <name>text</name>
+	void element(std::string_view name, std::string_view text)
+	{
+		start(name);
+		this->text(text);
+		end();
+	}
+
+	void element(std::string_view name, long long value) { element(name, std::string_view{ std::to_string(value) }); }
+
+	// <name/>
+	void empty(std::string_view name)
+	{
+		start(name);
+		end();
+	}
+
+	// closes whatever is still open and hands everything to the stream; false if the stream failed
+	bool finish()
+	{
+		while (m_depth > 0)
+		{
+			end();
+		}
+		m_buffer += '\n';
+		flush();
+		m_out.flush();
+		return static_cast<bool>(m_out);
+	}
+
+	std::size_t getDepth() const { return m_depth; }
+
+private:
+	std::ostream& m_out;
+	std::size_t m_bufferSize;
+	std::string m_buffer;
+	std::vector<std::string> m_names; // the open elements', reused as the depth comes back
+	std::size_t m_depth{ 0 };
+	bool m_open{ false }; // the last start tag is waiting for its '>'
+	bool m_hasText{ false }; // the open element has text in it
+	bool m_started{ false }; // anything has been written
+
+	void closeStartTag()
+	{
+		if (m_open)
+		{
+			m_buffer += '>';
+			m_open = false;
+		}
+	}
+
+	void newLine()
+	{
+		if (m_started)
+		{
+			m_buffer += '\n';
+			m_buffer.append(2 * m_depth, ' ');
+		}
+		m_started = true;
+	}
+
+	// Text as UTF-8, with the markup characters as entities. Control characters XML 1.0 can't hold at all
+	// are dropped; tabs and line breaks in attributes become references so a reader keeps them.
+	void escape(std::string_view text, bool inAttribute)
+	{
+		for (char c : text)
+		{
+			switch (c)
+			{
+			case '&':
+				m_buffer.append("&amp;");
+				break;
+			case '<':
+				m_buffer.append("&lt;");
+				break;
+			case '>':
+				m_buffer.append("&gt;");
+				break;
+			case '"':
+				m_buffer.append(inAttribute ? "&quot;" : "\"");
+				break;
+			case '\t':
+			case '\n':
+			case '\r':
+				if (inAttribute)
+				{
+					m_buffer.append(c == '\t' ? "&#9;" : c == '\n' ? "&#10;" : "&#13;");
+				}
+				else
+				{
+					m_buffer += c;
+				}
+				break;
+			default:
+				if (static_cast<unsigned char>(c) >= 0x20)
+				{
+					m_buffer += c;
+				}
+				break;
+			}
+		}
+		spill();
+	}
+
+	void spill()
+	{
+		if (m_buffer.size() >= m_bufferSize)
+		{
+			flush();
+		}
+	}
+
+	void flush()
+	{
+		if (!m_buffer.empty())
+		{
+			m_out.write(m_buffer.data(), static_cast<std::streamsize>(m_buffer.size()));
+			m_buffer.clear();
+		}
+	}
+};
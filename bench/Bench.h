@@ -0,0 +1,163 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+// What the benchmarks share: a clock, the options every one of them takes, and the JSON they write.
+//
+//   --quick        the smallest sizes only, as ctest runs them
+//   --json FILE    the results go to FILE instead of stdout
+//
+// Each benchmark writes one object, {"benchmark": name, "quick": bool, "results": [...]}, and each result
+// is a flat object of numbers and strings, so runs can be compared without knowing what was measured.
+
+class BenchClock
+{
+public:
+	BenchClock() : m_start(std::chrono::steady_clock::now()) {}
+
+	void restart() { m_start = std::chrono::steady_clock::now(); }
+
+	double elapsedMs() const { return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - m_start).count(); }
+
+private:
+	std::chrono::steady_clock::time_point m_start;
+};
+
+class BenchReport
+{
+public:
+	BenchReport(std::string name, int argc, char** argv) : m_name(std::move(name))
+	{
+		for (int i{ 1 }; i < argc; ++i)
+		{
+			std::string arg{ argv[i] };
+			if (arg == "--quick")
+			{
+				m_quick = true;
+			}
+			else if (arg == "--json" && i + 1 < argc)
+			{
+				m_path = argv[++i];
+			}
+			else
+			{
+				m_extra.push_back(arg);
+			}
+		}
+	}
+
+	bool isQuick() const { return m_quick; }
+
+	// arguments that aren't the shared options, for the benchmark to read
+	const std::vector<std::string>& getArguments() const { return m_extra; }
+
+	// starts a result; the fields that follow go in it
+	void begin()
+	{
+		m_results.emplace_back();
+	}
+
+	void field(const char* name, double value)
+	{
+		char number[32];
+		if (std::isfinite(value))
+		{
+			std::snprintf(number, sizeof(number), "%.6g", value);
+		}
+		else
+		{
+			std::snprintf(number, sizeof(number), "null");
+		}
+		append(name, number);
+	}
+
+	void field(const char* name, long long value) { append(name, std::to_string(value)); }
+	void field(const char* name, std::size_t value) { append(name, std::to_string(value)); }
+	void field(const char* name, int value) { append(name, std::to_string(value)); }
+	void field(const char* name, bool value) { append(name, value ? "true" : "false"); }
+
+	void field(const char* name, const std::string& value)
+	{
+		std::string quoted{ "\"" };
+		for (char c : value)
+		{
+			if (c == '"' || c == '\\')
+			{
+				quoted += '\\';
+			}
+			quoted += c;
+		}
+		quoted += '"';
+		append(name, quoted);
+	}
+
+	void field(const char* name, const char* value) { field(name, std::string{ value }); }
+
+	// writes everything; false if the file couldn't be written
+	bool finish() const
+	{
+		std::string json{ "{\n  \"benchmark\": \"" + m_name + "\",\n  \"quick\": " + (m_quick ? "true" : "false") + ",\n  \"results\": [" };
+		for (std::size_t i{ 0 }; i < m_results.size(); ++i)
+		{
+			json += (i == 0 ? "\n    {" : ",\n    {") + m_results[i] + "}";
+		}
+		json += "\n  ]\n}\n";
+
+		if (m_path.empty())
+		{
+			std::cout << json;
+			return static_cast<bool>(std::cout.flush());
+		}
+
+		std::ofstream out(m_path, std::ios::trunc);
+		out << json;
+		return static_cast<bool>(out);
+	}
+
+private:
+	std::string m_name;
+	std::string m_path;
+	bool m_quick{ false };
+	std::vector<std::string> m_extra;
+	std::vector<std::string> m_results; // each result's fields, "name": value, comma separated
+
+	void append(const char* name, const std::string& value)
+	{
+		if (m_results.empty())
+		{
+			begin();
+		}
+
+		std::string& result{ m_results.back() };
+		if (!result.empty())
+		{
+			result += ", ";
+		}
+		result += '"';
+		result += name;
+		result += "\": ";
+		result += value;
+	}
+};
+
+// the largest difference between any of two pixels' channels, for benchmarks that compare what they drew
+inline int channelDifference(std::uint32_t a, std::uint32_t b)
+{
+	int largest{ 0 };
+	for (int shift{ 0 }; shift < 32; shift += 8)
+	{
+		largest = (std::max)(largest, std::abs(static_cast<int>((a >> shift) & 0xFF) - static_cast<int>((b >> shift) & 0xFF)));
+	}
+	return largest;
+}
@@ -0,0 +1,227 @@
+// bulk-delete-bench: deletes rubber-band selections of 10 to 100k shapes out of a 100k-shape document on
+// both layers, through the same calls the window makes (band select, then Delete), and undoes each delete.
+// Every tenth shape is locked. Alongside, the old per-item delete is replayed on a plain vector of handles
+// (a find_if and an erase per selected shape), for as long as its quadratic cost stays bearable.
+//
+// After each delete the survivors are checked: the locked shapes must all be there, and in the same z order.
+// Undo must bring everything back, however big the delete. It should take about as long as the delete did;
+// that's reported as undo_in_budget, but only fails a full run, since a --quick run under a busy ctest -j
+// can't time anything that small reliably.
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdio>
+#include <limits>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+#include "Bench.h"
+#include "Simple Score.h"
+
+// shapes sit in a grid, one per cell in z order row by row, so a band of whole rows selects an exact count
+constexpr int kColumns{ 500 };
+constexpr float kCell{ 40.0f };
+constexpr std::size_t kLockEvery{ 10 };
+
+// beyond this many compares and moves the per-item replay is skipped
+constexpr double kPerItemBudget{ 2.0e9 };
+
+// putting a delete back is the same kind of pass as making it, so undo may take this many times the delete,
+// plus a little for the journal; one that searches per shape blows through it by orders of magnitude at 100k
+constexpr double kUndoPerDelete{ 4.0 };
+constexpr double kUndoSlackMs{ 20.0 };
+
+// the calls each layer names its own way
+struct DrawingLayer
+{
+    static constexpr const char* kName{ "drawing" };
+    std::unique_ptr<DRAW_SHAPES> model{ std::make_unique<DRAW_SHAPES>() };
+
+    void set(ShapeStore store) { model->setShapes(std::move(store)); }
+    void select(const Bounds& band)
+    {
+        model->setOrigin(RenderPoint{ band.left, band.top });
+        model->setCurrent(RenderPoint{ band.right, band.bottom });
+        model->selectShapes();
+    }
+    void remove() { model->removeShape(); }
+    bool canUndo() const { return model->canUndo(); }
+    void undo() { model->undo(); }
+    const ShapeStore& shapes() const { return model->getShapes(); }
+};
+
+struct ScoreLayer
+{
+    static constexpr const char* kName{ "score" };
+    std::unique_ptr<SCORE> model{ std::make_unique<SCORE>() };
+
+    void set(ShapeStore store) { model->setElements(std::move(store)); }
+    void select(const Bounds& band)
+    {
+        model->setOrigin(RenderPoint{ band.left, band.top });
+        model->setCurrent(RenderPoint{ band.right, band.bottom });
+        model->selectElements();
+    }
+    void remove() { model->removeElement(); }
+    bool canUndo() const { return model->canUndo(); }
+    void undo() { model->undo(); }
+    const ShapeStore& shapes() const { return model->getElements(); }
+};
+
+ShapeStore makeDocument(std::size_t count)
+{
+    ShapeStore store;
+    for (std::size_t i{ 0 }; i < count; ++i)
+    {
+        float x{ static_cast<float>(i % kColumns) * kCell + 5.0f };
+        float y{ static_cast<float>(i / kColumns) * kCell + 5.0f };
+        float xy[4]{ x, y, x + 20.0f, y + 15.0f };
+        ShapeHandle shape{ store.add(i % 2 == 0 ? ShapeKind::Rect : ShapeKind::Ellipse, xy, 2, 0xFF000000, 2, false) };
+        store.setLocked(shape, i % kLockEvery == 0);
+    }
+    return store;
+}
+
+// the old removeShape: for each selected shape, find it and erase it; the milliseconds it took
+double perItemDeleteMs(const ShapeStore& store, const std::vector<ShapeHandle>& selected)
+{
+    std::vector<ShapeHandle> shapes;
+    for (std::size_t i{ 0 }; i < store.size(); ++i)
+    {
+        shapes.push_back(store.getHandle(i));
+    }
+
+    BenchClock clock;
+    for (ShapeHandle victim : selected)
+    {
+        auto it = std::find_if(shapes.begin(), shapes.end(), [victim](ShapeHandle shape) { return shape == victim; });
+        if (it != shapes.end() && !store.isLocked(victim))
+        {
+            shapes.erase(it);
+        }
+    }
+    return clock.elapsedMs();
+}
+
+// true if what's left is everything that wasn't deleted, in the order it was in
+bool survivorsIntact(const ShapeStore& before, const ShapeStore& after, const std::vector<ShapeHandle>& deleted)
+{
+    std::unordered_map<ShapeHandle, std::size_t> position;
+    for (std::size_t i{ 0 }; i < before.size(); ++i)
+    {
+        position.emplace(before.getHandle(i), i);
+    }
+
+    std::size_t last{ 0 };
+    for (std::size_t i{ 0 }; i < after.size(); ++i)
+    {
+        auto found = position.find(after.getHandle(i));
+        if (found == position.end() || (i > 0 && found->second <= last))
+        {
+            return false;
+        }
+        last = found->second;
+    }
+
+    std::size_t unlocked{ 0 };
+    for (ShapeHandle shape : deleted)
+    {
+        if (before.isLocked(shape))
+        {
+            if (!after.contains(shape))
+            {
+                return false;
+            }
+        }
+        else
+        {
+            ++unlocked;
+            if (after.contains(shape))
+            {
+                return false;
+            }
+        }
+    }
+    return after.size() == before.size() - unlocked;
+}
+
+template<typename Layer>
+bool run(BenchReport& bench, std::size_t count, std::size_t selection)
+{
+    Layer layer;
+    layer.set(makeDocument(count));
+
+    // copies of what's there, to check against
+    ShapeStore before{ makeDocument(count) };
+    std::vector<ShapeHandle> selected;
+    std::size_t columns{ (std::min)(selection, static_cast<std::size_t>(kColumns)) };
+    std::size_t rows{ selection / columns };
+    for (std::size_t i{ 0 }; i < rows * kColumns; ++i)
+    {
+        if (i % kColumns < columns)
+        {
+            selected.push_back(before.getHandle(i));
+        }
+    }
+    Bounds band{ 0.0f, 0.0f, static_cast<float>(columns) * kCell, static_cast<float>(rows) * kCell };
+
+    BenchClock clock;
+    layer.select(band);
+    double selectMs{ clock.elapsedMs() };
+
+    clock.restart();
+    layer.remove();
+    double deleteMs{ clock.elapsedMs() };
+    bool intact{ survivorsIntact(before, layer.shapes(), selected) };
+
+    bool undoable{ layer.canUndo() };
+    clock.restart();
+    layer.undo();
+    double undoMs{ clock.elapsedMs() };
+    bool restored{ layer.shapes().size() == count };
+    bool undoInBudget{ undoMs <= kUndoPerDelete * deleteMs + kUndoSlackMs };
+
+    double work{ static_cast<double>(count) * static_cast<double>(selection) };
+    double perItemMs{ work <= kPerItemBudget ? perItemDeleteMs(before, selected) : std::numeric_limits<double>::quiet_NaN() };
+
+    bench.begin();
+    bench.field("layer", Layer::kName);
+    bench.field("shapes", count);
+    bench.field("selected", selected.size());
+    bench.field("select_ms", selectMs);
+    bench.field("delete_ms", deleteMs);
+    bench.field("undoable", undoable);
+    bench.field("undo_ms", undoMs);
+    bench.field("per_item_delete_ms", perItemMs);
+    bench.field("speedup", perItemMs / deleteMs);
+    bench.field("survivors_intact", intact);
+    bench.field("undo_restored", restored);
+    bench.field("undo_in_budget", undoInBudget);
+    return intact && undoable && restored && (undoInBudget || bench.isQuick()) && selected.size() == selection;
+}
+
+int main(int argc, char** argv)
+{
+    BenchReport bench{ "bulk-delete", argc, argv };
+
+    std::size_t count{ 100000 };
+    std::vector<std::size_t> selections{ 10, 100, 1000, 10000, 100000 };
+    if (bench.isQuick())
+    {
+        count = 10000;
+        selections = { 10, 100, 1000, 10000 };
+    }
+
+    bool ok{ true };
+    for (std::size_t selection : selections)
+    {
+        ok = run<DrawingLayer>(bench, count, selection) && ok;
+        ok = run<ScoreLayer>(bench, count, selection) && ok;
+    }
+
+    if (!ok)
+    {
+        std::fprintf(stderr, "a delete took the wrong shapes, reordered the survivors, or didn't undo in time\n");
+    }
+    return bench.finish() && ok ? 0 : 1;
+}
@@ -0,0 +1,22 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include "RenderBackend.h"
+
+// counts what the model hands a backend, without drawing it
+class CountingBackend : public RenderBackend
+{
+public:
+	std::size_t calls{ 0 };
+
+	void drawLine(float, float, float, float, std::uint32_t, float) override { ++calls; }
+	void drawRect(float, float, float, float, std::uint32_t, float, bool) override { ++calls; }
+	void drawEllipse(float, float, float, float, std::uint32_t, float, bool) override { ++calls; }
+	void drawPolygon(const RenderPoint*, std::size_t, std::uint32_t, float, bool) override { ++calls; }
+	void drawCurve(const RenderPoint*, std::size_t, std::uint32_t, float) override { ++calls; }
+	void drawBeziers(const RenderPoint*, std::size_t, std::uint32_t, float) override { ++calls; }
+	void drawText(const std::wstring&, float, float, const std::wstring&, float, std::uint32_t) override { ++calls; }
+	void setTransform(const Transform&) override {}
+};
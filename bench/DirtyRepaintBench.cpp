@@ -0,0 +1,324 @@
+// dirty-repaint-bench: checks that repainting only the damage the model records gives the same pixels as
+// redrawing the whole view, and counts the draw calls that saves. Each frame makes one edit the way the
+// window does (drag, add, delete, raise, undo, or dragging a score element), repaints each dirty rectangle
+// into its own surface as a clipped WM_PAINT would, and compares the result with a full redraw.
+//
+// It fails if any pixel differs by more than the rasterizer's rounding, so a change that forgets to record
+// damage shows up under ctest. Coverage is computed from coordinates shifted to each surface's corner, so a
+// pixel can come out one level apart; those are counted, but only as rounding.
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <random>
+#include <vector>
+#include "Bench.h"
+#include "CountingBackend.h"
+#include "RasterBackend.h"
+#include "Simple Score.h"
+
+constexpr int kViewWidth{ 1280 };
+constexpr int kViewHeight{ 800 };
+constexpr int kFrames{ 120 };
+constexpr std::uint32_t kPaper{ 0xFFFFFFFF };
+
+// the most any channel may differ by before a pixel counts as wrong
+constexpr int kRounding{ 1 };
+
+GlyphOutlines leland;
+
+struct Scene
+{
+    std::unique_ptr<DRAW_SHAPES> drawing{ std::make_unique<DRAW_SHAPES>() };
+    std::unique_ptr<SCORE> score{ std::make_unique<SCORE>() };
+
+    // in the window's order: the drawing, then the score over it
+    void draw(RenderBackend& backend, const Bounds& area)
+    {
+        drawing->drawStoredShapes(backend, area);
+        score->drawStoredElements(backend, area);
+    }
+};
+
+// what the frames add up to
+struct Totals
+{
+    std::size_t dirtyRects{ 0 };
+    std::size_t dirtyCalls{ 0 };
+    std::size_t fullCalls{ 0 };
+    double dirtyPixels{ 0.0 };
+    double dirtyMs{ 0.0 };
+    double fullMs{ 0.0 };
+    std::size_t roundedPixels{ 0 };
+    std::size_t mismatchedPixels{ 0 };
+    int mismatchedFrames{ 0 };
+};
+
+// repaints one dirty rectangle, widened to whole pixels as invalidateDirty does, into the window's surface
+void repaintRect(Scene& scene, const Bounds& damage, std::vector<std::uint32_t>& surface, Totals& totals)
+{
+    int left{ (std::max)(0, static_cast<int>(std::floor(damage.left))) };
+    int top{ (std::max)(0, static_cast<int>(std::floor(damage.top))) };
+    int right{ (std::min)(kViewWidth, static_cast<int>(std::ceil(damage.right)) + 1) };
+    int bottom{ (std::min)(kViewHeight, static_cast<int>(std::ceil(damage.bottom)) + 1) };
+    if (right <= left || bottom <= top)
+    {
+        return;
+    }
+
+    Bounds area{ static_cast<float>(left), static_cast<float>(top), static_cast<float>(right), static_cast<float>(bottom) };
+
+    BenchClock clock;
+    RasterBackend raster(leland.isOpen() ? &leland : nullptr);
+    raster.resize(right - left, bottom - top);
+    raster.clear(kPaper);
+    raster.setView(Transform::translation(static_cast<float>(-left), static_cast<float>(-top)));
+    scene.draw(raster, area);
+
+    const std::uint32_t* pixels{ raster.getPixels() };
+    int width{ right - left };
+    for (int y{ top }; y < bottom; ++y)
+    {
+        std::copy(pixels + static_cast<std::size_t>(y - top) * width, pixels + static_cast<std::size_t>(y - top + 1) * width, surface.begin() + static_cast<std::size_t>(y) * kViewWidth + left);
+    }
+    totals.dirtyMs += clock.elapsedMs();
+
+    CountingBackend counter;
+    scene.draw(counter, area);
+    totals.dirtyCalls += counter.calls;
+    totals.dirtyPixels += static_cast<double>(right - left) * (bottom - top);
+    ++totals.dirtyRects;
+}
+
+// clicks until something is hit, as a user aiming at a shape would; false if nothing was
+template<typename Click>
+bool clickSomething(std::mt19937& rng, Click&& click)
+{
+    std::uniform_int_distribution<int> x{ 0, kViewWidth - 1 };
+    std::uniform_int_distribution<int> y{ 0, kViewHeight - 1 };
+    for (int attempt{ 0 }; attempt < 200; ++attempt)
+    {
+        if (click(x(rng), y(rng)))
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+// one edit, chosen by frame
+void edit(Scene& scene, std::mt19937& rng, int frame)
+{
+    DRAW_SHAPES& drawing{ *scene.drawing };
+    SCORE& score{ *scene.score };
+    int dragX{ 0 };
+    int dragY{ 0 };
+    auto clickShape = [&](int x, int y) {
+        drawing.selectShape(x, y);
+        dragX = x;
+        dragY = y;
+        if (!drawing.isMoving())
+        {
+            drawing.stopSelecting();
+            return false;
+        }
+        return true;
+    };
+
+    switch (frame % 6)
+    {
+    case 0:
+        if (clickSomething(rng, clickShape))
+        {
+            for (int step{ 1 }; step <= 4; ++step)
+            {
+                drawing.moveShape(dragX + step * 7, dragY + step * 3);
+            }
+            drawing.dropShape();
+        }
+        drawing.unSelect();
+        break;
+    case 1:
+    {
+        std::uniform_real_distribution<float> x{ -20.0f, static_cast<float>(kViewWidth) };
+        std::uniform_real_distribution<float> y{ -20.0f, static_cast<float>(kViewHeight) };
+        drawing.addEllipse(RenderPoint{ x(rng), y(rng) }, 40.0f, 25.0f, 0xC0208040, 3, frame % 2 == 0);
+        drawing.endEdit();
+        break;
+    }
+    case 2:
+        if (clickSomething(rng, clickShape))
+        {
+            drawing.dropShape();
+            drawing.removeShape();
+        }
+        drawing.unSelect();
+        break;
+    case 3:
+        if (clickSomething(rng, clickShape))
+        {
+            drawing.dropShape();
+            drawing.popUp();
+        }
+        drawing.unSelect();
+        break;
+    case 4:
+        if (drawing.canUndo())
+        {
+            drawing.undo();
+        }
+        break;
+    default:
+        if (clickSomething(rng, [&](int x, int y) {
+                score.selectElement(x, y);
+                dragX = x;
+                dragY = y;
+                if (!score.isMoving())
+                {
+                    score.stopSelecting();
+                    return false;
+                }
+                return true;
+            }))
+        {
+            for (int step{ 1 }; step <= 4; ++step)
+            {
+                score.moveElement(dragX - step * 5, dragY + step * 4);
+            }
+            score.dropElement();
+        }
+        score.stopSelecting();
+        break;
+    }
+}
+
+// false if the partial repaints ever differed from the full one
+bool run(BenchReport& report, std::size_t count)
+{
+    std::mt19937 rng{ 11 };
+    std::uniform_real_distribution<float> x{ -20.0f, static_cast<float>(kViewWidth) };
+    std::uniform_real_distribution<float> y{ -20.0f, static_cast<float>(kViewHeight) };
+
+    Scene scene;
+    scene.drawing->setShape(DRAW_SHAPES::SELECT);
+    scene.score->setElement(SCORE::SELECT);
+    for (std::size_t i{ 0 }; i < count; ++i)
+    {
+        RenderPoint p{ x(rng), y(rng) };
+        switch (i % 4)
+        {
+        case 0:
+            scene.drawing->addRect(p, 30.0f, 18.0f, 0xFF000000, 2, false);
+            break;
+        case 1:
+            scene.drawing->addEllipse(p, 24.0f, 16.0f, 0x80204080, 2, true);
+            break;
+        case 2:
+            scene.drawing->addLine(p, p + RenderPoint{ 25.0f, 12.0f }, 0xFF800000, 3);
+            break;
+        default:
+            scene.drawing->addTriangle(p, p + RenderPoint{ 20.0f, 0.0f }, p + RenderPoint{ 10.0f, 15.0f }, 0xFF000080, 1, false);
+            break;
+        }
+    }
+    for (float staff{ 40.0f }; staff < kViewHeight; staff += 84.0f)
+    {
+        scene.score->addMeasure(RenderPoint{ 20.0f, staff }, 600);
+        scene.score->addMeasure(RenderPoint{ 620.0f, staff }, 600);
+    }
+    for (std::size_t i{ 0 }; i < count / 10; ++i)
+    {
+        scene.score->addSymbol(RenderPoint{ x(rng), y(rng) }, 28, i % 2 == 0 ? L"\xE0A4" : L"\xE4E5");
+    }
+    scene.drawing->endEdit();
+    scene.score->endEdit();
+
+    Bounds view{ 0.0f, 0.0f, static_cast<float>(kViewWidth), static_cast<float>(kViewHeight) };
+    RasterBackend full(leland.isOpen() ? &leland : nullptr);
+    full.resize(kViewWidth, kViewHeight);
+
+    // the window's surface starts as a full paint, and from then on only the damage is repainted
+    full.clear(kPaper);
+    scene.draw(full, view);
+    std::vector<std::uint32_t> surface(full.getPixels(), full.getPixels() + static_cast<std::size_t>(kViewWidth) * kViewHeight);
+    {
+        DirtyRegion dirty;
+        scene.drawing->takeDirty(dirty);
+        scene.score->takeDirty(dirty);
+    }
+
+    Totals totals;
+    for (int frame{ 0 }; frame < kFrames; ++frame)
+    {
+        edit(scene, rng, frame);
+
+        DirtyRegion dirty;
+        scene.drawing->takeDirty(dirty);
+        scene.score->takeDirty(dirty);
+        for (const Bounds& damage : dirty.getRects())
+        {
+            repaintRect(scene, damage, surface, totals);
+        }
+
+        BenchClock clock;
+        full.clear(kPaper);
+        scene.draw(full, view);
+        totals.fullMs += clock.elapsedMs();
+
+        CountingBackend counter;
+        scene.draw(counter, view);
+        totals.fullCalls += counter.calls;
+
+        std::size_t mismatched{ 0 };
+        const std::uint32_t* expected{ full.getPixels() };
+        for (std::size_t i{ 0 }; i < surface.size(); ++i)
+        {
+            if (surface[i] != expected[i])
+            {
+                int difference{ channelDifference(surface[i], expected[i]) };
+                totals.roundedPixels += difference <= kRounding ? 1 : 0;
+                mismatched += difference > kRounding ? 1 : 0;
+            }
+        }
+        totals.mismatchedPixels += mismatched;
+        totals.mismatchedFrames += mismatched > 0 ? 1 : 0;
+    }
+
+    double viewPixels{ static_cast<double>(kViewWidth) * kViewHeight * kFrames };
+    report.begin();
+    report.field("shapes", count);
+    report.field("frames", kFrames);
+    report.field("dirty_rects", totals.dirtyRects);
+    report.field("dirty_area_fraction", totals.dirtyPixels / viewPixels);
+    report.field("dirty_draw_calls", totals.dirtyCalls);
+    report.field("full_draw_calls", totals.fullCalls);
+    report.field("draw_calls_saved", totals.fullCalls > 0 ? 1.0 - static_cast<double>(totals.dirtyCalls) / totals.fullCalls : 0.0);
+    report.field("dirty_frame_ms", totals.dirtyMs / kFrames);
+    report.field("full_frame_ms", totals.fullMs / kFrames);
+    report.field("rounded_pixels", totals.roundedPixels);
+    report.field("mismatched_frames", totals.mismatchedFrames);
+    report.field("mismatched_pixels", totals.mismatchedPixels);
+    return totals.mismatchedPixels == 0;
+}
+
+int main(int argc, char** argv)
+{
+    BenchReport report{ "dirty-repaint", argc, argv };
+    leland.open(kLelandPath);
+
+    std::vector<std::size_t> sizes{ 1000, 5000, 20000 };
+    if (report.isQuick())
+    {
+        sizes = { 1000 };
+    }
+
+    bool matched{ true };
+    for (std::size_t count : sizes)
+    {
+        matched = run(report, count) && matched;
+    }
+
+    return report.finish() && matched ? 0 : 1;
+}
@@ -0,0 +1,141 @@
+// font-cache-bench: repaints a 10k-symbol score through a backend that, like GdiplusBackend, needs a font
+// object for every string it draws, once building the font for each draw as Symbol::draw used to and once
+// taking it from the font cache. The font here is Leland's outlines opened from the file, which stands in
+// for a GDI+ Font: building one looks the font up and parses its tables, and drawing a glyph walks its outline.
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+#include "Bench.h"
+#include "FontCache.h"
+#include "GlyphOutlines.h"
+#include "RenderBackend.h"
+#include "Simple Score.h"
+
+constexpr int kRepaints{ 10 };
+
+// outline points, so the walk can't be optimized away
+class PointCounter : public OutlineSink
+{
+public:
+    std::size_t points{ 0 };
+
+    void moveTo(float, float) override { ++points; }
+    void lineTo(float, float) override { ++points; }
+    void cubicTo(float, float, float, float, float, float) override { points += 3; }
+    void closePath() override {}
+};
+
+using OutlineCache = BasicFontCache<GlyphOutlines>;
+
+std::shared_ptr<GlyphOutlines> openLeland(const std::wstring&, int, int)
+{
+    auto font{ std::make_shared<GlyphOutlines>() };
+    font->open(kLelandPath);
+    return font;
+}
+
+// draws text the way the GDI+ backend does: a font for the string, then its glyphs from that font
+class FontBackend : public RenderBackend
+{
+public:
+    // without a cache every string builds its own font
+    explicit FontBackend(OutlineCache* cache) : m_cache(cache) {}
+
+    std::size_t texts{ 0 };
+    std::size_t points{ 0 };
+
+    void drawLine(float, float, float, float, std::uint32_t, float) override {}
+    void drawRect(float, float, float, float, std::uint32_t, float, bool) override {}
+    void drawEllipse(float, float, float, float, std::uint32_t, float, bool) override {}
+    void drawPolygon(const RenderPoint*, std::size_t, std::uint32_t, float, bool) override {}
+    void drawCurve(const RenderPoint*, std::size_t, std::uint32_t, float) override {}
+    void drawBeziers(const RenderPoint*, std::size_t, std::uint32_t, float) override {}
+    void setTransform(const Transform&) override {}
+
+    void drawText(const std::wstring& text, float, float, const std::wstring& family, float size, std::uint32_t) override
+    {
+        ++texts;
+        std::shared_ptr<GlyphOutlines> font{ m_cache ? m_cache->get(family, static_cast<int>(size)) : openLeland(family, static_cast<int>(size), 0) };
+        PointCounter counter;
+        for (wchar_t c : text)
+        {
+            font->getOutline(font->getGlyph(static_cast<std::uint32_t>(c)), counter);
+        }
+        points += counter.points;
+    }
+
+private:
+    OutlineCache* m_cache;
+};
+
+// repaints the whole score the given number of times; the milliseconds per repaint
+double repaintMs(SCORE& score, FontBackend& backend, int repaints)
+{
+    BenchClock clock;
+    for (int i{ 0 }; i < repaints; ++i)
+    {
+        score.drawStoredElements(backend, score.getContentBounds());
+    }
+    return clock.elapsedMs() / repaints;
+}
+
+void report(BenchReport& report, const char* mode, std::size_t symbols, double ms, double uncachedMs, const FontBackend& backend, const OutlineCache* cache)
+{
+    report.begin();
+    report.field("mode", mode);
+    report.field("symbols", symbols);
+    report.field("repaint_ms", ms);
+    report.field("speedup", uncachedMs / ms);
+    report.field("draw_text_calls", backend.texts);
+    report.field("outline_points", backend.points);
+    report.field("hits", cache ? cache->getHits() : 0);
+    report.field("misses", cache ? cache->getMisses() : backend.texts);
+    report.field("evictions", cache ? cache->getEvictions() : 0);
+}
+
+int main(int argc, char** argv)
+{
+    BenchReport bench{ "font-cache", argc, argv };
+    if (!GlyphOutlines{}.open(kLelandPath))
+    {
+        std::fprintf(stderr, "can't open %s\n", kLelandPath);
+        return 1;
+    }
+
+    // noteheads, rests, accidentals and clefs at the sizes the symbol palette offers
+    static const wchar_t* const kGlyphs[]{ L"\xE0A4", L"\xE0A3", L"\xE4E5", L"\xE262", L"\xE050", L"\xE4E3" };
+    static const int kSizes[]{ 20, 24, 28, 32 };
+
+    std::size_t symbols{ bench.isQuick() ? std::size_t{ 1000 } : std::size_t{ 10000 } };
+    int repaints{ bench.isQuick() ? 2 : kRepaints };
+
+    std::mt19937 rng{ 3 };
+    std::uniform_real_distribution<float> anywhere{ 0.0f, 4000.0f };
+    auto score{ std::make_unique<SCORE>() };
+    for (std::size_t i{ 0 }; i < symbols; ++i)
+    {
+        score->addSymbol(RenderPoint{ anywhere(rng), anywhere(rng) }, kSizes[i % 4], kGlyphs[i % 6]);
+    }
+
+    FontBackend uncached{ nullptr };
+    double uncachedMs{ repaintMs(*score, uncached, repaints) };
+    report(bench, "uncached", symbols, uncachedMs, uncachedMs, uncached, nullptr);
+
+    OutlineCache cache{ openLeland };
+    FontBackend cached{ &cache };
+    double cachedMs{ repaintMs(*score, cached, repaints) };
+    report(bench, "cached", symbols, cachedMs, uncachedMs, cached, &cache);
+
+    // fewer entries than sizes on the page: every draw evicts, which is what the capacity has to stay above
+    OutlineCache small{ openLeland, 2 };
+    FontBackend thrashing{ &small };
+    double thrashingMs{ repaintMs(*score, thrashing, repaints) };
+    report(bench, "cached_capacity_2", symbols, thrashingMs, uncachedMs, thrashing, &small);
+
+    return bench.finish() ? 0 : 1;
+}
@@ -0,0 +1,160 @@
+// glyph-atlas-bench: draws 50k score symbols (noteheads, rests, accidentals, clefs and flags at three sizes)
+// through RasterBackend twice, once filling every glyph from its outline, as symbols were drawn before the
+// atlas, and once blending masks from the glyph atlas. The outline fill stands in for GDI+'s DrawString,
+// which doesn't run here: both lay out and rasterize the glyph's outline on every draw.
+//
+// Two surfaces: a 256-pixel tile, which stays in cache, and a 2000-pixel page, which doesn't. The atlas runs
+// twice on each, cold (every mask drawn on first use) and warm. At the end the same symbols are drawn on
+// quarter-pixel pens, where the atlas rounds nothing, and the two surfaces must match to within the blend's
+// rounding; on arbitrary pens the atlas moves a glyph by up to an eighth of a pixel, which is only reported.
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <iterator>
+#include <random>
+#include <string>
+#include <vector>
+#include "Bench.h"
+#include "GlyphOutlines.h"
+#include "RasterBackend.h"
+
+constexpr std::uint32_t kPaper{ 0xFFFFFFFF };
+constexpr std::uint32_t kInk{ 0xFF000000 };
+
+// the atlas blends in integers and the outline fill in floats, a level apart at most, but symbols overlap
+// and each blend rounds what the one before left
+constexpr int kRounding{ 3 };
+
+// a score's usual glyphs: noteheads, rests, accidentals, clefs and flags
+const wchar_t kGlyphs[]{ 0xE0A4, 0xE0A3, 0xE0A2, 0xE0A0, 0xE4E5, 0xE4E4, 0xE4E3, 0xE4E6, 0xE4E7, 0xE260, 0xE261, 0xE262, 0xE050, 0xE062, 0xE240, 0xE242 };
+const float kSizes[]{ 24.0f, 32.0f, 40.0f };
+
+GlyphOutlines leland;
+
+struct Symbol
+{
+    std::wstring text;
+    float x;
+    float y;
+    float size;
+};
+
+// symbols scattered over a side by side surface, a little past its edges as a tile's would be
+std::vector<Symbol> makeSymbols(std::size_t count, int side, bool quarterPens)
+{
+    std::mt19937 rng{ 5 };
+    std::uniform_real_distribution<float> anywhere{ -20.0f, static_cast<float>(side) - 16.0f };
+    std::vector<Symbol> symbols;
+    symbols.reserve(count);
+    for (std::size_t i{ 0 }; i < count; ++i)
+    {
+        Symbol symbol{ std::wstring(1, kGlyphs[rng() % std::size(kGlyphs)]), anywhere(rng), anywhere(rng), kSizes[rng() % std::size(kSizes)] };
+        if (quarterPens)
+        {
+            // the pen sits a sixth of an em right of x and an ascender below y; put it on a quarter pixel
+            float scale{ symbol.size / static_cast<float>(leland.getUnitsPerEm()) };
+            float penX{ std::round((symbol.x + symbol.size / 6.0f) * 4.0f) / 4.0f };
+            float baseline{ std::round((symbol.y + static_cast<float>(leland.getAscender()) * scale) * 4.0f) / 4.0f };
+            symbol.x = penX - symbol.size / 6.0f;
+            symbol.y = baseline - static_cast<float>(leland.getAscender()) * scale;
+        }
+        symbols.push_back(symbol);
+    }
+    return symbols;
+}
+
+double draw(RasterBackend& backend, const std::vector<Symbol>& symbols)
+{
+    backend.clear(kPaper);
+    BenchClock clock;
+    for (const Symbol& symbol : symbols)
+    {
+        backend.drawText(symbol.text, symbol.x, symbol.y, L"Leland", symbol.size, kInk);
+    }
+    return clock.elapsedMs();
+}
+
+struct Comparison
+{
+    int largest{ 0 };
+    double mean{ 0.0 };
+    std::size_t mismatched{ 0 };
+};
+
+Comparison compare(const RasterBackend& outlines, const RasterBackend& atlas)
+{
+    Comparison result;
+    std::size_t pixels{ static_cast<std::size_t>(outlines.getWidth()) * outlines.getHeight() };
+    double total{ 0.0 };
+    for (std::size_t i{ 0 }; i < pixels; ++i)
+    {
+        int difference{ channelDifference(outlines.getPixels()[i], atlas.getPixels()[i]) };
+        result.largest = (std::max)(result.largest, difference);
+        result.mismatched += difference > kRounding ? 1 : 0;
+        total += difference;
+    }
+    result.mean = pixels > 0 ? total / static_cast<double>(pixels) : 0.0;
+    return result;
+}
+
+// draws the symbols both ways on a side by side surface and reports the times and how far apart they came out
+Comparison run(BenchReport& bench, const char* name, std::size_t count, int side, bool quarterPens)
+{
+    std::vector<Symbol> symbols{ makeSymbols(count, side, quarterPens) };
+
+    RasterBackend outlines{ &leland };
+    outlines.resize(side, side);
+    outlines.setGlyphAtlas(false);
+    RasterBackend atlas{ &leland };
+    atlas.resize(side, side);
+
+    double outlineMs{ draw(outlines, symbols) };
+    double coldMs{ draw(atlas, symbols) };
+    double warmMs{ draw(atlas, symbols) };
+    Comparison difference{ compare(outlines, atlas) };
+
+    const GlyphAtlas& cache{ atlas.getGlyphAtlas() };
+    bench.begin();
+    bench.field("run", name);
+    bench.field("symbols", count);
+    bench.field("surface", side);
+    bench.field("outline_ms", outlineMs);
+    bench.field("atlas_cold_ms", coldMs);
+    bench.field("atlas_warm_ms", warmMs);
+    bench.field("outline_us_per_symbol", outlineMs * 1000.0 / static_cast<double>(count));
+    bench.field("atlas_us_per_symbol", warmMs * 1000.0 / static_cast<double>(count));
+    bench.field("speedup", warmMs > 0.0 ? outlineMs / warmMs : 0.0);
+    bench.field("masks", cache.size());
+    bench.field("atlas_kb", cache.getBytes() / 1024);
+    bench.field("misses", cache.getMisses());
+    bench.field("largest_difference", difference.largest);
+    bench.field("mean_difference", difference.mean);
+    return difference;
+}
+
+int main(int argc, char** argv)
+{
+    BenchReport bench{ "glyph-atlas", argc, argv };
+    if (!leland.open(kLelandPath))
+    {
+        std::fprintf(stderr, "can't open %s\n", kLelandPath);
+        return 1;
+    }
+
+    std::size_t count{ bench.isQuick() ? std::size_t{ 5000 } : std::size_t{ 50000 } };
+    run(bench, "tile", count, 256, false);
+    run(bench, "page", count, 2000, false);
+    Comparison snapped{ run(bench, "quarter_pixel_pens", count, 2000, true) };
+    bench.field("mismatched_pixels", snapped.mismatched);
+
+    bool ok{ bench.finish() };
+    if (snapped.mismatched > 0)
+    {
+        std::fprintf(stderr, "%zu pixels drawn from the atlas differ from the outline fill by more than %d\n", snapped.mismatched, kRounding);
+        return 1;
+    }
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,165 @@
+// glyph-list-bench: counts the allocations the Symbols listbox makes per redraw, the way its WM_DRAWITEM
+// handler reads the glyph catalogue: before, a copy of the whole vector<wstring> from getGlyphs() for each
+// visible row, and now a view of one character from getGlyph(). Opening the dialog is counted too, when
+// every glyph was added to the listbox as a string, against the owner-data list that only takes a count.
+//
+// Every operator new in the process is counted, so the figures include anything the catalogue allocates.
+
+#include <cstddef>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <memory>
+#include <new>
+#include <string>
+#include <vector>
+#include "Bench.h"
+#include "Simple Score.h"
+
+namespace
+{
+    std::size_t allocations{ 0 };
+    std::size_t allocatedBytes{ 0 };
+}
+
+void* operator new(std::size_t size)
+{
+    ++allocations;
+    allocatedBytes += size;
+    if (void* p{ std::malloc(size == 0 ? 1 : size) })
+    {
+        return p;
+    }
+    throw std::bad_alloc{};
+}
+
+void* operator new[](std::size_t size) { return operator new(size); }
+
+// Every form of delete, sized or not, frees what the operator new above took from malloc. They stay out of
+// line: inlined into a delete expression, GCC sees free() called on a pointer from operator new and warns.
+[[gnu::noinline]] void operator delete(void* p) noexcept { std::free(p); }
+[[gnu::noinline]] void operator delete[](void* p) noexcept { std::free(p); }
+[[gnu::noinline]] void operator delete(void* p, std::size_t) noexcept { std::free(p); }
+[[gnu::noinline]] void operator delete[](void* p, std::size_t) noexcept { std::free(p); }
+
+// the rows a Symbols listbox of the dialog's height shows at Leland's row height
+constexpr std::size_t kVisibleRows{ 20 };
+constexpr int kRedraws{ 1000 };
+
+// the catalogue as it was: a string per glyph, handed out by value
+class CopiedCatalogue
+{
+public:
+    explicit CopiedCatalogue(const std::vector<wchar_t>& glyphs)
+    {
+        for (wchar_t glyph : glyphs)
+        {
+            m_glyphs.push_back(std::wstring(1, glyph));
+        }
+    }
+
+    std::vector<std::wstring> getGlyphs() const { return m_glyphs; }
+
+private:
+    std::vector<std::wstring> m_glyphs;
+};
+
+// what each allocation count is taken over
+struct Count
+{
+    std::size_t allocations{ 0 };
+    std::size_t bytes{ 0 };
+    double ms{ 0.0 };
+};
+
+template<typename Work>
+Count count(Work&& work)
+{
+    std::size_t startAllocations{ allocations };
+    std::size_t startBytes{ allocatedBytes };
+    BenchClock clock;
+    work();
+    return Count{ allocations - startAllocations, allocatedBytes - startBytes, clock.elapsedMs() };
+}
+
+// the character the handler passes to DrawText, summed so the reads aren't optimized away
+volatile unsigned drawn{ 0 };
+
+void report(BenchReport& bench, const char* handler, std::size_t glyphs, const Count& open, const Count& redraws, int redrawCount)
+{
+    bench.begin();
+    bench.field("handler", handler);
+    bench.field("glyphs", glyphs);
+    bench.field("visible_rows", kVisibleRows);
+    bench.field("open_allocations", open.allocations);
+    bench.field("open_bytes", open.bytes);
+    bench.field("allocations_per_redraw", static_cast<double>(redraws.allocations) / redrawCount);
+    bench.field("bytes_per_redraw", static_cast<double>(redraws.bytes) / redrawCount);
+    bench.field("redraw_us", redraws.ms * 1000.0 / redrawCount);
+}
+
+int main(int argc, char** argv)
+{
+    BenchReport bench{ "glyph-list", argc, argv };
+
+    // the glyph cache lands beside the font, as it does for the app
+    auto score{ std::make_unique<SCORE>() };
+    if (!score->loadGlyphs(kLelandPath))
+    {
+        std::fprintf(stderr, "can't load the glyphs from %s\n", kLelandPath);
+        return 1;
+    }
+
+    std::size_t glyphs{ score->getGlyphCount() };
+    int redraws{ bench.isQuick() ? 50 : kRedraws };
+
+    // each redraw scrolls a row on and paints every visible row, as dragging the scroll bar does
+    auto firstRow = [&](int redraw) { return static_cast<std::size_t>(redraw) % (glyphs - kVisibleRows); };
+
+    CopiedCatalogue copied{ score->getGlyphs() };
+    std::vector<std::wstring> listbox;
+    Count openBefore{ count([&]() {
+        // LB_ADDSTRING for every glyph; the control keeps its own copy of each string
+        for (const std::wstring& glyph : copied.getGlyphs())
+        {
+            listbox.push_back(glyph);
+        }
+    }) };
+    Count redrawBefore{ count([&]() {
+        for (int redraw{ 0 }; redraw < redraws; ++redraw)
+        {
+            for (std::size_t row{ firstRow(redraw) }; row < firstRow(redraw) + kVisibleRows; ++row)
+            {
+                drawn = drawn + copied.getGlyphs()[row][0];
+            }
+        }
+    }) };
+    report(bench, "copied", glyphs, openBefore, redrawBefore, redraws);
+
+    std::size_t rowCount{ 0 };
+    Count openAfter{ count([&]() {
+        // LB_SETCOUNT
+        rowCount = score->getGlyphCount();
+    }) };
+    Count redrawAfter{ count([&]() {
+        for (int redraw{ 0 }; redraw < redraws; ++redraw)
+        {
+            for (std::size_t row{ firstRow(redraw) }; row < firstRow(redraw) + kVisibleRows && row < rowCount; ++row)
+            {
+                std::wstring_view glyph{ score->getGlyph(row) };
+                drawn = drawn + glyph[0];
+            }
+        }
+    }) };
+    report(bench, "owner_data", glyphs, openAfter, redrawAfter, redraws);
+
+    bool ok{ bench.finish() };
+
+    // the point of the change: a redraw reads the catalogue without allocating
+    if (redrawAfter.allocations != 0)
+    {
+        std::fprintf(stderr, "the owner-data redraw allocated %zu times\n", redrawAfter.allocations);
+        ok = false;
+    }
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,352 @@
+// model-bench: times the drawing and score model the way the window drives it, on generated documents
+// from 1k to 1M elements: insertion, hit-test, rectangle select, drag, z-order changes, delete, save and
+// load, and rasterization. Everything runs through DRAW_SHAPES and SCORE, with no windows.h.
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+#include "Bench.h"
+#include "CountingBackend.h"
+#include "RasterBackend.h"
+#include "Simple Score.h"
+
+// the window's size, for the frames that are rasterized
+constexpr int kViewWidth{ 1280 };
+constexpr int kViewHeight{ 800 };
+
+constexpr int kHitTests{ 2000 };
+constexpr int kBands{ 100 };
+constexpr int kDrags{ 100 };
+constexpr int kReorders{ 200 };
+constexpr int kFrames{ 5 };
+
+// shapes are scattered at the same density whatever their number, so a view holds about as many at every size
+float sideFor(std::size_t count)
+{
+    return std::sqrt(static_cast<float>(count)) * 40.0f;
+}
+
+std::filesystem::path scratchFile()
+{
+    return std::filesystem::temp_directory_path() / "simple-score-model-bench.ssd";
+}
+
+// Leland's outlines, for the symbols the rasterizer draws; without them symbols are skipped
+GlyphOutlines leland;
+
+// a frame of the window's size at the top left of the document, through the portable rasterizer
+double rasterizeMs(const std::function<void(RenderBackend&, const Bounds&)>& draw)
+{
+    RasterBackend raster(leland.isOpen() ? &leland : nullptr);
+    raster.resize(kViewWidth, kViewHeight);
+    Bounds view{ 0.0f, 0.0f, static_cast<float>(kViewWidth), static_cast<float>(kViewHeight) };
+
+    BenchClock clock;
+    for (int frame{ 0 }; frame < kFrames; ++frame)
+    {
+        raster.clear(0xFFFFFFFF);
+        draw(raster, view);
+    }
+    return clock.elapsedMs() / kFrames;
+}
+
+// reads a saved document back into one layer's store, as File > Open does
+bool loadLayer(const std::filesystem::path& path, DocumentLayer layer, ShapeStore& store)
+{
+    DocumentReader reader;
+    if (!reader.open(path))
+    {
+        return false;
+    }
+
+    for (std::size_t i{ 0 }; i < reader.size(); ++i)
+    {
+        ShapeRecord record;
+        if (!reader.getRecord(i, record) || (record.layer == layer && store.add(reader, record) == kNoShape))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+void benchDrawing(BenchReport& report, std::size_t count)
+{
+    std::mt19937 rng{ 42 };
+    float side{ sideFor(count) };
+    std::uniform_real_distribution<float> anywhere{ 0.0f, side };
+    auto point = [&]() { return RenderPoint{ anywhere(rng), anywhere(rng) }; };
+
+    auto drawing{ std::make_unique<DRAW_SHAPES>() };
+    drawing->setShape(DRAW_SHAPES::SELECT);
+
+    report.begin();
+    report.field("layer", "drawing");
+    report.field("elements", count);
+
+    BenchClock clock;
+    for (std::size_t i{ 0 }; i < count; ++i)
+    {
+        RenderPoint p{ point() };
+        switch (i % 4)
+        {
+        case 0:
+            drawing->addRect(p, 20.0f, 15.0f, 0xFF000000, 2, false);
+            break;
+        case 1:
+            drawing->addEllipse(p, 20.0f, 15.0f, 0xFF204080, 2, true);
+            break;
+        case 2:
+            drawing->addLine(p, p + RenderPoint{ 20.0f, 10.0f }, 0xFF000000, 2);
+            break;
+        default:
+            drawing->addTriangle(p, p + RenderPoint{ 20.0f, 0.0f }, p + RenderPoint{ 10.0f, 15.0f }, 0xFF800000, 2, false);
+            break;
+        }
+    }
+    report.field("insert_ms", clock.elapsedMs());
+
+    clock.restart();
+    int hits{ 0 };
+    for (int i{ 0 }; i < kHitTests; ++i)
+    {
+        RenderPoint p{ point() };
+        drawing->selectShape(p.x, p.y);
+        hits += drawing->isMoving() ? 1 : 0;
+        drawing->dropShape();
+        drawing->unSelect();
+        drawing->stopSelecting();
+    }
+    report.field("hit_test_us", clock.elapsedMs() * 1000.0 / kHitTests);
+    report.field("hit_rate", static_cast<double>(hits) / kHitTests);
+
+    clock.restart();
+    for (int i{ 0 }; i < kBands; ++i)
+    {
+        RenderPoint p{ point() };
+        drawing->setOrigin(p);
+        drawing->setCurrent(p + RenderPoint{ 400.0f, 300.0f });
+        drawing->selectShapes();
+        drawing->unSelect();
+    }
+    report.field("rect_select_us", clock.elapsedMs() * 1000.0 / kBands);
+
+    // a drag is ten mouse moves and a drop on whatever the click lands on
+    clock.restart();
+    int drags{ 0 };
+    for (int i{ 0 }; i < 50 * kDrags && drags < kDrags; ++i)
+    {
+        RenderPoint p{ point() };
+        int x{ static_cast<int>(p.x) };
+        int y{ static_cast<int>(p.y) };
+        drawing->selectShape(x, y);
+        if (drawing->isMoving())
+        {
+            for (int step{ 1 }; step <= 10; ++step)
+            {
+                drawing->moveShape(x + step, y + step);
+            }
+            ++drags;
+        }
+        drawing->dropShape();
+        drawing->unSelect();
+        drawing->stopSelecting();
+    }
+    report.field("drag_us", drags > 0 ? clock.elapsedMs() * 1000.0 / drags : 0.0);
+
+    clock.restart();
+    int reorders{ 0 };
+    for (int i{ 0 }; i < 50 * kReorders && reorders < kReorders; ++i)
+    {
+        RenderPoint p{ point() };
+        drawing->selectShape(p.x, p.y);
+        if (drawing->isMoving())
+        {
+            drawing->dropShape();
+            drawing->popUp();
+            drawing->pushDown();
+            ++reorders;
+        }
+        drawing->dropShape();
+        drawing->unSelect();
+        drawing->stopSelecting();
+    }
+    report.field("z_order_us", reorders > 0 ? clock.elapsedMs() * 1000.0 / reorders : 0.0);
+
+    CountingBackend counter;
+    clock.restart();
+    drawing->drawStoredShapes(counter, drawing->getContentBounds());
+    report.field("draw_all_ms", clock.elapsedMs());
+    report.field("draw_calls", counter.calls);
+    report.field("rasterize_view_ms", rasterizeMs([&](RenderBackend& backend, const Bounds& view) { drawing->drawStoredShapes(backend, view); }));
+
+    std::filesystem::path path{ scratchFile() };
+    clock.restart();
+    {
+        DocumentWriter writer;
+        drawing->writeShapes(writer);
+        writer.save(path);
+    }
+    report.field("save_ms", clock.elapsedMs());
+    report.field("file_bytes", static_cast<std::size_t>(std::filesystem::file_size(path)));
+
+    clock.restart();
+    {
+        ShapeStore shapes;
+        bool loaded{ loadLayer(path, DocumentLayer::Drawing, shapes) };
+        drawing->setShapes(std::move(shapes));
+        report.field("loaded", loaded);
+    }
+    report.field("load_ms", clock.elapsedMs());
+    std::filesystem::remove(path);
+
+    // a quarter of the document in one band, then delete
+    clock.restart();
+    drawing->setOrigin(RenderPoint{ side / 4.0f, side / 4.0f });
+    drawing->setCurrent(RenderPoint{ side * 3.0f / 4.0f, side * 3.0f / 4.0f });
+    drawing->selectShapes();
+    drawing->removeShape();
+    report.field("delete_quarter_ms", clock.elapsedMs());
+}
+
+void benchScore(BenchReport& report, std::size_t count)
+{
+    // a staff every 84 pixels, each a row of measures, with noteheads and rests scattered over them
+    static const wchar_t* const kGlyphs[]{ L"\xE0A4", L"\xE0A3", L"\xE4E5", L"\xE262", L"\xE050" };
+
+    std::mt19937 rng{ 7 };
+    float side{ sideFor(count) };
+    std::uniform_real_distribution<float> anywhere{ 0.0f, side };
+    auto point = [&]() { return RenderPoint{ anywhere(rng), anywhere(rng) }; };
+
+    auto score{ std::make_unique<SCORE>() };
+    score->setElement(SCORE::SELECT);
+
+    report.begin();
+    report.field("layer", "score");
+    report.field("elements", count);
+
+    BenchClock clock;
+    std::size_t measures{ count / 8 };
+    int perRow{ (std::max)(1, static_cast<int>(side / 200.0f)) };
+    for (std::size_t i{ 0 }; i < measures; ++i)
+    {
+        float x{ static_cast<float>(i % perRow) * 200.0f };
+        float y{ static_cast<float>(i / perRow) * 84.0f };
+        score->addMeasure(RenderPoint{ x, y }, 200);
+    }
+    for (std::size_t i{ measures }; i < count; ++i)
+    {
+        score->addSymbol(point(), 28, kGlyphs[i % 5]);
+    }
+    report.field("insert_ms", clock.elapsedMs());
+
+    // SCORE keeps a clicked element selected until the next hit, so the bands run before any click lands
+    clock.restart();
+    for (int i{ 0 }; i < kBands; ++i)
+    {
+        RenderPoint p{ point() };
+        score->selectElement(-100000, -100000);
+        score->stopSelecting();
+        score->setOrigin(p);
+        score->setCurrent(p + RenderPoint{ 400.0f, 300.0f });
+        score->selectElements();
+    }
+    report.field("rect_select_us", clock.elapsedMs() * 1000.0 / kBands);
+
+    clock.restart();
+    score->selectElement(-100000, -100000);
+    score->stopSelecting();
+    score->setOrigin(RenderPoint{ side / 4.0f, side / 4.0f });
+    score->setCurrent(RenderPoint{ side * 3.0f / 4.0f, side * 3.0f / 4.0f });
+    score->selectElements();
+    score->removeElement();
+    report.field("delete_quarter_ms", clock.elapsedMs());
+
+    clock.restart();
+    int hits{ 0 };
+    for (int i{ 0 }; i < kHitTests; ++i)
+    {
+        RenderPoint p{ point() };
+        score->selectElement(p.x, p.y);
+        hits += score->isMoving() ? 1 : 0;
+        score->dropElement();
+        score->stopSelecting();
+    }
+    report.field("hit_test_us", clock.elapsedMs() * 1000.0 / kHitTests);
+    report.field("hit_rate", static_cast<double>(hits) / kHitTests);
+
+    clock.restart();
+    int drags{ 0 };
+    for (int i{ 0 }; i < 50 * kDrags && drags < kDrags; ++i)
+    {
+        RenderPoint p{ point() };
+        int x{ static_cast<int>(p.x) };
+        int y{ static_cast<int>(p.y) };
+        score->selectElement(x, y);
+        if (score->isMoving())
+        {
+            for (int step{ 1 }; step <= 10; ++step)
+            {
+                score->moveElement(x + step, y + step);
+            }
+            ++drags;
+        }
+        score->dropElement();
+        score->stopSelecting();
+    }
+    report.field("drag_us", drags > 0 ? clock.elapsedMs() * 1000.0 / drags : 0.0);
+
+    CountingBackend counter;
+    clock.restart();
+    score->drawStoredElements(counter, score->getContentBounds());
+    report.field("draw_all_ms", clock.elapsedMs());
+    report.field("draw_calls", counter.calls);
+    report.field("rasterize_view_ms", rasterizeMs([&](RenderBackend& backend, const Bounds& view) { score->drawStoredElements(backend, view); }));
+
+    std::filesystem::path path{ scratchFile() };
+    clock.restart();
+    {
+        DocumentWriter writer;
+        score->writeElements(writer);
+        writer.save(path);
+    }
+    report.field("save_ms", clock.elapsedMs());
+    report.field("file_bytes", static_cast<std::size_t>(std::filesystem::file_size(path)));
+
+    clock.restart();
+    {
+        ShapeStore elements;
+        bool loaded{ loadLayer(path, DocumentLayer::Score, elements) };
+        score->setElements(std::move(elements));
+        report.field("loaded", loaded);
+    }
+    report.field("load_ms", clock.elapsedMs());
+    std::filesystem::remove(path);
+}
+
+int main(int argc, char** argv)
+{
+    BenchReport report{ "model", argc, argv };
+    leland.open(kLelandPath);
+
+    std::vector<std::size_t> sizes{ 1000, 10000, 100000, 1000000 };
+    if (report.isQuick())
+    {
+        sizes = { 1000, 10000 };
+    }
+
+    for (std::size_t count : sizes)
+    {
+        benchDrawing(report, count);
+        benchScore(report, count);
+    }
+
+    return report.finish() ? 0 : 1;
+}
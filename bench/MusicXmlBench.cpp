@@ -0,0 +1,256 @@
+// music-xml-bench: import and export throughput on a generated 10k-measure score: five parts, a piano among
+// them, with random rhythms, accidentals, chords and words. The score is written to a temporary file,
+// imported, exported to another and the export imported again; the two imports must read the same parts,
+// measures and notes or the benchmark fails.
+//
+// On Linux the export's own memory is measured too: the peak resident size is reset just before it and read
+// just after, so what's reported is what the exporter added over the imported score and its index, as the
+// app keeps them. It reads one system at a time and streams the XML, so this should track the measures and
+// the busiest system, not the notes or the file size; past MusicXmlExporter::getMemoryBound, or if it read
+// more than a system's worth of the score at once, the benchmark fails.
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include <sstream>
+#include <string>
+#include "Bench.h"
+#include "MusicXmlExport.h"
+#include "MusicXmlImport.h"
+#include "SpatialIndex.h"
+
+struct PartSpec
+{
+    const char* id;
+    const char* name;
+    const char* sign;
+    int line;
+    int octave; // of the bottom line's neighbourhood, where the part's notes start
+    int staves;
+};
+
+const PartSpec kParts[]{
+    { "P1", "Violin I", "G", 2, 4, 1 },
+    { "P2", "Violin II", "G", 2, 4, 1 },
+    { "P3", "Viola", "C", 3, 3, 1 },
+    { "P4", "Violoncello", "F", 4, 2, 1 },
+    { "P5", "Piano", "G", 2, 4, 2 },
+};
+
+const char* const kSteps[]{ "C", "D", "E", "F", "G", "A", "B" };
+
+// a 4/4 measure at four divisions to the quarter, filled with random values from a 16th up
+void writeStaff(std::ostringstream& xml, std::mt19937& rng, int octave, int staff, bool chords)
+{
+    static const int kDurations[]{ 1, 2, 3, 4, 6, 8, 12, 16 };
+    static const char* const kTypes[]{ "16th", "eighth", "eighth", "quarter", "quarter", "half", "half", "whole" };
+    static const int kDots[]{ 0, 0, 1, 0, 1, 0, 1, 0 };
+    static const char* const kAccidentals[]{ "sharp", "flat", "natural" };
+
+    for (int left{ 16 }; left > 0;)
+    {
+        int value{ static_cast<int>(rng() % 8) };
+        while (kDurations[value] > left)
+        {
+            --value;
+        }
+        left -= kDurations[value];
+
+        int notes{ rng() % 10 == 0 ? 0 : chords && rng() % 5 < 2 ? 2 : 1 };
+        for (int n{ 0 }; n < (std::max)(notes, 1); ++n)
+        {
+            xml << "<note>" << (n > 0 ? "<chord/>" : "");
+            if (notes == 0)
+            {
+                xml << "<rest/>";
+            }
+            else
+            {
+                int step{ static_cast<int>(rng() % 7) + 2 * n };
+                xml << "<pitch><step>" << kSteps[step % 7] << "</step><octave>" << octave + static_cast<int>(rng() % 2) + step / 7 << "</octave></pitch>";
+            }
+            xml << "<duration>" << kDurations[value] << "</duration><type>" << kTypes[value] << "</type>" << (kDots[value] ? "<dot/>" : "");
+            if (notes > 0 && rng() % 8 == 0)
+            {
+                xml << "<accidental>" << kAccidentals[rng() % 3] << "</accidental>";
+            }
+            xml << (staff > 0 ? "<staff>" + std::to_string(staff) + "</staff>" : "") << "</note>\n";
+        }
+    }
+}
+
+std::string makeScore(int measures)
+{
+    std::mt19937 rng{ 7 };
+    std::ostringstream xml;
+    xml << "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n<score-partwise version=\"4.0\">\n<work><work-title>Generated Symphony</work-title></work>\n<part-list>\n";
+    for (const PartSpec& part : kParts)
+    {
+        xml << "<score-part id=\"" << part.id << "\"><part-name>" << part.name << "</part-name></score-part>\n";
+    }
+    xml << "</part-list>\n";
+
+    for (const PartSpec& part : kParts)
+    {
+        xml << "<part id=\"" << part.id << "\">\n";
+        for (int m{ 1 }; m <= measures; ++m)
+        {
+            xml << "<measure number=\"" << m << "\">\n";
+            if (m == 1)
+            {
+                xml << "<attributes><divisions>4</divisions><key><fifths>-2</fifths></key><time><beats>4</beats><beat-type>4</beat-type></time>";
+                if (part.staves == 2)
+                {
+                    xml << "<staves>2</staves><clef number=\"1\"><sign>G</sign><line>2</line></clef><clef number=\"2\"><sign>F</sign><line>4</line></clef>";
+                }
+                else
+                {
+                    xml << "<clef><sign>" << part.sign << "</sign><line>" << part.line << "</line></clef>";
+                }
+                xml << "</attributes>\n";
+            }
+            if (rng() % 50 == 0)
+            {
+                xml << "<direction placement=\"above\"><direction-type><words>dolce &amp; espr.</words></direction-type></direction>\n";
+            }
+            writeStaff(xml, rng, part.octave, part.staves == 2 ? 1 : 0, part.staves == 2);
+            if (part.staves == 2)
+            {
+                xml << "<backup><duration>16</duration></backup>\n";
+                writeStaff(xml, rng, 2, 2, true);
+            }
+            xml << "</measure>\n";
+        }
+        xml << "</part>\n";
+    }
+    xml << "</score-partwise>\n";
+    return xml.str();
+}
+
+// the peak resident size in KB since the last reset, or 0 where /proc doesn't say
+long peakKb()
+{
+    std::ifstream status("/proc/self/status");
+    std::string line;
+    while (std::getline(status, line))
+    {
+        if (line.rfind("VmHWM:", 0) == 0)
+        {
+            return std::stol(line.substr(6));
+        }
+    }
+    return 0;
+}
+
+long residentKb()
+{
+    std::ifstream status("/proc/self/status");
+    std::string line;
+    while (std::getline(status, line))
+    {
+        if (line.rfind("VmRSS:", 0) == 0)
+        {
+            return std::stol(line.substr(6));
+        }
+    }
+    return 0;
+}
+
+void resetPeak()
+{
+    std::ofstream clear("/proc/self/clear_refs");
+    clear << "5";
+}
+
+int main(int argc, char** argv)
+{
+    BenchReport bench{ "music-xml", argc, argv };
+    int measures{ bench.isQuick() ? 500 : 10000 };
+
+    std::filesystem::path source{ std::filesystem::temp_directory_path() / "simple-score-bench.musicxml" };
+    std::filesystem::path exported{ std::filesystem::temp_directory_path() / "simple-score-bench-export.musicxml" };
+    {
+        std::string xml{ makeScore(measures) };
+        std::ofstream out(source, std::ios::binary | std::ios::trunc);
+        out.write(xml.data(), static_cast<std::streamsize>(xml.size()));
+    }
+    double sourceMb{ static_cast<double>(std::filesystem::file_size(source)) / (1024.0 * 1024.0) };
+
+    ShapeStore elements;
+    MusicXmlImporter importer;
+    BenchClock clock;
+    bool imported{ importer.import(source, elements) };
+    double importMs{ clock.elapsedMs() };
+
+    SpatialIndex<ShapeHandle> index;
+    for (std::size_t i{ 0 }; i < elements.size(); ++i)
+    {
+        ShapeHandle shape{ elements.getHandle(i) };
+        if (elements.getParent(shape) == kNoShape)
+        {
+            index.insert(shape, elements.getBounds(shape));
+        }
+    }
+
+    long before{ residentKb() };
+    resetPeak();
+    MusicXmlExporter exporter;
+    clock.restart();
+    bool written{ imported && exporter.write(elements, index, exported) };
+    double exportMs{ clock.elapsedMs() };
+    long peak{ peakKb() };
+    double exportedMb{ written ? static_cast<double>(std::filesystem::file_size(exported)) / (1024.0 * 1024.0) : 0.0 };
+
+    // a system of a few measures is a small share of the score, whatever its length
+    std::size_t bound{ exporter.getMemoryBound() };
+    bool withinBound{ peak <= 0 || static_cast<std::size_t>((std::max)(0L, peak - before)) * 1024 <= bound };
+    bool bounded{ exporter.getMostElements() * 20 <= elements.size() };
+
+    ShapeStore again;
+    MusicXmlImporter reimporter;
+    bool reimported{ written && reimporter.import(exported, again) };
+    bool same{ reimported && reimporter.getPartCount() == importer.getPartCount() && reimporter.getMeasureCount() == importer.getMeasureCount()
+        && reimporter.getNoteCount() == importer.getNoteCount() };
+
+    bench.begin();
+    bench.field("measures", measures);
+    bench.field("parts", importer.getPartCount());
+    bench.field("notes", importer.getNoteCount());
+    bench.field("elements", elements.size());
+    bench.field("import_mb", sourceMb);
+    bench.field("import_ms", importMs);
+    bench.field("import_mb_per_s", importMs > 0.0 ? sourceMb * 1000.0 / importMs : 0.0);
+    bench.field("export_mb", exportedMb);
+    bench.field("export_ms", exportMs);
+    bench.field("export_mb_per_s", exportMs > 0.0 ? exportedMb * 1000.0 / exportMs : 0.0);
+    bench.field("export_measures_per_s", exportMs > 0.0 ? exporter.getMeasureCount() * 1000.0 / exportMs : 0.0);
+    bench.field("export_peak_kb", peak > 0 ? static_cast<long long>(peak - before) : -1LL);
+    bench.field("export_bytes_per_element", peak > 0 ? static_cast<double>(peak - before) * 1024.0 / static_cast<double>(elements.size()) : 0.0);
+    bench.field("export_bound_kb", bound / 1024);
+    bench.field("export_within_bound", withinBound);
+    bench.field("export_most_elements", exporter.getMostElements());
+    bench.field("round_trip_same", same);
+
+    std::filesystem::remove(source);
+    std::filesystem::remove(exported);
+    bool ok{ bench.finish() };
+    if (!same)
+    {
+        std::fprintf(stderr, "the export didn't read back as the same score: %s%s\n", importer.getError(), exporter.getError());
+        return 1;
+    }
+    if (!withinBound)
+    {
+        std::fprintf(stderr, "the export took %ld KB, past its bound of %zu KB\n", peak - before, bound / 1024);
+        return 1;
+    }
+    if (!bounded)
+    {
+        std::fprintf(stderr, "the export read %zu of the score's %zu elements at once\n", exporter.getMostElements(), elements.size());
+        return 1;
+    }
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,105 @@
+// sketch-fitter-bench: feeds freehand strokes to SketchFitter one sample at a time, as mouse moves arrive
+// during a drag, and reports the samples it takes per second, the slowest single sample, and how many
+// points the finished curve has against the raw samples a sketch used to store and hand to DrawCurve.
+//
+// Two kinds of stroke: a smooth one that turns slowly, like handwriting or a slur, sampled every pixel, and
+// a scribble that turns sharply every 2 px.
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdio>
+#include <random>
+#include <vector>
+#include "Bench.h"
+#include "SketchFitter.h"
+
+struct Stroke
+{
+    const char* kind;
+    float step; // pixels between samples
+    float turn; // the most the direction changes per sample, in radians
+};
+
+std::vector<RenderPoint> makeStroke(const Stroke& stroke, std::mt19937& rng, std::size_t samples)
+{
+    std::uniform_real_distribution<float> turn{ -stroke.turn, stroke.turn };
+    std::vector<RenderPoint> points;
+    float x{ 0.0f };
+    float y{ 0.0f };
+    float angle{ 0.0f };
+    for (std::size_t i{ 0 }; i < samples; ++i)
+    {
+        angle += turn(rng);
+        x += stroke.step * std::cos(angle);
+        y += stroke.step * std::sin(angle);
+        points.push_back(RenderPoint{ std::round(x), std::round(y) });
+    }
+    return points;
+}
+
+int main(int argc, char** argv)
+{
+    BenchReport bench{ "sketch-fitter", argc, argv };
+
+    std::size_t strokes{ bench.isQuick() ? std::size_t{ 10 } : std::size_t{ 200 } };
+    constexpr std::size_t kSamples{ 5000 };
+
+    const Stroke kinds[]{ { "smooth", 1.0f, 0.03f }, { "scribble", 2.0f, 0.3f } };
+
+    bool ok{ true };
+    for (const Stroke& kind : kinds)
+    {
+        std::mt19937 rng{ 7 };
+        std::vector<std::vector<RenderPoint>> samples;
+        for (std::size_t i{ 0 }; i < strokes; ++i)
+        {
+            samples.push_back(makeStroke(kind, rng, kSamples));
+        }
+
+        for (float tolerance : { 0.5f, 1.0f, 2.0f, 4.0f })
+        {
+            SketchFitter fitter{ tolerance };
+            std::size_t kept{ 0 };
+            std::size_t points{ 0 };
+            double slowestMs{ 0.0 };
+
+            BenchClock total;
+            for (const std::vector<RenderPoint>& stroke : samples)
+            {
+                fitter.clear();
+                for (RenderPoint p : stroke)
+                {
+                    BenchClock clock;
+                    fitter.add(p.x, p.y);
+                    slowestMs = (std::max)(slowestMs, clock.elapsedMs());
+                }
+                const std::vector<RenderPoint>& curve{ fitter.finish() };
+                ok = ok && curve.size() >= 4 && (curve.size() - 1) % 3 == 0;
+                kept += fitter.getKeptCount();
+                points += curve.size();
+            }
+            double ms{ total.elapsedMs() };
+            std::size_t sampleCount{ strokes * kSamples };
+
+            bench.begin();
+            bench.field("stroke", kind.kind);
+            bench.field("tolerance", static_cast<double>(tolerance));
+            bench.field("strokes", strokes);
+            bench.field("samples", sampleCount);
+            bench.field("samples_per_second", static_cast<double>(sampleCount) / ms * 1000.0);
+            bench.field("us_per_sample", ms * 1000.0 / static_cast<double>(sampleCount));
+            bench.field("slowest_sample_us", slowestMs * 1000.0);
+            bench.field("kept_points", kept);
+            bench.field("curve_points", points);
+            bench.field("segments", (points - strokes) / 3);
+            bench.field("points_saved", 1.0 - static_cast<double>(points) / static_cast<double>(sampleCount));
+        }
+    }
+
+    if (!ok)
+    {
+        std::fprintf(stderr, "a finished curve isn't a start point and three points per segment\n");
+    }
+    return bench.finish() && ok ? 0 : 1;
+}
@@ -0,0 +1,438 @@
+// store-layout-bench: paint, hit-test, cull and move throughput of the column store against the layout it
+// replaced, a vector of shared_ptr to polymorphic shapes that each own a heap-allocated pen and brush. The
+// old classes are reproduced below as they were, with GDI+'s Pen and SolidBrush swapped for plain heap
+// objects and Graphics for a RenderBackend, so both layouts draw through the same counting backend.
+//
+// Both sides scan every shape, as the old DRAW_SHAPES did; the spatial index is left out so only the layout
+// is measured (model-bench covers the indexed paths).
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <random>
+#include <vector>
+#include "Bench.h"
+#include "CountingBackend.h"
+#include "ShapeStore.h"
+
+constexpr int kPaints{ 10 };
+constexpr int kHitTests{ 1000 };
+constexpr int kCulls{ 100 };
+constexpr int kMoves{ 10 };
+
+// the old Shape hierarchy
+namespace old
+{
+    struct Pen
+    {
+        std::uint32_t color;
+        float width;
+    };
+
+    struct SolidBrush
+    {
+        std::uint32_t color;
+    };
+
+    class Shape
+    {
+    public:
+        Shape(std::uint32_t color, int width, bool filled) : m_color(color), m_width(width), m_filled(filled) { setTools(color, width); }
+        virtual ~Shape() = default;
+
+        void setTools(std::uint32_t color, int width)
+        {
+            m_color = color;
+            m_width = width;
+            m_brush = std::make_unique<SolidBrush>(SolidBrush{ color });
+            m_pen = std::make_unique<Pen>(Pen{ color, static_cast<float>(width) });
+        }
+
+        virtual void draw(RenderBackend& backend) const = 0;
+        virtual bool hitTest(int x, int y) = 0;
+        virtual void move(float dx, float dy) = 0;
+        virtual RenderPoint getCorner() const = 0;
+        virtual int getLength() const = 0;
+        virtual int getHeight() const = 0;
+
+        const Pen* getPen() const { return m_pen.get(); }
+        const SolidBrush* getBrush() const { return m_filled ? m_brush.get() : nullptr; }
+        bool isFilled() const { return m_filled; }
+
+        void setSelX(int x) { m_selX = x; }
+        void setSelY(int y) { m_selY = y; }
+        int getSelX() const { return m_selX; }
+        int getSelY() const { return m_selY; }
+
+    private:
+        std::uint32_t m_color;
+        int m_width;
+        int m_selX{ 0 };
+        int m_selY{ 0 };
+        bool m_filled;
+        std::unique_ptr<Pen> m_pen;
+        std::unique_ptr<SolidBrush> m_brush;
+    };
+
+    class LineShape : public Shape
+    {
+    public:
+        LineShape(RenderPoint a, RenderPoint b, std::uint32_t color, int width) : Shape(color, width, false), m_a(a), m_b(b) { setHiLo(); }
+
+        void setHiLo()
+        {
+            hiX = static_cast<int>((std::max)(m_a.x, m_b.x));
+            loX = static_cast<int>((std::min)(m_a.x, m_b.x));
+            hiY = static_cast<int>((std::max)(m_a.y, m_b.y));
+            loY = static_cast<int>((std::min)(m_a.y, m_b.y));
+        }
+
+        bool hitTest(int x, int y) override
+        {
+            if (x <= hiX && x >= loX && y <= hiY && y >= loY)
+            {
+                setSelX(x);
+                setSelY(y);
+                return true;
+            }
+            return false;
+        }
+
+        RenderPoint getCorner() const override { return RenderPoint{ static_cast<float>(loX), static_cast<float>(loY) }; }
+        int getLength() const override { return hiX - loX; }
+        int getHeight() const override { return hiY - loY; }
+
+        void move(float dx, float dy) override
+        {
+            float moveX{ dx - getSelX() };
+            float moveY{ dy - getSelY() };
+            m_a = m_a + RenderPoint{ moveX, moveY };
+            m_b = m_b + RenderPoint{ moveX, moveY };
+            setSelX(static_cast<int>(dx));
+            setSelY(static_cast<int>(dy));
+            setHiLo();
+        }
+
+        void draw(RenderBackend& backend) const override { backend.drawLine(m_a.x, m_a.y, m_b.x, m_b.y, getPen()->color, getPen()->width); }
+
+    private:
+        RenderPoint m_a;
+        RenderPoint m_b;
+        int hiX, loX, hiY, loY;
+    };
+
+    // the ellipse and rectangle kept a corner and a size, and differed only in what they drew
+    template<bool Ellipse>
+    class BoxShape : public Shape
+    {
+    public:
+        BoxShape(RenderPoint corner, float width, float height, std::uint32_t color, int w, bool f) : Shape(color, w, f), m_corner(corner), m_width(width), m_height(height) {}
+
+        void draw(RenderBackend& backend) const override
+        {
+            const SolidBrush* brush{ getBrush() };
+            std::uint32_t color{ brush ? brush->color : getPen()->color };
+            if (Ellipse)
+            {
+                backend.drawEllipse(m_corner.x, m_corner.y, m_width, m_height, color, getPen()->width, isFilled());
+            }
+            else
+            {
+                backend.drawRect(m_corner.x, m_corner.y, m_width, m_height, color, getPen()->width, isFilled());
+            }
+        }
+
+        bool hitTest(int x, int y) override
+        {
+            if (x <= m_corner.x + m_width && x >= m_corner.x && y <= m_corner.y + m_height && y >= m_corner.y)
+            {
+                setSelX(x);
+                setSelY(y);
+                return true;
+            }
+            return false;
+        }
+
+        RenderPoint getCorner() const override { return m_corner; }
+        int getLength() const override { return static_cast<int>(m_width); }
+        int getHeight() const override { return static_cast<int>(m_height); }
+
+        void move(float dx, float dy) override
+        {
+            m_corner = m_corner + RenderPoint{ dx - getSelX(), dy - getSelY() };
+            setSelX(static_cast<int>(dx));
+            setSelY(static_cast<int>(dy));
+        }
+
+    private:
+        RenderPoint m_corner;
+        float m_width;
+        float m_height;
+    };
+
+    class TriShape : public Shape
+    {
+    public:
+        TriShape(RenderPoint p1, RenderPoint p2, RenderPoint p3, std::uint32_t color, int w, bool f) : Shape(color, w, f), m_points{ p1, p2, p3 } { setHiLo(); }
+
+        void setHiLo()
+        {
+            hiX = loX = m_points[0].x;
+            hiY = loY = m_points[0].y;
+            for (const RenderPoint& p : m_points)
+            {
+                hiX = (std::max)(hiX, p.x);
+                loX = (std::min)(loX, p.x);
+                hiY = (std::max)(hiY, p.y);
+                loY = (std::min)(loY, p.y);
+            }
+        }
+
+        void draw(RenderBackend& backend) const override
+        {
+            const SolidBrush* brush{ getBrush() };
+            backend.drawPolygon(m_points, 3, brush ? brush->color : getPen()->color, getPen()->width, isFilled());
+        }
+
+        bool hitTest(int x, int y) override
+        {
+            if (x <= hiX && x >= loX && y <= hiY && y >= loY)
+            {
+                setSelX(x);
+                setSelY(y);
+                return true;
+            }
+            return false;
+        }
+
+        RenderPoint getCorner() const override { return RenderPoint{ loX, loY }; }
+        int getLength() const override { return static_cast<int>(hiX - loX); }
+        int getHeight() const override { return static_cast<int>(hiY - loY); }
+
+        void move(float dx, float dy) override
+        {
+            RenderPoint by{ dx - getSelX(), dy - getSelY() };
+            for (RenderPoint& p : m_points)
+            {
+                p = p + by;
+            }
+            setSelX(static_cast<int>(dx));
+            setSelY(static_cast<int>(dy));
+            setHiLo();
+        }
+
+    private:
+        RenderPoint m_points[3];
+        float hiX, loX, hiY, loY;
+    };
+}
+
+struct Timings
+{
+    double paintMs{ 0.0 };
+    double hitTestUs{ 0.0 };
+    double cullMs{ 0.0 };
+    double moveMs{ 0.0 };
+    std::size_t drawCalls{ 0 };
+    std::size_t hits{ 0 };
+    std::size_t culled{ 0 };
+};
+
+void report(BenchReport& bench, const char* layout, std::size_t shapes, const Timings& t, const Timings& baseline)
+{
+    bench.begin();
+    bench.field("layout", layout);
+    bench.field("shapes", shapes);
+    bench.field("paint_ms", t.paintMs);
+    bench.field("paint_mshapes_per_s", shapes / t.paintMs / 1000.0);
+    bench.field("paint_speedup", baseline.paintMs / t.paintMs);
+    bench.field("hit_test_us", t.hitTestUs);
+    bench.field("hit_test_speedup", baseline.hitTestUs / t.hitTestUs);
+    bench.field("cull_ms", t.cullMs);
+    bench.field("move_all_ms", t.moveMs);
+    bench.field("draw_calls", t.drawCalls);
+    bench.field("hits", t.hits);
+    bench.field("culled", t.culled);
+}
+
+void run(BenchReport& bench, std::size_t count, int hitTests)
+{
+    std::mt19937 rng{ 5 };
+    float side{ std::sqrt(static_cast<float>(count)) * 40.0f };
+    std::uniform_real_distribution<float> anywhere{ 0.0f, side };
+
+    // the same shapes both ways
+    std::vector<std::shared_ptr<old::Shape>> shapes;
+    ShapeStore store;
+    for (std::size_t i{ 0 }; i < count; ++i)
+    {
+        RenderPoint p{ anywhere(rng), anywhere(rng) };
+        bool filled{ i % 8 == 1 };
+        switch (i % 4)
+        {
+        case 0:
+        {
+            shapes.push_back(std::make_shared<old::LineShape>(p, p + RenderPoint{ 20.0f, 10.0f }, 0xFF000000, 2));
+            float xy[4]{ p.x, p.y, p.x + 20.0f, p.y + 10.0f };
+            store.add(ShapeKind::Line, xy, 2, 0xFF000000, 2, false);
+            break;
+        }
+        case 1:
+        {
+            shapes.push_back(std::make_shared<old::BoxShape<true>>(p, 20.0f, 15.0f, 0xFF204080, 2, filled));
+            float xy[4]{ p.x, p.y, p.x + 20.0f, p.y + 15.0f };
+            store.add(ShapeKind::Ellipse, xy, 2, 0xFF204080, 2, filled);
+            break;
+        }
+        case 2:
+        {
+            shapes.push_back(std::make_shared<old::BoxShape<false>>(p, 20.0f, 15.0f, 0xFF000000, 2, false));
+            float xy[4]{ p.x, p.y, p.x + 20.0f, p.y + 15.0f };
+            store.add(ShapeKind::Rect, xy, 2, 0xFF000000, 2, false);
+            break;
+        }
+        default:
+        {
+            RenderPoint b{ p + RenderPoint{ 20.0f, 0.0f } };
+            RenderPoint c{ p + RenderPoint{ 10.0f, 15.0f } };
+            shapes.push_back(std::make_shared<old::TriShape>(p, b, c, 0xFF800000, 2, false));
+            float xy[6]{ p.x, p.y, b.x, b.y, c.x, c.y };
+            store.add(ShapeKind::Triangle, xy, 3, 0xFF800000, 2, false);
+            break;
+        }
+        }
+    }
+
+    std::vector<RenderPoint> clicks;
+    std::vector<Bounds> views;
+    for (int i{ 0 }; i < hitTests; ++i)
+    {
+        clicks.push_back(RenderPoint{ anywhere(rng), anywhere(rng) });
+    }
+    for (int i{ 0 }; i < kCulls; ++i)
+    {
+        RenderPoint corner{ anywhere(rng), anywhere(rng) };
+        views.push_back(Bounds{ corner.x, corner.y, corner.x + 1280.0f, corner.y + 800.0f });
+    }
+
+    Timings before;
+    {
+        CountingBackend counter;
+        BenchClock clock;
+        for (int paint{ 0 }; paint < kPaints; ++paint)
+        {
+            for (const auto& shape : shapes)
+            {
+                shape->draw(counter);
+            }
+        }
+        before.paintMs = clock.elapsedMs() / kPaints;
+        before.drawCalls = counter.calls / kPaints;
+
+        // topmost first, as selectShape scanned
+        clock.restart();
+        for (const RenderPoint& click : clicks)
+        {
+            for (auto it{ shapes.rbegin() }; it != shapes.rend(); ++it)
+            {
+                if ((*it)->hitTest(static_cast<int>(click.x), static_cast<int>(click.y)))
+                {
+                    ++before.hits;
+                    break;
+                }
+            }
+        }
+        before.hitTestUs = clock.elapsedMs() * 1000.0 / hitTests;
+
+        clock.restart();
+        for (const Bounds& view : views)
+        {
+            for (const auto& shape : shapes)
+            {
+                RenderPoint corner{ shape->getCorner() };
+                Bounds bounds{ corner.x, corner.y, corner.x + shape->getLength(), corner.y + shape->getHeight() };
+                before.culled += bounds.intersects(view) ? 1 : 0;
+            }
+        }
+        before.cullMs = clock.elapsedMs() / kCulls;
+
+        clock.restart();
+        for (int move{ 0 }; move < kMoves; ++move)
+        {
+            for (const auto& shape : shapes)
+            {
+                shape->move(static_cast<float>(shape->getSelX() + 1), static_cast<float>(shape->getSelY() + 1));
+            }
+        }
+        before.moveMs = clock.elapsedMs() / kMoves;
+    }
+    report(bench, "shared_ptr", count, before, before);
+
+    Timings after;
+    {
+        CountingBackend counter;
+        BenchClock clock;
+        for (int paint{ 0 }; paint < kPaints; ++paint)
+        {
+            for (std::size_t i{ 0 }; i < store.size(); ++i)
+            {
+                store.render(store.getHandle(i), counter);
+            }
+        }
+        after.paintMs = clock.elapsedMs() / kPaints;
+        after.drawCalls = counter.calls / kPaints;
+
+        clock.restart();
+        for (const RenderPoint& click : clicks)
+        {
+            for (std::size_t i{ store.size() }; i-- > 0;)
+            {
+                if (store.hitTest(store.getHandle(i), click.x, click.y))
+                {
+                    ++after.hits;
+                    break;
+                }
+            }
+        }
+        after.hitTestUs = clock.elapsedMs() * 1000.0 / hitTests;
+
+        clock.restart();
+        for (const Bounds& view : views)
+        {
+            for (std::size_t i{ 0 }; i < store.size(); ++i)
+            {
+                after.culled += store.getBounds(store.getHandle(i)).intersects(view) ? 1 : 0;
+            }
+        }
+        after.cullMs = clock.elapsedMs() / kCulls;
+
+        clock.restart();
+        for (int move{ 0 }; move < kMoves; ++move)
+        {
+            for (std::size_t i{ 0 }; i < store.size(); ++i)
+            {
+                store.translate(store.getHandle(i), 1.0f, 1.0f);
+            }
+        }
+        after.moveMs = clock.elapsedMs() / kMoves;
+    }
+    report(bench, "columns", count, after, before);
+}
+
+int main(int argc, char** argv)
+{
+    BenchReport bench{ "store-layout", argc, argv };
+
+    if (bench.isQuick())
+    {
+        run(bench, 10000, 100);
+    }
+    else
+    {
+        run(bench, 100000, kHitTests);
+    }
+
+    return bench.finish() ? 0 : 1;
+}
@@ -0,0 +1,517 @@
+// tile-cache-bench: frames per second painting a 50k-shape document the way WM_PAINT does, headless. The
+// direct painter rasterizes everything under the damage each frame; the tiled painter draws the static
+// layer into 256-pixel tiles once, on the TileRenderer's workers from one recorded DisplayList, copies the
+// tiles into the frame, and rasterizes only the live selection over them.
+//
+// Four runs: repainting the whole view, panning it, dragging one shape, and repainting the view with a
+// budget of fewer tiles than it covers. The tiled painter waits for its workers, so a frame's time includes
+// redrawing its stale tiles, where the window would show the old pixels for a frame. At the end the tiled
+// frame is compared with the document drawn whole in the same order, the static layer then the live one;
+// it fails if a pixel differs by more than the rasterizer's rounding.
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <random>
+#include <vector>
+#include "Bench.h"
+#include "DisplayList.h"
+#include "RasterBackend.h"
+#include "Simple Score.h"
+#include "TileCache.h"
+#include "TileRenderer.h"
+
+constexpr float kCanvasWidth{ 8000.0f };
+constexpr float kCanvasHeight{ 4800.0f };
+constexpr int kViewWidth{ 1600 };
+constexpr int kViewHeight{ 1000 };
+constexpr int kTileSize{ 256 };
+constexpr std::uint32_t kPaper{ 0xFFFFFFFF };
+
+// the most any channel may differ by before a pixel counts as wrong. Coverage is computed from coordinates
+// shifted to each tile's corner, so each fill can land a level apart, and where half-transparent shapes
+// stack those levels add up.
+constexpr int kRounding{ 3 };
+
+GlyphOutlines leland;
+
+struct Scene
+{
+    std::unique_ptr<DRAW_SHAPES> drawing{ std::make_unique<DRAW_SHAPES>() };
+    std::unique_ptr<SCORE> score{ std::make_unique<SCORE>() };
+
+    // in the window's order: the drawing, then the score over it
+    void drawAll(RenderBackend& backend, const Bounds& area)
+    {
+        drawing->drawStoredShapes(backend, area);
+        score->drawStoredElements(backend, area);
+    }
+
+    void drawStatic(RenderBackend& backend, const Bounds& area)
+    {
+        drawing->drawStaticShapes(backend, area);
+        score->drawStaticElements(backend, area);
+    }
+
+    void drawLive(RenderBackend& backend, const Bounds& area)
+    {
+        drawing->drawLiveShapes(backend, area);
+        score->drawLiveElements(backend, area);
+    }
+
+    void takeDirty(DirtyRegion& dirty)
+    {
+        drawing->takeDirty(dirty);
+        score->takeDirty(dirty);
+    }
+
+    void takeStale(DirtyRegion& stale)
+    {
+        drawing->takeStale(stale);
+        score->takeStale(stale);
+    }
+};
+
+// shapes of every kind spread over the canvas, every fifth one locked, and a score of staves with notes
+void makeDocument(Scene& scene, std::size_t count)
+{
+    std::mt19937 rng{ 11 };
+    std::uniform_real_distribution<float> x{ 0.0f, kCanvasWidth };
+    std::uniform_real_distribution<float> y{ 0.0f, kCanvasHeight };
+    std::uniform_real_distribution<float> size{ 6.0f, 90.0f };
+
+    // built as a store, the way a document is opened, so every fifth shape can be locked
+    std::size_t elements{ count / 10 };
+    ShapeStore store;
+    for (std::size_t i{ 0 }; i < count - elements; ++i)
+    {
+        float left{ x(rng) };
+        float top{ y(rng) };
+        float right{ left + size(rng) };
+        float bottom{ top + size(rng) };
+        float xy[6]{ left, top, right, bottom, (left + right) / 2.0f, bottom };
+        ShapeHandle shape{ kNoShape };
+        switch (i % 4)
+        {
+        case 0:
+            shape = store.add(ShapeKind::Rect, xy, 2, 0xFF000000, 2, false);
+            break;
+        case 1:
+            shape = store.add(ShapeKind::Ellipse, xy, 2, 0x80204080, 2, true);
+            break;
+        case 2:
+            shape = store.add(ShapeKind::Line, xy, 2, 0xFF800000, 3, false);
+            break;
+        default:
+            xy[3] = top;
+            shape = store.add(ShapeKind::Triangle, xy, 3, 0xFF000080, 1, false);
+            break;
+        }
+        store.setLocked(shape, i % 5 == 0);
+    }
+    scene.drawing->setShapes(std::move(store));
+
+    std::size_t measures{ 0 };
+    for (float staff{ 40.0f }; staff < kCanvasHeight && measures < elements / 4; staff += 84.0f)
+    {
+        for (float left{ 20.0f }; left + 400.0f < kCanvasWidth && measures < elements / 4; left += 400.0f, ++measures)
+        {
+            scene.score->addMeasure(RenderPoint{ left, staff }, 400);
+        }
+    }
+    for (std::size_t i{ measures }; i < elements; ++i)
+    {
+        scene.score->addSymbol(RenderPoint{ x(rng), y(rng) }, 28, i % 2 == 0 ? L"\xE0A4" : L"\xE4E5");
+    }
+    scene.score->endEdit();
+
+    DirtyRegion ignored;
+    scene.takeDirty(ignored);
+    scene.takeStale(ignored);
+}
+
+// the window's surface: one view's worth of pixels, its top left corner at a canvas position
+struct Frame
+{
+    int left{ 0 };
+    int top{ 0 };
+    std::vector<std::uint32_t> pixels;
+
+    Frame(int x, int y) : left(x), top(y), pixels(static_cast<std::size_t>(kViewWidth) * kViewHeight, kPaper) {}
+
+    Bounds getBounds() const
+    {
+        return Bounds{ static_cast<float>(left), static_cast<float>(top), static_cast<float>(left + kViewWidth), static_cast<float>(top + kViewHeight) };
+    }
+
+    // the pixel-aligned part of a canvas area the frame shows, as invalidateDirty widens damage
+    Bounds clip(const Bounds& area) const
+    {
+        Bounds view{ getBounds() };
+        Bounds clipped{ (std::max)(view.left, std::floor(area.left)), (std::max)(view.top, std::floor(area.top)),
+            (std::min)(view.right, std::ceil(area.right) + 1.0f), (std::min)(view.bottom, std::ceil(area.bottom) + 1.0f) };
+        return clipped.right > clipped.left && clipped.bottom > clipped.top ? clipped : Bounds::empty();
+    }
+
+    std::uint32_t* row(int canvasY, int canvasX) { return &pixels[static_cast<std::size_t>(canvasY - top) * kViewWidth + (canvasX - left)]; }
+};
+
+// repaints everything under each area, as WM_PAINT did before the tiles
+class DirectPainter
+{
+public:
+    void paint(Scene& scene, Frame& frame, const Bounds& damage)
+    {
+        Bounds area{ frame.clip(damage) };
+        if (area.isEmpty())
+        {
+            return;
+        }
+
+        int left{ static_cast<int>(area.left) };
+        int top{ static_cast<int>(area.top) };
+        int width{ static_cast<int>(area.right) - left };
+        int height{ static_cast<int>(area.bottom) - top };
+        m_raster.resize(width, height);
+        m_raster.clear(kPaper);
+        m_raster.setView(Transform::translation(-area.left, -area.top));
+        scene.drawAll(m_raster, area);
+
+        const std::uint32_t* pixels{ m_raster.getPixels() };
+        for (int y{ 0 }; y < height; ++y)
+        {
+            std::copy(pixels + static_cast<std::size_t>(y) * width, pixels + static_cast<std::size_t>(y + 1) * width, frame.row(top + y, left));
+        }
+    }
+
+private:
+    RasterBackend m_raster{ leland.isOpen() ? &leland : nullptr };
+};
+
+// copies cached tiles of the static layer under each area and rasterizes the live layer over them
+class TiledPainter
+{
+public:
+    explicit TiledPainter(std::size_t budget) : m_tiles(kTileSize, budget) {}
+
+    TileCache<std::vector<std::uint32_t>>& getTiles() { return m_tiles; }
+    std::size_t getTilesDrawn() const { return m_tilesDrawn; }
+
+    // marks the tiles under changes to the static layer for redrawing, as invalidateTiles does
+    void invalidate(Scene& scene)
+    {
+        DirtyRegion stale;
+        scene.takeStale(stale);
+        for (const Bounds& bounds : stale.getRects())
+        {
+            m_tiles.invalidate(bounds.inflated(1.0f));
+        }
+    }
+
+    void paint(Scene& scene, Frame& frame, const Bounds& damage)
+    {
+        Bounds area{ frame.clip(damage) };
+        if (area.isEmpty())
+        {
+            return;
+        }
+
+        drawStaleTiles(scene, area);
+
+        m_tiles.forEachTile(area, [&](TileCache<std::vector<std::uint32_t>>::Tile& tile) {
+            if (!tile.valid)
+            {
+                // evicted while the others were drawn, under a budget smaller than the area
+                drawStaleTiles(scene, m_tiles.getTileBounds(tile.column, tile.row));
+            }
+
+            Bounds bounds{ m_tiles.getTileBounds(tile.column, tile.row) };
+            int left{ static_cast<int>((std::max)(bounds.left, area.left)) };
+            int right{ static_cast<int>((std::min)(bounds.right, area.right)) };
+            int top{ static_cast<int>((std::max)(bounds.top, area.top)) };
+            int bottom{ static_cast<int>((std::min)(bounds.bottom, area.bottom)) };
+            for (int y{ top }; y < bottom; ++y)
+            {
+                const std::uint32_t* source{ &tile.surface[static_cast<std::size_t>(y - static_cast<int>(bounds.top)) * kTileSize + (left - static_cast<int>(bounds.left))] };
+                std::copy(source, source + (right - left), frame.row(y, left));
+            }
+        });
+
+        // the live layer goes over the tiles, blended as GDI+ draws it over the composited bitmap
+        int left{ static_cast<int>(area.left) };
+        int top{ static_cast<int>(area.top) };
+        int width{ static_cast<int>(area.right) - left };
+        int height{ static_cast<int>(area.bottom) - top };
+        m_live.resize(width, height);
+        m_live.clear(0x00000000);
+        m_live.setView(Transform::translation(-area.left, -area.top));
+        scene.drawLive(m_live, area);
+
+        const std::uint32_t* pixels{ m_live.getPixels() };
+        for (int y{ 0 }; y < height; ++y)
+        {
+            std::uint32_t* target{ frame.row(top + y, left) };
+            for (int x{ 0 }; x < width; ++x)
+            {
+                std::uint32_t source{ pixels[static_cast<std::size_t>(y) * width + x] };
+                if (source != 0)
+                {
+                    target[x] = blend(source, target[x]);
+                }
+            }
+        }
+    }
+
+private:
+    TileCache<std::vector<std::uint32_t>> m_tiles;
+    TileRenderer m_renderer{ kLelandPath, nullptr };
+    RasterBackend m_live{ leland.isOpen() ? &leland : nullptr };
+    std::size_t m_tilesDrawn{ 0 };
+
+    // as compositeTiles: records the static layer under the stale tiles once and has the workers draw them
+    void drawStaleTiles(Scene& scene, const Bounds& area)
+    {
+        struct StaleTile
+        {
+            int column;
+            int row;
+            std::uint64_t revision;
+        };
+        std::vector<StaleTile> stale;
+        Bounds covered{ Bounds::empty() };
+        m_tiles.forEachTile(area, [&](TileCache<std::vector<std::uint32_t>>::Tile& tile) {
+            if (!tile.valid)
+            {
+                stale.push_back(StaleTile{ tile.column, tile.row, tile.revision });
+                covered = covered.united(m_tiles.getTileBounds(tile.column, tile.row));
+            }
+        });
+        if (stale.empty())
+        {
+            return;
+        }
+
+        auto recorded{ std::make_shared<DisplayList>(1.0f) };
+        scene.drawStatic(*recorded, covered);
+        for (const StaleTile& tile : stale)
+        {
+            m_renderer.request(tile.column, tile.row, tile.revision, kTileSize, 1.0f, recorded);
+        }
+        m_renderer.wait();
+
+        std::vector<RenderedTile> finished;
+        m_renderer.takeFinished(finished);
+        for (RenderedTile& rendered : finished)
+        {
+            ++m_tilesDrawn;
+            auto* tile{ m_tiles.find(rendered.column, rendered.row) };
+            if (tile && tile->revision == rendered.revision)
+            {
+                tile->surface = std::move(rendered.pixels);
+                tile->valid = true;
+            }
+        }
+    }
+
+    // premultiplied source over destination
+    static std::uint32_t blend(std::uint32_t source, std::uint32_t target)
+    {
+        std::uint32_t keep{ 255 - (source >> 24) };
+        std::uint32_t result{ 0 };
+        for (int shift{ 0 }; shift < 32; shift += 8)
+        {
+            std::uint32_t channel{ ((source >> shift) & 0xFF) + (((target >> shift) & 0xFF) * keep + 127) / 255 };
+            result |= (std::min)(channel, 255u) << shift;
+        }
+        return result;
+    }
+};
+
+// frames per second from the milliseconds a number of frames took
+double fps(double ms, int frames)
+{
+    return ms > 0.0 ? frames * 1000.0 / ms : 0.0;
+}
+
+void report(BenchReport& bench, const char* run, std::size_t shapes, int frames, double directMs, double tiledMs, std::size_t tilesDrawn, TiledPainter& tiled)
+{
+    bench.begin();
+    bench.field("run", run);
+    bench.field("shapes", shapes);
+    bench.field("frames", frames);
+    bench.field("direct_fps", fps(directMs, frames));
+    bench.field("tiled_fps", fps(tiledMs, frames));
+    bench.field("speedup", directMs / tiledMs);
+    bench.field("tiles_drawn", tilesDrawn);
+    bench.field("tiles_cached", tiled.getTiles().size());
+    bench.field("tile_bytes", tiled.getTiles().getBytes());
+    bench.field("evictions", tiled.getTiles().getEvictions());
+}
+
+int main(int argc, char** argv)
+{
+    BenchReport bench{ "tile-cache", argc, argv };
+    leland.open(kLelandPath);
+
+    std::size_t shapes{ bench.isQuick() ? std::size_t{ 5000 } : std::size_t{ 50000 } };
+    int frames{ bench.isQuick() ? 5 : 60 };
+
+    // each painter keeps its own copy of the document, edited the same way
+    Scene directScene;
+    Scene tiledScene;
+    makeDocument(directScene, shapes);
+    makeDocument(tiledScene, shapes);
+
+    DirectPainter direct;
+    TiledPainter tiled{ 64u << 20 };
+    Frame directFrame{ 2400, 1600 };
+    Frame tiledFrame{ 2400, 1600 };
+
+    // the whole view, over and over; the first tiled frame draws every tile
+    BenchClock clock;
+    tiled.paint(tiledScene, tiledFrame, tiledFrame.getBounds());
+    double coldMs{ clock.elapsedMs() };
+    std::size_t drawn{ tiled.getTilesDrawn() };
+
+    clock.restart();
+    for (int i{ 0 }; i < frames; ++i)
+    {
+        direct.paint(directScene, directFrame, directFrame.getBounds());
+    }
+    double directMs{ clock.elapsedMs() };
+    clock.restart();
+    for (int i{ 0 }; i < frames; ++i)
+    {
+        tiled.paint(tiledScene, tiledFrame, tiledFrame.getBounds());
+    }
+    double tiledMs{ clock.elapsedMs() };
+    report(bench, "repaint", shapes, frames, directMs, tiledMs, tiled.getTilesDrawn() - drawn, tiled);
+    bench.field("cold_tiled_ms", coldMs);
+
+    // panning right and down: a scroll repaints the whole view, and the tiled painter draws the new tiles
+    drawn = tiled.getTilesDrawn();
+    directMs = 0.0;
+    tiledMs = 0.0;
+    for (int i{ 0 }; i < frames; ++i)
+    {
+        directFrame.left += 24;
+        directFrame.top += 8;
+        tiledFrame.left += 24;
+        tiledFrame.top += 8;
+        clock.restart();
+        direct.paint(directScene, directFrame, directFrame.getBounds());
+        directMs += clock.elapsedMs();
+        clock.restart();
+        tiled.paint(tiledScene, tiledFrame, tiledFrame.getBounds());
+        tiledMs += clock.elapsedMs();
+    }
+    report(bench, "pan", shapes, frames, directMs, tiledMs, tiled.getTilesDrawn() - drawn, tiled);
+
+    // dragging a shape: each frame repaints where it was and where it is; taking it out of the static
+    // layer redraws the tiles under it once, on the first frame
+    int x{ 0 };
+    int y{ 0 };
+    std::mt19937 rng{ 5 };
+    std::uniform_int_distribution<int> anyX{ directFrame.left + 200, directFrame.left + kViewWidth - 600 };
+    std::uniform_int_distribution<int> anyY{ directFrame.top + 200, directFrame.top + kViewHeight - 400 };
+    bool hit{ false };
+    for (int attempt{ 0 }; attempt < 1000 && !hit; ++attempt)
+    {
+        x = anyX(rng);
+        y = anyY(rng);
+        directScene.drawing->selectShape(x, y);
+        tiledScene.drawing->selectShape(x, y);
+        hit = directScene.drawing->isMoving() && !directScene.drawing->getShapes().isLocked(directScene.drawing->getSelected());
+        if (!hit)
+        {
+            directScene.drawing->unSelect();
+            tiledScene.drawing->unSelect();
+        }
+    }
+
+    drawn = tiled.getTilesDrawn();
+    directMs = 0.0;
+    tiledMs = 0.0;
+    for (int i{ 0 }; i < frames; ++i)
+    {
+        x += 3;
+        y += 1;
+        directScene.drawing->moveShape(x, y);
+        tiledScene.drawing->moveShape(x, y);
+
+        clock.restart();
+        DirtyRegion dirty;
+        directScene.takeDirty(dirty);
+        DirtyRegion ignored;
+        directScene.takeStale(ignored);
+        for (const Bounds& damage : dirty.getRects())
+        {
+            direct.paint(directScene, directFrame, damage);
+        }
+        directMs += clock.elapsedMs();
+
+        clock.restart();
+        tiled.invalidate(tiledScene);
+        dirty.clear();
+        tiledScene.takeDirty(dirty);
+        for (const Bounds& damage : dirty.getRects())
+        {
+            tiled.paint(tiledScene, tiledFrame, damage);
+        }
+        tiledMs += clock.elapsedMs();
+    }
+    report(bench, "drag", shapes, frames, directMs, tiledMs, tiled.getTilesDrawn() - drawn, tiled);
+    bench.field("dragged", hit);
+
+    // the tiled frame, painted only where there was damage, against one raster of the same document drawn in
+    // the tiled window's order: the static layer, then the live selection over it whatever its z order
+    RasterBackend layered(leland.isOpen() ? &leland : nullptr);
+    layered.resize(kViewWidth, kViewHeight);
+    layered.clear(kPaper);
+    layered.setView(Transform::translation(static_cast<float>(-tiledFrame.left), static_cast<float>(-tiledFrame.top)));
+    tiledScene.drawStatic(layered, tiledFrame.getBounds());
+    tiledScene.drawLive(layered, tiledFrame.getBounds());
+    std::size_t rounded{ 0 };
+    std::size_t mismatched{ 0 };
+    for (std::size_t i{ 0 }; i < tiledFrame.pixels.size(); ++i)
+    {
+        int difference{ channelDifference(layered.getPixels()[i], tiledFrame.pixels[i]) };
+        rounded += difference > 0 && difference <= kRounding ? 1 : 0;
+        mismatched += difference > kRounding ? 1 : 0;
+    }
+    bench.field("rounded_pixels", rounded);
+    bench.field("mismatched_pixels", mismatched);
+
+    // a budget of eight tiles, fewer than the view covers: every repaint evicts and redraws tiles
+    TiledPainter starved{ 8 * static_cast<std::size_t>(kTileSize) * kTileSize * 4 };
+    int starvedFrames{ (std::max)(1, frames / 10) };
+    clock.restart();
+    for (int i{ 0 }; i < starvedFrames; ++i)
+    {
+        starved.paint(tiledScene, tiledFrame, tiledFrame.getBounds());
+    }
+    tiledMs = clock.elapsedMs();
+    clock.restart();
+    for (int i{ 0 }; i < starvedFrames; ++i)
+    {
+        direct.paint(tiledScene, directFrame, directFrame.getBounds());
+    }
+    directMs = clock.elapsedMs();
+    report(bench, "repaint_budget_8_tiles", shapes, starvedFrames, directMs, tiledMs, starved.getTilesDrawn(), starved);
+
+    bool ok{ bench.finish() };
+    if (!hit)
+    {
+        std::fprintf(stderr, "no unlocked shape to drag under any click\n");
+        ok = false;
+    }
+    if (mismatched > 0)
+    {
+        std::fprintf(stderr, "%zu pixels of the tiled frame differ from the document drawn whole\n", mismatched);
+        ok = false;
+    }
+    return ok ? 0 : 1;
+}
@@ -61,6 +61,17 @@
 #define ID_SCORE_SYMBOLS                32779
 #define ID_SCORE_SELECT                 32780
 #define ID_SCORE_TEXT                   32781
+#define ID_FILE_OPEN                    32782
+#define ID_FILE_SAVE                    32783
+#define ID_FILE_EXPORT                  32784
+#define ID_EDIT_UNDO                    32785
+#define ID_EDIT_REDO                    32786
+#define ID_EDIT_GROUP                   32787
+#define ID_EDIT_UNGROUP                 32788
+#define ID_VIEW_FRAMESTATS              32789
+#define ID_VIEW_EXPORTTRACE             32790
+#define ID_FILE_IMPORT                  32791
+#define ID_FILE_EXPORTMUSICXML          32792
 #define IDC_STATIC                      -1
 
 // Next default values for new objects
@@ -69,7 +80,7 @@
 #ifndef APSTUDIO_READONLY_SYMBOLS
 #define _APS_NO_MFC                     1
 #define _APS_NEXT_RESOURCE_VALUE        132
-#define _APS_NEXT_COMMAND_VALUE         32782
+#define _APS_NEXT_COMMAND_VALUE         32793
 #define _APS_NEXT_CONTROL_VALUE         1040
 #define _APS_NEXT_SYMED_VALUE           110
 #endif
@@ -0,0 +1,29 @@
+#pragma once
+
+#include <cstdio>
+
+// Counts failed checks and reports each as it happens, so one run shows everything that broke.
+// Tests return checks.result() from main.
+class Checks
+{
+public:
+	void check(bool passed, const char* what)
+	{
+		++m_run;
+		if (!passed)
+		{
+			++m_failed;
+			std::fprintf(stderr, "FAILED: %s\n", what);
+		}
+	}
+
+	int result() const
+	{
+		std::printf("%d of %d checks passed\n", m_run - m_failed, m_run);
+		return m_failed == 0 ? 0 : 1;
+	}
+
+private:
+	int m_run{ 0 };
+	int m_failed{ 0 };
+};
@@ -0,0 +1,129 @@
+// Checks that exporting a document writes only the pages something is on, however far apart, and that each
+// page draws what reaches it: a shape across a page edge on both pages, a grouped shape through its group.
+
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <vector>
+#include "DocumentExport.h"
+#include "tests/Check.h"
+
+namespace
+{
+    // what was drawn on one exported page
+    struct Page
+    {
+        float left{ 0.0f };
+        float top{ 0.0f };
+        int rects{ 0 };
+        float shiftX{ 0.0f }; // how far the last transform set moved things across
+    };
+
+    // keeps the pages an export begins and counts the rectangles on each, drawing nothing
+    class PageRecorder : public PageBackend
+    {
+    public:
+        std::vector<Page> pages;
+
+        bool beginPage(float left, float top, float, float) override
+        {
+            pages.push_back(Page{ left, top });
+            return true;
+        }
+        bool endPage() override { return true; }
+        bool finish() override { return true; }
+
+        void drawLine(float, float, float, float, std::uint32_t, float) override {}
+        void drawRect(float, float, float, float, std::uint32_t, float, bool) override { ++pages.back().rects; }
+        void drawEllipse(float, float, float, float, std::uint32_t, float, bool) override {}
+        void drawPolygon(const RenderPoint*, std::size_t, std::uint32_t, float, bool) override {}
+        void drawCurve(const RenderPoint*, std::size_t, std::uint32_t, float) override {}
+        void drawBeziers(const RenderPoint*, std::size_t, std::uint32_t, float) override {}
+        void drawText(const std::wstring&, float, float, const std::wstring&, float, std::uint32_t) override {}
+        void setTransform(const Transform& transform) override
+        {
+            if (!transform.isIdentity())
+            {
+                pages.back().shiftX = transform.tx;
+            }
+        }
+    };
+
+    std::filesystem::path scratchFile()
+    {
+        return std::filesystem::temp_directory_path() / "simple-score-export-test.ssd";
+    }
+
+    ShapeRecord makeRect(float x, float y, float width, float height)
+    {
+        ShapeRecord rect;
+        rect.kind = ShapeKind::Rect;
+        rect.values[0] = x;
+        rect.values[1] = y;
+        rect.values[2] = width;
+        rect.values[3] = height;
+        rect.bounds = Bounds{ x - 1.0f, y - 1.0f, x + width + 1.0f, y + height + 1.0f };
+        return rect;
+    }
+
+    // saves the records, exports them and hands back the pages written
+    std::vector<Page> exportRecords(const std::vector<ShapeRecord>& records)
+    {
+        DocumentWriter writer;
+        for (const ShapeRecord& record : records)
+        {
+            writer.add(record);
+        }
+        writer.save(scratchFile());
+
+        DocumentReader reader;
+        PageRecorder recorder;
+        if (!reader.open(scratchFile()) || !exportDocument(reader, recorder))
+        {
+            return {};
+        }
+        return recorder.pages;
+    }
+}
+
+int main()
+{
+    Checks checks;
+
+    std::vector<Page> pages{ exportRecords({}) };
+    checks.check(pages.size() == 1 && pages[0].left == 0.0f && pages[0].top == 0.0f, "an empty document still gets its first page");
+
+    // nine pages across and down from each other; the 98 pages between them stay blank and aren't written
+    pages = exportRecords({ makeRect(100.0f, 100.0f, 20.0f, 20.0f), makeRect(9 * kExportPageWidth + 100.0f, 9 * kExportPageHeight + 100.0f, 20.0f, 20.0f) });
+    checks.check(pages.size() == 2, "two small shapes far apart export two pages");
+    checks.check(pages.size() == 2 && pages[0].left == 0.0f && pages[0].top == 0.0f && pages[1].left == 9 * kExportPageWidth && pages[1].top == 9 * kExportPageHeight,
+        "the pages are the ones the shapes are on, in reading order");
+    checks.check(pages.size() == 2 && pages[0].rects == 1 && pages[1].rects == 1, "each page draws only the shape on it");
+
+    pages = exportRecords({ makeRect(kExportPageWidth - 40.0f, 100.0f, 80.0f, 20.0f) });
+    checks.check(pages.size() == 2 && pages[0].rects == 1 && pages[1].rects == 1, "a shape across a page edge is drawn on both pages");
+
+    ShapeRecord line;
+    line.kind = ShapeKind::Line;
+    line.values[2] = 200.0f;
+    line.values[3] = 200.0f;
+    line.bounds = Bounds{ -kPageSlack, -kPageSlack, 200.0f + kPageSlack, 200.0f + kPageSlack };
+    pages = exportRecords({ line });
+    checks.check(pages.size() == 1, "a line from the origin doesn't add pages above and left of it");
+
+    // a group moved three pages right, then a shape in it and one after it, back on the first page
+    ShapeRecord group;
+    group.kind = ShapeKind::Group;
+    group.transform = Transform::translation(3 * kExportPageWidth, 0.0f);
+    group.bounds = Bounds{ 3 * kExportPageWidth + 99.0f, 99.0f, 3 * kExportPageWidth + 121.0f, 121.0f };
+    ShapeRecord grouped{ makeRect(100.0f, 100.0f, 20.0f, 20.0f) };
+    grouped.bounds = group.bounds;
+    grouped.parent = 1;
+    pages = exportRecords({ group, grouped, makeRect(100.0f, 100.0f, 20.0f, 20.0f) });
+    checks.check(pages.size() == 2 && pages[0].left == 0.0f && pages[1].left == 3 * kExportPageWidth, "a grouped shape gives the page it's moved onto");
+    checks.check(pages.size() == 2 && pages[0].rects == 1 && pages[0].shiftX == 0.0f, "the shape after the group is drawn where it is");
+    checks.check(pages.size() == 2 && pages[1].rects == 1 && pages[1].shiftX == 3 * kExportPageWidth, "the grouped shape is drawn through its group's transform");
+
+    std::filesystem::remove(scratchFile());
+    return checks.result();
+}
@@ -0,0 +1,345 @@
+// Checks that a document whose records hold numbers no shape can have, e.g. NaN or 1e38 coordinates from a
+// damaged file, is turned away as damaged rather than loaded, and that an intact one still loads. Then that
+// a shape of every kind, and a transformed group of them, comes back from a saved document as it was.
+
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <limits>
+#include <string>
+#include <vector>
+#include "ShapeStore.h"
+#include "tests/Check.h"
+
+namespace
+{
+    // where the fields the damage goes into sit, from the section table and the record layout in DocumentFile.h
+    constexpr std::size_t kSectionTable{ 32 };
+    constexpr std::size_t kSectionEntry{ 24 };
+    constexpr std::size_t kRecordSize{ 112 };
+    constexpr std::size_t kStroke{ 8 };
+    constexpr std::size_t kValues{ 12 };
+    constexpr std::size_t kBounds{ 68 };
+    constexpr std::size_t kTransform{ 88 };
+
+    const float kInfinity{ std::numeric_limits<float>::infinity() };
+    const float kNaN{ std::numeric_limits<float>::quiet_NaN() };
+
+    std::filesystem::path scratchFile()
+    {
+        return std::filesystem::temp_directory_path() / "simple-score-document-test.ssd";
+    }
+
+    std::vector<std::uint8_t> readFile(const std::filesystem::path& path)
+    {
+        std::ifstream in(path, std::ios::binary);
+        return std::vector<std::uint8_t>(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+    }
+
+    void writeFile(const std::filesystem::path& path, const std::vector<std::uint8_t>& bytes)
+    {
+        std::ofstream out(path, std::ios::binary | std::ios::trunc);
+        out.write(reinterpret_cast<const char*>(bytes.data()), static_cast<std::streamsize>(bytes.size()));
+    }
+
+    std::uint64_t sectionOffset(const std::vector<std::uint8_t>& bytes, int section)
+    {
+        std::uint64_t offset{ 0 };
+        std::memcpy(&offset, bytes.data() + kSectionTable + section * kSectionEntry + 16, sizeof(offset));
+        return offset;
+    }
+
+    // reads every record into a store the way File > Open does; false if the document is damaged
+    bool load(const std::filesystem::path& path, std::size_t& loaded)
+    {
+        DocumentReader reader;
+        if (!reader.open(path))
+        {
+            return false;
+        }
+
+        ShapeStore store;
+        for (std::size_t i{ 0 }; i < reader.size(); ++i)
+        {
+            ShapeRecord record;
+            if (!reader.getRecord(i, record) || store.add(reader, record) == kNoShape)
+            {
+                return false;
+            }
+        }
+        loaded = store.size();
+        return true;
+    }
+
+    // a rectangle, a sketch through three points and a symbol
+    std::vector<std::uint8_t> writeDocument()
+    {
+        DocumentWriter writer;
+
+        ShapeRecord rect;
+        rect.kind = ShapeKind::Rect;
+        rect.stroke = 2;
+        rect.values[0] = 10.0f;
+        rect.values[1] = 20.0f;
+        rect.values[2] = 30.0f;
+        rect.values[3] = 40.0f;
+        rect.bounds = Bounds{ 9.0f, 19.0f, 41.0f, 61.0f };
+        writer.add(rect);
+
+        ShapeRecord sketch;
+        sketch.kind = ShapeKind::Sketch;
+        sketch.pointFirst = writer.getPointCount();
+        writer.addPoint(0.0f, 0.0f);
+        writer.addPoint(5.0f, 8.0f);
+        writer.addPoint(12.0f, 3.0f);
+        sketch.pointCount = 3;
+        sketch.bounds = Bounds{ -1.0f, -1.0f, 13.0f, 9.0f };
+        writer.add(sketch);
+
+        ShapeRecord symbol;
+        symbol.kind = ShapeKind::Symbol;
+        symbol.layer = DocumentLayer::Score;
+        symbol.values[0] = 100.0f;
+        symbol.values[1] = 50.0f;
+        symbol.values[2] = 28.0f;
+        writer.addString(L"\xE0A4", symbol.textOffset, symbol.textLength);
+        writer.addString(L"Leland", symbol.fontOffset, symbol.fontLength);
+        symbol.bounds = Bounds{ 100.0f, 50.0f, 128.0f, 78.0f };
+        writer.add(symbol);
+
+        writer.save(scratchFile());
+        return readFile(scratchFile());
+    }
+
+    // saves the roots of saved the way File > Save does and loads them into loaded the way File > Open does
+    bool saveAndLoad(const ShapeStore& saved, ShapeStore& loaded)
+    {
+        DocumentWriter writer;
+        for (std::size_t i{ 0 }; i < saved.size(); ++i)
+        {
+            ShapeHandle shape{ saved.getHandle(i) };
+            if (saved.getParent(shape) == kNoShape)
+            {
+                saved.write(shape, writer, DocumentLayer::Drawing);
+            }
+        }
+        if (!writer.save(scratchFile()))
+        {
+            return false;
+        }
+
+        DocumentReader reader;
+        if (!reader.open(scratchFile()))
+        {
+            return false;
+        }
+        for (std::size_t i{ 0 }; i < reader.size(); ++i)
+        {
+            ShapeRecord record;
+            if (!reader.getRecord(i, record) || loaded.add(reader, record) == kNoShape)
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // the store keeps a font only in what it snapshots
+    std::wstring fontOf(const ShapeStore& store, ShapeHandle shape)
+    {
+        ShapeSnapshot copy{ store.snapshot(shape) };
+        store.getStyleTable().release(copy.style);
+        return copy.font;
+    }
+
+    bool near(float a, float b)
+    {
+        return std::fabs(a - b) <= 1e-3f;
+    }
+
+    bool nearBounds(const Bounds& a, const Bounds& b)
+    {
+        return near(a.left, b.left) && near(a.top, b.top) && near(a.right, b.right) && near(a.bottom, b.bottom);
+    }
+
+    // Whether shape b of store b is shape a of store a: kind, style, text, points and transform, and for a
+    // group its children, in order. A shape that was only moved is saved where it ended up, so points are
+    // compared after their transform; one scaled or rotated must keep its transform and points as they were.
+    bool sameShape(const ShapeStore& storeA, ShapeHandle a, const ShapeStore& storeB, ShapeHandle b)
+    {
+        ShapeKind kind{ storeA.getKind(a) };
+        if (storeB.getKind(b) != kind || storeB.getColor(b) != storeA.getColor(a) || storeB.getStroke(b) != storeA.getStroke(a)
+            || storeB.isFilled(b) != storeA.isFilled(a) || storeB.isLocked(b) != storeA.isLocked(a) || !nearBounds(storeB.getBounds(b), storeA.getBounds(a)))
+        {
+            return false;
+        }
+
+        const Transform& transformA{ storeA.getTransform(a) };
+        const Transform& transformB{ storeB.getTransform(b) };
+        if ((!transformA.isTranslation() || kind == ShapeKind::Group) ? !(transformB == transformA) : !transformB.isTranslation())
+        {
+            return false;
+        }
+
+        if (kind == ShapeKind::Group)
+        {
+            const std::vector<ShapeHandle>& childrenA{ storeA.getChildren(a) };
+            const std::vector<ShapeHandle>& childrenB{ storeB.getChildren(b) };
+            if (childrenB.size() != childrenA.size())
+            {
+                return false;
+            }
+            for (std::size_t i{ 0 }; i < childrenA.size(); ++i)
+            {
+                if (!sameShape(storeA, childrenA[i], storeB, childrenB[i]))
+                {
+                    return false;
+                }
+            }
+            return true;
+        }
+
+        if (kind == ShapeKind::Symbol || kind == ShapeKind::Text)
+        {
+            // a symbol is always drawn in the score font, so only text keeps a family
+            if (storeB.getText(b) != storeA.getText(a) || storeB.getWidth(b) != storeA.getWidth(a) || (kind == ShapeKind::Text && fontOf(storeB, b) != fontOf(storeA, a)))
+            {
+                return false;
+            }
+        }
+
+        std::size_t count{ storeA.getPointCount(a) };
+        if (storeB.getPointCount(b) != count)
+        {
+            return false;
+        }
+        const float* xyA{ storeA.getPoints(a) };
+        const float* xyB{ storeB.getPoints(b) };
+        for (std::size_t p{ 0 }; p < count; ++p)
+        {
+            float x{ xyA[2 * p] };
+            float y{ xyA[2 * p + 1] };
+            if (!near(transformB.mapX(xyB[2 * p], xyB[2 * p + 1]), transformA.mapX(x, y)) || !near(transformB.mapY(xyB[2 * p], xyB[2 * p + 1]), transformA.mapY(x, y)))
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+}
+
+int main()
+{
+    Checks checks;
+
+    std::vector<std::uint8_t> intact{ writeDocument() };
+    std::size_t loaded{ 0 };
+    checks.check(load(scratchFile(), loaded) && loaded == 3, "an intact document loads");
+
+    std::uint64_t records{ sectionOffset(intact, 0) };
+    std::uint64_t points{ sectionOffset(intact, 1) };
+
+    struct Damage
+    {
+        const char* what;
+        std::uint64_t offset;
+        float value;
+    };
+    const Damage damages[]{
+        { "a NaN coordinate", records + kValues, kNaN },
+        { "an infinite size", records + kValues + 8, kInfinity },
+        { "a coordinate of -1.7e38", records + kValues + 4, -1.7e38f },
+        { "a coordinate past the canvas", records + kValues, 2.0e9f },
+        { "NaN in a value the kind doesn't use", records + kValues + 28, kNaN },
+        { "infinite bounds", records + kBounds, -kInfinity },
+        { "huge bounds", records + kRecordSize + kBounds + 12, 3.0e38f },
+        { "a NaN transform", records + kTransform + 16, kNaN },
+        { "an infinite scale", records + 2 * kRecordSize + kTransform, kInfinity },
+        { "an infinite sketch point", points + 8 + 4, kInfinity },
+        { "a NaN sketch point", points + 16, kNaN },
+    };
+
+    for (const Damage& damage : damages)
+    {
+        std::vector<std::uint8_t> bytes{ intact };
+        std::memcpy(bytes.data() + damage.offset, &damage.value, sizeof(float));
+        writeFile(scratchFile(), bytes);
+        std::string what{ std::string{ "a document with " } + damage.what + " is damaged" };
+        checks.check(!load(scratchFile(), loaded), what.c_str());
+    }
+
+    const std::int32_t strokes[]{ -5, 0x7FFFFFFF };
+    for (std::int32_t stroke : strokes)
+    {
+        std::vector<std::uint8_t> bytes{ intact };
+        std::memcpy(bytes.data() + records + kStroke, &stroke, sizeof(stroke));
+        writeFile(scratchFile(), bytes);
+        checks.check(!load(scratchFile(), loaded), "a document with an impossible stroke width is damaged");
+    }
+
+    // one of every kind, each with its own colour and stroke, some moved, scaled, filled or locked
+    ShapeStore saved;
+    const float line[]{ 10.0f, 20.0f, 110.0f, 70.0f };
+    const float ellipse[]{ 200.0f, 40.0f, 260.0f, 90.0f };
+    const float rect[]{ 300.0f, 30.0f, 340.0f, 95.0f };
+    const float triangle[]{ 20.0f, 200.0f, 80.0f, 150.0f, 120.0f, 230.0f };
+    const float sketch[]{ 150.0f, 150.0f, 160.0f, 170.0f, 175.0f, 165.0f, 190.0f, 180.0f };
+    const float curve[]{ 220.0f, 160.0f, 230.0f, 140.0f, 250.0f, 140.0f, 260.0f, 160.0f, 270.0f, 180.0f, 290.0f, 180.0f, 300.0f, 160.0f };
+    const float measure[]{ 40.0f, 300.0f, 440.0f, 332.0f };
+    const float symbol[]{ 60.0f, 310.0f, 88.0f, 338.0f };
+    const float text[]{ 100.0f, 400.0f, 124.0f, 424.0f };
+    const ShapeHandle shapes[]{
+        saved.add(ShapeKind::Line, line, 2, 0xFF112233, 3, false),
+        saved.add(ShapeKind::Ellipse, ellipse, 2, 0x80FF0000, 2, true),
+        saved.add(ShapeKind::Rect, rect, 2, 0xFF00AA00, 5, false),
+        saved.add(ShapeKind::Triangle, triangle, 3, 0xFF0000FF, 1, true),
+        saved.add(ShapeKind::Sketch, sketch, 4, 0xFF444444, 4, false),
+        saved.add(ShapeKind::Curve, curve, 7, 0xFF884400, 6, false),
+        saved.add(ShapeKind::Measure, measure, 2, 0xFF000000, 1, false),
+        saved.add(ShapeKind::Symbol, symbol, 2, 0xFF000000, 1, true, L"\xE0A4"),
+        saved.add(ShapeKind::Text, text, 2, 0xFF336699, 1, true, L"Allegro", L"Times New Roman"),
+    };
+    const char* kinds[]{ "a line", "an ellipse", "a rectangle", "a triangle", "a sketch", "a curve", "a measure", "a symbol", "a text" };
+    saved.setLocked(shapes[2], true);
+    saved.translate(shapes[0], 15.0f, -5.0f);
+    saved.applyTransform(shapes[3], Transform::scaling(2.0f, 0.5f, 70.0f, 190.0f));
+
+    // a group rotated and moved, around a scaled rectangle and a line
+    const float inner[]{ 500.0f, 500.0f, 540.0f, 530.0f };
+    const float innerLine[]{ 480.0f, 560.0f, 600.0f, 520.0f };
+    ShapeHandle scaled{ saved.add(ShapeKind::Rect, inner, 2, 0xFFCC00CC, 2, true) };
+    saved.applyTransform(scaled, Transform::scaling(1.5f, 1.5f, 520.0f, 515.0f));
+    ShapeHandle group{ saved.group({ scaled, saved.add(ShapeKind::Line, innerLine, 2, 0xFF00CCCC, 7, false) }) };
+    saved.setTransform(group, Transform::rotation(0.4f, 540.0f, 540.0f).then(Transform::translation(30.0f, -20.0f)));
+
+    ShapeStore reloaded;
+    checks.check(saveAndLoad(saved, reloaded) && reloaded.size() == saved.size(), "a shape of every kind and a group are saved and loaded");
+
+    std::vector<ShapeHandle> roots;
+    for (std::size_t i{ 0 }; i < reloaded.size(); ++i)
+    {
+        if (reloaded.getParent(reloaded.getHandle(i)) == kNoShape)
+        {
+            roots.push_back(reloaded.getHandle(i));
+        }
+    }
+    if (roots.size() == 10)
+    {
+        for (std::size_t i{ 0 }; i < 9; ++i)
+        {
+            std::string what{ std::string{ kinds[i] } + " comes back as it was saved" };
+            checks.check(sameShape(saved, shapes[i], reloaded, roots[i]), what.c_str());
+        }
+        checks.check(reloaded.isGroup(roots[9]) && sameShape(saved, group, reloaded, roots[9]), "a transformed group comes back with its transform and children");
+    }
+    else
+    {
+        checks.check(false, "every root comes back");
+    }
+
+    std::filesystem::remove(scratchFile());
+    return checks.result();
+}
@@ -0,0 +1,211 @@
+// Checks the undo journal's bookkeeping: a run of arrow-key nudges is kept as one move, the oldest edits are
+// forgotten once the history passes its memory cap but the newest never is, a new edit drops what could have
+// been redone, and the style references restyles hold are taken and given back so that nothing is left once
+// all is cleared.
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "EditJournal.h"
+#include "tests/Check.h"
+
+namespace
+{
+    // the journal tells its owner what it changed; with no index or damage to keep up, nothing listens
+    class NoListener : public EditListener
+    {
+    public:
+        void shapeRestored(ShapeHandle, std::uint64_t) override {}
+        void shapesRemoving(const std::vector<ShapeHandle>&) override {}
+        void shapeChanged(ShapeHandle) override {}
+        void shapesSwapped(ShapeHandle, ShapeHandle) override {}
+        void shapesGrouped(ShapeHandle, const std::vector<ShapeHandle>&) override {}
+        void shapesUngrouped(ShapeHandle, const std::vector<ShapeHandle>&) override {}
+    };
+
+    ShapeHandle addRect(ShapeStore& store, float left, std::uint32_t color = 0xFF000000)
+    {
+        const float xy[]{ left, 0.0f, left + 20.0f, 10.0f };
+        return store.add(ShapeKind::Rect, xy, 2, color, 1, false);
+    }
+
+    // nudges the shapes as the arrow keys do, recording each nudge with join
+    void nudge(ShapeStore& store, EditJournal& journal, const std::vector<ShapeHandle>& shapes, float dx, float dy)
+    {
+        for (ShapeHandle shape : shapes)
+        {
+            store.translate(shape, dx, dy);
+        }
+        journal.recordMove(shapes, dx, dy, true);
+    }
+
+    // recolors the shape as the palette does and returns the style it had
+    StyleId recolor(ShapeStore& store, EditJournal& journal, ShapeHandle shape, std::uint32_t color, bool join)
+    {
+        StyleId before{ store.getStyle(shape) };
+        store.getStyleTable().retain(before);
+        store.setColor(shape, color);
+        journal.recordRestyle({ shape }, { before }, { store.getStyle(shape) }, join);
+        store.getStyleTable().release(before);
+        return before;
+    }
+}
+
+int main()
+{
+    Checks checks;
+    NoListener listener;
+
+    // a held arrow key: ten nudges of the same shapes are one move, undone in one step
+    {
+        StyleTable styles;
+        ShapeStore store(styles);
+        EditJournal journal(styles);
+        std::vector<ShapeHandle> shapes{ addRect(store, 0.0f), addRect(store, 40.0f) };
+        Bounds start{ store.getBounds(shapes[0]) };
+
+        for (int i{ 0 }; i < 10; ++i)
+        {
+            nudge(store, journal, shapes, 1.0f, 0.0f);
+        }
+        checks.check(journal.size() == 1, "ten nudges of the same shapes are one edit");
+
+        journal.undo(store, listener);
+        checks.check(store.getBounds(shapes[0]).left == start.left && !journal.canUndo(), "undoing the run of nudges puts the shapes back where they started");
+        journal.redo(store, listener);
+        checks.check(store.getBounds(shapes[0]).left == start.left + 10.0f, "redoing it moves them the whole way again");
+
+        // a nudge straight after an undo or redo starts a new edit, as does one after a seal or of other shapes
+        nudge(store, journal, shapes, 1.0f, 0.0f);
+        checks.check(journal.size() == 2, "a nudge after a redo is not joined to the redone move");
+        journal.seal();
+        nudge(store, journal, shapes, 1.0f, 0.0f);
+        nudge(store, journal, { shapes[0] }, 1.0f, 0.0f);
+        checks.check(journal.size() == 4, "a seal, or nudging different shapes, starts a new edit");
+        nudge(store, journal, { shapes[0] }, 0.0f, 1.0f);
+        checks.check(journal.size() == 4, "nudges in different directions still join");
+        journal.undo(store, listener);
+        checks.check(store.getBounds(shapes[0]).left == start.left + 12.0f && store.getBounds(shapes[0]).top == start.top, "undoing a joined move takes back both directions");
+    }
+
+    // a history capped at a few inserts keeps only the latest and never holds more than the cap
+    {
+        StyleTable styles;
+        ShapeStore store(styles);
+        EditJournal journal(styles, 4096);
+        bool withinCap{ true };
+        std::vector<ShapeHandle> shapes;
+        for (int i{ 0 }; i < 200; ++i)
+        {
+            shapes.push_back(addRect(store, static_cast<float>(i) * 30.0f, 0xFF000000 + static_cast<std::uint32_t>(i)));
+            journal.recordInsert({ store.snapshot(shapes.back()) });
+            withinCap = withinCap && journal.getMemoryUsed() <= journal.getMemoryCap();
+        }
+        checks.check(withinCap, "the journal never holds more than its memory cap");
+        checks.check(journal.size() > 0 && journal.size() < 200, "the oldest inserts are forgotten");
+        checks.check(journal.takeForgotten() == 200 - journal.size() && journal.takeForgotten() == 0, "the journal says how many edits it forgot, once");
+
+        // each forgotten insert gave back the reference its snapshot held
+        bool released{ true };
+        for (std::size_t i{ 0 }; i < shapes.size(); ++i)
+        {
+            bool remembered{ i >= shapes.size() - journal.size() };
+            released = released && styles.getReferences(store.getStyle(shapes[i])) == (remembered ? 2u : 1u);
+        }
+        checks.check(released, "a forgotten edit gives back its style references");
+
+        std::size_t remembered{ journal.size() };
+        std::size_t undone{ 0 };
+        while (journal.undo(store, listener))
+        {
+            ++undone;
+        }
+        checks.check(undone == remembered && store.size() == 200 - remembered, "only the remembered inserts can be undone");
+
+        journal.setMemoryCap(0);
+        checks.check(journal.size() == 1 && journal.canRedo(), "lowering the cap forgets straight away, all but the newest edit");
+    }
+
+    // an edit bigger than the whole cap pushes out everything before it, but can still be undone
+    {
+        StyleTable styles;
+        ShapeStore store(styles);
+        EditJournal journal(styles, 4096);
+        ShapeHandle first{ addRect(store, 0.0f) };
+        journal.recordInsert({ store.snapshot(first) });
+
+        std::vector<ShapeSnapshot> removed;
+        std::vector<ShapeHandle> victims;
+        for (int i{ 0 }; i < 200; ++i)
+        {
+            victims.push_back(addRect(store, static_cast<float>(i + 1) * 30.0f));
+            removed.push_back(store.snapshot(victims.back()));
+        }
+        journal.recordRemove(std::move(removed));
+        store.remove(victims);
+
+        checks.check(journal.size() == 1 && journal.getMemoryUsed() > journal.getMemoryCap(), "an edit over the cap is kept on its own");
+        checks.check(journal.takeForgotten() == 1, "the edit it pushed out is reported");
+        checks.check(journal.undo(store, listener) && store.size() == 201 && !journal.canUndo(), "the big edit can be undone");
+    }
+
+    // undoing then making a new edit drops the undone one for good
+    {
+        StyleTable styles;
+        ShapeStore store(styles);
+        EditJournal journal(styles);
+        ShapeHandle shape{ addRect(store, 0.0f) };
+        float left{ store.getBounds(shape).left };
+        store.translate(shape, 5.0f, 0.0f);
+        journal.recordMove({ shape }, 5.0f, 0.0f);
+        store.translate(shape, 7.0f, 0.0f);
+        journal.recordMove({ shape }, 7.0f, 0.0f);
+
+        journal.undo(store, listener);
+        checks.check(journal.canRedo(), "an undone edit can be redone");
+        StyleId black{ recolor(store, journal, shape, 0xFFFF0000, false) };
+        checks.check(!journal.canRedo() && !journal.redo(store, listener) && journal.size() == 2, "a new edit drops what could have been redone");
+        checks.check(store.getBounds(shape).left == left + 5.0f, "and leaves the shape where the undo put it");
+
+        journal.undo(store, listener);
+        journal.undo(store, listener);
+        checks.check(store.getBounds(shape).left == left && store.getStyle(shape) == black && !journal.canUndo(), "what's left undoes in order");
+    }
+
+    // restyles hold a reference to each style they name: before, after and across undo and redo
+    {
+        StyleTable styles;
+        ShapeStore store(styles);
+        EditJournal journal(styles);
+        ShapeHandle shape{ addRect(store, 0.0f, 0xFF000000) };
+        StyleId black{ store.getStyle(shape) };
+
+        recolor(store, journal, shape, 0xFFFF0000, false);
+        StyleId red{ store.getStyle(shape) };
+        checks.check(styles.getReferences(black) == 1 && styles.getReferences(red) == 2, "a restyle holds the styles before and after");
+
+        journal.undo(store, listener);
+        checks.check(store.getStyle(shape) == black && styles.getReferences(black) == 2 && styles.getReferences(red) == 1, "undoing a restyle moves the shape's reference back");
+        journal.redo(store, listener);
+        checks.check(store.getStyle(shape) == red && styles.getReferences(black) == 1 && styles.getReferences(red) == 2, "redoing it moves it forward again");
+
+        // a slider drag: the steps between its first and last color are let go as soon as they're passed; red is
+        // held as the first restyle's after and this one's before
+        journal.seal();
+        recolor(store, journal, shape, 0xFF00FF00, true);
+        recolor(store, journal, shape, 0xFF0000FF, true);
+        StyleId blue{ store.getStyle(shape) };
+        checks.check(journal.size() == 2 && styles.getReferences(red) == 2 && styles.getReferences(blue) == 2 && styles.size() == 3,
+            "a joined restyle keeps only its first and latest styles");
+        journal.undo(store, listener);
+        checks.check(store.getStyle(shape) == red, "undoing a slider drag goes back to the color before it");
+
+        // the journal gives back everything it held, so only the shape's own style is left
+        journal.clear();
+        checks.check(styles.size() == 1 && styles.getReferences(red) == 1, "clearing the journal releases its styles");
+        store.clear();
+        checks.check(styles.size() == 0, "no references outlive the shapes and the journal");
+    }
+
+    return checks.result();
+}
@@ -0,0 +1,182 @@
+// Replays a synthetic pointer trace polled at about 1000 Hz through the frame pacer and the drawing model, as
+// the window procedure drives them: a sketch drawn in one stroke, then dragged across the page. Paced to a
+// 60 Hz display the replay must paint once a refresh at most rather than once a move, never leave a change
+// waiting longer than a refresh, and save exactly the document an unpaced replay of the same trace does.
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <random>
+#include <vector>
+#include "FramePacer.h"
+#include "Simple Score.h"
+#include "tests/Check.h"
+
+namespace
+{
+    constexpr std::uint64_t kMillisecond{ 1000000 };
+
+    struct Move
+    {
+        std::uint64_t time; // nanoseconds
+        RenderPoint point;
+    };
+
+    struct Trace
+    {
+        std::vector<Move> sketch;
+        std::vector<Move> drag;
+    };
+
+    // a pointer polled every millisecond, give or take a quarter of one, tracing a loop and then dragging it
+    Trace makeTrace()
+    {
+        Trace trace;
+        std::mt19937 random(5);
+        std::uint64_t time{ 0 };
+        auto tick = [&] {
+            time += kMillisecond - kMillisecond / 4 + random() % (kMillisecond / 2);
+            return time;
+        };
+
+        for (int i{ 0 }; i < 1500; ++i)
+        {
+            float t{ static_cast<float>(i) / 1500.0f * 6.2831853f };
+            trace.sketch.push_back(Move{ tick(), RenderPoint{ 300.0f + 200.0f * std::sin(t) + i * 0.1f, 300.0f + 120.0f * std::sin(2.0f * t) } });
+        }
+        for (int i{ 1 }; i <= 1000; ++i)
+        {
+            trace.drag.push_back(Move{ tick(), RenderPoint{ 300.0f + i * 0.25f, 300.0f + i * 0.125f } });
+        }
+        return trace;
+    }
+
+    struct Replay
+    {
+        std::uint64_t paints{ 0 };
+        std::uint64_t longestWait{ 0 };   // from a change to the paint that showed it
+        bool selected{ false };
+        bool settled{ false };            // nothing was left unpainted at the end
+        std::vector<std::uint8_t> saved;
+    };
+
+    std::vector<std::uint8_t> savedShapes(DRAW_SHAPES& model, const std::filesystem::path& path)
+    {
+        DocumentWriter writer;
+        model.writeShapes(writer);
+        writer.save(path);
+        std::ifstream in(path, std::ios::binary);
+        return std::vector<std::uint8_t>(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+    }
+
+    // Applies each move to the model as it arrives, then asks for a frame: unpaced, every move is painted
+    // straight away; paced, the pacer says when, and a scheduled frame fires at its deadline unless a later
+    // move comes first. A paint takes the model's damage, as invalidateDirty does.
+    Replay replay(const Trace& trace, bool paced, const std::filesystem::path& path)
+    {
+        Replay result;
+        DRAW_SHAPES model;
+        FramePacer pacer{ 60.0 };
+        std::uint64_t deadline{ 0 };
+        std::uint64_t firstUnpainted{ 0 };
+        bool unpainted{ false };
+
+        auto paint = [&](std::uint64_t time) {
+            DirtyRegion dirty;
+            model.takeDirty(dirty);
+            ++result.paints;
+            if (unpainted)
+            {
+                result.longestWait = (std::max)(result.longestWait, time - firstUnpainted);
+                unpainted = false;
+            }
+        };
+        auto fireUntil = [&](std::uint64_t time) {
+            if (pacer.isScheduled() && deadline <= time)
+            {
+                pacer.fire(deadline);
+                paint(deadline);
+            }
+        };
+        auto changed = [&](std::uint64_t time) {
+            if (!unpainted)
+            {
+                firstUnpainted = time;
+                unpainted = true;
+            }
+            if (!paced)
+            {
+                paint(time);
+                return;
+            }
+            std::int64_t wait{ pacer.request(time) };
+            if (wait == FramePacer::kPresentNow)
+            {
+                paint(time);
+            }
+            else if (wait != FramePacer::kAlreadyScheduled)
+            {
+                deadline = time + static_cast<std::uint64_t>(wait);
+            }
+        };
+
+        model.setShape(DRAW_SHAPES::SKETCH);
+        model.setDrawing(true);
+        for (const Move& move : trace.sketch)
+        {
+            fireUntil(move.time);
+            model.setCurrent(move.point);
+            model.addSketchPoint();
+            changed(move.time);
+        }
+        model.addSketch();
+        model.setDrawing(false);
+        model.setSelect();
+
+        // the drag starts on the stroke's first point, which the fitted curve passes through
+        model.setShape(DRAW_SHAPES::SELECT);
+        const RenderPoint& start{ trace.sketch.front().point };
+        model.selectShape(start.x, start.y);
+        result.selected = model.isMoving();
+        for (const Move& move : trace.drag)
+        {
+            fireUntil(move.time);
+            model.moveShape(move.point.x, move.point.y);
+            changed(move.time);
+        }
+        model.dropShape();
+
+        // the last scheduled frame still fires, and shows everything
+        fireUntil(UINT64_MAX);
+        result.settled = !unpainted && !pacer.isScheduled();
+
+        result.saved = savedShapes(model, path);
+        return result;
+    }
+}
+
+int main()
+{
+    Checks checks;
+    Trace trace{ makeTrace() };
+    std::uint64_t moves{ trace.sketch.size() + trace.drag.size() };
+    std::uint64_t span{ trace.drag.back().time - trace.sketch.front().time };
+    std::uint64_t interval{ FramePacer{ 60.0 }.getInterval() };
+
+    std::filesystem::path scratch{ std::filesystem::temp_directory_path() / "simple-score-frame-pacer-test.ssd" };
+    Replay unpaced{ replay(trace, false, scratch) };
+    Replay paced{ replay(trace, true, scratch) };
+    std::filesystem::remove(scratch);
+
+    checks.check(unpaced.selected && paced.selected, "the drag picks up the sketched stroke");
+    checks.check(unpaced.paints == moves, "unpaced, every move is painted");
+    checks.check(paced.paints < unpaced.paints && paced.paints <= span / interval + 2, "paced, there is at most one paint a refresh");
+    checks.check(paced.longestWait <= interval, "paced, no change waits longer than a refresh to be shown");
+    checks.check(unpaced.settled && paced.settled, "the last change is painted either way");
+    checks.check(!unpaced.saved.empty() && paced.saved == unpaced.saved, "pacing the paints leaves the saved document byte for byte the same");
+
+    return checks.result();
+}
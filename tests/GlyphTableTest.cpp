@@ -0,0 +1,136 @@
+// Checks the glyph table against the checked-in Leland.otf: how many private use glyphs it supports and at
+// what units per em, the G clef's name and bounds, and the Leland.glyphs cache. A second load must be served
+// from the cache the first one wrote, and a change to the font or to SMuFL's names must rebuild it.
+//
+// The test is given the directory Leland.otf is in and works on a copy of the font in a scratch directory,
+// so the cache it writes never replaces the one next to the app.
+
+#include <algorithm>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "GlyphTable.h"
+#include "tests/Check.h"
+
+namespace
+{
+    // SMuFL's glyphnames.json entry for the G clef, as the app would find it next to the font
+    const std::string kGlyphNames{ "{\n    \"gClef\": {\n        \"codepoint\": \"U+E050\",\n        \"description\": \"G clef\"\n    }\n}\n" };
+
+    std::string readFile(const std::filesystem::path& path)
+    {
+        std::ifstream in(path, std::ios::binary);
+        return std::string(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+    }
+
+    void writeFile(const std::filesystem::path& path, const std::string& bytes)
+    {
+        std::ofstream out(path, std::ios::binary | std::ios::trunc);
+        out.write(bytes.data(), static_cast<std::streamsize>(bytes.size()));
+    }
+
+    std::string nameOf(const GlyphTable& table, std::uint32_t codePoint)
+    {
+        const GlyphInfo* glyph{ table.find(codePoint) };
+        return glyph != nullptr ? std::string(table.getName(*glyph)) : std::string{};
+    }
+
+    bool sameRecords(const GlyphTable& table, const std::vector<GlyphInfo>& glyphs, const std::string& names)
+    {
+        if (table.size() != glyphs.size())
+        {
+            return false;
+        }
+        for (std::size_t i{ 0 }; i < glyphs.size(); ++i)
+        {
+            const GlyphInfo& a{ table[i] };
+            const GlyphInfo& b{ glyphs[i] };
+            if (a.codePoint != b.codePoint || a.glyphId != b.glyphId || a.xMin != b.xMin || a.yMin != b.yMin || a.xMax != b.xMax || a.yMax != b.yMax
+                || table.getName(a) != std::string_view(names).substr(b.nameOffset, b.nameLength))
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+}
+
+int main(int argc, char** argv)
+{
+    Checks checks;
+
+    std::filesystem::path source{ argc > 1 ? argv[1] : "." };
+    std::filesystem::path scratch{ std::filesystem::temp_directory_path() / "simple-score-glyph-table-test" };
+    std::filesystem::remove_all(scratch);
+    std::filesystem::create_directories(scratch);
+    std::filesystem::path font{ scratch / "Leland.otf" };
+    std::filesystem::path cache{ scratch / "Leland.glyphs" };
+    std::filesystem::path glyphNames{ scratch / "glyphnames.json" };
+    std::filesystem::copy_file(source / "Leland.otf", font);
+
+    {
+        GlyphTable table;
+        checks.check(table.load(font, cache), "Leland.otf loads");
+        checks.check(table.size() == 463, "Leland supports 463 glyphs in the private use area");
+        checks.check(table.getUnitsPerEm() == 1000, "Leland has 1000 units per em");
+        checks.check(!table.isEmpty() && std::is_sorted(table.begin(), table.end(), [](const GlyphInfo& a, const GlyphInfo& b) { return a.codePoint < b.codePoint; })
+            && table.begin()->codePoint >= GlyphTable::kFirstCodePoint && (table.end() - 1)->codePoint <= GlyphTable::kLastCodePoint,
+            "the glyphs are in the private use area, sorted by code point");
+
+        // the G clef, named as the font names it and bounded by its outline in font units, y up
+        const GlyphInfo* gClef{ table.find(0xE050) };
+        checks.check(gClef != nullptr && table.getName(*gClef) == "uniE050", "U+E050 is named uniE050 by the font");
+        checks.check(gClef != nullptr && gClef->xMin == 0 && gClef->yMin == -666 && gClef->xMax == 640 && gClef->yMax == 1112, "the G clef's bounds are 0, -666 to 640, 1112");
+    }
+
+    // the first load wrote the cache, and it holds what a fresh parse of the font does
+    std::string fontBytes{ readFile(font) };
+    std::vector<GlyphInfo> parsed;
+    std::string parsedNames;
+    int unitsPerEm{ 0 };
+    GlyphTable::parse(reinterpret_cast<const std::uint8_t*>(fontBytes.data()), fontBytes.size(), {}, parsed, parsedNames, unitsPerEm);
+    std::string written{ readFile(cache) };
+    checks.check(written.size() == 32 + parsed.size() * sizeof(GlyphInfo) + parsedNames.size() && written.compare(0, 4, "SSGT") == 0, "the first load writes Leland.glyphs");
+
+    {
+        GlyphTable cached;
+        checks.check(cached.load(font, cache) && sameRecords(cached, parsed, parsedNames) && cached.getUnitsPerEm() == 1000, "a second load reads back what was parsed");
+    }
+
+    // a name changed in the cache shows up, so a second load maps the cache rather than parsing the font again
+    std::size_t at{ written.find("uniE050") };
+    std::string tampered{ written };
+    if (at != std::string::npos)
+    {
+        tampered.replace(at, 7, "cachedE");
+    }
+    writeFile(cache, tampered);
+    {
+        GlyphTable mapped;
+        checks.check(at != std::string::npos && mapped.load(font, cache) && nameOf(mapped, 0xE050) == "cachedE", "a second load is served from the cache");
+    }
+
+    // SMuFL's names change the hash: the cache is rebuilt, and the G clef gets its canonical name
+    writeFile(glyphNames, kGlyphNames);
+    {
+        GlyphTable named;
+        checks.check(named.load(font, cache, glyphNames) && nameOf(named, 0xE050) == "gClef" && named.size() == 463, "adding glyphnames.json rebuilds the cache with SMuFL's names");
+    }
+    checks.check(readFile(cache).find("gClef") != std::string::npos, "the rebuilt cache is written back");
+
+    // so does a changed font, even under a cache written for the font before it
+    writeFile(cache, tampered);
+    writeFile(font, fontBytes + std::string(16, '\0'));
+    {
+        GlyphTable changed;
+        checks.check(changed.load(font, cache) && nameOf(changed, 0xE050) == "uniE050" && sameRecords(changed, parsed, parsedNames), "a changed font's hash invalidates the cache");
+    }
+    checks.check(readFile(cache) != tampered, "the invalidated cache is replaced");
+
+    std::filesystem::remove_all(scratch);
+    return checks.result();
+}
@@ -0,0 +1,242 @@
+// Checks that malformed MusicXML is turned away or drawn within reason rather than crashing the importer:
+// keys, clefs and notes outside any part have no staves to go on, and octaves, clef octave changes and dots
+// far past anything a score writes must not send notes, or their ledger lines, off toward infinity, nor may
+// divisions, beats and durations big enough to overflow the measure's arithmetic. Then that a small score
+// imports as it should: each note, rest, clef and accidental the right glyph, on the right line or space of
+// the right measure, in order.
+
+#include <cmath>
+#include <cstddef>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "MusicXmlImport.h"
+#include "tests/Check.h"
+
+namespace
+{
+    const std::string kHead{ "<?xml version=\"1.0\"?>\n<score-partwise version=\"4.0\">\n"
+        "<part-list><score-part id=\"P1\"><part-name>Flute</part-name></score-part></part-list>\n" };
+    const std::string kTail{ "</score-partwise>\n" };
+    const std::string kAttributes{ "<attributes><divisions>2</divisions><key><fifths>2</fifths></key>"
+        "<time><beats>4</beats><beat-type>4</beat-type></time><clef><sign>G</sign><line>2</line></clef></attributes>" };
+
+    std::string note(const std::string& octave, const std::string& extra = "")
+    {
+        return "<note><pitch><step>C</step><octave>" + octave + "</octave></pitch><duration>2</duration><type>quarter</type>" + extra + "</note>";
+    }
+
+    std::string part(const std::string& measure)
+    {
+        return "<part id=\"P1\"><measure number=\"1\">" + measure + "</measure></part>\n";
+    }
+
+    struct Imported
+    {
+        bool ok{ false };
+        std::string error;
+        std::size_t elements{ 0 };
+        Bounds content;
+    };
+
+    Imported import(const std::string& xml)
+    {
+        std::istringstream in(xml);
+        ShapeStore elements;
+        MusicXmlImporter importer;
+        Imported result;
+        result.ok = importer.import(in, elements);
+        result.error = importer.getError();
+        result.elements = elements.size();
+        result.content = elements.getContentBounds();
+        return result;
+    }
+
+    bool finite(const Bounds& bounds)
+    {
+        return std::isfinite(bounds.left) && std::isfinite(bounds.top) && std::isfinite(bounds.right) && std::isfinite(bounds.bottom);
+    }
+
+    // turned away with a reason and nothing added
+    bool rejected(const Imported& imported)
+    {
+        return !imported.ok && !imported.error.empty() && imported.elements == 0;
+    }
+
+    // Two measures of one staff: E4, F#4, a quarter rest and F4, which needs a natural after the sharp, in
+    // treble clef; then a change to bass clef, D3 and Bb2 as halves.
+    const std::string kFixture{ kHead + "<part id=\"P1\">"
+        "<measure number=\"1\"><attributes><divisions>1</divisions><key><fifths>0</fifths></key>"
+        "<time><beats>4</beats><beat-type>4</beat-type></time><clef><sign>G</sign><line>2</line></clef></attributes>"
+        "<note><pitch><step>E</step><octave>4</octave></pitch><duration>1</duration><type>quarter</type></note>"
+        "<note><pitch><step>F</step><alter>1</alter><octave>4</octave></pitch><duration>1</duration><type>quarter</type></note>"
+        "<note><rest/><duration>1</duration><type>quarter</type></note>"
+        "<note><pitch><step>F</step><octave>4</octave></pitch><duration>1</duration><type>quarter</type></note></measure>"
+        "<measure number=\"2\"><attributes><clef><sign>F</sign><line>4</line></clef></attributes>"
+        "<note><pitch><step>D</step><octave>3</octave></pitch><duration>2</duration><type>half</type></note>"
+        "<note><pitch><step>B</step><alter>-1</alter><octave>2</octave></pitch><duration>2</duration><type>half</type></note></measure>"
+        "</part>\n" + kTail };
+
+    // Leland's ascender, which the importer puts a glyph's origin this many ems below its corner by
+    constexpr float kLelandAscent{ 2.012f };
+
+    // a symbol as the importer meant it: its code point and the origin it's drawn from
+    struct Glyph
+    {
+        wchar_t code;
+        float x;
+        float y;
+    };
+
+    // where a symbol's glyph is, undoing the corner the importer worked out from it
+    Glyph glyphOf(const ShapeStore& elements, ShapeHandle shape)
+    {
+        const float* xy{ elements.getPoints(shape) };
+        float size{ xy[2] - xy[0] };
+        RenderPoint offset{ scoreTextOffset(static_cast<int>(size)) };
+        return Glyph{ elements.getText(shape)[0], xy[0] + offset.x + size / 6.0f, xy[1] + offset.y + size * kLelandAscent };
+    }
+
+    // The x of every code glyph in measure (counted from 0) on position, in half spaces up from the bottom
+    // line; measures are the staff's Measure shapes, in order.
+    std::vector<float> find(const ShapeStore& elements, const std::vector<Bounds>& measures, wchar_t code, std::size_t measure, int position)
+    {
+        std::vector<float> xs;
+        const Bounds& staff{ measures[measure] };
+        for (std::size_t i{ 0 }; i < elements.size(); ++i)
+        {
+            ShapeHandle shape{ elements.getHandle(i) };
+            if (elements.getKind(shape) != ShapeKind::Symbol)
+            {
+                continue;
+            }
+            Glyph glyph{ glyphOf(elements, shape) };
+            float halfSpaces{ (staff.bottom - glyph.y) / ((staff.bottom - staff.top) / 8.0f) };
+            if (glyph.code == code && glyph.x >= staff.left && glyph.x < staff.right && std::lround(halfSpaces) == position && std::fabs(halfSpaces - static_cast<float>(position)) < 0.01f)
+            {
+                xs.push_back(glyph.x);
+            }
+        }
+        return xs;
+    }
+
+    // there's exactly one code glyph there; its x goes to x
+    bool one(const ShapeStore& elements, const std::vector<Bounds>& measures, wchar_t code, std::size_t measure, int position, float& x)
+    {
+        std::vector<float> xs{ find(elements, measures, code, measure, position) };
+        x = xs.empty() ? 0.0f : xs[0];
+        return xs.size() == 1;
+    }
+}
+
+int main()
+{
+    Checks checks;
+
+    Imported intact{ import(kHead + part(kAttributes + note("5") + note("4", "<dot/>") + note("4") + "<note><rest/><duration>1</duration></note>") + kTail) };
+    checks.check(intact.ok && intact.elements > 4 && finite(intact.content), "an intact score imports");
+
+    // nothing to put these on before the first part or after the last
+    checks.check(rejected(import(kHead + "<attributes><key><fifths>3</fifths></key></attributes>" + part(note("4")) + kTail)), "a key before any part is turned away");
+    checks.check(rejected(import(kHead + "<attributes><clef><sign>F</sign><line>4</line></clef></attributes>" + part(note("4")) + kTail)), "a clef before any part is turned away");
+    checks.check(rejected(import(kHead + note("4") + part(note("4")) + kTail)), "a note before any part is turned away");
+    checks.check(rejected(import(kHead + part(note("4")) + note("4") + kTail)), "a note after the last part is turned away");
+    checks.check(rejected(import(kHead + "<measure number=\"1\">" + note("4") + "</measure>" + kTail)), "a measure outside a part is turned away");
+    checks.check(rejected(import(kHead + "<direction><direction-type><words>loud</words></direction-type></direction>" + part(note("4")) + kTail)), "a direction outside a part is turned away");
+    checks.check(rejected(import(kHead + "<part id=\"P1\"><measure number=\"1\">" + part(note("4")) + "</measure></part>" + kTail)), "a part inside a part is turned away");
+    checks.check(rejected(import(kHead + "<part id=\"P1\"><measure number=\"1\">" + note("4"))), "a file that stops partway is turned away");
+
+    // an octave is 0 to 9; past that the note sits where octave 0 or 9 would, with its ledger lines
+    Imported high{ import(kHead + part(kAttributes + note("999999999")) + kTail) };
+    Imported top{ import(kHead + part(kAttributes + note("9")) + kTail) };
+    checks.check(high.ok && high.elements == top.elements && finite(high.content), "an octave of 999999999 draws as octave 9");
+    Imported low{ import(kHead + part(kAttributes + note("-999999999")) + kTail) };
+    Imported bottom{ import(kHead + part(kAttributes + note("0")) + kTail) };
+    checks.check(low.ok && low.elements == bottom.elements && finite(low.content), "an octave of -999999999 draws as octave 0");
+    checks.check(high.content.bottom - high.content.top < 1000.0f && low.content.bottom - low.content.top < 1000.0f, "notes far out of range stay near their staff");
+
+    // a clef's octave change and line are held to what a staff can show
+    std::string shifted{ "<attributes><divisions>2</divisions><clef><sign>G</sign><line>999999</line><clef-octave-change>-999999</clef-octave-change></clef></attributes>" };
+    Imported clef{ import(kHead + part(shifted + note("4")) + kTail) };
+    checks.check(clef.ok && finite(clef.content) && clef.content.bottom - clef.content.top < 1000.0f, "a clef far out of range keeps its notes near the staff");
+
+    // dots past a handful are dropped
+    std::string dots;
+    for (int i{ 0 }; i < 500; ++i)
+    {
+        dots += "<dot/>";
+    }
+    Imported dotted{ import(kHead + part(kAttributes + note("4", dots)) + kTail) };
+    Imported fewDots{ import(kHead + part(kAttributes + note("4", "<dot/><dot/><dot/><dot/>")) + kTail) };
+    checks.check(dotted.ok && dotted.elements == fewDots.elements, "500 dots draw as four");
+
+    // a measure's length in divisions would overflow an int; it and the times in the measure are capped
+    std::string huge{ "<attributes><divisions>99999999</divisions><time><beats>99999999</beats><beat-type>1</beat-type></time>"
+        "<clef><sign>G</sign><line>2</line></clef></attributes>" };
+    Imported vast{ import(kHead + part(huge + note("4")) + kTail) };
+    checks.check(vast.ok && vast.elements > 0 && finite(vast.content), "a measure of 99999999 whole notes at 99999999 divisions imports");
+    std::string added{ "<attributes><divisions>99999999</divisions><time><beats>999999999+999999999+999999999</beats><beat-type>1</beat-type></time></attributes>" };
+    std::string forwards;
+    for (int i{ 0 }; i < 8; ++i)
+    {
+        forwards += "<forward><duration>999999999</duration></forward>" + note("4");
+    }
+    Imported summed{ import(kHead + part(added + forwards) + kTail) };
+    checks.check(summed.ok && summed.elements > 0 && finite(summed.content), "additive beats and durations that sum past an int import");
+
+    std::istringstream fixture(kFixture);
+    ShapeStore elements;
+    MusicXmlImporter importer;
+    checks.check(importer.import(fixture, elements) && importer.getNoteCount() == 6, "the fixture imports all six notes and rests");
+    std::vector<Bounds> measures;
+    for (std::size_t i{ 0 }; i < elements.size(); ++i)
+    {
+        ShapeHandle shape{ elements.getHandle(i) };
+        if (elements.getKind(shape) == ShapeKind::Measure)
+        {
+            const float* xy{ elements.getPoints(shape) };
+            measures.push_back(Bounds{ xy[0], xy[1], xy[2], xy[3] });
+        }
+    }
+    if (measures.size() == 2)
+    {
+        checks.check(measures[0].right <= measures[1].left + 0.5f && measures[0].top == measures[1].top, "the two measures sit side by side on one staff");
+
+        // leads: a treble clef on line 2 and four four time, then a bass clef on line 4 where it changes
+        float x;
+        checks.check(one(elements, measures, 0xE050, 0, 2, x), "a treble clef sits on the second line of the first measure");
+        checks.check(one(elements, measures, 0xE084, 0, 6, x) && one(elements, measures, 0xE084, 0, 2, x), "four four time is a 4 over a 4");
+        checks.check(one(elements, measures, 0xE062, 1, 6, x), "the bass clef sits on the fourth line of the second measure");
+        checks.check(find(elements, measures, 0xE050, 1, 2).empty(), "the second measure doesn't repeat the treble clef");
+
+        // quarters with stems up below the middle line, a quarter rest on it; in order across the measure
+        float e4;
+        float sharp;
+        float rest;
+        float natural;
+        checks.check(one(elements, measures, 0xE1D5, 0, 0, e4), "E4 is a quarter note on the bottom line");
+        std::vector<float> fs{ find(elements, measures, 0xE1D5, 0, 1) };
+        checks.check(fs.size() == 2, "F#4 and F4 are quarter notes in the bottom space");
+        float fSharp{ fs.size() == 2 ? fs[0] : 0.0f };
+        float fNatural{ fs.size() == 2 ? fs[1] : 0.0f };
+        checks.check(one(elements, measures, 0xE262, 0, 1, sharp) && sharp < fSharp, "F#4 has a sharp in its space, before it");
+        checks.check(one(elements, measures, 0xE4E5, 0, 4, rest), "the quarter rest is on the middle line");
+        checks.check(one(elements, measures, 0xE261, 0, 1, natural) && natural < fNatural && natural > rest, "F4 after F#4 has a natural before it");
+        checks.check(e4 < fSharp && fSharp < rest && rest < fNatural, "the first measure's notes and rest are in order");
+
+        // in bass clef D3 is on the middle line, stem down, and Bb2 on the second line, stem up, with its flat
+        float d3;
+        float bFlat;
+        float flat;
+        checks.check(one(elements, measures, 0xE1D4, 1, 4, d3), "D3 is a half note with its stem down on the middle line");
+        checks.check(one(elements, measures, 0xE1D3, 1, 2, bFlat) && d3 < bFlat, "Bb2 is a half note with its stem up on the second line, after D3");
+        checks.check(one(elements, measures, 0xE260, 1, 2, flat) && flat < bFlat && flat > d3, "Bb2 has a flat before it");
+        checks.check(find(elements, measures, 0xE1D5, 1, 0).empty() && find(elements, measures, 0xE262, 1, 1).empty(), "the first measure's notes aren't in the second");
+    }
+    else
+    {
+        checks.check(false, "the fixture is two measures on one staff");
+    }
+
+    return checks.result();
+}
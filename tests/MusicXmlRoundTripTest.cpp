@@ -0,0 +1,343 @@
+// Checks that exporting a score as MusicXML and importing it again gives back the same score: each score is
+// imported, exported, imported and exported again, and the two imports must place the same elements in the
+// same order and the two exports be byte for byte the same. One score has a bit of everything the importer
+// reads, titles and words with characters that need escaping among it; the other walks every pitch a staff
+// shows under each clef, every note and rest type with and without dots, and chords across a grand staff.
+// A last score spells its pitches by <alter> alone, against the key and each other, and must export the
+// same pitches.
+
+#include <cmath>
+#include <cstddef>
+#include <sstream>
+#include <string>
+#include "MusicXmlExport.h"
+#include "MusicXmlImport.h"
+#include "tests/Check.h"
+
+namespace
+{
+    const char kMixed[]{ R"(<?xml version="1.0" encoding="UTF-8" standalone="no"?>
+<!DOCTYPE score-partwise PUBLIC "-//Recordare//DTD MusicXML 4.0 Partwise//EN" "http://www.musicxml.org/dtds/partwise.dtd">
+<score-partwise version="4.0">
+  <work><work-title>Fixture &amp; Test &#x266F;</work-title></work>
+  <part-list>
+    <score-part id="P1"><part-name>Flute</part-name></score-part>
+    <score-part id="P2"><part-name>Piano</part-name></score-part>
+  </part-list>
+  <part id="P1">
+    <measure number="1">
+      <attributes><divisions>2</divisions><key><fifths>2</fifths></key><time><beats>4</beats><beat-type>4</beat-type></time><clef><sign>G</sign><line>2</line></clef></attributes>
+      <direction placement="above"><direction-type><words>Allegro <![CDATA[<vivo>]]></words></direction-type></direction>
+      <note><pitch><step>C</step><alter>1</alter><octave>5</octave></pitch><duration>2</duration><type>quarter</type><accidental>sharp</accidental></note>
+      <note><pitch><step>A</step><octave>5</octave></pitch><duration>3</duration><type>quarter</type><dot/></note>
+      <note><pitch><step>B</step><octave>4</octave></pitch><duration>1</duration><type>eighth</type><stem>up</stem></note>
+      <note><rest/><duration>2</duration><type>quarter</type></note>
+    </measure>
+    <measure number="2">
+      <note><pitch><step>D</step><octave>4</octave></pitch><duration>8</duration><type>whole</type></note>
+    </measure>
+    <measure number="3">
+      <note><rest measure="yes"/><duration>8</duration></note>
+    </measure>
+  </part>
+  <part id="P2">
+    <measure number="1">
+      <attributes><divisions>1</divisions><key><fifths>-3</fifths></key><time symbol="common"><beats>4</beats><beat-type>4</beat-type></time><staves>2</staves>
+        <clef number="1"><sign>G</sign><line>2</line></clef><clef number="2"><sign>F</sign><line>4</line></clef></attributes>
+      <note><pitch><step>C</step><octave>4</octave></pitch><duration>2</duration><type>half</type><staff>1</staff></note>
+      <note><chord/><pitch><step>E</step><alter>-1</alter><octave>4</octave></pitch><duration>2</duration><type>half</type><accidental>flat</accidental><staff>1</staff></note>
+      <note><grace/><pitch><step>G</step><octave>4</octave></pitch><type>eighth</type><staff>1</staff></note>
+      <note><pitch><step>G</step><octave>4</octave></pitch><duration>2</duration><type>half</type><staff>1</staff></note>
+      <backup><duration>4</duration></backup>
+      <note><pitch><step>C</step><octave>3</octave></pitch><duration>4</duration><type>whole</type><staff>2</staff></note>
+    </measure>
+    <measure number="2">
+      <attributes><clef number="2"><sign>G</sign><line>2</line><clef-octave-change>-1</clef-octave-change></clef></attributes>
+      <note><pitch><step>E</step><octave>2</octave></pitch><duration>1</duration><type>quarter</type><staff>2</staff></note>
+      <note print-object="no"><rest/><duration>3</duration><staff>2</staff></note>
+    </measure>
+    <measure number="3">
+      <note><pitch><step>A</step><octave>6</octave></pitch><duration>4</duration><staff>1</staff></note>
+    </measure>
+  </part>
+</score-partwise>
+)" };
+
+    // no <accidental> anywhere: E natural and F sharp against two flats, then E flat again after the natural
+    const char kSpelled[]{ R"(<?xml version="1.0" encoding="UTF-8"?>
+<score-partwise version="4.0">
+  <part-list><score-part id="P1"><part-name>Oboe</part-name></score-part></part-list>
+  <part id="P1">
+    <measure number="1">
+      <attributes><divisions>1</divisions><key><fifths>-2</fifths></key><time><beats>4</beats><beat-type>4</beat-type></time><clef><sign>G</sign><line>2</line></clef></attributes>
+      <note><pitch><step>E</step><octave>5</octave></pitch><duration>1</duration><type>quarter</type></note>
+      <note><pitch><step>E</step><alter>-1</alter><octave>5</octave></pitch><duration>1</duration><type>quarter</type></note>
+      <note><pitch><step>B</step><alter>-1</alter><octave>4</octave></pitch><duration>1</duration><type>quarter</type></note>
+      <note><pitch><step>F</step><alter>1</alter><octave>4</octave></pitch><duration>1</duration><type>quarter</type></note>
+    </measure>
+    <measure number="2">
+      <note><pitch><step>E</step><alter>-1</alter><octave>5</octave></pitch><duration>1</duration><type>quarter</type></note>
+      <note><pitch><step>F</step><octave>4</octave></pitch><duration>1</duration><type>quarter</type></note>
+      <note><pitch><step>E</step><octave>4</octave></pitch><duration>2</duration><type>half</type></note>
+    </measure>
+  </part>
+</score-partwise>
+)" };
+
+    const char* const kSteps[]{ "C", "D", "E", "F", "G", "A", "B" };
+    const char* const kAccidentals[]{ "", "sharp", "flat", "natural" };
+    const char* const kTypes[]{ "whole", "half", "quarter", "eighth", "16th", "32nd" };
+
+    std::string pitched(int step, int octave, int duration, const char* type, int dots, const char* accidental, int staff = 0, bool chord = false)
+    {
+        std::string note{ "<note>" };
+        note += chord ? "<chord/>" : "";
+        note += "<pitch><step>" + std::string(kSteps[step]) + "</step><octave>" + std::to_string(octave) + "</octave></pitch>";
+        note += "<duration>" + std::to_string(duration) + "</duration><type>" + type + "</type>";
+        for (int dot{ 0 }; dot < dots; ++dot)
+        {
+            note += "<dot/>";
+        }
+        note += *accidental ? "<accidental>" + std::string(accidental) + "</accidental>" : "";
+        note += staff > 0 ? "<staff>" + std::to_string(staff) + "</staff>" : "";
+        return note + "</note>";
+    }
+
+    std::string rest(int duration, const char* type, int dots)
+    {
+        std::string note{ "<note><rest/><duration>" + std::to_string(duration) + "</duration><type>" + type + "</type>" };
+        for (int dot{ 0 }; dot < dots; ++dot)
+        {
+            note += "<dot/>";
+        }
+        return note + "</note>";
+    }
+
+    std::string measure(int number, const std::string& content)
+    {
+        return "<measure number=\"" + std::to_string(number) + "\">" + content + "</measure>\n";
+    }
+
+    // every part is as long as the longest, the rhythms; the others end in measure rests
+    constexpr int kMeasures{ 30 };
+
+    std::string restsTo(int number, int duration, int staves = 1)
+    {
+        std::string rests;
+        for (; number <= kMeasures; ++number)
+        {
+            std::string content;
+            for (int staff{ 1 }; staff <= staves; ++staff)
+            {
+                content += staff > 1 ? "<backup><duration>" + std::to_string(duration) + "</duration></backup>" : "";
+                content += "<note><rest measure=\"yes\"/><duration>" + std::to_string(duration) + "</duration><staff>" + std::to_string(staff) + "</staff></note>";
+            }
+            rests += measure(number, content);
+        }
+        return rests;
+    }
+
+    // quarter notes up from two octaves below the staff to two above it, accidentals in turn
+    std::string scale(const char* id, const char* sign, int line, int fifths, int lowest)
+    {
+        std::string part{ "<part id=\"" + std::string(id) + "\">\n" };
+        std::string content{ "<attributes><divisions>8</divisions><key><fifths>" + std::to_string(fifths) + "</fifths></key>"
+            "<time><beats>4</beats><beat-type>4</beat-type></time><clef><sign>" + sign + "</sign><line>" + std::to_string(line) + "</line></clef></attributes>" };
+        int number{ 1 };
+        int count{ 0 };
+        for (int pitch{ lowest }; pitch <= lowest + 28; ++pitch)
+        {
+            content += pitched(pitch % 7, pitch / 7, 8, "quarter", 0, kAccidentals[pitch % 4]);
+            if (++count % 4 == 0)
+            {
+                part += measure(number++, content);
+                content.clear();
+            }
+        }
+        while (count++ % 4 != 0)
+        {
+            content += rest(8, "quarter", 0);
+        }
+        return part + measure(number, content) + restsTo(number + 1, 32) + "</part>\n";
+    }
+
+    // every type from whole to 32nd, plain then dotted then double dotted, each filled out to an 8/4 measure
+    // with the next shorter values; then the same as rests
+    std::string rhythms()
+    {
+        std::string part{ "<part id=\"P4\">\n" };
+        std::string first{ "<attributes><divisions>8</divisions><time><beats>8</beats><beat-type>4</beat-type></time><clef><sign>G</sign><line>2</line></clef></attributes>" };
+        int number{ 1 };
+        for (bool rests : { false, true })
+        {
+            for (int type{ 0 }; type < 6; ++type)
+            {
+                for (int dots{ 0 }; dots <= 2 && type + dots < 6; ++dots)
+                {
+                    int value{ 32 >> type };
+                    int duration{ value * ((2 << dots) - 1) / (1 << dots) };
+                    int left{ 64 - duration };
+                    std::string content{ number == 1 ? first : "" };
+                    content += rests ? rest(duration, kTypes[type], dots) : pitched(number % 7, 4 + number % 2, duration, kTypes[type], dots, "");
+                    for (int fill{ 0 }; left > 0; ++fill)
+                    {
+                        while ((32 >> fill) > left)
+                        {
+                            ++fill;
+                        }
+                        content += rests ? rest(32 >> fill, kTypes[fill], 0) : pitched((number + fill) % 7, 5, 32 >> fill, kTypes[fill], 0, "");
+                        left -= 32 >> fill;
+                    }
+                    part += measure(number++, content);
+                }
+            }
+        }
+        return part + "</part>\n";
+    }
+
+    // two staves, chords of two and three notes on each, a clef change partway through the lower one
+    std::string grandStaff()
+    {
+        std::string part{ "<part id=\"P5\">\n" };
+        for (int number{ 1 }; number <= 6; ++number)
+        {
+            std::string content{ number == 1 ? "<attributes><divisions>2</divisions><key><fifths>-2</fifths></key><time><beats>3</beats><beat-type>4</beat-type></time>"
+                "<staves>2</staves><clef number=\"1\"><sign>G</sign><line>2</line></clef><clef number=\"2\"><sign>F</sign><line>4</line></clef></attributes>" : "" };
+            for (int beat{ 0 }; beat < 3; ++beat)
+            {
+                int root{ 30 + (number * 3 + beat) % 7 };
+                content += pitched(root % 7, root / 7, 2, "quarter", 0, kAccidentals[beat], 1);
+                content += pitched((root + 2) % 7, (root + 2) / 7, 2, "quarter", 0, "", 1, true);
+                content += beat == 1 ? pitched((root + 4) % 7, (root + 4) / 7, 2, "quarter", 0, "", 1, true) : "";
+            }
+            content += "<backup><duration>6</duration></backup>";
+            content += number == 4 ? "<attributes><clef number=\"2\"><sign>G</sign><line>2</line></clef></attributes>" : "";
+            int bass{ (number >= 4 ? 28 : 17) + number % 5 };
+            content += pitched(bass % 7, bass / 7, 4, "half", 0, "", 2);
+            content += pitched((bass + 4) % 7, (bass + 4) / 7, 4, "half", 0, "", 2, true);
+            content += pitched((bass + 1) % 7, (bass + 1) / 7, 2, "quarter", 0, "sharp", 2);
+            part += measure(number, content);
+        }
+        return part + restsTo(7, 6, 2) + "</part>\n";
+    }
+
+    std::string everything()
+    {
+        std::string score{ "<?xml version=\"1.0\"?>\n<score-partwise version=\"4.0\">\n<work><work-title>Every pitch</work-title></work>\n<part-list>"
+            "<score-part id=\"P1\"><part-name>Treble</part-name></score-part><score-part id=\"P2\"><part-name>Alto</part-name></score-part>"
+            "<score-part id=\"P3\"><part-name>Bass</part-name></score-part><score-part id=\"P4\"><part-name>Rhythm</part-name></score-part>"
+            "<score-part id=\"P5\"><part-name>Piano</part-name></score-part></part-list>\n" };
+        score += scale("P1", "G", 2, 0, 4 * 7 + 2 - 14); // E4 on the bottom line, two octaves down
+        score += scale("P2", "C", 3, -3, 3 * 7 + 3 - 14); // F3
+        score += scale("P3", "F", 4, 4, 2 * 7 + 4 - 14); // G2
+        score += rhythms();
+        score += grandStaff();
+        return score + "</score-partwise>\n";
+    }
+
+    struct Counts
+    {
+        std::size_t parts{ 0 };
+        std::size_t measures{ 0 };
+        std::size_t notes{ 0 };
+    };
+
+    bool import(const std::string& xml, ShapeStore& elements, Counts& counts)
+    {
+        std::istringstream in(xml);
+        MusicXmlImporter importer;
+        if (!importer.import(in, elements))
+        {
+            return false;
+        }
+        counts = Counts{ importer.getPartCount(), importer.getMeasureCount(), importer.getNoteCount() };
+        return true;
+    }
+
+    bool exportScore(const ShapeStore& elements, std::string& xml, Counts& counts)
+    {
+        std::ostringstream out;
+        MusicXmlExporter exporter;
+        if (!exporter.write(elements, out))
+        {
+            return false;
+        }
+        xml = out.str();
+        counts = Counts{ exporter.getPartCount(), exporter.getMeasureCount(), exporter.getNoteCount() };
+        return true;
+    }
+
+    bool near(float a, float b) { return std::fabs(a - b) < 0.01f; }
+
+    // elements that differ in kind, text or place, in order
+    std::size_t differences(const ShapeStore& a, const ShapeStore& b)
+    {
+        std::size_t different{ a.size() > b.size() ? a.size() - b.size() : b.size() - a.size() };
+        for (std::size_t i{ 0 }; i < a.size() && i < b.size(); ++i)
+        {
+            ShapeHandle ha{ a.getHandle(i) };
+            ShapeHandle hb{ b.getHandle(i) };
+            Bounds ba{ a.getBounds(ha) };
+            Bounds bb{ b.getBounds(hb) };
+            bool same{ a.getKind(ha) == b.getKind(hb) && a.getText(ha) == b.getText(hb)
+                && near(ba.left, bb.left) && near(ba.top, bb.top) && near(ba.right, bb.right) && near(ba.bottom, bb.bottom) };
+            different += same ? 0 : 1;
+        }
+        return different;
+    }
+
+    // every <pitch> in the file, in order, its whitespace taken out
+    std::string pitches(const std::string& xml)
+    {
+        std::string all;
+        for (std::size_t at{ xml.find("<pitch>") }; at != std::string::npos; at = xml.find("<pitch>", at + 1))
+        {
+            std::size_t end{ xml.find("</pitch>", at) };
+            for (char c : xml.substr(at, end - at))
+            {
+                all += c == ' ' || c == '\n' ? "" : std::string(1, c);
+            }
+        }
+        return all;
+    }
+
+    // a note that isn't drawn, like a rest with print-object="no", is read but can't be written
+    void roundTrip(Checks& checks, const std::string& name, const std::string& source, std::size_t parts, std::size_t measures, std::size_t notes, std::size_t drawn)
+    {
+        ShapeStore imported;
+        Counts read;
+        std::string exported;
+        Counts written;
+        ShapeStore reimported;
+        Counts reread;
+        std::string reexported;
+        Counts rewritten;
+        bool ok{ import(source, imported, read) && exportScore(imported, exported, written)
+            && import(exported, reimported, reread) && exportScore(reimported, reexported, rewritten) };
+
+        checks.check(ok, (name + " imports, exports and imports again").c_str());
+        checks.check(read.parts == parts && read.measures == measures && read.notes == notes, (name + " reads every part, measure and note").c_str());
+        checks.check(written.parts == parts && written.measures == measures && written.notes == drawn, (name + " writes every part, measure and drawn note").c_str());
+        checks.check(reread.parts == parts && reread.measures == measures && reread.notes == drawn, (name + " reads its export's parts, measures and notes").c_str());
+        checks.check(imported.size() > 0 && differences(imported, reimported) == 0, (name + " comes back element for element").c_str());
+        checks.check(!exported.empty() && exported == reexported, (name + " exports the same file from its own export").c_str());
+    }
+}
+
+int main()
+{
+    Checks checks;
+
+    roundTrip(checks, "the mixed score", kMixed, 2, 3, 14, 13);
+    roundTrip(checks, "the every-pitch score", everything(), 5, 30, 392, 392);
+    roundTrip(checks, "the spelled score", kSpelled, 1, 2, 7, 7);
+
+    ShapeStore spelled;
+    Counts read;
+    std::string exported;
+    Counts written;
+    bool ok{ import(kSpelled, spelled, read) && exportScore(spelled, exported, written) };
+    checks.check(ok && pitches(exported) == pitches(kSpelled), "pitches spelled by <alter> alone export as the same pitches");
+
+    return checks.result();
+}
@@ -0,0 +1,218 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <vector>
+
+// Reads back the PNGs PngWriter writes, for tests that compare against checked-in images: 8-bit RGBA, rows
+// unfiltered, deflated with stored or fixed-Huffman blocks. Anything else, e.g. a file an image editor has
+// saved over, is refused rather than misread. Pixels come back premultiplied, as PngWriter took them.
+class PngReader
+{
+public:
+	static bool load(const std::filesystem::path& path, std::vector<std::uint32_t>& pixels, int& width, int& height)
+	{
+		std::ifstream in(path, std::ios::binary);
+		std::vector<std::uint8_t> file((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+		static const std::uint8_t kSignature[]{ 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+		if (file.size() < 8 || !std::equal(kSignature, kSignature + 8, file.begin()))
+		{
+			return false;
+		}
+
+		std::vector<std::uint8_t> compressed;
+		bool header{ false };
+		for (std::size_t at{ 8 }; at + 12 <= file.size();)
+		{
+			std::size_t length{ get32(&file[at]) };
+			if (length > file.size() - at - 12)
+			{
+				return false;
+			}
+
+			const std::uint8_t* type{ &file[at + 4] };
+			const std::uint8_t* data{ &file[at + 8] };
+			if (std::equal(type, type + 4, "IHDR"))
+			{
+				// 8 bits per channel, RGBA, deflate, no filters beyond none, no interlace
+				width = static_cast<int>(get32(data));
+				height = static_cast<int>(get32(data + 4));
+				header = length == 13 && width > 0 && height > 0 && data[8] == 8 && data[9] == 6 && data[10] == 0 && data[11] == 0 && data[12] == 0;
+			}
+			else if (std::equal(type, type + 4, "IDAT"))
+			{
+				compressed.insert(compressed.end(), data, data + length);
+			}
+			at += length + 12;
+		}
+
+		std::size_t rowBytes{ static_cast<std::size_t>(width) * 4 + 1 };
+		std::vector<std::uint8_t> raw;
+		if (!header || compressed.size() < 2 || (compressed[0] & 0x0F) != 8 || !inflate(compressed.data() + 2, compressed.size() - 2, raw)
+			|| raw.size() != rowBytes * static_cast<std::size_t>(height))
+		{
+			return false;
+		}
+
+		pixels.resize(static_cast<std::size_t>(width) * height);
+		for (int y{ 0 }; y < height; ++y)
+		{
+			const std::uint8_t* row{ &raw[rowBytes * static_cast<std::size_t>(y)] };
+			if (*row++ != 0)
+			{
+				return false;
+			}
+			for (int x{ 0 }; x < width; ++x, row += 4)
+			{
+				std::uint32_t alpha{ row[3] };
+				std::uint32_t pixel{ alpha << 24 };
+				for (int c{ 0 }; c < 3; ++c)
+				{
+					pixel |= ((row[c] * alpha + 127) / 255) << (16 - 8 * c);
+				}
+				pixels[static_cast<std::size_t>(y) * width + x] = pixel;
+			}
+		}
+		return true;
+	}
+
+private:
+	// an LSB-first bit stream, as deflate packs its codes
+	class BitReader
+	{
+	public:
+		BitReader(const std::uint8_t* data, std::size_t size) : m_data(data), m_size(size) {}
+
+		bool isOverrun() const { return m_at > m_size * 8; }
+
+		std::uint32_t get(int count)
+		{
+			std::uint32_t bits{ 0 };
+			for (int i{ 0 }; i < count; ++i, ++m_at)
+			{
+				std::uint32_t bit{ m_at < m_size * 8 ? (m_data[m_at / 8] >> (m_at % 8)) & 1u : 0u };
+				bits |= bit << i;
+			}
+			return bits;
+		}
+
+		// Huffman codes come most significant bit first
+		std::uint32_t getCode(int count)
+		{
+			std::uint32_t code{ 0 };
+			for (int i{ 0 }; i < count; ++i)
+			{
+				code = (code << 1) | get(1);
+			}
+			return code;
+		}
+
+		// stored blocks start on a byte
+		void align() { m_at = (m_at + 7) / 8 * 8; }
+
+	private:
+		const std::uint8_t* m_data;
+		std::size_t m_size;
+		std::size_t m_at{ 0 };
+	};
+
+	static std::size_t get32(const std::uint8_t* p)
+	{
+		return (static_cast<std::size_t>(p[0]) << 24) | (static_cast<std::size_t>(p[1]) << 16) | (static_cast<std::size_t>(p[2]) << 8) | p[3];
+	}
+
+	// the fixed literal/length code: 7 bits for 256-279, 8 for 0-143 and 280-287, 9 for 144-255
+	static std::uint32_t getLiteral(BitReader& bits)
+	{
+		std::uint32_t code{ bits.getCode(7) };
+		if (code <= 0x17)
+		{
+			return 256 + code;
+		}
+		code = (code << 1) | bits.get(1);
+		if (code >= 0x30 && code <= 0xBF)
+		{
+			return code - 0x30;
+		}
+		if (code >= 0xC0 && code <= 0xC7)
+		{
+			return 280 + code - 0xC0;
+		}
+		code = (code << 1) | bits.get(1);
+		return 144 + code - 0x190;
+	}
+
+	static bool inflate(const std::uint8_t* data, std::size_t size, std::vector<std::uint8_t>& out)
+	{
+		static constexpr std::uint16_t kLengthBase[29]{ 3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258 };
+		static constexpr std::uint8_t kLengthExtra[29]{ 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0 };
+		static constexpr std::uint16_t kDistanceBase[30]{ 1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193, 257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577 };
+		static constexpr std::uint8_t kDistanceExtra[30]{ 0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13 };
+
+		BitReader bits(data, size);
+		for (bool last{ false }; !last;)
+		{
+			last = bits.get(1) != 0;
+			std::uint32_t type{ bits.get(2) };
+			if (type == 0)
+			{
+				bits.align();
+				std::uint32_t length{ bits.get(16) };
+				if ((bits.get(16) ^ 0xFFFF) != length)
+				{
+					return false;
+				}
+				for (std::uint32_t i{ 0 }; i < length; ++i)
+				{
+					out.push_back(static_cast<std::uint8_t>(bits.get(8)));
+				}
+			}
+			else if (type == 1)
+			{
+				for (std::uint32_t symbol{ getLiteral(bits) }; symbol != 256; symbol = getLiteral(bits))
+				{
+					if (bits.isOverrun() || symbol > 285)
+					{
+						return false;
+					}
+					if (symbol < 256)
+					{
+						out.push_back(static_cast<std::uint8_t>(symbol));
+						continue;
+					}
+
+					std::size_t length{ kLengthBase[symbol - 257] + bits.get(kLengthExtra[symbol - 257]) };
+					std::uint32_t code{ bits.getCode(5) };
+					if (code > 29)
+					{
+						return false;
+					}
+					std::size_t distance{ kDistanceBase[code] + bits.get(kDistanceExtra[code]) };
+					if (distance > out.size())
+					{
+						return false;
+					}
+					for (std::size_t i{ 0 }; i < length; ++i)
+					{
+						out.push_back(out[out.size() - distance]);
+					}
+				}
+			}
+			else
+			{
+				// dynamic Huffman codes, which PngWriter never writes
+				return false;
+			}
+
+			if (bits.isOverrun())
+			{
+				return false;
+			}
+		}
+		return true;
+	}
+};
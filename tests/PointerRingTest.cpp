@@ -0,0 +1,219 @@
+// Stress-tests the pointer path with synthetic producers: the lock-free ring between the input thread and the
+// UI thread must hand over every value once and in order however the two sides batch, the history reader must
+// turn overlapping reads of a fast pointer into one stream with nothing repeated or reordered, and a sketch fed
+// in batches must come out the same as one fed point by point.
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <random>
+#include <thread>
+#include <vector>
+#include "PointerRing.h"
+#include "Simple Score.h"
+#include "tests/Check.h"
+
+namespace
+{
+    // producer and consumer each pick a random batch size every time, so the indices wrap at every offset
+    bool handsOverInOrder(std::size_t capacity, std::uint64_t total)
+    {
+        SpscRing<std::uint64_t> ring(capacity);
+        std::thread producer([&ring, total] {
+            std::mt19937 random(1);
+            std::uint64_t batch[97];
+            std::uint64_t next{ 0 };
+            while (next < total)
+            {
+                std::size_t count{ 1 + random() % 97 };
+                count = static_cast<std::size_t>((std::min)(static_cast<std::uint64_t>(count), total - next));
+                for (std::size_t i{ 0 }; i < count; ++i)
+                {
+                    batch[i] = next + i;
+                }
+                for (std::size_t done{ 0 }; done < count;)
+                {
+                    std::size_t pushed{ ring.push(batch + done, count - done) };
+                    if (pushed == 0)
+                    {
+                        std::this_thread::yield();
+                    }
+                    done += pushed;
+                }
+                next += count;
+            }
+        });
+
+        std::mt19937 random(2);
+        std::uint64_t out[256];
+        std::uint64_t expected{ 0 };
+        bool inOrder{ true };
+        while (expected < total)
+        {
+            std::size_t popped{ ring.pop(out, 1 + random() % 256) };
+            for (std::size_t i{ 0 }; i < popped; ++i)
+            {
+                inOrder = inOrder && out[i] == expected;
+                ++expected;
+            }
+            if (popped == 0)
+            {
+                std::this_thread::yield();
+            }
+        }
+        producer.join();
+        return inOrder && ring.empty();
+    }
+
+    struct HistoryRun
+    {
+        std::vector<PointerSample> moves; // what the UI thread drained
+        std::size_t gaps{ 0 };
+    };
+
+    // A synthetic pointer moves once per tick while an input thread reads its 64-deep history at its own pace,
+    // now and then stalling long enough for the history to move on past its last read, and pushes what's new
+    // into the ring. The ticks start just short of wrapping.
+    HistoryRun readHistory(const std::vector<PointerSample>& truth)
+    {
+        std::atomic<std::size_t> moved{ 1 };
+        std::atomic<bool> stopped{ false };
+        SpscRing<PointerSample> ring(4096);
+        HistoryRun run;
+
+        std::thread input([&] {
+            PointerHistory history;
+            history.reset(truth[0].time);
+            std::mt19937 random(3);
+            std::vector<PointerSample> fresh;
+            PointerSample read[64];
+            while (!stopped.load())
+            {
+                std::size_t now{ moved.load() };
+                std::size_t count{ (std::min)(static_cast<std::size_t>(64), now) };
+                for (std::size_t i{ 0 }; i < count; ++i)
+                {
+                    read[i] = truth[now - 1 - i];
+                }
+
+                fresh.clear();
+                history.takeNew(read, count, fresh);
+                for (std::size_t done{ 0 }; done < fresh.size();)
+                {
+                    done += ring.push(fresh.data() + done, fresh.size() - done);
+                }
+                std::this_thread::sleep_for(std::chrono::microseconds(random() % 64 == 0 ? 20000 : 500));
+            }
+            run.gaps = history.getGaps();
+        });
+
+        std::mt19937 random(4);
+        PointerSample drained[256];
+        auto drain = [&] {
+            std::size_t popped;
+            while ((popped = ring.pop(drained, 256)) > 0)
+            {
+                run.moves.insert(run.moves.end(), drained, drained + popped);
+            }
+        };
+
+        auto start = std::chrono::steady_clock::now();
+        for (std::size_t n{ 1 }; n <= truth.size(); ++n)
+        {
+            std::this_thread::sleep_until(start + std::chrono::microseconds(100 * n));
+            moved.store(n);
+            if (random() % 8 == 0)
+            {
+                drain();
+            }
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        stopped.store(true);
+        input.join();
+        drain();
+        return run;
+    }
+
+    std::vector<std::uint8_t> savedShapes(DRAW_SHAPES& model, const std::filesystem::path& path)
+    {
+        DocumentWriter writer;
+        model.writeShapes(writer);
+        writer.save(path);
+        std::ifstream in(path, std::ios::binary);
+        return std::vector<std::uint8_t>(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+    }
+}
+
+int main()
+{
+    Checks checks;
+
+    checks.check(handsOverInOrder(1024, 5000000), "five million values cross the ring once each and in order");
+    checks.check(handsOverInOrder(2, 200000), "a ring of two hands over in order");
+
+    // the ring rounds its capacity up to a power of two and takes no more than fits
+    SpscRing<int> small(5);
+    int values[]{ 1, 2, 3, 4, 5, 6, 7, 8, 9 };
+    checks.check(small.capacity() == 8 && small.push(values, 9) == 8 && !small.push(values[0]), "a full ring takes no more");
+    int out[16];
+    checks.check(small.pop(out, 16) == 8 && out[0] == 1 && out[7] == 8 && small.empty(), "a ring drains what it took");
+
+    const std::uint32_t firstTick{ 0xFFFFFFFFu - 1000u };
+    std::vector<PointerSample> truth;
+    for (std::uint32_t t{ 0 }; t < 4000; ++t)
+    {
+        truth.push_back(PointerSample{ static_cast<int>(t * 7 % 5000), static_cast<int>(t * 13 % 3000), firstTick + t });
+    }
+    HistoryRun run{ readHistory(truth) };
+
+    bool ordered{ true };
+    bool exact{ true };
+    for (std::size_t i{ 0 }; i < run.moves.size(); ++i)
+    {
+        std::uint32_t index{ run.moves[i].time - firstTick };
+        exact = exact && index < truth.size() && truth[index] == run.moves[i];
+        if (i > 0)
+        {
+            ordered = ordered && static_cast<std::int32_t>(run.moves[i].time - run.moves[i - 1].time) > 0;
+        }
+    }
+    checks.check(!run.moves.empty(), "the history reader passes moves on");
+    checks.check(ordered, "moves arrive oldest first with nothing repeated, across the tick wrapping");
+    checks.check(exact, "every move that arrives is one the pointer made");
+    checks.check(run.gaps > 0 || run.moves.size() == truth.size() - 1, "moves only go missing where a gap was counted");
+
+    // a sketch drained from the ring in batches of 37 must fit the same curve as one fed point by point
+    std::vector<RenderPoint> points;
+    for (int i{ 0 }; i < 2000; ++i)
+    {
+        points.push_back(RenderPoint{ static_cast<float>(i) + std::sin(i * 0.05f) * 30.0f, std::cos(i * 0.031f) * 80.0f });
+    }
+    DRAW_SHAPES single;
+    DRAW_SHAPES batched;
+    single.setShape(DRAW_SHAPES::SKETCH);
+    batched.setShape(DRAW_SHAPES::SKETCH);
+    for (const RenderPoint& point : points)
+    {
+        single.setCurrent(point);
+        single.addSketchPoint();
+    }
+    for (std::size_t i{ 0 }; i < points.size(); i += 37)
+    {
+        batched.addSketchPoints(points.data() + i, (std::min)(static_cast<std::size_t>(37), points.size() - i));
+    }
+    single.addSketch();
+    batched.addSketch();
+
+    std::filesystem::path scratch{ std::filesystem::temp_directory_path() / "simple-score-pointer-ring-test.ssd" };
+    std::vector<std::uint8_t> singleBytes{ savedShapes(single, scratch) };
+    std::vector<std::uint8_t> batchedBytes{ savedShapes(batched, scratch) };
+    std::filesystem::remove(scratch);
+    checks.check(!singleBytes.empty() && singleBytes == batchedBytes, "a sketch fed in batches saves the same as one fed point by point");
+
+    return checks.result();
+}
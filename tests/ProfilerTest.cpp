@@ -0,0 +1,123 @@
+// Checks the profiler's recorder core: a ring hands back its recent events oldest first and drops the ones
+// it has overwritten, a reader copying while the writer laps it never gets an event that's half one and half
+// another, and the trace export writes what Chrome's trace viewer reads.
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include "Profiler.h"
+#include "tests/Check.h"
+
+namespace
+{
+    const char* const kNames[]{ "drawStoredShapes", "hitTest", "BitBlt" };
+
+    // every field of event i follows from i, so a torn copy shows
+    bool isWhole(const ProfileEvent& event)
+    {
+        return event.duration == event.start * 7 + 1 && event.name == kNames[event.start % 3];
+    }
+
+    void push(ProfileRing& ring, std::uint64_t i)
+    {
+        ring.push(kNames[i % 3], i, i * 7 + 1);
+    }
+
+    // true if the events are whole and consecutive
+    bool isRun(const std::vector<ProfileEvent>& events)
+    {
+        for (std::size_t i{ 0 }; i < events.size(); ++i)
+        {
+            if (!isWhole(events[i]) || (i > 0 && events[i].start != events[i - 1].start + 1))
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+}
+
+int main()
+{
+    Checks checks;
+
+    {
+        ProfileRing ring{ 3 };
+        for (std::uint64_t i{ 0 }; i < 10; ++i)
+        {
+            push(ring, i);
+        }
+        std::vector<ProfileEvent> events;
+        ring.copy(events);
+        checks.check(events.size() == 10 && isRun(events) && events[0].start == 0 && events[0].thread == 3, "a ring hands back its events oldest first");
+
+        for (std::uint64_t i{ 10 }; i < ProfileRing::kCapacity + 5; ++i)
+        {
+            push(ring, i);
+        }
+        events.clear();
+        ring.copy(events);
+        // the oldest slot is the one the writer's next event goes in, so a reader can't trust it
+        checks.check(events.size() == ProfileRing::kCapacity - 1 && isRun(events) && events[0].start == 6, "a full ring keeps the newest events but the one being overwritten");
+
+        ring.clear();
+        events.clear();
+        ring.copy(events);
+        checks.check(events.empty(), "a cleared ring is empty");
+    }
+
+    {
+        // the writer laps the reader over and over; every copy must still be whole, consecutive events
+        ProfileRing ring{ 1 };
+        std::atomic<bool> done{ false };
+        std::thread writer([&]() {
+            for (std::uint64_t i{ 0 }; i < 20000000 && !done.load(std::memory_order_relaxed); ++i)
+            {
+                push(ring, i);
+            }
+            done.store(true);
+        });
+
+        std::size_t copies{ 0 };
+        std::size_t broken{ 0 };
+        std::vector<ProfileEvent> events;
+        while (!done.load())
+        {
+            events.clear();
+            ring.copy(events);
+            broken += isRun(events) ? 0 : 1;
+            if (++copies == 200000)
+            {
+                done.store(true);
+            }
+        }
+        writer.join();
+        std::string what{ "no copy out of " + std::to_string(copies) + " has a torn or missing event" };
+        checks.check(broken == 0, what.c_str());
+    }
+
+    {
+        Profiler profiler;
+        std::thread other([&]() { profiler.record("worker \"tile\"", 2500, 1000); });
+        other.join();
+        profiler.record("frame", 1234, 5678);
+
+        std::vector<ProfileEvent> events{ profiler.collect() };
+        checks.check(events.size() == 2 && events[0].start == 1234 && events[1].start == 2500 && events[0].thread != events[1].thread, "collect merges the threads by start time");
+
+        std::ostringstream trace;
+        profiler.writeChromeTrace(trace);
+        std::string json{ trace.str() };
+        checks.check(json.find("{\"name\":\"frame\",\"ph\":\"X\",\"pid\":1,\"tid\":2,\"ts\":1.234,\"dur\":5.678}") != std::string::npos, "an event is a complete event in microseconds");
+        checks.check(json.find("\"worker \\\"tile\\\"\"") != std::string::npos, "quotes in a name are escaped");
+
+        profiler.clear();
+        checks.check(profiler.collect().empty(), "clear forgets the events");
+    }
+
+    return checks.result();
+}
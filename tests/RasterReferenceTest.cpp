@@ -0,0 +1,185 @@
+// Draws the raster backend's primitives and compares each scene with a reference image checked in under
+// tests/reference: lines at every angle and width, rects and ellipses stroked and filled, cardinal curves,
+// Béziers and polygons with mitred joins, Leland glyphs at fractional pens, and anti-aliased edges under
+// a rotated, scaled view. Every channel of every pixel must be within kTolerance of the reference.
+//
+// The references were drawn by this backend on x86-64 with SSE2. The tolerance leaves room for the AVX2
+// and scalar sweeps and for compilers that fuse multiply-adds, which round coverage a level or so apart;
+// anything that moves an edge or changes a blend shows up as far more than that. A scene that fails is
+// written to the temporary directory as raster-<scene>-actual.png to look at beside its reference.
+//
+// The test is given the source directory. With --update it redraws the references instead of checking them.
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <filesystem>
+#include <string>
+#include <vector>
+#include "RasterBackend.h"
+#include "bench/Bench.h"
+#include "tests/Check.h"
+#include "tests/PngReader.h"
+
+namespace
+{
+    // levels out of 255 any one channel may be off by
+    constexpr int kTolerance{ 2 };
+    constexpr int kSide{ 128 };
+    constexpr std::uint32_t kPaper{ 0xFFFFFFFF };
+
+    constexpr float kPi{ 3.14159265f };
+
+    void lines(RasterBackend& backend)
+    {
+        // a fan of every 15 degrees at three widths, then a hairline thinner than a pixel
+        const float widths[]{ 1.0f, 2.5f, 6.0f };
+        for (int w{ 0 }; w < 3; ++w)
+        {
+            float cx{ 22.0f + 42.0f * w };
+            for (int degrees{ 0 }; degrees < 180; degrees += 15)
+            {
+                float angle{ degrees * kPi / 180.0f };
+                backend.drawLine(cx, 60.0f, cx + 20.0f * std::cos(angle), 60.0f - 40.0f * std::sin(angle), 0xFF1040A0, widths[w]);
+            }
+        }
+        backend.drawLine(4.5f, 80.25f, 123.5f, 120.75f, 0xFF000000, 0.3f);
+        backend.drawLine(4.0f, 124.0f, 124.0f, 124.0f, 0x80D02020, 3.0f);
+    }
+
+    void rects(RasterBackend& backend)
+    {
+        backend.drawRect(8.0f, 8.0f, 40.0f, 30.0f, 0xFF000000, 1.0f, false);
+        backend.drawRect(60.5f, 8.5f, 40.0f, 30.0f, 0xFF000000, 1.0f, false);
+        backend.drawRect(8.25f, 50.75f, 50.0f, 30.0f, 0xFF2060C0, 0.0f, true);
+        backend.drawRect(40.0f, 66.0f, 50.0f, 40.0f, 0x80E03010, 0.0f, true);
+        backend.drawRect(70.0f, 50.0f, 48.0f, 70.0f, 0xFF108020, 5.0f, false);
+        backend.drawRect(110.6f, 10.3f, 0.6f, 20.0f, 0xFF000000, 0.0f, true);
+    }
+
+    void ellipses(RasterBackend& backend)
+    {
+        backend.drawEllipse(10.0f, 10.0f, 50.0f, 50.0f, 0xFF000000, 0.0f, true);
+        backend.drawEllipse(66.5f, 8.5f, 55.0f, 30.0f, 0xFFC02060, 1.0f, false);
+        backend.drawEllipse(64.0f, 44.0f, 56.0f, 40.0f, 0xFF2040C0, 4.0f, false);
+        backend.drawEllipse(20.0f, 40.0f, 60.0f, 60.0f, 0x6020A040, 0.0f, true);
+        backend.drawEllipse(100.25f, 100.25f, 3.0f, 3.0f, 0xFF000000, 0.0f, true);
+        backend.drawEllipse(10.0f, 104.0f, 80.0f, 16.0f, 0xFF806000, 2.0f, false);
+    }
+
+    void curves(RasterBackend& backend)
+    {
+        const RenderPoint wave[]{ { 6.0f, 30.0f }, { 30.0f, 6.0f }, { 60.0f, 40.0f }, { 90.0f, 8.0f }, { 122.0f, 30.0f } };
+        backend.drawCurve(wave, 5, 0xFF000000, 2.0f);
+
+        const RenderPoint slur[]{ { 8.0f, 70.0f }, { 30.0f, 40.0f }, { 90.0f, 40.0f }, { 120.0f, 70.0f }, { 100.0f, 90.0f }, { 40.0f, 50.0f }, { 10.0f, 80.0f } };
+        backend.drawBeziers(slur, 7, 0xFF2050B0, 1.5f);
+
+        // a sharp point past the mitre limit and a blunt one within it
+        const RenderPoint arrow[]{ { 10.0f, 120.0f }, { 60.0f, 92.0f }, { 14.0f, 100.0f } };
+        backend.drawPolygon(arrow, 3, 0xFFB02020, 3.0f, false);
+        const RenderPoint diamond[]{ { 90.0f, 88.0f }, { 118.0f, 104.0f }, { 90.0f, 124.0f }, { 70.0f, 104.0f } };
+        backend.drawPolygon(diamond, 4, 0xC0208040, 0.0f, true);
+        backend.drawPolygon(diamond, 4, 0xFF000000, 2.0f, false);
+    }
+
+    void glyphs(RasterBackend& backend)
+    {
+        // a G clef, noteheads, a rest and accidentals, on pens that fall between pixels
+        backend.drawText(L"\xE050", 4.0f, 8.0f, L"Leland", 40.0f, 0xFF000000);
+        backend.drawText(L"\xE0A4", 40.3f, 20.6f, L"Leland", 24.0f, 0xFF000000);
+        backend.drawText(L"\xE0A2", 62.7f, 18.2f, L"Leland", 32.0f, 0xFF000000);
+        backend.drawText(L"\xE4E5", 92.45f, 10.9f, L"Leland", 32.0f, 0xFF000000);
+        backend.drawText(L"\xE262", 34.1f, 42.35f, L"Leland", 24.0f, 0xFF2040A0);
+        backend.drawText(L"\xE260", 52.8f, 30.5f, L"Leland", 40.0f, 0xFFA02040);
+        backend.drawText(L"\xE0A3", 76.0f, 34.0f, L"Leland", 40.0f, 0x80000000);
+        backend.drawText(L"\xE062", 100.5f, 50.0f, L"Leland", 24.0f, 0xFF000000);
+    }
+
+    void edges(RasterBackend& backend)
+    {
+        // nearly flat and nearly upright edges, where coverage steps across many pixels
+        const RenderPoint wedge[]{ { 4.0f, 10.0f }, { 124.0f, 14.0f }, { 124.0f, 16.0f }, { 4.0f, 11.0f } };
+        backend.drawPolygon(wedge, 4, 0xFF000000, 0.0f, true);
+        const RenderPoint sliver[]{ { 10.0f, 20.0f }, { 13.0f, 124.0f }, { 11.0f, 124.0f } };
+        backend.drawPolygon(sliver, 3, 0xFF000000, 0.0f, true);
+
+        // a rect and a ring under a view rotated by 20 degrees and scaled by 1.3 about the centre
+        backend.setView(Transform::rotation(20.0f * kPi / 180.0f, 64.0f, 64.0f).then(Transform::scaling(1.3f, 1.3f, 64.0f, 64.0f)));
+        backend.drawRect(40.0f, 40.0f, 30.0f, 20.0f, 0xFF2060C0, 0.0f, true);
+        backend.drawEllipse(60.0f, 56.0f, 30.0f, 30.0f, 0xFFC03000, 1.5f, false);
+        backend.drawLine(30.0f, 90.0f, 100.0f, 90.0f, 0xFF000000, 1.0f);
+        backend.setView(Transform{});
+    }
+
+    struct Scene
+    {
+        const char* name;
+        void (*draw)(RasterBackend&);
+    };
+
+    const Scene kScenes[]{ { "lines", lines }, { "rects", rects }, { "ellipses", ellipses }, { "curves", curves }, { "glyphs", glyphs }, { "edges", edges } };
+}
+
+int main(int argc, char** argv)
+{
+    Checks checks;
+
+    std::filesystem::path source{ argc > 1 ? argv[1] : "." };
+    bool update{ argc > 2 && std::string{ argv[2] } == "--update" };
+    std::filesystem::path references{ source / "tests" / "reference" };
+
+    GlyphOutlines leland;
+    checks.check(leland.open(source / "Leland.otf"), "Leland.otf opens");
+
+    for (const Scene& scene : kScenes)
+    {
+        RasterBackend backend{ &leland };
+        backend.resize(kSide, kSide);
+        backend.clear(kPaper);
+        scene.draw(backend);
+
+        std::string file{ std::string{ "raster-" } + scene.name + ".png" };
+        const std::uint32_t* drawn{ backend.getPixels() };
+        std::size_t pixels{ static_cast<std::size_t>(kSide) * kSide };
+        std::string what{ std::string{ "the " } + scene.name + " scene" };
+
+        if (update)
+        {
+            checks.check(PngWriter::save(references / file, drawn, kSide, kSide), (what + " is written as a reference").c_str());
+            continue;
+        }
+
+        checks.check(std::any_of(drawn, drawn + pixels, [](std::uint32_t pixel) { return pixel != kPaper; }), (what + " draws something").c_str());
+
+        std::vector<std::uint32_t> expected;
+        int width{ 0 };
+        int height{ 0 };
+        bool loaded{ PngReader::load(references / file, expected, width, height) && width == kSide && height == kSide };
+        checks.check(loaded, (what + "'s reference image reads").c_str());
+        if (!loaded)
+        {
+            continue;
+        }
+
+        int largest{ 0 };
+        std::size_t outside{ 0 };
+        for (std::size_t i{ 0 }; i < pixels; ++i)
+        {
+            int difference{ channelDifference(drawn[i], expected[i]) };
+            largest = (std::max)(largest, difference);
+            outside += difference > kTolerance ? 1 : 0;
+        }
+        if (outside > 0)
+        {
+            std::filesystem::path actual{ std::filesystem::temp_directory_path() / ("raster-" + std::string{ scene.name } + "-actual.png") };
+            PngWriter::save(actual, drawn, kSide, kSide);
+            std::fprintf(stderr, "%s: %zu pixels off by up to %d; drawn as %s\n", scene.name, outside, largest, actual.string().c_str());
+        }
+        checks.check(outside == 0, (what + " matches its reference within the tolerance").c_str());
+    }
+
+    return checks.result();
+}
@@ -0,0 +1,167 @@
+// Checks SketchFitter's error bound: every sample of a freehand stroke must end up within the tolerance of
+// the fitted curve, at each tolerance the sketch tool offers, and the curve must keep the layout
+// ShapeKind::Curve expects while it's being drawn. Also checks that a fitted curve moves by its offset alone.
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <random>
+#include <string>
+#include <vector>
+#include "ShapeStore.h"
+#include "SketchFitter.h"
+#include "tests/Check.h"
+
+namespace
+{
+    // each segment is walked in coarse steps, then finely either side of its closest step
+    constexpr int kSteps{ 64 };
+
+    RenderPoint evaluate(const RenderPoint* b, float u)
+    {
+        float v{ 1.0f - u };
+        return b[0] * (v * v * v) + b[1] * (3.0f * v * v * u) + b[2] * (3.0f * v * u * u) + b[3] * (u * u * u);
+    }
+
+    float distanceAt(const RenderPoint* b, float u, RenderPoint p)
+    {
+        RenderPoint q{ evaluate(b, u) };
+        return std::hypot(q.x - p.x, q.y - p.y);
+    }
+
+    float distanceToCurve(const std::vector<RenderPoint>& curve, RenderPoint p)
+    {
+        // the curve passes through every third point, so the nearest of those bounds the answer
+        float best{ 1.0e30f };
+        for (std::size_t s{ 0 }; s < curve.size(); s += 3)
+        {
+            best = (std::min)(best, std::hypot(curve[s].x - p.x, curve[s].y - p.y));
+        }
+
+        for (std::size_t s{ 0 }; s + 3 < curve.size(); s += 3)
+        {
+            // a segment lies inside its control points' box, so one further off than the best so far can't be closer
+            float left{ (std::min)({ curve[s].x, curve[s + 1].x, curve[s + 2].x, curve[s + 3].x }) };
+            float right{ (std::max)({ curve[s].x, curve[s + 1].x, curve[s + 2].x, curve[s + 3].x }) };
+            float top{ (std::min)({ curve[s].y, curve[s + 1].y, curve[s + 2].y, curve[s + 3].y }) };
+            float bottom{ (std::max)({ curve[s].y, curve[s + 1].y, curve[s + 2].y, curve[s + 3].y }) };
+            float dx{ (std::max)({ left - p.x, 0.0f, p.x - right }) };
+            float dy{ (std::max)({ top - p.y, 0.0f, p.y - bottom }) };
+            if (std::hypot(dx, dy) > best)
+            {
+                continue;
+            }
+
+            int closest{ 0 };
+            float coarse{ 1.0e30f };
+            for (int k{ 0 }; k <= kSteps; ++k)
+            {
+                float d{ distanceAt(&curve[s], static_cast<float>(k) / kSteps, p) };
+                if (d < coarse)
+                {
+                    coarse = d;
+                    closest = k;
+                }
+            }
+            best = (std::min)(best, coarse);
+
+            for (int k{ -kSteps }; k <= kSteps; ++k)
+            {
+                float u{ (static_cast<float>(closest) + static_cast<float>(k) / kSteps) / kSteps };
+                if (u >= 0.0f && u <= 1.0f)
+                {
+                    best = (std::min)(best, distanceAt(&curve[s], u, p));
+                }
+            }
+        }
+        return best;
+    }
+
+    bool hasCurveLayout(const std::vector<RenderPoint>& curve)
+    {
+        return curve.size() >= 4 && (curve.size() - 1) % 3 == 0;
+    }
+
+    // a wandering stroke sampled every 2 px and snapped to whole pixels, as mouse moves arrive
+    std::vector<RenderPoint> makeStroke(std::mt19937& rng, std::size_t samples)
+    {
+        std::uniform_real_distribution<float> turn{ -0.3f, 0.3f };
+        std::vector<RenderPoint> stroke;
+        float x{ 200.0f };
+        float y{ 200.0f };
+        float angle{ 0.0f };
+        for (std::size_t i{ 0 }; i < samples; ++i)
+        {
+            angle += turn(rng);
+            x += 2.0f * std::cos(angle);
+            y += 2.0f * std::sin(angle);
+            stroke.push_back(RenderPoint{ std::round(x), std::round(y) });
+        }
+        return stroke;
+    }
+}
+
+int main()
+{
+    Checks checks;
+    std::mt19937 rng{ 1 };
+
+    for (float tolerance : { 0.5f, 1.0f, 2.0f, 4.0f })
+    {
+        float worst{ 0.0f };
+        bool laidOut{ true };
+        bool simplified{ true };
+        for (int trial{ 0 }; trial < 20; ++trial)
+        {
+            std::vector<RenderPoint> stroke{ makeStroke(rng, 200 + rng() % 800) };
+            SketchFitter fitter{ tolerance };
+            for (std::size_t i{ 0 }; i < stroke.size(); ++i)
+            {
+                fitter.add(stroke[i].x, stroke[i].y);
+                if (i % 50 == 49)
+                {
+                    laidOut = laidOut && hasCurveLayout(fitter.getCurve());
+                }
+            }
+
+            const std::vector<RenderPoint>& curve{ fitter.finish() };
+            laidOut = laidOut && hasCurveLayout(curve);
+            simplified = simplified && fitter.getKeptCount() < stroke.size();
+            for (RenderPoint p : stroke)
+            {
+                worst = (std::max)(worst, distanceToCurve(curve, p));
+            }
+        }
+
+        // the walk along each segment is itself only accurate to about a thousandth of a pixel
+        std::string what{ "every sample lies within a tolerance of " + std::to_string(tolerance) + " of the curve" };
+        checks.check(worst <= tolerance + 0.001f, what.c_str());
+        checks.check(laidOut, "the curve is a start point and three points per segment while drawing and after");
+        checks.check(simplified, "the simplifier drops samples");
+    }
+
+    SketchFitter click;
+    click.add(5.0f, 5.0f);
+    const std::vector<RenderPoint>& dot{ click.finish() };
+    checks.check(dot.size() == 4 && dot[0].x == 5.0f && dot[3].y == 5.0f, "a click is one segment in one place");
+
+    SketchFitter straight{ 1.0f };
+    for (int i{ 0 }; i <= 1000; ++i)
+    {
+        straight.add(static_cast<float>(i), 10.0f);
+    }
+    checks.check(straight.finish().size() == 4, "a straight stroke is one segment");
+
+    // moving a fitted curve sets its offset; the points it was drawn with stay as they were
+    ShapeStore store;
+    float xy[]{ 0.0f, 0.0f, 10.0f, 10.0f, 20.0f, 0.0f, 30.0f, 10.0f };
+    ShapeHandle curve{ store.add(ShapeKind::Curve, xy, 4, 0xFF000000, 2, false) };
+    store.translate(curve, 100.0f, 50.0f);
+    Bounds extent{ store.getExtent(curve) };
+    checks.check(extent.left == 100.0f && extent.top == 50.0f && extent.right == 130.0f && extent.bottom == 60.0f, "a moved curve covers its new place");
+    checks.check(store.hitTest(curve, 115.0f, 55.0f) && !store.hitTest(curve, 15.0f, 5.0f), "a moved curve is hit where it now is");
+    store.translate(curve, -100.0f, -50.0f);
+    checks.check(store.getExtent(curve).left == 0.0f, "moving it back puts it where it was drawn");
+
+    return checks.result();
+}
@@ -0,0 +1,117 @@
+// Checks that the spatial index keeps its cell math in range for bounds that are huge, infinite or NaN,
+// as a damaged document or a runaway drag can produce, and still answers queries in z order, keeping it as
+// items are renumbered or fitted back in between others.
+
+#include <chrono>
+#include <cstdint>
+#include <limits>
+#include <vector>
+#include "SpatialIndex.h"
+#include "tests/Check.h"
+
+namespace
+{
+    const float kInfinity{ std::numeric_limits<float>::infinity() };
+    const float kNaN{ std::numeric_limits<float>::quiet_NaN() };
+    const float kHuge{ 1.7e38f };
+
+    bool contains(const std::vector<int>& items, int item)
+    {
+        for (int i : items)
+        {
+            if (i == item)
+            {
+                return true;
+            }
+        }
+        return false;
+    }
+}
+
+int main()
+{
+    Checks checks;
+    auto start = std::chrono::steady_clock::now();
+
+    SpatialIndex<int> index;
+    index.insert(1, Bounds{ 0.0f, 0.0f, 10.0f, 10.0f });
+    index.insert(2, Bounds{ 0.0f, 0.0f, 3e7f, 10.0f });
+    index.insert(3, Bounds{ -kHuge, -kHuge, kHuge, kHuge });
+    index.insert(4, Bounds{ -kInfinity, 0.0f, kInfinity, 10.0f });
+    index.insert(5, Bounds{ kNaN, kNaN, kNaN, kNaN });
+    index.insert(6, Bounds{ -kHuge, 5.0f, -kHuge, 6.0f });
+    index.insert(7, Bounds{ 2e9f, 2e9f, 2e9f + 10.0f, 2e9f + 10.0f });
+    index.insert(8, Bounds{ 20.0f, 20.0f, 30.0f, 30.0f });
+    checks.check(index.size() == 8, "every item is indexed");
+
+    std::vector<int> found;
+    index.query(5.0f, 5.0f, found);
+    checks.check(found == std::vector<int>{ 1, 2, 3, 4 }, "a point query finds the small, wide, huge and infinite items in z order");
+
+    index.query(-kHuge, 5.5f, found);
+    checks.check(contains(found, 3) && contains(found, 6) && !contains(found, 1), "a point query at a huge coordinate finds the items there");
+
+    index.query(kNaN, kNaN, found);
+    checks.check(found.empty(), "a NaN point is inside nothing");
+
+    index.query(Bounds{ 15.0f, 15.0f, 35.0f, 35.0f }, found);
+    checks.check(found == std::vector<int>{ 3, 8 }, "an area query finds what it overlaps in z order");
+
+    index.query(Bounds{ -kInfinity, -kInfinity, kInfinity, kInfinity }, found);
+    checks.check(found.size() == 7 && !contains(found, 5), "an infinite area finds everything but the NaN item");
+
+    index.query(Bounds{ kNaN, 0.0f, 10.0f, 10.0f }, found);
+    checks.check(found.empty(), "a NaN area intersects nothing");
+
+    // moving between the grid and the side list either way
+    index.update(8, Bounds{ -kHuge, 20.0f, kHuge, 30.0f });
+    index.update(3, Bounds{ 100.0f, 100.0f, 110.0f, 110.0f });
+    index.query(Bounds{ 105.0f, 25.0f, 106.0f, 106.0f }, found);
+    checks.check(found == std::vector<int>{ 3, 8 }, "items move on and off the grid");
+
+    index.remove(std::vector<int>{ 2, 4, 7 });
+    index.remove(6);
+    index.query(Bounds{ -kHuge, -kHuge, kHuge, kHuge }, found);
+    checks.check(found == std::vector<int>{ 1, 3, 8 }, "items off the grid can be removed");
+
+    // renumbering takes the order it's given, skipping what isn't indexed, and new items go on top
+    index.renumber(std::vector<int>{ 8, 2, 1, 3 });
+    index.insert(9, Bounds{ 0.0f, 0.0f, 10.0f, 10.0f });
+    index.query(Bounds{ -kHuge, -kHuge, kHuge, kHuge }, found);
+    checks.check(found == std::vector<int>{ 8, 1, 3, 9 }, "renumbering reorders queries");
+
+    // items put back fit between their neighbours, at the bottom or on top, without moving anything else
+    index.insert(10, Bounds{ 0.0f, 0.0f, 10.0f, 10.0f });
+    index.insert(11, Bounds{ 0.0f, 0.0f, 10.0f, 10.0f });
+    index.insert(12, Bounds{ 0.0f, 0.0f, 10.0f, 10.0f });
+    std::uint64_t orderOfThree{ index.orderOf(3) };
+    int between[]{ 10, 11 };
+    int bottom{ 8 };
+    int one{ 1 };
+    int middle{ 3 };
+    int topmost{ 12 };
+    int top{ 9 };
+    checks.check(index.fitBetween(between, 2, &middle, &top), "two items fit in a gap");
+    checks.check(index.fitBetween(&bottom, 1, nullptr, &one) && index.fitBetween(&top, 1, &topmost, nullptr), "items fit at the bottom and on top");
+    index.query(Bounds{ -kHuge, -kHuge, kHuge, kHuge }, found);
+    checks.check(found == std::vector<int>{ 8, 1, 3, 10, 11, 12, 9 } && index.orderOf(3) == orderOfThree, "fitting only moves what's fitted");
+
+    // halving one gap again and again eventually runs out of room, and then nothing changes
+    int lower{ 10 };
+    int upper{ 11 };
+    bool fitted{ true };
+    int fits{ 0 };
+    while (fitted && fits < 64)
+    {
+        fitted = index.fitBetween(&upper, 1, &lower, &upper) && index.orderOf(upper) > index.orderOf(lower);
+        fits += fitted ? 1 : 0;
+    }
+    index.query(Bounds{ -kHuge, -kHuge, kHuge, kHuge }, found);
+    checks.check(!fitted && fits >= 16 && found == std::vector<int>{ 8, 1, 3, 10, 11, 12, 9 }, "a gap too narrow to fit into is refused");
+
+    // every item off the grid goes to the side list, so none of this walks more than a handful of cells
+    double ms{ std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count() };
+    checks.check(ms < 1000.0, "out-of-range bounds don't walk the cells between them");
+
+    return checks.result();
+}
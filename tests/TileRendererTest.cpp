@@ -0,0 +1,274 @@
+// Checks that a tile whose drawing throws doesn't stay pending forever: the renderer has to catch it on the
+// worker, let the UI thread know, and stop counting the tile as asked for, so the next repaint asks again.
+// A tile too big for any surface makes the worker's resize throw, as running out of memory would.
+//
+// Also checks that text the workers can't draw keeps its place in z order: a tile comes in layers split at
+// it, and the layers blended back together are what drawing the whole scene in one pass gives. And that
+// a grid of tiles drawn in parallel on several workers is pixel for pixel what the calling thread draws.
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <random>
+#include <vector>
+#include "TileRenderer.h"
+#include "tests/Check.h"
+
+namespace
+{
+    constexpr int kSize{ 64 };
+
+    // more pixels than a vector can hold, so the surface throws before it allocates anything
+    constexpr int kTooBig{ std::numeric_limits<int>::max() };
+
+    std::shared_ptr<const DisplayList> makeScene()
+    {
+        auto scene{ std::make_shared<DisplayList>() };
+        scene->drawRect(10.0f, 10.0f, 100.0f, 30.0f, 0xFF2060C0, 0.0f, true);
+        scene->drawEllipse(20.0f, 20.0f, 90.0f, 80.0f, 0xFF000000, 2.0f, false);
+        return scene;
+    }
+
+    // text in a font the workers have no outlines for, under a filled rect that covers part of it
+    std::shared_ptr<const DisplayList> makeTextScene(bool textOnTop)
+    {
+        auto scene{ std::make_shared<DisplayList>() };
+        if (!textOnTop)
+        {
+            scene->drawText(L"Text", 4.0f, 30.0f, L"Arial", 12.0f, 0xFF000000);
+        }
+        scene->drawRect(10.0f, 10.0f, 40.0f, 30.0f, 0xFFC02020, 0.0f, true);
+        scene->drawEllipse(5.0f, 5.0f, 50.0f, 50.0f, 0x802060C0, 3.0f, false);
+        if (textOnTop)
+        {
+            scene->drawText(L"Text", 4.0f, 30.0f, L"Arial", 12.0f, 0xFF000000);
+        }
+        return scene;
+    }
+
+    // shapes of every kind, half of them translucent, scattered over a grid of kGrid by kGrid tiles at kZoom
+    constexpr int kGrid{ 4 };
+    constexpr float kZoom{ 1.5f };
+
+    std::shared_ptr<const DisplayList> makeBusyScene()
+    {
+        auto scene{ std::make_shared<DisplayList>() };
+        std::mt19937 rng{ 11 };
+        float extent{ kGrid * kSize / kZoom };
+        auto at{ [&rng, extent] { return static_cast<float>(rng() % 1000) / 1000.0f * extent; } };
+        for (int i{ 0 }; i < 200; ++i)
+        {
+            std::uint32_t color{ (i % 2 == 0 ? 0xFF000000u : 0x80000000u) | static_cast<std::uint32_t>(rng() & 0xFFFFFF) };
+            float x{ at() };
+            float y{ at() };
+            switch (i % 5)
+            {
+            case 0: scene->drawLine(x, y, at(), at(), color, 1.0f + static_cast<float>(i % 4)); break;
+            case 1: scene->drawRect(x, y, at() / 3.0f, at() / 3.0f, color, 2.0f, i % 3 == 0); break;
+            case 2: scene->drawEllipse(x, y, at() / 3.0f, at() / 3.0f, color, 1.5f, i % 3 == 0); break;
+            case 3:
+            {
+                RenderPoint points[]{ { x, y }, { at(), at() }, { at(), at() } };
+                scene->drawPolygon(points, 3, color, 1.0f, i % 3 == 0);
+                break;
+            }
+            default:
+            {
+                RenderPoint points[]{ { x, y }, { at(), at() }, { at(), at() }, { at(), at() } };
+                scene->drawCurve(points, 4, color, 2.0f);
+                break;
+            }
+            }
+        }
+        return scene;
+    }
+
+    // tile (column, row) drawn on the calling thread, the way a worker sets up its surface
+    std::vector<std::uint32_t> drawHere(const DisplayList& scene, int column, int row)
+    {
+        RasterBackend backend(nullptr);
+        backend.resize(kSize, kSize);
+        backend.clear(0xFFFFFFFF);
+        backend.setView(Transform::scaling(kZoom, kZoom, 0.0f, 0.0f).then(Transform::translation(-static_cast<float>(column * kSize), -static_cast<float>(row * kSize))));
+        scene.replay(backend, TileRenderer::getCanvasBounds(column, row, kSize, kZoom));
+        return std::vector<std::uint32_t>(backend.getPixels(), backend.getPixels() + kSize * kSize);
+    }
+
+    // the whole scene drawn in one pass, which skips the text as the workers do
+    std::vector<std::uint32_t> drawInOnePass(const DisplayList& scene)
+    {
+        RasterBackend backend(nullptr);
+        backend.resize(kSize, kSize);
+        backend.clear(0xFFFFFFFF);
+        scene.replay(backend, TileRenderer::getCanvasBounds(0, 0, kSize, 1.0f));
+        return std::vector<std::uint32_t>(backend.getPixels(), backend.getPixels() + kSize * kSize);
+    }
+
+    // premultiplied source over, as the UI thread blends an overlay onto the tile
+    void blendOver(std::vector<std::uint32_t>& pixels, const std::vector<std::uint32_t>& layer)
+    {
+        for (std::size_t i{ 0 }; i < pixels.size(); ++i)
+        {
+            std::uint32_t keep{ 255 - (layer[i] >> 24) };
+            std::uint32_t result{ 0 };
+            for (int shift : { 24, 16, 8, 0 })
+            {
+                std::uint32_t channel{ ((layer[i] >> shift) & 0xFF) + (((pixels[i] >> shift) & 0xFF) * keep + 127) / 255 };
+                result |= (std::min)(channel, 255u) << shift;
+            }
+            pixels[i] = result;
+        }
+    }
+
+    // true if every channel of every pixel is within one step, as rounding the blend twice allows
+    bool nearlyEqual(const std::vector<std::uint32_t>& a, const std::vector<std::uint32_t>& b)
+    {
+        if (a.size() != b.size())
+        {
+            return false;
+        }
+        for (std::size_t i{ 0 }; i < a.size(); ++i)
+        {
+            for (int shift : { 24, 16, 8, 0 })
+            {
+                int difference{ static_cast<int>((a[i] >> shift) & 0xFF) - static_cast<int>((b[i] >> shift) & 0xFF) };
+                if (difference > 1 || difference < -1)
+                {
+                    return false;
+                }
+            }
+        }
+        return true;
+    }
+
+    // waits for the tiles asked for; false if an exception came out of the pool
+    bool waitQuietly(TileRenderer& renderer)
+    {
+        try
+        {
+            renderer.wait();
+            return true;
+        }
+        catch (...)
+        {
+            return false;
+        }
+    }
+}
+
+int main()
+{
+    Checks checks;
+    std::shared_ptr<const DisplayList> scene{ makeScene() };
+
+    // one worker, so the tile drawn after the failure is drawn by the thread whose surface threw
+    std::atomic<int> notified{ 0 };
+    TileRenderer renderer{ {}, [&notified] { notified.fetch_add(1); }, 1 };
+
+    renderer.request(1, 0, 1, kTooBig, 1.0f, scene);
+    checks.check(renderer.isPending(1, 0, 1), "a tile is pending once asked for");
+    checks.check(waitQuietly(renderer), "a tile that throws doesn't throw out of wait");
+    checks.check(renderer.getFailedCount() == 1, "the failure is counted");
+    checks.check(notified.load() == 1, "the UI thread is told, as for a finished tile");
+
+    std::vector<RenderedTile> finished;
+    renderer.takeFinished(finished);
+    checks.check(finished.empty(), "a tile that threw isn't handed out");
+    checks.check(!renderer.isPending(1, 0, 1) && renderer.getPendingCount() == 0, "a tile that threw is no longer pending");
+
+    // asked for again, and alongside others, it's drawn, the same as by a renderer that never failed
+    renderer.request(0, 0, 1, kSize, 1.0f, scene);
+    renderer.request(1, 0, 2, kSize, 1.0f, scene);
+    renderer.request(2, 0, 1, kTooBig, 1.0f, scene);
+    checks.check(waitQuietly(renderer), "wait returns with a failure among drawn tiles");
+    renderer.takeFinished(finished);
+    checks.check(finished.size() == 2 && renderer.getPendingCount() == 0 && renderer.getFailedCount() == 2, "the drawn tiles are handed out and nothing is left pending");
+
+    TileRenderer fresh{ {}, nullptr, 1 };
+    fresh.request(1, 0, 2, kSize, 1.0f, scene);
+    fresh.wait();
+    std::vector<RenderedTile> expected;
+    fresh.takeFinished(expected);
+    bool same{ false };
+    for (const RenderedTile& tile : finished)
+    {
+        if (tile.column == 1 && expected.size() == 1)
+        {
+            same = tile.revision == 2 && tile.pixels.size() == static_cast<std::size_t>(kSize) * kSize && tile.pixels == expected[0].pixels;
+        }
+    }
+    checks.check(same, "the worker whose surface threw draws the tile again as a fresh one would");
+
+    // text under a shape: the shapes over it come as a layer of their own, and nothing is lost splitting them off
+    {
+        std::shared_ptr<const DisplayList> textScene{ makeTextScene(false) };
+        TileRenderer layered{ {}, nullptr, 1 };
+        layered.request(0, 0, 1, kSize, 1.0f, textScene);
+        layered.wait();
+        std::vector<RenderedTile> tiles;
+        layered.takeFinished(tiles);
+
+        bool split{ tiles.size() == 1 && tiles[0].overlays.size() == 1 && tiles[0].overlays[0].text == 0 && !tiles[0].overlays[0].pixels.empty() };
+        checks.check(split, "a tile with text under a shape is split at the text");
+        if (split)
+        {
+            const RenderedTile& tile{ tiles[0] };
+            std::size_t inRect{ 20 * kSize + 20 };
+            checks.check(tile.pixels[inRect] == 0xFFFFFFFF && tile.overlays[0].pixels[inRect] == 0xFFC02020, "the shape over the text is in the layer above it");
+            checks.check(tile.overlays[0].pixels[kSize * kSize - 1] == 0, "the layer is clear where nothing is drawn");
+
+            std::vector<std::uint32_t> blended{ tile.pixels };
+            blendOver(blended, tile.overlays[0].pixels);
+            checks.check(nearlyEqual(blended, drawInOnePass(*textScene)), "the layers blend back into the scene drawn in one pass");
+        }
+    }
+
+    // text on top needs nothing over it, and a tile without text isn't split
+    {
+        TileRenderer layered{ {}, nullptr, 1 };
+        layered.request(0, 0, 1, kSize, 1.0f, makeTextScene(true));
+        layered.request(1, 0, 1, kSize, 1.0f, scene);
+        layered.wait();
+        std::vector<RenderedTile> tiles;
+        layered.takeFinished(tiles);
+        std::sort(tiles.begin(), tiles.end(), [](const RenderedTile& a, const RenderedTile& b) { return a.column < b.column; });
+        checks.check(tiles.size() == 2 && tiles[0].overlays.size() == 1 && tiles[0].overlays[0].pixels.empty() && tiles[0].pixels == drawInOnePass(*tiles[0].scene),
+            "text on top leaves an empty layer over it and the rest in the tile");
+        checks.check(tiles.size() == 2 && tiles[1].overlays.empty(), "a tile without text comes in one layer");
+    }
+
+    // every tile of a busy scene, asked for twice over on four workers so they steal from each other
+    {
+        std::shared_ptr<const DisplayList> busy{ makeBusyScene() };
+        TileRenderer parallel{ {}, nullptr, 4 };
+        for (std::uint64_t revision : { 1u, 2u })
+        {
+            for (int row{ 0 }; row < kGrid; ++row)
+            {
+                for (int column{ 0 }; column < kGrid; ++column)
+                {
+                    parallel.request(column, row, revision, kSize, kZoom, busy);
+                }
+            }
+        }
+        parallel.wait();
+        std::vector<RenderedTile> tiles;
+        parallel.takeFinished(tiles);
+
+        bool same{ parallel.getThreadCount() == 4 && tiles.size() == 2 * kGrid * kGrid };
+        bool drawn{ false };
+        for (const RenderedTile& tile : tiles)
+        {
+            std::vector<std::uint32_t> here{ drawHere(*busy, tile.column, tile.row) };
+            same = same && tile.overlays.empty() && tile.pixels == here;
+            drawn = drawn || std::any_of(here.begin(), here.end(), [](std::uint32_t pixel) { return pixel != 0xFFFFFFFF; });
+        }
+        checks.check(drawn, "the busy scene draws something");
+        checks.check(same, "tiles drawn in parallel on the pool match the calling thread's, pixel for pixel");
+    }
+
+    return checks.result();
+}
@@ -0,0 +1,137 @@
+// Checks that undo and redo put shapes back in the z order they had. Grouping and ungrouping change which
+// orders the spatial index holds, so orders taken before then (a deleted shape's, for one) go stale; undoing
+// past an ungroup must still fit a restored shape back over what it used to cover.
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+#include "Simple Score.h"
+#include "tests/Check.h"
+
+namespace
+{
+    // what the model draws, as the size of each shape in draw order; every shape here has its own size
+    class SizeRecorder : public RenderBackend
+    {
+    public:
+        std::vector<int> sizes;
+
+        void drawLine(float, float, float, float, std::uint32_t, float) override {}
+        void drawRect(float, float, float width, float, std::uint32_t, float, bool) override { sizes.push_back(static_cast<int>(width + 0.5f)); }
+        void drawEllipse(float, float, float, float, std::uint32_t, float, bool) override {}
+        void drawPolygon(const RenderPoint*, std::size_t, std::uint32_t, float, bool) override {}
+        void drawCurve(const RenderPoint*, std::size_t, std::uint32_t, float) override {}
+        void drawBeziers(const RenderPoint*, std::size_t, std::uint32_t, float) override {}
+        void drawText(const std::wstring&, float, float, const std::wstring&, float size, std::uint32_t) override { sizes.push_back(static_cast<int>(size + 0.5f)); }
+        void setTransform(const Transform&) override {}
+    };
+
+    const Bounds kEverything{ -1000.0f, -1000.0f, 1000.0f, 1000.0f };
+
+    // three shapes in a row, sized 40, 41 and 42, then one sized 100 on top that overlaps the third
+    const float kLefts[]{ 0.0f, 50.0f, 100.0f, 120.0f };
+    const int kSizes[]{ 40, 41, 42, 100 };
+    const std::vector<int> kDrawn{ 40, 41, 42, 100 };
+
+    struct DrawingLayer
+    {
+        std::unique_ptr<DRAW_SHAPES> model{ std::make_unique<DRAW_SHAPES>() };
+
+        void add(float left, int size) { model->addRect(RenderPoint{ left, left == 120.0f ? 20.0f : 0.0f }, static_cast<float>(size), 40.0f, 0xFF000000, 1, false); }
+        void click(int x, int y) { model->selectShape(x, y); model->dropShape(); }
+        void band(float right, float bottom)
+        {
+            model->selectShape(-5, -5);
+            model->setOrigin(RenderPoint{ -5.0f, -5.0f });
+            model->setCurrent(RenderPoint{ right, bottom });
+            model->selectShapes();
+            model->stopSelecting();
+        }
+        void remove() { model->removeShape(); }
+        void group() { model->groupSelected(); }
+        void ungroup() { model->ungroupSelected(); }
+        void undo() { model->undo(); }
+        void redo() { model->redo(); }
+        void draw(RenderBackend& backend) { model->drawStoredShapes(backend, kEverything); }
+    };
+
+    struct ScoreLayer
+    {
+        std::unique_ptr<SCORE> model{ std::make_unique<SCORE>() };
+
+        void add(float left, int size) { model->addSymbol(RenderPoint{ left, left == 120.0f ? 20.0f : 0.0f }, size, L"\xE0A4"); }
+        void click(int x, int y) { model->selectElement(x, y); model->dropElement(); }
+        void band(float right, float bottom)
+        {
+            model->selectElement(-5, -5);
+            model->setOrigin(RenderPoint{ -5.0f, -5.0f });
+            model->setCurrent(RenderPoint{ right, bottom });
+            model->selectElements();
+            model->stopSelecting();
+        }
+        void remove() { model->removeElement(); }
+        void group() { model->groupSelected(); }
+        void ungroup() { model->ungroupSelected(); }
+        void undo() { model->undo(); }
+        void redo() { model->redo(); }
+        void draw(RenderBackend& backend) { model->drawStoredElements(backend, kEverything); }
+    };
+
+    template<typename Layer>
+    std::vector<int> drawn(Layer& layer)
+    {
+        SizeRecorder recorder;
+        layer.draw(recorder);
+        return recorder.sizes;
+    }
+
+    template<typename Layer>
+    void check(Checks& checks, const char* name)
+    {
+        Layer layer;
+        for (std::size_t i{ 0 }; i < 4; ++i)
+        {
+            layer.add(kLefts[i], kSizes[i]);
+        }
+        std::string prefix{ std::string{ name } + ": " };
+        checks.check(drawn(layer) == kDrawn, (prefix + "the shapes draw bottom first").c_str());
+
+        // group the three in the row, delete the one on top, then dissolve the group
+        layer.band(145.0f, 45.0f);
+        layer.group();
+        layer.click(200, 50);
+        layer.remove();
+        layer.click(10, 10);
+        layer.ungroup();
+        checks.check(drawn(layer) == std::vector<int>{ 40, 41, 42 }, (prefix + "ungrouping keeps the order").c_str());
+
+        layer.undo();
+        layer.undo();
+        checks.check(drawn(layer) == kDrawn, (prefix + "undoing the ungroup and the delete draws the deleted shape on top again").c_str());
+
+        layer.redo();
+        layer.redo();
+        checks.check(drawn(layer) == std::vector<int>{ 40, 41, 42 }, (prefix + "redoing both keeps the order").c_str());
+
+        layer.undo();
+        layer.undo();
+        layer.undo();
+        checks.check(drawn(layer) == kDrawn, (prefix + "undoing back past the group still draws the shapes in order").c_str());
+
+        // a shape added afterwards goes on top of everything
+        layer.add(300.0f, 43);
+        std::vector<int> withNew{ kDrawn };
+        withNew.push_back(43);
+        checks.check(drawn(layer) == withNew, (prefix + "a new shape draws on top").c_str());
+    }
+}
+
+int main()
+{
+    Checks checks;
+    check<DrawingLayer>(checks, "drawing");
+    check<ScoreLayer>(checks, "score");
+    return checks.result();
+}
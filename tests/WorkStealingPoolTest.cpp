@@ -0,0 +1,86 @@
+// Checks the work-stealing pool: every task runs once, wait() returns when they have, a task that throws
+// neither loses the others nor hangs wait() but has its exception rethrown there, and idle workers sleep
+// rather than spin.
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <ctime>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+#include "WorkStealingPool.h"
+#include "tests/Check.h"
+
+int main()
+{
+    Checks checks;
+    WorkStealingPool pool{ 4 };
+
+    std::atomic<std::size_t> ran{ 0 };
+    for (int i{ 0 }; i < 10000; ++i)
+    {
+        pool.submit([&ran] { ran.fetch_add(1, std::memory_order_relaxed); });
+    }
+    pool.wait();
+    checks.check(ran.load() == 10000, "wait returns once every task has run");
+
+    // tasks that submit more, as a tile might
+    ran = 0;
+    for (int i{ 0 }; i < 100; ++i)
+    {
+        pool.submit([&pool, &ran] {
+            for (int k{ 0 }; k < 10; ++k)
+            {
+                pool.submit([&ran] { ran.fetch_add(1, std::memory_order_relaxed); });
+            }
+        });
+    }
+    pool.wait();
+    checks.check(ran.load() == 1000, "tasks submitted from tasks run before wait returns");
+
+    ran = 0;
+    for (int i{ 0 }; i < 100; ++i)
+    {
+        pool.submit([&ran, i] {
+            ran.fetch_add(1, std::memory_order_relaxed);
+            if (i % 10 == 3)
+            {
+                throw std::runtime_error("tile failed");
+            }
+        });
+    }
+    bool threw{ false };
+    try
+    {
+        pool.wait();
+    }
+    catch (const std::runtime_error&)
+    {
+        threw = true;
+    }
+    checks.check(threw && ran.load() == 100, "a throwing task is rethrown from wait after the rest have run");
+
+    bool threwAgain{ false };
+    try
+    {
+        pool.wait();
+    }
+    catch (...)
+    {
+        threwAgain = true;
+    }
+    checks.check(!threwAgain, "an exception is rethrown once");
+
+    pool.submit([&ran] { ran.fetch_add(1, std::memory_order_relaxed); });
+    pool.wait();
+    checks.check(ran.load() == 101, "the pool keeps working after a task throws");
+
+    // four idle workers over a quarter of a second should use next to no processor time
+    std::clock_t before{ std::clock() };
+    std::this_thread::sleep_for(std::chrono::milliseconds(250));
+    double cpuMs{ (std::clock() - before) * 1000.0 / CLOCKS_PER_SEC };
+    checks.check(cpuMs < 50.0, "idle workers sleep");
+
+    return checks.result();
+}